@@ -0,0 +1,102 @@
+#ifndef CLIENT_CLOCK_OFFSET_H
+#define CLIENT_CLOCK_OFFSET_H
+
+//-- includes -----
+#include <atomic>
+#include <chrono>
+
+//-- definitions -----
+/// Estimates the offset between the client's clock and the service's steady clock (client time - service time)
+/// from GET_SERVICE_TIME round trips.
+/// A round trip bounds the error of its offset to half the round trip time, so the sample with the shortest
+/// round trip is kept (a minimum filter). The kept round trip is aged by k_round_trip_creep_usec_per_sec
+/// so that newer samples eventually replace it and the estimate follows the drift between the clocks.
+/// One thread adds samples, any thread can read the estimate.
+class ClientClockOffsetEstimator
+{
+public:
+    // Twice the drift of a 100ppm clock, the error bound of the kept sample grows at least that fast
+    static const unsigned long long k_round_trip_creep_usec_per_sec = 200;
+
+    ClientClockOffsetEstimator()
+        : m_offset_usec(0)
+        , m_round_trip_usec(0)
+        , m_sample_time_usec(0)
+    {
+    }
+
+    /// The client's clock the samples are taken on (steady_clock, microseconds)
+    static unsigned long long get_client_time_usec()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /// Writer thread only. Forgets every sample, e.g. when the service may have restarted.
+    void reset()
+    {
+        m_round_trip_usec.store(0, std::memory_order_relaxed);
+        m_offset_usec.store(0, std::memory_order_relaxed);
+        m_sample_time_usec = 0;
+    }
+
+    /// Writer thread only. The request was sent at sent_usec and its response received at received_usec
+    /// (both on the client's clock), service_usec is the service's clock when it handled the request.
+    /// Returns true if the sample replaced the estimate.
+    bool add_round_trip_sample(
+        unsigned long long sent_usec,
+        unsigned long long service_usec,
+        unsigned long long received_usec)
+    {
+        const unsigned long long round_trip_usec = (received_usec > sent_usec) ? received_usec - sent_usec : 1;
+        const unsigned long long kept_round_trip_usec = m_round_trip_usec.load(std::memory_order_relaxed);
+
+        if (kept_round_trip_usec != 0)
+        {
+            const unsigned long long kept_age_usec =
+                (received_usec > m_sample_time_usec) ? received_usec - m_sample_time_usec : 0;
+            const unsigned long long aged_round_trip_usec =
+                kept_round_trip_usec + (kept_age_usec * k_round_trip_creep_usec_per_sec) / 1000000;
+
+            if (round_trip_usec > aged_round_trip_usec)
+            {
+                return false;
+            }
+        }
+
+        // Assume the service read its clock halfway through the round trip
+        const long long midpoint_usec = static_cast<long long>(sent_usec + round_trip_usec / 2);
+
+        // Readers check the round trip first, so the offset has to be visible before it
+        m_offset_usec.store(midpoint_usec - static_cast<long long>(service_usec), std::memory_order_relaxed);
+        m_round_trip_usec.store(round_trip_usec, std::memory_order_release);
+        m_sample_time_usec = received_usec;
+
+        return true;
+    }
+
+    /// Any thread. False until the first sample.
+    bool get_has_offset() const
+    {
+        return m_round_trip_usec.load(std::memory_order_acquire) != 0;
+    }
+
+    /// Any thread. Client time minus service time, 0 until the first sample.
+    long long get_offset_usec() const
+    {
+        return m_offset_usec.load(std::memory_order_relaxed);
+    }
+
+    /// Any thread. Round trip of the sample behind the estimate, 0 until the first sample.
+    unsigned long long get_round_trip_usec() const
+    {
+        return m_round_trip_usec.load(std::memory_order_acquire);
+    }
+
+private:
+    std::atomic<long long> m_offset_usec;
+    std::atomic<unsigned long long> m_round_trip_usec;
+    unsigned long long m_sample_time_usec; // Writer thread only
+};
+
+#endif // CLIENT_CLOCK_OFFSET_H
@@ -18,6 +18,26 @@
 // The max length of the service version string
 #define PSMOVESERVICE_MAX_VERSION_STRING_LEN 32
 
+// How far past the last received pose PSM_Get*PoseAtTime() will extrapolate
+#define PSM_MAX_POSE_EXTRAPOLATION_USEC 100000 // microseconds
+
+// Layout versions of the PSMControllerStateBlock and PSMHmdStateBlock structures
+#define PSM_CONTROLLER_STATE_BLOCK_VERSION 1
+#define PSM_HMD_STATE_BLOCK_VERSION 1
+
+// Latency histogram buckets: bucket i counts samples below (PSM_LATENCY_HISTOGRAM_FIRST_BUCKET_USEC << i),
+// the last bucket counts everything else
+#define PSM_LATENCY_HISTOGRAM_BUCKET_COUNT 12
+#define PSM_LATENCY_HISTOGRAM_FIRST_BUCKET_USEC 125 // microseconds
+
+// Service stage histogram buckets: bucket i counts durations below (PSM_SERVICE_STAGE_HISTOGRAM_FIRST_BUCKET_NSEC << i),
+// the last bucket counts everything else
+#define PSM_SERVICE_STAGE_HISTOGRAM_BUCKET_COUNT 16
+#define PSM_SERVICE_STAGE_HISTOGRAM_FIRST_BUCKET_NSEC 1000 // nanoseconds
+
+// Max number of stage histograms in a PSMServicePerformanceStats
+#define PSM_MAX_SERVICE_STAGE_STATS_COUNT 64
+
 // Defines a standard _PAUSE function
 #if __cplusplus >= 199711L  // if C++11
     #include <thread>
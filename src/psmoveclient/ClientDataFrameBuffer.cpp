@@ -0,0 +1,38 @@
+//-- includes -----
+#include "ClientDataFrameBuffer.h"
+#include "PSMoveProtocol.pb.h"
+
+#include <google/protobuf/arena.h>
+
+//-- constants -----
+// Same size as the block the network manager decodes data frames onto
+static const size_t k_data_frame_arena_block_size = 4096;
+
+//-- public methods -----
+ClientDataFrameBuffer::ClientDataFrameBuffer()
+    : m_arena_block(k_data_frame_arena_block_size)
+    , m_arena(nullptr)
+    , m_data_frame(nullptr)
+{
+    google::protobuf::ArenaOptions options;
+
+    options.initial_block= m_arena_block.data();
+    options.initial_block_size= m_arena_block.size();
+
+    m_arena= new google::protobuf::Arena(options);
+}
+
+ClientDataFrameBuffer::~ClientDataFrameBuffer()
+{
+    m_data_frame= nullptr;
+    delete m_arena;
+}
+
+void ClientDataFrameBuffer::copy_from(const PSMoveProtocol::DeviceOutputDataFrame *data_frame)
+{
+    // Frees the previous frame, but keeps the initial block for the new one
+    m_arena->Reset();
+
+    m_data_frame= google::protobuf::Arena::CreateMessage<PSMoveProtocol::DeviceOutputDataFrame>(m_arena);
+    m_data_frame->CopyFrom(*data_frame);
+}
@@ -0,0 +1,47 @@
+#ifndef CLIENT_DATA_FRAME_BUFFER_H
+#define CLIENT_DATA_FRAME_BUFFER_H
+
+//-- includes -----
+#include <vector>
+
+//-- pre-declarations -----
+namespace google
+{
+    namespace protobuf
+    {
+        class Arena;
+    };
+};
+
+namespace PSMoveProtocol
+{
+    class DeviceOutputDataFrame;
+};
+
+//-- definitions -----
+/// Holds a copy of a data frame on an arena of its own.
+/// The arena starts on a preallocated block that is reused for every copy, 
+/// so copying a frame in doesn't touch the heap (CopyFrom into a heap message re-creates its sub-messages).
+class ClientDataFrameBuffer
+{
+public:
+    ClientDataFrameBuffer();
+    ~ClientDataFrameBuffer();
+
+    /// Replaces the held frame, invalidating the pointer get() returned before
+    void copy_from(const PSMoveProtocol::DeviceOutputDataFrame *data_frame);
+
+    /// The held frame, null until a frame is copied in
+    const PSMoveProtocol::DeviceOutputDataFrame *get() const { return m_data_frame; }
+
+private:
+    ClientDataFrameBuffer(const ClientDataFrameBuffer &) = delete;
+    ClientDataFrameBuffer &operator=(const ClientDataFrameBuffer &) = delete;
+
+    // The initial block must be declared before the arena so that it outlives it
+    std::vector<char> m_arena_block;
+    google::protobuf::Arena *m_arena;
+    PSMoveProtocol::DeviceOutputDataFrame *m_data_frame;
+};
+
+#endif // CLIENT_DATA_FRAME_BUFFER_H
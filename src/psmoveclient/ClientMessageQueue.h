@@ -0,0 +1,135 @@
+#ifndef CLIENT_MESSAGE_QUEUE_H
+#define CLIENT_MESSAGE_QUEUE_H
+
+//-- includes -----
+#include <google/protobuf/arena.h>
+
+#include <vector>
+#include <stddef.h>
+
+//-- definitions -----
+/// Bounded ring of plain-old-data messages (e.g. PSMMessage).
+/// All storage is allocated up front, so pushing and popping never touches the heap.
+/// A push onto a full ring is dropped and counted rather than growing the ring.
+template <typename t_message>
+class ClientMessageRing
+{
+public:
+    ClientMessageRing(size_t capacity)
+        : m_messages(capacity)
+        , m_read_index(0)
+        , m_count(0)
+        , m_overflow_count(0)
+    {
+    }
+
+    bool push(const t_message &message)
+    {
+        if (m_count >= m_messages.size())
+        {
+            ++m_overflow_count;
+            return false;
+        }
+
+        m_messages[(m_read_index + m_count) % m_messages.size()]= message;
+        ++m_count;
+
+        return true;
+    }
+
+    bool pop(t_message &out_message)
+    {
+        if (m_count == 0)
+        {
+            return false;
+        }
+
+        out_message= m_messages[m_read_index];
+        m_read_index= (m_read_index + 1) % m_messages.size();
+        --m_count;
+
+        return true;
+    }
+
+    void clear()
+    {
+        m_read_index= 0;
+        m_count= 0;
+    }
+
+    inline size_t size() const { return m_count; }
+    inline size_t capacity() const { return m_messages.size(); }
+    inline unsigned long long getOverflowCount() const { return m_overflow_count; }
+
+private:
+    std::vector<t_message> m_messages;
+    size_t m_read_index;
+    size_t m_count;
+    unsigned long long m_overflow_count;
+};
+
+/// Protobuf messages (e.g. PSMoveProtocol::Response) copied onto a shared arena and handed out until the next reset().
+/// The arena starts on a preallocated block that reset() rewinds, so storing up to the expected number of messages 
+/// per update (nested sub-messages included) never touches the heap.
+/// Storing more than that still succeeds: the arena grows onto heap blocks (freed again by the next reset())
+/// and the store gets counted as an overflow.
+template <typename t_message>
+class ClientMessagePool
+{
+public:
+    ClientMessagePool(size_t capacity, size_t arena_block_size)
+        : m_arena_block(arena_block_size)
+        , m_arena(make_arena_options(m_arena_block))
+        , m_capacity(capacity)
+        , m_used_count(0)
+        , m_overflow_count(0)
+    {
+    }
+
+    /// Returns a pooled copy of the message that stays valid until reset()
+    const t_message *store(const t_message &message)
+    {
+        if (m_used_count >= m_capacity)
+        {
+            ++m_overflow_count;
+        }
+
+        t_message *pooled_message= google::protobuf::Arena::CreateMessage<t_message>(&m_arena);
+        ++m_used_count;
+
+        pooled_message->CopyFrom(message);
+
+        return pooled_message;
+    }
+
+    /// Invalidates every stored message and rewinds the arena onto its initial block
+    void reset()
+    {
+        m_arena.Reset();
+        m_used_count= 0;
+    }
+
+    inline size_t size() const { return m_used_count; }
+    inline size_t capacity() const { return m_capacity; }
+    inline unsigned long long getOverflowCount() const { return m_overflow_count; }
+
+private:
+    static google::protobuf::ArenaOptions make_arena_options(std::vector<char> &block)
+    {
+        google::protobuf::ArenaOptions options;
+
+        options.initial_block= block.data();
+        options.initial_block_size= block.size();
+
+        return options;
+    }
+
+    // The initial block must be declared before the arena so that it outlives it
+    std::vector<char> m_arena_block;
+    google::protobuf::Arena m_arena;
+    size_t m_capacity;
+    size_t m_used_count;
+    unsigned long long m_overflow_count;
+};
+
+#endif // CLIENT_MESSAGE_QUEUE_H
@@ -3,28 +3,187 @@
 #include "ClientLog.h"
 #include "PackedMessage.h"
 #include "PSMoveProtocol.pb.h"
+#include <google/protobuf/arena.h>
 #include <cassert>
 #include <iostream>
 #include <string>
 #include <sstream>
 #include <vector>
 #include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <boost/asio.hpp>
 #include <boost/bind.hpp>
+#include <boost/function.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/cstdint.hpp>
 
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+#include <errno.h>
+#include <stdlib.h> // mkdtemp
+#include <unistd.h> // unlink, rmdir
+#endif
+
 //-- pre-declarations -----
 using namespace std;
 namespace asio = boost::asio;
 using asio::ip::tcp;
 using asio::ip::udp;
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+typedef asio::local::stream_protocol local_stream;
+typedef asio::local::datagram_protocol local_datagram;
+#endif
 using boost::uint8_t;
 
+//-- constants -----
+// Max number of already received data frames processed after each completed data frame read
+static const int k_max_data_frame_batch_size = 64;
+
+// Size of the preallocated arena block incoming data frames are decoded onto
+static const size_t k_output_data_frame_arena_block_size = 4096;
+
+// Initial capacity of the tcp response read buffer
+static const size_t k_initial_response_buffer_size = 4096;
+
+// How often the clock offset to the service gets measured
+static const int k_clock_sync_interval_ms = 1000;
+
+// Request id of the clock sync round trips.
+// The request manager hands out ids from zero up and notifications use -1, so this never collides.
+static const int k_clock_sync_request_id = -2;
+
 //-- implementation -----
 
+// -ClientDeferredEventQueue-
+// Stands in for the client's notification, response and connection event listeners
+// while the network manager runs its own I/O thread.
+// Everything reported on the I/O thread is queued up here and handed to the real listeners 
+// on the client's thread in dispatch(), so the client never sees these callbacks from another thread.
+class ClientDeferredEventQueue : 
+    public INotificationListener,
+    public IResponseListener,
+    public IClientNetworkEventListener
+{
+public:
+    ClientDeferredEventQueue(
+        INotificationListener *notificationListener,
+        IResponseListener *responseListener,
+        IClientNetworkEventListener *netEventListener)
+        : m_notification_listener(notificationListener)
+        , m_response_listener(responseListener)
+        , m_netEventListener(netEventListener)
+    {
+    }
+
+    inline INotificationListener *get_notification_listener() const { return m_notification_listener; }
+    inline IResponseListener *get_response_listener() const { return m_response_listener; }
+    inline IClientNetworkEventListener *get_net_event_listener() const { return m_netEventListener; }
+
+    // Called on the client's thread
+    void dispatch()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_event_mutex);
+            m_dispatching_events.swap(m_queued_events);
+        }
+
+        for (t_event_list::iterator iter= m_dispatching_events.begin(); iter != m_dispatching_events.end(); ++iter)
+        {
+            (*iter)();
+        }
+
+        m_dispatching_events.clear();
+    }
+
+    // INotificationListener
+    virtual void handle_notification(ResponsePtr notification) override
+    {
+        // The network manager unpacks every response into the same message, so queue up a copy
+        ResponsePtr notification_copy(new PSMoveProtocol::Response(*notification));
+
+        enqueue(boost::bind(&INotificationListener::handle_notification, m_notification_listener, notification_copy));
+    }
+
+    // IResponseListener
+    virtual void handle_request_canceled(RequestPtr request) override
+    {
+        enqueue(boost::bind(&IResponseListener::handle_request_canceled, m_response_listener, request));
+    }
+
+    virtual void handle_response(ResponsePtr response) override
+    {
+        ResponsePtr response_copy(new PSMoveProtocol::Response(*response));
+
+        enqueue(boost::bind(&IResponseListener::handle_response, m_response_listener, response_copy));
+    }
+
+    // IClientNetworkEventListener
+    virtual void handle_server_connection_opened() override
+    {
+        if (m_netEventListener)
+        {
+            enqueue(boost::bind(&IClientNetworkEventListener::handle_server_connection_opened, m_netEventListener));
+        }
+    }
+
+    virtual void handle_server_connection_open_failed(const boost::system::error_code& ec) override
+    {
+        if (m_netEventListener)
+        {
+            enqueue(boost::bind(&IClientNetworkEventListener::handle_server_connection_open_failed, m_netEventListener, ec));
+        }
+    }
+
+    virtual void handle_server_connection_closed() override
+    {
+        if (m_netEventListener)
+        {
+            enqueue(boost::bind(&IClientNetworkEventListener::handle_server_connection_closed, m_netEventListener));
+        }
+    }
+
+    virtual void handle_server_connection_close_failed(const boost::system::error_code& ec) override
+    {
+        if (m_netEventListener)
+        {
+            enqueue(boost::bind(&IClientNetworkEventListener::handle_server_connection_close_failed, m_netEventListener, ec));
+        }
+    }
+
+    virtual void handle_server_connection_socket_error(const boost::system::error_code& ec) override
+    {
+        if (m_netEventListener)
+        {
+            enqueue(boost::bind(&IClientNetworkEventListener::handle_server_connection_socket_error, m_netEventListener, ec));
+        }
+    }
+
+private:
+    typedef std::vector< boost::function<void()> > t_event_list;
+
+    void enqueue(const boost::function<void()> &event)
+    {
+        std::lock_guard<std::mutex> lock(m_event_mutex);
+        m_queued_events.push_back(event);
+    }
+
+    INotificationListener *m_notification_listener;
+    IResponseListener *m_response_listener;
+    IClientNetworkEventListener *m_netEventListener;
+
+    std::mutex m_event_mutex;
+    t_event_list m_queued_events;       // Guarded by m_event_mutex
+    t_event_list m_dispatching_events;  // Client thread only
+};
+
 // -ClientNetworkManagerImpl-
 // Internal implementation of the client network manager.
+// When the server is on this host (and the platform has unix domain sockets), 
+// requests and data frames go over local stream/datagram sockets instead of TCP/UDP.
+// If the server isn't listening on its local socket we fall back to TCP/UDP.
+// Optionally the sockets are serviced by an I/O thread instead of by poll(),
+// in which case data frames get handed to the data frame listener as soon as they arrive.
 class ClientNetworkManagerImpl
 {
 public:
@@ -44,6 +203,16 @@ public:
         , m_udp_socket(m_io_service, udp::endpoint(udp::v4(), 0))
         , m_udp_server_endpoint()
         , m_udp_remote_endpoint()
+        , m_is_local_connection(false)
+        , m_use_local_sockets(true)
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+        , m_local_stream_socket(m_io_service)
+        , m_local_datagram_socket(m_io_service)
+        , m_local_server_endpoint()
+        , m_local_remote_endpoint()
+        , m_local_client_socket_dir()
+        , m_local_client_socket_path()
+#endif
         , m_connection_stopped(false)
         , m_has_pending_tcp_read(false)
         , m_has_pending_tcp_write(false)
@@ -53,7 +222,8 @@ public:
         , m_response_read_buffer()
         , m_packed_response(std::shared_ptr<PSMoveProtocol::Response>(new PSMoveProtocol::Response()))
 
-        , m_packed_output_data_frame(std::shared_ptr<PSMoveProtocol::DeviceOutputDataFrame>(new PSMoveProtocol::DeviceOutputDataFrame()))
+        , m_output_data_frame_arena_block(k_output_data_frame_arena_block_size)
+        , m_output_data_frame_arena(make_arena_options(m_output_data_frame_arena_block))
     
         , m_write_bufer()
         , m_packed_request()
@@ -63,38 +233,123 @@ public:
         , m_response_listener(responseListener)
         , m_netEventListener(netEventListener)
         , m_pending_requests()
+
+        , m_deferred_events(notificationListener, responseListener, netEventListener)
+        , m_use_io_thread(false)
+        , m_io_thread()
+        , m_io_work()
+
+        , m_clock_offset()
+        , m_clock_sync_request(new PSMoveProtocol::Request())
+        , m_clock_sync_timer(m_io_service)
+        , m_clock_sync_sent_usec(0)
+        , m_is_clock_sync_enabled(false)
+        , m_has_pending_clock_sync(false)
     {
         memset(m_output_data_frame_buffer, 0, sizeof(m_output_data_frame_buffer));
+
+        // Sent again for every round trip, so syncing doesn't allocate a request
+        m_clock_sync_request->set_type(PSMoveProtocol::Request_RequestType_GET_SERVICE_TIME);
+        m_clock_sync_request->set_request_id(k_clock_sync_request_id);
+
+        // Most responses fit in here, so reading a response doesn't need to grow the buffer
+        m_response_read_buffer.reserve(k_initial_response_buffer_size);
     }
 
-    bool start()
+    virtual ~ClientNetworkManagerImpl()
     {
-        tcp::resolver resolver(m_io_service);
-        tcp::resolver::iterator endpoint_iter= resolver.resolve(tcp::resolver::query(tcp::v4(), m_server_host, m_server_port));
+        // The I/O thread must not outlive the sockets it's servicing
+        if (m_io_thread.joinable())
+        {
+            m_io_service.post(boost::bind(&ClientNetworkManagerImpl::stop, this));
+            stop_io_thread();
+        }
+    }
 
-        m_connection_stopped= false;
-        bool success= start_tcp_connect(endpoint_iter);
+    bool start(bool use_io_thread, bool use_local_sockets)
+    {
+        // A previous I/O thread has to be done with the sockets before we reconnect
+        stop_io_thread();
+
+        m_use_local_sockets= use_local_sockets;
+
+        // When the I/O thread is used everything except data frames gets reported back through poll()
+        m_use_io_thread= use_io_thread;
+        if (m_use_io_thread)
+        {
+            m_notification_listener= &m_deferred_events;
+            m_response_listener= &m_deferred_events;
+            m_netEventListener= &m_deferred_events;
+        }
+        else
+        {
+            m_notification_listener= m_deferred_events.get_notification_listener();
+            m_response_listener= m_deferred_events.get_response_listener();
+            m_netEventListener= m_deferred_events.get_net_event_listener();
+        }
+
+        bool success= start_connect();
+
+        if (success && m_use_io_thread)
+        {
+            start_io_thread();
+        }
 
         return success;
     }
 
     void send_request(RequestPtr request)
     {
-        m_pending_requests.push_back(request);
-        start_tcp_write_request();
+        if (m_use_io_thread)
+        {
+            // The sockets belong to the I/O thread
+            m_io_service.post(boost::bind(&ClientNetworkManagerImpl::start_request_write, this, request));
+        }
+        else
+        {
+            start_request_write(request);
+        }
     }
 
-    void send_device_data_frame(DeviceInputDataFramePtr data_frame)
+    void start_clock_sync()
     {
-        // Stamp the packet with the connection ID before it goes out
-        data_frame->set_connection_id(m_tcp_connection_id);
+        if (m_use_io_thread)
+        {
+            m_io_service.post(boost::bind(&ClientNetworkManagerImpl::begin_clock_sync, this));
+        }
+        else
+        {
+            begin_clock_sync();
+        }
+    }
 
-        m_pending_data_frames.push_back(data_frame);
-        start_udp_queued_data_frame_write();
+    const ClientClockOffsetEstimator &get_clock_offset() const
+    {
+        return m_clock_offset;
+    }
+
+    void send_device_data_frame(DeviceInputDataFramePtr data_frame)
+    {
+        if (m_use_io_thread)
+        {
+            m_io_service.post(boost::bind(&ClientNetworkManagerImpl::start_device_data_frame_write, this, data_frame));
+        }
+        else
+        {
+            start_device_data_frame_write(data_frame);
+        }
     }
 
     void poll()
     {
+        if (m_use_io_thread)
+        {
+            // The I/O thread already did the socket work.
+            // Just hand over the responses and events it received.
+            m_deferred_events.dispatch();
+            return;
+        }
+
         bool keep_polling = true;
         int iteration_count = 0;
         const static int k_max_iteration_count = 32;
@@ -120,12 +375,93 @@ public:
 
     }
 
+    void shutdown()
+    {
+        if (m_io_thread.joinable())
+        {
+            // Close the connection on the I/O thread and then let it run out of work
+            m_io_service.post(boost::bind(&ClientNetworkManagerImpl::stop, this));
+            stop_io_thread();
+
+            // Hand over whatever the I/O thread reported on the way out (e.g. the connection closing)
+            m_deferred_events.dispatch();
+        }
+        else
+        {
+            stop();
+        }
+    }
+
+private:
+    bool start_connect()
+    {
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+        if (m_use_local_sockets && is_local_host(m_server_host) && start_local_connect())
+        {
+            m_connection_stopped= false;
+            return true;
+        }
+#endif
+
+        tcp::resolver resolver(m_io_service);
+        tcp::resolver::iterator endpoint_iter= resolver.resolve(tcp::resolver::query(tcp::v4(), m_server_host, m_server_port));
+
+        m_connection_stopped= false;
+        bool success= start_tcp_connect(endpoint_iter);
+
+        return success;
+    }
+
+    void start_io_thread()
+    {
+        // Keep run() from returning while there is no socket operation in flight
+        m_io_service.reset();
+        m_io_work.reset(new asio::io_service::work(m_io_service));
+
+        m_io_thread= std::thread(&ClientNetworkManagerImpl::io_thread_func, this);
+    }
+
+    void stop_io_thread()
+    {
+        if (m_io_thread.joinable())
+        {
+            // run() returns once the handlers of the (now closed) sockets have been called
+            m_io_work.reset();
+            m_io_thread.join();
+        }
+    }
+
+    void io_thread_func()
+    {
+        CLIENT_LOG_INFO("ClientNetworkManager::io_thread_func") << "Network I/O thread started" << std::endl;
+
+        m_io_service.run();
+
+        CLIENT_LOG_INFO("ClientNetworkManager::io_thread_func") << "Network I/O thread exited" << std::endl;
+    }
+
+    void start_request_write(RequestPtr request)
+    {
+        m_pending_requests.push_back(request);
+        start_tcp_write_request();
+    }
+
+    void start_device_data_frame_write(DeviceInputDataFramePtr data_frame)
+    {
+        // Stamp the packet with the connection ID before it goes out
+        data_frame->set_connection_id(m_tcp_connection_id);
+
+        m_pending_data_frames.push_back(data_frame);
+        start_udp_queued_data_frame_write();
+    }
+
     void stop()
     {
         // drain any pending requests
         while (m_pending_requests.size() > 0)
         {
-            if (m_response_listener)
+            // The clock sync request never went through the request manager
+            if (m_response_listener && m_pending_requests.front() != m_clock_sync_request)
             {
                 m_response_listener->handle_request_canceled(m_pending_requests.front());
             }
@@ -133,24 +469,29 @@ public:
             m_pending_requests.pop_front();
         }
 
-        // close the tcp request socket
-        if (m_tcp_socket.is_open())
-        {
-            boost::system::error_code shutdown_error;
-            m_tcp_socket.shutdown(asio::socket_base::shutdown_both, shutdown_error);
+        // The next connection may be to a restarted service, so measure the clock offset from scratch
+        stop_clock_sync();
 
-            if (shutdown_error)
-            {
-                CLIENT_LOG_ERROR("ClientNetworkManager::stop") << "Problem shutting down the socket: " << shutdown_error.message() << std::endl;
-            }
+        // close the tcp (or local) request socket
+        boost::system::error_code close_error;
+        bool was_open= close_stream_socket(m_tcp_socket, close_error);
 
-            boost::system::error_code close_error;
-            m_tcp_socket.close(close_error);
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+        was_open|= close_stream_socket(m_local_stream_socket, close_error);
 
+        if (m_local_datagram_socket.is_open())
+        {
+            boost::system::error_code datagram_close_error;
+            m_local_datagram_socket.close(datagram_close_error);
+            ::unlink(m_local_client_socket_path.c_str());
+            ::rmdir(m_local_client_socket_dir.c_str());
+        }
+#endif
+
+        if (was_open)
+        {
             if (close_error)
             {
-                CLIENT_LOG_ERROR("ClientNetworkManager::stop") << "Problem closing the socket: " << close_error.message() << std::endl;
-
                 if (m_netEventListener)
                 {
                     m_netEventListener->handle_server_connection_close_failed(close_error);
@@ -172,7 +513,166 @@ public:
         m_has_pending_udp_write = false;
     }
 
-private:
+    template <typename t_socket>
+    static bool close_stream_socket(t_socket &socket, boost::system::error_code &close_error)
+    {
+        if (!socket.is_open())
+            return false;
+
+        boost::system::error_code shutdown_error;
+        socket.shutdown(asio::socket_base::shutdown_both, shutdown_error);
+
+        if (shutdown_error)
+        {
+            CLIENT_LOG_ERROR("ClientNetworkManager::stop") << "Problem shutting down the socket: " << shutdown_error.message() << std::endl;
+        }
+
+        socket.close(close_error);
+
+        if (close_error)
+        {
+            CLIENT_LOG_ERROR("ClientNetworkManager::stop") << "Problem closing the socket: " << close_error.message() << std::endl;
+        }
+
+        return true;
+    }
+
+    // The stream and datagram socket calls go through these so that the rest of the 
+    // client doesn't care whether it's talking to the server over tcp/udp or unix domain sockets
+    template <typename t_buffer, typename t_handler>
+    void async_read_stream(const t_buffer &buffer, t_handler handler)
+    {
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+        if (m_is_local_connection)
+        {
+            asio::async_read(m_local_stream_socket, buffer, handler);
+            return;
+        }
+#endif
+        asio::async_read(m_tcp_socket, buffer, handler);
+    }
+
+    template <typename t_buffer, typename t_handler>
+    void async_write_stream(const t_buffer &buffer, t_handler handler)
+    {
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+        if (m_is_local_connection)
+        {
+            asio::async_write(m_local_stream_socket, buffer, handler);
+            return;
+        }
+#endif
+        asio::async_write(m_tcp_socket, buffer, handler);
+    }
+
+    template <typename t_buffer, typename t_handler>
+    void async_send_datagram(const t_buffer &buffer, t_handler handler)
+    {
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+        if (m_is_local_connection)
+        {
+            m_local_datagram_socket.async_send_to(buffer, m_local_server_endpoint, handler);
+            return;
+        }
+#endif
+        m_udp_socket.async_send_to(buffer, m_udp_server_endpoint, handler);
+    }
+
+    template <typename t_buffer, typename t_handler>
+    void async_receive_datagram(const t_buffer &buffer, udp::endpoint &udp_sender_endpoint, t_handler handler)
+    {
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+        if (m_is_local_connection)
+        {
+            m_local_datagram_socket.async_receive_from(buffer, m_local_remote_endpoint, handler);
+            return;
+        }
+#endif
+        m_udp_socket.async_receive_from(buffer, udp_sender_endpoint, handler);
+    }
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    static bool is_local_host(const std::string &host)
+    {
+        return host == "localhost" || host == "127.0.0.1" || host == "::1";
+    }
+
+    // The service names its local sockets after its port, so they only ever lead to the service on m_server_port
+    std::string make_local_server_socket_path(const char *suffix) const
+    {
+        return std::string(PSMOVESERVICE_LOCAL_SOCKET_PATH_PREFIX) + m_server_port + suffix;
+    }
+
+    bool start_local_connect()
+    {
+        boost::system::error_code error;
+        const std::string server_stream_socket_path= make_local_server_socket_path(PSMOVESERVICE_LOCAL_STREAM_SOCKET_SUFFIX);
+
+        // Connecting a unix domain socket completes (or fails) immediately,
+        // so there is no need to go through the async connect path
+        m_local_stream_socket.connect(local_stream::endpoint(server_stream_socket_path), error);
+
+        if (error)
+        {
+            CLIENT_LOG_INFO("ClientNetworkManager::start_local_connect") 
+                << "No local socket (" << error.message() << "), using TCP/UDP instead" << std::endl;
+
+            boost::system::error_code close_error;
+            m_local_stream_socket.close(close_error);
+
+            return false;
+        }
+
+        m_local_server_endpoint= 
+            local_datagram::endpoint(make_local_server_socket_path(PSMOVESERVICE_LOCAL_DATAGRAM_SOCKET_SUFFIX));
+
+        // Data frames come back to a datagram socket bound inside a directory private to this client.
+        // mkdtemp picks a fresh name and creates it with 0700 permissions in one step,
+        // so concurrent clients (in this or any other process) never share or hijack each other's socket.
+        char socket_dir_template[]= "/tmp/psmoveclient-XXXXXX";
+        if (::mkdtemp(socket_dir_template) != nullptr)
+        {
+            m_local_client_socket_dir= socket_dir_template;
+            m_local_client_socket_path= m_local_client_socket_dir + "/data.dgram";
+
+            m_local_datagram_socket.open(local_datagram(), error);
+        }
+        else
+        {
+            error= boost::system::error_code(errno, boost::system::system_category());
+        }
+
+        if (!error)
+        {
+            m_local_datagram_socket.bind(local_datagram::endpoint(m_local_client_socket_path), error);
+        }
+
+        if (error)
+        {
+            CLIENT_LOG_ERROR("ClientNetworkManager::start_local_connect") 
+                << "Failed to bind local datagram socket " << m_local_client_socket_path << ": " << error.message() << std::endl;
+
+            boost::system::error_code close_error;
+            m_local_stream_socket.close(close_error);
+            m_local_datagram_socket.close(close_error);
+            ::unlink(m_local_client_socket_path.c_str());
+            ::rmdir(m_local_client_socket_dir.c_str());
+
+            return false;
+        }
+
+        CLIENT_LOG_INFO("ClientNetworkManager::start_local_connect") 
+            << "Connected to " << server_stream_socket_path << std::endl;
+
+        m_is_local_connection= true;
+
+        // Start listening for any incoming responses (the connection info notification comes first)
+        start_tcp_read_response_header();
+
+        return true;
+    }
+#endif
+
     bool start_tcp_connect(tcp::resolver::iterator endpoint_iter)
     {
         bool success= true;
@@ -292,9 +792,8 @@ private:
 
             // Start an asynchronous operation to send the data frame
             // NOTE: Even if the write completes immediate, the callback will only be called from io_service::poll()
-            m_udp_socket.async_send_to(
-                boost::asio::buffer(m_input_data_frame_buffer, sizeof(m_input_data_frame_buffer)),
-                m_udp_server_endpoint,
+            async_send_datagram(
+                boost::asio::buffer(m_input_data_frame_buffer, HEADER_SIZE + msg_size),
                 boost::bind(&ClientNetworkManagerImpl::handle_udp_write_connection_id, this, _1));
         }
         else
@@ -313,7 +812,7 @@ private:
 
             // Now wait for the response
             //###bwalker $TODO timeout
-            m_udp_socket.async_receive_from(
+            async_receive_datagram(
                 boost::asio::buffer(&m_udp_connection_result_read_buffer, sizeof(m_udp_connection_result_read_buffer)),
                 m_udp_remote_endpoint,
                 boost::bind(&ClientNetworkManagerImpl::handle_udp_read_connection_result, this, boost::asio::placeholders::error));
@@ -376,8 +875,7 @@ private:
         {
             m_has_pending_tcp_read= true;
             m_response_read_buffer.resize(HEADER_SIZE);
-            asio::async_read(
-                m_tcp_socket, 
+            async_read_stream(
                 asio::buffer(m_response_read_buffer),
                 boost::bind(
                     &ClientNetworkManagerImpl::handle_tcp_read_response_header, 
@@ -431,8 +929,7 @@ private:
         // Expand it to fit in the body as well, and start async read into the body.
         m_response_read_buffer.resize(HEADER_SIZE + msg_len);
         asio::mutable_buffers_1 buffer = asio::buffer(&m_response_read_buffer[HEADER_SIZE], msg_len);
-        asio::async_read(
-            m_tcp_socket, 
+        async_read_stream(
             buffer,
             boost::bind(
                 &ClientNetworkManagerImpl::handle_tcp_read_response_body, 
@@ -474,6 +971,8 @@ private:
     // Parse the response and forward it on to the response handler.
     void handle_tcp_response_received()
     {
+        const unsigned long long received_usec= ClientClockOffsetEstimator::get_client_time_usec();
+
         // No longer is there a pending read
         m_has_pending_tcp_read= false;
 
@@ -482,7 +981,12 @@ private:
         {
             ResponsePtr response = m_packed_response.get_msg();
 
-            if (response->request_id() != -1)
+            if (response->request_id() == k_clock_sync_request_id)
+            {
+                // SPECIAL CASE: Clock sync round trips are handled right here, on the thread that received them
+                handle_clock_sync_response(response, received_usec);
+            }
+            else if (response->request_id() != -1)
             {
                 CLIENT_LOG_INFO("ClientNetworkManager::handle_tcp_response_received") 
                     << "Received response type " << response->type() << std::endl;
@@ -519,6 +1023,68 @@ private:
         }
     }
 
+    // Clock sync round trips run on whichever thread services the sockets (the I/O thread if there is one).
+    // Without an I/O thread the response only gets read in poll(), so the round trip still includes the caller's update rate.
+    void begin_clock_sync()
+    {
+        if (m_connection_stopped || m_is_clock_sync_enabled)
+            return;
+
+        m_is_clock_sync_enabled= true;
+        send_clock_sync_request();
+    }
+
+    void stop_clock_sync()
+    {
+        boost::system::error_code cancel_error;
+        m_clock_sync_timer.cancel(cancel_error);
+
+        m_is_clock_sync_enabled= false;
+        m_has_pending_clock_sync= false;
+        m_clock_offset.reset();
+    }
+
+    void send_clock_sync_request()
+    {
+        if (m_connection_stopped || !m_is_clock_sync_enabled || m_has_pending_clock_sync)
+            return;
+
+        // The send time gets stamped once the request is actually written
+        m_has_pending_clock_sync= true;
+        start_request_write(m_clock_sync_request);
+    }
+
+    void handle_clock_sync_response(ResponsePtr response, unsigned long long received_usec)
+    {
+        if (!m_has_pending_clock_sync)
+            return;
+
+        m_has_pending_clock_sync= false;
+
+        if (response->result_code() == PSMoveProtocol::Response_ResultCode_RESULT_OK &&
+            response->has_result_service_time())
+        {
+            m_clock_offset.add_round_trip_sample(
+                m_clock_sync_sent_usec, 
+                response->result_service_time().service_time_usec(), 
+                received_usec);
+        }
+
+        // Measure again in a bit
+        m_clock_sync_timer.expires_from_now(boost::posix_time::milliseconds(k_clock_sync_interval_ms));
+        m_clock_sync_timer.async_wait(
+            boost::bind(&ClientNetworkManagerImpl::handle_clock_sync_timer, this, asio::placeholders::error));
+    }
+
+    void handle_clock_sync_timer(const boost::system::error_code& ec)
+    {
+        // Canceled when the connection stopped
+        if (!ec)
+        {
+            send_clock_sync_request();
+        }
+    }
+
     void start_tcp_write_request()
     {        
         if (m_connection_stopped)
@@ -531,12 +1097,17 @@ private:
             m_packed_request.set_msg(request);
             m_packed_request.pack(m_write_bufer);
 
+            if (request == m_clock_sync_request)
+            {
+                // Time the round trip from when the request actually goes out, not from when it got queued
+                m_clock_sync_sent_usec= ClientClockOffsetEstimator::get_client_time_usec();
+            }
+
             // The queue should prevent us from writing more than one request as once
             m_has_pending_tcp_write= true;
 
             // Start an asynchronous operation to send a heartbeat message.
-            boost::asio::async_write(
-                m_tcp_socket, 
+            async_write_stream(
                 boost::asio::buffer(m_write_bufer),
                 boost::bind(&ClientNetworkManagerImpl::handle_tcp_write_request_complete, this, _1));
         }
@@ -599,9 +1170,8 @@ private:
 
                         // Start an asynchronous operation to send the data frame
                         // NOTE: Even if the write completes immediate, the callback will only be called from io_service::poll()
-                        m_udp_socket.async_send_to(
-                            boost::asio::buffer(m_input_data_frame_buffer, sizeof(m_input_data_frame_buffer)),
-                            m_udp_server_endpoint,
+                        async_send_datagram(
+                            boost::asio::buffer(m_input_data_frame_buffer, HEADER_SIZE + msg_size),
                             boost::bind(&ClientNetworkManagerImpl::handle_udp_write_device_data_frame_complete, this, _1));
                     }
                     else
@@ -629,6 +1199,9 @@ private:
 
             // Remove the dataframe from the pending send queue now that it's sent
             m_pending_data_frames.pop_front();
+
+            // Send the next queued data frame (if any)
+            start_udp_queued_data_frame_write();
         }
         else
         {
@@ -642,30 +1215,41 @@ private:
         if (!m_has_pending_udp_read)
         {
             m_has_pending_udp_read= true;
-            m_udp_socket.async_receive_from(
+            async_receive_datagram(
                 asio::buffer(m_output_data_frame_buffer, sizeof(m_output_data_frame_buffer)),
                 m_udp_server_endpoint,
                 boost::bind(
                     &ClientNetworkManagerImpl::handle_udp_read_data_frame, 
                     this,
-                    asio::placeholders::error));
+                    asio::placeholders::error,
+                    asio::placeholders::bytes_transferred));
         }
     }
 
-    void handle_udp_read_data_frame(const boost::system::error_code& error)
+    void handle_udp_read_data_frame(const boost::system::error_code& error, std::size_t bytes_received)
     {
         if (m_connection_stopped)
             return;
 
+        // No longer is there a pending read
+        m_has_pending_udp_read= false;
+
         if (!error)
         {
             CLIENT_LOG_DEBUG("ClientNetworkManager::handle_udp_read_data_frame") << "Received DataFrame" << std::endl;
 
-            // Process the data frame now that we have received all of it
-            handle_udp_data_frame_received();
+            // Process the data frame now that we have received all of it,
+            // then every other data frame that is already waiting on the socket
+            if (handle_udp_data_frame_received(bytes_received))
+            {
+                drain_udp_data_frames();
+            }
 
             // Start reading the next incoming data frame
-            start_udp_read_data_frame();
+            if (!m_connection_stopped)
+            {
+                start_udp_read_data_frame();
+            }
         }
         else
         {
@@ -680,27 +1264,79 @@ private:
         }
     }
 
-    // Called when enough data was read into m_data_frame_read_buffer for a complete data frame message. 
-    // Parse the data_frame and forward it on to the response handler.
-    void handle_udp_data_frame_received()
+    // Reads and processes the data frames that arrived since the last completed async read
+    // without going back through the io_service for each one.
+    // The server publishes several data frames per device per update, so this saves a 
+    // reactor round trip per frame when the client polls less often than the server publishes.
+    void drain_udp_data_frames()
     {
-        // No longer is there a pending read
-        m_has_pending_udp_read= false;
+        for (int batch_index= 0; batch_index < k_max_data_frame_batch_size; ++batch_index)
+        {
+            boost::system::error_code error;
+            std::size_t bytes_received= receive_available_datagram(
+                asio::buffer(m_output_data_frame_buffer, sizeof(m_output_data_frame_buffer)),
+                error);
+
+            if (error || bytes_received == 0)
+            {
+                // Nothing left to read (or the async read will report the problem)
+                break;
+            }
+
+            if (!handle_udp_data_frame_received(bytes_received))
+            {
+                break;
+            }
+        }
+    }
+
+    // Synchronous receive of a datagram that is already waiting on the socket.
+    // Returns 0 without blocking if there is nothing to read.
+    template <typename t_buffer>
+    std::size_t receive_available_datagram(const t_buffer &buffer, boost::system::error_code &error)
+    {
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+        if (m_is_local_connection)
+        {
+            if (m_local_datagram_socket.available(error) == 0 || error)
+                return 0;
+
+            return m_local_datagram_socket.receive_from(buffer, m_local_remote_endpoint, 0, error);
+        }
+#endif
+        if (m_udp_socket.available(error) == 0 || error)
+            return 0;
 
+        return m_udp_socket.receive_from(buffer, m_udp_server_endpoint, 0, error);
+    }
+
+    // Called when a complete data frame message was received into m_output_data_frame_buffer.
+    // The data_frame is parsed straight out of the receive buffer into a message living on
+    // a preallocated arena, so decoding a data frame doesn't touch the heap.
+    // Returns false if the data frame was malformed (and the connection got stopped).
+    bool handle_udp_data_frame_received(std::size_t bytes_received)
+    {
         CLIENT_LOG_DEBUG("ClientNetworkManager::handle_udp_data_frame_received") << "Parsing DataFrame" << std::endl;
         
         // TODO: Switch on data frame type to choose which m_packed_data_frame_X to use.
-        unsigned msg_len = m_packed_output_data_frame.decode_header(m_output_data_frame_buffer, sizeof(m_output_data_frame_buffer));
+        const PackedMessage<PSMoveProtocol::DeviceOutputDataFrame> packed_header;
+        unsigned msg_len = packed_header.decode_header(m_output_data_frame_buffer, static_cast<unsigned>(bytes_received));
         unsigned total_len= HEADER_SIZE+msg_len;
         CLIENT_LOG_DEBUG("    ") << show_hex(m_output_data_frame_buffer, total_len) << std::endl;
         CLIENT_LOG_DEBUG("    ") << msg_len << " bytes" << std::endl;
 
+        // Recycle the message (and any sub-messages) from the previous data frame
+        m_output_data_frame_arena.Reset();
+        PSMoveProtocol::DeviceOutputDataFrame *data_frame= 
+            google::protobuf::Arena::CreateMessage<PSMoveProtocol::DeviceOutputDataFrame>(&m_output_data_frame_arena);
+
         // Parse the response buffer
-        if (m_packed_output_data_frame.unpack(m_output_data_frame_buffer, total_len))
+        if (bytes_received >= HEADER_SIZE && total_len <= bytes_received &&
+            data_frame->ParseFromArray(&m_output_data_frame_buffer[HEADER_SIZE], msg_len))
         {
-            const PSMoveProtocol::DeviceOutputDataFrame *data_frame = m_packed_output_data_frame.get_msg().get();
-
             m_data_frame_listener->handle_data_frame(data_frame);
+
+            return true;
         }
         else
         {
@@ -712,9 +1348,20 @@ private:
                 //###HipsterSloth $TODO pick a better error code that means "malformed data"
                 m_netEventListener->handle_server_connection_socket_error(boost::asio::error::message_size);
             }
+
+            return false;
         }
     }
 
+    static google::protobuf::ArenaOptions make_arena_options(std::vector<char> &block)
+    {
+        google::protobuf::ArenaOptions options;
+
+        options.initial_block= block.data();
+        options.initial_block_size= block.size();
+
+        return options;
+    }
 private:
     std::string m_server_host;
     std::string m_server_port;
@@ -728,6 +1375,19 @@ private:
     udp::endpoint m_udp_remote_endpoint;
     bool m_udp_connection_result_read_buffer;
 
+    // Local (unix domain socket) connection used instead of tcp/udp when the server is on this host
+    bool m_is_local_connection;
+    // Cleared to always connect over tcp/udp, e.g. to measure the network path on the service's host
+    bool m_use_local_sockets;
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    local_stream::socket m_local_stream_socket;
+    local_datagram::socket m_local_datagram_socket;
+    local_datagram::endpoint m_local_server_endpoint;
+    local_datagram::endpoint m_local_remote_endpoint;
+    std::string m_local_client_socket_dir;
+    std::string m_local_client_socket_path;
+#endif
+
     bool m_connection_stopped;
     bool m_has_pending_tcp_read;
     bool m_has_pending_tcp_write;
@@ -738,7 +1398,11 @@ private:
     PackedMessage<PSMoveProtocol::Response> m_packed_response;
 
     uint8_t m_output_data_frame_buffer[HEADER_SIZE+MAX_OUTPUT_DATA_FRAME_MESSAGE_SIZE];
-    PackedMessage<PSMoveProtocol::DeviceOutputDataFrame> m_packed_output_data_frame;
+
+    // Incoming data frames are decoded onto this arena, which gets reset for every data frame.
+    // The initial block must be declared before the arena so that it outlives it.
+    std::vector<char> m_output_data_frame_arena_block;
+    google::protobuf::Arena m_output_data_frame_arena;
 
     uint8_t m_input_data_frame_buffer[HEADER_SIZE + MAX_INPUT_DATA_FRAME_MESSAGE_SIZE];
     PackedMessage<PSMoveProtocol::DeviceInputDataFrame> m_packed_input_data_frame;
@@ -753,11 +1417,24 @@ private:
 
     deque<RequestPtr> m_pending_requests;
     deque<DeviceInputDataFramePtr> m_pending_data_frames;
+
+    // Optional I/O thread that runs m_io_service instead of poll()
+    ClientDeferredEventQueue m_deferred_events;
+    bool m_use_io_thread;
+    std::thread m_io_thread;
+    std::unique_ptr<asio::io_service::work> m_io_work;
+
+    // Clock sync state, only touched by the thread servicing the sockets (readers only see the estimator)
+    ClientClockOffsetEstimator m_clock_offset;
+    RequestPtr m_clock_sync_request;
+    asio::deadline_timer m_clock_sync_timer;
+    unsigned long long m_clock_sync_sent_usec;
+    bool m_is_clock_sync_enabled;
+    bool m_has_pending_clock_sync;
 };
 
 // -ClientNetworkManager-
 // Public interface to the psmove client network API
-ClientNetworkManager *ClientNetworkManager::m_instance = NULL;
 
 ClientNetworkManager::ClientNetworkManager(
     const std::string &host, 
@@ -779,15 +1456,12 @@ ClientNetworkManager::ClientNetworkManager(
 
 ClientNetworkManager::~ClientNetworkManager()
 {
-    assert(m_instance == NULL);
     delete m_implementation_ptr;
 }
 
-bool ClientNetworkManager::startup()
+bool ClientNetworkManager::startup(bool use_io_thread, bool use_local_sockets)
 {
-    m_instance= this;
-
-    return m_implementation_ptr->start();
+    return m_implementation_ptr->start(use_io_thread, use_local_sockets);
 }
 
 void ClientNetworkManager::send_request(RequestPtr request)
@@ -800,6 +1474,16 @@ void ClientNetworkManager::send_device_data_frame(DeviceInputDataFramePtr data_f
     m_implementation_ptr->send_device_data_frame(data_frame);
 }
 
+void ClientNetworkManager::start_clock_sync()
+{
+    m_implementation_ptr->start_clock_sync();
+}
+
+const ClientClockOffsetEstimator &ClientNetworkManager::get_clock_offset() const
+{
+    return m_implementation_ptr->get_clock_offset();
+}
+
 void ClientNetworkManager::update()
 {
     m_implementation_ptr->poll();
@@ -807,6 +1491,5 @@ void ClientNetworkManager::update()
 
 void ClientNetworkManager::shutdown()
 {
-    m_implementation_ptr->stop();
-    m_instance = NULL;
+    m_implementation_ptr->shutdown();
 }
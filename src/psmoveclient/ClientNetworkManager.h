@@ -4,12 +4,19 @@
 //-- includes ----
 #include "PSMoveClient_export.h"
 #include "PSMoveProtocolInterface.h"
+#include "ClientClockOffset.h"
 #include "ClientNetworkInterface.h"
 
 //-- definitions ------
 // -Server Network Manager-
 // Maintains TCP/UDP connection state with PSMoveService.
 // Routes requests to the given request handler.
+// If started with an I/O thread, data frames are handed to the data frame listener on that thread
+// while responses, notifications and connection events are still delivered from update().
+// Connections to this host use the service's local sockets (where available) unless told not to.
+// Every client owns its own manager, so a process can hold several connections to the service.
+// Once started, clock sync round trips (GET_SERVICE_TIME) are sent, timestamped and answered 
+// on the thread servicing the sockets, so the caller's update rate doesn't inflate their round trip.
 class PSM_CPP_PRIVATE_CLASS ClientNetworkManager 
 {
 public:
@@ -21,11 +28,14 @@ public:
         IClientNetworkEventListener *netEventListener);
     virtual ~ClientNetworkManager();
 
-    static ClientNetworkManager *get_instance() { return m_instance; }
-
-    bool startup();
+    bool startup(bool use_io_thread= false, bool use_local_sockets= true);
     void send_request(RequestPtr request);
     void send_device_data_frame(DeviceInputDataFramePtr data_frame);
+    // Starts measuring the clock offset to the service (only call once it's known to answer GET_SERVICE_TIME).
+    // Stops again when the connection closes.
+    void start_clock_sync();
+    // Client time - service time, readable from any thread
+    const ClientClockOffsetEstimator &get_clock_offset() const;
     void update();
     void shutdown();
 
@@ -35,10 +45,6 @@ private:
 
     // private implementation - same lifetime as the ClientNetworkManager
     class ClientNetworkManagerImpl *m_implementation_ptr;
-
-    // Singleton instance of the class
-    // Assigned in startup, cleared in teardown
-    static ClientNetworkManager *m_instance;
 };
 
 #endif  // CLIENT_NETWORK_MANAGER_H
@@ -1,12 +1,19 @@
 //-- includes -----
 #include "ClientRequestManager.h"
 #include "ClientNetworkManager.h"
+#include "ClientMessageQueue.h"
 #include "PSMoveProtocolInterface.h"
 #include "PSMoveProtocol.pb.h"
 #include <cassert>
 #include <map>
 #include <utility>
 
+//-- constants -----
+// Max number of responses whose protocol data stays accessible between two updates
+static const size_t k_response_pool_capacity = 32;
+// Size of the preallocated arena block the pooled response copies live on
+static const size_t k_response_pool_arena_block_size = 16384;
+
 //-- definitions -----
 struct RequestContext
 {
@@ -15,7 +22,7 @@ struct RequestContext
 typedef std::map<int, RequestContext> t_request_context_map;
 typedef std::map<int, RequestContext>::iterator t_request_context_map_iterator;
 typedef std::pair<int, RequestContext> t_id_request_context_pair;
-typedef std::vector<ResponsePtr> t_response_reference_cache;
+typedef ClientMessagePool<PSMoveProtocol::Response> t_response_pool;
 typedef std::vector<RequestPtr> t_request_reference_cache;
 
 class ClientRequestManagerImpl
@@ -26,20 +33,37 @@ public:
         PSMResponseCallback callback,
         void *userdata)
         : m_dataFrameListener(dataFrameListener)
+        , m_network_manager(nullptr)
         , m_callback(callback)
         , m_callback_userdata(userdata)
         , m_pending_requests()
         , m_next_request_id(0)
+        , m_request_reference_cache()
+        , m_response_pool(k_response_pool_capacity, k_response_pool_arena_block_size)
     {
+        m_request_reference_cache.reserve(k_response_pool_capacity);
     }
 
     void flush_response_cache()
     {
-        // Drop all of the request/response references,
+        // Drop all of the request references,
         // NOTE: std::vector::clear() calls the destructor on each element in the vector
         // This will decrement the last ref count to the parameter data, causing them to get cleaned up.
+        // The vector keeps its capacity, so refilling it doesn't allocate.
         m_request_reference_cache.clear();
-        m_response_reference_cache.clear();
+
+        // Hand the pooled response copies back (the arena keeps its initial block for the next update)
+        m_response_pool.reset();
+    }
+
+    unsigned long long get_response_overflow_count() const
+    {
+        return m_response_pool.getOverflowCount();
+    }
+
+    void set_network_manager(ClientNetworkManager *network_manager)
+    {
+        m_network_manager= network_manager;
     }
 
     void send_request(RequestPtr request)
@@ -57,7 +81,8 @@ public:
         m_pending_requests.insert(t_id_request_context_pair(request->request_id(), context));
 
         // Send the request off to the network manager to get sent to the server
-        ClientNetworkManager::get_instance()->send_request(request);
+        assert(m_network_manager != nullptr);
+        m_network_manager->send_request(request);
     }
 
     void handle_request_canceled(RequestPtr request)
@@ -132,20 +157,19 @@ public:
         m_request_reference_cache.push_back(request);
 
         {
-            // Create a smart pointer to a new copy of the response.
-            // If we just add the given event smart pointer to the reference cache
-            // we'll be storing a reference to the shared m_packed_response on the client network manager
+            // Copy the response into the response pool.
+            // If we just kept a reference to the given response
+            // we'd be storing a reference to the shared m_packed_response on the client network manager
             // which gets constantly overwritten with new incoming responses.
-            ResponsePtr responseCopy(new PSMoveProtocol::Response(*response.get()));
+            // If more responses arrived this update than the pool expects, the copy spills onto the heap (counted as an overflow).
+            const PSMoveProtocol::Response *responseCopy= m_response_pool.store(*response.get());
 
             // Attach an opaque pointer to the PSMoveProtocol response.
             // Client code that has linked against PSMoveProtocol library
             // can access this pointer via the GET_PSMOVEPROTOCOL_RESPONSE() macro.
-            out_response_message->opaque_response_handle = static_cast<const void*>(responseCopy.get());
-
             // The opaque response pointer will only remain valid until the next call to update()
-            // at which time the response reference cache gets cleared out.
-            m_response_reference_cache.push_back(responseCopy);
+            // at which time the response pool gets reset.
+            out_response_message->opaque_response_handle = static_cast<const void*>(responseCopy);
         }
 
         // Write response specific data
@@ -291,6 +315,9 @@ public:
             case PSMoveProtocol::TrackerType::PS3EYE:
                 TrackerInfo.tracker_type = PSMTracker_PS3Eye;
                 break;
+            case PSMoveProtocol::TrackerType::VIRTUAL_TRACKER:
+                TrackerInfo.tracker_type = PSMTracker_Virtual;
+                break;
             default:
                 assert(0 && "unreachable");
             }
@@ -309,6 +336,9 @@ public:
             case PSMoveProtocol::TrackerDriver::GENERIC_WEBCAM:
                 TrackerInfo.tracker_driver = PSMDriver_GENERIC_WEBCAM;
                 break;
+            case PSMoveProtocol::TrackerDriver::VIRTUAL:
+                TrackerInfo.tracker_driver = PSMDriver_VIRTUAL;
+                break;
             default:
                 assert(0 && "unreachable");
             }
@@ -395,16 +425,16 @@ public:
 
 private:
     IDataFrameListener *m_dataFrameListener;
+    ClientNetworkManager *m_network_manager;
     PSMResponseCallback m_callback;
     void *m_callback_userdata;
     t_request_context_map m_pending_requests;
     int m_next_request_id;
 
-    // These vectors is used solely to keep the ref counted pointers to the 
-    // request/response parameter data valid until the next update call.
+    // These are used solely to keep the request/response parameter data valid until the next update call.
     // The ClientAPI message queue contains raw void pointers to the request/response and event data.
     t_request_reference_cache m_request_reference_cache;
-    t_response_reference_cache m_response_reference_cache;
+    t_response_pool m_response_pool;
 };
 
 //-- public methods -----
@@ -426,6 +456,17 @@ void ClientRequestManager::flush_response_cache()
     m_implementation_ptr->flush_response_cache();
 }
 
+unsigned long long ClientRequestManager::get_response_overflow_count() const
+{
+    return m_implementation_ptr->get_response_overflow_count();
+}
+
+void ClientRequestManager::set_network_manager(
+    ClientNetworkManager *network_manager)
+{
+    m_implementation_ptr->set_network_manager(network_manager);
+}
+
 void ClientRequestManager::send_request(
     RequestPtr request)
 {
@@ -14,6 +14,8 @@ public:
                          void *userdata);
     virtual ~ClientRequestManager();
 
+    // Requests are sent through the network manager of the client that owns this request manager
+    void set_network_manager(class ClientNetworkManager *network_manager);
     void send_request(RequestPtr request);
 
     virtual void handle_request_canceled(RequestPtr request) override;
@@ -21,6 +23,9 @@ public:
 
     void flush_response_cache();
 
+    // Number of response copies that spilled onto the heap because the response pool was full
+    unsigned long long get_response_overflow_count() const;
+
 private:
     // private implementation - same lifetime as the ClientRequestManager
     class ClientRequestManagerImpl *m_implementation_ptr;
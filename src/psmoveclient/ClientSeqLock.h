@@ -0,0 +1,90 @@
+#ifndef CLIENT_SEQ_LOCK_H
+#define CLIENT_SEQ_LOCK_H
+
+//-- includes -----
+#include <atomic>
+#include <cstring>
+#include <type_traits>
+
+//-- definitions -----
+/// Single writer, multiple reader sequence lock around a plain-old-data value.
+/// The writer never blocks. Readers retry if the value changed while they were copying it.
+/// The value is stored as relaxed atomic words so a torn read is detected rather than undefined.
+template <typename t_value>
+class ClientSeqLock
+{
+public:
+    static_assert(std::is_trivially_copyable<t_value>::value, "ClientSeqLock value must be trivially copyable");
+
+    ClientSeqLock()
+        : m_sequence(0)
+    {
+        for (size_t word_index = 0; word_index < k_word_count; ++word_index)
+        {
+            m_words[word_index].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    /// Writer thread only
+    void write(const t_value &value)
+    {
+        unsigned int words[k_word_count];
+        words[k_word_count - 1] = 0;
+        std::memcpy(words, &value, sizeof(t_value));
+
+        const unsigned int sequence = m_sequence.load(std::memory_order_relaxed);
+
+        // Odd while the value is being written
+        m_sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for (size_t word_index = 0; word_index < k_word_count; ++word_index)
+        {
+            m_words[word_index].store(words[word_index], std::memory_order_relaxed);
+        }
+
+        m_sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    /// Any thread. Returns false if nothing has been written yet.
+    bool read(t_value &out_value) const
+    {
+        unsigned int words[k_word_count];
+        unsigned int sequence_before;
+
+        for (;;)
+        {
+            sequence_before = m_sequence.load(std::memory_order_acquire);
+
+            if ((sequence_before & 1) != 0)
+            {
+                // Writer is mid update, it won't be long
+                continue;
+            }
+
+            for (size_t word_index = 0; word_index < k_word_count; ++word_index)
+            {
+                words[word_index] = m_words[word_index].load(std::memory_order_relaxed);
+            }
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if (m_sequence.load(std::memory_order_relaxed) == sequence_before)
+            {
+                break;
+            }
+        }
+
+        std::memcpy(&out_value, words, sizeof(t_value));
+
+        return sequence_before != 0;
+    }
+
+private:
+    static const size_t k_word_count = (sizeof(t_value) + sizeof(unsigned int) - 1) / sizeof(unsigned int);
+
+    std::atomic<unsigned int> m_sequence;
+    std::atomic<unsigned int> m_words[k_word_count];
+};
+
+#endif // CLIENT_SEQ_LOCK_H
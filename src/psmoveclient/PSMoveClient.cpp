@@ -3,12 +3,15 @@
 #include "ClientRequestManager.h"
 #include "ClientNetworkManager.h"
 #include "ClientLog.h"
+#include "MathUtility.h"
 #include "PSMoveProtocol.pb.h"
 #include "SharedTrackerState.h"
 #include <boost/interprocess/shared_memory_object.hpp>
 #include <boost/interprocess/mapped_region.hpp>
-#include <boost/interprocess/sync/scoped_lock.hpp>
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
 #include <iostream>
 #include <thread>
 #include <memory>
@@ -17,9 +20,18 @@
 	#pragma warning(disable:4996)  // ignore strncpy warning
 #endif
 
-//-- typedefs -----
-typedef std::deque<PSMMessage> t_message_queue;
-typedef std::vector<ResponsePtr> t_event_reference_cache;
+//-- constants -----
+// Max number of messages queued up between two updates
+static const size_t k_message_queue_capacity = 128;
+
+// Max number of events whose protocol data stays accessible between two updates
+static const size_t k_event_pool_capacity = 32;
+// Size of the preallocated arena block the pooled event copies live on
+static const size_t k_event_pool_arena_block_size = 8192;
+
+// Oldest service protocol version that answers GET_SERVICE_TIME ("0.9-alpha 8.7.1"), 
+// older services don't know the request
+static const int k_clock_sync_min_protocol_version[] = {0, 9, 8, 7, 1};
 
 // -- macros -----
 #define IS_VALID_CONTROLLER_INDEX(x) ((x) >= 0 && (x) < PSMOVESERVICE_MAX_CONTROLLER_COUNT)
@@ -40,6 +52,11 @@ static void applyTrackerDataFrame(const PSMoveProtocol::DeviceOutputDataFrame_Tr
 static void applyHmdDataFrame(const PSMoveProtocol::DeviceOutputDataFrame_HMDDataPacket& hmd_packet, PSMHeadMountedDisplay *hmd);
 static void applyMorpheusDataFrame(const PSMoveProtocol::DeviceOutputDataFrame_HMDDataPacket& hmd_packet, PSMMorpheus *morpheus);
 static void applyVirtualHMDDataFrame(const PSMoveProtocol::DeviceOutputDataFrame_HMDDataPacket& hmd_packet, PSMVirtualHMD *virtualHMD);
+static bool buildControllerPoseSnapshot(const PSMController *controller, unsigned long long server_timestamp_usec, PSMPoseSnapshot *out_snapshot);
+static bool buildHmdPoseSnapshot(const PSMHeadMountedDisplay *hmd, unsigned long long server_timestamp_usec, PSMPoseSnapshot *out_snapshot);
+static int getPendingDataFrameIndex(const PSMoveProtocol::DeviceOutputDataFrame *data_frame);
+static int getPendingDataFrameIndex(PSMDeviceCategory device_category, int device_id);
+static void addLatencySample(PSMLatencyHistogram *histogram, long long latency_usec);
 
 // -- private definitions -----
 class SharedVideoFrameReadOnlyAccessor
@@ -53,6 +70,9 @@ public:
         , m_frame_height(0)
         , m_frame_stride(0)
         , m_last_frame_index(0)
+        , m_leased_slot_index(-1)
+        , m_leased_slot_epoch(0)
+        , m_last_leased_frame_index(0)
     {}
 
     ~SharedVideoFrameReadOnlyAccessor()
@@ -72,6 +92,14 @@ public:
             strncpy(m_shared_memory_name, shared_memory_name, sizeof(m_shared_memory_name)-1);
             m_shared_memory_name[sizeof(m_shared_memory_name) - 1] = '\0';
 
+            // A service with another video frame layout names its shared memory differently
+            if (strncmp(shared_memory_name, SHARED_VIDEO_FRAME_NAME_PREFIX, strlen(SHARED_VIDEO_FRAME_NAME_PREFIX)) != 0)
+            {
+                CLIENT_LOG_ERROR("SharedMemory::initialize()") << "Incompatible shared memory: " << m_shared_memory_name
+                    << ", expected video frame version " << SHARED_VIDEO_FRAME_VERSION;
+                return false;
+            }
+
             // Create the shared memory object
             m_shared_memory_object =
                 new boost::interprocess::shared_memory_object(
@@ -82,7 +110,19 @@ public:
             // Map all of the shared memory for read/write access
             m_region = new boost::interprocess::mapped_region(*m_shared_memory_object, boost::interprocess::read_write);
 
-            bSuccess = true;
+            // Refuse to read shared memory laid out by a different version of the service
+            const SharedVideoFrameHeader *sharedFrameState = getFrameHeader();
+            if (sharedFrameState->isCompatible(m_region->get_size()))
+            {
+                bSuccess = true;
+            }
+            else
+            {
+                CLIENT_LOG_ERROR("SharedMemory::initialize()") << "Incompatible shared memory: " << m_shared_memory_name
+                    << ", expected video frame version " << SHARED_VIDEO_FRAME_VERSION
+                    << " but found " << sharedFrameState->version;
+                dispose();
+            }
         }
         catch (boost::interprocess::interprocess_exception &ex)
         {
@@ -102,6 +142,9 @@ public:
 
     void dispose()
     {
+        // Give back any leased slot before the shared memory is unmapped
+        releaseVideoFrame();
+
         if (m_region != nullptr)
         {
             delete m_region;
@@ -124,8 +167,7 @@ public:
     bool readVideoFrame()
     {
         bool bNewFrame = false;
-        SharedVideoFrameHeader *sharedFrameState = getFrameHeader();
-        boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex> lock(sharedFrameState->mutex);
+        const SharedVideoFrameHeader *sharedFrameState = getFrameHeader();
 
         // Make sure the target buffer is big enough to read the video frame into
         size_t buffer_size =
@@ -150,20 +192,81 @@ public:
             allocateVideoBuffer();
         }
 
-        // Copy over the video frame if the frame index changed
-        if (m_last_frame_index != sharedFrameState->frame_index)
+        // Copy over the most recently published video frame if the frame index changed.
+        // This never waits on the service; a frame overwritten mid-copy is retried or skipped.
+        if (buffer_size > 0)
         {
-            if (buffer_size > 0)
+            int frame_index= m_last_frame_index;
+
+            if (sharedFrameState->readVideoFrame(m_bgr_frame_buffer, m_last_frame_index, frame_index))
             {
-                std::memcpy(m_bgr_frame_buffer, sharedFrameState->getBufferMutable(), buffer_size);
+                m_last_frame_index = frame_index;
+
+                bNewFrame = true;
             }
+        }
 
-            m_last_frame_index = sharedFrameState->frame_index;
+        return bNewFrame;
+    }
 
-            bNewFrame = true;
+    // Pin the newest video frame in shared memory and point out_frame straight at it.
+    // The frame stays valid until releaseVideoFrame(). Only one frame can be leased at a time.
+    PSMResult acquireVideoFrame(PSMTrackerVideoFrame *out_frame)
+    {
+        if (m_leased_slot_index != -1)
+        {
+            CLIENT_LOG_ERROR("SharedMemory::acquireVideoFrame()") << "Previous video frame wasn't released: " << m_shared_memory_name;
+            return PSMResult_Error;
         }
 
-        return bNewFrame;
+        SharedVideoFrameHeader *sharedFrameState = getFrameHeader();
+        const int slot_index = sharedFrameState->leaseVideoFrame(m_last_leased_frame_index, m_leased_slot_epoch);
+
+        if (slot_index == -1)
+        {
+            return PSMResult_NoData;
+        }
+
+        const SharedVideoFrameSlot &slot = sharedFrameState->slots[slot_index];
+
+        m_leased_slot_index = slot_index;
+        m_last_leased_frame_index = slot.frame_index.load(std::memory_order_relaxed);
+
+        out_frame->buffer = sharedFrameState->getSlotBuffer(slot_index);
+        out_frame->width = sharedFrameState->width;
+        out_frame->height = sharedFrameState->height;
+        out_frame->stride = sharedFrameState->stride;
+        out_frame->frame_index = m_last_leased_frame_index;
+        out_frame->capture_timestamp_usec = slot.capture_timestamp_usec.load(std::memory_order_relaxed);
+
+        return PSMResult_Success;
+    }
+
+    // Block until the service publishes a frame newer than the last one read or leased
+    bool waitForVideoFrame(int timeout_ms)
+    {
+        const int last_read_frame_index = std::max(m_last_frame_index, m_last_leased_frame_index);
+
+        return getFrameHeader()->waitForVideoFrame(last_read_frame_index, timeout_ms);
+    }
+
+    // Returns false if nothing was leased, or the lease expired and the frame may have been overwritten
+    bool releaseVideoFrame()
+    {
+        bool bReleased = false;
+
+        if (m_leased_slot_index != -1 && m_region != nullptr)
+        {
+            bReleased = getFrameHeader()->releaseVideoFrame(m_leased_slot_index, m_leased_slot_epoch);
+            if (!bReleased)
+            {
+                CLIENT_LOG_WARNING("SharedMemory::releaseVideoFrame()") << "Video frame lease expired before it was released: " << m_shared_memory_name;
+            }
+        }
+
+        m_leased_slot_index = -1;
+
+        return bReleased;
     }
 
     void allocateVideoBuffer()
@@ -206,6 +309,9 @@ private:
     unsigned char *m_bgr_frame_buffer;
     int m_frame_width, m_frame_height, m_frame_stride;
     int m_last_frame_index;
+    int m_leased_slot_index;
+    boost::uint32_t m_leased_slot_epoch;
+    int m_last_leased_frame_index;
 };
 
 // -- methods -----
@@ -214,11 +320,15 @@ PSMoveClient::PSMoveClient(
     const std::string &port)
     : m_request_manager(nullptr)  // ClientPSMoveAPIImpl::handle_response_message userdata
     , m_network_manager(nullptr) // IClientNetworkEventListener
+	, m_bUseIOThread(false)
+	, m_clock_sync_version_request_id(PSM_INVALID_REQUEST_ID)
 	, m_bIsConnected(false)
 	, m_bHasConnectionStatusChanged(false)
 	, m_bHasControllerListChanged(false)
 	, m_bHasTrackerListChanged(false)
 	, m_bHasHMDListChanged(false)
+	, m_message_queue(k_message_queue_capacity)
+	, m_event_pool(k_event_pool_capacity, k_event_pool_arena_block_size)
 {
 	m_request_manager=
 		new ClientRequestManager(
@@ -232,6 +342,7 @@ PSMoveClient::PSMoveClient(
 			this, // INotificationListener
 			m_request_manager, // IResponseListener
 			this); // IClientNetworkEventListener
+	m_request_manager->set_network_manager(m_network_manager);
 }
 
 PSMoveClient::~PSMoveClient()
@@ -287,7 +398,7 @@ bool PSMoveClient::pollWasSystemButtonPressed()
 }
 
 // -- ClientPSMoveAPI System -----
-bool PSMoveClient::startup(e_log_severity_level log_level)
+bool PSMoveClient::startup(e_log_severity_level log_level, bool use_io_thread, bool use_local_sockets)
 {
     bool success = true;
 
@@ -301,10 +412,47 @@ bool PSMoveClient::startup(e_log_severity_level log_level)
 	m_bHasHMDListChanged= false;
 	m_bWasSystemButtonPressed = false;
 
+	// Reset the device views before the network manager (and possibly its I/O thread) starts
+	memset(&m_controllers, 0, sizeof(PSMController)*PSMOVESERVICE_MAX_CONTROLLER_COUNT);
+	for (PSMControllerID controller_id= 0; controller_id < PSMOVESERVICE_MAX_CONTROLLER_COUNT; ++controller_id)    
+	{
+		m_controllers[controller_id].ControllerID= controller_id;
+		m_controllers[controller_id].ControllerType= PSMController_None;
+	}
+	memcpy(m_snapshot_controller_views, m_controllers, sizeof(PSMController)*PSMOVESERVICE_MAX_CONTROLLER_COUNT);
+
+	memset(m_trackers, 0, sizeof(PSMTracker)*PSMOVESERVICE_MAX_TRACKER_COUNT);
+	for (PSMTrackerID tracker_id= 0; tracker_id < PSMOVESERVICE_MAX_TRACKER_COUNT; ++tracker_id)    
+	{
+		m_trackers[tracker_id].tracker_info.tracker_id= tracker_id;
+		m_trackers[tracker_id].tracker_info.tracker_type= PSMTracker_None;
+	}
+
+	memset(m_HMDs, 0, sizeof(PSMHeadMountedDisplay)*PSMOVESERVICE_MAX_HMD_COUNT);
+	for (PSMHmdID hmd_id= 0; hmd_id < PSMOVESERVICE_MAX_HMD_COUNT; ++hmd_id)    
+	{
+		m_HMDs[hmd_id].HmdID= hmd_id;
+		m_HMDs[hmd_id].HmdType= PSMHmd_None;
+	}
+	memcpy(m_snapshot_hmd_views, m_HMDs, sizeof(PSMHeadMountedDisplay)*PSMOVESERVICE_MAX_HMD_COUNT);
+
+	for (int frame_index= 0; frame_index < k_pending_data_frame_count; ++frame_index)
+	{
+		m_pending_data_frames[frame_index].received_buffer_index= 0;
+		m_pending_data_frames[frame_index].bHasReceivedFrame= false;
+	}
+
+	m_bUseIOThread= use_io_thread;
+
+	// The service may have been restarted, so start over with the clock offset
+	reset_clock_sync();
+	reset_latency_stats();
+	memset(m_last_latency_timestamps, 0, sizeof(m_last_latency_timestamps));
+
     // Attempt to connect to the server
     if (success)
     {
-        if (!m_network_manager->startup())
+        if (!m_network_manager->startup(use_io_thread, use_local_sockets))
         {
             CLIENT_LOG_ERROR("ClientPSMoveAPI") << "Failed to initialize the client network manager" << std::endl;
             success = false;
@@ -313,28 +461,8 @@ bool PSMoveClient::startup(e_log_severity_level log_level)
 
 	if (success)
 	{
-        CLIENT_LOG_INFO("ClientPSMoveAPI") << "Successfully initialized ClientPSMoveAPI" << std::endl;
-
-		memset(&m_controllers, 0, sizeof(PSMController)*PSMOVESERVICE_MAX_CONTROLLER_COUNT);
-		for (PSMControllerID controller_id= 0; controller_id < PSMOVESERVICE_MAX_CONTROLLER_COUNT; ++controller_id)    
-		{
-			m_controllers[controller_id].ControllerID= controller_id;
-			m_controllers[controller_id].ControllerType= PSMController_None;
-		}
-
-		memset(m_trackers, 0, sizeof(PSMTracker)*PSMOVESERVICE_MAX_TRACKER_COUNT);
-		for (PSMTrackerID tracker_id= 0; tracker_id < PSMOVESERVICE_MAX_TRACKER_COUNT; ++tracker_id)    
-		{
-			m_trackers[tracker_id].tracker_info.tracker_id= tracker_id;
-			m_trackers[tracker_id].tracker_info.tracker_type= PSMTracker_None;
-		}
-
-		memset(m_HMDs, 0, sizeof(PSMHeadMountedDisplay)*PSMOVESERVICE_MAX_HMD_COUNT);
-		for (PSMHmdID hmd_id= 0; hmd_id < PSMOVESERVICE_MAX_HMD_COUNT; ++hmd_id)    
-		{
-			m_HMDs[hmd_id].HmdID= hmd_id;
-			m_HMDs[hmd_id].HmdType= PSMHmd_None;
-		}
+        CLIENT_LOG_INFO("ClientPSMoveAPI") << "Successfully initialized ClientPSMoveAPI" 
+			<< (use_io_thread ? " (network I/O thread)" : "") << std::endl;
 	}
 
     return success;
@@ -350,16 +478,21 @@ void PSMoveClient::update()
     m_message_queue.clear();
 
     // Drop all of the message parameters
-    // NOTE: std::vector::clear() calls the destructor on each element in the vector
-    // This will decrement the last ref count to the parameter data, causing them to get cleaned up.
+    // NOTE: The pooled copies keep their storage, so the next batch of messages doesn't allocate
     m_request_manager->flush_response_cache();
-    m_event_reference_cache.clear();
+    m_event_pool.reset();
 
     // Publish modified device state back to the service
     publish();
 
     // Process incoming/outgoing networking requests
     m_network_manager->update();
+
+	// Catch the device views up with the data frames the I/O thread received since the last update
+	if (m_bUseIOThread)
+	{
+		apply_pending_data_frames();
+	}
 }
 
 void PSMoveClient::process_messages()
@@ -591,18 +724,13 @@ bool PSMoveClient::poll_next_message(PSMMessage *message, size_t message_size)
 {
     bool bHasMessage = false;
 
-    if (m_message_queue.size() > 0)
-    {
-        const PSMMessage &first = m_message_queue.front();
-
-        assert(sizeof(PSMMessage) == message_size);
-        assert(message != nullptr);
-        memcpy(message, &first, sizeof(PSMMessage));
-
-        m_message_queue.pop_front();
+    assert(sizeof(PSMMessage) == message_size);
+    assert(message != nullptr);
 
+    if (m_message_queue.pop(*message))
+    {
         // NOTE: We intentionally keep the message parameters around in the 
-        // m_response_reference_cache and m_event_reference_cache since the
+        // response pool and m_event_pool since the
         // messages contain raw void pointers to the parameters, which
         // become invalid after the next call to update.
 
@@ -612,19 +740,72 @@ bool PSMoveClient::poll_next_message(PSMMessage *message, size_t message_size)
     return bHasMessage;
 }
 
+void PSMoveClient::get_message_queue_stats(PSMMessageQueueStats *out_stats) const
+{
+    out_stats->MessageOverflowCount= m_message_queue.getOverflowCount();
+    out_stats->EventOverflowCount= m_event_pool.getOverflowCount();
+    out_stats->ResponseOverflowCount= m_request_manager->get_response_overflow_count();
+}
+
+bool PSMoveClient::get_latency_stats(
+	PSMDeviceCategory device_category, 
+	int device_id, 
+	PSMLatencyStats *out_stats) const
+{
+	const int frame_index= getPendingDataFrameIndex(device_category, device_id);
+
+	if (frame_index != -1)
+	{
+		*out_stats= m_latency_stats[frame_index];
+		const ClientClockOffsetEstimator &clock_offset= m_network_manager->get_clock_offset();
+
+		out_stats->ClockOffsetUsec= clock_offset.get_offset_usec();
+		out_stats->ClockSyncRoundTripUsec= clock_offset.get_round_trip_usec();
+
+		return true;
+	}
+
+	return false;
+}
+
+bool PSMoveClient::get_latency_timestamps(
+	PSMDeviceCategory device_category, 
+	int device_id, 
+	PSMLatencyTimestamps *out_timestamps) const
+{
+	const int frame_index= getPendingDataFrameIndex(device_category, device_id);
+
+	if (frame_index != -1)
+	{
+		*out_timestamps= m_last_latency_timestamps[frame_index];
+
+		return true;
+	}
+
+	return false;
+}
+
+void PSMoveClient::reset_latency_stats()
+{
+	memset(m_latency_stats, 0, sizeof(m_latency_stats));
+}
+
 void PSMoveClient::shutdown()
 {
-    // Close all active network connections
+    // Close all active network connections (and stop the I/O thread, if any)
     m_network_manager->shutdown();
 
+	for (int frame_index= 0; frame_index < k_pending_data_frame_count; ++frame_index)
+	{
+		m_pending_data_frames[frame_index].bHasReceivedFrame= false;
+	}
+
     // Drop an unread messages from the previous call to update
     m_message_queue.clear();
 
     // Drop all of the message parameters
-    // NOTE: std::vector::clear() calls the destructor on each element in the vector
-    // This will decrement the last ref count to the parameter data, causing them to get cleaned up.
     m_request_manager->flush_response_cache();
-    m_event_reference_cache.clear();
+    m_event_pool.reset();
 
     // No more pending requests
     m_pending_request_map.clear();
@@ -644,6 +825,44 @@ PSMRequestID PSMoveClient::get_service_version()
     return request->request_id();
 }
 
+PSMRequestID PSMoveClient::get_service_performance_stats(bool reset_stats)
+{
+    CLIENT_LOG_INFO("get_service_performance_stats") << "requesting service performance stats" << std::endl;
+
+    RequestPtr request(new PSMoveProtocol::Request());
+    request->set_type(PSMoveProtocol::Request_RequestType_GET_PERFORMANCE_STATS);
+    request->mutable_request_get_performance_stats()->set_reset_stats(reset_stats);
+
+    m_request_manager->send_request(request);
+
+    return request->request_id();
+}
+
+PSMRequestID PSMoveClient::set_service_tracing_enabled(bool enabled)
+{
+    CLIENT_LOG_INFO("set_service_tracing_enabled") << "requesting service tracing " << (enabled ? "on" : "off") << std::endl;
+
+    RequestPtr request(new PSMoveProtocol::Request());
+    request->set_type(PSMoveProtocol::Request_RequestType_SET_TRACING_ENABLED);
+    request->mutable_request_set_tracing_enabled()->set_enabled(enabled);
+
+    m_request_manager->send_request(request);
+
+    return request->request_id();
+}
+
+PSMRequestID PSMoveClient::dump_service_trace()
+{
+    CLIENT_LOG_INFO("dump_service_trace") << "requesting service trace dump" << std::endl;
+
+    RequestPtr request(new PSMoveProtocol::Request());
+    request->set_type(PSMoveProtocol::Request_RequestType_DUMP_TRACE);
+
+    m_request_manager->send_request(request);
+
+    return request->request_id();
+}
+
 // -- ClientPSMoveAPI Requests -----
 bool PSMoveClient::allocate_controller_listener(PSMControllerID ControllerID)
 {
@@ -707,7 +926,7 @@ PSMRequestID PSMoveClient::get_controller_list()
     return request->request_id();
 }
 
-PSMRequestID PSMoveClient::start_controller_data_stream(PSMControllerID controller_id, unsigned int flags)
+PSMRequestID PSMoveClient::start_controller_data_stream(PSMControllerID controller_id, unsigned int flags, float max_publish_rate_hz)
 {
 	PSMRequestID requestID= PSM_INVALID_REQUEST_ID;
 
@@ -750,6 +969,11 @@ PSMRequestID PSMoveClient::start_controller_data_stream(PSMControllerID controll
 			request->mutable_request_start_psmove_data_stream()->set_disable_roi(true);
 		}
 
+		if (max_publish_rate_hz > 0.f)
+		{
+			request->mutable_request_start_psmove_data_stream()->set_max_publish_rate_hz(max_publish_rate_hz);
+		}
+
 		m_request_manager->send_request(request);
 
 		requestID= request->request_id();
@@ -920,7 +1144,7 @@ PSMRequestID PSMoveClient::get_tracker_list()
     return request->request_id();
 }
 
-PSMRequestID PSMoveClient::start_tracker_data_stream(PSMTrackerID tracker_id)
+PSMRequestID PSMoveClient::start_tracker_data_stream(PSMTrackerID tracker_id, float max_publish_rate_hz)
 {
     CLIENT_LOG_INFO("start_tracker_data_stream") << "requesting tracker stream start for TrackerID: " << tracker_id << std::endl;
 
@@ -929,6 +1153,11 @@ PSMRequestID PSMoveClient::start_tracker_data_stream(PSMTrackerID tracker_id)
     request->set_type(PSMoveProtocol::Request_RequestType_START_TRACKER_DATA_STREAM);
     request->mutable_request_start_tracker_data_stream()->set_tracker_id(tracker_id);
 
+    if (max_publish_rate_hz > 0.f)
+    {
+        request->mutable_request_start_tracker_data_stream()->set_max_publish_rate_hz(max_publish_rate_hz);
+    }
+
     m_request_manager->send_request(request);
 
     return request->request_id();
@@ -1032,6 +1261,66 @@ void PSMoveClient::close_video_stream(PSMTrackerID tracker_id)
 	}
 }
 
+PSMResult PSMoveClient::acquire_video_frame(PSMTrackerID tracker_id, PSMTrackerVideoFrame *out_frame)
+{
+	PSMResult result= PSMResult_Error;
+
+	if (IS_VALID_TRACKER_INDEX(tracker_id))
+	{
+		PSMTracker *tracker= &m_trackers[tracker_id];
+
+		if (tracker->opaque_shared_memory_accesor != nullptr)
+		{
+			SharedVideoFrameReadOnlyAccessor *shared_memory_accesor = 
+				reinterpret_cast<SharedVideoFrameReadOnlyAccessor *>(tracker->opaque_shared_memory_accesor);
+
+			result= shared_memory_accesor->acquireVideoFrame(out_frame);
+		}
+	}
+
+	return result;
+}
+
+PSMResult PSMoveClient::wait_video_frame(PSMTrackerID tracker_id, int timeout_ms)
+{
+	PSMResult result= PSMResult_Error;
+
+	if (IS_VALID_TRACKER_INDEX(tracker_id))
+	{
+		PSMTracker *tracker= &m_trackers[tracker_id];
+
+		if (tracker->opaque_shared_memory_accesor != nullptr)
+		{
+			SharedVideoFrameReadOnlyAccessor *shared_memory_accesor = 
+				reinterpret_cast<SharedVideoFrameReadOnlyAccessor *>(tracker->opaque_shared_memory_accesor);
+
+			result= shared_memory_accesor->waitForVideoFrame(timeout_ms) ? PSMResult_Success : PSMResult_Timeout;
+		}
+	}
+
+	return result;
+}
+
+bool PSMoveClient::release_video_frame(PSMTrackerID tracker_id)
+{
+	bool bReleased= false;
+
+	if (IS_VALID_TRACKER_INDEX(tracker_id))
+	{
+		PSMTracker *tracker= &m_trackers[tracker_id];
+
+		if (tracker->opaque_shared_memory_accesor != nullptr)
+		{
+			SharedVideoFrameReadOnlyAccessor *shared_memory_accesor = 
+				reinterpret_cast<SharedVideoFrameReadOnlyAccessor *>(tracker->opaque_shared_memory_accesor);
+
+			bReleased= shared_memory_accesor->releaseVideoFrame();
+		}
+	}
+
+	return bReleased;
+}
+
 const unsigned char *PSMoveClient::get_video_frame_buffer(PSMTrackerID tracker_id) const
 {
 	const unsigned char *buffer= nullptr;
@@ -1113,7 +1402,8 @@ PSMRequestID PSMoveClient::get_hmd_list()
     
 PSMRequestID PSMoveClient::start_hmd_data_stream(
     PSMHmdID hmd_id,
-    unsigned int flags)
+    unsigned int flags,
+    float max_publish_rate_hz)
 {
     CLIENT_LOG_INFO("start_hmd_data_stream") << "requesting HMD stream start for HmdID: " << hmd_id << std::endl;
 
@@ -1152,6 +1442,11 @@ PSMRequestID PSMoveClient::start_hmd_data_stream(
 		request->mutable_request_start_hmd_data_stream()->set_disable_roi(true);
 	}
 
+	if (max_publish_rate_hz > 0.f)
+	{
+		request->mutable_request_start_hmd_data_stream()->set_max_publish_rate_hz(max_publish_rate_hz);
+	}
+
     m_request_manager->send_request(request);
 
     return request->request_id();
@@ -1199,6 +1494,29 @@ PSMRequestID PSMoveClient::send_opaque_request(
 // IDataFrameListener
 void PSMoveClient::handle_data_frame(const PSMoveProtocol::DeviceOutputDataFrame *data_frame)
 {
+	const unsigned long long received_time_usec= get_client_time_usec();
+
+	// Keep the pose snapshots as fresh as the data frames, regardless of how often update() is called
+	update_pose_snapshot(data_frame);
+
+	if (m_bUseIOThread)
+	{
+		// We're on the network I/O thread.
+		// Leave the device views to the client thread, it'll apply the frame in the next update().
+		enqueue_data_frame(data_frame, received_time_usec);
+	}
+	else
+	{
+		apply_data_frame(data_frame, received_time_usec);
+	}
+}
+
+void PSMoveClient::apply_data_frame(
+	const PSMoveProtocol::DeviceOutputDataFrame *data_frame, 
+	unsigned long long received_time_usec)
+{
+	record_data_frame_latency(data_frame, received_time_usec);
+
     switch (data_frame->device_category())
     {
     case PSMoveProtocol::DeviceOutputDataFrame::CONTROLLER:
@@ -1253,6 +1571,524 @@ void PSMoveClient::handle_data_frame(const PSMoveProtocol::DeviceOutputDataFrame
     }
 }
 
+void PSMoveClient::update_pose_snapshot(const PSMoveProtocol::DeviceOutputDataFrame *data_frame)
+{
+    switch (data_frame->device_category())
+    {
+    case PSMoveProtocol::DeviceOutputDataFrame::CONTROLLER:
+        {
+            const PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket& controller_packet= data_frame->controller_data_packet();
+			const PSMControllerID controller_id= controller_packet.controller_id();
+
+			if (IS_VALID_CONTROLLER_INDEX(controller_id))
+			{
+				PSMController *controller= &m_snapshot_controller_views[controller_id];
+				PSMPoseSnapshot snapshot;
+
+				applyControllerDataFrame(controller_packet, controller);
+
+				// Publish the new pose for other threads (skipped if the packet was stale)
+				if (controller->OutputSequenceNum == controller_packet.sequence_num() &&
+					buildControllerPoseSnapshot(controller, controller_packet.server_timestamp_usec(), &snapshot))
+				{
+					m_controller_pose_snapshots[controller_id].write(snapshot);
+				}
+			}
+        } break;
+    case PSMoveProtocol::DeviceOutputDataFrame::HMD:
+        {
+            const PSMoveProtocol::DeviceOutputDataFrame_HMDDataPacket& hmd_packet = data_frame->hmd_data_packet();
+			const PSMHmdID hmd_id= hmd_packet.hmd_id();
+
+			if (IS_VALID_HMD_INDEX(hmd_id))
+			{
+				PSMHeadMountedDisplay *hmd= &m_snapshot_hmd_views[hmd_id];
+				PSMPoseSnapshot snapshot;
+
+				applyHmdDataFrame(hmd_packet, hmd);
+
+				// Publish the new pose for other threads (skipped if the packet was stale)
+				if (hmd->OutputSequenceNum == hmd_packet.sequence_num() &&
+					buildHmdPoseSnapshot(hmd, hmd_packet.server_timestamp_usec(), &snapshot))
+				{
+					m_hmd_pose_snapshots[hmd_id].write(snapshot);
+				}
+			}
+        } break;
+    default:
+        // Trackers don't have a pose snapshot
+        break;
+    }
+}
+
+void PSMoveClient::enqueue_data_frame(
+	const PSMoveProtocol::DeviceOutputDataFrame *data_frame, 
+	unsigned long long received_time_usec)
+{
+	const int frame_index= getPendingDataFrameIndex(data_frame);
+
+	if (frame_index != -1)
+	{
+		PendingDataFrame &pending= m_pending_data_frames[frame_index];
+		std::lock_guard<std::mutex> lock(m_pending_data_frame_mutex);
+
+		// Only the latest frame per device is kept.
+		// The copy goes onto the buffer's preallocated arena block, so it doesn't allocate.
+		pending.frame_buffers[pending.received_buffer_index].copy_from(data_frame);
+		pending.received_time_usec= received_time_usec;
+		pending.bHasReceivedFrame= true;
+	}
+}
+
+void PSMoveClient::apply_pending_data_frames()
+{
+	bool bHasFrame[k_pending_data_frame_count];
+
+	// Grab the received frames in one go so the I/O thread never waits on us applying them
+	{
+		std::lock_guard<std::mutex> lock(m_pending_data_frame_mutex);
+
+		for (int frame_index= 0; frame_index < k_pending_data_frame_count; ++frame_index)
+		{
+			PendingDataFrame &pending= m_pending_data_frames[frame_index];
+
+			bHasFrame[frame_index]= pending.bHasReceivedFrame;
+			if (pending.bHasReceivedFrame)
+			{
+				pending.received_buffer_index= 1 - pending.received_buffer_index;
+				pending.applied_received_time_usec= pending.received_time_usec;
+				pending.bHasReceivedFrame= false;
+			}
+		}
+	}
+
+	for (int frame_index= 0; frame_index < k_pending_data_frame_count; ++frame_index)
+	{
+		if (bHasFrame[frame_index])
+		{
+			const PendingDataFrame &pending= m_pending_data_frames[frame_index];
+			const ClientDataFrameBuffer &applied_buffer= pending.frame_buffers[1 - pending.received_buffer_index];
+
+			apply_data_frame(applied_buffer.get(), pending.applied_received_time_usec);
+		}
+	}
+}
+
+// Add the client's receive and consume times to the timestamps the service put in the data frame.
+// The service timestamps are on the service's clock, so stages crossing over to the client need the clock offset.
+void PSMoveClient::record_data_frame_latency(
+	const PSMoveProtocol::DeviceOutputDataFrame *data_frame, 
+	unsigned long long received_time_usec)
+{
+	const int frame_index= getPendingDataFrameIndex(data_frame);
+
+	if (frame_index == -1)
+	{
+		return;
+	}
+
+	const PSMoveProtocol::DeviceOutputDataFrame_LatencyTimestamps &timestamps= data_frame->latency_timestamps();
+	const long long sensor_usec= static_cast<long long>(timestamps.sensor_arrival_usec());
+	const long long optical_usec= static_cast<long long>(timestamps.optical_capture_usec());
+	const long long filter_usec= static_cast<long long>(timestamps.filter_update_usec());
+	const long long send_usec= static_cast<long long>(timestamps.network_send_usec());
+	const long long received_usec= static_cast<long long>(received_time_usec);
+	const long long consumed_usec= static_cast<long long>(get_client_time_usec());
+	const ClientClockOffsetEstimator &clock_offset= m_network_manager->get_clock_offset();
+	const bool bHasClockSync= clock_offset.get_has_offset();
+	const long long clock_offset_usec= clock_offset.get_offset_usec();
+	PSMLatencyHistogram *stages= m_latency_stats[frame_index].Stages;
+
+	// Timestamps are zero when a stage doesn't apply (e.g. no tracker sees the device) 
+	// or the data frame didn't go through the service's network manager (e.g. the initial frame of a stream)
+	if (sensor_usec != 0 && filter_usec != 0)
+	{
+		addLatencySample(&stages[PSMLatencyStage_SensorToFilter], filter_usec - sensor_usec);
+	}
+	if (optical_usec != 0 && filter_usec != 0)
+	{
+		addLatencySample(&stages[PSMLatencyStage_OpticalToFilter], filter_usec - optical_usec);
+	}
+
+	// Trackers don't run a filter, their frames go straight out once the video frame arrives
+	const long long processed_usec= (filter_usec != 0) ? filter_usec : sensor_usec;
+	if (processed_usec != 0 && send_usec != 0)
+	{
+		addLatencySample(&stages[PSMLatencyStage_FilterToSend], send_usec - processed_usec);
+	}
+	if (send_usec != 0 && bHasClockSync)
+	{
+		addLatencySample(&stages[PSMLatencyStage_SendToReceive], received_usec - (send_usec + clock_offset_usec));
+	}
+
+	addLatencySample(&stages[PSMLatencyStage_ReceiveToConsume], consumed_usec - received_usec);
+
+	// Keep the frame's timestamps around on the client clock for callers that want every sample
+	PSMLatencyTimestamps &last_timestamps= m_last_latency_timestamps[frame_index];
+
+	last_timestamps.SensorArrivalUsec= (bHasClockSync && sensor_usec != 0) ? sensor_usec + clock_offset_usec : 0;
+	last_timestamps.OpticalCaptureUsec= (bHasClockSync && optical_usec != 0) ? optical_usec + clock_offset_usec : 0;
+	last_timestamps.FilterUpdateUsec= (bHasClockSync && filter_usec != 0) ? filter_usec + clock_offset_usec : 0;
+	last_timestamps.NetworkSendUsec= (bHasClockSync && send_usec != 0) ? send_usec + clock_offset_usec : 0;
+	last_timestamps.ReceivedUsec= received_usec;
+	last_timestamps.ConsumedUsec= consumed_usec;
+	last_timestamps.bIsClockSynced= bHasClockSync;
+
+	if (bHasClockSync)
+	{
+		long long earliest_usec= 0;
+		const long long service_timestamps[]= {sensor_usec, optical_usec, filter_usec, send_usec};
+
+		for (long long service_timestamp : service_timestamps)
+		{
+			if (service_timestamp != 0 && (earliest_usec == 0 || service_timestamp < earliest_usec))
+			{
+				earliest_usec= service_timestamp;
+			}
+		}
+
+		if (earliest_usec != 0)
+		{
+			addLatencySample(&stages[PSMLatencyStage_Total], consumed_usec - (earliest_usec + clock_offset_usec));
+		}
+	}
+}
+
+static int getPendingDataFrameIndex(const PSMoveProtocol::DeviceOutputDataFrame *data_frame)
+{
+	int frame_index= -1;
+
+    switch (data_frame->device_category())
+    {
+    case PSMoveProtocol::DeviceOutputDataFrame::CONTROLLER:
+		{
+			const int controller_id= data_frame->controller_data_packet().controller_id();
+
+			if (IS_VALID_CONTROLLER_INDEX(controller_id))
+			{
+				frame_index= controller_id;
+			}
+		} break;
+    case PSMoveProtocol::DeviceOutputDataFrame::TRACKER:
+		{
+			const int tracker_id= data_frame->tracker_data_packet().tracker_id();
+
+			if (IS_VALID_TRACKER_INDEX(tracker_id))
+			{
+				frame_index= PSMOVESERVICE_MAX_CONTROLLER_COUNT + tracker_id;
+			}
+		} break;
+    case PSMoveProtocol::DeviceOutputDataFrame::HMD:
+		{
+			const int hmd_id= data_frame->hmd_data_packet().hmd_id();
+
+			if (IS_VALID_HMD_INDEX(hmd_id))
+			{
+				frame_index= PSMOVESERVICE_MAX_CONTROLLER_COUNT + PSMOVESERVICE_MAX_TRACKER_COUNT + hmd_id;
+			}
+		} break;
+    }
+
+	return frame_index;
+}
+
+static int getPendingDataFrameIndex(PSMDeviceCategory device_category, int device_id)
+{
+	int frame_index= -1;
+
+	switch (device_category)
+	{
+	case PSMDeviceCategory_Controller:
+		if (IS_VALID_CONTROLLER_INDEX(device_id))
+		{
+			frame_index= device_id;
+		}
+		break;
+	case PSMDeviceCategory_Tracker:
+		if (IS_VALID_TRACKER_INDEX(device_id))
+		{
+			frame_index= PSMOVESERVICE_MAX_CONTROLLER_COUNT + device_id;
+		}
+		break;
+	case PSMDeviceCategory_Hmd:
+		if (IS_VALID_HMD_INDEX(device_id))
+		{
+			frame_index= PSMOVESERVICE_MAX_CONTROLLER_COUNT + PSMOVESERVICE_MAX_TRACKER_COUNT + device_id;
+		}
+		break;
+	}
+
+	return frame_index;
+}
+
+static void addLatencySample(PSMLatencyHistogram *histogram, long long latency_usec)
+{
+	// Clock offset error can make a cross clock stage come out slightly negative
+	const unsigned long long sample_usec= static_cast<unsigned long long>(std::max(latency_usec, 0LL));
+	int bucket_index= 0;
+
+	while (bucket_index < PSM_LATENCY_HISTOGRAM_BUCKET_COUNT - 1 &&
+		   sample_usec >= (static_cast<unsigned long long>(PSM_LATENCY_HISTOGRAM_FIRST_BUCKET_USEC) << bucket_index))
+	{
+		++bucket_index;
+	}
+
+	histogram->MinUsec= (histogram->SampleCount == 0) ? sample_usec : std::min(histogram->MinUsec, sample_usec);
+	histogram->MaxUsec= std::max(histogram->MaxUsec, sample_usec);
+	histogram->TotalUsec+= sample_usec;
+	histogram->BucketCounts[bucket_index]++;
+	histogram->SampleCount++;
+}
+
+bool PSMoveClient::get_controller_pose_snapshot(PSMControllerID controller_id, PSMPoseSnapshot *out_snapshot) const
+{
+    return IS_VALID_CONTROLLER_INDEX(controller_id) && m_controller_pose_snapshots[controller_id].read(*out_snapshot);
+}
+
+bool PSMoveClient::get_hmd_pose_snapshot(PSMHmdID hmd_id, PSMPoseSnapshot *out_snapshot) const
+{
+    return IS_VALID_HMD_INDEX(hmd_id) && m_hmd_pose_snapshots[hmd_id].read(*out_snapshot);
+}
+
+bool PSMoveClient::get_controller_pose_at_time(
+	PSMControllerID controller_id, 
+	unsigned long long target_time_usec, 
+	PSMPosef *out_pose) const
+{
+	PSMPoseSnapshot snapshot;
+
+	if (get_controller_pose_snapshot(controller_id, &snapshot))
+	{
+		get_pose_at_time(snapshot, target_time_usec, out_pose);
+		return true;
+	}
+
+	return false;
+}
+
+bool PSMoveClient::get_hmd_pose_at_time(
+	PSMHmdID hmd_id, 
+	unsigned long long target_time_usec, 
+	PSMPosef *out_pose) const
+{
+	PSMPoseSnapshot snapshot;
+
+	if (get_hmd_pose_snapshot(hmd_id, &snapshot))
+	{
+		get_pose_at_time(snapshot, target_time_usec, out_pose);
+		return true;
+	}
+
+	return false;
+}
+
+unsigned long long PSMoveClient::get_client_time_usec()
+{
+	return ClientClockOffsetEstimator::get_client_time_usec();
+}
+
+void PSMoveClient::reset_clock_sync()
+{
+	// A version request still in flight gets a canceled response when its connection closes,
+	// its callback ignores it since the id no longer matches.
+	// The network manager forgets the clock offset itself once the connection stops.
+	m_clock_sync_version_request_id= PSM_INVALID_REQUEST_ID;
+}
+
+void PSMoveClient::handle_clock_sync_version_response(
+	const PSMResponseMessage *response_message, 
+	void *userdata)
+{
+	PSMoveClient *this_ptr = reinterpret_cast<PSMoveClient *>(userdata);
+
+	if (response_message->request_id != this_ptr->m_clock_sync_version_request_id)
+	{
+		return;
+	}
+
+	this_ptr->m_clock_sync_version_request_id= PSM_INVALID_REQUEST_ID;
+
+	if (response_message->result_code != PSMResult_Success || 
+		response_message->payload_type != PSMResponseMessage::_responsePayloadType_ServiceVersion)
+	{
+		return;
+	}
+
+	// "Product.Major-Phase Minor.Release.Hotfix", see ProtocolVersion.h
+	const char *version_string= response_message->payload.service_version.version_string;
+	int version[5];
+
+	if (sscanf(version_string, "%d.%d-%*s %d.%d.%d", &version[0], &version[1], &version[2], &version[3], &version[4]) == 5 &&
+		!std::lexicographical_compare(version, version + 5, k_clock_sync_min_protocol_version, k_clock_sync_min_protocol_version + 5))
+	{
+		// Measure the clock offset about once a second from now on.
+		// A round trip bounds the error of the offset to half the round trip time, 
+		// so the latency stages that cross between the two clocks and the extrapolated poses stay honest.
+		this_ptr->m_network_manager->start_clock_sync();
+	}
+	else
+	{
+		CLIENT_LOG_INFO("handle_clock_sync_version_response") 
+			<< "Service protocol v" << version_string << " can't sync clocks, latency stages across the network and pose extrapolation are unavailable" << std::endl;
+	}
+}
+
+void PSMoveClient::get_pose_at_time(
+	const PSMPoseSnapshot &snapshot, 
+	unsigned long long target_time_usec, 
+	PSMPosef *out_pose) const
+{
+	const ClientClockOffsetEstimator &clock_offset= m_network_manager->get_clock_offset();
+
+	if (clock_offset.get_has_offset())
+	{
+		extrapolate_pose(snapshot, clock_offset.get_offset_usec(), target_time_usec, out_pose);
+	}
+	else
+	{
+		// Don't know when this pose was taken on our clock
+		*out_pose = snapshot.Pose;
+	}
+}
+
+void PSMoveClient::extrapolate_pose(
+	const PSMPoseSnapshot &snapshot, 
+	long long clock_offset_usec, 
+	unsigned long long target_time_usec, 
+	PSMPosef *out_pose)
+{
+	*out_pose = snapshot.Pose;
+
+	if (snapshot.ServerTimestampUsec == 0)
+	{
+		// Older service or the pose filter hasn't run yet
+		return;
+	}
+
+	const long long pose_time_usec = static_cast<long long>(snapshot.ServerTimestampUsec) + clock_offset_usec;
+	const long long delta_usec = 
+		std::min(
+			std::max(static_cast<long long>(target_time_usec) - pose_time_usec, 0LL), 
+			static_cast<long long>(PSM_MAX_POSE_EXTRAPOLATION_USEC));
+	const float dt = static_cast<float>(delta_usec) / 1000000.f;
+
+	if (dt <= 0.f)
+	{
+		return;
+	}
+
+	const PSMPhysicsData &physics = snapshot.PhysicsData;
+
+	// p' = p + v*dt + a*dt^2/2
+	if (snapshot.bIsPositionValid)
+	{
+		const PSMVector3f velocity_term = PSM_Vector3fScale(&physics.LinearVelocityCmPerSec, dt);
+		const PSMVector3f acceleration_term = PSM_Vector3fScale(&physics.LinearAccelerationCmPerSecSqr, 0.5f*dt*dt);
+		const PSMVector3f delta_position = PSM_Vector3fAdd(&velocity_term, &acceleration_term);
+
+		out_pose->Position = PSM_Vector3fAdd(&snapshot.Pose.Position, &delta_position);
+	}
+
+	// Rotate by the angle swept in dt (angular velocity is in the local frame, like the service's filters use it)
+	if (snapshot.bIsOrientationValid)
+	{
+		const PSMVector3f average_angular_velocity = 
+			PSM_Vector3fScaleAndAdd(&physics.AngularAccelerationRadPerSecSqr, 0.5f*dt, &physics.AngularVelocityRadPerSec);
+		const PSMVector3f rotation = PSM_Vector3fScale(&average_angular_velocity, dt);
+		const float angle = PSM_Vector3fLength(&rotation);
+
+		if (angle > k_real_epsilon)
+		{
+			const float half_angle_sin_over_angle = sinf(0.5f*angle) / angle;
+			const PSMQuatf delta_orientation = 
+				PSM_QuatfCreate(
+					cosf(0.5f*angle), 
+					rotation.x*half_angle_sin_over_angle, 
+					rotation.y*half_angle_sin_over_angle, 
+					rotation.z*half_angle_sin_over_angle);
+			const PSMQuatf orientation = PSM_QuatfMultiply(&snapshot.Pose.Orientation, &delta_orientation);
+
+			out_pose->Orientation = PSM_QuatfNormalizeWithDefault(&orientation, &snapshot.Pose.Orientation);
+		}
+	}
+}
+
+static bool buildControllerPoseSnapshot(
+	const PSMController *controller, 
+	unsigned long long server_timestamp_usec, 
+	PSMPoseSnapshot *out_snapshot)
+{
+	memset(out_snapshot, 0, sizeof(PSMPoseSnapshot));
+	out_snapshot->OutputSequenceNum = controller->OutputSequenceNum;
+	out_snapshot->ServerTimestampUsec = server_timestamp_usec;
+
+	switch (controller->ControllerType)
+	{
+	case PSMController_Move:
+		{
+			const PSMPSMove &State= controller->ControllerState.PSMoveState;
+			out_snapshot->Pose = State.Pose;
+			out_snapshot->PhysicsData = State.PhysicsData;
+			out_snapshot->bIsOrientationValid = State.bIsOrientationValid;
+			out_snapshot->bIsPositionValid = State.bIsPositionValid;
+			out_snapshot->bIsCurrentlyTracking = State.bIsCurrentlyTracking;
+		} return true;
+	case PSMController_DualShock4:
+		{
+			const PSMDualShock4 &State= controller->ControllerState.PSDS4State;
+			out_snapshot->Pose = State.Pose;
+			out_snapshot->PhysicsData = State.PhysicsData;
+			out_snapshot->bIsOrientationValid = State.bIsOrientationValid;
+			out_snapshot->bIsPositionValid = State.bIsPositionValid;
+			out_snapshot->bIsCurrentlyTracking = State.bIsCurrentlyTracking;
+		} return true;
+	case PSMController_Virtual:
+		{
+			const PSMVirtualController &State= controller->ControllerState.VirtualController;
+			out_snapshot->Pose = State.Pose;
+			out_snapshot->PhysicsData = State.PhysicsData;
+			out_snapshot->bIsPositionValid = State.bIsPositionValid;
+			out_snapshot->bIsCurrentlyTracking = State.bIsCurrentlyTracking;
+		} return true;
+	default:
+		// Navi (and unknown controllers) don't have a pose
+		return false;
+	}
+}
+
+static bool buildHmdPoseSnapshot(
+	const PSMHeadMountedDisplay *hmd, 
+	unsigned long long server_timestamp_usec, 
+	PSMPoseSnapshot *out_snapshot)
+{
+	memset(out_snapshot, 0, sizeof(PSMPoseSnapshot));
+	out_snapshot->OutputSequenceNum = hmd->OutputSequenceNum;
+	out_snapshot->ServerTimestampUsec = server_timestamp_usec;
+
+	switch (hmd->HmdType)
+	{
+	case PSMHmd_Morpheus:
+		{
+			const PSMMorpheus &State= hmd->HmdState.MorpheusState;
+			out_snapshot->Pose = State.Pose;
+			out_snapshot->PhysicsData = State.PhysicsData;
+			out_snapshot->bIsOrientationValid = State.bIsOrientationValid;
+			out_snapshot->bIsPositionValid = State.bIsPositionValid;
+			out_snapshot->bIsCurrentlyTracking = State.bIsCurrentlyTracking;
+		} return true;
+	case PSMHmd_Virtual:
+		{
+			const PSMVirtualHMD &State= hmd->HmdState.VirtualHMDState;
+			out_snapshot->Pose = State.Pose;
+			out_snapshot->PhysicsData = State.PhysicsData;
+			out_snapshot->bIsPositionValid = State.bIsPositionValid;
+			out_snapshot->bIsCurrentlyTracking = State.bIsCurrentlyTracking;
+		} return true;
+	default:
+		return false;
+	}
+}
+
 static void applyControllerDataFrame(
 	const PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket& controller_packet, 
 	PSMController *controller)
@@ -2146,6 +2982,12 @@ void PSMoveClient::handle_server_connection_opened()
 {
     CLIENT_LOG_INFO("handle_server_connection_opened") << "Connected to service" << std::endl;
 
+    // The service may have been restarted, start the clock offset measurement over.
+    // Clock sync requests only go out once the service's protocol version shows it can answer them.
+    reset_clock_sync();
+    m_clock_sync_version_request_id= get_service_version();
+    register_callback(m_clock_sync_version_request_id, PSMoveClient::handle_clock_sync_version_response, this);
+
     enqueue_event_message(PSMEventMessage::PSMEvent_connectedToService, ResponsePtr());
 }
 
@@ -2160,6 +3002,8 @@ void PSMoveClient::handle_server_connection_closed()
 {
     CLIENT_LOG_INFO("handle_server_connection_closed") << "Disconnected from service" << std::endl;
 
+    reset_clock_sync();
+
     enqueue_event_message(PSMEventMessage::PSMEvent_disconnectedFromService, ResponsePtr());
 }
 
@@ -2247,27 +3091,26 @@ void PSMoveClient::enqueue_event_message(
     message.payload_type = PSMMessage::_messagePayloadType_Event;
     message.event_data.event_type= event_type;
 
-    // Maintain a reference to the event until the next update
+    // Maintain a copy of the event until the next update
     if (event)
     {
-        // Create a smart pointer to a new copy of the event.
-        // If we just add the given event smart pointer to the reference cache
-        // we'll be storing a reference to the shared m_packed_response on the client network manager
+        // Copy the event into the event pool.
+        // If we just kept a reference to the given event
+        // we'd be storing a reference to the shared m_packed_response on the client network manager
         // which gets constantly overwritten with new incoming events.
-        ResponsePtr eventCopy(new PSMoveProtocol::Response(*event.get()));
+        // If more events arrived this update than the pool expects, the copy spills onto the heap (counted as an overflow).
+        const PSMoveProtocol::Response *eventCopy= m_event_pool.store(*event.get());
 
         //NOTE: This pointer is only safe until the next update call to update is made
-        message.event_data.event_data_handle = static_cast<const void *>(eventCopy.get());
-
-        m_event_reference_cache.push_back(eventCopy);
+        message.event_data.event_data_handle = static_cast<const void *>(eventCopy);
     }
     else
     {
         message.event_data.event_data_handle = nullptr;
     }
 
-    // Add the message to the message queue
-    m_message_queue.push_back(message);
+    // Add the message to the message queue (dropped and counted if the queue is full)
+    m_message_queue.push(message);
 }
 
 bool PSMoveClient::register_callback(
@@ -2333,8 +3176,8 @@ void PSMoveClient::enqueue_response_message(
     message.payload_type = PSMMessage::_messagePayloadType_Response;
     message.response_data= *response_message;
 
-    // Add the message to the message queue
-    m_message_queue.push_back(message);
+    // Add the message to the message queue (dropped and counted if the queue is full)
+    m_message_queue.push(message);
 }
 
 bool PSMoveClient::cancel_callback(PSMRequestID request_id)
@@ -5,14 +5,18 @@
 #include "PSMoveClient_CAPI.h"
 #include "PSMoveProtocolInterface.h"
 #include "ClientNetworkInterface.h"
+#include "ClientDataFrameBuffer.h"
 #include "ClientLog.h"
-#include <deque>
+#include "ClientMessageQueue.h"
+#include "ClientSeqLock.h"
+#include <atomic>
 #include <map>
+#include <mutex>
 #include <vector>
 
 //-- typedefs -----
-typedef std::deque<PSMMessage> t_message_queue;
-typedef std::vector<ResponsePtr> t_event_reference_cache;
+typedef ClientMessageRing<PSMMessage> t_message_queue;
+typedef ClientMessagePool<PSMoveProtocol::Response> t_event_pool;
 
 //-- definitions -----
 class PSMoveClient : 
@@ -35,21 +39,30 @@ public:
 	bool pollWasSystemButtonPressed();
 
     // -- ClientPSMoveAPI System -----
-    bool startup(e_log_severity_level log_level);
+    bool startup(e_log_severity_level log_level, bool use_io_thread= false, bool use_local_sockets= true);
     void update();
 	void process_messages();
     bool poll_next_message(PSMMessage *message, size_t message_size);
+    void get_message_queue_stats(PSMMessageQueueStats *out_stats) const;
+    bool get_latency_stats(PSMDeviceCategory device_category, int device_id, PSMLatencyStats *out_stats) const;
+    bool get_latency_timestamps(PSMDeviceCategory device_category, int device_id, PSMLatencyTimestamps *out_timestamps) const;
+    void reset_latency_stats();
     void shutdown();
 
 	// -- System Requests ----
     PSMRequestID get_service_version();
+    PSMRequestID get_service_performance_stats(bool reset_stats);
+    PSMRequestID set_service_tracing_enabled(bool enabled);
+    PSMRequestID dump_service_trace();
 
     // -- ClientPSMoveAPI Requests -----
     bool allocate_controller_listener(PSMControllerID controller_id);
     void free_controller_listener(PSMControllerID controller_id);   
     PSMController* get_controller_view(PSMControllerID controller_id);
+    bool get_controller_pose_snapshot(PSMControllerID controller_id, PSMPoseSnapshot *out_snapshot) const;
+    bool get_controller_pose_at_time(PSMControllerID controller_id, unsigned long long target_time_usec, PSMPosef *out_pose) const;
     PSMRequestID get_controller_list();
-    PSMRequestID start_controller_data_stream(PSMControllerID controller_id, unsigned int flags);
+    PSMRequestID start_controller_data_stream(PSMControllerID controller_id, unsigned int flags, float max_publish_rate_hz= 0.f);
     PSMRequestID stop_controller_data_stream(PSMControllerID controller_id);
     PSMRequestID set_led_tracking_color(PSMControllerID controller_id, PSMTrackingColorType tracking_color);
     PSMRequestID reset_orientation(PSMControllerID controller_id, const PSMQuatf& q_pose);
@@ -60,29 +73,48 @@ public:
     PSMTracker* get_tracker_view(PSMTrackerID tracker_id);
 	PSMRequestID get_tracking_space_settings();
     PSMRequestID get_tracker_list();
-    PSMRequestID start_tracker_data_stream(PSMTrackerID tracker_id);
+    PSMRequestID start_tracker_data_stream(PSMTrackerID tracker_id, float max_publish_rate_hz= 0.f);
     PSMRequestID stop_tracker_data_stream(PSMTrackerID tracker_id);
 	bool open_video_stream(PSMTrackerID tracker_id);
 	bool poll_video_stream(PSMTrackerID tracker_id);
 	void close_video_stream(PSMTrackerID tracker_id);
 	const unsigned char *get_video_frame_buffer(PSMTrackerID tracker_id) const;
+	PSMResult acquire_video_frame(PSMTrackerID tracker_id, PSMTrackerVideoFrame *out_frame);
+	bool release_video_frame(PSMTrackerID tracker_id);
+	PSMResult wait_video_frame(PSMTrackerID tracker_id, int timeout_ms);
 
     bool allocate_hmd_listener(PSMHmdID HmdID);
     void free_hmd_listener(PSMHmdID HmdID);   
 	PSMHeadMountedDisplay* get_hmd_view(PSMHmdID tracker_id);
+    bool get_hmd_pose_snapshot(PSMHmdID hmd_id, PSMPoseSnapshot *out_snapshot) const;
+    bool get_hmd_pose_at_time(PSMHmdID hmd_id, unsigned long long target_time_usec, PSMPosef *out_pose) const;
     PSMRequestID get_hmd_list();    
-    PSMRequestID start_hmd_data_stream(PSMHmdID hmd_id, unsigned int flags);
+    PSMRequestID start_hmd_data_stream(PSMHmdID hmd_id, unsigned int flags, float max_publish_rate_hz= 0.f);
     PSMRequestID stop_hmd_data_stream(PSMHmdID hmd_id);
     PSMRequestID set_hmd_data_stream_tracker_index(PSMHmdID hmd_id, PSMTrackerID tracker_id);
     
     PSMRequestID send_opaque_request(PSMRequestHandle request_handle);
 
+    // -- Pose Extrapolation --
+    static unsigned long long get_client_time_usec();
+    /// Extrapolates a snapshot's pose to target_time_usec (client clock),
+    /// clock_offset_usec maps the snapshot's service timestamp onto the client's clock
+    static void extrapolate_pose(
+        const PSMPoseSnapshot &snapshot, long long clock_offset_usec, unsigned long long target_time_usec, PSMPosef *out_pose);
+
     // -- Callback API --
     bool register_callback(PSMRequestID request_id, PSMResponseCallback callback, void *callback_userdata);
     bool cancel_callback(PSMRequestID request_id);
     
 protected:
     void publish();
+    void apply_data_frame(const PSMoveProtocol::DeviceOutputDataFrame *data_frame, unsigned long long received_time_usec);
+    void update_pose_snapshot(const PSMoveProtocol::DeviceOutputDataFrame *data_frame);
+    void enqueue_data_frame(const PSMoveProtocol::DeviceOutputDataFrame *data_frame, unsigned long long received_time_usec);
+    void apply_pending_data_frames();
+    void record_data_frame_latency(const PSMoveProtocol::DeviceOutputDataFrame *data_frame, unsigned long long received_time_usec);
+    void reset_clock_sync();
+    void get_pose_at_time(const PSMPoseSnapshot &snapshot, unsigned long long target_time_usec, PSMPosef *out_pose) const;
 
     // IDataFrameListener
     virtual void handle_data_frame(const PSMoveProtocol::DeviceOutputDataFrame *data_frame) override;
@@ -99,6 +131,7 @@ protected:
 
     // Request Manager Callback
     static void handle_response_message(const PSMResponseMessage *response_message, void *userdata);
+    static void handle_clock_sync_version_response(const PSMResponseMessage *response_message, void *userdata);
 
     // Message Helpers
     //-----------------
@@ -123,6 +156,48 @@ private:
     //-- HMD Views -----
 	PSMHeadMountedDisplay m_HMDs[PSMOVESERVICE_MAX_HMD_COUNT];
 
+    //-- Pose Snapshots -----
+    // Written when a data frame is received, readable from any thread.
+    // The snapshot views are private copies of the device views that only the thread receiving data frames touches.
+    ClientSeqLock<PSMPoseSnapshot> m_controller_pose_snapshots[PSMOVESERVICE_MAX_CONTROLLER_COUNT];
+    ClientSeqLock<PSMPoseSnapshot> m_hmd_pose_snapshots[PSMOVESERVICE_MAX_HMD_COUNT];
+    PSMController m_snapshot_controller_views[PSMOVESERVICE_MAX_CONTROLLER_COUNT];
+    PSMHeadMountedDisplay m_snapshot_hmd_views[PSMOVESERVICE_MAX_HMD_COUNT];
+
+    //-- Network I/O Thread -----
+    // When data frames are received on the network manager's I/O thread,
+    // the most recent frame of each device waits here for the next update() to apply it to the device views.
+    // Only the latest state survives: a button pressed and released again between two updates goes unseen,
+    // same as when several frames get applied in one update without the I/O thread.
+    struct PendingDataFrame
+    {
+        ClientDataFrameBuffer frame_buffers[2];
+        int received_buffer_index;  // Buffer written on the I/O thread, update() applies the other one
+        unsigned long long received_time_usec;
+        unsigned long long applied_received_time_usec;
+        bool bHasReceivedFrame;
+    };
+    enum
+    {
+        k_pending_data_frame_count= PSMOVESERVICE_MAX_CONTROLLER_COUNT + PSMOVESERVICE_MAX_TRACKER_COUNT + PSMOVESERVICE_MAX_HMD_COUNT
+    };
+
+    bool m_bUseIOThread;
+    PendingDataFrame m_pending_data_frames[k_pending_data_frame_count];
+    std::mutex m_pending_data_frame_mutex;
+
+    //-- Latency Telemetry -----
+    // Per device histograms (same indexing as the pending data frames), only touched by the client thread
+    PSMLatencyStats m_latency_stats[k_pending_data_frame_count];
+    // Timestamps of the last data frame applied to each device view
+    PSMLatencyTimestamps m_last_latency_timestamps[k_pending_data_frame_count];
+
+    //-- Clock Sync -----
+    // The network manager measures client time - service time with GET_SERVICE_TIME round trips
+    // on the thread servicing its sockets, once the service's protocol version shows it answers them.
+    // The offset maps the service's timestamps onto the client's clock for both the latency telemetry and pose extrapolation.
+    PSMRequestID m_clock_sync_version_request_id;
+
 	bool m_bIsConnected;
 	bool m_bHasConnectionStatusChanged;
 	bool m_bHasControllerListChanged;
@@ -146,10 +221,9 @@ private:
     // This queue will be emptied automatically at the next call to update().
     t_message_queue m_message_queue;
 
-    // These vectors are used solely to keep the ref counted pointers to the 
-    // response and event parameter data valid until the next update call.
+    // Copies of the event parameter data, valid until the next update call.
     // The message queue contains raw void pointers to the response and event data.
-    t_event_reference_cache m_event_reference_cache;
+    t_event_pool m_event_pool;
 };
 
 
@@ -128,6 +128,11 @@ const char* PSM_GetClientVersionString()
     return version_string;
 }
 
+unsigned long long PSM_GetClientTimeUsec()
+{
+	return PSMoveClient::get_client_time_usec();
+}
+
 bool PSM_GetIsInitialized()
 {
 	return g_psm_client != nullptr;
@@ -192,6 +197,11 @@ PSMResult PSM_Initialize(const char* host, const char* port, int timeout_ms)
 }
 
 PSMResult PSM_InitializeAsync(const char* host, const char* port)
+{
+	return PSM_InitializeAsyncWithFlags(host, port, PSMInitializeFlags_defaultOptions);
+}
+
+PSMResult PSM_InitializeAsyncWithFlags(const char* host, const char* port, unsigned int initialize_flags)
 {
 	PSMResult result= PSMResult_Error;
 
@@ -205,7 +215,10 @@ PSMResult PSM_InitializeAsync(const char* host, const char* port)
 			g_psm_client= new PSMoveClient(s_host, s_port);
 		}
 
-		if (g_psm_client->startup(_log_severity_level_info))
+		const bool use_io_thread= (initialize_flags & PSMInitializeFlags_useNetworkIOThread) != 0;
+		const bool use_local_sockets= (initialize_flags & PSMInitializeFlags_disableLocalSockets) == 0;
+
+		if (g_psm_client->startup(_log_severity_level_info, use_io_thread, use_local_sockets))
 		{
 			result= PSMResult_RequestSent;
 		}
@@ -245,6 +258,106 @@ PSMResult PSM_GetServiceVersionString(char *out_version_string, size_t max_versi
     return result_code;
 }
 
+PSMResult PSM_GetServicePerformanceStats(PSMServicePerformanceStats *out_stats, bool reset_stats, int timeout_ms)
+{
+    PSMResult result_code= PSMResult_Error;
+
+    if (g_psm_client != nullptr && out_stats != nullptr)
+    {
+	    PSMBlockingRequest request(g_psm_client->get_service_performance_stats(reset_stats));
+        result_code= request.send(timeout_ms);
+
+        // The stats are only in the protocol response (too big for PSMResponseMessage),
+        // which stays valid until the next PSM_Update()
+        const PSMoveProtocol::Response *response= 
+            reinterpret_cast<const PSMoveProtocol::Response *>(request.get_response_message().opaque_response_handle);
+
+        if (result_code == PSMResult_Success && response != nullptr)
+        {
+            const PSMoveProtocol::Response_ResultPerformanceStats &stats= response->result_performance_stats();
+
+            memset(out_stats, 0, sizeof(PSMServicePerformanceStats));
+            out_stats->WindowSampleCount= stats.window_sample_count();
+
+            for (int stats_index= 0; 
+                 stats_index < stats.stage_stats_size() && stats_index < PSM_MAX_SERVICE_STAGE_STATS_COUNT; 
+                 ++stats_index)
+            {
+                const PSMoveProtocol::Response_ResultPerformanceStats_StageStats &stage_stats= stats.stage_stats(stats_index);
+                PSMServiceStageStats &out_stage_stats= out_stats->StageStats[stats_index];
+
+                out_stage_stats.Stage= static_cast<PSMServiceStage>(stage_stats.stage());
+                out_stage_stats.DeviceCategory= static_cast<PSMDeviceCategory>(stage_stats.device_category());
+                out_stage_stats.DeviceID= stage_stats.device_id();
+                out_stage_stats.SampleCount= stage_stats.sample_count();
+                out_stage_stats.MinNsec= stage_stats.min_nsec();
+                out_stage_stats.MaxNsec= stage_stats.max_nsec();
+                out_stage_stats.TotalNsec= stage_stats.total_nsec();
+
+                for (int bucket_index= 0; 
+                     bucket_index < stage_stats.bucket_counts_size() && bucket_index < PSM_SERVICE_STAGE_HISTOGRAM_BUCKET_COUNT; 
+                     ++bucket_index)
+                {
+                    out_stage_stats.BucketCounts[bucket_index]= stage_stats.bucket_counts(bucket_index);
+                }
+
+                ++out_stats->StageStatsCount;
+            }
+        }
+        else if (result_code == PSMResult_Success)
+        {
+            // The response pool overflowed
+            result_code= PSMResult_Error;
+        }
+    }
+    
+    return result_code;
+}
+
+PSMResult PSM_SetServiceTracingEnabled(bool enabled, int timeout_ms)
+{
+    PSMResult result_code= PSMResult_Error;
+
+    if (g_psm_client != nullptr)
+    {
+	    PSMBlockingRequest request(g_psm_client->set_service_tracing_enabled(enabled));
+        result_code= request.send(timeout_ms);
+    }
+    
+    return result_code;
+}
+
+PSMResult PSM_DumpServiceTrace(char *out_filename, size_t max_filename_size, int timeout_ms)
+{
+    PSMResult result_code= PSMResult_Error;
+
+    if (g_psm_client != nullptr)
+    {
+	    PSMBlockingRequest request(g_psm_client->dump_service_trace());
+        result_code= request.send(timeout_ms);
+
+        // The file name is only in the protocol response, which stays valid until the next PSM_Update()
+        const PSMoveProtocol::Response *response= 
+            reinterpret_cast<const PSMoveProtocol::Response *>(request.get_response_message().opaque_response_handle);
+
+        if (result_code == PSMResult_Success && response != nullptr)
+        {
+            if (out_filename != nullptr && max_filename_size > 0)
+            {
+                strncpy(out_filename, response->result_trace_dump().filename().c_str(), max_filename_size);
+                out_filename[max_filename_size - 1]= '\0';
+            }
+        }
+        else if (result_code == PSMResult_Success)
+        {
+            // The response pool overflowed
+            result_code= PSMResult_Error;
+        }
+    }
+    
+    return result_code;
+}
+
 PSMResult PSM_GetServiceVersionStringAsync(PSMRequestID *out_request_id)
 {
     PSMResult result= PSMResult_Error;
@@ -411,6 +524,38 @@ PSMResult PSM_StartControllerDataStream(PSMControllerID controller_id, unsigned
     return result_code;
 }
 
+PSMResult PSM_StartControllerDataStreamAtRateAsync(PSMControllerID controller_id, unsigned int data_stream_flags, float max_rate_hz, PSMRequestID *out_request_id)
+{
+    PSMResult result_code= PSMResult_Error;
+
+    if (g_psm_client != nullptr && IS_VALID_CONTROLLER_INDEX(controller_id))
+    {
+        PSMRequestID req_id = g_psm_client->start_controller_data_stream(controller_id, data_stream_flags, max_rate_hz);
+
+        if (out_request_id != nullptr)
+        {
+            *out_request_id= req_id;
+        }
+
+        result_code= (req_id != PSM_INVALID_REQUEST_ID) ? PSMResult_RequestSent : PSMResult_Error;
+    }
+
+    return result_code;
+}
+
+PSMResult PSM_StartControllerDataStreamAtRate(PSMControllerID controller_id, unsigned int data_stream_flags, float max_rate_hz, int timeout_ms)
+{
+    PSMResult result_code= PSMResult_Error;
+
+    if (g_psm_client != nullptr && IS_VALID_CONTROLLER_INDEX(controller_id))
+    {
+		PSMBlockingRequest request(g_psm_client->start_controller_data_stream(controller_id, data_stream_flags, max_rate_hz));
+		result_code= request.send(timeout_ms);
+    }
+
+    return result_code;
+}
+
 PSMResult PSM_StopControllerDataStreamAsync(PSMControllerID controller_id, PSMRequestID *out_request_id)
 {
     PSMResult result_code= PSMResult_Error;
@@ -690,6 +835,121 @@ PSMResult PSM_GetControllerPosition(PSMControllerID controller_id, PSMVector3f *
     return result;
 }
 
+PSMResult PSM_GetControllerPoseSnapshot(PSMControllerID controller_id, PSMPoseSnapshot *out_snapshot)
+{
+    PSMResult result= PSMResult_Error;
+	assert(out_snapshot);
+
+    if (g_psm_client != nullptr && IS_VALID_CONTROLLER_INDEX(controller_id))
+    {
+        result= g_psm_client->get_controller_pose_snapshot(controller_id, out_snapshot) ? PSMResult_Success : PSMResult_NoData;
+    }
+
+    return result;
+}
+
+PSMResult PSM_GetAllControllerStates(PSMControllerStateBlock *out_state_block, int max_count)
+{
+    PSMResult result= PSMResult_Error;
+
+    // Managed bindings can hand in a null block, fail the call rather than the process
+    if (g_psm_client != nullptr && out_state_block != nullptr && out_state_block->Version == PSM_CONTROLLER_STATE_BLOCK_VERSION)
+    {
+        int count= 0;
+
+        for (PSMControllerID controller_id= 0; 
+            controller_id < PSMOVESERVICE_MAX_CONTROLLER_COUNT && count < max_count; 
+            ++controller_id)
+        {
+            const PSMController *controller= g_psm_client->get_controller_view(controller_id);
+
+            if (!controller->bValid)
+                continue;
+
+            PSMPosef pose= {*k_psm_position_origin, *k_psm_quaternion_identity};
+            PSMPhysicsData physics_data;
+            unsigned int state_flags= controller->IsConnected ? PSMDeviceStateFlags_isConnected : 0;
+            float rumble_left= 0.f;
+            float rumble_right= 0.f;
+            bool bIsStable= false;
+
+            memset(&physics_data, 0, sizeof(PSMPhysicsData));
+
+            switch (controller->ControllerType)
+            {
+            case PSMController_Move:
+                {
+                    const PSMPSMove &State= controller->ControllerState.PSMoveState;
+
+                    pose= State.Pose;
+                    physics_data= State.PhysicsData;
+                    state_flags|= State.bIsCurrentlyTracking ? PSMDeviceStateFlags_isCurrentlyTracking : 0;
+                    state_flags|= State.bIsOrientationValid ? PSMDeviceStateFlags_isOrientationValid : 0;
+                    state_flags|= State.bIsPositionValid ? PSMDeviceStateFlags_isPositionValid : 0;
+                    rumble_left= clampf01(static_cast<float>(State.Rumble / 255.f));
+                    rumble_right= rumble_left;
+                } break;
+            case PSMController_Navi:
+                break;
+            case PSMController_DualShock4:
+                {
+                    const PSMDualShock4 &State= controller->ControllerState.PSDS4State;
+
+                    pose= State.Pose;
+                    physics_data= State.PhysicsData;
+                    state_flags|= State.bIsCurrentlyTracking ? PSMDeviceStateFlags_isCurrentlyTracking : 0;
+                    state_flags|= State.bIsOrientationValid ? PSMDeviceStateFlags_isOrientationValid : 0;
+                    state_flags|= State.bIsPositionValid ? PSMDeviceStateFlags_isPositionValid : 0;
+                    rumble_left= clampf01(static_cast<float>(State.BigRumble / 255.f));
+                    rumble_right= clampf01(static_cast<float>(State.SmallRumble / 255.f));
+                } break;
+            case PSMController_Virtual:
+                {
+                    const PSMVirtualController &State= controller->ControllerState.VirtualController;
+
+                    pose= State.Pose;
+                    physics_data= State.PhysicsData;
+                    state_flags|= State.bIsCurrentlyTracking ? PSMDeviceStateFlags_isCurrentlyTracking : 0;
+                    state_flags|= State.bIsPositionValid ? PSMDeviceStateFlags_isPositionValid : 0;
+                } break;
+            }
+
+            if (PSM_GetIsControllerStable(controller_id, &bIsStable) == PSMResult_Success && bIsStable)
+            {
+                state_flags|= PSMDeviceStateFlags_isStable;
+            }
+
+            out_state_block->ControllerID[count]= controller_id;
+            out_state_block->ControllerType[count]= controller->ControllerType;
+            out_state_block->OutputSequenceNum[count]= controller->OutputSequenceNum;
+            out_state_block->StateFlags[count]= state_flags;
+            out_state_block->Pose[count]= pose;
+            out_state_block->PhysicsData[count]= physics_data;
+            out_state_block->RumbleLeft[count]= rumble_left;
+            out_state_block->RumbleRight[count]= rumble_right;
+            ++count;
+        }
+
+        out_state_block->Count= count;
+        result= PSMResult_Success;
+    }
+
+    return result;
+}
+
+PSMResult PSM_GetControllerPoseAtTime(PSMControllerID controller_id, unsigned long long target_time_usec, PSMPosef *out_pose)
+{
+    PSMResult result= PSMResult_Error;
+	assert(out_pose);
+
+    if (g_psm_client != nullptr && IS_VALID_CONTROLLER_INDEX(controller_id))
+    {
+        result= g_psm_client->get_controller_pose_at_time(controller_id, target_time_usec, out_pose) ? PSMResult_Success : PSMResult_NoData;
+    }
+
+    return result;
+}
+
 PSMResult PSM_GetControllerPose(PSMControllerID controller_id, PSMPosef *out_pose)
 {
     PSMResult result= PSMResult_Error;
@@ -1105,6 +1365,20 @@ PSMResult PSM_StartTrackerDataStream(PSMTrackerID tracker_id, int timeout_ms)
     return result;
 }
 
+PSMResult PSM_StartTrackerDataStreamAtRate(PSMTrackerID tracker_id, float max_rate_hz, int timeout_ms)
+{
+    PSMResult result= PSMResult_Error;
+
+    if (g_psm_client != nullptr && IS_VALID_TRACKER_INDEX(tracker_id))
+    {
+		PSMBlockingRequest request(g_psm_client->start_tracker_data_stream(tracker_id, max_rate_hz));
+
+		result= request.send(timeout_ms);
+    }
+
+    return result;
+}
+
 PSMResult PSM_StopTrackerDataStream(PSMTrackerID tracker_id, int timeout_ms)
 {
     PSMResult result= PSMResult_Error;
@@ -1195,6 +1469,43 @@ PSMResult PSM_GetTrackerVideoFrameBuffer(PSMTrackerID tracker_id, const unsigned
     return result;
 }
 
+PSMResult PSM_AcquireTrackerVideoFrame(PSMTrackerID tracker_id, PSMTrackerVideoFrame *out_frame)
+{
+    PSMResult result= PSMResult_Error;
+	assert(out_frame != nullptr);
+
+    if (g_psm_client != nullptr && IS_VALID_TRACKER_INDEX(tracker_id))
+    {
+        result= g_psm_client->acquire_video_frame(tracker_id, out_frame);
+    }
+
+    return result;
+}
+
+PSMResult PSM_WaitTrackerVideoFrame(PSMTrackerID tracker_id, int timeout_ms)
+{
+    PSMResult result= PSMResult_Error;
+
+    if (g_psm_client != nullptr && IS_VALID_TRACKER_INDEX(tracker_id))
+    {
+        result= g_psm_client->wait_video_frame(tracker_id, timeout_ms);
+    }
+
+    return result;
+}
+
+PSMResult PSM_ReleaseTrackerVideoFrame(PSMTrackerID tracker_id)
+{
+    PSMResult result= PSMResult_Error;
+
+    if (g_psm_client != nullptr && IS_VALID_TRACKER_INDEX(tracker_id))
+    {
+        result= g_psm_client->release_video_frame(tracker_id) ? PSMResult_Success : PSMResult_Error;
+    }
+
+    return result;
+}
+
 PSMResult PSM_GetTrackerFrustum(PSMTrackerID tracker_id, PSMFrustum *out_frustum)
 {
     PSMResult result= PSMResult_Error;
@@ -1257,6 +1568,25 @@ PSMResult PSM_StartTrackerDataStreamAsync(PSMTrackerID tracker_id, PSMRequestID
     return result_code;
 }
 
+PSMResult PSM_StartTrackerDataStreamAtRateAsync(PSMTrackerID tracker_id, float max_rate_hz, PSMRequestID *out_request_id)
+{
+    PSMResult result_code= PSMResult_Error;
+
+    if (g_psm_client != nullptr && IS_VALID_TRACKER_INDEX(tracker_id))
+    {
+        PSMRequestID req_id = g_psm_client->start_tracker_data_stream(tracker_id, max_rate_hz);
+
+        if (out_request_id != nullptr)
+        {
+            *out_request_id= req_id;
+        }
+
+        result_code= (req_id != PSM_INVALID_REQUEST_ID) ? PSMResult_RequestSent : PSMResult_Error;
+    }
+
+    return result_code;
+}
+
 PSMResult PSM_StopTrackerDataStreamAsync(PSMTrackerID tracker_id, PSMRequestID *out_request_id)
 {
     PSMResult result_code= PSMResult_Error;
@@ -1383,6 +1713,99 @@ PSMResult PSM_GetHmdPosition(PSMHmdID hmd_id, PSMVector3f *out_position)
     return result;
 }
 
+PSMResult PSM_GetHmdPoseSnapshot(PSMHmdID hmd_id, PSMPoseSnapshot *out_snapshot)
+{
+    PSMResult result= PSMResult_Error;
+	assert(out_snapshot);
+
+    if (g_psm_client != nullptr && IS_VALID_HMD_INDEX(hmd_id))
+    {
+        result= g_psm_client->get_hmd_pose_snapshot(hmd_id, out_snapshot) ? PSMResult_Success : PSMResult_NoData;
+    }
+
+    return result;
+}
+
+PSMResult PSM_GetAllHmdStates(PSMHmdStateBlock *out_state_block, int max_count)
+{
+    PSMResult result= PSMResult_Error;
+
+    // Same checks as PSM_GetAllControllerStates()
+    if (g_psm_client != nullptr && out_state_block != nullptr && out_state_block->Version == PSM_HMD_STATE_BLOCK_VERSION)
+    {
+        int count= 0;
+
+        for (PSMHmdID hmd_id= 0; hmd_id < PSMOVESERVICE_MAX_HMD_COUNT && count < max_count; ++hmd_id)
+        {
+            const PSMHeadMountedDisplay *hmd= g_psm_client->get_hmd_view(hmd_id);
+
+            if (!hmd->bValid)
+                continue;
+
+            PSMPosef pose= {*k_psm_position_origin, *k_psm_quaternion_identity};
+            PSMPhysicsData physics_data;
+            unsigned int state_flags= hmd->IsConnected ? PSMDeviceStateFlags_isConnected : 0;
+            bool bIsStable= false;
+
+            memset(&physics_data, 0, sizeof(PSMPhysicsData));
+
+            switch (hmd->HmdType)
+            {
+            case PSMHmd_Morpheus:
+                {
+                    const PSMMorpheus &State= hmd->HmdState.MorpheusState;
+
+                    pose= State.Pose;
+                    physics_data= State.PhysicsData;
+                    state_flags|= State.bIsCurrentlyTracking ? PSMDeviceStateFlags_isCurrentlyTracking : 0;
+                    state_flags|= State.bIsOrientationValid ? PSMDeviceStateFlags_isOrientationValid : 0;
+                    state_flags|= State.bIsPositionValid ? PSMDeviceStateFlags_isPositionValid : 0;
+                } break;
+            case PSMHmd_Virtual:
+                {
+                    const PSMVirtualHMD &State= hmd->HmdState.VirtualHMDState;
+
+                    pose= State.Pose;
+                    physics_data= State.PhysicsData;
+                    state_flags|= State.bIsCurrentlyTracking ? PSMDeviceStateFlags_isCurrentlyTracking : 0;
+                    state_flags|= State.bIsPositionValid ? PSMDeviceStateFlags_isPositionValid : 0;
+                } break;
+            }
+
+            if (PSM_GetIsHmdStable(hmd_id, &bIsStable) == PSMResult_Success && bIsStable)
+            {
+                state_flags|= PSMDeviceStateFlags_isStable;
+            }
+
+            out_state_block->HmdID[count]= hmd_id;
+            out_state_block->HmdType[count]= hmd->HmdType;
+            out_state_block->OutputSequenceNum[count]= hmd->OutputSequenceNum;
+            out_state_block->StateFlags[count]= state_flags;
+            out_state_block->Pose[count]= pose;
+            out_state_block->PhysicsData[count]= physics_data;
+            ++count;
+        }
+
+        out_state_block->Count= count;
+        result= PSMResult_Success;
+    }
+
+    return result;
+}
+
+PSMResult PSM_GetHmdPoseAtTime(PSMHmdID hmd_id, unsigned long long target_time_usec, PSMPosef *out_pose)
+{
+    PSMResult result= PSMResult_Error;
+	assert(out_pose);
+
+    if (g_psm_client != nullptr && IS_VALID_HMD_INDEX(hmd_id))
+    {
+        result= g_psm_client->get_hmd_pose_at_time(hmd_id, target_time_usec, out_pose) ? PSMResult_Success : PSMResult_NoData;
+    }
+
+    return result;
+}
+
 PSMResult PSM_GetHmdPose(PSMHmdID hmd_id, PSMPosef *out_pose)
 {
     PSMResult result= PSMResult_Error;
@@ -1649,6 +2072,20 @@ PSMResult PSM_StartHmdDataStream(PSMHmdID hmd_id, unsigned int data_stream_flags
     return result;
 }
 
+PSMResult PSM_StartHmdDataStreamAtRate(PSMHmdID hmd_id, unsigned int data_stream_flags, float max_rate_hz, int timeout_ms)
+{
+    PSMResult result= PSMResult_Error;
+
+    if (g_psm_client != nullptr && IS_VALID_HMD_INDEX(hmd_id))
+    {
+		PSMBlockingRequest request(g_psm_client->start_hmd_data_stream(hmd_id, data_stream_flags, max_rate_hz));
+
+		result= request.send(timeout_ms);
+    }
+
+    return result;
+}
+
 PSMResult PSM_StopHmdDataStream(PSMHmdID hmd_id, int timeout_ms)
 {
     PSMResult result= PSMResult_Error;
@@ -1718,6 +2155,25 @@ PSMResult PSM_StartHmdDataStreamAsync(PSMHmdID hmd_id, unsigned int data_stream_
     return result;
 }
 
+PSMResult PSM_StartHmdDataStreamAtRateAsync(PSMHmdID hmd_id, unsigned int data_stream_flags, float max_rate_hz, PSMRequestID *out_request_id)
+{
+    PSMResult result= PSMResult_Error;
+
+    if (g_psm_client != nullptr && IS_VALID_HMD_INDEX(hmd_id))
+    {
+        PSMRequestID req_id = g_psm_client->start_hmd_data_stream(hmd_id, data_stream_flags, max_rate_hz);
+
+        if (out_request_id != nullptr)
+        {
+            *out_request_id= req_id;
+        }
+
+        result= (req_id != PSM_INVALID_REQUEST_ID) ? PSMResult_RequestSent : PSMResult_Error;
+    }
+
+    return result;
+}
+
 PSMResult PSM_StopHmdDataStreamAsync(PSMHmdID hmd_id, PSMRequestID *out_request_id)
 {
     PSMResult result= PSMResult_Error;
@@ -1767,6 +2223,58 @@ PSMResult PSM_PollNextMessage(PSMMessage *message, size_t message_size)
         return PSMResult_Error;
 }
 
+PSMResult PSM_GetMessageQueueStats(PSMMessageQueueStats *out_stats)
+{
+    PSMResult result= PSMResult_Error;
+
+    if (g_psm_client != nullptr && out_stats != nullptr)
+    {
+        g_psm_client->get_message_queue_stats(out_stats);
+        result= PSMResult_Success;
+    }
+
+    return result;
+}
+
+PSMResult PSM_GetLatencyStats(PSMDeviceCategory device_category, int device_id, PSMLatencyStats *out_stats)
+{
+    PSMResult result= PSMResult_Error;
+
+    if (g_psm_client != nullptr && out_stats != nullptr &&
+        g_psm_client->get_latency_stats(device_category, device_id, out_stats))
+    {
+        result= PSMResult_Success;
+    }
+
+    return result;
+}
+
+PSMResult PSM_ResetLatencyStats()
+{
+    PSMResult result= PSMResult_Error;
+
+    if (g_psm_client != nullptr)
+    {
+        g_psm_client->reset_latency_stats();
+        result= PSMResult_Success;
+    }
+
+    return result;
+}
+
+PSMResult PSM_GetLatencyTimestamps(PSMDeviceCategory device_category, int device_id, PSMLatencyTimestamps *out_timestamps)
+{
+    PSMResult result= PSMResult_Error;
+
+    if (g_psm_client != nullptr && out_timestamps != nullptr &&
+        g_psm_client->get_latency_timestamps(device_category, device_id, out_timestamps))
+    {
+        result= PSMResult_Success;
+    }
+
+    return result;
+}
+
 PSMResult PSM_SendOpaqueRequest(PSMRequestHandle request_handle, PSMRequestID *out_request_id)
 {
     PSMResult result= PSMResult_Error;
@@ -113,6 +113,55 @@ typedef enum
 	PSMStreamFlags_disableROI = 0x20,					///< Disable Region-of-Interest tracking optimization
 } PSMControllerDataStreamFlags;
 
+/// Client initialization options
+typedef enum
+{
+    PSMInitializeFlags_defaultOptions = 0x00,           ///< Sockets are serviced by PSM_Update()
+    PSMInitializeFlags_useNetworkIOThread = 0x01,       ///< Receive and decode data frames on an internal I/O thread
+    PSMInitializeFlags_disableLocalSockets = 0x02,      ///< Always connect over TCP/UDP, even to a service on this host
+} PSMInitializeFlags;
+
+/// Per device state bits in a \ref PSMControllerStateBlock or \ref PSMHmdStateBlock
+typedef enum
+{
+    PSMDeviceStateFlags_isConnected = 0x01,             ///< The device is connected to the service
+    PSMDeviceStateFlags_isCurrentlyTracking = 0x02,     ///< The device is currently seen by a tracker
+    PSMDeviceStateFlags_isOrientationValid = 0x04,      ///< The pose orientation is valid
+    PSMDeviceStateFlags_isPositionValid = 0x08,         ///< The pose position is valid
+    PSMDeviceStateFlags_isStable = 0x10,                ///< The device is at rest (see \ref PSM_GetIsControllerStable)
+} PSMDeviceStateFlags;
+
+/// The kinds of devices that stream data frames
+typedef enum
+{
+    PSMDeviceCategory_Controller,
+    PSMDeviceCategory_Tracker,
+    PSMDeviceCategory_Hmd
+} PSMDeviceCategory;
+
+/// The legs of a data frame's trip from the device to the client (see \ref PSM_GetLatencyStats)
+typedef enum
+{
+    PSMLatencyStage_SensorToFilter,     ///< Sensor packet arrival in the service -> pose filter update
+    PSMLatencyStage_OpticalToFilter,    ///< Tracker video frame capture -> pose filter update
+    PSMLatencyStage_FilterToSend,       ///< Pose filter update (sensor arrival for trackers) -> data frame sent
+    PSMLatencyStage_SendToReceive,      ///< Data frame sent -> data frame received by the client
+    PSMLatencyStage_ReceiveToConsume,   ///< Data frame received -> applied to the device view by PSM_Update()
+    PSMLatencyStage_Total,              ///< Earliest service timestamp -> applied to the device view
+    PSMLatencyStage_count
+} PSMLatencyStage;
+
+/// The timed stages of the service's device update loop (see \ref PSM_GetServicePerformanceStats)
+typedef enum
+{
+    PSMServiceStage_Tick,                   ///< The whole device update, shared by all devices
+    PSMServiceStage_DevicePoll,             ///< Reading a device's sensor packet or video frame
+    PSMServiceStage_OpticalPoseEstimation,  ///< Projecting a device on every tracker and triangulating its position
+    PSMServiceStage_FilterUpdate,           ///< Pose filter update and prediction
+    PSMServiceStage_Publish,                ///< Building the data frames of a device for its listening clients
+    PSMServiceStage_count
+} PSMServiceStage;
+
 /// The possible rumble channels available to the comtrollers
 typedef enum
 {
@@ -135,7 +184,8 @@ typedef enum
 typedef enum
 {
     PSMTracker_None= -1,
-    PSMTracker_PS3Eye
+    PSMTracker_PS3Eye,
+    PSMTracker_Virtual
 } PSMTrackerType;
 
 /// The list of possible HMD types tracked by PSMoveService
@@ -152,7 +202,8 @@ typedef enum
     PSMDriver_LIBUSB,
     PSMDriver_CL_EYE,
     PSMDriver_CL_EYE_MULTICAM,
-    PSMDriver_GENERIC_WEBCAM
+    PSMDriver_GENERIC_WEBCAM,
+    PSMDriver_VIRTUAL
 } PSMTrackerDriver;
 
 // Controller State
@@ -451,6 +502,17 @@ typedef struct
     void *opaque_shared_memory_accesor;
 } PSMTracker;
 
+/// A tracker video frame leased straight out of shared memory (see \ref PSM_AcquireTrackerVideoFrame)
+typedef struct
+{
+    const unsigned char *buffer; ///< BGR pixels, read-only, valid until the frame is released
+    int width;
+    int height;
+    int stride; ///< bytes per row
+    int frame_index; ///< increments by one for every frame the service writes
+    unsigned long long capture_timestamp_usec; ///< when the service received the frame, in microseconds on the host's steady clock
+} PSMTrackerVideoFrame;
+
 // HMD State
 //----------
 
@@ -515,6 +577,108 @@ typedef struct
     int             ListenerCount;
 } PSMHeadMountedDisplay;
 
+/// Latest pose of a controller or HMD, readable from any thread
+/// (see \ref PSM_GetControllerPoseSnapshot and \ref PSM_GetHmdPoseSnapshot)
+typedef struct
+{
+    PSMPosef        Pose;
+    PSMPhysicsData  PhysicsData;
+    bool            bIsOrientationValid;
+    bool            bIsPositionValid;
+    bool            bIsCurrentlyTracking;
+    int             OutputSequenceNum;        ///< Sequence number of the data frame the pose came from
+    unsigned long long ServerTimestampUsec;   ///< When the service last updated the pose (microseconds, service's steady clock)
+} PSMPoseSnapshot;
+
+/// State of every controller with valid data, as parallel arrays (see \ref PSM_GetAllControllerStates)
+/// Entry i of each array belongs to controller ControllerID[i]. Only the first Count entries are filled in.
+typedef struct
+{
+    int                 Version;        ///< Set to PSM_CONTROLLER_STATE_BLOCK_VERSION by the caller
+    int                 Count;          ///< Number of controllers written to the arrays
+    PSMControllerID     ControllerID[PSMOVESERVICE_MAX_CONTROLLER_COUNT];
+    PSMControllerType   ControllerType[PSMOVESERVICE_MAX_CONTROLLER_COUNT];
+    int                 OutputSequenceNum[PSMOVESERVICE_MAX_CONTROLLER_COUNT];
+    unsigned int        StateFlags[PSMOVESERVICE_MAX_CONTROLLER_COUNT];     ///< Bitmask of \ref PSMDeviceStateFlags
+    PSMPosef            Pose[PSMOVESERVICE_MAX_CONTROLLER_COUNT];
+    PSMPhysicsData      PhysicsData[PSMOVESERVICE_MAX_CONTROLLER_COUNT];
+    float               RumbleLeft[PSMOVESERVICE_MAX_CONTROLLER_COUNT];     ///< Rumble fraction of the left channel (the only channel on a PSMove)
+    float               RumbleRight[PSMOVESERVICE_MAX_CONTROLLER_COUNT];    ///< Rumble fraction of the right channel (the only channel on a PSMove)
+} PSMControllerStateBlock;
+
+/// State of every HMD with valid data, as parallel arrays (see \ref PSM_GetAllHmdStates)
+/// Entry i of each array belongs to HMD HmdID[i]. Only the first Count entries are filled in.
+typedef struct
+{
+    int                 Version;        ///< Set to PSM_HMD_STATE_BLOCK_VERSION by the caller
+    int                 Count;          ///< Number of HMDs written to the arrays
+    PSMHmdID            HmdID[PSMOVESERVICE_MAX_HMD_COUNT];
+    PSMHmdType          HmdType[PSMOVESERVICE_MAX_HMD_COUNT];
+    int                 OutputSequenceNum[PSMOVESERVICE_MAX_HMD_COUNT];
+    unsigned int        StateFlags[PSMOVESERVICE_MAX_HMD_COUNT];            ///< Bitmask of \ref PSMDeviceStateFlags
+    PSMPosef            Pose[PSMOVESERVICE_MAX_HMD_COUNT];
+    PSMPhysicsData      PhysicsData[PSMOVESERVICE_MAX_HMD_COUNT];
+} PSMHmdStateBlock;
+
+/// Overflow counters for the client's fixed capacity message storage (see \ref PSM_GetMessageQueueStats)
+typedef struct
+{
+    unsigned long long MessageOverflowCount;    ///< Messages dropped because the message queue was full
+    unsigned long long EventOverflowCount;      ///< Event copies that spilled onto the heap because the event pool was full
+    unsigned long long ResponseOverflowCount;   ///< Response copies that spilled onto the heap because the response pool was full
+} PSMMessageQueueStats;
+
+/// Distribution of the latency of one \ref PSMLatencyStage
+typedef struct
+{
+    unsigned long long SampleCount;
+    unsigned long long MinUsec;
+    unsigned long long MaxUsec;
+    unsigned long long TotalUsec;       ///< Divide by SampleCount for the mean
+    unsigned long long BucketCounts[PSM_LATENCY_HISTOGRAM_BUCKET_COUNT];   ///< See PSM_LATENCY_HISTOGRAM_FIRST_BUCKET_USEC
+} PSMLatencyHistogram;
+
+/// Latency of the data frames of one device (see \ref PSM_GetLatencyStats)
+typedef struct
+{
+    PSMLatencyHistogram Stages[PSMLatencyStage_count];
+    long long           ClockOffsetUsec;            ///< Client clock minus service clock
+    unsigned long long  ClockSyncRoundTripUsec;     ///< Round trip of the clock offset measurement, 0 if the clocks aren't synced yet
+} PSMLatencyStats;
+
+/// Timestamps of the last data frame applied to a device view, in microseconds on the client's clock (see \ref PSM_GetLatencyTimestamps)
+typedef struct
+{
+    unsigned long long  SensorArrivalUsec;      ///< Sensor packet arrival in the service, 0 if the stage doesn't apply
+    unsigned long long  OpticalCaptureUsec;     ///< Tracker video frame capture, 0 if no tracker saw the device
+    unsigned long long  FilterUpdateUsec;       ///< Pose filter update, 0 for trackers
+    unsigned long long  NetworkSendUsec;        ///< Data frame sent by the service
+    unsigned long long  ReceivedUsec;           ///< Data frame received by the client
+    unsigned long long  ConsumedUsec;           ///< Data frame applied to the device view by PSM_Update()
+    bool                bIsClockSynced;         ///< False until the clock offset is measured, the service timestamps are all 0 until then
+} PSMLatencyTimestamps;
+
+/// Duration histogram of one stage of the service's device update loop for one device
+typedef struct
+{
+    PSMServiceStage     Stage;
+    PSMDeviceCategory   DeviceCategory;     ///< Not meaningful for stages shared by all devices
+    int                 DeviceID;           ///< -1 for stages shared by all devices
+    unsigned long long  SampleCount;
+    long long           MinNsec;
+    long long           MaxNsec;
+    long long           TotalNsec;          ///< Divide by SampleCount for the mean
+    unsigned long long  BucketCounts[PSM_SERVICE_STAGE_HISTOGRAM_BUCKET_COUNT];    ///< See PSM_SERVICE_STAGE_HISTOGRAM_FIRST_BUCKET_NSEC
+} PSMServiceStageStats;
+
+/// Stage histograms of every device the service has timed (see \ref PSM_GetServicePerformanceStats)
+typedef struct
+{
+    int                     StageStatsCount;
+    unsigned int            WindowSampleCount;  ///< Each histogram covers the most recent 1 to 2 windows of samples
+    PSMServiceStageStats    StageStats[PSM_MAX_SERVICE_STAGE_STATS_COUNT];
+} PSMServicePerformanceStats;
+
 // Service Events
 //------------------
 
@@ -691,6 +855,25 @@ PSM_PUBLIC_FUNCTION(PSMResult) PSM_Shutdown();
  */
 PSM_PUBLIC_FUNCTION(PSMResult) PSM_InitializeAsync(const char* host, const char* port);
 
+/** \brief Initializes a connection to PSMoveService with the given options.
+ Same as \ref PSM_InitializeAsync() but takes a set of \ref PSMInitializeFlags.
+ 
+ With PSMInitializeFlags_useNetworkIOThread the client starts an internal thread that services the connection.
+ Data frames are received and decoded as soon as the service sends them, so the poses returned by 
+ \ref PSM_GetControllerPoseSnapshot() and \ref PSM_GetHmdPoseSnapshot() no longer depend on how often the 
+ application calls \ref PSM_Update(). Everything else is unchanged and still happens on the application's thread:
+  - Responses, callbacks and events are delivered by \ref PSM_Update() or \ref PSM_PollNextMessage()
+  - The device views (\ref PSM_GetController(), \ref PSM_GetTracker(), \ref PSM_GetHmd()) are brought up to date 
+    with the latest data frame of each device in \ref PSM_Update() / \ref PSM_UpdateNoPollMessages()
+ With PSMInitializeFlags_disableLocalSockets a client on the service's host connects over TCP/UDP 
+ rather than the service's local sockets, e.g. to measure the network path.
+ \param host The address that PSMoveService is running at, usually PSMOVESERVICE_DEFAULT_ADDRESS
+ \param port The port that PSMoveSerive is running at, usually PSMOVESERVICE_DEFAULT_PORT
+ \param initialize_flags One or more \ref PSMInitializeFlags
+ \returns PSMResult_RequestSent on success, PSMResult_Success if already connected, or PSMResult_Error on a general connection error.
+ */
+PSM_PUBLIC_FUNCTION(PSMResult) PSM_InitializeAsyncWithFlags(const char* host, const char* port, unsigned int initialize_flags);
+
 // Update
 /** \brief Poll the connection and process messages.
 	This function will poll the connection for new messages from PSMoveService.
@@ -723,6 +906,13 @@ PSM_PUBLIC_FUNCTION(PSMResult) PSM_UpdateNoPollMessages();
  */
 PSM_PUBLIC_FUNCTION(const char*) PSM_GetClientVersionString();
 
+/** \brief Get the current time on the client's clock
+	This is the clock the target time of \ref PSM_GetControllerPoseAtTime() and \ref PSM_GetHmdPoseAtTime() is measured on.
+	It's a monotonic clock (std::chrono::steady_clock) with an arbitrary epoch.
+	\return The current time in microseconds
+ */
+PSM_PUBLIC_FUNCTION(unsigned long long) PSM_GetClientTimeUsec();
+
 /** \brief Get the API initialization status
 	\return true if the client API is initialized
  */
@@ -792,6 +982,38 @@ PSM_PUBLIC_FUNCTION(bool) PSM_WasSystemButtonPressed();
  */
 PSM_PUBLIC_FUNCTION(PSMResult) PSM_GetServiceVersionString(char *out_version_string, size_t max_version_string, int timeout_ms);
 
+/** \brief Get the timing histograms of the stages of PSMoveService's device update loop
+	The service times polling, optical pose estimation, filtering and publishing of every device
+	(unless it was built without PSM_ENABLE_STAGE_TIMERS, in which case no stats are returned).
+	\remark Blocking - Returns after either the stats are returned OR the timeout period is reached. 
+	\param[out] out_stats The stage histograms that have samples in them
+	\param reset_stats If true the service empties its histograms after reporting them
+	\param timeout_ms The conection timeout period in milliseconds, usually PSM_DEFAULT_TIMEOUT
+	\return PSMResult_Success upon receiving result, PSMResult_Timeoout, or PSMResult_Error on request error.
+ */
+PSM_PUBLIC_FUNCTION(PSMResult) PSM_GetServicePerformanceStats(PSMServicePerformanceStats *out_stats, bool reset_stats, int timeout_ms);
+
+/** \brief Start or stop recording PSMoveService's timeline
+	While enabled the service records its update loop, vision, filter, USB and network work into a ring
+	that \ref PSM_DumpServiceTrace writes out. The service can also be started with --trace to record from startup.
+	\remark Blocking - Returns after either the service acknowledges the request OR the timeout period is reached. 
+	\param enabled True to start recording, false to stop
+	\param timeout_ms The conection timeout period in milliseconds, usually PSM_DEFAULT_TIMEOUT
+	\return PSMResult_Success upon receiving result, PSMResult_Timeoout, or PSMResult_Error on request error.
+ */
+PSM_PUBLIC_FUNCTION(PSMResult) PSM_SetServiceTracingEnabled(bool enabled, int timeout_ms);
+
+/** \brief Have PSMoveService write the last few seconds of its timeline to a file as Chrome trace JSON
+	The service writes a new file in the traces folder of its config directory, on the service's machine.
+	Open it in chrome://tracing or ui.perfetto.dev.
+	\remark Blocking - Returns after either the trace is written OR the timeout period is reached. 
+	\param[out] out_filename The file the service wrote to (can be NULL)
+	\param max_filename_size The size of the output buffer
+	\param timeout_ms The conection timeout period in milliseconds, usually PSM_DEFAULT_TIMEOUT
+	\return PSMResult_Success upon receiving result, PSMResult_Timeoout, or PSMResult_Error on request error.
+ */
+PSM_PUBLIC_FUNCTION(PSMResult) PSM_DumpServiceTrace(char *out_filename, size_t max_filename_size, int timeout_ms);
+
 // System Async Queries
 /** \brief Get the client API version string from PSMoveService
 	Sends a request to PSMoveService to get the protocol version.
@@ -817,6 +1039,43 @@ PSM_PUBLIC_FUNCTION(PSMResult) PSM_GetServiceVersionStringAsync(PSMRequestID *ou
  */
 PSM_PUBLIC_FUNCTION(PSMResult) PSM_PollNextMessage(PSMMessage *out_message, size_t message_size);
 
+/** \brief Get the overflow counters of the message queue.
+	Messages, events and responses are stored in fixed capacity buffers that are reused every \ref PSM_Update(),
+	so receiving them doesn't allocate memory. If more arrive between two updates than the buffers hold
+	the excess is dropped (or delivered without its opaque handle) and counted here.
+	\param[out] out_stats The overflow counters accumulated since the client was initialized
+	\return PSMResult_Success or PSMResult_Error if the client isn't initialized
+ */
+PSM_PUBLIC_FUNCTION(PSMResult) PSM_GetMessageQueueStats(PSMMessageQueueStats *out_stats);
+
+/** \brief Get the latency histograms of a device's data frames.
+	The service stamps every data frame with the times of sensor arrival, optical capture, filter update and network send.
+	The client adds the times it received and applied the frame, and maps the service's timestamps onto its own clock
+	with a clock offset measured over the TCP connection about once a second.
+	Stages that need the clock offset (SendToReceive and Total) have no samples until the first measurement.
+	\param device_category The kind of device
+	\param device_id The controller, tracker or HMD id
+	\param[out] out_stats The histograms accumulated since the client was initialized or \ref PSM_ResetLatencyStats was called
+	\return PSMResult_Success or PSMResult_Error if the client isn't initialized or the device id is invalid
+ */
+PSM_PUBLIC_FUNCTION(PSMResult) PSM_GetLatencyStats(PSMDeviceCategory device_category, int device_id, PSMLatencyStats *out_stats);
+
+/** \brief Clear the latency histograms of every device.
+	\return PSMResult_Success or PSMResult_Error if the client isn't initialized
+ */
+PSM_PUBLIC_FUNCTION(PSMResult) PSM_ResetLatencyStats();
+
+/** \brief Get the timestamps of the last data frame applied to a device view.
+	Unlike \ref PSM_GetLatencyStats this gives the individual samples, 
+	e.g. to measure the latency from a frame's input to the moment the application reads the pose.
+	The service's timestamps are mapped onto the client clock (see \ref PSM_GetClientTimeUsec()).
+	\param device_category The kind of device
+	\param device_id The controller, tracker or HMD id
+	\param[out] out_timestamps The timestamps of the frame returned by the last \ref PSM_Update(), all 0 before the first frame
+	\return PSMResult_Success or PSMResult_Error if the client isn't initialized or the device id is invalid
+ */
+PSM_PUBLIC_FUNCTION(PSMResult) PSM_GetLatencyTimestamps(PSMDeviceCategory device_category, int device_id, PSMLatencyTimestamps *out_timestamps);
+
 /** \brief Sends a private protocol request to PSMoveService.
 	If the client has linked against the PSMoveProtocol.lib and defined the HAS_PROTOCOL_ACCESS symbol then you can 
 	construct a private message declared in PSMoveProtocol.pb.h. These messages are defined in the Google protobuf 
@@ -985,6 +1244,41 @@ PSM_PUBLIC_FUNCTION(PSMResult) PSM_GetControllerPosition(PSMControllerID control
  */
 PSM_PUBLIC_FUNCTION(PSMResult) PSM_GetControllerPose(PSMControllerID controller_id, PSMPosef *out_pose);
 
+/** \brief Get the most recently received pose of a controller from any thread
+	Unlike the rest of the client API this can be called from any thread (e.g. a render thread
+	late-latching the pose right before submitting a frame) while another thread calls \ref PSM_Update.
+	The snapshot is updated as soon as a controller data frame is received.
+	\param controller_id The id of the controller
+	\param[out] out_snapshot The pose, sequence number and service timestamp of the controller
+	\return PSMResult_Success if a pose has been received, PSMResult_NoData if not
+ */
+PSM_PUBLIC_FUNCTION(PSMResult) PSM_GetControllerPoseSnapshot(PSMControllerID controller_id, PSMPoseSnapshot *out_snapshot);
+
+/** \brief Get the state of every controller in one call
+	Fills in the pose, physics, tracking flags and rumble of every controller that has received data,
+	which saves a call per controller per value (and an interop transition each, for managed bindings).
+	The values are the same ones returned by \ref PSM_GetControllerPose(), \ref PSM_GetIsControllerTracking(), 
+	\ref PSM_GetIsControllerStable() and \ref PSM_GetControllerRumble(), as of the last \ref PSM_Update().
+	\param[in,out] out_state_block Version must be set to PSM_CONTROLLER_STATE_BLOCK_VERSION, everything else is written
+	\param max_count The max number of controllers to write (at most PSMOVESERVICE_MAX_CONTROLLER_COUNT)
+	\return PSMResult_Success, or PSMResult_Error if the client isn't initialized, the block is null or its version doesn't match
+ */
+PSM_PUBLIC_FUNCTION(PSMResult) PSM_GetAllControllerStates(PSMControllerStateBlock *out_state_block, int max_count);
+
+/** \brief Get the pose of a controller extrapolated to the given time (e.g. the predicted display time of a frame)
+	The most recently received pose is moved forward using the streamed velocity and acceleration 
+	(the data stream needs PSMStreamFlags_includePhysicsData for this, otherwise the last pose is returned as is).
+	The service's filter timestamps are mapped onto the client's clock with the clock offset the latency telemetry uses
+	(see \ref PSMLatencyStats), until the first measurement the last pose is returned as is.
+	Extrapolation is limited to PSM_MAX_POSE_EXTRAPOLATION_USEC past the last pose and never goes backwards in time.
+	Like \ref PSM_GetControllerPoseSnapshot this can be called from any thread.
+	\param controller_id The id of the controller
+	\param target_time_usec The time to extrapolate the pose to on the client's clock, see \ref PSM_GetClientTimeUsec()
+	\param[out] out_pose The extrapolated pose of the controller
+	\return PSMResult_Success if a pose has been received, PSMResult_NoData if not
+ */
+PSM_PUBLIC_FUNCTION(PSMResult) PSM_GetControllerPoseAtTime(PSMControllerID controller_id, unsigned long long target_time_usec, PSMPosef *out_pose);
+
 /** \brief Get the current rumble fraction of a controller
 	\param controller_id The id of the controller
 	\param channel The channel to get the rumble for. The PSMove has one channel. The DualShock4 has two.
@@ -1107,6 +1401,29 @@ PSM_PUBLIC_FUNCTION(PSMResult) PSM_GetControllerListAsync(PSMRequestID *out_requ
  */
 PSM_PUBLIC_FUNCTION(PSMResult) PSM_StartControllerDataStreamAsync(PSMControllerID controller_id, unsigned int data_stream_flags, PSMRequestID *out_request_id);
 
+/** \brief Requests start of a rate limited unreliable(udp) data stream for a given controller
+	Same as \ref PSM_StartControllerDataStream, but PSMoveService will publish at most max_rate_hz
+	data frames per second on this stream. Frames are decimated on a fixed cadence so the 
+	effective rate does not drift below the requested rate.
+	\remark Blocking - Returns after either stream start response comes back OR the timeout period is reached. 
+	\param controller_id The id of the controller to start the stream for.
+	\param data_stream_flags See \ref PSM_StartControllerDataStream
+	\param max_rate_hz The maximum publish rate in Hz. A value <= 0 means publish every controller update.
+	\param timeout_ms The conection timeout period in milliseconds, usually PSM_DEFAULT_TIMEOUT
+	\return PSMResult_Success upon receiving result, PSMResult_Timeoout, or PSMResult_Error on request error.
+ */
+PSM_PUBLIC_FUNCTION(PSMResult) PSM_StartControllerDataStreamAtRate(PSMControllerID controller_id, unsigned int data_stream_flags, float max_rate_hz, int timeout_ms);
+
+/** \brief Requests start of a rate limited unreliable(udp) data stream for a given controller
+	Async version of \ref PSM_StartControllerDataStreamAtRate.
+	\param controller_id The controller id we wish to start the stream for
+	\param data_stream_flags See \ref PSM_StartControllerDataStream
+	\param max_rate_hz The maximum publish rate in Hz. A value <= 0 means publish every controller update.
+	\param[out] out_request_id The id of the request sent to PSMoveService. Can be used to register callback with \ref PSM_RegisterCallback.
+	\return PSMResult_RequestSent on success or PSMResult_Error if there was no valid connection
+ */
+PSM_PUBLIC_FUNCTION(PSMResult) PSM_StartControllerDataStreamAtRateAsync(PSMControllerID controller_id, unsigned int data_stream_flags, float max_rate_hz, PSMRequestID *out_request_id);
+
 /** \brief Requests stop of an unreliable(udp) data stream for a given controller
 	Asks PSMoveService to stop stream data for the given controller.
 	\remark Async - Starts a request for version string. Result obtained in one of two ways:
@@ -1276,6 +1593,38 @@ PSM_PUBLIC_FUNCTION(PSMResult) PSM_CloseTrackerVideoStream(PSMTrackerID tracker_
  */
 PSM_PUBLIC_FUNCTION(PSMResult) PSM_GetTrackerVideoFrameBuffer(PSMTrackerID tracker_id, const unsigned char **out_buffer); 
 
+/** \brief Lease the newest video frame from an opened tracker video stream without copying it
+	Pins the shared memory slot holding the newest video frame and returns a pointer straight into it.
+	PSMoveService won't overwrite the slot until it is released with \ref PSM_ReleaseTrackerVideoFrame,
+	so release each frame as soon as you're done with it. Only one frame per tracker can be leased at a time.
+	A lease held for more than a second is assumed to belong to a crashed client and the slot is taken back.
+	\param tracker_id The tracker to lease the newest video frame from
+	\param[out] out_frame The leased video frame buffer, frame index and capture timestamp
+	\return PSMResult_Success if a frame was leased, PSMResult_NoData if there is no frame newer than the last one leased,
+	 or PSMResult_Error if the stream isn't open or the previous frame wasn't released
+ */
+PSM_PUBLIC_FUNCTION(PSMResult) PSM_AcquireTrackerVideoFrame(PSMTrackerID tracker_id, PSMTrackerVideoFrame *out_frame);
+
+/** \brief Release a video frame leased with \ref PSM_AcquireTrackerVideoFrame
+	The frame buffer pointer must not be used after this call.
+	\param tracker_id The tracker the video frame was leased from
+	\return PSMResult_Success if a leased frame was released, PSMResult_Error if no frame was leased
+	 or the lease expired (the frame may have been overwritten while it was in use)
+ */
+PSM_PUBLIC_FUNCTION(PSMResult) PSM_ReleaseTrackerVideoFrame(PSMTrackerID tracker_id);
+
+/** \brief Block until a new video frame is published on an opened tracker video stream
+	Sleeps (without polling) until PSMoveService publishes a frame newer than the last one read with
+	\ref PSM_PollTrackerVideoStream or leased with \ref PSM_AcquireTrackerVideoFrame.
+	Returns immediately if such a frame is already available.
+	Meant for dedicated preview/recording threads: call it from the thread that reads the frames,
+	and don't close the video stream while a wait is in progress.
+	\param tracker_id The tracker to wait on
+	\param timeout_ms The longest time to wait in milliseconds
+	\return PSMResult_Success if a new frame is available, PSMResult_Timeout, or PSMResult_Error if the stream isn't open
+ */
+PSM_PUBLIC_FUNCTION(PSMResult) PSM_WaitTrackerVideoFrame(PSMTrackerID tracker_id, int timeout_ms);
+
 /** \brief Helper function to fetch tracking frustum properties from a tracker
 	\param The id of the tracker we wish to get the tracking frustum properties for
 	\param out_frustum The tracking frustum properties to write the result into
@@ -1310,6 +1659,26 @@ PSM_PUBLIC_FUNCTION(PSMResult) PSM_GetTrackerFrustum(PSMTrackerID tracker_id, PS
  */
 PSM_PUBLIC_FUNCTION(PSMResult) PSM_StartTrackerDataStreamAsync(PSMTrackerID tracker_id, PSMRequestID *out_request_id);
 
+/** \brief Requests start of a rate limited shared memory video stream for a given tracker
+	Same as \ref PSM_StartTrackerDataStream, but PSMoveService will send at most max_rate_hz
+	tracker data frames per second to this client.
+	\remark Blocking - Returns after either stream start response comes back OR the timeout period is reached. 
+	\param tracker_id The id of the tracker to start the stream for.
+	\param max_rate_hz The maximum publish rate in Hz. A value <= 0 means publish every tracker update.
+	\param timeout_ms The conection timeout period in milliseconds, usually PSM_DEFAULT_TIMEOUT
+	\return PSMResult_Success upon receiving result, PSMResult_Timeoout, or PSMResult_Error on request error.
+ */
+PSM_PUBLIC_FUNCTION(PSMResult) PSM_StartTrackerDataStreamAtRate(PSMTrackerID tracker_id, float max_rate_hz, int timeout_ms);
+
+/** \brief Requests start of a rate limited shared memory video stream for a given tracker
+	Async version of \ref PSM_StartTrackerDataStreamAtRate.
+	\param tracker_id The tracker id we wish to start the stream for
+	\param max_rate_hz The maximum publish rate in Hz. A value <= 0 means publish every tracker update.
+	\param[out] out_request_id The id of the request sent to PSMoveService. Can be used to register callback with \ref PSM_RegisterCallback.
+	\return PSMResult_RequestSent on success or PSMResult_Error if there was no valid connection
+ */
+PSM_PUBLIC_FUNCTION(PSMResult) PSM_StartTrackerDataStreamAtRateAsync(PSMTrackerID tracker_id, float max_rate_hz, PSMRequestID *out_request_id);
+
 /** \brief Requests stop shared memory video stream for a given tracker
 	Asks PSMoveService to stop video data for the given tracker.
 	\remark Async - Result obtained in one of two ways:
@@ -1383,6 +1752,40 @@ PSM_PUBLIC_FUNCTION(PSMResult) PSM_GetHmdPosition(PSMHmdID hmd_id, PSMVector3f *
  */
 PSM_PUBLIC_FUNCTION(PSMResult) PSM_GetHmdPose(PSMHmdID hmd_id, PSMPosef *out_pose);
 
+/** \brief Get the most recently received pose of an HMD from any thread
+	Unlike the rest of the client API this can be called from any thread (e.g. a render thread
+	late-latching the pose right before submitting a frame) while another thread calls \ref PSM_Update.
+	The snapshot is updated as soon as an HMD data frame is received.
+	\param hmd_id The id of the HMD
+	\param[out] out_snapshot The pose, sequence number and service timestamp of the HMD
+	\return PSMResult_Success if a pose has been received, PSMResult_NoData if not
+ */
+PSM_PUBLIC_FUNCTION(PSMResult) PSM_GetHmdPoseSnapshot(PSMHmdID hmd_id, PSMPoseSnapshot *out_snapshot);
+
+/** \brief Get the state of every HMD in one call
+	Fills in the pose, physics and tracking flags of every HMD that has received data.
+	The values are the same ones returned by \ref PSM_GetHmdPose(), \ref PSM_GetIsHmdTracking() 
+	and \ref PSM_GetIsHmdStable(), as of the last \ref PSM_Update().
+	\param[in,out] out_state_block Version must be set to PSM_HMD_STATE_BLOCK_VERSION, everything else is written
+	\param max_count The max number of HMDs to write (at most PSMOVESERVICE_MAX_HMD_COUNT)
+	\return PSMResult_Success, or PSMResult_Error if the client isn't initialized, the block is null or its version doesn't match
+ */
+PSM_PUBLIC_FUNCTION(PSMResult) PSM_GetAllHmdStates(PSMHmdStateBlock *out_state_block, int max_count);
+
+/** \brief Get the pose of an HMD extrapolated to the given time (e.g. the predicted display time of a frame)
+	The most recently received pose is moved forward using the streamed velocity and acceleration 
+	(the data stream needs PSMStreamFlags_includePhysicsData for this, otherwise the last pose is returned as is).
+	The service's filter timestamps are mapped onto the client's clock with the clock offset the latency telemetry uses
+	(see \ref PSMLatencyStats), until the first measurement the last pose is returned as is.
+	Extrapolation is limited to PSM_MAX_POSE_EXTRAPOLATION_USEC past the last pose and never goes backwards in time.
+	Like \ref PSM_GetHmdPoseSnapshot this can be called from any thread.
+	\param hmd_id The id of the HMD
+	\param target_time_usec The time to extrapolate the pose to on the client's clock, see \ref PSM_GetClientTimeUsec()
+	\param[out] out_pose The extrapolated pose of the HMD
+	\return PSMResult_Success if a pose has been received, PSMResult_NoData if not
+ */
+PSM_PUBLIC_FUNCTION(PSMResult) PSM_GetHmdPoseAtTime(PSMHmdID hmd_id, unsigned long long target_time_usec, PSMPosef *out_pose);
+
 /** \brief Helper used to tell if the HMD is upright on a level surface.
 	This method is used as a calibration helper when you want to get a number of HMD samples. 
 	Often in this instance you want to make sure the HMD is sitting upright on a table.
@@ -1525,6 +1928,28 @@ PSM_PUBLIC_FUNCTION(PSMResult) PSM_GetHmdListAsync(PSMRequestID *out_request_id)
  */
 PSM_PUBLIC_FUNCTION(PSMResult) PSM_StartHmdDataStreamAsync(PSMHmdID hmd_id, unsigned int data_stream_flags, PSMRequestID *out_request_id);
 
+/** \brief Requests start of a rate limited unreliable(udp) data stream for a given HMD
+	Same as \ref PSM_StartHmdDataStream, but PSMoveService will publish at most max_rate_hz
+	data frames per second on this stream.
+	\remark Blocking - Returns after either stream start response comes back OR the timeout period is reached. 
+	\param hmd_id The id of the head mounted display to start the stream for.
+	\param data_stream_flags See \ref PSM_StartHmdDataStream
+	\param max_rate_hz The maximum publish rate in Hz. A value <= 0 means publish every HMD update.
+	\param timeout_ms The conection timeout period in milliseconds, usually PSM_DEFAULT_TIMEOUT
+	\return PSMResult_Success upon receiving result, PSMResult_Timeoout, or PSMResult_Error on request error.
+ */
+PSM_PUBLIC_FUNCTION(PSMResult) PSM_StartHmdDataStreamAtRate(PSMHmdID hmd_id, unsigned int data_stream_flags, float max_rate_hz, int timeout_ms);
+
+/** \brief Requests start of a rate limited unreliable(udp) data stream for a given HMD
+	Async version of \ref PSM_StartHmdDataStreamAtRate.
+	\param hmd_id The id of the head mounted display to start the stream for.
+	\param data_stream_flags See \ref PSM_StartHmdDataStream
+	\param max_rate_hz The maximum publish rate in Hz. A value <= 0 means publish every HMD update.
+	\param[out] out_request_id The id of the request sent to PSMoveService. Can be used to register callback with \ref PSM_RegisterCallback.
+	\return PSMResult_RequestSent if request successfully sent or PSMResult_Error if connection is invalid.
+ */
+PSM_PUBLIC_FUNCTION(PSMResult) PSM_StartHmdDataStreamAtRateAsync(PSMHmdID hmd_id, unsigned int data_stream_flags, float max_rate_hz, PSMRequestID *out_request_id);
+
 /** \brief Requests stop of an unreliable(udp) data stream for a given HMD
 	Asks PSMoveService to stop stream data for the given HMD.
 	\remark Async - Sends a request for HMD stream stop. Result obtained in one of two ways:
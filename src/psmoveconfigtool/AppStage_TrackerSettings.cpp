@@ -65,6 +65,7 @@ void AppStage_TrackerSettings::render()
             switch (trackerInfo.tracker_type)
             {
             case PSMoveProtocol::PS3EYE:
+            case PSMoveProtocol::VIRTUAL_TRACKER:
                 {
                     glm::mat4 scale3 = glm::scale(glm::mat4(1.f), glm::vec3(3.f, 3.f, 3.f));
                     drawPS3EyeModel(scale3);
@@ -233,6 +234,10 @@ void AppStage_TrackerSettings::renderUI()
                 {
                     ImGui::BulletText("Controller Type: PS3 Eye");
                 } break;
+            case PSMTracker_Virtual:
+                {
+                    ImGui::BulletText("Controller Type: Virtual");
+                } break;
             default:
                 assert(0 && "Unreachable");
             }
@@ -255,6 +260,10 @@ void AppStage_TrackerSettings::renderUI()
                 {
                     ImGui::BulletText("Controller Type: Generic Webcam");
                 } break;
+            case PSMDriver_VIRTUAL:
+                {
+                    ImGui::BulletText("Controller Type: Virtual");
+                } break;
             default:
                 assert(0 && "Unreachable");
             }
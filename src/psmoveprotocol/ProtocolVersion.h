@@ -22,12 +22,13 @@
 #endif
 
 // Version of the release that the protocol comes from (<= current release)
+// 8.7.1 added GET_SERVICE_TIME and moved the data frame server timestamps to the service's steady clock
 #define PSM_PROTOCOL_VERSION_PRODUCT 0
 #define PSM_PROTOCOL_VERSION_MAJOR   9
 #define PSM_PROTOCOL_VERSION_PHASE   alpha
 #define PSM_PROTOCOL_VERSION_MINOR   8
 #define PSM_PROTOCOL_VERSION_RELEASE 7
-#define PSM_PROTOCOL_VERSION_HOTFIX  0
+#define PSM_PROTOCOL_VERSION_HOTFIX  1
 
 /// "Product.Major-Phase Minor.Release.Hotfix"
 #if !defined(PSM_PROTOCOL_VERSION_STRING)
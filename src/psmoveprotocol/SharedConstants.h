@@ -4,6 +4,13 @@
 #define PSMOVESERVICE_DEFAULT_ADDRESS   "localhost"
 #define PSMOVESERVICE_DEFAULT_PORT      "9512"
 
+// Unix domain sockets used instead of TCP/UDP by clients on the same host (where supported).
+// The service port goes between the prefix and the suffix (e.g. "/tmp/psmoveservice-9512.sock"),
+// so a client only ever finds the local sockets of the service on the port it asked for.
+#define PSMOVESERVICE_LOCAL_SOCKET_PATH_PREFIX      "/tmp/psmoveservice-"
+#define PSMOVESERVICE_LOCAL_STREAM_SOCKET_SUFFIX    ".sock"
+#define PSMOVESERVICE_LOCAL_DATAGRAM_SOCKET_SUFFIX  ".dgram"
+
 #define MAX_OUTPUT_DATA_FRAME_MESSAGE_SIZE 500
 #define MAX_INPUT_DATA_FRAME_MESSAGE_SIZE 64
 
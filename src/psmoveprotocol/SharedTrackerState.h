@@ -5,39 +5,450 @@
 #define BOOST_INTERPROCESS_SHARED_DIR_PATH "shared_mem"
 #endif // WIN32
 
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <cstddef>
+#include <boost/cstdint.hpp>
+
+// Readers block on new frames with a futex on the frame publish counter where available.
+// Elsewhere they fall back to an interprocess condition variable the service only ever try-locks.
+#if defined(__linux__)
+#define SHARED_VIDEO_FRAME_USE_FUTEX 1
+#include <climits>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#define SHARED_VIDEO_FRAME_USE_FUTEX 0
+#include <boost/interprocess/sync/interprocess_condition.hpp>
 #include <boost/interprocess/sync/interprocess_mutex.hpp>
+#include <boost/interprocess/sync/scoped_lock.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#endif
+
+// Identifies the layout of the shared video frame memory.
+// Bump the version whenever SharedVideoFrameHeader changes so mismatched clients are rejected.
+#define SHARED_VIDEO_FRAME_MAGIC            0x50534D56 // 'PSMV'
+#define SHARED_VIDEO_FRAME_VERSION          5
+
+// The layout version is part of the shared memory name, so a binary built against another layout
+// never even opens the segment (binaries from before the magic word can't check the header).
+// The service appends the tracker id.
+#define SHARED_VIDEO_FRAME_STRINGIZE_INNER(x) #x
+#define SHARED_VIDEO_FRAME_STRINGIZE(x) SHARED_VIDEO_FRAME_STRINGIZE_INNER(x)
+#define SHARED_VIDEO_FRAME_NAME_PREFIX      "tracker_view_v" SHARED_VIDEO_FRAME_STRINGIZE(SHARED_VIDEO_FRAME_VERSION) "_"
+
+// Number of video frame buffers the service cycles through.
+// Besides the published slot, one slot can be leased by readers while
+// the service still has a free slot to write the next frame into.
+#define SHARED_VIDEO_FRAME_SLOT_COUNT       4
+
+// A lease held longer than this is taken to belong to a reader that died without releasing it,
+// so the service takes the slot back
+#define SHARED_VIDEO_FRAME_LEASE_TIMEOUT_MS 1000
+
+// Number of times a reader retries when the service overwrote the slot it was reading
+#define SHARED_VIDEO_FRAME_MAX_READ_ATTEMPTS 4
 
+// Without a futex a waiter can miss a wake up (the service won't wait for the condition mutex),
+// so it re-checks for a new frame at least this often
+#define SHARED_VIDEO_FRAME_MAX_WAIT_SLICE_MS 5
+
+/// State of one video frame buffer in the shared memory.
+/// The sequence number is odd while the service is writing the slot,
+/// so a reader can tell if the frame it copied was modified underneath it.
+/// The service never writes into a slot while its lease count is non-zero,
+/// unless the newest lease is older than SHARED_VIDEO_FRAME_LEASE_TIMEOUT_MS.
+/// Taking the slot back bumps the lease epoch, which voids the leases handed out before.
+struct SharedVideoFrameSlot
+{
+    std::atomic<boost::uint32_t> sequence;
+    // Lease epoch in the high 32 bits, lease count in the low 32 bits
+    std::atomic<boost::uint64_t> lease_state;
+    // Microseconds on the host's steady clock when the newest lease was taken
+    std::atomic<boost::uint64_t> lease_timestamp_usec;
+    std::atomic<int> frame_index;
+    // Microseconds on the host's steady clock, see SharedVideoFrameHeader::getTimestampUsec()
+    std::atomic<boost::uint64_t> capture_timestamp_usec;
+};
+
+/// Header at the start of the shared video frame memory.
+/// The service (single writer) writes each new video frame into the slot after the last published one
+/// and then publishes that slot. It never waits on a reader.
+/// Readers (any number, any process) copy out the published slot and then verify that slot
+/// wasn't rewritten during the copy, retrying on the newly published slot if it was.
+/// Readers can instead lease the published slot, which pins it so it can be read in place.
+/// Readers can block until a new frame is published with waitForVideoFrame().
+/// The video buffers for each slot are stored past the end of the header.
 class SharedVideoFrameHeader
 {
 public:
-    SharedVideoFrameHeader()
-        : mutex()
-        , width(0)
-        , height(0)
-        , stride(0)
-        , frame_index(0)
+    SharedVideoFrameHeader(int _width, int _height, int _stride)
+        : magic(SHARED_VIDEO_FRAME_MAGIC)
+        , version(SHARED_VIDEO_FRAME_VERSION)
+        , header_size(sizeof(SharedVideoFrameHeader))
+        , slot_count(SHARED_VIDEO_FRAME_SLOT_COUNT)
+        , width(_width)
+        , height(_height)
+        , stride(_stride)
+        , published_slot_index(-1)
+        , last_frame_index(0)
+        , publish_count(0)
+        , waiter_count(0)
     {
+        for (int slot_index = 0; slot_index < SHARED_VIDEO_FRAME_SLOT_COUNT; ++slot_index)
+        {
+            slots[slot_index].sequence.store(0, std::memory_order_relaxed);
+            slots[slot_index].lease_state.store(0, std::memory_order_relaxed);
+            slots[slot_index].lease_timestamp_usec.store(0, std::memory_order_relaxed);
+            slots[slot_index].frame_index.store(0, std::memory_order_relaxed);
+            slots[slot_index].capture_timestamp_usec.store(0, std::memory_order_relaxed);
+        }
     }
-    
-    //Mutex to protect access to the shared memory
-    boost::interprocess::interprocess_mutex mutex;
+
+    // Layout identification (never moves between versions)
+    boost::uint32_t magic;
+    boost::uint32_t version;
+    boost::uint32_t header_size;
+    boost::uint32_t slot_count;
 
     int width;
     int height;
     int stride;
-    int frame_index;
-    // Buffer stored past the end of the header
 
-    const unsigned char *getBuffer() const
+    // Index of the slot holding the most recently written frame (-1 before the first frame)
+    std::atomic<int> published_slot_index;
+    // Writer only: frame index of the last written frame
+    int last_frame_index;
+
+    SharedVideoFrameSlot slots[SHARED_VIDEO_FRAME_SLOT_COUNT];
+
+    // Bumped after every published frame. Waiters sleep on this (it's the futex word on linux).
+    std::atomic<boost::uint32_t> publish_count;
+    // Number of readers currently blocked in waitForVideoFrame(). The service skips the wake up when zero.
+    std::atomic<boost::uint32_t> waiter_count;
+
+#if !SHARED_VIDEO_FRAME_USE_FUTEX
+    boost::interprocess::interprocess_mutex wait_mutex;
+    boost::interprocess::interprocess_condition wait_condition;
+#endif
+
+    /// Returns true if a reader built against this header can read the shared memory
+    bool isCompatible(size_t mapped_size) const
+    {
+        return
+            mapped_size >= sizeof(SharedVideoFrameHeader) &&
+            magic == SHARED_VIDEO_FRAME_MAGIC &&
+            version == SHARED_VIDEO_FRAME_VERSION &&
+            header_size == sizeof(SharedVideoFrameHeader) &&
+            slot_count == SHARED_VIDEO_FRAME_SLOT_COUNT &&
+            mapped_size >= computeTotalSize(stride, height);
+    }
+
+    const unsigned char *getSlotBuffer(int slot_index) const
     {
-        return reinterpret_cast<const unsigned char *>(this) + sizeof(SharedVideoFrameHeader);
+        return
+            reinterpret_cast<const unsigned char *>(this) +
+            sizeof(SharedVideoFrameHeader) +
+            slot_index*computeVideoBufferSize(stride, height);
     }
 
-    unsigned char *getBufferMutable()
+    unsigned char *getSlotBufferMutable(int slot_index)
     {
-        return const_cast<unsigned char *>(getBuffer());
+        return const_cast<unsigned char *>(getSlotBuffer(slot_index));
     }
 
+    /// Service side: copy a new video frame into shared memory. Never blocks.
+    /// Returns false if the frame was dropped because every other slot is leased.
+    bool writeVideoFrame(const unsigned char *buffer, boost::uint64_t capture_timestamp_usec)
+    {
+        // Write into a slot after the published one so readers of the published frame are left alone
+        const int published_index = published_slot_index.load(std::memory_order_relaxed);
+
+        for (int offset = 1; offset < SHARED_VIDEO_FRAME_SLOT_COUNT; ++offset)
+        {
+            const int slot_index = (published_index + offset + SHARED_VIDEO_FRAME_SLOT_COUNT) % SHARED_VIDEO_FRAME_SLOT_COUNT;
+            SharedVideoFrameSlot &slot = slots[slot_index];
+            const boost::uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+
+            // Mark the slot as being written, then make sure nobody leased it before they could see that.
+            // (Pairs with the lease count increment / sequence load in leaseVideoFrame())
+            slot.sequence.store(sequence + 1, std::memory_order_seq_cst);
+            if (!reclaimExpiredLease(slot))
+            {
+                // Leased: leave the slot as it was and try the next one
+                slot.sequence.store(sequence, std::memory_order_release);
+                continue;
+            }
+
+            std::atomic_thread_fence(std::memory_order_release);
+
+            std::memcpy(getSlotBufferMutable(slot_index), buffer, computeVideoBufferSize(stride, height));
+
+            ++last_frame_index;
+            slot.frame_index.store(last_frame_index, std::memory_order_relaxed);
+            slot.capture_timestamp_usec.store(capture_timestamp_usec, std::memory_order_relaxed);
+
+            // Mark the slot as complete and then publish it
+            slot.sequence.store(sequence + 2, std::memory_order_release);
+            published_slot_index.store(slot_index, std::memory_order_release);
+
+            notifyVideoFrameWaiters();
+
+            return true;
+        }
+
+        return false;
+    }
+
+    /// Client side: pin the most recently published slot so it can be read in place.
+    /// Returns the leased slot index, or -1 if nothing has been published yet
+    /// (or the newest frame is last_read_frame_index). Every lease must be given back with releaseVideoFrame(),
+    /// passing back out_lease_epoch, within SHARED_VIDEO_FRAME_LEASE_TIMEOUT_MS.
+    int leaseVideoFrame(int last_read_frame_index, boost::uint32_t &out_lease_epoch)
+    {
+        for (int attempt = 0; attempt < SHARED_VIDEO_FRAME_MAX_READ_ATTEMPTS; ++attempt)
+        {
+            const int slot_index = published_slot_index.load(std::memory_order_acquire);
+
+            if (slot_index < 0 || slot_index >= SHARED_VIDEO_FRAME_SLOT_COUNT)
+            {
+                return -1;
+            }
+
+            SharedVideoFrameSlot &slot = slots[slot_index];
+
+            // Stamped before the count goes up, so the service never sees the new lease with an older stamp
+            slot.lease_timestamp_usec.store(getTimestampUsec(std::chrono::steady_clock::now()), std::memory_order_relaxed);
+
+            const boost::uint32_t lease_epoch = 
+                static_cast<boost::uint32_t>(slot.lease_state.fetch_add(1, std::memory_order_seq_cst) >> 32);
+            if ((slot.sequence.load(std::memory_order_seq_cst) & 1) != 0)
+            {
+                // The service is writing this slot. It will publish it (or another) shortly.
+                releaseVideoFrame(slot_index, lease_epoch);
+                continue;
+            }
+
+            if (slot.frame_index.load(std::memory_order_relaxed) == last_read_frame_index)
+            {
+                // Already have this frame
+                releaseVideoFrame(slot_index, lease_epoch);
+                return -1;
+            }
+
+            out_lease_epoch = lease_epoch;
+            return slot_index;
+        }
+
+        return -1;
+    }
+
+    /// Client side: unpin a slot returned by leaseVideoFrame().
+    /// Returns false if the service took the slot back because the lease expired,
+    /// in which case the frame may have been overwritten while it was leased.
+    bool releaseVideoFrame(int slot_index, boost::uint32_t lease_epoch)
+    {
+        SharedVideoFrameSlot &slot = slots[slot_index];
+        boost::uint64_t state = slot.lease_state.load(std::memory_order_relaxed);
+
+        while (static_cast<boost::uint32_t>(state >> 32) == lease_epoch)
+        {
+            if (slot.lease_state.compare_exchange_weak(state, state - 1, std::memory_order_release, std::memory_order_relaxed))
+            {
+                return true;
+            }
+        }
+
+        // The count was reset when the slot was taken back, this lease is no longer part of it
+        return false;
+    }
+
+    /// Client side: copy the most recently published video frame into out_buffer
+    /// if its frame index differs from last_read_frame_index.
+    /// Returns true and sets out_frame_index if a complete new frame was copied.
+    bool readVideoFrame(unsigned char *out_buffer, int last_read_frame_index, int &out_frame_index) const
+    {
+        for (int attempt = 0; attempt < SHARED_VIDEO_FRAME_MAX_READ_ATTEMPTS; ++attempt)
+        {
+            const int slot_index = published_slot_index.load(std::memory_order_acquire);
+
+            if (slot_index < 0 || slot_index >= SHARED_VIDEO_FRAME_SLOT_COUNT)
+            {
+                // Nothing published yet
+                return false;
+            }
+
+            const SharedVideoFrameSlot &slot = slots[slot_index];
+            const boost::uint32_t sequence_before = slot.sequence.load(std::memory_order_acquire);
+
+            if ((sequence_before & 1) != 0)
+            {
+                // The writer already wrapped around to this slot, go look at the new published slot
+                continue;
+            }
+
+            const int frame_index = slot.frame_index.load(std::memory_order_relaxed);
+
+            if (frame_index == last_read_frame_index)
+            {
+                // Already have this frame
+                return false;
+            }
+
+            std::memcpy(out_buffer, getSlotBuffer(slot_index), computeVideoBufferSize(stride, height));
+
+            // Make sure the copy happened before we re-check the sequence number
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if (slot.sequence.load(std::memory_order_relaxed) == sequence_before)
+            {
+                out_frame_index = frame_index;
+                return true;
+            }
+        }
+
+        // The writer kept overwriting the slot we were reading (reader far slower than the camera).
+        // Try again next update.
+        return false;
+    }
+
+    /// Frame index of the most recently published frame (0 before the first frame)
+    int getPublishedFrameIndex() const
+    {
+        const int slot_index = published_slot_index.load(std::memory_order_acquire);
+
+        return 
+            (slot_index >= 0 && slot_index < SHARED_VIDEO_FRAME_SLOT_COUNT) 
+            ? slots[slot_index].frame_index.load(std::memory_order_relaxed)
+            : 0;
+    }
+
+    /// Client side: block until a frame other than last_read_frame_index is published, or the timeout passes.
+    /// Returns immediately if such a frame is already published.
+    /// Returns true if a new frame is available.
+    bool waitForVideoFrame(int last_read_frame_index, int timeout_ms)
+    {
+        const std::chrono::steady_clock::time_point deadline = 
+            std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+        bool bNewFrame = false;
+
+        // Register as a waiter before checking for a frame so the service can't publish
+        // in between the check and the wait without waking us (pairs with notifyVideoFrameWaiters())
+        waiter_count.fetch_add(1, std::memory_order_seq_cst);
+
+        for (;;)
+        {
+            const boost::uint32_t observed_publish_count = publish_count.load(std::memory_order_seq_cst);
+
+            if (getPublishedFrameIndex() != last_read_frame_index)
+            {
+                bNewFrame = true;
+                break;
+            }
+
+            const std::chrono::steady_clock::duration remaining = deadline - std::chrono::steady_clock::now();
+            if (remaining <= std::chrono::steady_clock::duration::zero())
+            {
+                break;
+            }
+
+            sleepUntilPublishCountChanges(
+                observed_publish_count, 
+                std::chrono::duration_cast<std::chrono::microseconds>(remaining));
+        }
+
+        waiter_count.fetch_sub(1, std::memory_order_release);
+
+        return bNewFrame;
+    }
+
+    /// Timestamps are shared between processes on the same host, so use the system wide steady clock
+    static boost::uint64_t getTimestampUsec(const std::chrono::steady_clock::time_point &time_point)
+    {
+        return static_cast<boost::uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(time_point.time_since_epoch()).count());
+    }
+
+private:
+    /// Service side: true if the slot has no leases, or only leases that expired and have now been voided
+    bool reclaimExpiredLease(SharedVideoFrameSlot &slot)
+    {
+        boost::uint64_t state = slot.lease_state.load(std::memory_order_seq_cst);
+
+        if ((state & 0xFFFFFFFFull) == 0)
+        {
+            return true;
+        }
+
+        const boost::uint64_t now_usec = getTimestampUsec(std::chrono::steady_clock::now());
+        const boost::uint64_t lease_usec = slot.lease_timestamp_usec.load(std::memory_order_relaxed);
+
+        if (now_usec < lease_usec || now_usec - lease_usec < SHARED_VIDEO_FRAME_LEASE_TIMEOUT_MS*1000ull)
+        {
+            return false;
+        }
+
+        // Fails if a reader leased or released the slot in the meantime, it then gets another look next frame
+        const boost::uint64_t next_epoch_state = ((state >> 32) + 1) << 32;
+
+        return slot.lease_state.compare_exchange_strong(state, next_epoch_state, std::memory_order_seq_cst);
+    }
+
+    void notifyVideoFrameWaiters()
+    {
+        publish_count.fetch_add(1, std::memory_order_seq_cst);
+
+        if (waiter_count.load(std::memory_order_seq_cst) == 0)
+        {
+            // Nobody is blocked, skip the system call
+            return;
+        }
+
+#if SHARED_VIDEO_FRAME_USE_FUTEX
+        syscall(SYS_futex, reinterpret_cast<boost::uint32_t *>(&publish_count), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#else
+        // Never wait on a reader: if a waiter holds the mutex right now it will notice
+        // the new frame within SHARED_VIDEO_FRAME_MAX_WAIT_SLICE_MS
+        if (wait_mutex.try_lock())
+        {
+            wait_condition.notify_all();
+            wait_mutex.unlock();
+        }
+#endif
+    }
+
+    void sleepUntilPublishCountChanges(boost::uint32_t observed_publish_count, std::chrono::microseconds timeout)
+    {
+#if SHARED_VIDEO_FRAME_USE_FUTEX
+        struct timespec relative_timeout;
+        relative_timeout.tv_sec = static_cast<time_t>(timeout.count() / 1000000);
+        relative_timeout.tv_nsec = static_cast<long>((timeout.count() % 1000000) * 1000);
+
+        // Returns right away if the publish count already moved on.
+        // Not FUTEX_PRIVATE: the word lives in memory shared with the service process.
+        syscall(
+            SYS_futex, reinterpret_cast<boost::uint32_t *>(&publish_count), FUTEX_WAIT, observed_publish_count, 
+            &relative_timeout, nullptr, 0);
+#else
+        const std::chrono::microseconds max_slice = std::chrono::milliseconds(SHARED_VIDEO_FRAME_MAX_WAIT_SLICE_MS);
+        const std::chrono::microseconds slice = (timeout < max_slice) ? timeout : max_slice;
+        const boost::posix_time::ptime wake_time = 
+            boost::posix_time::microsec_clock::universal_time() + boost::posix_time::microseconds(slice.count());
+
+        // A reader that died holding the mutex would block everyone else, so never wait past this slice for it.
+        // Failing to get it means the slice is used up, the caller then re-checks the publish count (polling).
+        boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex> lock(wait_mutex, wake_time);
+        if (lock.owns() && publish_count.load(std::memory_order_seq_cst) == observed_publish_count)
+        {
+            wait_condition.timed_wait(lock, wake_time);
+        }
+#endif
+    }
+
+public:
     static size_t computeVideoBufferSize(int stride, int height)
     {
         return stride*height;
@@ -45,8 +456,8 @@ public:
 
     static size_t computeTotalSize(int stride, int height)
     {
-        return sizeof(SharedVideoFrameHeader) + computeVideoBufferSize(stride, height);
+        return sizeof(SharedVideoFrameHeader) + SHARED_VIDEO_FRAME_SLOT_COUNT*computeVideoBufferSize(stride, height);
     }
 };
 
-#endif // SHARED_TRACKER_STATE_H
\ No newline at end of file
+#endif // SHARED_TRACKER_STATE_H
@@ -0,0 +1,515 @@
+//-- includes -----
+#include "DeviceCapture.h"
+#include "ServerLog.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string.h>
+
+//-- definitions -----
+struct ReplayStream
+{
+    DeviceCaptureStreamDesc desc;
+    bool bIsValid;
+
+    std::vector<const DeviceCaptureRecord *> input_reports;
+    std::vector<const DeviceCaptureRecord *> feature_reports;
+    std::vector<const DeviceCaptureRecord *> video_frames;
+    size_t next_input_report;
+    size_t next_feature_report;
+    size_t next_video_frame;
+
+    ReplayStream()
+        : desc()
+        , bIsValid(false)
+        , next_input_report(0)
+        , next_feature_report(0)
+        , next_video_frame(0)
+    {
+    }
+};
+
+//-- globals -----
+// Guards everything below, the devices read and write from the device thread
+// but the recording is started and stopped from the main thread.
+static std::mutex g_capture_mutex;
+static std::atomic_bool g_is_recording(false);
+static std::atomic_bool g_is_replaying(false);
+
+static DeviceCaptureWriter g_capture_writer;
+static std::vector<DeviceCaptureStreamDesc> g_recorded_streams;
+static long long g_recording_start_usec = 0;
+static bool g_bRecordDropWarned = false;
+
+static DeviceCaptureReader g_capture_reader;
+static std::vector<ReplayStream> g_replay_streams;
+static bool g_bReplayRealTime = true;
+static long long g_replay_start_usec = 0;
+static long long g_replay_clock_usec = 0;
+static bool g_bReplayFinished = false;
+
+//-- private methods -----
+static long long get_capture_time_usec()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void append_record(
+    eDeviceCaptureRecordType record_type, int stream_id,
+    const void *payload_header, size_t payload_header_size,
+    const void *payload, size_t payload_size)
+{
+    const long long arrival_usec = get_capture_time_usec() - g_recording_start_usec;
+
+    if (!g_capture_writer.append(record_type, stream_id, arrival_usec, payload_header, payload_header_size, payload, payload_size) &&
+        !g_bRecordDropWarned)
+    {
+        SERVER_LOG_WARNING("DeviceCapture") << "Dropped a " << (payload_header_size + payload_size) << " byte record, further drops won't be reported";
+        g_bRecordDropWarned = true;
+    }
+}
+
+static bool parse_stream_info(const DeviceCaptureRecord &record, DeviceCaptureStreamDesc &out_desc)
+{
+    if (record.payload_size < sizeof(DeviceCaptureStreamInfo))
+    {
+        return false;
+    }
+
+    const DeviceCaptureStreamInfo *info = reinterpret_cast<const DeviceCaptureStreamInfo *>(record.payload);
+    const char *strings = reinterpret_cast<const char *>(record.payload + sizeof(DeviceCaptureStreamInfo));
+    const size_t strings_size = record.payload_size - sizeof(DeviceCaptureStreamInfo);
+
+    // Both strings have to be null terminated inside the payload
+    const char *path_end = static_cast<const char *>(memchr(strings, '\0', strings_size));
+    if (path_end == nullptr)
+    {
+        return false;
+    }
+
+    const char *identifier = path_end + 1;
+    const size_t identifier_size = strings_size - (identifier - strings);
+    if (memchr(identifier, '\0', identifier_size) == nullptr)
+    {
+        return false;
+    }
+
+    out_desc.stream_type = static_cast<eDeviceCaptureStreamType>(info->stream_type);
+    out_desc.device_type = static_cast<CommonDeviceState::eDeviceType>(info->device_type);
+    out_desc.vendor_id = info->vendor_id;
+    out_desc.product_id = info->product_id;
+    out_desc.interface_number = info->interface_number;
+    out_desc.path = strings;
+    out_desc.identifier = identifier;
+
+    return true;
+}
+
+static ReplayStream *get_replay_stream(int stream_id)
+{
+    return (stream_id >= 0 && stream_id < static_cast<int>(g_replay_streams.size()) && g_replay_streams[stream_id].bIsValid)
+        ? &g_replay_streams[stream_id]
+        : nullptr;
+}
+
+//-- public interface -----
+namespace DeviceCapture
+{
+    bool start_recording(const std::string &filename)
+    {
+        std::lock_guard<std::mutex> lock(g_capture_mutex);
+
+        if (g_is_recording || g_is_replaying)
+        {
+            SERVER_LOG_ERROR("DeviceCapture::start_recording") << "A device capture is already active";
+            return false;
+        }
+
+        if (!g_capture_writer.open(filename))
+        {
+            return false;
+        }
+
+        g_recorded_streams.clear();
+        g_recording_start_usec = get_capture_time_usec();
+        g_bRecordDropWarned = false;
+        g_is_recording = true;
+
+        SERVER_LOG_INFO("DeviceCapture::start_recording") << "Recording raw device input to " << filename;
+
+        return true;
+    }
+
+    bool start_replay(const std::string &filename, bool bRealTime)
+    {
+        std::lock_guard<std::mutex> lock(g_capture_mutex);
+
+        if (g_is_recording || g_is_replaying)
+        {
+            SERVER_LOG_ERROR("DeviceCapture::start_replay") << "A device capture is already active";
+            return false;
+        }
+
+        if (!g_capture_reader.open(filename))
+        {
+            return false;
+        }
+
+        // Sort the records into their streams
+        const std::vector<DeviceCaptureRecord> &records = g_capture_reader.getRecords();
+
+        g_replay_streams.clear();
+        for (const DeviceCaptureRecord &record : records)
+        {
+            if (record.stream_id >= static_cast<int>(g_replay_streams.size()))
+            {
+                g_replay_streams.resize(record.stream_id + 1);
+            }
+
+            ReplayStream &stream = g_replay_streams[record.stream_id];
+
+            switch (record.record_type)
+            {
+            case _DeviceCaptureRecord_StreamInfo:
+                stream.bIsValid = parse_stream_info(record, stream.desc);
+                break;
+            case _DeviceCaptureRecord_InputReport:
+                stream.input_reports.push_back(&record);
+                break;
+            case _DeviceCaptureRecord_FeatureReport:
+                stream.feature_reports.push_back(&record);
+                break;
+            case _DeviceCaptureRecord_VideoFrame:
+                if (record.payload_size >= sizeof(DeviceCaptureFrameInfo))
+                {
+                    const DeviceCaptureFrameInfo *frame_info = reinterpret_cast<const DeviceCaptureFrameInfo *>(record.payload);
+                    const size_t pixel_bytes = static_cast<size_t>(frame_info->row_bytes)*frame_info->height;
+
+                    if (record.payload_size == sizeof(DeviceCaptureFrameInfo) + pixel_bytes)
+                    {
+                        stream.video_frames.push_back(&record);
+                    }
+                }
+                break;
+            }
+        }
+
+        g_bReplayRealTime = bRealTime;
+        g_replay_start_usec = get_capture_time_usec();
+        g_replay_clock_usec = 0;
+        g_bReplayFinished = false;
+        g_is_replaying = true;
+
+        SERVER_LOG_INFO("DeviceCapture::start_replay") << "Replaying " << records.size() << " records from " << filename
+            << (bRealTime ? " in real time" : " as fast as possible");
+
+        return true;
+    }
+
+    void stop()
+    {
+        std::lock_guard<std::mutex> lock(g_capture_mutex);
+
+        if (g_is_recording)
+        {
+            SERVER_LOG_INFO("DeviceCapture::stop") << "Recorded " << g_capture_writer.getBytesWritten() << " bytes of device input";
+
+            g_is_recording = false;
+            g_capture_writer.close();
+            g_recorded_streams.clear();
+        }
+
+        if (g_is_replaying)
+        {
+            g_is_replaying = false;
+            g_replay_streams.clear();
+            g_capture_reader.close();
+        }
+    }
+
+    bool get_is_recording()
+    {
+        return g_is_recording.load(std::memory_order_relaxed);
+    }
+
+    bool get_is_replaying()
+    {
+        return g_is_replaying.load(std::memory_order_relaxed);
+    }
+
+    int register_stream(const DeviceCaptureStreamDesc &desc)
+    {
+        if (!g_is_recording)
+        {
+            return -1;
+        }
+
+        std::lock_guard<std::mutex> lock(g_capture_mutex);
+
+        for (size_t stream_id = 0; stream_id < g_recorded_streams.size(); ++stream_id)
+        {
+            if (g_recorded_streams[stream_id].stream_type == desc.stream_type &&
+                g_recorded_streams[stream_id].path == desc.path)
+            {
+                return static_cast<int>(stream_id);
+            }
+        }
+
+        const int stream_id = static_cast<int>(g_recorded_streams.size());
+        g_recorded_streams.push_back(desc);
+
+        DeviceCaptureStreamInfo info;
+        info.stream_type = desc.stream_type;
+        info.device_type = desc.device_type;
+        info.vendor_id = desc.vendor_id;
+        info.product_id = desc.product_id;
+        info.interface_number = desc.interface_number;
+        info.reserved = 0;
+
+        std::string strings = desc.path;
+        strings.push_back('\0');
+        strings.append(desc.identifier);
+        strings.push_back('\0');
+
+        append_record(_DeviceCaptureRecord_StreamInfo, stream_id, &info, sizeof(info), strings.data(), strings.size());
+
+        return stream_id;
+    }
+
+    void record_input_report(int stream_id, const unsigned char *data, size_t size)
+    {
+        if (g_is_recording.load(std::memory_order_relaxed) && stream_id >= 0)
+        {
+            std::lock_guard<std::mutex> lock(g_capture_mutex);
+
+            append_record(_DeviceCaptureRecord_InputReport, stream_id, nullptr, 0, data, size);
+        }
+    }
+
+    void record_feature_report(int stream_id, const unsigned char *data, size_t size)
+    {
+        if (g_is_recording.load(std::memory_order_relaxed) && stream_id >= 0)
+        {
+            std::lock_guard<std::mutex> lock(g_capture_mutex);
+
+            append_record(_DeviceCaptureRecord_FeatureReport, stream_id, nullptr, 0, data, size);
+        }
+    }
+
+    void record_video_frame(int stream_id, const DeviceCaptureFrameInfo &frame_info, const unsigned char *pixels)
+    {
+        if (g_is_recording.load(std::memory_order_relaxed) && stream_id >= 0)
+        {
+            std::lock_guard<std::mutex> lock(g_capture_mutex);
+
+            append_record(
+                _DeviceCaptureRecord_VideoFrame, stream_id,
+                &frame_info, sizeof(frame_info),
+                pixels, static_cast<size_t>(frame_info.row_bytes)*frame_info.height);
+        }
+    }
+
+    void advance_replay_clock()
+    {
+        if (!g_is_replaying)
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(g_capture_mutex);
+
+        // Find the earliest input still ahead of the replay clock.
+        // Input that is already due but hasn't been read (e.g. from a device that never got opened)
+        // must not hold the clock back.
+        long long next_arrival_usec = -1;
+        bool bAnyPending = false;
+        for (const ReplayStream &stream : g_replay_streams)
+        {
+            for (size_t index = stream.next_input_report; index < stream.input_reports.size(); ++index)
+            {
+                const long long arrival_usec = stream.input_reports[index]->arrival_usec;
+
+                bAnyPending = true;
+                if (arrival_usec > g_replay_clock_usec)
+                {
+                    next_arrival_usec = (next_arrival_usec < 0) ? arrival_usec : std::min(next_arrival_usec, arrival_usec);
+                    break;
+                }
+            }
+
+            for (size_t index = stream.next_video_frame; index < stream.video_frames.size(); ++index)
+            {
+                const long long arrival_usec = stream.video_frames[index]->arrival_usec;
+
+                bAnyPending = true;
+                if (arrival_usec > g_replay_clock_usec)
+                {
+                    next_arrival_usec = (next_arrival_usec < 0) ? arrival_usec : std::min(next_arrival_usec, arrival_usec);
+                    break;
+                }
+            }
+        }
+
+        if (g_bReplayRealTime)
+        {
+            g_replay_clock_usec = get_capture_time_usec() - g_replay_start_usec;
+        }
+        else if (next_arrival_usec >= 0)
+        {
+            // Skip the time the device would have been idle
+            g_replay_clock_usec = next_arrival_usec;
+        }
+
+        if (next_arrival_usec < 0 && !g_bReplayFinished)
+        {
+            SERVER_LOG_INFO("DeviceCapture::advance_replay_clock") << "Reached the end of the capture after " << (g_replay_clock_usec / 1000) << "ms"
+                << (bAnyPending ? ", some of the recorded input was never read" : "");
+            g_bReplayFinished = true;
+        }
+    }
+
+    void get_replay_streams(eDeviceCaptureStreamType stream_type, std::vector<DeviceCaptureStreamDesc> &out_streams)
+    {
+        std::lock_guard<std::mutex> lock(g_capture_mutex);
+
+        out_streams.clear();
+        for (const ReplayStream &stream : g_replay_streams)
+        {
+            if (stream.bIsValid && stream.desc.stream_type == stream_type)
+            {
+                out_streams.push_back(stream.desc);
+            }
+        }
+    }
+
+    int find_replay_stream(eDeviceCaptureStreamType stream_type, const std::string &path)
+    {
+        std::lock_guard<std::mutex> lock(g_capture_mutex);
+
+        for (size_t stream_id = 0; stream_id < g_replay_streams.size(); ++stream_id)
+        {
+            const ReplayStream &stream = g_replay_streams[stream_id];
+
+            if (stream.bIsValid && stream.desc.stream_type == stream_type && stream.desc.path == path)
+            {
+                return static_cast<int>(stream_id);
+            }
+        }
+
+        return -1;
+    }
+
+    bool get_replay_stream_desc(int stream_id, DeviceCaptureStreamDesc &out_desc)
+    {
+        std::lock_guard<std::mutex> lock(g_capture_mutex);
+
+        const ReplayStream *stream = get_replay_stream(stream_id);
+
+        if (stream != nullptr)
+        {
+            out_desc = stream->desc;
+        }
+
+        return stream != nullptr;
+    }
+
+    bool get_replay_frame_format(int stream_id, DeviceCaptureFrameInfo &out_frame_info)
+    {
+        std::lock_guard<std::mutex> lock(g_capture_mutex);
+
+        const ReplayStream *stream = get_replay_stream(stream_id);
+        bool bHasFrames = stream != nullptr && !stream->video_frames.empty();
+
+        if (bHasFrames)
+        {
+            memcpy(&out_frame_info, stream->video_frames[0]->payload, sizeof(DeviceCaptureFrameInfo));
+        }
+
+        return bHasFrames;
+    }
+
+    int read_input_report(int stream_id, unsigned char *out_data, size_t max_size)
+    {
+        std::lock_guard<std::mutex> lock(g_capture_mutex);
+
+        ReplayStream *stream = get_replay_stream(stream_id);
+        int result = 0;
+
+        if (stream != nullptr && stream->next_input_report < stream->input_reports.size())
+        {
+            const DeviceCaptureRecord *record = stream->input_reports[stream->next_input_report];
+
+            if (record->arrival_usec <= g_replay_clock_usec)
+            {
+                const size_t copy_size = std::min(record->payload_size, max_size);
+
+                memcpy(out_data, record->payload, copy_size);
+                ++stream->next_input_report;
+                result = static_cast<int>(copy_size);
+            }
+        }
+
+        return result;
+    }
+
+    int read_feature_report(int stream_id, unsigned char *in_out_data, size_t max_size)
+    {
+        std::lock_guard<std::mutex> lock(g_capture_mutex);
+
+        ReplayStream *stream = get_replay_stream(stream_id);
+        int result = -1;
+
+        if (stream != nullptr && max_size > 0 && !stream->feature_reports.empty())
+        {
+            const size_t report_count = stream->feature_reports.size();
+            const unsigned char report_id = in_out_data[0];
+
+            // Hand out the responses in the order they were recorded, starting over once they run out
+            for (size_t offset = 0; offset < report_count; ++offset)
+            {
+                const size_t report_index = (stream->next_feature_report + offset) % report_count;
+                const DeviceCaptureRecord *record = stream->feature_reports[report_index];
+
+                if (record->payload_size > 0 && record->payload[0] == report_id)
+                {
+                    const size_t copy_size = std::min(record->payload_size, max_size);
+
+                    memcpy(in_out_data, record->payload, copy_size);
+                    stream->next_feature_report = report_index + 1;
+                    result = static_cast<int>(copy_size);
+                    break;
+                }
+            }
+        }
+
+        return result;
+    }
+
+    bool read_video_frame(int stream_id, DeviceCaptureFrameInfo &out_frame_info, const unsigned char *&out_pixels)
+    {
+        std::lock_guard<std::mutex> lock(g_capture_mutex);
+
+        ReplayStream *stream = get_replay_stream(stream_id);
+        bool bFrameAvailable = false;
+
+        if (stream != nullptr)
+        {
+            // A camera polled slower than it records drops the frames it missed
+            while (stream->next_video_frame < stream->video_frames.size() &&
+                stream->video_frames[stream->next_video_frame]->arrival_usec <= g_replay_clock_usec)
+            {
+                const DeviceCaptureRecord *record = stream->video_frames[stream->next_video_frame];
+
+                memcpy(&out_frame_info, record->payload, sizeof(DeviceCaptureFrameInfo));
+                out_pixels = record->payload + sizeof(DeviceCaptureFrameInfo);
+                ++stream->next_video_frame;
+                bFrameAvailable = true;
+            }
+        }
+
+        return bFrameAvailable;
+    }
+};
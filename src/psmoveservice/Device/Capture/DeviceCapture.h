@@ -0,0 +1,83 @@
+#ifndef DEVICE_CAPTURE_H
+#define DEVICE_CAPTURE_H
+
+//-- includes -----
+#include "DeviceCaptureFile.h"
+#include "DeviceInterface.h"
+
+#include <string>
+#include <vector>
+
+//-- definitions -----
+/// Describes one source of raw input: a HID interface, a USB device or a camera
+struct DeviceCaptureStreamDesc
+{
+    eDeviceCaptureStreamType stream_type;
+    CommonDeviceState::eDeviceType device_type;
+    int vendor_id;
+    int product_id;
+    int interface_number;
+    std::string path;
+    std::string identifier; // Serial number for HID interfaces, camera identifier for trackers
+};
+
+//-- interface -----
+/// Records the raw input of every device into a capture file, or plays a capture file back to the devices.
+/// While recording, the devices hand over each report and frame they read, stamped with its arrival time.
+/// While replaying, the HID devices and trackers read from the capture instead of the hardware,
+/// either paced at the speed it was recorded at or as fast as the update loop runs.
+/// Recording and replaying can't be active at the same time.
+namespace DeviceCapture
+{
+    /// Starts appending all raw device input to the given capture file
+    bool start_recording(const std::string &filename);
+
+    /// Maps the given capture file and serves its input to the devices instead of the hardware.
+    /// When bRealTime is false each update jumps straight to the next recorded input.
+    bool start_replay(const std::string &filename, bool bRealTime);
+
+    /// Closes the capture file of the active recording or replay
+    void stop();
+
+    bool get_is_recording();
+    bool get_is_replaying();
+
+    //-- recording --
+    /// Returns the id to record the stream's input under, -1 if not recording.
+    /// Registering the same stream (type and path) again returns the same id.
+    int register_stream(const DeviceCaptureStreamDesc &desc);
+
+    void record_input_report(int stream_id, const unsigned char *data, size_t size);
+    void record_feature_report(int stream_id, const unsigned char *data, size_t size);
+    void record_video_frame(int stream_id, const DeviceCaptureFrameInfo &frame_info, const unsigned char *pixels);
+
+    //-- replay --
+    /// Moves the replay clock forward, called once at the start of every device update
+    void advance_replay_clock();
+
+    /// The streams in the capture of the given type, in the order they were recorded
+    void get_replay_streams(eDeviceCaptureStreamType stream_type, std::vector<DeviceCaptureStreamDesc> &out_streams);
+
+    /// Returns the id of the recorded stream with the given type and path, -1 if there isn't one
+    int find_replay_stream(eDeviceCaptureStreamType stream_type, const std::string &path);
+
+    /// Gets the description of a recorded stream, false if there isn't a valid stream with that id
+    bool get_replay_stream_desc(int stream_id, DeviceCaptureStreamDesc &out_desc);
+
+    /// Gets the size and format of the first frame recorded on a video stream, false if it has none
+    bool get_replay_frame_format(int stream_id, DeviceCaptureFrameInfo &out_frame_info);
+
+    /// Copies the next input report of the stream that is due on the replay clock.
+    /// Returns the report size, or 0 when nothing is due yet.
+    int read_input_report(int stream_id, unsigned char *out_data, size_t max_size);
+
+    /// Copies the next recorded response for the feature report id in out_data[0].
+    /// Returns the report size, or -1 if the capture never saw that report.
+    int read_feature_report(int stream_id, unsigned char *in_out_data, size_t max_size);
+
+    /// Gets the newest frame of the stream that is due on the replay clock and hasn't been handed out yet.
+    /// The pixels point into the capture file mapping.
+    bool read_video_frame(int stream_id, DeviceCaptureFrameInfo &out_frame_info, const unsigned char *&out_pixels);
+};
+
+#endif // DEVICE_CAPTURE_H
@@ -0,0 +1,445 @@
+//-- includes -----
+#include "DeviceCaptureFile.h"
+#include "ServerLog.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <string.h>
+
+//-- constants -----
+static const char k_capture_file_magic[8] = { 'P', 'S', 'M', 'C', 'A', 'P', 'T', '\0' };
+static const uint32_t k_capture_chunk_magic = 0x4B4E4843; // "CHNK"
+
+// The file header gets an area of its own so that every chunk starts on a mapping boundary
+// (64KB is the allocation granularity on Windows and a multiple of the page size elsewhere)
+static const unsigned long long k_capture_header_area_size = 64*1024;
+
+//-- definitions -----
+struct DeviceCaptureFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t header_area_size;
+    uint64_t chunk_size;
+    int64_t start_time_usec; // Wall clock time the recording started at, in microseconds since the epoch
+};
+
+struct DeviceCaptureChunkHeader
+{
+    uint32_t magic;
+    uint32_t record_count;
+    uint64_t used_bytes; // Including this header
+};
+
+struct DeviceCaptureRecordHeader
+{
+    uint32_t payload_size;
+    uint16_t record_type;
+    uint16_t stream_id;
+    int64_t arrival_usec;
+};
+
+//-- private methods -----
+static size_t align_record_size(size_t size)
+{
+    // Keep every record header 8 byte aligned
+    return (size + 7) & ~static_cast<size_t>(7);
+}
+
+//-- DeviceCaptureWriterImpl -----
+class DeviceCaptureWriterImpl
+{
+public:
+    DeviceCaptureWriterImpl()
+        : filename()
+        , chunk_size(0)
+        , file_mapping()
+        , chunk_region()
+        , chunk_index(0)
+        , chunk_header(nullptr)
+        , bytes_written(0)
+        , file_size(0)
+        , bIsOpen(false)
+    {
+    }
+
+    bool map_chunk(unsigned long long new_chunk_index)
+    {
+        bool bSuccess = false;
+
+        try
+        {
+            const unsigned long long chunk_offset = k_capture_header_area_size + new_chunk_index*chunk_size;
+
+            // Unmap the previous chunk before growing the file under it
+            chunk_region = boost::interprocess::mapped_region();
+            chunk_header = nullptr;
+
+            boost::filesystem::resize_file(filename, chunk_offset + chunk_size);
+
+            boost::interprocess::mapped_region new_region(
+                file_mapping, boost::interprocess::read_write,
+                static_cast<boost::interprocess::offset_t>(chunk_offset), chunk_size);
+            chunk_region.swap(new_region);
+
+            chunk_header = static_cast<DeviceCaptureChunkHeader *>(chunk_region.get_address());
+            chunk_header->magic = k_capture_chunk_magic;
+            chunk_header->record_count = 0;
+            chunk_header->used_bytes = sizeof(DeviceCaptureChunkHeader);
+            chunk_index = new_chunk_index;
+            file_size = chunk_offset + sizeof(DeviceCaptureChunkHeader);
+
+            bSuccess = true;
+        }
+        catch (std::exception &e)
+        {
+            SERVER_LOG_ERROR("DeviceCaptureWriter::map_chunk") << "Failed to map chunk " << new_chunk_index << " of " << filename << ": " << e.what();
+        }
+
+        return bSuccess;
+    }
+
+    std::string filename;
+    size_t chunk_size;
+    boost::interprocess::file_mapping file_mapping;
+    boost::interprocess::mapped_region chunk_region;
+    unsigned long long chunk_index;
+    DeviceCaptureChunkHeader *chunk_header;
+    unsigned long long bytes_written;
+    unsigned long long file_size; // End of the last record written
+    bool bIsOpen;
+};
+
+//-- DeviceCaptureWriter -----
+DeviceCaptureWriter::DeviceCaptureWriter()
+    : m_implementation_ptr(new DeviceCaptureWriterImpl)
+{
+}
+
+DeviceCaptureWriter::~DeviceCaptureWriter()
+{
+    close();
+    delete m_implementation_ptr;
+}
+
+bool DeviceCaptureWriter::open(const std::string &filename, size_t chunk_size)
+{
+    close();
+
+    DeviceCaptureWriterImpl *impl = m_implementation_ptr;
+    bool bSuccess = false;
+
+    // Chunks have to start on a mapping boundary too
+    impl->filename = filename;
+    impl->chunk_size = static_cast<size_t>(
+        ((chunk_size + k_capture_header_area_size - 1) / k_capture_header_area_size) * k_capture_header_area_size);
+    impl->bytes_written = 0;
+
+    // Create the file with its header, the chunks get mapped in after it
+    {
+        std::ofstream file(filename, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+
+        if (file.is_open())
+        {
+            DeviceCaptureFileHeader header;
+
+            memset(&header, 0, sizeof(header));
+            memcpy(header.magic, k_capture_file_magic, sizeof(header.magic));
+            header.version = DEVICE_CAPTURE_FILE_VERSION;
+            header.header_area_size = k_capture_header_area_size;
+            header.chunk_size = impl->chunk_size;
+            header.start_time_usec = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+
+            file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            bSuccess = file.good();
+        }
+    }
+
+    if (bSuccess)
+    {
+        try
+        {
+            boost::filesystem::resize_file(filename, k_capture_header_area_size);
+
+            boost::interprocess::file_mapping file_mapping(filename.c_str(), boost::interprocess::read_write);
+            impl->file_mapping.swap(file_mapping);
+        }
+        catch (std::exception &e)
+        {
+            SERVER_LOG_ERROR("DeviceCaptureWriter::open") << "Failed to map " << filename << ": " << e.what();
+            bSuccess = false;
+        }
+    }
+    else
+    {
+        SERVER_LOG_ERROR("DeviceCaptureWriter::open") << "Failed to create " << filename;
+    }
+
+    if (bSuccess)
+    {
+        bSuccess = impl->map_chunk(0);
+    }
+
+    impl->bIsOpen = bSuccess;
+
+    return bSuccess;
+}
+
+void DeviceCaptureWriter::close()
+{
+    DeviceCaptureWriterImpl *impl = m_implementation_ptr;
+
+    if (impl->bIsOpen)
+    {
+        impl->chunk_region = boost::interprocess::mapped_region();
+        impl->chunk_header = nullptr;
+        impl->file_mapping = boost::interprocess::file_mapping();
+
+        // Drop the unused tail of the last chunk
+        boost::system::error_code ec;
+        boost::filesystem::resize_file(impl->filename, impl->file_size, ec);
+
+        impl->bIsOpen = false;
+    }
+}
+
+bool DeviceCaptureWriter::getIsOpen() const
+{
+    return m_implementation_ptr->bIsOpen;
+}
+
+bool DeviceCaptureWriter::append(
+    eDeviceCaptureRecordType record_type, int stream_id, long long arrival_usec,
+    const void *payload_header, size_t payload_header_size,
+    const void *payload, size_t payload_size)
+{
+    DeviceCaptureWriterImpl *impl = m_implementation_ptr;
+
+    if (!impl->bIsOpen)
+    {
+        return false;
+    }
+
+    const size_t record_size = align_record_size(sizeof(DeviceCaptureRecordHeader) + payload_header_size + payload_size);
+
+    if (record_size > impl->chunk_size - sizeof(DeviceCaptureChunkHeader))
+    {
+        return false;
+    }
+
+    // Move on to a fresh chunk when this one is full
+    if (impl->chunk_header->used_bytes + record_size > impl->chunk_size)
+    {
+        if (!impl->map_chunk(impl->chunk_index + 1))
+        {
+            close();
+            return false;
+        }
+    }
+
+    unsigned char *write_ptr = static_cast<unsigned char *>(impl->chunk_region.get_address()) + impl->chunk_header->used_bytes;
+
+    DeviceCaptureRecordHeader *record_header = reinterpret_cast<DeviceCaptureRecordHeader *>(write_ptr);
+    record_header->payload_size = static_cast<uint32_t>(payload_header_size + payload_size);
+    record_header->record_type = static_cast<uint16_t>(record_type);
+    record_header->stream_id = static_cast<uint16_t>(stream_id);
+    record_header->arrival_usec = arrival_usec;
+    write_ptr += sizeof(DeviceCaptureRecordHeader);
+
+    if (payload_header_size > 0)
+    {
+        memcpy(write_ptr, payload_header, payload_header_size);
+        write_ptr += payload_header_size;
+    }
+
+    if (payload_size > 0)
+    {
+        memcpy(write_ptr, payload, payload_size);
+    }
+
+    // Only count the record once all of it is in the mapping
+    impl->chunk_header->used_bytes += record_size;
+    impl->chunk_header->record_count++;
+    impl->bytes_written += record_size;
+    impl->file_size += record_size;
+
+    return true;
+}
+
+unsigned long long DeviceCaptureWriter::getBytesWritten() const
+{
+    return m_implementation_ptr->bytes_written;
+}
+
+//-- DeviceCaptureReaderImpl -----
+class DeviceCaptureReaderImpl
+{
+public:
+    DeviceCaptureReaderImpl()
+        : file_mapping()
+        , file_region()
+        , records()
+        , bIsOpen(false)
+    {
+    }
+
+    bool index_records(const std::string &filename)
+    {
+        const unsigned char *file_data = static_cast<const unsigned char *>(file_region.get_address());
+        const unsigned long long file_size = file_region.get_size();
+
+        if (file_size < sizeof(DeviceCaptureFileHeader))
+        {
+            SERVER_LOG_ERROR("DeviceCaptureReader::open") << filename << " is too small to be a capture file";
+            return false;
+        }
+
+        const DeviceCaptureFileHeader *header = reinterpret_cast<const DeviceCaptureFileHeader *>(file_data);
+
+        if (memcmp(header->magic, k_capture_file_magic, sizeof(header->magic)) != 0)
+        {
+            SERVER_LOG_ERROR("DeviceCaptureReader::open") << filename << " is not a capture file";
+            return false;
+        }
+
+        if (header->version != DEVICE_CAPTURE_FILE_VERSION)
+        {
+            SERVER_LOG_ERROR("DeviceCaptureReader::open") << filename << " has version " << header->version << ", expected " << DEVICE_CAPTURE_FILE_VERSION;
+            return false;
+        }
+
+        // A corrupt layout would otherwise never advance past a chunk or index outside the mapping
+        if (header->chunk_size < sizeof(DeviceCaptureChunkHeader) ||
+            header->header_area_size < sizeof(DeviceCaptureFileHeader) ||
+            header->header_area_size > file_size)
+        {
+            SERVER_LOG_ERROR("DeviceCaptureReader::open") << filename << " has a corrupt header (header area " 
+                << header->header_area_size << " bytes, chunk " << header->chunk_size << " bytes)";
+            return false;
+        }
+
+        // Compare against the remaining size rather than adding to the offset, so huge chunk sizes can't wrap around
+        for (unsigned long long chunk_offset = header->header_area_size;
+            file_size - chunk_offset >= sizeof(DeviceCaptureChunkHeader);
+            chunk_offset += header->chunk_size)
+        {
+            const DeviceCaptureChunkHeader *chunk_header = reinterpret_cast<const DeviceCaptureChunkHeader *>(file_data + chunk_offset);
+
+            if (chunk_header->magic != k_capture_chunk_magic)
+            {
+                SERVER_LOG_WARNING("DeviceCaptureReader::open") << "Ignoring the corrupt tail of " << filename << " at byte " << chunk_offset;
+                break;
+            }
+
+            // A recording that didn't get closed can end in the middle of a chunk
+            const unsigned long long chunk_end = chunk_offset + std::min<unsigned long long>(chunk_header->used_bytes, file_size - chunk_offset);
+            unsigned long long record_offset = chunk_offset + sizeof(DeviceCaptureChunkHeader);
+
+            while (record_offset + sizeof(DeviceCaptureRecordHeader) <= chunk_end)
+            {
+                const DeviceCaptureRecordHeader *record_header = reinterpret_cast<const DeviceCaptureRecordHeader *>(file_data + record_offset);
+                const unsigned long long payload_offset = record_offset + sizeof(DeviceCaptureRecordHeader);
+
+                if (payload_offset + record_header->payload_size > chunk_end)
+                {
+                    break;
+                }
+
+                DeviceCaptureRecord record;
+                record.record_type = static_cast<eDeviceCaptureRecordType>(record_header->record_type);
+                record.stream_id = record_header->stream_id;
+                record.arrival_usec = record_header->arrival_usec;
+                record.payload = file_data + payload_offset;
+                record.payload_size = record_header->payload_size;
+                records.push_back(record);
+
+                record_offset += align_record_size(sizeof(DeviceCaptureRecordHeader) + record_header->payload_size);
+            }
+
+            if (header->chunk_size > file_size - chunk_offset)
+            {
+                break;
+            }
+        }
+
+        return true;
+    }
+
+    boost::interprocess::file_mapping file_mapping;
+    boost::interprocess::mapped_region file_region;
+    std::vector<DeviceCaptureRecord> records;
+    bool bIsOpen;
+};
+
+//-- DeviceCaptureReader -----
+DeviceCaptureReader::DeviceCaptureReader()
+    : m_implementation_ptr(new DeviceCaptureReaderImpl)
+{
+}
+
+DeviceCaptureReader::~DeviceCaptureReader()
+{
+    close();
+    delete m_implementation_ptr;
+}
+
+bool DeviceCaptureReader::open(const std::string &filename)
+{
+    close();
+
+    DeviceCaptureReaderImpl *impl = m_implementation_ptr;
+    bool bSuccess = false;
+
+    try
+    {
+        boost::interprocess::file_mapping file_mapping(filename.c_str(), boost::interprocess::read_only);
+        boost::interprocess::mapped_region file_region(file_mapping, boost::interprocess::read_only);
+
+        impl->file_mapping.swap(file_mapping);
+        impl->file_region.swap(file_region);
+
+        bSuccess = impl->index_records(filename);
+    }
+    catch (std::exception &e)
+    {
+        SERVER_LOG_ERROR("DeviceCaptureReader::open") << "Failed to map " << filename << ": " << e.what();
+    }
+
+    if (bSuccess)
+    {
+        impl->bIsOpen = true;
+    }
+    else
+    {
+        close();
+    }
+
+    return bSuccess;
+}
+
+void DeviceCaptureReader::close()
+{
+    DeviceCaptureReaderImpl *impl = m_implementation_ptr;
+
+    impl->records.clear();
+    impl->file_region = boost::interprocess::mapped_region();
+    impl->file_mapping = boost::interprocess::file_mapping();
+    impl->bIsOpen = false;
+}
+
+bool DeviceCaptureReader::getIsOpen() const
+{
+    return m_implementation_ptr->bIsOpen;
+}
+
+const std::vector<DeviceCaptureRecord> &DeviceCaptureReader::getRecords() const
+{
+    return m_implementation_ptr->records;
+}
@@ -0,0 +1,111 @@
+#ifndef DEVICE_CAPTURE_FILE_H
+#define DEVICE_CAPTURE_FILE_H
+
+//-- includes -----
+#include <stdint.h>
+#include <stdlib.h> // size_t
+#include <string>
+#include <vector>
+
+//-- constants -----
+// Bump this version when the layout of the file changes
+#define DEVICE_CAPTURE_FILE_VERSION 1
+
+// The capture file is grown and mapped this many bytes at a time.
+// A single record (e.g. a 640x480 BGR frame) has to fit in one chunk.
+#define DEVICE_CAPTURE_DEFAULT_CHUNK_SIZE (64*1024*1024)
+
+enum eDeviceCaptureRecordType
+{
+    _DeviceCaptureRecord_StreamInfo,    // DeviceCaptureStreamInfo, then the null terminated device path and identifier
+    _DeviceCaptureRecord_InputReport,   // An input report exactly as it was read from the device
+    _DeviceCaptureRecord_FeatureReport, // A feature report exactly as the device returned it (report id first)
+    _DeviceCaptureRecord_VideoFrame,    // DeviceCaptureFrameInfo, then the pixel rows
+};
+
+enum eDeviceCaptureStreamType
+{
+    _DeviceCaptureStream_HID,
+    _DeviceCaptureStream_USB,
+    _DeviceCaptureStream_Video,
+};
+
+//-- definitions -----
+/// Payload header of a _DeviceCaptureRecord_StreamInfo record
+struct DeviceCaptureStreamInfo
+{
+    int32_t stream_type; // eDeviceCaptureStreamType
+    int32_t device_type; // CommonDeviceState::eDeviceType, or -1 when the stream doesn't know it (HID interfaces)
+    int32_t vendor_id;
+    int32_t product_id;
+    int32_t interface_number;
+    int32_t reserved;
+};
+
+/// Payload header of a _DeviceCaptureRecord_VideoFrame record
+struct DeviceCaptureFrameInfo
+{
+    int32_t width;
+    int32_t height;
+    int32_t cv_type; // OpenCV matrix type of the pixels (CV_8UC3 for BGR, CV_8UC1 for Bayer)
+    int32_t row_bytes;
+};
+
+/// A record of a capture file as handed out by DeviceCaptureReader.
+/// The payload points into the file mapping and stays valid until the reader is closed.
+struct DeviceCaptureRecord
+{
+    eDeviceCaptureRecordType record_type;
+    int stream_id;
+    long long arrival_usec; // Time since the recording started
+    const unsigned char *payload;
+    size_t payload_size;
+};
+
+/// Appends records to a capture file.
+/// The file is made of fixed size chunks that get mapped into memory one at a time,
+/// so writing a record is a copy into the mapping rather than a write call.
+class DeviceCaptureWriter
+{
+public:
+    DeviceCaptureWriter();
+    virtual ~DeviceCaptureWriter();
+
+    bool open(const std::string &filename, size_t chunk_size= DEVICE_CAPTURE_DEFAULT_CHUNK_SIZE);
+    /// Unmaps the last chunk and trims the file down to the bytes actually written
+    void close();
+    bool getIsOpen() const;
+
+    /// Appends one record made of an optional payload header followed by the payload.
+    /// Returns false if the record doesn't fit in a chunk or the file couldn't be grown.
+    bool append(
+        eDeviceCaptureRecordType record_type, int stream_id, long long arrival_usec,
+        const void *payload_header, size_t payload_header_size,
+        const void *payload, size_t payload_size);
+
+    /// Bytes of records written so far
+    unsigned long long getBytesWritten() const;
+
+private:
+    class DeviceCaptureWriterImpl *m_implementation_ptr;
+};
+
+/// Maps a whole capture file read-only and indexes its records
+class DeviceCaptureReader
+{
+public:
+    DeviceCaptureReader();
+    virtual ~DeviceCaptureReader();
+
+    bool open(const std::string &filename);
+    void close();
+    bool getIsOpen() const;
+
+    /// Every record of the file, in the order they were recorded
+    const std::vector<DeviceCaptureRecord> &getRecords() const;
+
+private:
+    class DeviceCaptureReaderImpl *m_implementation_ptr;
+};
+
+#endif // DEVICE_CAPTURE_FILE_H
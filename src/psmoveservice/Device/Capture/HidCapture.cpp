@@ -0,0 +1,277 @@
+//-- includes -----
+#include "HidCapture.h"
+#include "DeviceCapture.h"
+#include "ServerMetrics.h"
+#include "ServerUtility.h"
+
+#include <map>
+#include <mutex>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _MSC_VER
+#pragma warning (disable: 4996) // 'This function or variable may be unsafe': strdup, mbstowcs
+#define strdup _strdup
+#endif
+
+//-- definitions -----
+/// What a hid_device handle points to while replaying
+struct HidReplayDevice
+{
+    int stream_id;
+};
+
+//-- globals -----
+static std::mutex g_hid_capture_mutex;
+
+// Capture stream of every device opened while recording
+static std::map<hid_device *, int> g_recorded_devices;
+
+// Devices opened while replaying
+static std::map<hid_device *, HidReplayDevice *> g_replay_devices;
+
+//-- private methods -----
+static int register_hid_stream(const char *path, const struct hid_device_info *dev_info)
+{
+    DeviceCaptureStreamDesc desc;
+
+    desc.stream_type = _DeviceCaptureStream_HID;
+    desc.device_type = CommonDeviceState::INVALID_DEVICE_TYPE;
+    desc.vendor_id = (dev_info != nullptr) ? dev_info->vendor_id : 0;
+    desc.product_id = (dev_info != nullptr) ? dev_info->product_id : 0;
+    desc.interface_number = (dev_info != nullptr) ? dev_info->interface_number : -1;
+    desc.path = path;
+
+    char serial[256];
+    if (dev_info != nullptr && dev_info->serial_number != nullptr &&
+        ServerUtility::convert_wcs_to_mbs(dev_info->serial_number, serial, sizeof(serial)))
+    {
+        desc.identifier = serial;
+    }
+
+    return DeviceCapture::register_stream(desc);
+}
+
+static int get_recorded_stream(hid_device *device)
+{
+    std::lock_guard<std::mutex> lock(g_hid_capture_mutex);
+    std::map<hid_device *, int>::const_iterator iter = g_recorded_devices.find(device);
+
+    return (iter != g_recorded_devices.end()) ? iter->second : -1;
+}
+
+static int get_replay_stream(hid_device *device)
+{
+    std::lock_guard<std::mutex> lock(g_hid_capture_mutex);
+    std::map<hid_device *, HidReplayDevice *>::const_iterator iter = g_replay_devices.find(device);
+
+    return (iter != g_replay_devices.end()) ? iter->second->stream_id : -1;
+}
+
+static struct hid_device_info *build_replay_enumeration(unsigned short vendor_id, unsigned short product_id)
+{
+    std::vector<DeviceCaptureStreamDesc> streams;
+    struct hid_device_info *devs = nullptr;
+    struct hid_device_info *last_dev = nullptr;
+
+    DeviceCapture::get_replay_streams(_DeviceCaptureStream_HID, streams);
+
+    for (const DeviceCaptureStreamDesc &stream : streams)
+    {
+        // Zero matches anything, same as hidapi
+        if ((vendor_id != 0 && stream.vendor_id != vendor_id) ||
+            (product_id != 0 && stream.product_id != product_id))
+        {
+            continue;
+        }
+
+        struct hid_device_info *dev = static_cast<struct hid_device_info *>(calloc(1, sizeof(struct hid_device_info)));
+
+        dev->path = strdup(stream.path.c_str());
+        dev->vendor_id = static_cast<unsigned short>(stream.vendor_id);
+        dev->product_id = static_cast<unsigned short>(stream.product_id);
+        dev->interface_number = stream.interface_number;
+
+        if (!stream.identifier.empty())
+        {
+            const size_t serial_length = stream.identifier.size();
+
+            dev->serial_number = static_cast<wchar_t *>(calloc(serial_length + 1, sizeof(wchar_t)));
+            mbstowcs(dev->serial_number, stream.identifier.c_str(), serial_length + 1);
+        }
+
+        if (last_dev != nullptr)
+        {
+            last_dev->next = dev;
+        }
+        else
+        {
+            devs = dev;
+        }
+        last_dev = dev;
+    }
+
+    return devs;
+}
+
+//-- public interface -----
+struct hid_device_info *hid_capture_enumerate(unsigned short vendor_id, unsigned short product_id)
+{
+    if (DeviceCapture::get_is_replaying())
+    {
+        return build_replay_enumeration(vendor_id, product_id);
+    }
+
+    struct hid_device_info *devs = hid_enumerate(vendor_id, product_id);
+
+    if (DeviceCapture::get_is_recording())
+    {
+        for (struct hid_device_info *cur_dev = devs; cur_dev != nullptr; cur_dev = cur_dev->next)
+        {
+            register_hid_stream(cur_dev->path, cur_dev);
+        }
+    }
+
+    return devs;
+}
+
+void hid_capture_free_enumeration(struct hid_device_info *devs)
+{
+    if (DeviceCapture::get_is_replaying())
+    {
+        while (devs != nullptr)
+        {
+            struct hid_device_info *next_dev = devs->next;
+
+            free(devs->path);
+            free(devs->serial_number);
+            free(devs);
+            devs = next_dev;
+        }
+    }
+    else if (devs != nullptr)
+    {
+        hid_free_enumeration(devs);
+    }
+}
+
+hid_device *hid_capture_open_path(const char *path)
+{
+    hid_device *device = nullptr;
+
+    if (DeviceCapture::get_is_replaying())
+    {
+        const int stream_id = DeviceCapture::find_replay_stream(_DeviceCaptureStream_HID, path);
+
+        if (stream_id != -1)
+        {
+            HidReplayDevice *replay_device = new HidReplayDevice;
+            replay_device->stream_id = stream_id;
+
+            // Never dereferenced, it only has to be unique
+            device = reinterpret_cast<hid_device *>(replay_device);
+
+            std::lock_guard<std::mutex> lock(g_hid_capture_mutex);
+            g_replay_devices[device] = replay_device;
+        }
+    }
+    else
+    {
+        device = hid_open_path(path);
+
+        if (device != nullptr && DeviceCapture::get_is_recording())
+        {
+            // Interfaces opened without being enumerated (e.g. the PSMove's second collection on Windows)
+            // get registered with just their path
+            const int stream_id = register_hid_stream(path, nullptr);
+
+            std::lock_guard<std::mutex> lock(g_hid_capture_mutex);
+            g_recorded_devices[device] = stream_id;
+        }
+    }
+
+    return device;
+}
+
+void hid_capture_close(hid_device *device)
+{
+    std::unique_lock<std::mutex> lock(g_hid_capture_mutex);
+    std::map<hid_device *, HidReplayDevice *>::iterator replay_iter = g_replay_devices.find(device);
+
+    if (replay_iter != g_replay_devices.end())
+    {
+        delete replay_iter->second;
+        g_replay_devices.erase(replay_iter);
+    }
+    else
+    {
+        g_recorded_devices.erase(device);
+        lock.unlock();
+
+        hid_close(device);
+    }
+}
+
+int hid_capture_set_nonblocking(hid_device *device, int nonblock)
+{
+    // Replay reads never block
+    return hid_capture_is_replay_device(device) ? 0 : hid_set_nonblocking(device, nonblock);
+}
+
+int hid_capture_read(hid_device *device, unsigned char *data, size_t length)
+{
+    if (DeviceCapture::get_is_replaying())
+    {
+        return DeviceCapture::read_input_report(get_replay_stream(device), data, length);
+    }
+
+    const int res = hid_read(device, data, length);
+
+    if (res < 0)
+    {
+        ServerMetrics::increment_counter(ServerMetric_HidReadErrors, -1);
+    }
+    else if (res > 0 && DeviceCapture::get_is_recording())
+    {
+        DeviceCapture::record_input_report(get_recorded_stream(device), data, static_cast<size_t>(res));
+    }
+
+    return res;
+}
+
+int hid_capture_write(hid_device *device, const unsigned char *data, size_t length)
+{
+    return hid_capture_is_replay_device(device) ? static_cast<int>(length) : hid_write(device, data, length);
+}
+
+int hid_capture_get_feature_report(hid_device *device, unsigned char *data, size_t length)
+{
+    if (DeviceCapture::get_is_replaying())
+    {
+        return DeviceCapture::read_feature_report(get_replay_stream(device), data, length);
+    }
+
+    const int res = hid_get_feature_report(device, data, length);
+
+    if (res > 0 && DeviceCapture::get_is_recording())
+    {
+        DeviceCapture::record_feature_report(get_recorded_stream(device), data, static_cast<size_t>(res));
+    }
+
+    return res;
+}
+
+int hid_capture_send_feature_report(hid_device *device, const unsigned char *data, size_t length)
+{
+    return hid_capture_is_replay_device(device) ? static_cast<int>(length) : hid_send_feature_report(device, data, length);
+}
+
+const wchar_t *hid_capture_error(hid_device *device)
+{
+    return hid_capture_is_replay_device(device) ? L"Device capture replay" : hid_error(device);
+}
+
+bool hid_capture_is_replay_device(hid_device *device)
+{
+    return get_replay_stream(device) != -1;
+}
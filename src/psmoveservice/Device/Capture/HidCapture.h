@@ -0,0 +1,29 @@
+#ifndef HID_CAPTURE_H
+#define HID_CAPTURE_H
+
+//-- includes -----
+#include "hidapi.h"
+
+//-- interface -----
+// Stand-ins for the hidapi calls made by the HID devices and their enumerators.
+// Normally they just forward to hidapi. While DeviceCapture is recording they also record the
+// interfaces that were enumerated and every input and feature report the device returned.
+// While it is replaying they never touch the hardware: enumeration lists the recorded interfaces,
+// reads return the recorded reports and writes are dropped.
+struct hid_device_info *hid_capture_enumerate(unsigned short vendor_id, unsigned short product_id);
+void hid_capture_free_enumeration(struct hid_device_info *devs);
+
+hid_device *hid_capture_open_path(const char *path);
+void hid_capture_close(hid_device *device);
+int hid_capture_set_nonblocking(hid_device *device, int nonblock);
+
+int hid_capture_read(hid_device *device, unsigned char *data, size_t length);
+int hid_capture_write(hid_device *device, const unsigned char *data, size_t length);
+int hid_capture_get_feature_report(hid_device *device, unsigned char *data, size_t length);
+int hid_capture_send_feature_report(hid_device *device, const unsigned char *data, size_t length);
+const wchar_t *hid_capture_error(hid_device *device);
+
+/// True if the handle was opened on a capture replay rather than on the hardware
+bool hid_capture_is_replay_device(hid_device *device);
+
+#endif // HID_CAPTURE_H
@@ -3,7 +3,7 @@
 #include "ServerUtility.h"
 #include "USBDeviceInfo.h"
 #include "assert.h"
-#include "hidapi.h"
+#include "HidCapture.h"
 #include "string.h"
 
 // -- private definitions -----
@@ -39,7 +39,7 @@ ControllerHidDeviceEnumerator::ControllerHidDeviceEnumerator()
 	assert(m_deviceType >= 0 && GET_DEVICE_TYPE_INDEX(m_deviceType) < MAX_CONTROLLER_TYPE_INDEX);
 
 	HIDApiDeviceFilter &dev_info = g_supported_hid_controller_infos[GET_DEVICE_TYPE_INDEX(m_deviceType)];
-	devs = hid_enumerate(dev_info.filter.vendor_id, dev_info.filter.product_id);
+	devs = hid_capture_enumerate(dev_info.filter.vendor_id, dev_info.filter.product_id);
 	cur_dev = devs;
 
 	if (!is_valid())
@@ -59,7 +59,7 @@ ControllerHidDeviceEnumerator::ControllerHidDeviceEnumerator(
 	assert(m_deviceType >= 0 && GET_DEVICE_TYPE_INDEX(m_deviceType) < MAX_CONTROLLER_TYPE_INDEX);
 
 	HIDApiDeviceFilter &dev_info = g_supported_hid_controller_infos[GET_DEVICE_TYPE_INDEX(m_deviceType)];
-	devs = hid_enumerate(dev_info.filter.vendor_id, dev_info.filter.product_id);
+	devs = hid_capture_enumerate(dev_info.filter.vendor_id, dev_info.filter.product_id);
 	cur_dev = devs;
 
 	if (!is_valid())
@@ -72,7 +72,7 @@ ControllerHidDeviceEnumerator::~ControllerHidDeviceEnumerator()
 {
 	if (devs != nullptr)
 	{
-		hid_free_enumeration(devs);
+		hid_capture_free_enumeration(devs);
 	}
 }
 
@@ -143,7 +143,7 @@ bool ControllerHidDeviceEnumerator::next()
 			// Free any previous enumeration
 			if (devs != nullptr)
 			{
-				hid_free_enumeration(devs);
+				hid_capture_free_enumeration(devs);
 				cur_dev = nullptr;
 				devs = nullptr;
 			}
@@ -156,7 +156,7 @@ bool ControllerHidDeviceEnumerator::next()
 				if (dev_info.bHIDApiSupported)
 				{
 					// Create a new HID enumeration
-					devs = hid_enumerate(dev_info.filter.vendor_id, dev_info.filter.product_id);
+					devs = hid_capture_enumerate(dev_info.filter.vendor_id, dev_info.filter.product_id);
 					cur_dev = devs;
 					foundValid = is_valid();
 				}
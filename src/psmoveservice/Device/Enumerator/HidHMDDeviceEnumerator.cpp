@@ -3,7 +3,7 @@
 #include "ServerUtility.h"
 #include "USBDeviceInfo.h" // for MAX_USB_DEVICE_PORT_PATH, t_usb_device_handle
 #include "assert.h"
-#include "hidapi.h"
+#include "HidCapture.h"
 #include "string.h"
 #include <sstream>
 #include <iomanip>
@@ -102,7 +102,7 @@ std::string HidHMDDeviceEnumerator::get_interface_path(int interface_number) con
 void HidHMDDeviceEnumerator::build_interface_list()
 {
 	USBDeviceFilter &dev_info = g_supported_hmd_infos[GET_DEVICE_TYPE_INDEX(m_deviceType)];
-	hid_device_info * devs = hid_enumerate(dev_info.vendor_id, dev_info.product_id);
+	hid_device_info * devs = hid_capture_enumerate(dev_info.vendor_id, dev_info.product_id);
 
 	current_device_identifier = "";
 	current_device_interfaces.clear();
@@ -126,6 +126,6 @@ void HidHMDDeviceEnumerator::build_interface_list()
 			current_device_interfaces.push_back(hmd_interface);
 		}
 
-		hid_free_enumeration(devs);
+		hid_capture_free_enumeration(devs);
 	}
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 // -- includes -----
 #include "TrackerDeviceEnumerator.h"
+#include "DeviceCapture.h"
 #include "ServerUtility.h"
 #include "USBDeviceManager.h"
 #include "ServerLog.h"
@@ -19,22 +20,38 @@
 // NOTE: This list must match the tracker order in CommonDeviceState::eDeviceType
 USBDeviceFilter k_supported_tracker_infos[MAX_CAMERA_TYPE_INDEX] = {
     { 0x1415, 0x2000 }, // PS3Eye
+    { 0x0000, 0x0000 }, // VirtualTracker (never on the bus)
     //{ 0x05a9, 0x058a }, // PS4 Camera - TODO
 };
 
 // -- private prototypes -----
 static bool is_tracker_supported(USBDeviceEnumerator* enumerator, CommonDeviceState::eDeviceType device_type_filter, CommonDeviceState::eDeviceType &out_device_type);
 
+//-- statics -----
+int TrackerDeviceEnumerator::virtual_tracker_count= 0;
+
 // -- methods -----
 TrackerDeviceEnumerator::TrackerDeviceEnumerator()
 	: DeviceEnumerator()
 	, m_usb_enumerator(nullptr)
     , m_cameraIndex(-1)
+	, m_replayStreams()
+	, m_replayStreamIndex(-1)
+	, m_virtualTrackerIndex(-1)
 {
 	USBDeviceManager *usbRequestMgr = USBDeviceManager::getInstance();
 
 	m_deviceType= CommonDeviceState::PS3EYE;
 	assert(m_deviceType >= 0 && GET_DEVICE_TYPE_INDEX(m_deviceType) < MAX_CAMERA_TYPE_INDEX);
+
+	if (DeviceCapture::get_is_replaying())
+	{
+		// List the cameras recorded in the capture instead of the ones plugged in
+		DeviceCapture::get_replay_streams(_DeviceCaptureStream_Video, m_replayStreams);
+		next();
+		return;
+	}
+
 	m_usb_enumerator = usb_device_enumerator_allocate();
 
 	// If the first USB device handle isn't a tracker, move on to the next device
@@ -61,7 +78,15 @@ int TrackerDeviceEnumerator::get_vendor_id() const
 	USBDeviceFilter devInfo;
 	int vendor_id = -1;
 
-	if (is_valid() && usb_device_enumerator_get_filter(m_usb_enumerator, devInfo))
+	if (m_replayStreamIndex != -1)
+	{
+		vendor_id = is_valid() ? m_replayStreams[m_replayStreamIndex].vendor_id : -1;
+	}
+	else if (m_virtualTrackerIndex != -1)
+	{
+		vendor_id = is_valid() ? 0x0000 : -1;
+	}
+	else if (is_valid() && usb_device_enumerator_get_filter(m_usb_enumerator, devInfo))
 	{
 		vendor_id = devInfo.vendor_id;
 	}
@@ -74,7 +99,15 @@ int TrackerDeviceEnumerator::get_product_id() const
 	USBDeviceFilter devInfo;
 	int product_id = -1;
 
-	if (is_valid() && usb_device_enumerator_get_filter(m_usb_enumerator, devInfo))
+	if (m_replayStreamIndex != -1)
+	{
+		product_id = is_valid() ? m_replayStreams[m_replayStreamIndex].product_id : -1;
+	}
+	else if (m_virtualTrackerIndex != -1)
+	{
+		product_id = is_valid() ? 0x0000 : -1;
+	}
+	else if (is_valid() && usb_device_enumerator_get_filter(m_usb_enumerator, devInfo))
 	{
 		product_id = devInfo.product_id;
 	}
@@ -97,6 +130,16 @@ const char *TrackerDeviceEnumerator::get_path() const
 
 bool TrackerDeviceEnumerator::is_valid() const
 {
+	if (m_replayStreamIndex != -1)
+	{
+		return m_replayStreamIndex < static_cast<int>(m_replayStreams.size());
+	}
+
+	if (m_virtualTrackerIndex != -1)
+	{
+		return m_virtualTrackerIndex < virtual_tracker_count;
+	}
+
 	return m_usb_enumerator != nullptr && usb_device_enumerator_is_valid(m_usb_enumerator);
 }
 
@@ -105,16 +148,41 @@ bool TrackerDeviceEnumerator::next()
 	USBDeviceManager *usbRequestMgr = USBDeviceManager::getInstance();
 	bool foundValid = false;
 
-	while (is_valid() && !foundValid)
+	if (DeviceCapture::get_is_replaying())
 	{
-		usb_device_enumerator_next(m_usb_enumerator);
+		++m_replayStreamIndex;
 
-		if (testUSBEnumerator())
+		if (is_valid())
 		{
-			foundValid= true;
+			strncpy(m_currentUSBPath, m_replayStreams[m_replayStreamIndex].path.c_str(), sizeof(m_currentUSBPath));
+			m_currentUSBPath[sizeof(m_currentUSBPath) - 1] = '\0';
+			m_deviceType = m_replayStreams[m_replayStreamIndex].device_type;
+			m_cameraIndex = m_replayStreamIndex;
+			foundValid = true;
+		}
+
+		return foundValid;
+	}
+
+	if (m_virtualTrackerIndex == -1)
+	{
+		while (is_valid() && !foundValid)
+		{
+			usb_device_enumerator_next(m_usb_enumerator);
+
+			if (testUSBEnumerator())
+			{
+				foundValid= true;
+			}
 		}
 	}
 
+	// Move on to the virtual trackers once we run out of USB cameras
+	if (!foundValid)
+	{
+		foundValid= nextVirtualTracker();
+	}
+
 	if (foundValid)
 	{
 		++m_cameraIndex;
@@ -152,6 +220,28 @@ bool TrackerDeviceEnumerator::testUSBEnumerator()
 	return foundValid;
 }
 
+bool TrackerDeviceEnumerator::nextVirtualTracker()
+{
+	bool foundValid= false;
+
+	if (m_virtualTrackerIndex < virtual_tracker_count &&
+		(m_deviceTypeFilter == CommonDeviceState::INVALID_DEVICE_TYPE ||
+		 m_deviceTypeFilter == CommonDeviceState::VirtualTracker))
+	{
+		++m_virtualTrackerIndex;
+
+		if (m_virtualTrackerIndex < virtual_tracker_count)
+		{
+			snprintf(m_currentUSBPath, sizeof(m_currentUSBPath), "VirtualTracker_%d", m_virtualTrackerIndex);
+			m_deviceType= CommonDeviceState::VirtualTracker;
+
+			foundValid= true;
+		}
+	}
+
+	return foundValid;
+}
+
 //-- private methods -----
 static bool is_tracker_supported(
 	USBDeviceEnumerator *enumerator, 
@@ -168,7 +258,8 @@ static bool is_tracker_supported(
 		{
 			const USBDeviceFilter &supported_type = k_supported_tracker_infos[tracker_type_index];
 
-			if (devInfo.product_id == supported_type.product_id &&
+			if (supported_type.vendor_id != 0 &&
+				devInfo.product_id == supported_type.product_id &&
 				devInfo.vendor_id == supported_type.vendor_id)
 			{
 				CommonDeviceState::eDeviceType device_type = 
@@ -3,6 +3,7 @@
 
 //-- includes -----
 #include "DeviceEnumerator.h"
+#include "DeviceCapture.h"
 #include "USBApiInterface.h"
 
 //-- definitions -----
@@ -18,15 +19,27 @@ public:
 	int get_product_id() const override;
     const char *get_path() const override;
     inline int get_camera_index() const { return m_cameraIndex; }
+    inline int get_virtual_tracker_index() const { return m_virtualTrackerIndex; }
 	inline struct USBDeviceEnumerator* get_usb_device_enumerator() const { return m_usb_enumerator; }
 
+    // Assigned by the tracker manager on startup
+    static int virtual_tracker_count;
+
 protected: 
 	bool testUSBEnumerator();
+	bool nextVirtualTracker();
 
 private:
     char m_currentUSBPath[256];
 	struct USBDeviceEnumerator* m_usb_enumerator;
     int m_cameraIndex;
+
+	// Cameras recorded in the device capture being replayed
+	std::vector<DeviceCaptureStreamDesc> m_replayStreams;
+	int m_replayStreamIndex;
+
+	// Virtual trackers are listed after all of the USB cameras
+	int m_virtualTrackerIndex;
 };
 
 #endif // TRACKER_DEVICE_ENUMERATOR_H
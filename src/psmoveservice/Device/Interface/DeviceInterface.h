@@ -204,7 +204,8 @@ struct CommonDeviceState
         SUPPORTED_CONTROLLER_TYPE_COUNT = Controller + 0x04,
         
         PS3EYE = TrackingCamera + 0x00,
-        SUPPORTED_CAMERA_TYPE_COUNT = TrackingCamera + 0x01,
+        VirtualTracker = TrackingCamera + 0x01,
+        SUPPORTED_CAMERA_TYPE_COUNT = TrackingCamera + 0x02,
         
         Morpheus = HeadMountedDisplay + 0x00,
         VirtualHMD = HeadMountedDisplay + 0x01,
@@ -245,6 +246,9 @@ struct CommonDeviceState
         case PS3EYE:
             result = "PSEYE";
             break;
+        case VirtualTracker:
+            result = "VirtualTracker";
+            break;
         case Morpheus:
             result = "Morpheus";
             break;
@@ -512,6 +516,7 @@ public:
         CL,
         CLMulti,
         Generic_Webcam,
+        Virtual,
 
         SUPPORTED_DRIVER_TYPE_COUNT,
     };
@@ -547,6 +552,9 @@ public:
         case Generic_Webcam:
             result = "Generic_Webcam";
             break;
+        case Virtual:
+            result = "Virtual";
+            break;
         default:
             result = "UNKNOWN";
         }
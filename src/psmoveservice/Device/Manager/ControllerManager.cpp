@@ -9,6 +9,7 @@
 #include "ServerControllerView.h"
 #include "ServerDeviceView.h"
 #include "ServerNetworkManager.h"
+#include "ServerScope.h"
 #include "ServerUtility.h"
 #include "VirtualControllerEnumerator.h"
 
@@ -132,8 +133,15 @@ ControllerManager::updateStateAndPredict(TrackerManager* tracker_manager)
 		if (controllerView->getIsOpen() && 
             (controllerView->getIsBluetooth() || controllerView->getIsVirtualController()))
 		{
-			controllerView->updateOpticalPoseEstimation(tracker_manager);
-			controllerView->updateStateAndPredict();
+			{
+				SERVER_STAGE_SCOPE("ServerControllerView::updateOpticalPoseEstimation", ServerStage_OpticalPoseEstimation, ServerStageDevice_Controller, device_id);
+				controllerView->updateOpticalPoseEstimation(tracker_manager);
+			}
+
+			{
+				SERVER_STAGE_SCOPE("ServerControllerView::updateStateAndPredict", ServerStage_FilterUpdate, ServerStageDevice_Controller, device_id);
+				controllerView->updateStateAndPredict();
+			}
 		}
 	}
 }
@@ -15,6 +15,7 @@
 #include "ServerLog.h"
 #include "ServerDeviceView.h"
 #include "ServerNetworkManager.h"
+#include "ServerScope.h"
 #include "ServerUtility.h"
 #include "PSMoveProtocol.pb.h"
 #include "PSMoveConfig.h"
@@ -194,21 +195,48 @@ DeviceManager::startup()
 void
 DeviceManager::update()
 {
+    SERVER_STAGE_SCOPE("DeviceManager::update", ServerStage_Tick, ServerStageDevice_System, -1);
+
 	if (m_platform_api != nullptr)
 	{
+        SERVER_PHASE_SCOPE("IPlatformDeviceAPI::poll", ServerAllocationPhase_PlatformPoll);
 		m_platform_api->poll(); // Send device hotplug events
 	}
 
-    m_controller_manager->poll(); // Update controller counts and poll button/IMU state
-    m_tracker_manager->poll(); // Update tracker count and poll video frames
-    m_hmd_manager->poll(); // Update HMD count and poll IMU state
+    {
+        SERVER_PHASE_SCOPE("ControllerManager::poll", ServerAllocationPhase_ControllerPoll);
+        m_controller_manager->poll(); // Update controller counts and poll button/IMU state
+    }
+    {
+        SERVER_PHASE_SCOPE("TrackerManager::poll", ServerAllocationPhase_TrackerPoll);
+        m_tracker_manager->poll(); // Update tracker count and poll video frames
+    }
+    {
+        SERVER_PHASE_SCOPE("HMDManager::poll", ServerAllocationPhase_HMDPoll);
+        m_hmd_manager->poll(); // Update HMD count and poll IMU state
+    }
 
-    m_controller_manager->updateStateAndPredict(m_tracker_manager); // Compute pose/prediction of tracking blob+IMU state
-    m_hmd_manager->updateStateAndPredict(m_tracker_manager); // Compute pose/prediction of tracking blobs+IMU state
+    {
+        SERVER_PHASE_SCOPE("ControllerManager::updateStateAndPredict", ServerAllocationPhase_ControllerUpdate);
+        m_controller_manager->updateStateAndPredict(m_tracker_manager); // Compute pose/prediction of tracking blob+IMU state
+    }
+    {
+        SERVER_PHASE_SCOPE("HMDManager::updateStateAndPredict", ServerAllocationPhase_HMDUpdate);
+        m_hmd_manager->updateStateAndPredict(m_tracker_manager); // Compute pose/prediction of tracking blobs+IMU state
+    }
 
-    m_controller_manager->publish(); // publish controller state to any listening clients  (common case)
-    m_tracker_manager->publish(); // publish tracker state to any listening clients (probably only used by ConfigTool)
-    m_hmd_manager->publish(); // publish hmd state to any listening clients (common case)
+    {
+        SERVER_PHASE_SCOPE("ControllerManager::publish", ServerAllocationPhase_ControllerPublish);
+        m_controller_manager->publish(); // publish controller state to any listening clients  (common case)
+    }
+    {
+        SERVER_PHASE_SCOPE("TrackerManager::publish", ServerAllocationPhase_TrackerPublish);
+        m_tracker_manager->publish(); // publish tracker state to any listening clients (probably only used by ConfigTool)
+    }
+    {
+        SERVER_PHASE_SCOPE("HMDManager::publish", ServerAllocationPhase_HMDPublish);
+        m_hmd_manager->publish(); // publish hmd state to any listening clients (common case)
+    }
 }
 
 void
@@ -4,6 +4,7 @@
 #include "ServerLog.h"
 #include "ServerHMDView.h"
 #include "ServerDeviceView.h"
+#include "ServerScope.h"
 #include "PSMoveProtocol.pb.h"
 #include <boost/foreach.hpp>
 #include "VirtualHMDDeviceEnumerator.h"
@@ -91,8 +92,15 @@ HMDManager::updateStateAndPredict(TrackerManager* tracker_manager)
 
 		if (hmdView->getIsOpen())
 		{
-			hmdView->updateOpticalPoseEstimation(tracker_manager);
-			hmdView->updateStateAndPredict();
+			{
+				SERVER_STAGE_SCOPE("ServerHMDView::updateOpticalPoseEstimation", ServerStage_OpticalPoseEstimation, ServerStageDevice_HMD, device_id);
+				hmdView->updateOpticalPoseEstimation(tracker_manager);
+			}
+
+			{
+				SERVER_STAGE_SCOPE("ServerHMDView::updateStateAndPredict", ServerStage_FilterUpdate, ServerStageDevice_HMD, device_id);
+				hmdView->updateStateAndPredict();
+			}
 		}
 	}
 }
@@ -29,6 +29,7 @@ TrackerManagerConfig::TrackerManagerConfig(const std::string &fnamebase)
 	exclude_opposed_cameras = false;
 	min_valid_projection_area= 16;
 	disable_roi = false;
+	virtual_tracker_count = 0;
 	default_tracker_profile.frame_width = 640;
 	//default_tracker_profile.frame_height = 480;
 	default_tracker_profile.frame_rate = 40;
@@ -61,6 +62,8 @@ TrackerManagerConfig::config2ptree()
 
 	pt.put("disable_roi", disable_roi);
 
+	pt.put("virtual_tracker_count", virtual_tracker_count);
+
 	pt.put("default_tracker_profile.frame_width", default_tracker_profile.frame_width);
 	//pt.put("default_tracker_profile.frame_height", default_tracker_profile.frame_height);
 	pt.put("default_tracker_profile.frame_rate", default_tracker_profile.frame_rate);
@@ -89,6 +92,7 @@ TrackerManagerConfig::ptree2config(const boost::property_tree::ptree &pt)
 		exclude_opposed_cameras = pt.get<bool>("excluded_opposed_cameras", exclude_opposed_cameras);
 		min_valid_projection_area = pt.get<float>("min_valid_projection_area", min_valid_projection_area);	
 		disable_roi = pt.get<bool>("disable_roi", disable_roi);
+		virtual_tracker_count = pt.get<int>("virtual_tracker_count", 0);
 		default_tracker_profile.frame_width = pt.get<float>("default_tracker_profile.frame_width", 640);
 		//default_tracker_profile.frame_height = pt.get<float>("default_tracker_profile.frame_height", 480);
 		default_tracker_profile.frame_rate = pt.get<float>("default_tracker_profile.frame_rate", 40);
@@ -163,6 +167,10 @@ TrackerManager::startup()
         // Save back out the config in case there were updated defaults
         cfg.save();
 
+        // Copy the virtual tracker count into the Virtual tracker enumerator's static variable.
+        // This breaks the dependency between the Tracker Manager and the enumerator.
+        TrackerDeviceEnumerator::virtual_tracker_count= cfg.virtual_tracker_count;
+
         // Refresh the tracker list
         mark_tracker_list_dirty();
 
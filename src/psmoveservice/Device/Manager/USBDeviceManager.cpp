@@ -6,6 +6,8 @@
 #include "LibUSBApi.h"
 #include "NullUSBApi.h"
 #include "ServerLog.h"
+#include "ServerMetrics.h"
+#include "ServerScope.h"
 #include "ServerUtility.h"
 
 #include <atomic>
@@ -25,6 +27,8 @@ const char * k_nullusb_api_name= "nullusb_api";
 const char * k_libusb_api_name= "libusb_api";
 const char * k_winusb_api_name= "winusb_api";
 
+static const size_t k_usb_transfer_queue_capacity= 128;
+
 //-- private implementation -----
 
 //-- USB Manager Config -----
@@ -160,6 +164,15 @@ public:
 
     void update()
     {
+        // The device thread produces the requests and consumes the results,
+        // so these are the queue sizes as seen from the only side allowed to look at them
+        ServerMetrics::set_gauge(
+            ServerMetric_USBRequestQueueDepth, -1,
+            static_cast<long long>(k_usb_transfer_queue_capacity - request_queue.write_available()));
+        ServerMetrics::set_gauge(
+            ServerMetric_USBResultQueueDepth, -1,
+            static_cast<long long>(result_queue.read_available()));
+
         // If the thread terminated, reset the started and exited flags
         if (m_exit_signaled)
         {
@@ -404,6 +417,8 @@ protected:
 		USBTransferRequestState requestState;
         while (request_queue.pop(requestState))
         {
+            SERVER_TRACE_SCOPE("USBDeviceManager::processRequest");
+
             switch (requestState.request.request_type)
             {
 			case eUSBTransferRequestType::_USBRequestType_InterruptTransfer:
@@ -428,6 +443,7 @@ protected:
             m_active_control_transfers > 0 ||
 			m_active_interrupt_transfers > 0)
         {
+            SERVER_TRACE_SCOPE("USBDeviceManager::pollTransfers");
             int poll_count = 0;
 
             // If we have a transfer pending, 
@@ -494,6 +510,7 @@ protected:
     void workerThreadFunc()
     {
         ServerUtility::set_current_thread_name("USB Async Worker Thread");
+        SERVER_TRACE_THREAD_NAME("USB Async Worker Thread");
 
         // Stay in the message loop until asked to exit by the main thread
         while (!m_exit_signaled)
@@ -813,8 +830,8 @@ private:
 	IUSBApi *m_usb_api;
     bool m_bUseMultithreading;
     std::atomic_bool m_exit_signaled;
-    boost::lockfree::spsc_queue<USBTransferRequestState, boost::lockfree::capacity<128> > request_queue;
-    boost::lockfree::spsc_queue<USBTransferResultState, boost::lockfree::capacity<128> > result_queue;
+    boost::lockfree::spsc_queue<USBTransferRequestState, boost::lockfree::capacity<k_usb_transfer_queue_capacity> > request_queue;
+    boost::lockfree::spsc_queue<USBTransferResultState, boost::lockfree::capacity<k_usb_transfer_queue_capacity> > result_queue;
 
     // Worker thread state
     std::vector<IUSBBulkTransferBundle *> m_active_bulk_transfer_bundles;
@@ -6,9 +6,9 @@
 #include "DeviceManager.h"
 #include "MathAlignment.h"
 #include "ServerLog.h"
+#include "ServerMetrics.h"
 #include "ServerRequestHandler.h"
-#include "CompoundPoseFilter.h"
-#include "KalmanPoseFilter.h"
+#include "PoseFilterFactory.h"
 #include "PoseFilterInterface.h"
 #include "PSDualShock4Controller.h"
 #include "PSMoveController.h"
@@ -17,6 +17,7 @@
 #include "PSMoveProtocolInterface.h"
 #include "PSMoveProtocol.pb.h"
 #include "ServerUtility.h"
+#include "ServerScope.h"
 #include "ServerTrackerView.h"
 
 #include <glm/glm.hpp>
@@ -30,12 +31,6 @@ static const float k_max_time_delta_seconds = 1 / 30.f;
     bitmask|= (button_state == CommonControllerState::Button_DOWN || button_state == CommonControllerState::Button_PRESSED) ? (0x1 << (bit_index)) : 0x0;
 
 //-- private methods -----
-static IPoseFilter *pose_filter_factory(
-    const CommonDeviceState::eDeviceType deviceType,
-    const std::string &position_filter_type,
-    const std::string &orientation_filter_type,
-    const PoseFilterConstants &constants);
-
 static void init_filters_for_psmove(
     const PSMoveController *psmoveController, 
     PoseFilterSpace **out_pose_filter_space,
@@ -115,6 +110,7 @@ ServerControllerView::ServerControllerView(const int device_id)
     , m_lastPollSeqNumProcessed(-1)
     , m_last_filter_update_timestamp()
     , m_last_filter_update_timestamp_valid(false)
+    , m_last_optical_capture_timestamp()
 {
     m_tracking_color = std::make_tuple(0x00, 0x00, 0x00);
     m_LED_override_color = std::make_tuple(0x00, 0x00, 0x00);
@@ -308,6 +304,7 @@ bool ServerControllerView::open(const class DeviceEnumerator *enumerator)
     // Clear the filter update timestamp
     m_last_filter_update_timestamp = std::chrono::time_point<std::chrono::high_resolution_clock>();
     m_last_filter_update_timestamp_valid= false;
+    m_last_optical_capture_timestamp = std::chrono::time_point<std::chrono::high_resolution_clock>();
 
     return bSuccess;
 }
@@ -379,6 +376,8 @@ void ServerControllerView::resetPoseFilter()
 {
     assert(m_device != nullptr);
 
+    ServerMetrics::increment_counter(ServerMetric_ControllerFilterResets, getDeviceID());
+
     if (m_pose_filter != nullptr)
     {
         delete m_pose_filter;
@@ -478,6 +477,12 @@ void ServerControllerView::updateOpticalPoseEstimation(TrackerManager* tracker_m
                             // Actually apply the pose estimate state
                             trackerPoseEstimateRef= newTrackerPoseEstimate;
                             trackerPoseEstimateRef.last_visible_timestamp = now;
+
+                            // Remember the age of the newest video frame the controller was found in
+                            if (tracker->getLastNewDataTimestamp() > m_last_optical_capture_timestamp)
+                            {
+                                m_last_optical_capture_timestamp= tracker->getLastNewDataTimestamp();
+                            }
                         }
                     }
 
@@ -602,6 +607,12 @@ void ServerControllerView::updateStateAndPredict()
     }
     assert(firstLookBackIndex >= 0);
 
+    // The sequence numbers also cover reports that fell out of the state buffer before getting processed
+    const int newestPollSeqNum= getState(0)->PollSequenceNumber;
+    ServerMetrics::increment_counter(
+        ServerMetric_ControllerInputReports, getDeviceID(),
+        (m_lastPollSeqNumProcessed >= 0) ? newestPollSeqNum - m_lastPollSeqNumProcessed : firstLookBackIndex + 1);
+
     // Compute the time in seconds since the last update
     const std::chrono::time_point<std::chrono::high_resolution_clock> now = std::chrono::high_resolution_clock::now();
     float time_delta_seconds;
@@ -1125,6 +1136,18 @@ void ServerControllerView::generate_controller_data_frame_for_stream(
     controller_data_frame->set_sequence_num(controller_view->m_sequence_number);
     controller_data_frame->set_isconnected(controller_view->getDevice()->getIsOpen());
 
+    // Same clock as the latency timestamps and GET_SERVICE_TIME, so clients can map it onto theirs
+    if (controller_view->m_last_filter_update_timestamp_valid)
+    {
+        controller_data_frame->set_server_timestamp_usec(getSteadyTimestampUsec(controller_view->m_last_filter_update_timestamp));
+    }
+
+    // The network send time gets filled in by the network manager
+    PSMoveProtocol::DeviceOutputDataFrame_LatencyTimestamps *latency_timestamps= data_frame->mutable_latency_timestamps();
+    latency_timestamps->set_sensor_arrival_usec(getSteadyTimestampUsec(controller_view->getLastNewDataTimestamp()));
+    latency_timestamps->set_optical_capture_usec(getSteadyTimestampUsec(controller_view->m_last_optical_capture_timestamp));
+    latency_timestamps->set_filter_update_usec(getSteadyTimestampUsec(controller_view->m_last_filter_update_timestamp));
+
     switch (controller_view->getControllerDeviceType())
     {
     case CommonControllerState::PSMove:
@@ -1779,150 +1802,6 @@ static void generate_virtual_controller_data_frame_for_stream(
     controller_data_frame->set_controller_type(PSMoveProtocol::VIRTUALCONTROLLER);
 }
 
-static IPoseFilter *
-pose_filter_factory(
-    const CommonDeviceState::eDeviceType deviceType,
-    const std::string &position_filter_type,
-    const std::string &orientation_filter_type,
-    const PoseFilterConstants &constants)
-{
-    static IPoseFilter *filter= nullptr;
-
-    if (position_filter_type == "PoseKalman" && orientation_filter_type == "PoseKalman")
-    {
-        switch (deviceType)
-        {
-        case CommonDeviceState::PSMove:
-        case CommonDeviceState::VirtualController:
-            {
-                KalmanPoseFilterPSMove *kalmanFilter = new KalmanPoseFilterPSMove();
-                kalmanFilter->init(constants);
-                filter= kalmanFilter;
-            } break;
-        case CommonDeviceState::PSDualShock4:
-            {
-                KalmanPoseFilterDS4 *kalmanFilter = new KalmanPoseFilterDS4();
-                kalmanFilter->init(constants);
-                filter= kalmanFilter;
-            } break;
-        default:
-            assert(0 && "unreachable");
-        }
-    }
-    else
-    {
-        // Convert the position filter type string into an enum
-        PositionFilterType position_filter_enum= PositionFilterTypeNone;
-        if (position_filter_type == "")
-        {
-            position_filter_enum= PositionFilterTypeNone;
-        }
-        else if (position_filter_type == "PassThru")
-        {
-            position_filter_enum= PositionFilterTypePassThru;
-        }
-        else if (position_filter_type == "LowPassOptical")
-        {
-            position_filter_enum= PositionFilterTypeLowPassOptical;
-        }
-        else if (position_filter_type == "LowPassIMU")
-        {
-            position_filter_enum= PositionFilterTypeLowPassIMU;
-        }
-        else if (position_filter_type == "LowPassExponential")
-        {
-            position_filter_enum = PositionFilterTypeLowPassExponential;
-        }
-        else if (position_filter_type == "ComplimentaryOpticalIMU")
-        {
-            position_filter_enum= PositionFilterTypeComplimentaryOpticalIMU;
-        }
-        else if (position_filter_type == "PositionKalman")
-        {
-            position_filter_enum= PositionFilterTypeKalman;
-        }
-        else
-        {
-            SERVER_LOG_INFO("pose_filter_factory()") << 
-                "Unknown position filter type: " << position_filter_type << ". Using default.";
-
-            // fallback to a default based on controller type
-            switch (deviceType)
-            {
-            case CommonDeviceState::PSMove:
-            case CommonDeviceState::VirtualController:
-                position_filter_enum= PositionFilterTypeLowPassExponential;
-                break;
-            case CommonDeviceState::PSDualShock4:
-                position_filter_enum= PositionFilterTypeComplimentaryOpticalIMU;
-                break;
-            default:
-                assert(0 && "unreachable");
-            }
-        }
-        
-        // Convert the orientation filter type string into an enum
-        OrientationFilterType orientation_filter_enum= OrientationFilterTypeNone;
-        if (orientation_filter_type == "")
-        {
-            orientation_filter_enum= OrientationFilterTypeNone;
-        }
-        else if (orientation_filter_type == "PassThru")
-        {
-            orientation_filter_enum= OrientationFilterTypePassThru;
-        }
-        else if (orientation_filter_type == "MadgwickARG")
-        {
-            orientation_filter_enum= OrientationFilterTypeMadgwickARG;
-        }
-        else if (orientation_filter_type == "MadgwickMARG")
-        {
-            orientation_filter_enum= OrientationFilterTypeMadgwickMARG;
-        }
-        else if (orientation_filter_type == "ComplementaryOpticalARG")
-        {
-            orientation_filter_enum= OrientationFilterTypeComplementaryOpticalARG;
-        }
-        else if (orientation_filter_type == "ComplementaryMARG")
-        {
-            orientation_filter_enum= OrientationFilterTypeComplementaryMARG;
-        }
-        else if (orientation_filter_type == "OrientationKalman")
-        {
-            orientation_filter_enum = OrientationFilterTypeKalman;
-        }
-        else
-        {
-            SERVER_LOG_INFO("pose_filter_factory()") << 
-                "Unknown orientation filter type: " << orientation_filter_type << ". Using default.";
-
-            // fallback to a default based on controller type
-            switch (deviceType)
-            {
-            case CommonDeviceState::PSMove:
-                orientation_filter_enum= OrientationFilterTypeComplementaryMARG;
-                break;
-            case CommonDeviceState::PSDualShock4:
-                orientation_filter_enum= OrientationFilterTypeComplementaryOpticalARG;
-                break;
-            case CommonDeviceState::VirtualController:
-                orientation_filter_enum= OrientationFilterTypeNone;
-                break;
-            default:
-                assert(0 && "unreachable");
-            }
-        }
-
-        CompoundPoseFilter *compound_pose_filter = new CompoundPoseFilter();
-        compound_pose_filter->init(deviceType, orientation_filter_enum, position_filter_enum, constants);
-        filter= compound_pose_filter;
-    }
-
-    assert(filter != nullptr);
-
-    return filter;
-}
-
 static void
 init_filters_for_psmove(
     const PSMoveController *psmoveController, 
@@ -2048,6 +1927,7 @@ update_filters_for_psmove(
                 poseFilter,
                 filterPacket);
 
+            SERVER_TRACE_SCOPE("IPoseFilter::update");
             poseFilter->update(delta_time / 2.f, filterPacket);
         }
         }
@@ -2183,6 +2063,7 @@ update_filters_for_psdualshock4(
                 poseFilter,
                 filterPacket);
 
+            SERVER_TRACE_SCOPE("IPoseFilter::update");
             poseFilter->update(delta_time, filterPacket);
         }
     }
@@ -2279,6 +2160,7 @@ static void update_filters_for_virtual_controller(
 			// and the filter's previous orientation and position
 			poseFilterSpace->createFilterPacket(sensorPacket, poseFilter, filterPacket);
 
+			SERVER_TRACE_SCOPE("IPoseFilter::update");
 			poseFilter->update(delta_time, filterPacket);
 		}
 	}
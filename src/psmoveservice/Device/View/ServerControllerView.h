@@ -209,6 +209,8 @@ private:
     int m_lastPollSeqNumProcessed;
     std::chrono::time_point<std::chrono::high_resolution_clock> m_last_filter_update_timestamp;
     bool m_last_filter_update_timestamp_valid;
+    // When the newest tracker video frame the controller was found in arrived
+    std::chrono::time_point<std::chrono::high_resolution_clock> m_last_optical_capture_timestamp;
 };
 
 #endif // SERVER_CONTROLLER_VIEW_H
@@ -1,6 +1,7 @@
 //-- includes -----
 #include "ServerDeviceView.h"
 #include "ServerLog.h"
+#include "ServerScope.h"
 
 #include <chrono>
 
@@ -58,7 +59,14 @@ bool ServerDeviceView::poll()
     // Only poll data from open, bluetooth controllers
     if (device != nullptr && device->getIsReadyToPoll())
     {
-        switch (device->poll())
+        IDeviceInterface::ePollResult poll_result;
+
+        {
+            SERVER_STAGE_SCOPE("IDeviceInterface::poll", ServerStage_DevicePoll, ServerPerformanceStats::get_device_category(device), getDeviceID());
+            poll_result= device->poll();
+        }
+
+        switch (poll_result)
         {
         case IDeviceInterface::_PollResultSuccessNoData:
             {
@@ -110,7 +118,10 @@ void ServerDeviceView::publish()
 {
     if (m_bHasUnpublishedState)
     {
-        publish_device_data_frame();
+        {
+            SERVER_STAGE_SCOPE("ServerDeviceView::publish_device_data_frame", ServerStage_Publish, ServerPerformanceStats::get_device_category(getDevice()), getDeviceID());
+            publish_device_data_frame();
+        }
 
         m_bHasUnpublishedState= false;
         m_sequence_number++;
@@ -127,6 +138,24 @@ ServerDeviceView::close()
     }
 }
 
+unsigned long long
+ServerDeviceView::getSteadyTimestampUsec(const std::chrono::time_point<std::chrono::high_resolution_clock> &timestamp)
+{
+    if (timestamp == std::chrono::time_point<std::chrono::high_resolution_clock>())
+    {
+        return 0;
+    }
+
+    // The two clocks may be different clocks (they are on linux), 
+    // so carry the age of the timestamp over to the steady clock
+    const std::chrono::high_resolution_clock::duration age= std::chrono::high_resolution_clock::now() - timestamp;
+    const std::chrono::steady_clock::time_point steady_timestamp= 
+        std::chrono::steady_clock::now() - std::chrono::duration_cast<std::chrono::steady_clock::duration>(age);
+
+    return static_cast<unsigned long long>(
+        std::chrono::duration_cast<std::chrono::microseconds>(steady_timestamp.time_since_epoch()).count());
+}
+
 bool
 ServerDeviceView::matchesDeviceEnumerator(const DeviceEnumerator *enumerator) const
 {
@@ -55,6 +55,10 @@ public:
     { return m_bHasUnpublishedState; }
     inline std::chrono::time_point<std::chrono::high_resolution_clock> getLastNewDataTimestamp() const
     { return m_lastNewDataTimestamp; }
+
+    // Converts a high resolution clock time (what the views record) to microseconds on the steady clock
+    // used by the data frame latency timestamps. Returns 0 for a time that was never recorded.
+    static unsigned long long getSteadyTimestampUsec(const std::chrono::time_point<std::chrono::high_resolution_clock> &timestamp);
     
     // setters
     inline void markStateAsUnpublished()
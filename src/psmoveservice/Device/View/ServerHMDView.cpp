@@ -8,8 +8,10 @@
 #include "PoseFilterInterface.h"
 #include "PSMoveProtocol.pb.h"
 #include "ServerLog.h"
+#include "ServerMetrics.h"
 #include "ServerRequestHandler.h"
 #include "ServerTrackerView.h"
+#include "ServerScope.h"
 #include "TrackerManager.h"
 
 //-- constants -----
@@ -86,6 +88,7 @@ ServerHMDView::ServerHMDView(const int device_id)
 	, m_lastPollSeqNumProcessed(-1)
 	, m_last_filter_update_timestamp()
 	, m_last_filter_update_timestamp_valid(false)
+	, m_last_optical_capture_timestamp()
 {
 }
 
@@ -243,6 +246,8 @@ void ServerHMDView::resetPoseFilter()
 {
 	assert(m_device != nullptr);
 
+	ServerMetrics::increment_counter(ServerMetric_HMDFilterResets, getDeviceID());
+
 	if (m_pose_filter != nullptr)
 	{
 		delete m_pose_filter;
@@ -338,6 +343,12 @@ void ServerHMDView::updateOpticalPoseEstimation(TrackerManager* tracker_manager)
                             // Actually apply the pose estimate state
                             trackerPoseEstimateRef= newTrackerPoseEstimate;
                             trackerPoseEstimateRef.last_visible_timestamp = now;
+
+                            // Remember the age of the newest video frame the HMD was found in
+                            if (tracker->getLastNewDataTimestamp() > m_last_optical_capture_timestamp)
+                            {
+                                m_last_optical_capture_timestamp= tracker->getLastNewDataTimestamp();
+                            }
                         }
                     }
 
@@ -746,6 +757,18 @@ void ServerHMDView::generate_hmd_data_frame_for_stream(
     hmd_data_frame->set_sequence_num(hmd_view->m_sequence_number);
     hmd_data_frame->set_isconnected(hmd_view->getDevice()->getIsOpen());
 
+    // Same clock as the latency timestamps and GET_SERVICE_TIME, so clients can map it onto theirs
+    if (hmd_view->m_last_filter_update_timestamp_valid)
+    {
+        hmd_data_frame->set_server_timestamp_usec(getSteadyTimestampUsec(hmd_view->m_last_filter_update_timestamp));
+    }
+
+    // The network send time gets filled in by the network manager
+    PSMoveProtocol::DeviceOutputDataFrame_LatencyTimestamps *latency_timestamps= data_frame->mutable_latency_timestamps();
+    latency_timestamps->set_sensor_arrival_usec(getSteadyTimestampUsec(hmd_view->getLastNewDataTimestamp()));
+    latency_timestamps->set_optical_capture_usec(getSteadyTimestampUsec(hmd_view->m_last_optical_capture_timestamp));
+    latency_timestamps->set_filter_update_usec(getSteadyTimestampUsec(hmd_view->m_last_filter_update_timestamp));
+
     switch (hmd_view->getHMDDeviceType())
     {
     case CommonHMDState::Morpheus:
@@ -1040,6 +1063,7 @@ update_filters_for_morpheus_hmd(
 					poseFilter,
 					filterPacket);
 
+				SERVER_TRACE_SCOPE("IPoseFilter::update");
 				poseFilter->update(delta_time / 2.f, filterPacket);
 			}
 		}
@@ -1091,6 +1115,7 @@ update_filters_for_virtual_hmd(
 			// and the filter's previous orientation and position
 			poseFilterSpace->createFilterPacket(sensorPacket, poseFilter, filterPacket);
 
+			SERVER_TRACE_SCOPE("IPoseFilter::update");
 			poseFilter->update(delta_time, filterPacket);
 		}
 	}
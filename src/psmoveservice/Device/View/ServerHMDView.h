@@ -155,6 +155,8 @@ private:
     int m_lastPollSeqNumProcessed;
 	std::chrono::time_point<std::chrono::high_resolution_clock> m_last_filter_update_timestamp;
 	bool m_last_filter_update_timestamp_valid;
+	// When the newest tracker video frame the HMD was found in arrived
+	std::chrono::time_point<std::chrono::high_resolution_clock> m_last_optical_capture_timestamp;
 };
 
 #endif // SERVER_HMD_VIEW_H
\ No newline at end of file
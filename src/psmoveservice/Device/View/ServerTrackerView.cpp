@@ -9,17 +9,21 @@
 #include "MathGLM.h"
 #include "MathAlignment.h"
 #include "PS3EyeTracker.h"
+#include "VirtualTracker.h"
 #include "PSMoveProtocol.pb.h"
 #include "ServerUtility.h"
 #include "ServerLog.h"
+#include "ServerMetrics.h"
 #include "ServerRequestHandler.h"
+#include "ServerScope.h"
 #include "SharedTrackerState.h"
 #include "TrackerManager.h"
+#include "TrackerVision.h"
 #include "PoseFilterInterface.h"
 
 #include <boost/interprocess/shared_memory_object.hpp>
 #include <boost/interprocess/mapped_region.hpp>
-#include <boost/interprocess/sync/scoped_lock.hpp>
+#include <chrono>
 #include <memory>
 
 #include "opencv2/opencv.hpp"
@@ -32,17 +36,6 @@
 //-- constants ----
 static const int k_min_roi_size= 32;
 
-//-- typedefs ----
-typedef std::vector<cv::Point> t_opencv_int_contour;
-typedef std::vector<t_opencv_int_contour> t_opencv_int_contour_list;
-
-typedef std::vector<cv::Point2f> t_opencv_float_contour;
-typedef std::vector<t_opencv_float_contour> t_opencv_float_contour_list;
-
-//-- template utility methods
-template<typename t_opencv_contour_type>
-cv::Point2f computeSafeCenterOfMassForContour(const t_opencv_contour_type &contour);
-
 //-- private methods -----
 class SharedVideoFrameReadWriteAccessor
 {
@@ -84,23 +77,22 @@ public:
                     permissions);
 
             // Resize the shared memory
-            m_shared_memory_object->truncate(SharedVideoFrameHeader::computeTotalSize(stride, width));
+            m_shared_memory_object->truncate(SharedVideoFrameHeader::computeTotalSize(stride, height));
 
             // Map all of the shared memory for read/write access
             m_region = new boost::interprocess::mapped_region(*m_shared_memory_object, boost::interprocess::read_write);
 
             // Initialize the shared memory (call constructor using placement new)
-            // This make sure the mutex has the constructor called on it.
-            SharedVideoFrameHeader *frameState = new (getFrameHeader()) SharedVideoFrameHeader();
-            
-            frameState->width = width;
-            frameState->height = height;
-            frameState->stride = stride;
-            frameState->frame_index = 0;
-            std::memset(
-                frameState->getBufferMutable(),
-                0,
-                SharedVideoFrameHeader::computeVideoBufferSize(stride, height));
+            // This make sure the slot sequence numbers have the constructor called on them.
+            SharedVideoFrameHeader *frameState = new (getFrameHeader()) SharedVideoFrameHeader(width, height, stride);
+
+            for (int slot_index = 0; slot_index < SHARED_VIDEO_FRAME_SLOT_COUNT; ++slot_index)
+            {
+                std::memset(
+                    frameState->getSlotBufferMutable(slot_index),
+                    0,
+                    SharedVideoFrameHeader::computeVideoBufferSize(stride, height));
+            }
 
             bSuccess = true;
         }
@@ -119,7 +111,6 @@ public:
         if (m_region != nullptr)
         {
             // Call the destructor manually on the frame header since it was constructed via placement new
-            // This will make sure the mutex has the destructor called on it.
             getFrameHeader()->~SharedVideoFrameHeader();
             
             delete m_region;
@@ -138,19 +129,22 @@ public:
         }
     }
 
-    void writeVideoFrame(const unsigned char *buffer)
+    bool writeVideoFrame(const unsigned char *buffer, const std::chrono::steady_clock::time_point &capture_time)
     {
         SharedVideoFrameHeader *sharedFrameState = getFrameHeader();
-        boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex> lock(sharedFrameState->mutex);
 
-        size_t buffer_size = 
-            SharedVideoFrameHeader::computeVideoBufferSize(sharedFrameState->stride, sharedFrameState->height);
         size_t total_shared_mem_size =
             SharedVideoFrameHeader::computeTotalSize(sharedFrameState->stride, sharedFrameState->height);
         assert(m_region->get_size() >= total_shared_mem_size);
 
-        ++sharedFrameState->frame_index;
-        std::memcpy(sharedFrameState->getBufferMutable(), buffer, buffer_size);
+        // Lock-free: writes into a slot no reader is looking at, then publishes it
+        if (!sharedFrameState->writeVideoFrame(buffer, SharedVideoFrameHeader::getTimestampUsec(capture_time)))
+        {
+            SERVER_LOG_TRACE("SharedMemory::writeVideoFrame") << "Dropped video frame, all free slots are leased: " << m_shared_memory_name;
+            return false;
+        }
+
+        return true;
     }
 
 protected:
@@ -248,90 +242,6 @@ struct OpenCVPlane2D
     }
 };
 
-class OpenCVBGRToHSVMapper
-{
-public:
-    typedef cv::Point3_<uint8_t> ColorTuple;
-
-    static OpenCVBGRToHSVMapper *allocate()
-    {
-        if (m_refCount == 0)
-        {
-            assert(m_instance == nullptr);
-            m_instance = new OpenCVBGRToHSVMapper();
-        }
-        assert(m_instance != nullptr);
-
-        ++m_refCount;
-        return m_instance;
-    }
-
-    static void dispose(OpenCVBGRToHSVMapper *instance)
-    {
-        assert(m_instance != nullptr);
-        assert(m_instance == instance);
-        assert(m_refCount > 0);
-
-        --m_refCount;
-        if (m_refCount <= 0)
-        {
-            delete m_instance;
-            m_instance = nullptr;
-        }
-    }
-
-    void cvtColor(const cv::Mat &bgrBuffer, cv::Mat &hsvBuffer)
-    {
-        hsvBuffer.forEach<ColorTuple>([&bgrBuffer, this](ColorTuple &hsvColor, const int position[]) -> void {
-            const ColorTuple &bgrColor = bgrBuffer.at<ColorTuple>(position[0], position[1]);
-            const int b = bgrColor.x;
-            const int g = bgrColor.y;
-            const int r = bgrColor.z;
-            const int LUTIndex = OpenCVBGRToHSVMapper::getLUTIndex(r, g, b);
-
-            hsvColor = bgr2hsv->at<ColorTuple>(LUTIndex, 0);
-        });
-    }
-
-private:
-    static OpenCVBGRToHSVMapper *m_instance;
-    static int m_refCount;
-
-    OpenCVBGRToHSVMapper()
-    {
-        bgr2hsv = new cv::Mat(256*256*256, 1, CV_8UC3);
-
-        int LUTIndex = 0;
-        for (int r = 0; r < 256; ++r)
-        {
-            for (int g = 0; g < 256; ++g)
-            {
-                for (int b = 0; b < 256; ++b)
-                {
-                    bgr2hsv->at<ColorTuple>(LUTIndex, 0) = ColorTuple(b, g, r);
-                    ++LUTIndex;
-                }
-            }
-        }
-
-        cv::cvtColor(*bgr2hsv, *bgr2hsv, cv::COLOR_BGR2HSV);
-    }
-
-    ~OpenCVBGRToHSVMapper()
-    {
-        delete bgr2hsv;
-    }
-
-    static int getLUTIndex(int r, int g, int b)
-    {
-        return (256 * 256)*r + 256*g + b;
-    }
-
-    cv::Mat *bgr2hsv;
-};
-OpenCVBGRToHSVMapper *OpenCVBGRToHSVMapper::m_instance = nullptr;
-int OpenCVBGRToHSVMapper::m_refCount= 0;
-
 class OpenCVBufferState
 {
 public:
@@ -410,6 +320,8 @@ public:
 
         videoBufferMat.copyTo(*bgrBuffer);
         videoBufferMat.copyTo(*bgrShmemBuffer);
+
+        captureTime = std::chrono::steady_clock::now();
     }
     
     void updateHsvBuffer()
@@ -475,133 +387,16 @@ public:
         const int max_contour_count,
         const int min_points_in_contour = 6)
     {
-        out_biggest_N_contours.clear();
-        out_contour_areas.clear();
-        
         // Clamp the HSV image, taking into account wrapping the hue angle
-        {
-            const float hue_min = hsvColorRange.hue_range.center - hsvColorRange.hue_range.range;
-            const float hue_max = hsvColorRange.hue_range.center + hsvColorRange.hue_range.range;
-            const float saturation_min = clampf(hsvColorRange.saturation_range.center - hsvColorRange.saturation_range.range, 0, 255);
-            const float saturation_max = clampf(hsvColorRange.saturation_range.center + hsvColorRange.saturation_range.range, 0, 255);
-            const float value_min = clampf(hsvColorRange.value_range.center - hsvColorRange.value_range.range, 0, 255);
-            const float value_max = clampf(hsvColorRange.value_range.center + hsvColorRange.value_range.range, 0, 255);
-
-            if (hue_min < 0)
-            {
-                cv::inRange(
-                    hsvROI,
-                    cv::Scalar(0, saturation_min, value_min),
-                    cv::Scalar(clampf(hue_max, 0, 180), saturation_max, value_max),
-                    gsLowerROI);
-                cv::inRange(
-                    hsvROI,
-                    cv::Scalar(clampf(180 + hue_min, 0, 180), saturation_min, value_min),
-                    cv::Scalar(180, saturation_max, value_max),
-                    gsUpperROI);
-                cv::bitwise_or(gsLowerROI, gsUpperROI, gsLowerROI);
-            }
-            else if (hue_max > 180)
-            {
-                cv::inRange(
-                    hsvROI,
-                    cv::Scalar(0, saturation_min, value_min),
-                    cv::Scalar(clampf(hue_max - 180, 0, 180), saturation_max, value_max),
-                    gsLowerROI);
-                cv::inRange(
-                    hsvROI,
-                    cv::Scalar(clampf(hue_min, 0, 180), saturation_min, value_min),
-                    cv::Scalar(180, saturation_max, value_max),
-                    gsUpperROI);
-                cv::bitwise_or(gsLowerROI, gsUpperROI, gsLowerROI);
-            }
-            else
-            {
-                cv::inRange(
-                    hsvROI,
-                    cv::Scalar(hue_min, saturation_min, value_min),
-                    cv::Scalar(hue_max, saturation_max, value_max),
-                    gsLowerROI);
-            }
-        }
+        computeHSVRangeMask(hsvROI, hsvColorRange, gsLowerROI, gsUpperROI);
         
         //TODO: Why no blurring of the gsLowerBuffer?
 
         // Find the largest convex blob in the filtered grayscale buffer
-        {
-            struct ContourInfo
-            {
-                int contour_index;
-                double contour_area;
-            };
-            std::vector<ContourInfo> sorted_contour_list;
-
-            // Find all counters in the image buffer
-            cv::Size size; cv::Point ofs;
-            gsLowerROI.locateROI(size, ofs);
-            t_opencv_int_contour_list contours;
-            cv::findContours(gsLowerROI,
-                             contours,
-                             CV_RETR_EXTERNAL,
-                             CV_CHAIN_APPROX_SIMPLE,  //CV_CHAIN_APPROX_NONE?
-                             ofs);
-
-            // Compute the area of each contour
-            int contour_index = 0;
-            for (auto it = contours.begin(); it != contours.end(); ++it) 
-            {
-                const double contour_area = cv::contourArea(*it);
-                const ContourInfo contour_info = { contour_index, contour_area };
-
-                sorted_contour_list.push_back(contour_info);
-                ++contour_index;
-            }
-            
-            // Sort the list of contours by area, largest to smallest
-            if (sorted_contour_list.size() > 1)
-            {
-                std::sort(
-                    sorted_contour_list.begin(), sorted_contour_list.end(), 
-                    [](const ContourInfo &a, const ContourInfo &b) {
-                        return b.contour_area < a.contour_area;
-                });
-            }
-
-            // Copy up to N valid contours
-            for (auto it = sorted_contour_list.begin(); 
-                it != sorted_contour_list.end() && static_cast<int>(out_biggest_N_contours.size()) < max_contour_count; 
-                ++it)
-            {
-                const ContourInfo &contour_info = *it;
-                t_opencv_int_contour &contour = contours[contour_info.contour_index];
-
-                if (contour.size() > min_points_in_contour)
-                {
-                    // Remove any points in contour on edge of camera/ROI
-                    // TODO: Contours touching image border will be clipped,
-                    // so this might not be necessary.
-                    t_opencv_int_contour::iterator it = contour.begin();
-                    while (it != contour.end()) 
-                    {
-                        if (it->x == 0 || it->x == (frameWidth - 1) || it->y == 0 || it->y == (frameHeight - 1))
-                        {
-                            it = contour.erase(it);
-                        }
-                        else
-                        {
-                            ++it;
-                        }
-                    }
-
-                    // Add cleaned up contour to the output list
-                    out_biggest_N_contours.push_back(contour);
-                    // Add its area to the output list too.
-                    out_contour_areas.push_back(contour_info.contour_area);
-                }
-            }
-        }
-
-        return (out_biggest_N_contours.size() > 0);
+        return computeBiggestNContoursInMask(
+            gsLowerROI, frameWidth, frameHeight,
+            out_biggest_N_contours, out_contour_areas,
+            max_contour_count, min_points_in_contour);
     }
     
     void
@@ -700,6 +495,7 @@ public:
 
     cv::Mat *bgrBuffer; // source video frame
     cv::Mat *bgrShmemBuffer; //Frame onto which we draw debug lines, and transmit via shared mem.
+    std::chrono::steady_clock::time_point captureTime; // When the source video frame was received
     cv::Mat bgrROI;
     cv::Mat *hsvBuffer; // source frame converted to HSV color space
     cv::Mat hsvROI;
@@ -743,19 +539,6 @@ static cv::Rect2i computeTrackerROIForPoseProjection(
     const IPoseFilter* pose_filter,
     const CommonDeviceTrackingProjection *prior_tracking_projection,
     const CommonDeviceTrackingShape *tracking_shape);
-static bool computeBestFitTriangleForContour(
-    const t_opencv_float_contour &opencv_contour,
-    cv::Point2f &out_triangle_top,
-    cv::Point2f &out_triangle_bottom_left,
-    cv::Point2f &out_triangle_bottom_right);
-static bool computeBestFitQuadForContour(
-    const t_opencv_float_contour &opencv_contour,
-    const cv::Point2f &up_hint, 
-    const cv::Point2f &right_hint,
-    cv::Point2f &top_right,
-    cv::Point2f &top_left,
-    cv::Point2f &bottom_left,
-    cv::Point2f &bottom_right);
 static void commonDeviceOrientationToOpenCVRodrigues(
     const CommonDeviceQuaternion &orientation,
     cv::Mat &rvec);
@@ -777,7 +560,7 @@ ServerTrackerView::ServerTrackerView(const int device_id)
     , m_opencv_buffer_state(nullptr)
     , m_device(nullptr)
 {
-    ServerUtility::format_string(m_shared_memory_name, sizeof(m_shared_memory_name), "tracker_view_%d", device_id);
+    ServerUtility::format_string(m_shared_memory_name, sizeof(m_shared_memory_name), SHARED_VIDEO_FRAME_NAME_PREFIX "%d", device_id);
 }
 
 ServerTrackerView::~ServerTrackerView()
@@ -883,10 +666,31 @@ void ServerTrackerView::stopSharedMemoryVideoStream()
 
 bool ServerTrackerView::poll()
 {
+    const std::chrono::time_point<std::chrono::high_resolution_clock> previous_frame_timestamp= getLastNewDataTimestamp();
     bool bSuccess = ServerDeviceView::poll();
 
     if (bSuccess && m_device != nullptr)
     {
+        // The new data timestamp only moves when the poll grabbed a frame
+        if (getLastNewDataTimestamp() != previous_frame_timestamp)
+        {
+            ServerMetrics::increment_counter(ServerMetric_TrackerFramesGrabbed, getDeviceID());
+
+            // Estimate the frames the camera skipped from the gap since the last one (there is no gap before the first frame)
+            const double frame_rate= m_device->getFrameRate();
+
+            if (previous_frame_timestamp.time_since_epoch().count() != 0 && frame_rate > 0.0)
+            {
+                const std::chrono::duration<double> frame_gap= getLastNewDataTimestamp() - previous_frame_timestamp;
+                const long long missing_frame_count= static_cast<long long>(frame_gap.count() * frame_rate + 0.5) - 1;
+
+                if (missing_frame_count > 0)
+                {
+                    ServerMetrics::increment_counter(ServerMetric_TrackerFramesDropped, getDeviceID(), missing_frame_count);
+                }
+            }
+        }
+
         const unsigned char *buffer = m_device->getVideoFrameBuffer();
 
         if (buffer != nullptr)
@@ -894,6 +698,7 @@ bool ServerTrackerView::poll()
             // Cache the raw video frame
             if (m_opencv_buffer_state != nullptr)
             {
+                SERVER_TRACE_SCOPE_ID("OpenCVBufferState::writeVideoFrame", getDeviceID());
                 m_opencv_buffer_state->writeVideoFrame(buffer);
             }
         }
@@ -910,6 +715,10 @@ bool ServerTrackerView::allocate_device_interface(const class DeviceEnumerator *
     {
         m_device = new PS3EyeTracker();
     } break;
+    case CommonDeviceState::VirtualTracker:
+    {
+        m_device = new VirtualTracker();
+    } break;
     default:
         break;
     }
@@ -934,7 +743,12 @@ void ServerTrackerView::publish_device_data_frame()
     // Copy the video frame to shared memory (if requested)
     if (m_shared_memory_accesor != nullptr && m_shared_memory_video_stream_count > 0)
     {
-        m_shared_memory_accesor->writeVideoFrame(m_opencv_buffer_state->bgrShmemBuffer->data);
+        if (!m_shared_memory_accesor->writeVideoFrame(
+                m_opencv_buffer_state->bgrShmemBuffer->data, 
+                m_opencv_buffer_state->captureTime))
+        {
+            ServerMetrics::increment_counter(ServerMetric_TrackerVideoStreamFramesDropped, getDeviceID());
+        }
     }
     
     // Tell the server request handler we want to send out tracker updates.
@@ -955,12 +769,19 @@ void ServerTrackerView::generate_tracker_data_frame_for_stream(
     tracker_data_frame->set_sequence_num(tracker_view->m_sequence_number);
     tracker_data_frame->set_isconnected(tracker_view->getIsOpen());
 
+    // A tracker's sensor data is its video frame, the network send time gets filled in by the network manager
+    PSMoveProtocol::DeviceOutputDataFrame_LatencyTimestamps *latency_timestamps= data_frame->mutable_latency_timestamps();
+    latency_timestamps->set_sensor_arrival_usec(getSteadyTimestampUsec(tracker_view->getLastNewDataTimestamp()));
+    latency_timestamps->set_optical_capture_usec(latency_timestamps->sensor_arrival_usec());
+
     switch (tracker_view->getTrackerDeviceType())
     {
     case CommonDeviceState::PS3EYE:
         {
             //TODO: PS3EYE tracker location
         } break;
+    case CommonDeviceState::VirtualTracker:
+        break;
     default:
         assert(0 && "Unhandled Tracker type");
     }
@@ -1240,6 +1061,7 @@ ServerTrackerView::computeProjectionForController(
     const CommonDeviceTrackingShape *tracking_shape,
     ControllerOpticalPoseEstimation *out_pose_estimate)
 {
+    SERVER_TRACE_SCOPE_ID("ServerTrackerView::computeProjectionForController", getDeviceID());
     bool bSuccess = true;
 
     // Get the HSV filter used to find the tracking blob
@@ -1280,12 +1102,15 @@ ServerTrackerView::computeProjectionForController(
     std::vector<double> contour_areas;
     if (bSuccess)
     {
+        SERVER_TRACE_SCOPE_ID("OpenCVBufferState::computeBiggestNContours", getDeviceID());
         bSuccess = m_opencv_buffer_state->computeBiggestNContours(hsvColorRange, biggest_contours, contour_areas, 1);
     }
     
     // Process the contour for its 2D and 3D pose.
     if (bSuccess)
     {
+        SERVER_TRACE_SCOPE_ID("ServerTrackerView::fitProjectionToContours", getDeviceID());
+
         // Get camera parameters.
         // Needed for undistortion.
         cv::Matx33f camera_matrix;
@@ -1423,6 +1248,7 @@ bool ServerTrackerView::computeProjectionForHMD(
     const struct CommonDeviceTrackingShape *tracking_shape,
     struct HMDOpticalPoseEstimation *out_pose_estimate)
 {
+    SERVER_TRACE_SCOPE_ID("ServerTrackerView::computeProjectionForHMD", getDeviceID());
     bool bSuccess = true;
 
     // Get the HSV filter used to find the tracking blob
@@ -1462,6 +1288,7 @@ bool ServerTrackerView::computeProjectionForHMD(
     std::vector<double> contour_areas;
     if (bSuccess)
     {
+        SERVER_TRACE_SCOPE_ID("OpenCVBufferState::computeBiggestNContours", getDeviceID());
         bSuccess = 
             m_opencv_buffer_state->computeBiggestNContours(
                 hsvColorRange, biggest_contours, contour_areas, CommonDeviceTrackingProjection::MAX_POINT_CLOUD_POINT_COUNT);
@@ -1470,6 +1297,8 @@ bool ServerTrackerView::computeProjectionForHMD(
     // Compute the tracker relative 3d position of the controller from the contour
     if (bSuccess)
     {
+        SERVER_TRACE_SCOPE_ID("ServerTrackerView::fitProjectionToContours", getDeviceID());
+
         cv::Matx33f camera_matrix;
         cv::Matx<float, 5, 1> distortions;
         computeOpenCVCameraIntrinsicMatrix(m_device, camera_matrix, distortions);
@@ -2471,200 +2300,6 @@ static cv::Rect2i computeTrackerROIForPoseProjection(
     return ROI;
 }
 
-static bool computeBestFitTriangleForContour(
-    const t_opencv_float_contour &opencv_contour,
-    cv::Point2f &out_triangle_top,
-    cv::Point2f &out_triangle_bottom_left,
-    cv::Point2f &out_triangle_bottom_right)
-{
-    // Compute the tightest possible bounding triangle for the given contour
-    t_opencv_float_contour cv_min_triangle;
-
-    try
-    {
-        cv::minEnclosingTriangle(opencv_contour, cv_min_triangle);
-    }
-    catch( cv::Exception& e )
-    {
-        SERVER_LOG_INFO("computeBestFitTriangleForContour") << e.what();
-        return false;
-    }
-
-    if (cv_min_triangle.size() != 3)
-    {
-        return false;
-    }
-
-    cv::Point2f best_fit_origin_01 = (cv_min_triangle[0] + cv_min_triangle[1]) / 2.f;
-    cv::Point2f best_fit_origin_12 = (cv_min_triangle[1] + cv_min_triangle[2]) / 2.f;
-    cv::Point2f best_fit_origin_20 = (cv_min_triangle[2] + cv_min_triangle[0]) / 2.f;
-
-    t_opencv_float_contour cv_midpoint_triangle;
-    cv_midpoint_triangle.push_back(best_fit_origin_01);
-    cv_midpoint_triangle.push_back(best_fit_origin_12);
-    cv_midpoint_triangle.push_back(best_fit_origin_20);
-
-    // Find the corner closest to the center of mass.
-    // This is the bottom of the triangle.
-    int topCornerIndex = -1;
-    {
-        const cv::Point2f massCenter = computeSafeCenterOfMassForContour<t_opencv_float_contour>(opencv_contour);
-
-        double bestDistance = k_real_max;
-        for (int cornerIndex = 0; cornerIndex < 3; ++cornerIndex)
-        {
-            const double testDistance = cv::norm(cv_midpoint_triangle[cornerIndex] - massCenter);
-
-            if (testDistance < bestDistance)
-            {
-                topCornerIndex = cornerIndex;
-                bestDistance = testDistance;
-            }
-        }
-    }
-
-    // Assign the left and right corner indices
-    int leftCornerIndex = -1;
-    int rightCornerIndex = -1;
-    switch (topCornerIndex)
-    {
-    case 0:
-        leftCornerIndex = 1;
-        rightCornerIndex = 2;
-        break;
-    case 1:
-        leftCornerIndex = 0;
-        rightCornerIndex = 2;
-        break;
-    case 2:
-        leftCornerIndex = 0;
-        rightCornerIndex = 1;
-        break;
-    default:
-        assert(0 && "unreachable");
-    }
-
-    // Make sure the left and right corners are actually 
-    // on the left and right of the triangle
-    out_triangle_top = cv_midpoint_triangle[topCornerIndex];
-    out_triangle_bottom_left = cv_midpoint_triangle[leftCornerIndex];
-    out_triangle_bottom_right = cv_midpoint_triangle[rightCornerIndex];
-
-    const cv::Point2f topToLeft = out_triangle_bottom_left - out_triangle_top;
-    const cv::Point2f topToRight = out_triangle_bottom_right - out_triangle_top;
-
-    // Cross product should be positive if sides are correct
-    // If not, then swap them.
-    if (topToRight.cross(topToLeft) < 0)
-    {
-        std::swap(out_triangle_bottom_left, out_triangle_bottom_right);
-    }
-
-    return true;
-}
-
-static bool computeBestFitQuadForContour(
-    const t_opencv_float_contour &opencv_contour,
-    const cv::Point2f &up_hint, 
-    const cv::Point2f &right_hint,
-    cv::Point2f &top_right,
-    cv::Point2f &top_left,
-    cv::Point2f &bottom_left,
-    cv::Point2f &bottom_right)
-{
-    // Compute the tightest possible bounding triangle for the given contour
-    cv::RotatedRect cv_min_box= cv::minAreaRect(opencv_contour);
-
-    if (cv_min_box.size.width <= k_real_epsilon || cv_min_box.size.height <= k_real_epsilon)
-    {
-        return false;
-    }
-
-    float half_width, half_height;
-    float radians;
-    if (cv_min_box.size.width > cv_min_box.size.height)
-    {
-        half_width= cv_min_box.size.width / 2.f;
-        half_height= cv_min_box.size.height / 2.f;
-        radians= cv_min_box.angle*k_degrees_to_radians;
-    }
-    else
-    {
-        half_width= cv_min_box.size.height / 2.f;
-        half_height= cv_min_box.size.width / 2.f;
-        radians= (cv_min_box.angle + 90.f)*k_degrees_to_radians;
-    }
-
-    cv::Point2f quad_half_right, quad_half_up;
-    {
-        const float cos_angle= cosf(radians);
-        const float sin_angle= sinf(radians);
-
-        quad_half_right.x= half_width*cos_angle;
-        quad_half_right.y= half_width*sin_angle;
-
-        quad_half_up.x= -half_height*sin_angle;
-        quad_half_up.y= half_height*cos_angle;
-    }
-
-    if (quad_half_up.dot(up_hint) < 0)
-    {
-        // up axis is flipped
-        // flip the box vertically
-        quad_half_up= -quad_half_up;
-    }
-
-    if (quad_half_right.dot(right_hint) < 0)
-    {
-        // right axis is flipped
-        // flip the box horizontally
-        quad_half_right= -quad_half_right;
-    }
-
-    top_right= cv_min_box.center + quad_half_up + quad_half_right;
-    top_left= cv_min_box.center + quad_half_up - quad_half_right;
-    bottom_right= cv_min_box.center - quad_half_up + quad_half_right;
-    bottom_left= cv_min_box.center - quad_half_up - quad_half_right;
-
-    return true;
-}
-
-template<typename t_opencv_contour_type>
-cv::Point2f computeSafeCenterOfMassForContour(const t_opencv_contour_type &contour)
-{
-    cv::Moments mu(cv::moments(contour));
-    cv::Point2f massCenter;
-        
-    // mu.m00 is zero for contours of zero area.
-    // Fallback to standard centroid in this case.
-
-    if (!is_double_nearly_zero(mu.m00))
-    {
-        massCenter= cv::Point2f(static_cast<float>(mu.m10 / mu.m00), static_cast<float>(mu.m01 / mu.m00));
-    }
-    else
-    {
-        massCenter.x = 0.f;
-        massCenter.y = 0.f;
-
-        for (const cv::Point &int_point : contour)
-        {
-            massCenter.x += static_cast<float>(int_point.x);
-            massCenter.y += static_cast<float>(int_point.y);
-        }
-
-        if (contour.size() > 1)
-        {
-            const float N = static_cast<float>(contour.size());
-
-            massCenter.x /= N;
-            massCenter.y /= N;
-        }
-    }
-
-    return massCenter;
-}
-
 // http://www.euclideanspace.com/maths/geometry/rotations/conversions/quaternionToAngle/index.htm
 static void commonDeviceOrientationToOpenCVRodrigues(
     const CommonDeviceQuaternion &orientation,
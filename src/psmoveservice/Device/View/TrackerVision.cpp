@@ -0,0 +1,307 @@
+//-- includes -----
+#include "TrackerVision.h"
+#include "ServerLog.h"
+
+#include <algorithm>
+
+//-- statics -----
+OpenCVBGRToHSVMapper *OpenCVBGRToHSVMapper::m_instance = nullptr;
+int OpenCVBGRToHSVMapper::m_refCount= 0;
+
+//-- public methods -----
+void computeHSVRangeMask(
+    const cv::Mat &hsvImage,
+    const CommonHSVColorRange &hsvColorRange,
+    cv::Mat &out_mask,
+    cv::Mat &scratch_mask)
+{
+    const float hue_min = hsvColorRange.hue_range.center - hsvColorRange.hue_range.range;
+    const float hue_max = hsvColorRange.hue_range.center + hsvColorRange.hue_range.range;
+    const float saturation_min = clampf(hsvColorRange.saturation_range.center - hsvColorRange.saturation_range.range, 0, 255);
+    const float saturation_max = clampf(hsvColorRange.saturation_range.center + hsvColorRange.saturation_range.range, 0, 255);
+    const float value_min = clampf(hsvColorRange.value_range.center - hsvColorRange.value_range.range, 0, 255);
+    const float value_max = clampf(hsvColorRange.value_range.center + hsvColorRange.value_range.range, 0, 255);
+
+    if (hue_min < 0)
+    {
+        cv::inRange(
+            hsvImage,
+            cv::Scalar(0, saturation_min, value_min),
+            cv::Scalar(clampf(hue_max, 0, 180), saturation_max, value_max),
+            out_mask);
+        cv::inRange(
+            hsvImage,
+            cv::Scalar(clampf(180 + hue_min, 0, 180), saturation_min, value_min),
+            cv::Scalar(180, saturation_max, value_max),
+            scratch_mask);
+        cv::bitwise_or(out_mask, scratch_mask, out_mask);
+    }
+    else if (hue_max > 180)
+    {
+        cv::inRange(
+            hsvImage,
+            cv::Scalar(0, saturation_min, value_min),
+            cv::Scalar(clampf(hue_max - 180, 0, 180), saturation_max, value_max),
+            out_mask);
+        cv::inRange(
+            hsvImage,
+            cv::Scalar(clampf(hue_min, 0, 180), saturation_min, value_min),
+            cv::Scalar(180, saturation_max, value_max),
+            scratch_mask);
+        cv::bitwise_or(out_mask, scratch_mask, out_mask);
+    }
+    else
+    {
+        cv::inRange(
+            hsvImage,
+            cv::Scalar(hue_min, saturation_min, value_min),
+            cv::Scalar(hue_max, saturation_max, value_max),
+            out_mask);
+    }
+}
+
+bool computeBiggestNContoursInMask(
+    cv::Mat &mask,
+    const int frameWidth,
+    const int frameHeight,
+    t_opencv_int_contour_list &out_biggest_N_contours,
+    std::vector<double> &out_contour_areas,
+    const int max_contour_count,
+    const int min_points_in_contour)
+{
+    out_biggest_N_contours.clear();
+    out_contour_areas.clear();
+
+    struct ContourInfo
+    {
+        int contour_index;
+        double contour_area;
+    };
+    std::vector<ContourInfo> sorted_contour_list;
+
+    // Find all counters in the image buffer
+    cv::Size size; cv::Point ofs;
+    mask.locateROI(size, ofs);
+    t_opencv_int_contour_list contours;
+    cv::findContours(mask,
+                     contours,
+                     CV_RETR_EXTERNAL,
+                     CV_CHAIN_APPROX_SIMPLE,  //CV_CHAIN_APPROX_NONE?
+                     ofs);
+
+    // Compute the area of each contour
+    int contour_index = 0;
+    for (auto it = contours.begin(); it != contours.end(); ++it) 
+    {
+        const double contour_area = cv::contourArea(*it);
+        const ContourInfo contour_info = { contour_index, contour_area };
+
+        sorted_contour_list.push_back(contour_info);
+        ++contour_index;
+    }
+
+    // Sort the list of contours by area, largest to smallest
+    if (sorted_contour_list.size() > 1)
+    {
+        std::sort(
+            sorted_contour_list.begin(), sorted_contour_list.end(), 
+            [](const ContourInfo &a, const ContourInfo &b) {
+                return b.contour_area < a.contour_area;
+        });
+    }
+
+    // Copy up to N valid contours
+    for (auto it = sorted_contour_list.begin(); 
+        it != sorted_contour_list.end() && static_cast<int>(out_biggest_N_contours.size()) < max_contour_count; 
+        ++it)
+    {
+        const ContourInfo &contour_info = *it;
+        t_opencv_int_contour &contour = contours[contour_info.contour_index];
+
+        if (contour.size() > min_points_in_contour)
+        {
+            // Remove any points in contour on edge of camera/ROI
+            // TODO: Contours touching image border will be clipped,
+            // so this might not be necessary.
+            t_opencv_int_contour::iterator it = contour.begin();
+            while (it != contour.end()) 
+            {
+                if (it->x == 0 || it->x == (frameWidth - 1) || it->y == 0 || it->y == (frameHeight - 1))
+                {
+                    it = contour.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+
+            // Add cleaned up contour to the output list
+            out_biggest_N_contours.push_back(contour);
+            // Add its area to the output list too.
+            out_contour_areas.push_back(contour_info.contour_area);
+        }
+    }
+
+    return (out_biggest_N_contours.size() > 0);
+}
+
+bool computeBestFitTriangleForContour(
+    const t_opencv_float_contour &opencv_contour,
+    cv::Point2f &out_triangle_top,
+    cv::Point2f &out_triangle_bottom_left,
+    cv::Point2f &out_triangle_bottom_right)
+{
+    // Compute the tightest possible bounding triangle for the given contour
+    t_opencv_float_contour cv_min_triangle;
+
+    try
+    {
+        cv::minEnclosingTriangle(opencv_contour, cv_min_triangle);
+    }
+    catch( cv::Exception& e )
+    {
+        SERVER_LOG_INFO("computeBestFitTriangleForContour") << e.what();
+        return false;
+    }
+
+    if (cv_min_triangle.size() != 3)
+    {
+        return false;
+    }
+
+    cv::Point2f best_fit_origin_01 = (cv_min_triangle[0] + cv_min_triangle[1]) / 2.f;
+    cv::Point2f best_fit_origin_12 = (cv_min_triangle[1] + cv_min_triangle[2]) / 2.f;
+    cv::Point2f best_fit_origin_20 = (cv_min_triangle[2] + cv_min_triangle[0]) / 2.f;
+
+    t_opencv_float_contour cv_midpoint_triangle;
+    cv_midpoint_triangle.push_back(best_fit_origin_01);
+    cv_midpoint_triangle.push_back(best_fit_origin_12);
+    cv_midpoint_triangle.push_back(best_fit_origin_20);
+
+    // Find the corner closest to the center of mass.
+    // This is the bottom of the triangle.
+    int topCornerIndex = -1;
+    {
+        const cv::Point2f massCenter = computeSafeCenterOfMassForContour<t_opencv_float_contour>(opencv_contour);
+
+        double bestDistance = k_real_max;
+        for (int cornerIndex = 0; cornerIndex < 3; ++cornerIndex)
+        {
+            const double testDistance = cv::norm(cv_midpoint_triangle[cornerIndex] - massCenter);
+
+            if (testDistance < bestDistance)
+            {
+                topCornerIndex = cornerIndex;
+                bestDistance = testDistance;
+            }
+        }
+    }
+
+    // Assign the left and right corner indices
+    int leftCornerIndex = -1;
+    int rightCornerIndex = -1;
+    switch (topCornerIndex)
+    {
+    case 0:
+        leftCornerIndex = 1;
+        rightCornerIndex = 2;
+        break;
+    case 1:
+        leftCornerIndex = 0;
+        rightCornerIndex = 2;
+        break;
+    case 2:
+        leftCornerIndex = 0;
+        rightCornerIndex = 1;
+        break;
+    default:
+        assert(0 && "unreachable");
+    }
+
+    // Make sure the left and right corners are actually 
+    // on the left and right of the triangle
+    out_triangle_top = cv_midpoint_triangle[topCornerIndex];
+    out_triangle_bottom_left = cv_midpoint_triangle[leftCornerIndex];
+    out_triangle_bottom_right = cv_midpoint_triangle[rightCornerIndex];
+
+    const cv::Point2f topToLeft = out_triangle_bottom_left - out_triangle_top;
+    const cv::Point2f topToRight = out_triangle_bottom_right - out_triangle_top;
+
+    // Cross product should be positive if sides are correct
+    // If not, then swap them.
+    if (topToRight.cross(topToLeft) < 0)
+    {
+        std::swap(out_triangle_bottom_left, out_triangle_bottom_right);
+    }
+
+    return true;
+}
+}
+
+bool computeBestFitQuadForContour(
+    const t_opencv_float_contour &opencv_contour,
+    const cv::Point2f &up_hint, 
+    const cv::Point2f &right_hint,
+    cv::Point2f &top_right,
+    cv::Point2f &top_left,
+    cv::Point2f &bottom_left,
+    cv::Point2f &bottom_right)
+{
+    // Compute the tightest possible bounding triangle for the given contour
+    cv::RotatedRect cv_min_box= cv::minAreaRect(opencv_contour);
+
+    if (cv_min_box.size.width <= k_real_epsilon || cv_min_box.size.height <= k_real_epsilon)
+    {
+        return false;
+    }
+
+    float half_width, half_height;
+    float radians;
+    if (cv_min_box.size.width > cv_min_box.size.height)
+    {
+        half_width= cv_min_box.size.width / 2.f;
+        half_height= cv_min_box.size.height / 2.f;
+        radians= cv_min_box.angle*k_degrees_to_radians;
+    }
+    else
+    {
+        half_width= cv_min_box.size.height / 2.f;
+        half_height= cv_min_box.size.width / 2.f;
+        radians= (cv_min_box.angle + 90.f)*k_degrees_to_radians;
+    }
+
+    cv::Point2f quad_half_right, quad_half_up;
+    {
+        const float cos_angle= cosf(radians);
+        const float sin_angle= sinf(radians);
+
+        quad_half_right.x= half_width*cos_angle;
+        quad_half_right.y= half_width*sin_angle;
+
+        quad_half_up.x= -half_height*sin_angle;
+        quad_half_up.y= half_height*cos_angle;
+    }
+
+    if (quad_half_up.dot(up_hint) < 0)
+    {
+        // up axis is flipped
+        // flip the box vertically
+        quad_half_up= -quad_half_up;
+    }
+
+    if (quad_half_right.dot(right_hint) < 0)
+    {
+        // right axis is flipped
+        // flip the box horizontally
+        quad_half_right= -quad_half_right;
+    }
+
+    top_right= cv_min_box.center + quad_half_up + quad_half_right;
+    top_left= cv_min_box.center + quad_half_up - quad_half_right;
+    bottom_right= cv_min_box.center - quad_half_up + quad_half_right;
+    bottom_left= cv_min_box.center - quad_half_up - quad_half_right;
+
+    return true;
+}
+}
@@ -0,0 +1,179 @@
+#ifndef TRACKER_VISION_H
+#define TRACKER_VISION_H
+
+//-- includes -----
+#include "DeviceInterface.h"
+#include "MathUtility.h"
+
+#include "opencv2/opencv.hpp"
+
+#include <assert.h>
+#include <vector>
+
+//-- typedefs ----
+typedef std::vector<cv::Point> t_opencv_int_contour;
+typedef std::vector<t_opencv_int_contour> t_opencv_int_contour_list;
+
+typedef std::vector<cv::Point2f> t_opencv_float_contour;
+typedef std::vector<t_opencv_float_contour> t_opencv_float_contour_list;
+
+//-- definitions -----
+// Converts BGR frames to HSV with a 256^3 entry lookup table shared by every tracker
+class OpenCVBGRToHSVMapper
+{
+public:
+    typedef cv::Point3_<uint8_t> ColorTuple;
+
+    static OpenCVBGRToHSVMapper *allocate()
+    {
+        if (m_refCount == 0)
+        {
+            assert(m_instance == nullptr);
+            m_instance = new OpenCVBGRToHSVMapper();
+        }
+        assert(m_instance != nullptr);
+
+        ++m_refCount;
+        return m_instance;
+    }
+
+    static void dispose(OpenCVBGRToHSVMapper *instance)
+    {
+        assert(m_instance != nullptr);
+        assert(m_instance == instance);
+        assert(m_refCount > 0);
+
+        --m_refCount;
+        if (m_refCount <= 0)
+        {
+            delete m_instance;
+            m_instance = nullptr;
+        }
+    }
+
+    void cvtColor(const cv::Mat &bgrBuffer, cv::Mat &hsvBuffer)
+    {
+        hsvBuffer.forEach<ColorTuple>([&bgrBuffer, this](ColorTuple &hsvColor, const int position[]) -> void {
+            const ColorTuple &bgrColor = bgrBuffer.at<ColorTuple>(position[0], position[1]);
+            const int b = bgrColor.x;
+            const int g = bgrColor.y;
+            const int r = bgrColor.z;
+            const int LUTIndex = OpenCVBGRToHSVMapper::getLUTIndex(r, g, b);
+
+            hsvColor = bgr2hsv->at<ColorTuple>(LUTIndex, 0);
+        });
+    }
+
+private:
+    static OpenCVBGRToHSVMapper *m_instance;
+    static int m_refCount;
+
+    OpenCVBGRToHSVMapper()
+    {
+        bgr2hsv = new cv::Mat(256*256*256, 1, CV_8UC3);
+
+        int LUTIndex = 0;
+        for (int r = 0; r < 256; ++r)
+        {
+            for (int g = 0; g < 256; ++g)
+            {
+                for (int b = 0; b < 256; ++b)
+                {
+                    bgr2hsv->at<ColorTuple>(LUTIndex, 0) = ColorTuple(b, g, r);
+                    ++LUTIndex;
+                }
+            }
+        }
+
+        cv::cvtColor(*bgr2hsv, *bgr2hsv, cv::COLOR_BGR2HSV);
+    }
+
+    ~OpenCVBGRToHSVMapper()
+    {
+        delete bgr2hsv;
+    }
+
+    static int getLUTIndex(int r, int g, int b)
+    {
+        return (256 * 256)*r + 256*g + b;
+    }
+
+    cv::Mat *bgr2hsv;
+};
+
+//-- interface -----
+// The vision kernels ServerTrackerView runs on every tracker frame.
+// They live here rather than in ServerTrackerView.cpp so benchmark_vision can time them.
+
+/// Writes a mask of the HSV image pixels that fall in the color range, wrapping the hue around 0/180.
+/// The scratch mask must be the same size as the mask and is only used when the hue range wraps.
+void computeHSVRangeMask(
+    const cv::Mat &hsvImage,
+    const CommonHSVColorRange &hsvColorRange,
+    cv::Mat &out_mask,
+    cv::Mat &scratch_mask);
+
+/// Finds the outer contours in the mask and returns up to max_contour_count of them, biggest first.
+/// Points are in raw image space and points on the edge of the frame are dropped. Clobbers the mask.
+bool computeBiggestNContoursInMask(
+    cv::Mat &mask,
+    const int frameWidth,
+    const int frameHeight,
+    t_opencv_int_contour_list &out_biggest_N_contours,
+    std::vector<double> &out_contour_areas,
+    const int max_contour_count,
+    const int min_points_in_contour = 6);
+
+bool computeBestFitTriangleForContour(
+    const t_opencv_float_contour &opencv_contour,
+    cv::Point2f &out_triangle_top,
+    cv::Point2f &out_triangle_bottom_left,
+    cv::Point2f &out_triangle_bottom_right);
+
+bool computeBestFitQuadForContour(
+    const t_opencv_float_contour &opencv_contour,
+    const cv::Point2f &up_hint, 
+    const cv::Point2f &right_hint,
+    cv::Point2f &top_right,
+    cv::Point2f &top_left,
+    cv::Point2f &bottom_left,
+    cv::Point2f &bottom_right);
+
+//-- template utility methods -----
+template<typename t_opencv_contour_type>
+cv::Point2f computeSafeCenterOfMassForContour(const t_opencv_contour_type &contour)
+{
+    cv::Moments mu(cv::moments(contour));
+    cv::Point2f massCenter;
+        
+    // mu.m00 is zero for contours of zero area.
+    // Fallback to standard centroid in this case.
+
+    if (!is_double_nearly_zero(mu.m00))
+    {
+        massCenter= cv::Point2f(static_cast<float>(mu.m10 / mu.m00), static_cast<float>(mu.m01 / mu.m00));
+    }
+    else
+    {
+        massCenter.x = 0.f;
+        massCenter.y = 0.f;
+
+        for (const cv::Point &int_point : contour)
+        {
+            massCenter.x += static_cast<float>(int_point.x);
+            massCenter.y += static_cast<float>(int_point.y);
+        }
+
+        if (contour.size() > 1)
+        {
+            const float N = static_cast<float>(contour.size());
+
+            massCenter.x /= N;
+            massCenter.y /= N;
+        }
+    }
+
+    return massCenter;
+}
+
+#endif // TRACKER_VISION_H
@@ -0,0 +1,152 @@
+// -- includes --
+#include "PoseFilterFactory.h"
+#include "CompoundPoseFilter.h"
+#include "KalmanPoseFilter.h"
+#include "ServerLog.h"
+
+#include <assert.h>
+
+// -- constants --
+const char *k_pose_kalman_filter_type_name = "PoseKalman";
+
+const char *k_position_filter_type_names[] = {
+    "",                         // PositionFilterTypeNone
+    "PassThru",                 // PositionFilterTypePassThru
+    "LowPassOptical",           // PositionFilterTypeLowPassOptical
+    "LowPassIMU",               // PositionFilterTypeLowPassIMU
+    "ComplimentaryOpticalIMU",  // PositionFilterTypeComplimentaryOpticalIMU
+    "LowPassExponential",       // PositionFilterTypeLowPassExponential
+    "PositionKalman",           // PositionFilterTypeKalman
+};
+const int k_position_filter_type_count =
+    static_cast<int>(sizeof(k_position_filter_type_names) / sizeof(k_position_filter_type_names[0]));
+
+const char *k_orientation_filter_type_names[] = {
+    "",                         // OrientationFilterTypeNone
+    "PassThru",                 // OrientationFilterTypePassThru
+    "MadgwickARG",              // OrientationFilterTypeMadgwickARG
+    "MadgwickMARG",             // OrientationFilterTypeMadgwickMARG
+    "ComplementaryOpticalARG",  // OrientationFilterTypeComplementaryOpticalARG
+    "ComplementaryMARG",        // OrientationFilterTypeComplementaryMARG
+    "OrientationKalman",        // OrientationFilterTypeKalman
+};
+const int k_orientation_filter_type_count =
+    static_cast<int>(sizeof(k_orientation_filter_type_names) / sizeof(k_orientation_filter_type_names[0]));
+
+// -- private methods --
+static int find_filter_type_name(const char **names, const int name_count, const std::string &filter_type)
+{
+    for (int name_index = 0; name_index < name_count; ++name_index)
+    {
+        if (filter_type == names[name_index])
+        {
+            return name_index;
+        }
+    }
+
+    return -1;
+}
+
+// -- public interface --
+IPoseFilter *
+pose_filter_factory(
+    const CommonDeviceState::eDeviceType deviceType,
+    const std::string &position_filter_type,
+    const std::string &orientation_filter_type,
+    const PoseFilterConstants &constants)
+{
+    IPoseFilter *filter= nullptr;
+
+    if (position_filter_type == k_pose_kalman_filter_type_name &&
+        orientation_filter_type == k_pose_kalman_filter_type_name)
+    {
+        switch (deviceType)
+        {
+        case CommonDeviceState::PSMove:
+        case CommonDeviceState::VirtualController:
+            {
+                KalmanPoseFilterPSMove *kalmanFilter = new KalmanPoseFilterPSMove();
+                kalmanFilter->init(constants);
+                filter= kalmanFilter;
+            } break;
+        case CommonDeviceState::PSDualShock4:
+            {
+                KalmanPoseFilterDS4 *kalmanFilter = new KalmanPoseFilterDS4();
+                kalmanFilter->init(constants);
+                filter= kalmanFilter;
+            } break;
+        default:
+            assert(0 && "unreachable");
+        }
+    }
+    else
+    {
+        // Convert the position filter type string into an enum
+        PositionFilterType position_filter_enum= PositionFilterTypeNone;
+        const int position_name_index=
+            find_filter_type_name(k_position_filter_type_names, k_position_filter_type_count, position_filter_type);
+
+        if (position_name_index != -1)
+        {
+            position_filter_enum= static_cast<PositionFilterType>(position_name_index);
+        }
+        else
+        {
+            SERVER_LOG_INFO("pose_filter_factory()") <<
+                "Unknown position filter type: " << position_filter_type << ". Using default.";
+
+            // fallback to a default based on controller type
+            switch (deviceType)
+            {
+            case CommonDeviceState::PSMove:
+            case CommonDeviceState::VirtualController:
+                position_filter_enum= PositionFilterTypeLowPassExponential;
+                break;
+            case CommonDeviceState::PSDualShock4:
+                position_filter_enum= PositionFilterTypeComplimentaryOpticalIMU;
+                break;
+            default:
+                assert(0 && "unreachable");
+            }
+        }
+
+        // Convert the orientation filter type string into an enum
+        OrientationFilterType orientation_filter_enum= OrientationFilterTypeNone;
+        const int orientation_name_index=
+            find_filter_type_name(k_orientation_filter_type_names, k_orientation_filter_type_count, orientation_filter_type);
+
+        if (orientation_name_index != -1)
+        {
+            orientation_filter_enum= static_cast<OrientationFilterType>(orientation_name_index);
+        }
+        else
+        {
+            SERVER_LOG_INFO("pose_filter_factory()") <<
+                "Unknown orientation filter type: " << orientation_filter_type << ". Using default.";
+
+            // fallback to a default based on controller type
+            switch (deviceType)
+            {
+            case CommonDeviceState::PSMove:
+                orientation_filter_enum= OrientationFilterTypeComplementaryMARG;
+                break;
+            case CommonDeviceState::PSDualShock4:
+                orientation_filter_enum= OrientationFilterTypeComplementaryOpticalARG;
+                break;
+            case CommonDeviceState::VirtualController:
+                orientation_filter_enum= OrientationFilterTypeNone;
+                break;
+            default:
+                assert(0 && "unreachable");
+            }
+        }
+
+        CompoundPoseFilter *compound_pose_filter = new CompoundPoseFilter();
+        compound_pose_filter->init(deviceType, orientation_filter_enum, position_filter_enum, constants);
+        filter= compound_pose_filter;
+    }
+
+    assert(filter != nullptr);
+
+    return filter;
+}
@@ -0,0 +1,30 @@
+#ifndef POSE_FILTER_FACTORY_H
+#define POSE_FILTER_FACTORY_H
+
+//-- includes -----
+#include "PoseFilterInterface.h"
+#include "DeviceInterface.h"
+#include <string>
+
+//-- constants -----
+/// Filter type name that selects the full pose kalman filter when used for both position and orientation
+extern const char *k_pose_kalman_filter_type_name;
+
+/// Position filter type names accepted by pose_filter_factory, indexed by PositionFilterType
+extern const char *k_position_filter_type_names[];
+extern const int k_position_filter_type_count;
+
+/// Orientation filter type names accepted by pose_filter_factory, indexed by OrientationFilterType
+extern const char *k_orientation_filter_type_names[];
+extern const int k_orientation_filter_type_count;
+
+//-- interface -----
+/// Allocates the pose filter named in a controller config.
+/// Unknown filter type names fall back to the default filter of the device type.
+IPoseFilter *pose_filter_factory(
+    const CommonDeviceState::eDeviceType deviceType,
+    const std::string &position_filter_type,
+    const std::string &orientation_filter_type,
+    const PoseFilterConstants &constants);
+
+#endif // POSE_FILTER_FACTORY_H
@@ -7,7 +7,7 @@
 #include "MathUtility.h"
 #include "ServerLog.h"
 #include "ServerUtility.h"
-#include "hidapi.h"
+#include "HidCapture.h"
 #include "libusb.h"
 #include <vector>
 #include <cstdlib>
@@ -419,10 +419,10 @@ bool MorpheusHMD::open(
 
 		// Open the sensor interface using HIDAPI
 		USBContext->sensor_device_path = pEnum->get_hid_hmd_enumerator()->get_interface_path(MORPHEUS_SENSOR_INTERFACE);
-		USBContext->sensor_device_handle = hid_open_path(USBContext->sensor_device_path.c_str());
+		USBContext->sensor_device_handle = hid_capture_open_path(USBContext->sensor_device_path.c_str());
 		if (USBContext->sensor_device_handle != nullptr)
 		{
-			hid_set_nonblocking(USBContext->sensor_device_handle, 1);
+			hid_capture_set_nonblocking(USBContext->sensor_device_handle, 1);
 		}
 
 		// Open the command interface using libusb.
@@ -433,7 +433,12 @@ bool MorpheusHMD::open(
 		// If we started sending control transfer requests for the sensor data in the main thread at the same time
 		// it can lead to a crash. It shouldn't, but this was a problem previously setting video feed properties
 		// from the color config tool while a video feed was running.
-		if (!cfg.disable_command_interface)
+		if (hid_capture_is_replay_device(USBContext->sensor_device_handle))
+		{
+			// Only the sensor reports are in a device capture, there are no command responses to replay
+			SERVER_LOG_INFO("MorpheusHMD::open") << "Replaying the sensor interface without the command interface.";
+		}
+		else if (!cfg.disable_command_interface)
 		{
 			morpheus_open_usb_device(USBContext);
 		}
@@ -480,7 +485,7 @@ void MorpheusHMD::close()
 		if (USBContext->sensor_device_handle != nullptr)
 		{
 			SERVER_LOG_INFO("MorpheusHMD::close") << "Closing MorpheusHMD sensor interface(" << USBContext->sensor_device_path << ")";
-			hid_close(USBContext->sensor_device_handle);
+			hid_capture_close(USBContext->sensor_device_handle);
 		}
 
 		if (USBContext->usb_device_handle != nullptr)
@@ -538,7 +543,8 @@ MorpheusHMD::getUSBDevicePath() const
 bool
 MorpheusHMD::getIsOpen() const
 {
-    return USBContext->sensor_device_handle != nullptr && USBContext->usb_device_handle != nullptr;
+    return USBContext->sensor_device_handle != nullptr && 
+		(USBContext->usb_device_handle != nullptr || hid_capture_is_replay_device(USBContext->sensor_device_handle));
 }
 
 IControllerInterface::ePollResult
@@ -553,7 +559,7 @@ MorpheusHMD::poll()
 		for (int iteration = 0; iteration < k_max_iterations; ++iteration)
 		{
 			// Attempt to read the next update packet from the controller
-			int res = hid_read(USBContext->sensor_device_handle, (unsigned char*)InData, sizeof(MorpheusSensorData));
+			int res = hid_capture_read(USBContext->sensor_device_handle, (unsigned char*)InData, sizeof(MorpheusSensorData));
 
 			if (res == 0)
 			{
@@ -569,7 +575,7 @@ MorpheusHMD::poll()
 			{
 				char hidapi_err_mbs[256];
 				bool valid_error_mesg = 
-					ServerUtility::convert_wcs_to_mbs(hid_error(USBContext->sensor_device_handle), hidapi_err_mbs, sizeof(hidapi_err_mbs));
+					ServerUtility::convert_wcs_to_mbs(hid_capture_error(USBContext->sensor_device_handle), hidapi_err_mbs, sizeof(hidapi_err_mbs));
 
 				// Device no longer in valid state.
 				if (valid_error_mesg)
@@ -1,6 +1,7 @@
 //-- includes -----
 #include "PSDualShock4Controller.h"
 #include "ControllerDeviceEnumerator.h"
+#include "HidCapture.h"
 #include "MathUtility.h"
 #include "ServerLog.h"
 #include "ServerUtility.h"
@@ -453,12 +454,12 @@ bool PSDualShock4Controller::open(
 		HIDDetails.vendor_id = pEnum->get_vendor_id();
 		HIDDetails.product_id = pEnum->get_product_id();
         HIDDetails.Device_path = cur_dev_path;
-        HIDDetails.Handle = hid_open_path(HIDDetails.Device_path.c_str());
+        HIDDetails.Handle = hid_capture_open_path(HIDDetails.Device_path.c_str());
 
         if (HIDDetails.Handle != nullptr)  // Controller was opened and has an index
         {             
             // Don't block on hid report requests
-            hid_set_nonblocking(HIDDetails.Handle, 1);
+            hid_capture_set_nonblocking(HIDDetails.Handle, 1);
 
             /* -USB or Bluetooth Device-
 
@@ -567,7 +568,7 @@ void PSDualShock4Controller::close()
                 clearAndWriteDataOut();
             }
 
-            hid_close(HIDDetails.Handle);
+            hid_capture_close(HIDDetails.Handle);
             HIDDetails.Handle = nullptr;
         }
     }
@@ -601,7 +602,7 @@ PSDualShock4Controller::setHostBluetoothAddress(const std::string &new_host_bt_a
         }
 
         /* _WIN32 only has move->handle_addr for getting bluetooth address. */
-        res = hid_send_feature_report(HIDDetails.Handle, bts, sizeof(bts));
+        res = hid_capture_send_feature_report(HIDDetails.Handle, bts, sizeof(bts));
 
         if (res == sizeof(bts))
         {
@@ -733,7 +734,7 @@ PSDualShock4Controller::getBTAddressesViaUSB(std::string& host, std::string& con
 
     memset(btg, 0, sizeof(btg));
     btg[0] = PSDualShock4_USBReport_GetBTAddr;
-    res = hid_get_feature_report(HIDDetails.Handle, btg, sizeof(btg));
+    res = hid_capture_get_feature_report(HIDDetails.Handle, btg, sizeof(btg));
 
     if (res == sizeof(btg))
     {
@@ -779,7 +780,7 @@ PSDualShock4Controller::poll()
         for (int iteration = 0; iteration < k_max_iterations; ++iteration)
         {
             // Attempt to read the next update packet from the controller
-            int res = hid_read(HIDDetails.Handle, (unsigned char*)InData, sizeof(PSDualShock4DataInput));
+            int res = hid_capture_read(HIDDetails.Handle, (unsigned char*)InData, sizeof(PSDualShock4DataInput));
 
             if (res == 0)
             {
@@ -1148,9 +1149,11 @@ PSDualShock4Controller::writeDataOut()
         // In the DS4 implementation they use the HidD_SetOutputReport() Win32 API call instead. 
         // Unfortunately HIDAPI doesn't have any equivalent call, so we have to make our own.
         #ifdef _WIN32
-        int res = hid_set_output_report(HIDDetails.Handle, (unsigned char*)OutData, sizeof(PSDualShock4DataOutput));
+        int res = hid_capture_is_replay_device(HIDDetails.Handle)
+            ? sizeof(PSDualShock4DataOutput)
+            : hid_set_output_report(HIDDetails.Handle, (unsigned char*)OutData, sizeof(PSDualShock4DataOutput));
         #else
-        int res = hid_write(HIDDetails.Handle, (unsigned char*)OutData, sizeof(PSDualShock4DataOutput));
+        int res = hid_capture_write(HIDDetails.Handle, (unsigned char*)OutData, sizeof(PSDualShock4DataOutput));
         #endif
         bSuccess = res > 0;
 
@@ -1218,7 +1221,7 @@ getButtonState(unsigned int buttons, unsigned int lastButtons, int buttonMask)
 
 inline bool hid_error_mbs(hid_device *dev, char *out_mb_error, size_t mb_buffer_size)
 {
-    return ServerUtility::convert_wcs_to_mbs(hid_error(dev), out_mb_error, mb_buffer_size);
+    return ServerUtility::convert_wcs_to_mbs(hid_capture_error(dev), out_mb_error, mb_buffer_size);
 }
 
 #ifdef _WIN32
@@ -1281,7 +1284,7 @@ static int hid_set_output_report(hid_device *dev, const unsigned char *data, siz
                 NULL);
 
             /* Store the message off in the Device entry so that
-            the hid_error() function can pick it up. */
+            the hid_capture_error() function can pick it up. */
             LocalFree(dev_internal->last_error_str);
             dev_internal->last_error_str = error_msg;
 
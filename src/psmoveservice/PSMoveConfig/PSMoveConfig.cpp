@@ -21,14 +21,29 @@ const CommonHSVColorRange g_default_color_presets[] = {
 };
 const CommonHSVColorRange *k_default_color_presets = g_default_color_presets;
 
+std::string PSMoveConfig::s_configDirectory;
+
 PSMoveConfig::PSMoveConfig(const std::string &fnamebase)
 : ConfigFileBase(fnamebase)
 {
 }
 
+void
+PSMoveConfig::setConfigDirectory(const std::string &directory)
+{
+    s_configDirectory= directory;
+}
+
 const std::string
-PSMoveConfig::getConfigPath()
+PSMoveConfig::getConfigDirectory()
 {
+    if (!s_configDirectory.empty())
+    {
+        boost::filesystem::path configpath(s_configDirectory);
+        boost::filesystem::create_directories(configpath);
+        return configpath.string();
+    }
+
     const char *homedir;
 #ifdef _WIN32
     size_t homedir_buffer_req_size;
@@ -47,8 +62,18 @@ PSMoveConfig::getConfigPath()
     boost::filesystem::path configpath(homedir);
     configpath /= "PSMoveService";
     boost::filesystem::create_directory(configpath);
+    return configpath.string();
+}
+
+const std::string
+PSMoveConfig::getConfigPath()
+{
+    boost::filesystem::path configpath(getConfigDirectory());
     configpath /= ConfigFileBase + ".json";
-    std::cout << "Config file name: " << configpath << std::endl;
+    if (s_configDirectory.empty())
+    {
+        std::cout << "Config file name: " << configpath << std::endl;
+    }
     return configpath.string();
 }
 
@@ -42,8 +42,16 @@ public:
 	static void writeTrackingColor(boost::property_tree::ptree &pt, int tracking_color_id);
 	static int readTrackingColor(const boost::property_tree::ptree &pt);
 
+    // Loads and saves every config in the given directory instead of the per user one (empty restores it)
+    static void setConfigDirectory(const std::string &directory);
+
+    // The directory configs are loaded from and saved to, created if missing
+    static const std::string getConfigDirectory();
+
 private:
     const std::string getConfigPath();
+
+    static std::string s_configDirectory;
 };
 /*
 Note that PSMoveConfig is an abstract class because it has 2 pure virtual functions.
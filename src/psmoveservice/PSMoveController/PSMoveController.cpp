@@ -36,6 +36,7 @@ POSSIBILITY OF SUCH DAMAGE.
 //-- includes -----
 #include "PSMoveController.h"
 #include "ControllerDeviceEnumerator.h"
+#include "HidCapture.h"
 #include "ServerLog.h"
 #include "ServerUtility.h"
 #include "BluetoothQueries.h"
@@ -456,11 +457,11 @@ bool PSMoveController::open(
         HIDDetails.Device_path_addr = HIDDetails.Device_path;
         HIDDetails.Device_path_addr.replace(HIDDetails.Device_path_addr.find("&col01#"), 7, "&col02#");
         HIDDetails.Device_path_addr.replace(HIDDetails.Device_path_addr.find("&0000#"), 6, "&0001#");
-        HIDDetails.Handle_addr = hid_open_path(HIDDetails.Device_path_addr.c_str());
-        hid_set_nonblocking(HIDDetails.Handle_addr, 1);
+        HIDDetails.Handle_addr = hid_capture_open_path(HIDDetails.Device_path_addr.c_str());
+        hid_capture_set_nonblocking(HIDDetails.Handle_addr, 1);
     #endif
-        HIDDetails.Handle = hid_open_path(HIDDetails.Device_path.c_str());
-        hid_set_nonblocking(HIDDetails.Handle, 1);
+        HIDDetails.Handle = hid_capture_open_path(HIDDetails.Device_path.c_str());
+        hid_capture_set_nonblocking(HIDDetails.Handle, 1);
                 
         // On my Mac, using bluetooth,
         // cur_dev->path = Bluetooth_054c_03d5_779732e8
@@ -590,13 +591,13 @@ void PSMoveController::close()
 
         if (HIDDetails.Handle != nullptr)
         {
-            hid_close(HIDDetails.Handle);
+            hid_capture_close(HIDDetails.Handle);
             HIDDetails.Handle= nullptr;
         }
 
         if (HIDDetails.Handle_addr != nullptr)
         {
-            hid_close(HIDDetails.Handle_addr);
+            hid_capture_close(HIDDetails.Handle_addr);
             HIDDetails.Handle_addr= nullptr;
         }
     }
@@ -626,11 +627,11 @@ PSMoveController::setHostBluetoothAddress(const std::string &new_host_bt_addr)
         /* _WIN32 only has move->handle_addr for getting bluetooth address. */
         if (HIDDetails.Handle_addr) 
         {
-            res = hid_send_feature_report(HIDDetails.Handle_addr, bts, sizeof(bts));
+            res = hid_capture_send_feature_report(HIDDetails.Handle_addr, bts, sizeof(bts));
         } 
         else 
         {
-            res = hid_send_feature_report(HIDDetails.Handle, bts, sizeof(bts));
+            res = hid_capture_send_feature_report(HIDDetails.Handle, bts, sizeof(bts));
         }
 
         if (res == sizeof(bts))
@@ -803,10 +804,10 @@ PSMoveController::getBTAddress(std::string& host, std::string& controller)
         
         /* _WIN32 only has move->handle_addr for getting bluetooth address. */
         if (HIDDetails.Handle_addr) {
-            res = hid_get_feature_report(HIDDetails.Handle_addr, btg, sizeof(btg));
+            res = hid_capture_get_feature_report(HIDDetails.Handle_addr, btg, sizeof(btg));
         }
         else {
-            res = hid_get_feature_report(HIDDetails.Handle, btg, sizeof(btg));
+            res = hid_capture_get_feature_report(HIDDetails.Handle, btg, sizeof(btg));
         }
         
 
@@ -879,7 +880,7 @@ PSMoveController::loadCalibration()
         memset(cal, 0, sizeof(cal));
         cal[0] = PSMove_Req_GetCalibration;
 
-        int res = hid_get_feature_report(HIDDetails.Handle, cal, sizeof(cal));
+        int res = hid_capture_get_feature_report(HIDDetails.Handle, cal, sizeof(cal));
 
         if (res == expected_res)
         {
@@ -976,7 +977,7 @@ PSMoveController::loadFirmwareInfo()
         memset(buf, 0, sizeof(buf));
         buf[0] = PSMove_Req_GetFirmwareInfo;
 
-        res = hid_get_feature_report(HIDDetails.Handle, buf, sizeof(buf));
+        res = hid_capture_get_feature_report(HIDDetails.Handle, buf, sizeof(buf));
 
         /**
         * The Bluetooth report contains the Report ID as additional first byte
@@ -1021,7 +1022,7 @@ PSMoveController::enableDFUMode()
 	memset(buf, 0, sizeof(buf));
 	buf[0] = PSMove_Req_SetDFUMode;
 	buf[1] = mode_magic_val;
-	res = hid_send_feature_report(HIDDetails.Handle, buf, sizeof(buf));
+	res = hid_capture_send_feature_report(HIDDetails.Handle, buf, sizeof(buf));
 
 	return (res == sizeof(buf));
 }
@@ -1043,7 +1044,7 @@ PSMoveController::poll()
         for (int iteration= 0; iteration < k_max_iterations; ++iteration)
         {
             // Attempt to read the next update packet from the controller
-            int res = hid_read(HIDDetails.Handle, (unsigned char*)InData, sizeof(PSMoveDataInput));
+            int res = hid_capture_read(HIDDetails.Handle, (unsigned char*)InData, sizeof(PSMoveDataInput));
 
             if (res == 0)
             {
@@ -1341,7 +1342,7 @@ PSMoveController::writeDataOut()
         // Keep writing state out until the desired LED and Rumble are 0 
         bWriteStateDirty = LedR != 0 || LedG != 0 || LedB != 0 || Rumble != 0;
 
-        int res = hid_write(HIDDetails.Handle, (unsigned char*)(&data_out),
+        int res = hid_capture_write(HIDDetails.Handle, (unsigned char*)(&data_out),
             sizeof(data_out));
         bSuccess= (res == sizeof(data_out));
     }
@@ -1394,7 +1395,7 @@ PSMoveController::setLEDPWMFrequency(unsigned long freq)
         buf[4] = (freq >> 8) & 0xFF;
         buf[5] = (freq >> 16) & 0xFF;
         buf[6] = (freq >> 24) & 0xFF;
-        int res = hid_send_feature_report(HIDDetails.Handle, buf, sizeof(buf));
+        int res = hid_capture_send_feature_report(HIDDetails.Handle, buf, sizeof(buf));
         success = (res == sizeof(buf));
         LedPWMF = freq;
     }
@@ -1476,5 +1477,5 @@ getButtonState(unsigned int buttons, unsigned int lastButtons, int buttonMask)
 
 inline bool hid_error_mbs(hid_device *dev, char *out_mb_error, size_t mb_buffer_size)
 {
-    return ServerUtility::convert_wcs_to_mbs(hid_error(dev), out_mb_error, mb_buffer_size);
+    return ServerUtility::convert_wcs_to_mbs(hid_capture_error(dev), out_mb_error, mb_buffer_size);
 }
@@ -1,5 +1,6 @@
 // -- includes -----
 #include "PS3EyeTracker.h"
+#include "DeviceCapture.h"
 #include "ServerLog.h"
 #include "ServerUtility.h"
 #include "PSEyeVideoCapture.h"
@@ -28,6 +29,118 @@ public:
     cv::Mat frame;
 };
 
+/// Plays back the frames of a camera recorded in a device capture
+class PSEyeReplayVideoCapture : public PSEyeVideoCapture
+{
+public:
+    PSEyeReplayVideoCapture(int stream_id)
+        : PSEyeVideoCapture()
+        , m_streamId(-1)
+        , m_frameInfo()
+        , m_framePixels(nullptr)
+        , m_frameRate(0.0)
+        , m_exposure(0.0)
+        , m_gain(0.0)
+    {
+        DeviceCaptureStreamDesc desc;
+
+        if (DeviceCapture::get_replay_stream_desc(stream_id, desc) &&
+            DeviceCapture::get_replay_frame_format(stream_id, m_frameInfo))
+        {
+            m_streamId = stream_id;
+            m_indentifier = desc.identifier;
+        }
+    }
+
+    bool open(int index) override
+    {
+        return isOpened();
+    }
+
+    bool isOpened() const override
+    {
+        return m_streamId != -1;
+    }
+
+    void release() override
+    {
+        m_streamId = -1;
+        m_framePixels = nullptr;
+    }
+
+    bool grab() override
+    {
+        return isOpened() && DeviceCapture::read_video_frame(m_streamId, m_frameInfo, m_framePixels);
+    }
+
+    bool retrieve(cv::OutputArray image, int flag) override
+    {
+        if (m_framePixels == nullptr)
+        {
+            return false;
+        }
+
+        // The pixels live in the capture file mapping, copy them out before the replay moves on
+        const cv::Mat frame(
+            m_frameInfo.height, m_frameInfo.width, m_frameInfo.cv_type,
+            const_cast<unsigned char *>(m_framePixels), m_frameInfo.row_bytes);
+
+        frame.copyTo(image);
+        m_framePixels = nullptr;
+
+        return true;
+    }
+
+    // The recorded frames can't be resized or re-exposed, only remember what was asked for
+    bool set(int propId, double value) override
+    {
+        switch (propId)
+        {
+        case cv::CAP_PROP_FPS:
+            m_frameRate = value;
+            return true;
+        case cv::CAP_PROP_EXPOSURE:
+            m_exposure = value;
+            return true;
+        case cv::CAP_PROP_GAIN:
+            m_gain = value;
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    double get(int propId) const override
+    {
+        switch (propId)
+        {
+        case cv::CAP_PROP_FRAME_WIDTH:
+            return m_frameInfo.width;
+        case cv::CAP_PROP_FRAME_HEIGHT:
+            return m_frameInfo.height;
+        case cv::CAP_PROP_FORMAT:
+            // The camera drivers hand out BGR frames, which is what got recorded
+            return (CV_MAT_CN(m_frameInfo.cv_type) == 3) ? cv::CAP_MODE_BGR : -1;
+        case cv::CAP_PROP_FPS:
+            return m_frameRate;
+        case cv::CAP_PROP_EXPOSURE:
+            return m_exposure;
+        case cv::CAP_PROP_GAIN:
+            return m_gain;
+        default:
+            return 0.0;
+        }
+    }
+
+private:
+    int m_streamId;
+    DeviceCaptureFrameInfo m_frameInfo;
+    const unsigned char *m_framePixels;
+    double m_frameRate;
+    double m_exposure;
+    double m_gain;
+};
+
 // -- public methods
 // -- PS3EYE Controller Config
 const int PS3EyeTrackerConfig::CONFIG_VERSION = 7;
@@ -261,6 +374,7 @@ PS3EyeTracker::PS3EyeTracker()
     , VideoCapture(nullptr)
     , CaptureData(nullptr)
     , DriverType(PS3EyeTracker::Libusb)
+    , CaptureStreamId(-1)
     , NextPollSequenceNumber(0)
     , TrackerStates()
 {
@@ -330,7 +444,16 @@ bool PS3EyeTracker::open(const DeviceEnumerator *enumerator)
 
         SERVER_LOG_INFO("PS3EyeTracker::open") << "Opening PS3EyeTracker(" << cur_dev_path << ", camera_index=" << camera_index << ")";
 
-        VideoCapture = new PSEyeVideoCapture(camera_index);
+        if (DeviceCapture::get_is_replaying())
+        {
+            const int stream_id = DeviceCapture::find_replay_stream(_DeviceCaptureStream_Video, cur_dev_path);
+
+            VideoCapture = new PSEyeReplayVideoCapture(stream_id);
+        }
+        else
+        {
+            VideoCapture = new PSEyeVideoCapture(camera_index);
+        }
 
         if (VideoCapture->isOpened())
         {
@@ -363,6 +486,21 @@ bool PS3EyeTracker::open(const DeviceEnumerator *enumerator)
 		VideoCapture->set(cv::CAP_PROP_EXPOSURE, cfg.exposure);
 		VideoCapture->set(cv::CAP_PROP_GAIN, cfg.gain);
 		VideoCapture->set(cv::CAP_PROP_FPS, cfg.frame_rate);
+
+        if (DeviceCapture::get_is_recording())
+        {
+            DeviceCaptureStreamDesc desc;
+
+            desc.stream_type = _DeviceCaptureStream_Video;
+            desc.device_type = CommonDeviceState::PS3EYE;
+            desc.vendor_id = tracker_enumerator->get_vendor_id();
+            desc.product_id = tracker_enumerator->get_product_id();
+            desc.interface_number = -1;
+            desc.path = USBDevicePath;
+            desc.identifier = identifier;
+
+            CaptureStreamId = DeviceCapture::register_stream(desc);
+        }
     }
 
     return bSuccess;
@@ -394,6 +532,19 @@ IDeviceInterface::ePollResult PS3EyeTracker::poll()
         {
             // New data available. Keep iterating.
             result = IControllerInterface::_PollResultSuccessNewData;
+
+            if (CaptureStreamId != -1)
+            {
+                const cv::Mat &frame = CaptureData->frame;
+                DeviceCaptureFrameInfo frame_info;
+
+                frame_info.width = frame.cols;
+                frame_info.height = frame.rows;
+                frame_info.cv_type = frame.type();
+                frame_info.row_bytes = static_cast<int>(frame.step);
+
+                DeviceCapture::record_video_frame(CaptureStreamId, frame_info, frame.data);
+            }
         }
 
         {
@@ -432,6 +583,8 @@ void PS3EyeTracker::close()
         delete VideoCapture;
         VideoCapture = nullptr;
     }
+
+    CaptureStreamId = -1;
 }
 
 long PS3EyeTracker::getMaxPollFailureCount() const
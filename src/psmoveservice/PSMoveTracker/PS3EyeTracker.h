@@ -148,6 +148,7 @@ private:
     class PSEyeVideoCapture *VideoCapture;
     class PSEyeCaptureData *CaptureData;
     ITrackerInterface::eDriverType DriverType;    
+    int CaptureStreamId; // Device capture stream the frames are recorded to, -1 if not recording
     
     // Read Controller State
     int NextPollSequenceNumber;
@@ -50,6 +50,10 @@ public:
     std::string getUniqueIndentifier() const;
     
 protected:
+    /// For captures that don't read from a camera device, doesn't open anything
+    PSEyeVideoCapture()
+        : m_index(-1) {}
+
     int m_index; /**< Keep track of index. Necessary for PSEYE_CLEYE_DRIVER */
     std::string m_indentifier; /**< Filled in when the tracker is opened */
 
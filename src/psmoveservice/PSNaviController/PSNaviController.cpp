@@ -3,6 +3,7 @@
 #include "ControllerDeviceEnumerator.h"
 #include "ControllerUSBDeviceEnumerator.h"
 #include "ControllerGamepadEnumerator.h"
+#include "DeviceCapture.h"
 #include "ServerLog.h"
 #include "ServerUtility.h"
 #include "USBDeviceManager.h"
@@ -93,6 +94,7 @@ public:
 	// LibUSB state
 	std::string usb_device_path;
 	t_usb_device_handle usb_device_handle;
+	int usb_capture_stream_id;
 
 	// Gamepad state
 	std::string gamepad_device_path;
@@ -112,6 +114,7 @@ public:
 		controller_bluetooth_address = "";
 		usb_device_path = "";
 		usb_device_handle = k_invalid_usb_device_handle;
+		usb_capture_stream_id = -1;
 		gamepad_device_path = "";
 		gamepad_index = -1;
 	}
@@ -242,6 +245,19 @@ bool PSNaviController::open(
 				SERVER_LOG_INFO("PSNaviController::open") << "  Successfully opened USB handle " << usb_device_handle;
 				APIContext->usb_device_path = cur_dev_path;
 				APIContext->usb_device_handle = usb_device_handle;
+
+				if (DeviceCapture::get_is_recording())
+				{
+					DeviceCaptureStreamDesc capture_desc;
+					capture_desc.stream_type = _DeviceCaptureStream_USB;
+					capture_desc.device_type = CommonDeviceState::PSNavi;
+					capture_desc.vendor_id = APIContext->vendor_id;
+					capture_desc.product_id = APIContext->product_id;
+					capture_desc.interface_number = -1;
+					capture_desc.path = cur_dev_path;
+
+					APIContext->usb_capture_stream_id = DeviceCapture::register_stream(capture_desc);
+				}
 			}
 			else
 			{
@@ -703,6 +719,8 @@ PSNaviController::pollUSB()
 	}
 	else
 	{
+		DeviceCapture::record_input_report(APIContext->usb_capture_stream_id, InBuffer, static_cast<size_t>(res));
+
 		parseInputData();
 		poll_result = IControllerInterface::_PollResultSuccessNewData;
 	}
@@ -2,11 +2,17 @@
 #define BOOST_LIB_DIAGNOSTIC
 
 #include "PSMoveService.h"
+#include "ServerAllocationTracker.h"
 #include "ServerNetworkManager.h"
 #include "ServerRequestHandler.h"
+#include "DeviceCapture.h"
 #include "DeviceManager.h"
+#include "PSMoveConfig.h"
 #include "ProtocolVersion.h"
+#include "ServerControllerView.h"
+#include "ServerHMDView.h"
 #include "ServerLog.h"
+#include "ServerScope.h"
 #include "SharedTrackerState.h"
 #include "TrackerManager.h"
 #include "USBDeviceManager.h"
@@ -14,6 +20,7 @@
 #include <boost/asio.hpp>
 #include <boost/application.hpp>
 #include <boost/program_options.hpp>
+#include <atomic>
 #include <fstream>
 #include <cstdio>
 #include <string>
@@ -32,6 +39,10 @@
 #define DAEMON_LOCK_FILE	"psmoveserviced.lock"
 #endif // defined(BOOST_POSIX_API)
 
+//-- constants -----
+// Ticks with a tracked device the service gets to settle in before --assert_no_tick_allocations applies
+static const int k_allocation_check_warmup_tick_count = 1000;
+
 //-- definitions -----
 class PSMoveServiceImpl
 {
@@ -39,11 +50,15 @@ public:
     PSMoveServiceImpl()
         : m_io_service()
         , m_signals(m_io_service)
+        , m_trace_signals(m_io_service)
         , m_usb_device_manager()
         , m_device_manager()
         , m_request_handler(&m_device_manager)
         , m_network_manager(&m_io_service, &m_request_handler)
         , m_status()
+        , m_termination_requested(false)
+        , m_tracked_tick_count(0)
+        , m_exit_code(0)
     {
         // Register to handle the signals that indicate when the server should exit.
         m_signals.add(SIGINT);
@@ -52,6 +67,12 @@ public:
         m_signals.add(SIGQUIT);
 #endif // defined(SIGQUIT)
         m_signals.async_wait(boost::bind(&PSMoveServiceImpl::handle_termination_signal, this));
+
+#if defined(SIGUSR1)
+        // Dump the service timeline on demand, e.g. `kill -USR1 <pid>` right after a hitch
+        m_trace_signals.add(SIGUSR1);
+        m_trace_signals.async_wait(boost::bind(&PSMoveServiceImpl::handle_trace_dump_signal, this, _1));
+#endif // defined(SIGUSR1)
     }
 
     /// Entry point into boost::application
@@ -66,10 +87,20 @@ public:
             {
                 m_status = context.find<boost::application::status>();
 
+                SERVER_TRACE_THREAD_NAME("Device Thread");
+
 				const TrackerManagerConfig &cfg = DeviceManager::getInstance()->m_tracker_manager->getConfig();
 
                 while (m_status->state() != boost::application::status::stoped)
                 {
+                    // The signal handler runs on the network thread, the status is only changed from here
+                    if (m_termination_requested)
+                    {
+                        SERVER_LOG_WARNING("PSMoveService") << "Received termination signal. Stopping Service.";
+                        m_status->state(boost::application::status::stoped);
+                        break;
+                    }
+
                     if (m_status->state() != boost::application::status::paused)
                     {
                         update();
@@ -81,11 +112,13 @@ public:
             else
             {
                 SERVER_LOG_FATAL("PSMoveService") << "Failed to startup the PSMove service";
+                m_exit_code= 1;
             }
         }
         catch (std::exception& e) 
         {
             SERVER_LOG_FATAL("EXCEPTION - PSMoveService") << e.what();
+            m_exit_code= 1;
         }
 
         // Attempt to shutdown the service
@@ -98,7 +131,7 @@ public:
             std::cerr << e.what() << std::endl;
         }
 
-        return 0;
+        return m_exit_code;
     }
     
     bool stop(boost::application::context& context)
@@ -140,6 +173,16 @@ private:
     {
         bool success= true;
 
+        /** Route cv::Mat buffers through the allocation counts before any tracker opens */
+        ServerAllocationTracker::startup();
+
+        if (PSMoveService::getInstance()->getProgramSettings()->assert_no_tick_allocations &&
+            !ServerAllocationTracker::get_is_available())
+        {
+            SERVER_LOG_FATAL("PSMoveService") << "--assert_no_tick_allocations needs a build with PSM_ENABLE_ALLOCATION_TRACKING";
+            success= false;
+        }
+
 		/** Make sure the shared memory directory exists (if non-default path is defined) */
 		#if defined(BOOST_INTERPROCESS_SHARED_DIR_PATH)
 		boost::filesystem::path shared_mem_dir(BOOST_INTERPROCESS_SHARED_DIR_PATH);
@@ -174,6 +217,29 @@ private:
             }
         }
 
+        /** Start recording or replaying the raw device input before any device gets opened */
+        if (success)
+        {
+            const PSMoveService::ProgramSettings *settings = PSMoveService::getInstance()->getProgramSettings();
+
+            if (!settings->capture_replay_filename.empty())
+            {
+                if (!DeviceCapture::start_replay(settings->capture_replay_filename, !settings->capture_replay_fast))
+                {
+                    SERVER_LOG_FATAL("PSMoveService") << "Failed to open the device capture " << settings->capture_replay_filename;
+                    success = false;
+                }
+            }
+            else if (!settings->capture_record_filename.empty())
+            {
+                if (!DeviceCapture::start_recording(settings->capture_record_filename))
+                {
+                    SERVER_LOG_FATAL("PSMoveService") << "Failed to create the device capture " << settings->capture_record_filename;
+                    success = false;
+                }
+            }
+        }
+
         /** Setup the controller manager */
         if (success)
         {
@@ -200,20 +266,40 @@ private:
     /// Called in the application loop.
     void update()
     {
+        SERVER_TRACE_SCOPE("PSMoveService::update");
+
         /** Update an async requests still waiting to complete */
-        m_request_handler.update();
+        {
+            SERVER_TRACE_SCOPE("ServerRequestHandler::update");
+            m_request_handler.update();
+        }
 
         /** Process any async results from the USB transfer thread */
-        m_usb_device_manager.update();
+        {
+            SERVER_TRACE_SCOPE("USBDeviceManager::update");
+            m_usb_device_manager.update();
+        }
 
         /**
          Update the list of active tracked controllers
          Send controller updates to the client
          */
+        DeviceCapture::advance_replay_clock();
+        ServerAllocationTracker::begin_tick();
         m_device_manager.update();
+        ServerAllocationTracker::end_tick();
+
+        /** Fail the run once a steady state tick allocates, if asked to */
+        if (PSMoveService::getInstance()->getProgramSettings()->assert_no_tick_allocations)
+        {
+            check_tick_allocations();
+        }
 
         /** Process incoming/outgoing networking requests */
-        m_network_manager.update();
+        {
+            SERVER_TRACE_SCOPE("ServerNetworkManager::update");
+            m_network_manager.update();
+        }
     }
 
     void shutdown()
@@ -225,19 +311,107 @@ private:
         // Must be before device manager since closing a connection can modify device state
         m_network_manager.shutdown();
 
+        // Nothing can ask for a trace dump once the connections are closed, let the one in flight finish
+        ServerTrace::wait_for_dump();
+
         // Disconnect any actively connected controllers
         m_device_manager.shutdown();
 
+        // Finish writing the device capture once nothing can read from the devices anymore
+        DeviceCapture::stop();
+
         // Shutdown the usb async request thread
         // Must be after device manager since devices can have an active usb connection
         m_usb_device_manager.shutdown();
+
+        if (ServerAllocationTracker::get_is_available())
+        {
+            ServerAllocationTracker::log_summary();
+        }
+    }
+
+    /// Stops the service with an error when a tick allocated after the tracked devices settled in.
+    /// Ticks without any tracked device restart the warmup, acquiring or losing tracking is allowed to allocate.
+    void check_tick_allocations()
+    {
+        if (!get_is_any_device_tracked())
+        {
+            m_tracked_tick_count= 0;
+        }
+        else if (m_tracked_tick_count < k_allocation_check_warmup_tick_count)
+        {
+            ++m_tracked_tick_count;
+        }
+        else if (ServerAllocationTracker::get_tick_allocation_count() > 0)
+        {
+            SERVER_LOG_ERROR("PSMoveService") <<
+                "Steady state tick made " << ServerAllocationTracker::get_tick_allocation_count() <<
+                " heap allocations. Stopping Service.";
+            ServerAllocationTracker::log_tick_allocations();
+
+            m_exit_code= 1;
+            m_status->state(boost::application::status::stoped);
+        }
+    }
+
+    bool get_is_any_device_tracked()
+    {
+        for (int controller_id = 0; controller_id < m_device_manager.getControllerViewMaxCount(); ++controller_id)
+        {
+            ServerControllerViewPtr controller_view = m_device_manager.getControllerViewPtr(controller_id);
+
+            if (controller_view->getIsOpen() && controller_view->getIsCurrentlyTracking())
+            {
+                return true;
+            }
+        }
+
+        for (int hmd_id = 0; hmd_id < m_device_manager.getHMDViewMaxCount(); ++hmd_id)
+        {
+            ServerHMDViewPtr hmd_view = m_device_manager.getHMDViewPtr(hmd_id);
+
+            if (hmd_view->getIsOpen() && hmd_view->getIsCurrentlyTracking())
+            {
+                return true;
+            }
+        }
+
+        return false;
     }
 
+    // Runs on the network thread, which may start before m_status is set
     void handle_termination_signal()
     {
-        // flag the service as stopped
-        SERVER_LOG_WARNING("PSMoveService") << "Received termination signal. Stopping Service.";
-        m_status->state(boost::application::status::stoped);
+        // flag the service as stopped, the device loop picks it up on its next tick
+        m_termination_requested = true;
+    }
+
+    void handle_trace_dump_signal(const boost::system::error_code& error)
+    {
+        if (!error)
+        {
+            // Written on the trace dump thread so the main io_service keeps serving clients meanwhile
+            if (!ServerTrace::start_dump(&PSMoveServiceImpl::handle_trace_dump_finished))
+            {
+                SERVER_LOG_WARNING("PSMoveService") << "Ignoring trace dump signal, the previous dump is still being written";
+            }
+
+            // Keep listening for the next dump request
+            m_trace_signals.async_wait(boost::bind(&PSMoveServiceImpl::handle_trace_dump_signal, this, _1));
+        }
+    }
+
+    // Runs on the trace dump thread
+    static void handle_trace_dump_finished(bool bSuccess, const std::string &filename, int event_count)
+    {
+        if (bSuccess)
+        {
+            SERVER_LOG_INFO("PSMoveService") << "Wrote " << event_count << " trace events to " << filename;
+        }
+        else
+        {
+            SERVER_LOG_ERROR("PSMoveService") << "Failed to write the trace to " << filename;
+        }
     }
 
 private:   
@@ -247,6 +421,9 @@ private:
     // The signal_set is used to register for process termination notifications.
     boost::asio::signal_set m_signals;
 
+    // Signals that ask for a dump of the service timeline
+    boost::asio::signal_set m_trace_signals;
+
     // Manages all control and bulk transfer requests in another thread
     USBDeviceManager m_usb_device_manager;
 
@@ -261,6 +438,15 @@ private:
 
     // Whether the application should keep running or not
     std::shared_ptr<boost::application::status> m_status;
+
+    // Set by the termination signal handler, checked by the device loop
+    std::atomic_bool m_termination_requested;
+
+    // Consecutive ticks with a tracked device, see check_tick_allocations()
+    int m_tracked_tick_count;
+
+    // Returned from the application once the service stops
+    int m_exit_code;
 };
 
 static void parse_program_settings(
@@ -293,6 +479,38 @@ static void parse_program_settings(
 	{
 		settings.working_directory.clear();
 	}
+
+    if (options_map.count("config_directory"))
+    {
+        settings.config_directory= options_map["config_directory"].as<std::string>();
+    }
+    else
+    {
+        settings.config_directory.clear();
+    }
+
+    settings.enable_tracing= options_map.count("trace") > 0;
+
+    if (options_map.count("record_capture"))
+    {
+        settings.capture_record_filename= options_map["record_capture"].as<std::string>();
+    }
+    else
+    {
+        settings.capture_record_filename.clear();
+    }
+
+    if (options_map.count("replay_capture"))
+    {
+        settings.capture_replay_filename= options_map["replay_capture"].as<std::string>();
+    }
+    else
+    {
+        settings.capture_replay_filename.clear();
+    }
+
+    settings.capture_replay_fast= options_map.count("replay_fast") > 0;
+    settings.assert_no_tick_allocations= options_map.count("assert_no_tick_allocations") > 0;
 }
 
 #if defined(BOOST_WINDOWS_API) 
@@ -328,6 +546,15 @@ bool win32_service_management_action(
 			service_options+= "\"";
         }
 
+        if (options_map.count("config_directory"))
+        {
+            std::string config_directory= options_map["config_directory"].as<std::string>();
+
+            service_options+= " --config_directory \"";
+            service_options+= config_directory;
+            service_options+= "\"";
+        }
+
         boost::system::error_code ec;
 		boost::application::example::install_windows_service(
             boost::application::setup_arg(options_map["name"].as<std::string>()), 
@@ -505,6 +732,12 @@ int PSMoveService::exec(int argc, char *argv[])
         ("log_level,l", boost::program_options::value<std::string>(), "The level of logging to use: trace, debug, info, warning, error, fatal")
         ("admin_password,p", boost::program_options::value<std::string>(), "Remember the admin password for this machine (optional)")
 		("working_directory", boost::program_options::value<std::string>(), "service working directory (optional)")
+        ("config_directory", boost::program_options::value<std::string>(), "Load and save the config files in this directory instead of the per user one (optional)")
+        ("trace", "Record the service timeline from startup so it can be dumped as Chrome trace JSON (optional)")
+        ("record_capture", boost::program_options::value<std::string>(), "Record the raw input of every device to the given capture file (optional)")
+        ("replay_capture", boost::program_options::value<std::string>(), "Replay a device capture file instead of reading from the hardware (optional)")
+        ("replay_fast", "Replay the device capture as fast as the service can update rather than in real time (optional)")
+        ("assert_no_tick_allocations", "Exit with an error once a tick with tracked devices allocates memory, needs a PSM_ENABLE_ALLOCATION_TRACKING build (optional)")
 #if defined(BOOST_WINDOWS_API)
         (",i", "install service")
         (",u", "uninstall service")
@@ -568,9 +801,18 @@ int PSMoveService::exec(int argc, char *argv[])
 		}
 	}
 
+    // Config files get loaded as the managers and devices start up
+    if (!this->getProgramSettings()->config_directory.empty())
+    {
+        PSMoveConfig::setConfigDirectory(this->getProgramSettings()->config_directory);
+    }
+
     // initialize logging system
     log_init(this->getProgramSettings()->log_level, "PSMoveService.log");
 
+    // The timeline can also be switched on later with a SET_TRACING_ENABLED request
+    ServerTrace::set_enabled(this->getProgramSettings()->enable_tracing);
+
     // Start the service app
     SERVER_LOG_INFO("main") << "Starting PSMoveService v" << PSM_RELEASE_VERSION_STRING << " (protocol v" << PSM_PROTOCOL_VERSION_STRING << ")";
     try
@@ -13,6 +13,12 @@ public:
         std::string log_level;
         std::string admin_password;
 		std::string working_directory;
+        std::string config_directory;
+        bool enable_tracing;
+        std::string capture_record_filename;
+        std::string capture_replay_filename;
+        bool capture_replay_fast;
+        bool assert_no_tick_allocations;
     };
 
     PSMoveService();
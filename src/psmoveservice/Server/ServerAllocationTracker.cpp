@@ -0,0 +1,236 @@
+//-- includes -----
+#include "ServerAllocationTracker.h"
+#include "ServerLog.h"
+
+#if defined(PSM_ENABLE_ALLOCATION_TRACKING)
+#include "ServerCountingMatAllocator.h"
+
+#include <new>
+#include <stdlib.h>
+#endif // PSM_ENABLE_ALLOCATION_TRACKING
+
+#include <iomanip>
+
+#ifdef _MSC_VER
+#define ALLOCATION_THREAD_LOCAL __declspec(thread)
+#else
+#define ALLOCATION_THREAD_LOCAL __thread
+#endif
+
+//-- constants -----
+static const char *k_allocation_phase_names[ServerAllocationPhase_COUNT] = {
+    "IPlatformDeviceAPI::poll",                 // ServerAllocationPhase_PlatformPoll
+    "ControllerManager::poll",                  // ServerAllocationPhase_ControllerPoll
+    "TrackerManager::poll",                     // ServerAllocationPhase_TrackerPoll
+    "HMDManager::poll",                         // ServerAllocationPhase_HMDPoll
+    "ControllerManager::updateStateAndPredict", // ServerAllocationPhase_ControllerUpdate
+    "HMDManager::updateStateAndPredict",        // ServerAllocationPhase_HMDUpdate
+    "ControllerManager::publish",               // ServerAllocationPhase_ControllerPublish
+    "TrackerManager::publish",                  // ServerAllocationPhase_TrackerPublish
+    "HMDManager::publish",                      // ServerAllocationPhase_HMDPublish
+};
+
+//-- definitions -----
+struct AllocationPhaseCounts
+{
+    long long allocation_count;
+    long long allocated_bytes;
+};
+
+//-- globals -----
+// Only allocations made on a thread inside a SERVER_PHASE_SCOPE get counted,
+// and only the device thread ever enters one, so none of the counts need to be atomic.
+static ALLOCATION_THREAD_LOCAL int t_current_allocation_phase = ServerAllocationPhase_None;
+
+static AllocationPhaseCounts g_tick_phase_counts[ServerAllocationPhase_COUNT];
+static AllocationPhaseCounts g_total_phase_counts[ServerAllocationPhase_COUNT];
+static long long g_total_tick_count = 0;
+
+//-- allocator hooks -----
+#if defined(PSM_ENABLE_ALLOCATION_TRACKING)
+
+static void record_allocation(size_t size)
+{
+    const int phase = t_current_allocation_phase;
+
+    if (phase != ServerAllocationPhase_None)
+    {
+        AllocationPhaseCounts &counts = g_tick_phase_counts[phase];
+
+        ++counts.allocation_count;
+        counts.allocated_bytes += static_cast<long long>(size);
+    }
+}
+
+// Scratch memory OpenCV takes straight from cv::fastMalloc (e.g. in findContours) isn't seen,
+// only cv::Mat buffers and everything that goes through operator new.
+void *operator new(size_t size)
+{
+    record_allocation(size);
+
+    void *memory = malloc(size > 0 ? size : 1);
+    if (memory == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+
+    return memory;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    record_allocation(size);
+
+    return malloc(size > 0 ? size : 1);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+    return operator new(size, std::nothrow);
+}
+
+void operator delete(void *memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete(void *memory, const std::nothrow_t &) noexcept
+{
+    free(memory);
+}
+
+void operator delete[](void *memory, const std::nothrow_t &) noexcept
+{
+    free(memory);
+}
+
+static ServerCountingMatAllocator *g_counting_mat_allocator = nullptr;
+
+#endif // PSM_ENABLE_ALLOCATION_TRACKING
+
+//-- public interface -----
+namespace ServerAllocationTracker
+{
+    bool get_is_available()
+    {
+#if defined(PSM_ENABLE_ALLOCATION_TRACKING)
+        return true;
+#else
+        return false;
+#endif // PSM_ENABLE_ALLOCATION_TRACKING
+    }
+
+    void startup()
+    {
+#if defined(PSM_ENABLE_ALLOCATION_TRACKING)
+        if (g_counting_mat_allocator == nullptr)
+        {
+            // Never freed, Mats still alive at exit keep pointing at it
+            g_counting_mat_allocator = new ServerCountingMatAllocator(record_allocation);
+            cv::Mat::setDefaultAllocator(g_counting_mat_allocator);
+        }
+#endif // PSM_ENABLE_ALLOCATION_TRACKING
+    }
+
+    void begin_tick()
+    {
+        for (int phase_index = 0; phase_index < ServerAllocationPhase_COUNT; ++phase_index)
+        {
+            g_tick_phase_counts[phase_index].allocation_count = 0;
+            g_tick_phase_counts[phase_index].allocated_bytes = 0;
+        }
+    }
+
+    void end_tick()
+    {
+        for (int phase_index = 0; phase_index < ServerAllocationPhase_COUNT; ++phase_index)
+        {
+            g_total_phase_counts[phase_index].allocation_count += g_tick_phase_counts[phase_index].allocation_count;
+            g_total_phase_counts[phase_index].allocated_bytes += g_tick_phase_counts[phase_index].allocated_bytes;
+        }
+
+        ++g_total_tick_count;
+    }
+
+    eServerAllocationPhase set_current_phase(eServerAllocationPhase phase)
+    {
+        const eServerAllocationPhase previous_phase = static_cast<eServerAllocationPhase>(t_current_allocation_phase);
+
+        t_current_allocation_phase = phase;
+
+        return previous_phase;
+    }
+
+    long long get_tick_allocation_count()
+    {
+        long long allocation_count = 0;
+
+        for (int phase_index = 0; phase_index < ServerAllocationPhase_COUNT; ++phase_index)
+        {
+            allocation_count += g_tick_phase_counts[phase_index].allocation_count;
+        }
+
+        return allocation_count;
+    }
+
+    long long get_tick_phase_allocation_count(eServerAllocationPhase phase)
+    {
+        return g_tick_phase_counts[phase].allocation_count;
+    }
+
+    long long get_tick_phase_allocated_bytes(eServerAllocationPhase phase)
+    {
+        return g_tick_phase_counts[phase].allocated_bytes;
+    }
+
+    const char *get_phase_name(eServerAllocationPhase phase)
+    {
+        return (phase >= 0 && phase < ServerAllocationPhase_COUNT) ? k_allocation_phase_names[phase] : "None";
+    }
+
+    void log_tick_allocations()
+    {
+        for (int phase_index = 0; phase_index < ServerAllocationPhase_COUNT; ++phase_index)
+        {
+            const AllocationPhaseCounts &counts = g_tick_phase_counts[phase_index];
+
+            if (counts.allocation_count > 0)
+            {
+                SERVER_LOG_INFO("ServerAllocationTracker") <<
+                    k_allocation_phase_names[phase_index] << ": " <<
+                    counts.allocation_count << " allocations, " << counts.allocated_bytes << " bytes";
+            }
+        }
+    }
+
+    void log_summary()
+    {
+        if (g_total_tick_count > 0)
+        {
+            const double tick_count = static_cast<double>(g_total_tick_count);
+
+            SERVER_LOG_INFO("ServerAllocationTracker") << "Allocations per tick over " << g_total_tick_count << " ticks:";
+
+            for (int phase_index = 0; phase_index < ServerAllocationPhase_COUNT; ++phase_index)
+            {
+                const AllocationPhaseCounts &counts = g_total_phase_counts[phase_index];
+
+                SERVER_LOG_INFO("ServerAllocationTracker") <<
+                    k_allocation_phase_names[phase_index] << ": " <<
+                    std::fixed << std::setprecision(2) <<
+                    static_cast<double>(counts.allocation_count) / tick_count << " allocations, " <<
+                    static_cast<double>(counts.allocated_bytes) / tick_count << " bytes";
+            }
+        }
+    }
+};
@@ -0,0 +1,65 @@
+#ifndef SERVER_ALLOCATION_TRACKER_H
+#define SERVER_ALLOCATION_TRACKER_H
+
+//-- constants -----
+/// Phases of DeviceManager::update() that heap allocations get counted under
+enum eServerAllocationPhase
+{
+    ServerAllocationPhase_None= -1,             // Allocations outside of a device update tick aren't counted
+
+    ServerAllocationPhase_PlatformPoll= 0,      // IPlatformDeviceAPI::poll
+    ServerAllocationPhase_ControllerPoll,       // ControllerManager::poll
+    ServerAllocationPhase_TrackerPoll,          // TrackerManager::poll
+    ServerAllocationPhase_HMDPoll,              // HMDManager::poll
+    ServerAllocationPhase_ControllerUpdate,     // ControllerManager::updateStateAndPredict
+    ServerAllocationPhase_HMDUpdate,            // HMDManager::updateStateAndPredict
+    ServerAllocationPhase_ControllerPublish,    // ControllerManager::publish
+    ServerAllocationPhase_TrackerPublish,       // TrackerManager::publish
+    ServerAllocationPhase_HMDPublish,           // HMDManager::publish
+
+    ServerAllocationPhase_COUNT
+};
+
+//-- interface -----
+/// Counts the heap allocations made in each phase of the device update loop.
+/// Only built with PSM_ENABLE_ALLOCATION_TRACKING defined, which replaces the global operator new/delete
+/// and the default cv::Mat allocator; otherwise every count stays zero.
+/// The device thread (PSMoveService::update) is the only one that starts, ends and reads ticks.
+namespace ServerAllocationTracker
+{
+    /// True when the service was built with PSM_ENABLE_ALLOCATION_TRACKING
+    bool get_is_available();
+
+    /// Routes cv::Mat buffers through the counting allocator, call before any device opens
+    void startup();
+
+    /// Clears the counts of the previous tick
+    void begin_tick();
+
+    /// Adds the counts of the tick to the totals logged by log_summary(), they stay readable until the next begin_tick()
+    void end_tick();
+
+    /// Sets the phase allocations on the calling thread get counted under, returns the previous phase
+    eServerAllocationPhase set_current_phase(eServerAllocationPhase phase);
+
+    /// Allocations made by all phases during the last tick
+    long long get_tick_allocation_count();
+
+    /// Allocations and bytes allocated by one phase during the last tick
+    long long get_tick_phase_allocation_count(eServerAllocationPhase phase);
+    long long get_tick_phase_allocated_bytes(eServerAllocationPhase phase);
+
+    /// Short display name of a phase, e.g. "ControllerManager::poll"
+    const char *get_phase_name(eServerAllocationPhase phase);
+
+    /// Logs the allocations per phase of the last tick
+    void log_tick_allocations();
+
+    /// Logs the average allocations per tick of each phase since startup
+    void log_summary();
+};
+
+//-- macros -----
+// Phases get entered with SERVER_PHASE_SCOPE (ServerScope.h), which also records them in the timeline trace.
+
+#endif // SERVER_ALLOCATION_TRACKER_H
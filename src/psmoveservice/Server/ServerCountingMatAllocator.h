@@ -0,0 +1,55 @@
+#ifndef SERVER_COUNTING_MAT_ALLOCATOR_H
+#define SERVER_COUNTING_MAT_ALLOCATOR_H
+
+//-- includes -----
+#include "opencv2/core/mat.hpp"
+
+#include <stddef.h>
+
+//-- definitions -----
+/// cv::MatAllocator that hands out OpenCV's standard buffers and reports the size of each one it allocates.
+/// Used by the service's allocation tracker and by benchmark_vision to count cv::Mat buffers.
+/// Mats free their buffer through the allocator that made it, so an instance has to outlive every Mat
+/// allocated while it was the default allocator.
+class ServerCountingMatAllocator : public cv::MatAllocator
+{
+public:
+    typedef void(*t_record_allocation_callback)(size_t size);
+
+    ServerCountingMatAllocator(t_record_allocation_callback record_allocation)
+        : m_stdAllocator(cv::Mat::getStdAllocator())
+        , m_record_allocation(record_allocation)
+    {
+    }
+
+    cv::UMatData *allocate(
+        int dims, const int *sizes, int type, void *data, size_t *step,
+        int flags, cv::UMatUsageFlags usageFlags) const override
+    {
+        cv::UMatData *result = m_stdAllocator->allocate(dims, sizes, type, data, step, flags, usageFlags);
+
+        // Mats wrapping existing memory don't allocate anything
+        if (result != nullptr && data == nullptr)
+        {
+            m_record_allocation(result->size);
+        }
+
+        return result;
+    }
+
+    bool allocate(cv::UMatData *data, int accessflags, cv::UMatUsageFlags usageFlags) const override
+    {
+        return m_stdAllocator->allocate(data, accessflags, usageFlags);
+    }
+
+    void deallocate(cv::UMatData *data) const override
+    {
+        m_stdAllocator->deallocate(data);
+    }
+
+private:
+    cv::MatAllocator *m_stdAllocator;
+    t_record_allocation_callback m_record_allocation;
+};
+
+#endif // SERVER_COUNTING_MAT_ALLOCATOR_H
@@ -1,22 +1,129 @@
 //-- includes -----
 #include "ServerLog.h"
 
+#include <boost/lockfree/spsc_queue.hpp>
+
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <mutex>
 #include <ostream>
+#include <thread>
+#include <vector>
+#include <string.h>
 
 #ifdef _MSC_VER
 #pragma warning (disable: 4996) // 'This function or variable may be unsafe': localtime
 #endif
 
+//-- constants -----
+// Lines each thread can have queued before new ones get dropped
+static const size_t k_log_ring_capacity = 1024;
+
+// How long the logger thread sleeps once every ring is empty
+static const int k_log_writer_sleep_ms = 5;
+
+enum e_log_argument_type
+{
+	_log_argument_bool,
+	_log_argument_char,
+	_log_argument_signed,
+	_log_argument_unsigned,
+	_log_argument_double,
+	_log_argument_string,
+	_log_argument_manipulator
+};
+
+typedef std::ios_base &(*t_ios_manipulator)(std::ios_base &);
+
+//-- definitions -----
+/// Lines queued by a single thread.
+/// The owning thread is the only producer and the logger thread the only consumer.
+/// Once its thread exits the ring goes back to the logger for the next new thread to use.
+struct LogRing
+{
+	boost::lockfree::spsc_queue<LogRecord> records;
+	std::atomic<unsigned long long> dropped_count;
+
+	LogRing()
+		: records(k_log_ring_capacity)
+		, dropped_count(0)
+	{
+	}
+};
+
+class LogWriter
+{
+public:
+	LogWriter(std::ostream *console_stream, std::ostream *file_stream);
+	~LogWriter();
+
+	LogRing *register_ring();
+	void release_ring(LogRing *ring);
+
+private:
+	void thread_func();
+	bool write_pending_records();
+
+	std::ostream *m_console_stream;
+	std::ostream *m_file_stream;
+
+	// Only locked when a thread logs for the first time or exits, and while the logger thread empties the rings
+	std::mutex m_ring_mutex;
+	std::vector<std::unique_ptr<LogRing>> m_rings;
+	std::vector<LogRing *> m_free_rings;
+
+	std::vector<LogRecord> m_pending_records;
+	std::atomic_bool m_exit_signaled;
+	std::thread m_thread;
+};
+
+/// The ring the calling thread logs into, handed back to the logger when the thread exits
+struct LogRingLease
+{
+	LogRing *ring;
+	unsigned int generation;
+
+	LogRingLease()
+		: ring(nullptr)
+		, generation(0)
+	{
+	}
+
+	~LogRingLease();
+};
+
+/// Keeps log_dispose() from deleting the logger while the calling thread uses it
+class LogWriterUseScope
+{
+public:
+	LogWriterUseScope();
+	~LogWriterUseScope();
+
+	LogWriter *get_log_writer() const { return m_log_writer; }
+
+private:
+	LogWriter *m_log_writer;
+};
+
 //-- globals -----
 e_log_severity_level g_min_log_level= _log_severity_level_info;
-std::ostream *g_console_stream= nullptr;
-std::ostream *g_file_stream = nullptr;
-std::mutex *g_logger_mutex = nullptr;
+std::atomic<LogWriter *> g_log_writer(nullptr);
+
+// Threads currently between loading g_log_writer and their last use of it
+std::atomic<int> g_log_writer_use_count(0);
+
+// Bumped on every log_init so that threads drop rings cached from an earlier logger
+std::atomic<unsigned int> g_log_writer_generation(0);
+static thread_local LogRingLease t_log_ring_lease;
+
+//-- prototypes -----
+static void log_write_timestamp_prefix(std::ostream &out, const std::chrono::system_clock::time_point &timestamp);
+static void log_write_payload(std::ostream &out, const unsigned char *payload, size_t payload_size, bool bManipulatorsOnly);
+static void log_write_record(std::ostream &out, const LogRecord &record);
 
 //-- public implementation -----
 void log_init(const std::string &log_level, const std::string &log_filename)
@@ -50,34 +157,30 @@ void log_init(const std::string &log_level, const std::string &log_filename)
         g_min_log_level= _log_severity_level_fatal;
     }
 
-	g_console_stream = new std::ostream(std::cout.rdbuf());
+	std::ostream *console_stream = new std::ostream(std::cout.rdbuf());
+	std::ostream *file_stream = nullptr;
 	if (log_filename.length() > 0)
 	{
-		g_file_stream = new std::ofstream(log_filename, std::ofstream::out);
+		file_stream = new std::ofstream(log_filename, std::ofstream::out);
 	}
-	g_logger_mutex = new std::mutex();
+
+	++g_log_writer_generation;
+	g_log_writer = new LogWriter(console_stream, file_stream);
 }
 
 void log_dispose()
 {
-	if (g_console_stream != nullptr)
-	{
-		g_console_stream->flush();
-		delete g_console_stream;
-		g_console_stream = nullptr;
-	}
+	LogWriter *log_writer = g_log_writer.exchange(nullptr);
 
-	if (g_file_stream != nullptr)
+	if (log_writer != nullptr)
 	{
-		g_console_stream->flush();
-		delete g_file_stream;
-		g_file_stream = nullptr;
-	}
+		// Threads that loaded the logger before it was cleared are done with it once the count drops to zero
+		while (g_log_writer_use_count.load() != 0)
+		{
+			std::this_thread::yield();
+		}
 
-	if (g_logger_mutex != nullptr)
-	{
-		delete g_logger_mutex;
-		g_logger_mutex = nullptr;
+		delete log_writer;
 	}
 }
 
@@ -88,21 +191,19 @@ bool log_can_emit_level(e_log_severity_level level)
 
 std::string log_get_timestamp_prefix()
 {
-    auto now = std::chrono::system_clock::now();
-    auto seconds = std::chrono::time_point_cast<std::chrono::seconds>(now);
-    auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(now - seconds);
-    time_t in_time_t = std::chrono::system_clock::to_time_t(now);
-
     std::stringstream ss;
-    ss << "[" << std::put_time(std::localtime(&in_time_t), "%Y-%m-%d %H:%M:%S") << "." << milliseconds.count() << "]: ";
+    log_write_timestamp_prefix(ss, std::chrono::system_clock::now());
 
     return ss.str();
 }
 
-//-- member functions -----
-LoggerStream::LoggerStream(bool bEmit) :
-	m_bEmitLine(bEmit)
+//-- LoggerStream -----
+LoggerStream::LoggerStream(e_log_severity_level level)
 {
+	m_record.timestamp = std::chrono::system_clock::now();
+	m_record.level = level;
+	m_record.payload_size = 0;
+	m_record.bTruncated = false;
 }
 
 LoggerStream::~LoggerStream()
@@ -110,32 +211,449 @@ LoggerStream::~LoggerStream()
 	write_line();
 }
 
+static bool log_record_append(LogRecord &record, e_log_argument_type type, const void *data, size_t data_size)
+{
+	if (record.bTruncated || record.payload_size + 1 + data_size > LOG_RECORD_PAYLOAD_SIZE)
+	{
+		record.bTruncated = true;
+		return false;
+	}
+
+	record.payload[record.payload_size] = static_cast<unsigned char>(type);
+	memcpy(&record.payload[record.payload_size + 1], data, data_size);
+	record.payload_size += static_cast<unsigned short>(1 + data_size);
+
+	return true;
+}
+
+static void log_record_append_string(LogRecord &record, const char *string, size_t length)
+{
+	const size_t header_size = 1 + sizeof(unsigned short);
+
+	if (record.bTruncated || record.payload_size + header_size >= LOG_RECORD_PAYLOAD_SIZE)
+	{
+		record.bTruncated = true;
+		return;
+	}
+
+	// Keep as much of the string as fits
+	const size_t space_left = LOG_RECORD_PAYLOAD_SIZE - record.payload_size - header_size;
+	const unsigned short stored_length = static_cast<unsigned short>(std::min(length, space_left));
+
+	record.payload[record.payload_size] = static_cast<unsigned char>(_log_argument_string);
+	memcpy(&record.payload[record.payload_size + 1], &stored_length, sizeof(unsigned short));
+	memcpy(&record.payload[record.payload_size + header_size], string, stored_length);
+	record.payload_size += static_cast<unsigned short>(header_size + stored_length);
+	record.bTruncated = stored_length < length;
+}
+
+LoggerStream &LoggerStream::operator<<(bool x)
+{
+	if (m_textBuffer)
+	{
+		*m_textBuffer << x;
+	}
+	else
+	{
+		const unsigned char value = x ? 1 : 0;
+		log_record_append(m_record, _log_argument_bool, &value, sizeof(value));
+	}
+
+	return *this;
+}
+
+LoggerStream &LoggerStream::operator<<(char x)
+{
+	if (m_textBuffer)
+	{
+		*m_textBuffer << x;
+	}
+	else
+	{
+		log_record_append(m_record, _log_argument_char, &x, sizeof(x));
+	}
+
+	return *this;
+}
+
+LoggerStream &LoggerStream::operator<<(signed char x)
+{
+	return *this << static_cast<char>(x);
+}
+
+LoggerStream &LoggerStream::operator<<(unsigned char x)
+{
+	return *this << static_cast<char>(x);
+}
+
+LoggerStream &LoggerStream::operator<<(const char *x)
+{
+	if (x == nullptr)
+	{
+		// Streaming a null string into a std::ostream is undefined, log it as empty
+		x = "";
+	}
+
+	if (m_textBuffer)
+	{
+		*m_textBuffer << x;
+	}
+	else
+	{
+		log_record_append_string(m_record, x, strlen(x));
+	}
+
+	return *this;
+}
+
+LoggerStream &LoggerStream::operator<<(const std::string &x)
+{
+	if (m_textBuffer)
+	{
+		*m_textBuffer << x;
+	}
+	else
+	{
+		log_record_append_string(m_record, x.c_str(), x.length());
+	}
+
+	return *this;
+}
+
+LoggerStream &LoggerStream::operator<<(std::ios_base &(*manipulator)(std::ios_base &))
+{
+	if (m_textBuffer)
+	{
+		*m_textBuffer << manipulator;
+	}
+	else
+	{
+		log_record_append(m_record, _log_argument_manipulator, &manipulator, sizeof(manipulator));
+	}
+
+	return *this;
+}
+
+void LoggerStream::write_signed(long long x)
+{
+	log_record_append(m_record, _log_argument_signed, &x, sizeof(x));
+}
+
+void LoggerStream::write_unsigned(unsigned long long x)
+{
+	log_record_append(m_record, _log_argument_unsigned, &x, sizeof(x));
+}
+
+void LoggerStream::write_double(double x)
+{
+	log_record_append(m_record, _log_argument_double, &x, sizeof(x));
+}
+
+std::ostringstream &LoggerStream::get_text_buffer()
+{
+	if (!m_textBuffer)
+	{
+		m_textBuffer.reset(new std::ostringstream());
+
+		// Carry over the format flags already streamed in binary form
+		log_write_payload(*m_textBuffer, m_record.payload, m_record.payload_size, true);
+	}
+
+	return *m_textBuffer;
+}
+
 void LoggerStream::write_line()
 {
-	if (m_bEmitLine)
+	if (m_textBuffer)
+	{
+		const std::string text = m_textBuffer->str();
+
+		log_record_append_string(m_record, text.c_str(), text.length());
+	}
+
+	LogWriterUseScope log_writer_scope;
+	LogWriter *log_writer = log_writer_scope.get_log_writer();
+	if (log_writer == nullptr)
+	{
+		return;
+	}
+
+	LogRingLease &lease = t_log_ring_lease;
+	const unsigned int generation = g_log_writer_generation.load();
+	if (lease.ring == nullptr || lease.generation != generation)
+	{
+		lease.ring = log_writer->register_ring();
+		lease.generation = generation;
+	}
+
+	if (!lease.ring->records.push(m_record))
+	{
+		// Never wait on the logger thread, it reports how many lines got lost instead
+		++lease.ring->dropped_count;
+	}
+}
+
+//-- LogRingLease -----
+LogRingLease::~LogRingLease()
+{
+	if (ring == nullptr)
 	{
-		const std::string line = m_lineBuffer.str();
+		return;
+	}
+
+	LogWriterUseScope log_writer_scope;
+	LogWriter *log_writer = log_writer_scope.get_log_writer();
+
+	// A ring from an earlier logger was deleted along with it
+	if (log_writer != nullptr && generation == g_log_writer_generation.load())
+	{
+		log_writer->release_ring(ring);
+	}
+
+	ring = nullptr;
+}
 
-		if (g_console_stream != nullptr)
+//-- LogWriterUseScope -----
+LogWriterUseScope::LogWriterUseScope()
+{
+	// Counted before the load, so log_dispose() either sees the count or this sees nullptr
+	++g_log_writer_use_count;
+	m_log_writer = g_log_writer.load();
+}
+
+LogWriterUseScope::~LogWriterUseScope()
+{
+	--g_log_writer_use_count;
+}
+
+//-- LogWriter -----
+LogWriter::LogWriter(std::ostream *console_stream, std::ostream *file_stream)
+	: m_console_stream(console_stream)
+	, m_file_stream(file_stream)
+	, m_rings()
+	, m_pending_records()
+	, m_exit_signaled(false)
+	, m_thread()
+{
+	m_pending_records.reserve(k_log_ring_capacity);
+	m_thread = std::thread(&LogWriter::thread_func, this);
+}
+
+LogWriter::~LogWriter()
+{
+	m_exit_signaled = true;
+	m_thread.join();
+
+	// Anything queued after the logger thread's last pass
+	write_pending_records();
+
+	delete m_console_stream;
+	delete m_file_stream;
+}
+
+LogRing *LogWriter::register_ring()
+{
+	std::lock_guard<std::mutex> lock(m_ring_mutex);
+
+	// Reuse the ring of a thread that exited, any lines it left behind still get written
+	if (!m_free_rings.empty())
+	{
+		LogRing *ring = m_free_rings.back();
+
+		m_free_rings.pop_back();
+
+		return ring;
+	}
+
+	m_rings.push_back(std::unique_ptr<LogRing>(new LogRing));
+
+	return m_rings.back().get();
+}
+
+void LogWriter::release_ring(LogRing *ring)
+{
+	std::lock_guard<std::mutex> lock(m_ring_mutex);
+
+	m_free_rings.push_back(ring);
+}
+
+void LogWriter::thread_func()
+{
+	while (!m_exit_signaled)
+	{
+		if (!write_pending_records())
 		{
-			*g_console_stream << line << std::endl;
+			std::this_thread::sleep_for(std::chrono::milliseconds(k_log_writer_sleep_ms));
 		}
+	}
+}
 
-		if (g_file_stream != nullptr)
+static bool log_record_timestamp_less(const LogRecord &a, const LogRecord &b)
+{
+	return a.timestamp < b.timestamp;
+}
+
+bool LogWriter::write_pending_records()
+{
+	unsigned long long dropped_count = 0;
+
+	m_pending_records.clear();
+	{
+		std::lock_guard<std::mutex> lock(m_ring_mutex);
+
+		for (auto it = m_rings.begin(); it != m_rings.end(); ++it)
 		{
-			*g_file_stream << line << std::endl;
+			LogRing *ring = it->get();
+			LogRecord record;
+
+			while (ring->records.pop(record))
+			{
+				m_pending_records.push_back(record);
+			}
+
+			dropped_count += ring->dropped_count.exchange(0);
 		}
 	}
+
+	if (m_pending_records.empty() && dropped_count == 0)
+	{
+		return false;
+	}
+
+	// Interleave the lines of every thread in the order they were logged
+	std::stable_sort(m_pending_records.begin(), m_pending_records.end(), log_record_timestamp_less);
+
+	const std::chrono::system_clock::time_point write_time = std::chrono::system_clock::now();
+	std::ostream *streams[2] = { m_console_stream, m_file_stream };
+	for (int stream_index = 0; stream_index < 2; ++stream_index)
+	{
+		std::ostream *stream = streams[stream_index];
+
+		if (stream == nullptr)
+		{
+			continue;
+		}
+
+		for (auto it = m_pending_records.begin(); it != m_pending_records.end(); ++it)
+		{
+			log_write_record(*stream, *it);
+		}
+
+		if (dropped_count > 0)
+		{
+			log_write_timestamp_prefix(*stream, write_time);
+			*stream << "log_writer - Dropped " << dropped_count << " log lines (logging faster than they can be written)" << '\n';
+		}
+
+		stream->flush();
+	}
+
+	return true;
+}
+
+//-- private functions -----
+static void log_write_timestamp_prefix(std::ostream &out, const std::chrono::system_clock::time_point &timestamp)
+{
+    auto seconds = std::chrono::time_point_cast<std::chrono::seconds>(timestamp);
+    auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(timestamp - seconds);
+    time_t in_time_t = std::chrono::system_clock::to_time_t(timestamp);
+
+    out << "[" << std::put_time(std::localtime(&in_time_t), "%Y-%m-%d %H:%M:%S") << "." << milliseconds.count() << "]: ";
 }
 
-ThreadSafeLoggerStream::ThreadSafeLoggerStream(bool bEmit) :
-	LoggerStream(bEmit)
+static void log_write_payload(std::ostream &out, const unsigned char *payload, size_t payload_size, bool bManipulatorsOnly)
 {
+	size_t offset = 0;
+
+	while (offset < payload_size)
+	{
+		const e_log_argument_type type = static_cast<e_log_argument_type>(payload[offset]);
+		const unsigned char *data = &payload[offset + 1];
+
+		switch (type)
+		{
+		case _log_argument_bool:
+			{
+				if (!bManipulatorsOnly)
+				{
+					out << (data[0] != 0);
+				}
+				offset += 1 + sizeof(unsigned char);
+			} break;
+		case _log_argument_char:
+			{
+				if (!bManipulatorsOnly)
+				{
+					out << static_cast<char>(data[0]);
+				}
+				offset += 1 + sizeof(char);
+			} break;
+		case _log_argument_signed:
+			{
+				long long value;
+				memcpy(&value, data, sizeof(value));
+				if (!bManipulatorsOnly)
+				{
+					out << value;
+				}
+				offset += 1 + sizeof(value);
+			} break;
+		case _log_argument_unsigned:
+			{
+				unsigned long long value;
+				memcpy(&value, data, sizeof(value));
+				if (!bManipulatorsOnly)
+				{
+					out << value;
+				}
+				offset += 1 + sizeof(value);
+			} break;
+		case _log_argument_double:
+			{
+				double value;
+				memcpy(&value, data, sizeof(value));
+				if (!bManipulatorsOnly)
+				{
+					out << value;
+				}
+				offset += 1 + sizeof(value);
+			} break;
+		case _log_argument_string:
+			{
+				unsigned short length;
+				memcpy(&length, data, sizeof(length));
+				if (!bManipulatorsOnly)
+				{
+					out.write(reinterpret_cast<const char *>(data + sizeof(length)), length);
+				}
+				offset += 1 + sizeof(length) + length;
+			} break;
+		case _log_argument_manipulator:
+			{
+				t_ios_manipulator manipulator;
+				memcpy(&manipulator, data, sizeof(manipulator));
+				out << manipulator;
+				offset += 1 + sizeof(manipulator);
+			} break;
+		default:
+			// Corrupt record, nothing more can be decoded
+			offset = payload_size;
+			break;
+		}
+	}
 }
 
-void ThreadSafeLoggerStream::write_line()
+static void log_write_record(std::ostream &out, const LogRecord &record)
 {
-	std::lock_guard<std::mutex> lock(*g_logger_mutex);
+	log_write_timestamp_prefix(out, record.timestamp);
+
+	// Fresh stream so that format flags don't leak from one line into the next
+	std::ostringstream line;
+	log_write_payload(line, record.payload, record.payload_size, false);
+	if (record.bTruncated)
+	{
+		line << "...";
+	}
 
-	LoggerStream::write_line();
-}
\ No newline at end of file
+	out << line.str() << '\n';
+}
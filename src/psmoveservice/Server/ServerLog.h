@@ -2,8 +2,11 @@
 #define SERVER_LOG_H
 
 //-- includes -----
+#include <chrono>
+#include <memory>
 #include <string>
 #include <sstream>
+#include <type_traits>
 
 //-- constants -----
 enum e_log_severity_level
@@ -16,70 +19,140 @@ enum e_log_severity_level
     _log_severity_level_fatal
 };
 
-//-- includes -----
+// Size of the argument buffer of a single log line (arguments that don't fit are cut off)
+#define LOG_RECORD_PAYLOAD_SIZE 496
+
+//-- definitions -----
+/// A log line in its binary form.
+/// Arguments are stored as tagged values and only turned into text on the logger thread.
+struct LogRecord
+{
+	std::chrono::system_clock::time_point timestamp;
+	e_log_severity_level level;
+	unsigned short payload_size;
+	bool bTruncated;
+	unsigned char payload[LOG_RECORD_PAYLOAD_SIZE];
+};
+
+/// Builds one LogRecord from the arguments streamed into it and hands it to the logger thread when destroyed.
+/// Numbers, characters, strings and iostream format flags (std::hex, ...) are copied in binary form.
+/// Anything else (user types, std::setw, ...) gets formatted into text at the call site,
+/// along with every argument that follows it on the same line.
 class LoggerStream
 {
 protected:
-	std::ostringstream m_lineBuffer;
-	bool m_bEmitLine;
+	LogRecord m_record;
+	std::unique_ptr<std::ostringstream> m_textBuffer;
 
 public:
-	LoggerStream(bool bEmit);
-	virtual ~LoggerStream();
+	LoggerStream(e_log_severity_level level);
+	~LoggerStream();
+
+	LoggerStream &operator<<(bool x);
+	LoggerStream &operator<<(char x);
+	LoggerStream &operator<<(signed char x);
+	LoggerStream &operator<<(unsigned char x);
+	LoggerStream &operator<<(const char *x);
+	LoggerStream &operator<<(const std::string &x);
+	LoggerStream &operator<<(std::ios_base &(*manipulator)(std::ios_base &));
+
+	// integers and unscoped enums
+	template<class T>
+	typename std::enable_if<
+		std::is_integral<T>::value || (std::is_enum<T>::value && std::is_convertible<T, long long>::value),
+		LoggerStream &>::type
+	operator<<(const T &x)
+	{
+		if (m_textBuffer)
+		{
+			*m_textBuffer << x;
+		}
+		else if (std::is_signed<T>::value || std::is_enum<T>::value)
+		{
+			write_signed(static_cast<long long>(x));
+		}
+		else
+		{
+			write_unsigned(static_cast<unsigned long long>(x));
+		}
+
+		return *this;
+	}
 
-	// accepts just about anything
 	template<class T>
-	LoggerStream &operator<<(const T &x)
+	typename std::enable_if<std::is_floating_point<T>::value, LoggerStream &>::type
+	operator<<(const T &x)
 	{
-		if (m_bEmitLine)
+		if (m_textBuffer)
+		{
+			*m_textBuffer << x;
+		}
+		else
 		{
-			m_lineBuffer << x;
+			write_double(static_cast<double>(x));
 		}
 
 		return *this;
 	}
 
+	// accepts just about anything else
+	template<class T>
+	typename std::enable_if<
+		!std::is_integral<T>::value && !std::is_floating_point<T>::value &&
+		!(std::is_enum<T>::value && std::is_convertible<T, long long>::value),
+		LoggerStream &>::type
+	operator<<(const T &x)
+	{
+		get_text_buffer() << x;
+
+		return *this;
+	}
+
 protected:
-	virtual void write_line();
+	void write_signed(long long x);
+	void write_unsigned(unsigned long long x);
+	void write_double(double x);
+	std::ostringstream &get_text_buffer();
+	void write_line();
 };
 
-class ThreadSafeLoggerStream : public LoggerStream
+/// Turns the operator& expression built by the logger macros into a void one
+class LoggerStreamVoidify
 {
 public:
-	ThreadSafeLoggerStream(bool bEmit);
-
-protected:
-	void write_line() override;
+	void operator&(LoggerStream &) {}
 };
 
 //-- interface -----
+/// Starts the logger thread. Lines logged before this are dropped.
 void log_init(const std::string &log_level, const std::string &log_filename="");
+/// Writes out every pending line and stops the logger thread.
+/// Other threads must be done logging by the time this is called.
 void log_dispose();
 bool log_can_emit_level(e_log_severity_level level);
 std::string log_get_timestamp_prefix();
 
 //-- macros -----
-#define SELECT_LOG_STREAM(level) LoggerStream(log_can_emit_level(level))
-#define SELECT_MT_LOG_STREAM(level) ThreadSafeLoggerStream(log_can_emit_level(level))
-
-// Non Thread Safe Logger Macros
-// Almost everything is on the main thread, so you almost always want to use these
-#define SERVER_LOG_TRACE(function_name) SELECT_LOG_STREAM(_log_severity_level_trace) << log_get_timestamp_prefix() << function_name << " - "
-#define SERVER_LOG_DEBUG(function_name) SELECT_LOG_STREAM(_log_severity_level_debug) << log_get_timestamp_prefix() << function_name << " - "
-#define SERVER_LOG_INFO(function_name) SELECT_LOG_STREAM(_log_severity_level_info) << log_get_timestamp_prefix() << function_name << " - "
-#define SERVER_LOG_WARNING(function_name) SELECT_LOG_STREAM(_log_severity_level_warning) << log_get_timestamp_prefix() << function_name << " - "
-#define SERVER_LOG_ERROR(function_name) SELECT_LOG_STREAM(_log_severity_level_error) << log_get_timestamp_prefix() << function_name << " - "
-#define SERVER_LOG_FATAL(function_name) SELECT_LOG_STREAM(_log_severity_level_fatal) << log_get_timestamp_prefix() << function_name << " - "
-
-// Thread Safe Logger Macros
-// Uses thread safe locking before appending data to the logging stream
-// Only use this when logging from other threads
-#define SERVER_MT_LOG_TRACE(function_name) SELECT_MT_LOG_STREAM(_log_severity_level_trace) << log_get_timestamp_prefix() << function_name << " - "
-#define SERVER_MT_LOG_DEBUG(function_name) SELECT_MT_LOG_STREAM(_log_severity_level_debug) << log_get_timestamp_prefix() << function_name << " - "
-#define SERVER_MT_LOG_INFO(function_name) SELECT_MT_LOG_STREAM(_log_severity_level_info) << log_get_timestamp_prefix() << function_name << " - "
-#define SERVER_MT_LOG_WARNING(function_name) SELECT_MT_LOG_STREAM(_log_severity_level_warning) << log_get_timestamp_prefix() << function_name << " - "
-#define SERVER_MT_LOG_ERROR(function_name) SELECT_MT_LOG_STREAM(_log_severity_level_error) << log_get_timestamp_prefix() << function_name << " - "
-#define SERVER_MT_LOG_FATAL(function_name) SELECT_MT_LOG_STREAM(_log_severity_level_fatal) << log_get_timestamp_prefix() << function_name << " - "
- 
-#endif  // SERVER_LOG_H
+// The stream (and every argument streamed into it) is only evaluated when the level is enabled
+#define SELECT_LOG_STREAM(level) \
+	!log_can_emit_level(level) ? (void)0 : LoggerStreamVoidify() & LoggerStream(level)
+
+// Logger Macros
+// Every thread queues its lines in its own lock free ring buffer.
+// A background thread formats them and does the console/file writes, so these never block.
+#define SERVER_LOG_TRACE(function_name) SELECT_LOG_STREAM(_log_severity_level_trace) << function_name << " - "
+#define SERVER_LOG_DEBUG(function_name) SELECT_LOG_STREAM(_log_severity_level_debug) << function_name << " - "
+#define SERVER_LOG_INFO(function_name) SELECT_LOG_STREAM(_log_severity_level_info) << function_name << " - "
+#define SERVER_LOG_WARNING(function_name) SELECT_LOG_STREAM(_log_severity_level_warning) << function_name << " - "
+#define SERVER_LOG_ERROR(function_name) SELECT_LOG_STREAM(_log_severity_level_error) << function_name << " - "
+#define SERVER_LOG_FATAL(function_name) SELECT_LOG_STREAM(_log_severity_level_fatal) << function_name << " - "
 
+// Logging is safe from any thread now, these are kept for the existing call sites on the worker threads
+#define SERVER_MT_LOG_TRACE(function_name) SERVER_LOG_TRACE(function_name)
+#define SERVER_MT_LOG_DEBUG(function_name) SERVER_LOG_DEBUG(function_name)
+#define SERVER_MT_LOG_INFO(function_name) SERVER_LOG_INFO(function_name)
+#define SERVER_MT_LOG_WARNING(function_name) SERVER_LOG_WARNING(function_name)
+#define SERVER_MT_LOG_ERROR(function_name) SERVER_LOG_ERROR(function_name)
+#define SERVER_MT_LOG_FATAL(function_name) SERVER_LOG_FATAL(function_name)
+
+#endif  // SERVER_LOG_H
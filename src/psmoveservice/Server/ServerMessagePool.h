@@ -0,0 +1,157 @@
+#ifndef SERVER_MESSAGE_POOL_H
+#define SERVER_MESSAGE_POOL_H
+
+//-- includes -----
+#include <google/protobuf/arena.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+//-- definitions -----
+/// Allocation counters for a \ref ServerMessagePool.
+/// Every acquire that isn't counted as a reuse cost at least one heap allocation.
+struct ServerMessagePoolStats
+{
+    unsigned long long acquire_count;      // Total messages handed out
+    unsigned long long reuse_count;        // Acquires served by resetting an idle pooled arena
+    unsigned long long pool_alloc_count;   // Acquires that grew the pool by one arena
+    unsigned long long overflow_count;     // Acquires made while the pool was full (plain heap message)
+    unsigned long long arena_spill_count;  // Reuses where the arena had outgrown its initial block
+
+    inline void Clear()
+    {
+        acquire_count= 0;
+        reuse_count= 0;
+        pool_alloc_count= 0;
+        overflow_count= 0;
+        arena_spill_count= 0;
+    }
+
+    inline unsigned long long getHeapAllocationCount() const
+    {
+        return pool_alloc_count + overflow_count + arena_spill_count;
+    }
+};
+
+/// A fixed capacity pool of protobuf messages, each one living on its own protobuf arena.
+/// Messages handed out by acquireMessage() are shared_ptrs that alias the pool entry,
+/// so an entry becomes free again once every queue holding the message has let go of it.
+/// Reusing an entry resets its arena back onto a preallocated initial block,
+/// so steady state message construction (nested sub-messages included) never touches the heap.
+/// Messages must be acquired from a single thread, but may be released from any thread.
+template <class t_message_type>
+class ServerMessagePool
+{
+public:
+    typedef std::shared_ptr<t_message_type> t_message_ptr;
+
+    ServerMessagePool(size_t max_pooled_count, size_t arena_block_size)
+        : m_entries()
+        , m_max_pooled_count(max_pooled_count)
+        , m_arena_block_size(arena_block_size)
+        , m_next_index(0)
+    {
+        m_entries.reserve(max_pooled_count);
+        m_stats.Clear();
+    }
+
+    t_message_ptr acquireMessage()
+    {
+        const size_t entry_count= m_entries.size();
+
+        ++m_stats.acquire_count;
+
+        // Look for an entry that nobody outside the pool references any more.
+        // Start after the last handed out entry so that recently queued messages are probed last.
+        for (size_t probe = 0; probe < entry_count; ++probe)
+        {
+            const size_t index= (m_next_index + probe) % entry_count;
+            t_entry_ptr &entry= m_entries[index];
+
+            if (entry.use_count() == 1)
+            {
+                // The last outside reference may have been dropped on the network thread.
+                // Make sure everything it did with the message is visible before the arena gets reused.
+                std::atomic_thread_fence(std::memory_order_acquire);
+
+                if (entry->arena.SpaceAllocated() > m_arena_block_size)
+                {
+                    // The previous message needed more than the initial block
+                    ++m_stats.arena_spill_count;
+                }
+
+                entry->arena.Reset();
+                entry->message= google::protobuf::Arena::CreateMessage<t_message_type>(&entry->arena);
+
+                m_next_index= (index + 1) % entry_count;
+                ++m_stats.reuse_count;
+
+                return t_message_ptr(entry, entry->message);
+            }
+        }
+
+        if (entry_count < m_max_pooled_count)
+        {
+            t_entry_ptr entry(new Entry(m_arena_block_size));
+            entry->message= google::protobuf::Arena::CreateMessage<t_message_type>(&entry->arena);
+
+            m_entries.push_back(entry);
+            m_next_index= 0;
+            ++m_stats.pool_alloc_count;
+
+            return t_message_ptr(entry, entry->message);
+        }
+
+        // Every pooled message is still waiting in a send queue.
+        // Fall back to a regular heap allocated message rather than stall the publisher.
+        ++m_stats.overflow_count;
+
+        return t_message_ptr(new t_message_type);
+    }
+
+    inline const ServerMessagePoolStats &getStats() const
+    {
+        return m_stats;
+    }
+
+    inline size_t getPooledCount() const
+    {
+        return m_entries.size();
+    }
+
+private:
+    struct Entry
+    {
+        // Must be declared before the arena so it outlives it
+        std::vector<char> initial_block;
+        google::protobuf::Arena arena;
+        t_message_type *message;
+
+        Entry(size_t block_size)
+            : initial_block(block_size)
+            , arena(make_arena_options(initial_block))
+            , message(nullptr)
+        {
+        }
+
+        static google::protobuf::ArenaOptions make_arena_options(std::vector<char> &block)
+        {
+            google::protobuf::ArenaOptions options;
+
+            options.initial_block= block.data();
+            options.initial_block_size= block.size();
+
+            return options;
+        }
+    };
+    typedef std::shared_ptr<Entry> t_entry_ptr;
+
+    std::vector<t_entry_ptr> m_entries;
+    size_t m_max_pooled_count;
+    size_t m_arena_block_size;
+    size_t m_next_index;
+    ServerMessagePoolStats m_stats;
+};
+
+#endif // SERVER_MESSAGE_POOL_H
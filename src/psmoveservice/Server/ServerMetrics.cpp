@@ -0,0 +1,243 @@
+//-- includes -----
+#include "ServerMetrics.h"
+#include "SharedConstants.h"
+
+#include <atomic>
+
+//-- constants -----
+// Connections beyond this many at once don't get series of their own
+static const int k_max_metric_connection_count = 16;
+
+static const int k_max_metric_label_count =
+    (PSMOVESERVICE_MAX_TRACKER_COUNT > k_max_metric_connection_count)
+    ? PSMOVESERVICE_MAX_TRACKER_COUNT
+    : k_max_metric_connection_count;
+
+static_assert(PSMOVESERVICE_MAX_CONTROLLER_COUNT <= k_max_metric_label_count, "too few metric label slots");
+static_assert(PSMOVESERVICE_MAX_HMD_COUNT <= k_max_metric_label_count, "too few metric label slots");
+
+//-- definitions -----
+enum eMetricType
+{
+    MetricType_Counter,
+    MetricType_Gauge
+};
+
+enum eMetricLabel
+{
+    MetricLabel_None,
+    MetricLabel_Tracker,
+    MetricLabel_Controller,
+    MetricLabel_HMD,
+    MetricLabel_Connection
+};
+
+struct MetricDefinition
+{
+    const char *name;
+    const char *help;
+    eMetricType type;
+    eMetricLabel label;
+};
+
+static const MetricDefinition k_metric_definitions[ServerMetric_COUNT] = {
+    {"psmoveservice_tracker_frames_grabbed_total", "Video frames read from the tracker", MetricType_Counter, MetricLabel_Tracker},
+    {"psmoveservice_tracker_frames_dropped_total", "Frames the tracker should have delivered at its frame rate but didn't", MetricType_Counter, MetricLabel_Tracker},
+    {"psmoveservice_tracker_video_stream_frames_dropped_total", "Frames skipped by the shared memory video stream because every slot was leased", MetricType_Counter, MetricLabel_Tracker},
+    {"psmoveservice_controller_input_reports_total", "Input reports read from the controller", MetricType_Counter, MetricLabel_Controller},
+    {"psmoveservice_controller_filter_resets_total", "Pose filter rebuilds and state resets of the controller", MetricType_Counter, MetricLabel_Controller},
+    {"psmoveservice_hmd_filter_resets_total", "Pose filter rebuilds and state resets of the HMD", MetricType_Counter, MetricLabel_HMD},
+    {"psmoveservice_hid_read_errors_total", "Failed hid_read calls on any device", MetricType_Counter, MetricLabel_None},
+    {"psmoveservice_usb_request_queue_depth", "Transfer requests waiting for the USB thread", MetricType_Gauge, MetricLabel_None},
+    {"psmoveservice_usb_result_queue_depth", "Transfer results waiting for the device thread", MetricType_Gauge, MetricLabel_None},
+    {"psmoveservice_connection_data_frames_sent_total", "Data frames written to the client's datagram socket", MetricType_Counter, MetricLabel_Connection},
+    {"psmoveservice_connection_data_frames_dropped_total", "Data frames for the client dropped because the outbound queue was full", MetricType_Counter, MetricLabel_Connection},
+    {"psmoveservice_connection_data_frame_queue_depth", "Data frames waiting to be written to the client", MetricType_Gauge, MetricLabel_Connection},
+};
+
+static const char *k_metric_label_names[] = {
+    "",             // MetricLabel_None
+    "tracker",      // MetricLabel_Tracker
+    "controller",   // MetricLabel_Controller
+    "hmd",          // MetricLabel_HMD
+    "connection",   // MetricLabel_Connection
+};
+
+//-- globals -----
+// Unlabeled metrics only use the first slot
+static std::atomic<long long> g_metric_values[ServerMetric_COUNT][k_max_metric_label_count];
+
+// Set once a labeled series gets recorded to, only those are exported
+static std::atomic_bool g_metric_series_used[ServerMetric_COUNT][k_max_metric_label_count];
+
+// One past the id of the connection holding each connection slot, zero while the slot is free
+static std::atomic<int> g_connection_slot_ids_plus_one[k_max_metric_connection_count];
+
+//-- private functions -----
+static int get_device_label_count(eMetricLabel label)
+{
+    switch (label)
+    {
+    case MetricLabel_Tracker:
+        return PSMOVESERVICE_MAX_TRACKER_COUNT;
+    case MetricLabel_Controller:
+        return PSMOVESERVICE_MAX_CONTROLLER_COUNT;
+    case MetricLabel_HMD:
+        return PSMOVESERVICE_MAX_HMD_COUNT;
+    default:
+        return 0;
+    }
+}
+
+static int find_connection_slot(int connection_id)
+{
+    for (int slot_index = 0; slot_index < k_max_metric_connection_count; ++slot_index)
+    {
+        if (g_connection_slot_ids_plus_one[slot_index].load(std::memory_order_relaxed) == connection_id + 1)
+        {
+            return slot_index;
+        }
+    }
+
+    return -1;
+}
+
+// Slot of the series a recording goes to, or -1 when it doesn't have one
+static int find_series_slot(eServerMetric metric, int label_id)
+{
+    const eMetricLabel label = k_metric_definitions[metric].label;
+
+    if (label == MetricLabel_None)
+    {
+        return 0;
+    }
+    else if (label == MetricLabel_Connection)
+    {
+        return find_connection_slot(label_id);
+    }
+    else
+    {
+        return (label_id >= 0 && label_id < get_device_label_count(label)) ? label_id : -1;
+    }
+}
+
+static void write_series(std::ostream &out, eServerMetric metric, int slot_index, int label_id)
+{
+    const MetricDefinition &definition = k_metric_definitions[metric];
+
+    out << definition.name;
+    if (definition.label != MetricLabel_None)
+    {
+        out << "{" << k_metric_label_names[definition.label] << "=\"" << label_id << "\"}";
+    }
+    out << " " << g_metric_values[metric][slot_index].load(std::memory_order_relaxed) << "\n";
+}
+
+//-- public interface -----
+namespace ServerMetrics
+{
+    void increment_counter(eServerMetric metric, int label_id, long long amount)
+    {
+        const int slot_index = find_series_slot(metric, label_id);
+
+        if (slot_index != -1)
+        {
+            g_metric_values[metric][slot_index].fetch_add(amount, std::memory_order_relaxed);
+            g_metric_series_used[metric][slot_index].store(true, std::memory_order_relaxed);
+        }
+    }
+
+    void set_gauge(eServerMetric metric, int label_id, long long value)
+    {
+        const int slot_index = find_series_slot(metric, label_id);
+
+        if (slot_index != -1)
+        {
+            g_metric_values[metric][slot_index].store(value, std::memory_order_relaxed);
+            g_metric_series_used[metric][slot_index].store(true, std::memory_order_relaxed);
+        }
+    }
+
+    void add_connection(int connection_id)
+    {
+        for (int slot_index = 0; slot_index < k_max_metric_connection_count; ++slot_index)
+        {
+            int free_slot_id = 0;
+
+            if (g_connection_slot_ids_plus_one[slot_index].compare_exchange_strong(free_slot_id, connection_id + 1))
+            {
+                // Start the new series from zero and export them right away.
+                // Zeroed only now that the slot is ours: the device thread may still have been
+                // counting for the previous holder while it was being removed.
+                for (int metric_index = 0; metric_index < ServerMetric_COUNT; ++metric_index)
+                {
+                    if (k_metric_definitions[metric_index].label == MetricLabel_Connection)
+                    {
+                        g_metric_values[metric_index][slot_index].store(0, std::memory_order_relaxed);
+                        g_metric_series_used[metric_index][slot_index].store(true, std::memory_order_relaxed);
+                    }
+                }
+
+                break;
+            }
+        }
+    }
+
+    void remove_connection(int connection_id)
+    {
+        const int slot_index = find_connection_slot(connection_id);
+
+        if (slot_index != -1)
+        {
+            // Only stop exporting the series, the next holder of the slot zeroes the values
+            for (int metric_index = 0; metric_index < ServerMetric_COUNT; ++metric_index)
+            {
+                if (k_metric_definitions[metric_index].label == MetricLabel_Connection)
+                {
+                    g_metric_series_used[metric_index][slot_index].store(false, std::memory_order_relaxed);
+                }
+            }
+
+            g_connection_slot_ids_plus_one[slot_index].store(0);
+        }
+    }
+
+    void write_prometheus_text(std::ostream &out)
+    {
+        for (int metric_index = 0; metric_index < ServerMetric_COUNT; ++metric_index)
+        {
+            const eServerMetric metric = static_cast<eServerMetric>(metric_index);
+            const MetricDefinition &definition = k_metric_definitions[metric_index];
+
+            out << "# HELP " << definition.name << " " << definition.help << "\n";
+            out << "# TYPE " << definition.name << " " << (definition.type == MetricType_Counter ? "counter" : "gauge") << "\n";
+
+            if (definition.label == MetricLabel_None)
+            {
+                write_series(out, metric, 0, -1);
+            }
+            else if (definition.label == MetricLabel_Connection)
+            {
+                for (int slot_index = 0; slot_index < k_max_metric_connection_count; ++slot_index)
+                {
+                    const int connection_id_plus_one = g_connection_slot_ids_plus_one[slot_index].load();
+
+                    if (connection_id_plus_one != 0 && g_metric_series_used[metric_index][slot_index].load(std::memory_order_relaxed))
+                    {
+                        write_series(out, metric, slot_index, connection_id_plus_one - 1);
+                    }
+                }
+            }
+            else
+            {
+                for (int slot_index = 0; slot_index < get_device_label_count(definition.label); ++slot_index)
+                {
+                    if (g_metric_series_used[metric_index][slot_index].load(std::memory_order_relaxed))
+                    {
+                        write_series(out, metric, slot_index, slot_index);
+                    }
+                }
+            }
+        }
+    }
+};
@@ -0,0 +1,51 @@
+#ifndef SERVER_METRICS_H
+#define SERVER_METRICS_H
+
+//-- includes -----
+#include <ostream>
+
+//-- constants -----
+/// Counters and gauges the service keeps for its metrics endpoint.
+/// The label of a metric (tracker, controller, hmd or connection id) is fixed per metric, see ServerMetrics.cpp.
+enum eServerMetric
+{
+    ServerMetric_TrackerFramesGrabbed= 0,           // Video frames read from a tracker
+    ServerMetric_TrackerFramesDropped,              // Frames a tracker should have delivered at its frame rate but didn't
+    ServerMetric_TrackerVideoStreamFramesDropped,   // Frames not copied to the shared memory video stream since every slot was leased
+    ServerMetric_ControllerInputReports,            // Input reports read from a controller
+    ServerMetric_ControllerFilterResets,            // Pose filter rebuilds or state resets of a controller
+    ServerMetric_HMDFilterResets,                   // Pose filter rebuilds or state resets of an HMD
+    ServerMetric_HidReadErrors,                     // Failed hid_read calls on any device
+    ServerMetric_USBRequestQueueDepth,              // Transfer requests waiting for the USB thread
+    ServerMetric_USBResultQueueDepth,               // Transfer results waiting for the device thread
+    ServerMetric_ConnectionDataFramesSent,          // Data frames written to a client's UDP or local datagram socket
+    ServerMetric_ConnectionDataFramesDropped,       // Data frames for a client thrown away because the outbound queue was full
+    ServerMetric_ConnectionDataFrameQueueDepth,     // Data frames waiting to be written to a client
+
+    ServerMetric_COUNT
+};
+
+//-- interface -----
+/// Always on registry of cheap atomic counters and gauges, exported in the Prometheus text format.
+/// Any thread can record into it, recording never allocates or locks.
+namespace ServerMetrics
+{
+    /// Adds to a counter.
+    /// label_id is the tracker, controller, hmd or connection id of labeled metrics and is ignored otherwise.
+    /// Ids outside of the device lists and connections without a series are silently skipped.
+    void increment_counter(eServerMetric metric, int label_id, long long amount= 1);
+
+    /// Sets a gauge to its current value (label_id as in increment_counter)
+    void set_gauge(eServerMetric metric, int label_id, long long value);
+
+    /// Gives a client connection its own series, called as the connection starts
+    void add_connection(int connection_id);
+
+    /// Drops the series of a connection, called once the connection stopped
+    void remove_connection(int connection_id);
+
+    /// Writes every unlabeled metric and every labeled series that has been recorded to
+    void write_prometheus_text(std::ostream &out);
+};
+
+#endif // SERVER_METRICS_H
@@ -2,13 +2,22 @@
 #include "ServerNetworkManager.h"
 #include "ServerRequestHandler.h"
 #include "ServerLog.h"
+#include "ServerMetrics.h"
+#include "ServerScope.h"
+#include "ServerUtility.h"
 #include "PackedMessage.h"
 #include "PSMoveProtocolInterface.h"
 #include "PSMoveProtocol.pb.h"
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <sstream>
+#include <thread>
 #include <vector>
 #include <deque>
 #include <boost/asio.hpp>
@@ -16,31 +25,90 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/cstdint.hpp>
 #include <boost/enable_shared_from_this.hpp>
+#include <boost/lockfree/spsc_queue.hpp>
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+#include <unistd.h> // unlink
+#endif
 
 //-- pre-declarations -----
 using namespace std;
 namespace asio = boost::asio;
 using asio::ip::tcp;
 using asio::ip::udp;
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+typedef asio::local::stream_protocol local_stream;
+typedef asio::local::datagram_protocol local_datagram;
+#endif
 using boost::uint8_t;
 
 class ClientConnection;
 typedef boost::shared_ptr<ClientConnection> ClientConnectionPtr;
 
+class MetricsConnection;
+typedef boost::shared_ptr<MetricsConnection> MetricsConnectionPtr;
+
 typedef map<int, ClientConnectionPtr> t_client_connection_map;
 typedef map<int, ClientConnectionPtr>::iterator t_client_connection_map_iter;
 typedef std::pair<int, ClientConnectionPtr> t_id_client_connection_pair;
 
 //-- constants -----
 const int PSMOVE_SERVER_PORT = 9512;
+const int PSMOVE_METRICS_PORT = 9513;
+
+// Largest metrics scrape request read before giving up on the client
+const size_t k_max_metrics_request_size = 4096;
+
+// A metrics scrape that hasn't been answered by then gets its connection closed
+const int k_metrics_connection_timeout_ms = 5000;
+
+// Scrapes accepted past this many open metrics connections are closed right away
+const int k_max_metrics_connection_count = 4;
+
+// Cached query responses older than this get re-evaluated on the device thread
+// even if no state change was observed (catches device changes that don't send a notification)
+const int k_max_query_cache_age_ms = 1000;
 
 //-- private implementation -----
 class IServerNetworkEventListener
 {
 public:
+	virtual void handle_client_request(ClientConnection *connection, RequestPtr request) = 0;
+	virtual void handle_client_data_frame_sent() = 0;
 	virtual void handle_client_connection_stopped(int connection_id) = 0;
 };
 
+// Work handed from the network thread to the device thread
+struct NetworkToDeviceCommand
+{
+    enum eCommandType
+    {
+        _Request,
+        _InputDataFrame,
+        _ConnectionStopped
+    };
+
+    eCommandType command_type;
+    int connection_id;
+    RequestPtr request;
+    DeviceInputDataFramePtr input_data_frame;
+};
+
+// A data frame published on the device thread waiting to be handed to its connection on the network thread
+struct OutboundDataFrame
+{
+    int connection_id;
+    DeviceOutputDataFramePtr data_frame;
+};
+
+// The last response generated for a read-only query
+struct CachedQueryResponse
+{
+    unsigned int device_state_generation;
+    std::chrono::time_point<std::chrono::high_resolution_clock> timestamp;
+    ResponsePtr response;
+};
+
 //-- Network Manager Config -----
 const int NetworkManagerConfig::CONFIG_VERSION = 1;
 
@@ -48,6 +116,13 @@ NetworkManagerConfig::NetworkManagerConfig(const std::string &fnamebase)
     : PSMoveConfig(fnamebase)
 {
 	server_port= PSMOVE_SERVER_PORT;
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+	local_sockets_enabled= true;
+#else
+	local_sockets_enabled= false;
+#endif
+	metrics_port= PSMOVE_METRICS_PORT;
+	metrics_address= "127.0.0.1";
 };
 
 const boost::property_tree::ptree
@@ -57,6 +132,9 @@ NetworkManagerConfig::config2ptree()
 
     pt.put("version", NetworkManagerConfig::CONFIG_VERSION);
 	pt.put("server_port", server_port);
+	pt.put("local_sockets_enabled", local_sockets_enabled);
+	pt.put("metrics_port", metrics_port);
+	pt.put("metrics_address", metrics_address);
 
     return pt;
 }
@@ -69,6 +147,9 @@ NetworkManagerConfig::ptree2config(const boost::property_tree::ptree &pt)
     if (version == NetworkManagerConfig::CONFIG_VERSION)
     {
 		server_port = pt.get<int>("server_port", server_port);
+		local_sockets_enabled = pt.get<bool>("local_sockets_enabled", local_sockets_enabled);
+		metrics_port = pt.get<int>("metrics_port", metrics_port);
+		metrics_address = pt.get<std::string>("metrics_address", metrics_address);
     }
     else
     {
@@ -81,6 +162,8 @@ NetworkManagerConfig::ptree2config(const boost::property_tree::ptree &pt)
 // -ClientConnection-
 /**
  * Maintains TCP and UDP connection state to a single client.
+ * Local clients may instead be connected over a unix domain stream socket,
+ * with data frames sent over the shared unix domain datagram socket.
  * Handles async socket callbacks on the connection.
  * Routes requests through the request handler
  */
@@ -99,17 +182,35 @@ public:
     static ClientConnectionPtr create(
         IServerNetworkEventListener* network_event_listener,
         asio::io_service& io_service_ref,
-        udp::socket& udp_socket_ref, 
-        ServerRequestHandler &request_handler_ref)
+        udp::socket& udp_socket_ref)
     {
         return ClientConnectionPtr(
             new ClientConnection(
                 network_event_listener, 
                 io_service_ref, 
-                udp_socket_ref, 
-                request_handler_ref));
+                udp_socket_ref));
     }
 
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    static ClientConnectionPtr create_local(
+        IServerNetworkEventListener* network_event_listener,
+        asio::io_service& io_service_ref,
+        udp::socket& udp_socket_ref,
+        local_datagram::socket& local_datagram_socket_ref)
+    {
+        ClientConnectionPtr connection(
+            new ClientConnection(
+                network_event_listener, 
+                io_service_ref, 
+                udp_socket_ref));
+
+        connection->m_local_datagram_socket_ptr= &local_datagram_socket_ref;
+        connection->m_is_local_connection= true;
+
+        return connection;
+    }
+#endif
+
     int get_connection_id() const
     {
         return m_connection_id;
@@ -120,6 +221,18 @@ public:
         return m_tcp_socket;
     }
 
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    local_stream::socket& get_local_stream_socket()
+    {
+        return m_local_stream_socket;
+    }
+#endif
+
+    bool is_local_connection() const
+    {
+        return m_is_local_connection;
+    }
+
     void start()
     {
         SERVER_LOG_INFO("ClientConnection::start") << "Starting client connection id " << m_connection_id;
@@ -127,6 +240,8 @@ public:
         m_connection_started= true;
         m_connection_stopped= false;
 
+        ServerMetrics::add_connection(m_connection_id);
+
         // Send the connection ID to the client 
         // so that it can send it back to us to establish a UDP connection
         send_connection_info();
@@ -157,11 +272,27 @@ public:
                     SERVER_LOG_ERROR("ClientConnection::stop") << "Unable to close the tcp socket: " << error.value();
                 }
             }
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+            if (m_local_stream_socket.is_open())
+            {
+                boost::system::error_code error;
+                
+                m_local_stream_socket.shutdown(asio::socket_base::shutdown_both, error);
+                m_local_stream_socket.close(error);
+                if (error)
+                {
+                    SERVER_LOG_ERROR("ClientConnection::stop") << "Unable to close the local stream socket: " << error.value();
+                }
+            }
+#endif
             
             m_connection_stopped= true;
             m_has_pending_tcp_write= false;
             m_has_pending_udp_write= false;
 
+            ServerMetrics::remove_connection(m_connection_id);
+
             // Notify the parent network manager that this connection is going away
             m_network_event_listener->handle_client_connection_stopped(m_connection_id);
         }
@@ -182,6 +313,17 @@ public:
         m_is_udp_remote_endpoint_bound = true;
     }
 
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    void bind_local_remote_endpoint(const local_datagram::endpoint &connecting_remote_endpoint)
+    {
+        SERVER_LOG_DEBUG("ClientConnection::bind_local_remote_endpoint") << "Binding connection_id " 
+            << m_connection_id << " to local datagram endpoint " << connecting_remote_endpoint.path();
+
+        m_local_remote_endpoint= connecting_remote_endpoint;
+        m_is_udp_remote_endpoint_bound = true;
+    }
+#endif
+
     bool is_udp_remote_endpoint_bound() const
     {
         return m_is_udp_remote_endpoint_bound;
@@ -192,14 +334,21 @@ public:
         return m_connection_started && !m_connection_stopped;
     }
 
-    bool has_pending_udp_write() const
+    // Requests from this client that are still waiting on the device thread for a response
+    int get_pending_device_request_count() const
+    {
+        return m_pending_device_request_count;
+    }
+
+    void add_pending_device_request()
     {
-        return m_connection_started && m_has_pending_udp_write;
+        ++m_pending_device_request_count;
     }
 
-    bool has_queued_controller_data_frames() const
+    void remove_pending_device_request()
     {
-        return m_connection_started && m_pending_dataframes.size() > 0;
+        assert(m_pending_device_request_count > 0);
+        --m_pending_device_request_count;
     }
 
     void add_tcp_response_to_write_queue(ResponsePtr response)
@@ -217,6 +366,7 @@ public:
             {
                 if (m_pending_responses.size() > 0)
                 {
+                    SERVER_TRACE_SCOPE_ID("ClientConnection::start_tcp_write_queued_response", m_connection_id);
                     ResponsePtr response= m_pending_responses.front();
 
                     m_packed_response.set_msg(response);
@@ -233,8 +383,7 @@ public:
 
                     // Start an asynchronous operation to send a heartbeat message.
                     // NOTE: Even if the write completes immediate, the callback will only be called from io_service::poll()
-                    boost::asio::async_write(
-                        m_tcp_socket, 
+                    async_write_stream(
                         boost::asio::buffer(m_response_write_buffer),
                         boost::bind(&ClientConnection::handle_write_response_complete, this, _1));
                 }
@@ -251,6 +400,9 @@ public:
     void add_device_data_frame_to_write_queue(DeviceOutputDataFramePtr data_frame)
     {
         m_pending_dataframes.push_back(data_frame);
+
+        ServerMetrics::set_gauge(
+            ServerMetric_ConnectionDataFrameQueueDepth, m_connection_id, static_cast<long long>(m_pending_dataframes.size()));
     }
 
     bool start_udp_write_queued_device_data_frame()
@@ -263,8 +415,14 @@ public:
             {
                 if (m_pending_dataframes.size() > 0)
                 {
+                    SERVER_TRACE_SCOPE_ID("ClientConnection::start_udp_write_queued_device_data_frame", m_connection_id);
                     DeviceOutputDataFramePtr dataframe= m_pending_dataframes.front();
 
+                    // Last stop on the service for the data frame's latency timestamps
+                    dataframe->mutable_latency_timestamps()->set_network_send_usec(
+                        std::chrono::duration_cast<std::chrono::microseconds>(
+                            std::chrono::steady_clock::now().time_since_epoch()).count());
+
                     m_packed_output_dataframe.set_msg(dataframe);
                     if (m_packed_output_dataframe.pack(m_output_dataframe_buffer, sizeof(m_output_dataframe_buffer)))
                     {
@@ -281,9 +439,8 @@ public:
 
                         // Start an asynchronous operation to send the data frame
                         // NOTE: Even if the write completes immediate, the callback will only be called from io_service::poll()
-                        m_udp_socket_ref.async_send_to(
-                            boost::asio::buffer(m_output_dataframe_buffer, sizeof(m_output_dataframe_buffer)),
-                            m_udp_remote_endpoint,
+                        async_send_datagram(
+                            boost::asio::buffer(m_output_dataframe_buffer, HEADER_SIZE+msg_size),
                             boost::bind(&ClientConnection::handle_udp_write_device_data_frame_complete, this, _1));
                     }
                     else
@@ -309,12 +466,19 @@ private:
 
     int m_connection_id;
 
-    ServerRequestHandler &m_request_handler_ref;
     tcp::socket m_tcp_socket;
     udp::socket &m_udp_socket_ref;
     udp::endpoint m_udp_remote_endpoint;
     bool m_is_udp_remote_endpoint_bound;
 
+    // Local (unix domain socket) connections use these instead of the tcp/udp sockets
+    bool m_is_local_connection;
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    local_stream::socket m_local_stream_socket;
+    local_datagram::socket *m_local_datagram_socket_ptr;
+    local_datagram::endpoint m_local_remote_endpoint;
+#endif
+
     vector<uint8_t> m_request_read_buffer;
     PackedMessage<PSMoveProtocol::Request> m_packed_request;
 
@@ -331,19 +495,24 @@ private:
     bool m_connection_stopped;
     bool m_has_pending_tcp_write;
     bool m_has_pending_udp_write;
+    int m_pending_device_request_count;
 
     ClientConnection(
         IServerNetworkEventListener *network_event_listener,
         asio::io_service& io_service_ref,
-        udp::socket& udp_socket_ref , 
-        ServerRequestHandler &request_handler_ref)
+        udp::socket& udp_socket_ref)
         : m_network_event_listener(network_event_listener)
         , m_connection_id(next_connection_id)
-        , m_request_handler_ref(request_handler_ref)
         , m_tcp_socket(io_service_ref)
         , m_udp_socket_ref(udp_socket_ref)
         , m_udp_remote_endpoint()
         , m_is_udp_remote_endpoint_bound(false)
+        , m_is_local_connection(false)
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+        , m_local_stream_socket(io_service_ref)
+        , m_local_datagram_socket_ptr(nullptr)
+        , m_local_remote_endpoint()
+#endif
         , m_request_read_buffer()
         , m_packed_request(std::shared_ptr<PSMoveProtocol::Request>(new PSMoveProtocol::Request()))
         , m_response_write_buffer()
@@ -355,11 +524,53 @@ private:
         , m_connection_stopped(false)
         , m_has_pending_tcp_write(false)
         , m_has_pending_udp_write(false)
+        , m_pending_device_request_count(0)
     {
         memset(m_output_dataframe_buffer, 0, sizeof(m_output_dataframe_buffer));
         next_connection_id++;
     }
 
+    // The stream and datagram socket calls go through these so that the rest of the 
+    // connection doesn't care whether the client is connected over tcp/udp or unix domain sockets
+    template <typename t_buffer, typename t_handler>
+    void async_read_stream(const t_buffer &buffer, t_handler handler)
+    {
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+        if (m_is_local_connection)
+        {
+            asio::async_read(m_local_stream_socket, buffer, handler);
+            return;
+        }
+#endif
+        asio::async_read(m_tcp_socket, buffer, handler);
+    }
+
+    template <typename t_buffer, typename t_handler>
+    void async_write_stream(const t_buffer &buffer, t_handler handler)
+    {
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+        if (m_is_local_connection)
+        {
+            asio::async_write(m_local_stream_socket, buffer, handler);
+            return;
+        }
+#endif
+        asio::async_write(m_tcp_socket, buffer, handler);
+    }
+
+    template <typename t_buffer, typename t_handler>
+    void async_send_datagram(const t_buffer &buffer, t_handler handler)
+    {
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+        if (m_is_local_connection)
+        {
+            m_local_datagram_socket_ptr->async_send_to(buffer, m_local_remote_endpoint, handler);
+            return;
+        }
+#endif
+        m_udp_socket_ref.async_send_to(buffer, m_udp_remote_endpoint, handler);
+    }
+
     void send_connection_info()
     {
         SERVER_LOG_INFO("ClientConnection::send_connection_info") 
@@ -382,8 +593,7 @@ private:
             << "Start TCP header read on connection id to client " << m_connection_id;
 
         m_request_read_buffer.resize(HEADER_SIZE);
-        asio::async_read(
-            m_tcp_socket, 
+        async_read_stream(
             asio::buffer(m_request_read_buffer),
             boost::bind(
                 &ClientConnection::handle_tcp_read_request_header, 
@@ -432,8 +642,8 @@ private:
         //
         m_request_read_buffer.resize(HEADER_SIZE + msg_len);
         asio::mutable_buffers_1 buf = asio::buffer(&m_request_read_buffer[HEADER_SIZE], msg_len);
-        asio::async_read(
-            m_tcp_socket, buf,
+        async_read_stream(
+            buf,
             boost::bind(
                 &ClientConnection::handle_tcp_read_request_body, 
                 shared_from_this(),
@@ -461,7 +671,8 @@ private:
 
     // Called when enough data was read into m_readbuf for a complete request
     // message. 
-    // Parse the request, execute it and send back a response.
+    // Parse the request and hand it to the network manager to execute.
+    // The response is queued up once the request has been handled.
     //
     void handle_tcp_request()
     {
@@ -473,11 +684,9 @@ private:
                 << "Handle request type " << request->request_id() 
                 << " on connection id to client " << m_connection_id;
 
-            ResponsePtr response = m_request_handler_ref.handle_request(m_connection_id, request);            
-            if (response)
-            {
-                add_tcp_response_to_write_queue(response);
-            }
+            // The packed request gets reused by the next read,
+            // so the request handed off to the device thread needs its own copy
+            m_network_event_listener->handle_client_request(this, RequestPtr(new PSMoveProtocol::Request(*request)));
 
             start_tcp_write_queued_response();
         }
@@ -503,7 +712,9 @@ private:
             m_has_pending_tcp_write= false;
 
             // Remove the response from the pending send queue now that it's sent
+            // (drop the packer's reference too so a pooled message can be recycled)
             m_pending_responses.pop_front();
+            m_packed_response.set_msg(ResponsePtr());
 
             // If there are more requests waiting to be sent, start sending the next one
             start_tcp_write_queued_response();
@@ -530,7 +741,16 @@ private:
             m_has_pending_udp_write= false;
 
             // Remove the dataframe from the pending send queue now that it's sent
+            // (drop the packer's reference too so a pooled message can be recycled)
             m_pending_dataframes.pop_front();
+            m_packed_output_dataframe.set_msg(DeviceOutputDataFramePtr());
+
+            ServerMetrics::increment_counter(ServerMetric_ConnectionDataFramesSent, m_connection_id);
+            ServerMetrics::set_gauge(
+                ServerMetric_ConnectionDataFrameQueueDepth, m_connection_id, static_cast<long long>(m_pending_dataframes.size()));
+
+            // The shared UDP socket is free again, start the next queued write (on any connection)
+            m_network_event_listener->handle_client_data_frame_sent();
         }
         else
         {
@@ -543,8 +763,148 @@ private:
 };
 int ClientConnection::next_connection_id = 0;
 
+// -MetricsConnection-
+/**
+ * Answers a single HTTP scrape of the metrics endpoint and then closes.
+ * There is only the one document to serve, so the request is only checked for being a GET.
+ * The whole scrape has k_metrics_connection_timeout_ms to finish, so a client that never sends
+ * its request can't hold the socket open.
+ */
+class MetricsConnection : public boost::enable_shared_from_this<MetricsConnection>
+{
+public:
+    static MetricsConnectionPtr create(asio::io_service& io_service_ref)
+    {
+        return MetricsConnectionPtr(new MetricsConnection(io_service_ref));
+    }
+
+    virtual ~MetricsConnection()
+    {
+        --open_connection_count;
+    }
+
+    /// Metrics connections that haven't been destroyed yet, including the one waiting on the next accept
+    static int get_open_connection_count()
+    {
+        return open_connection_count;
+    }
+
+    tcp::socket& get_socket()
+    {
+        return m_socket;
+    }
+
+    void start()
+    {
+        m_deadline_timer.expires_from_now(boost::posix_time::milliseconds(k_metrics_connection_timeout_ms));
+        m_deadline_timer.async_wait(
+            boost::bind(&MetricsConnection::handle_deadline, shared_from_this(), asio::placeholders::error));
+
+        asio::async_read_until(
+            m_socket, m_request_buffer, "\r\n\r\n",
+            boost::bind(&MetricsConnection::handle_read_request, shared_from_this(), asio::placeholders::error));
+    }
+
+    void close()
+    {
+        boost::system::error_code error;
+
+        m_deadline_timer.cancel(error);
+        m_socket.shutdown(asio::socket_base::shutdown_both, error);
+        m_socket.close(error);
+    }
+
+private:
+    // Connections are created and destroyed on the network thread, but the last ones can go away during shutdown
+    static std::atomic<int> open_connection_count;
+
+    tcp::socket m_socket;
+    asio::deadline_timer m_deadline_timer;
+    asio::streambuf m_request_buffer;
+    std::string m_response;
+
+    MetricsConnection(asio::io_service& io_service_ref)
+        : m_socket(io_service_ref)
+        , m_deadline_timer(io_service_ref)
+        , m_request_buffer(k_max_metrics_request_size)
+        , m_response()
+    {
+        ++open_connection_count;
+    }
+
+    void handle_deadline(const boost::system::error_code& error)
+    {
+        // Aborted when the scrape finished in time
+        if (error != asio::error::operation_aborted)
+        {
+            SERVER_LOG_DEBUG("MetricsConnection::handle_deadline") << "Metrics scrape timed out";
+            close();
+        }
+    }
+
+    void handle_read_request(const boost::system::error_code& error)
+    {
+        // Also fails once a request outgrows k_max_metrics_request_size
+        if (error)
+        {
+            SERVER_LOG_DEBUG("MetricsConnection::handle_read_request") << "Failed to read metrics request: " << error.message();
+            close();
+            return;
+        }
+
+        std::istream request_stream(&m_request_buffer);
+        std::string method;
+        request_stream >> method;
+
+        std::ostringstream response_stream;
+        if (method == "GET")
+        {
+            std::ostringstream body_stream;
+            ServerMetrics::write_prometheus_text(body_stream);
+
+            const std::string body= body_stream.str();
+            response_stream 
+                << "HTTP/1.0 200 OK\r\n"
+                << "Content-Type: text/plain; version=0.0.4\r\n"
+                << "Content-Length: " << body.size() << "\r\n"
+                << "Connection: close\r\n\r\n"
+                << body;
+        }
+        else
+        {
+            response_stream 
+                << "HTTP/1.0 405 Method Not Allowed\r\n"
+                << "Content-Length: 0\r\n"
+                << "Connection: close\r\n\r\n";
+        }
+        m_response= response_stream.str();
+
+        asio::async_write(
+            m_socket, asio::buffer(m_response),
+            boost::bind(&MetricsConnection::handle_write_response, shared_from_this(), asio::placeholders::error));
+    }
+
+    void handle_write_response(const boost::system::error_code& error)
+    {
+        if (error)
+        {
+            SERVER_LOG_DEBUG("MetricsConnection::handle_write_response") << "Failed to write metrics response: " << error.message();
+        }
+
+        close();
+    }
+};
+std::atomic<int> MetricsConnection::open_connection_count(0);
+
 // -NetworkManagerImpl-
 /// Internal implementation of the network manager.
+/// All socket i/o runs on a dedicated network thread driving the io_service.
+/// Requests are queued over to the device thread (the thread calling poll()) where
+/// the request handler runs, so slow requests never block socket i/o and vice versa.
+/// Read-only queries are answered directly on the network thread from a snapshot of the
+/// last response when nothing has changed since it was generated.
+/// Where unix domain sockets are available, clients on the same host can connect over a local
+/// stream socket (instead of TCP) and exchange data frames over a local datagram socket (instead of UDP).
 class ServerNetworkManagerImpl : public IServerNetworkEventListener
 {
 public:
@@ -558,8 +918,38 @@ public:
         , m_udp_connection_result_write_buffer(false)
         , m_has_pending_udp_read(false)
         , m_connections()
+        , m_network_thread()
+        , m_network_work()
+        , m_is_closing_connections(false)
+        , m_has_pending_data_frame_flush(false)
+        , m_query_cache()
+        , m_device_state_generation(0)
+        , m_metrics_acceptor()
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+        , m_local_stream_acceptor()
+        , m_local_datagram_socket()
+        , m_local_connecting_remote_endpoint()
+        , m_local_connection_result_write_buffer(false)
+        , m_has_pending_local_read(false)
+        , m_local_stream_socket_path(make_local_socket_path(cfg.server_port, PSMOVESERVICE_LOCAL_STREAM_SOCKET_SUFFIX))
+        , m_local_datagram_socket_path(make_local_socket_path(cfg.server_port, PSMOVESERVICE_LOCAL_DATAGRAM_SOCKET_SUFFIX))
+#endif
     {
         memset(m_input_dataframe_buffer, 0, sizeof(m_input_dataframe_buffer));
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+        memset(m_local_input_dataframe_buffer, 0, sizeof(m_local_input_dataframe_buffer));
+
+        if (cfg.local_sockets_enabled)
+        {
+            open_local_sockets();
+        }
+#endif
+
+        if (cfg.metrics_port != 0)
+        {
+            open_metrics_acceptor(cfg.metrics_address, cfg.metrics_port);
+        }
     }
 
     virtual ~ServerNetworkManagerImpl()
@@ -578,14 +968,12 @@ public:
         SERVER_LOG_DEBUG("ServerNetworkManager::start_tcp_accept") << "Start waiting for a new TCP connection";
         
         // Create a new connection to handle a client.
-        // Passing a reference to a request handler to each connection poses no problem 
-        // since the server is single-threaded.
+        // Connections only ever touch the request handler through the device command queue.
         ClientConnectionPtr new_connection = 
             ClientConnection::create(
                 this, 
                 m_tcp_acceptor.get_io_service(), 
-                m_udp_socket, 
-                m_request_handler_ref);
+                m_udp_socket);
 
         // Add the connection to the list
         t_id_client_connection_pair map_entry(new_connection->get_connection_id(), new_connection);
@@ -600,31 +988,61 @@ public:
         // Asynchronously wait to accept a new udp clients
         // These should always come after a tcp connection is accepted
         start_udp_read_input_data_frame();
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+        if (m_local_stream_acceptor)
+        {
+            start_local_connection_accept();
+        }
+#endif
     }
 
-    void poll()
+    /// Called during PSMoveService::startup(), after the first accept has been queued
+    void start_network_thread()
     {
-        bool keep_polling= true;
-        int iteration_count= 0;
-        const static int k_max_iteration_count= 32;
+        if (!m_network_thread.joinable())
+        {
+            SERVER_LOG_INFO("ServerNetworkManager::start_network_thread") << "Starting network thread";
 
-        while (keep_polling && iteration_count < k_max_iteration_count)
+            // Keep io_service::run() from returning while there is no outstanding async work
+            m_network_work.reset(new asio::io_service::work(m_io_service));
+            m_network_thread = std::thread(&ServerNetworkManagerImpl::network_thread_func, this);
+        }
+    }
+
+    void stop_network_thread()
+    {
+        if (m_network_thread.joinable())
         {
-            // Start any pending writes on the UDP socket that can be started
-            start_udp_queued_data_frame_write();
+            SERVER_LOG_INFO("ServerNetworkManager::stop_network_thread") << "Stopping network thread";
 
-            // This call can execute any of the following callbacks:
-            // * TCP request has finished reading
-            // * TCP response has finished writing
-            // * UDP data frame has finished writing
-            m_io_service.poll();
+            m_network_work.reset();
+            m_io_service.stop();
+            m_network_thread.join();
+        }
+    }
+
+    /// Called during PSMoveService::startup()
+    void start_metrics_accept()
+    {
+        if (m_metrics_acceptor)
+        {
+            MetricsConnectionPtr new_connection= MetricsConnection::create(m_io_service);
 
-            // In the event that a UDP data frame write completed immediately,
-            // we should start another UDP data frame write.
-            keep_polling= has_queued_controller_data_frames_ready_to_start();
+            m_metrics_acceptor->async_accept(
+                new_connection->get_socket(),
+                boost::bind(&ServerNetworkManagerImpl::handle_metrics_accept, this, new_connection, asio::placeholders::error));
+        }
+    }
 
-            // ... but don't re-run this too many times
-            ++iteration_count;
+    /// Called on the device thread every PSMoveService::update()
+    void poll()
+    {
+        // Execute every request and client event the network thread has handed over since the last update
+        NetworkToDeviceCommand command;
+        while (m_device_command_queue.pop(command))
+        {
+            process_device_command(command);
         }
     }
 
@@ -632,6 +1050,13 @@ public:
     {
         SERVER_LOG_DEBUG("ServerNetworkManager::close_all_connections") << "Stopping all client connections";
 
+        // Nothing else may touch the sockets once we start closing them
+        stop_network_thread();
+        m_is_closing_connections= true;
+
+        // Throw away any requests that didn't get executed before shutdown
+        discard_device_commands();
+
         // Stop all of the TCP connections
         while (m_connections.size() > 0)
         {
@@ -661,78 +1086,130 @@ public:
             }
         }
 
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+        close_local_sockets();
+#endif
+
+        if (m_metrics_acceptor)
+        {
+            boost::system::error_code error;
+
+            m_metrics_acceptor->close(error);
+            m_metrics_acceptor.reset();
+        }
+
         m_connections.clear();
+
+        // Let the request handler clean up after the connections we just stopped
+        poll();
     }
 
+    /// Called on the device thread
     void send_notification(int connection_id, ResponsePtr response)
     {
-        t_client_connection_map_iter entry = m_connections.find(connection_id);
-
         // Notifications have an invalid response ID
         response->set_request_id(-1);
-        
-        if (entry != m_connections.end())
-        {
-            ClientConnectionPtr connection= entry->second;
 
-            SERVER_LOG_DEBUG("ServerNetworkManager::send_notification") 
-                << "Sending response_type " << response->type() 
-                << " to connection " << connection_id;
+        // Notifications signal device state changes made outside of a request
+        invalidate_query_cache();
 
-            connection->add_tcp_response_to_write_queue(response);
-            connection->start_tcp_write_queued_response();
-        }
-        else
-        {
-            SERVER_LOG_DEBUG("ServerNetworkManager::send_notification") 
-                << "Can't send response_type " << response->type() 
-                << " to a disconnected connection " << connection_id;
-        }
+        m_io_service.post(
+            boost::bind(&ServerNetworkManagerImpl::handle_send_notification, this, connection_id, response));
     }
 
+    /// Called on the device thread
     void send_notification_to_all_clients(ResponsePtr response)
     {
-        SERVER_LOG_DEBUG("ServerNetworkManager::send_notification") 
-            << "Sending response_type " << response->type() << "to all clients";
-
         // Notifications have an invalid response ID
         response->set_request_id(-1);
 
-        for (t_client_connection_map_iter iter= m_connections.begin(); iter != m_connections.end(); ++iter)
-        {
-            ClientConnectionPtr connection= iter->second;
+        // Notifications signal device state changes made outside of a request
+        invalidate_query_cache();
 
-            if (connection->can_send_data_to_client())
-            {
-                connection->add_tcp_response_to_write_queue(response);
-                connection->start_tcp_write_queued_response();
-            }
-        }
+        m_io_service.post(
+            boost::bind(&ServerNetworkManagerImpl::handle_send_notification_to_all_clients, this, response));
     }
 
+    /// Called on the device thread
     void send_device_data_frame(int connection_id, DeviceOutputDataFramePtr data_frame)
     {
-        t_client_connection_map_iter entry = m_connections.find(connection_id);
+        OutboundDataFrame outbound;
+        outbound.connection_id= connection_id;
+        outbound.data_frame= data_frame;
 
-        if (entry != m_connections.end())
+        if (m_outbound_data_frame_queue.push(outbound))
         {
-            ClientConnectionPtr connection= entry->second;
+            // Wake up the network thread unless a flush is already on its way
+            if (!m_has_pending_data_frame_flush.exchange(true))
+            {
+                m_io_service.post(boost::bind(&ServerNetworkManagerImpl::flush_outbound_data_frames, this));
+            }
+        }
+        else
+        {
+            SERVER_LOG_WARNING("ServerNetworkManager::send_device_data_frame") 
+                << "Outbound data frame queue full. Dropping data_frame for connection " << connection_id;
+
+            ServerMetrics::increment_counter(ServerMetric_ConnectionDataFramesDropped, connection_id);
+        }
+    }
 
-            SERVER_LOG_TRACE("ServerNetworkManager::send_device_data_frame") 
-                << "Sending data_frame to connection " << connection_id;
+    // -- IServerNetworkEventListener ----
+    virtual void handle_client_request(ClientConnection *connection, RequestPtr request) override
+    {
+        // Clock sync requests are answered right away.
+        // Any time spent waiting on the device thread would count against the client's round trip estimate.
+        if (request->type() == PSMoveProtocol::Request_RequestType_GET_SERVICE_TIME)
+        {
+            connection->add_tcp_response_to_write_queue(ServerRequestHandler::handle_service_time_request(request));
+            return;
+        }
 
-            connection->add_device_data_frame_to_write_queue(data_frame);
+        // Tracing requests don't touch device state, so they never wait on the device thread
+        if (request->type() == PSMoveProtocol::Request_RequestType_SET_TRACING_ENABLED)
+        {
+            connection->add_tcp_response_to_write_queue(ServerRequestHandler::handle_trace_request(request));
+            return;
+        }
 
-            start_udp_queued_data_frame_write();
+        // Writing a trace out takes a while, the response comes back from the trace dump thread once it's done
+        if (request->type() == PSMoveProtocol::Request_RequestType_DUMP_TRACE)
+        {
+            ServerRequestHandler::handle_trace_dump_request(
+                request,
+                boost::bind(&ServerNetworkManagerImpl::post_trace_dump_response, this, connection->get_connection_id(), _1));
+            return;
         }
-        else
+
+        // A read-only query can be answered right here from the snapshot of its last response,
+        // unless an earlier request from this client is still queued for the device thread 
+        // (the answer could otherwise miss a change this client asked for first).
+        if (connection->get_pending_device_request_count() == 0 &&
+            ServerRequestHandler::is_read_only_request(request))
         {
-            SERVER_LOG_ERROR("ServerNetworkManager::send_device_data_frame") 
-                << "Can't send data_frame to unknown connection " << connection_id;
+            ResponsePtr response= find_cached_query_response(request);
+
+            if (response)
+            {
+                connection->add_tcp_response_to_write_queue(response);
+                return;
+            }
         }
+
+        NetworkToDeviceCommand command;
+        command.command_type= NetworkToDeviceCommand::_Request;
+        command.connection_id= connection->get_connection_id();
+        command.request= request;
+
+        connection->add_pending_device_request();
+        push_device_command(command);
+    }
+
+    virtual void handle_client_data_frame_sent() override
+    {
+        start_udp_queued_data_frame_write();
     }
 
-    // -- IServerNetworkEventListener ----
 	virtual void handle_client_connection_stopped(int connection_id) override
     {
         t_client_connection_map_iter entry = m_connections.find(connection_id);
@@ -743,7 +1220,11 @@ public:
         }
 
         // Tell the request handler to clean up any state associated with this connection
-        m_request_handler_ref.handle_client_connection_stopped(connection_id);
+        NetworkToDeviceCommand command;
+        command.command_type= NetworkToDeviceCommand::_ConnectionStopped;
+        command.connection_id= connection_id;
+
+        push_device_command(command);
     }
 
 private:
@@ -772,35 +1253,371 @@ private:
     // If true, we are already waiting for a client to send the connection id
     bool m_has_pending_udp_read;
 
-    // A mapping from connection_id -> ClientConnectionPtr
+    // A mapping from connection_id -> ClientConnectionPtr (network thread only)
     t_client_connection_map m_connections;
 
-protected:
-    void handle_tcp_accept(ClientConnectionPtr connection, const boost::system::error_code& error)
-    {        
-        // A new client has connected
-        //
-        if (!error)
-        {
-            SERVER_LOG_DEBUG("ServerNetworkManager::handle_tcp_accept") << "Accepting a new connection";
-            
-            // Start the connection
-            connection->start();
-        }
-        else
-        {
-            SERVER_LOG_DEBUG("ServerNetworkManager::handle_tcp_accept") << 
-                "Failed to accept new connection: " << error.message();
+    // The thread running the io_service
+    std::thread m_network_thread;
+    std::unique_ptr<asio::io_service::work> m_network_work;
 
-            // Stop the failed connection
-            connection->stop();
-        }
+    // Network thread -> device thread: requests, input data frames and connection events
+    boost::lockfree::spsc_queue<NetworkToDeviceCommand, boost::lockfree::capacity<256> > m_device_command_queue;
 
-        // Accept another client
-        start_connection_accept();
-    }
+    // Set on the device thread once the network thread is stopped, the device thread then pushes the commands itself
+    bool m_is_closing_connections;
 
-    void start_udp_read_input_data_frame()
+    // Device thread -> network thread: published data frames
+    boost::lockfree::spsc_queue<OutboundDataFrame, boost::lockfree::capacity<1024> > m_outbound_data_frame_queue;
+    std::atomic_bool m_has_pending_data_frame_flush;
+
+    // Snapshot of the last response to each distinct read-only query
+    std::mutex m_query_cache_mutex;
+    std::map<std::string, CachedQueryResponse> m_query_cache;
+
+    // Bumped on the device thread whenever something may have changed what a query reports
+    std::atomic<unsigned int> m_device_state_generation;
+
+    // Handles waiting for and accepting metrics scrapes (null if the metrics endpoint is disabled)
+    std::unique_ptr<tcp::acceptor> m_metrics_acceptor;
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    // Handles waiting for and accepting new local stream connections (null if local sockets are disabled)
+    std::unique_ptr<local_stream::acceptor> m_local_stream_acceptor;
+
+    // Local datagram socket shared amongst all of the local client connections
+    std::unique_ptr<local_datagram::socket> m_local_datagram_socket;
+
+    // The endpoint of the next connecting local client
+    local_datagram::endpoint m_local_connecting_remote_endpoint;
+
+    // A pending local datagram from the client
+    uint8_t m_local_input_dataframe_buffer[HEADER_SIZE + MAX_INPUT_DATA_FRAME_MESSAGE_SIZE];
+
+    // A pending local connection result sent to the client
+    bool m_local_connection_result_write_buffer;
+
+    // If true, we are already waiting on a local datagram
+    bool m_has_pending_local_read;
+
+    std::string m_local_stream_socket_path;
+    std::string m_local_datagram_socket_path;
+#endif
+
+protected:
+    void network_thread_func()
+    {
+        ServerUtility::set_current_thread_name("Network Thread");
+        SERVER_TRACE_THREAD_NAME("Network Thread");
+
+        // Keep servicing the sockets until stop_network_thread() stops the io_service
+        while (!m_io_service.stopped())
+        {
+            try
+            {
+                m_io_service.run();
+            }
+            catch (std::exception& e)
+            {
+                SERVER_LOG_ERROR("ServerNetworkManager::network_thread_func") << "Unhandled exception: " << e.what();
+            }
+        }
+    }
+
+    void push_device_command(const NetworkToDeviceCommand &command)
+    {
+        // The device thread drains this queue every update, so a full queue only means a short wait
+        while (!m_device_command_queue.push(command))
+        {
+            if (m_is_closing_connections)
+            {
+                // Stopping the connections pushes from the device thread, no update() is coming to drain the queue
+                discard_device_commands();
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    void discard_device_commands()
+    {
+        NetworkToDeviceCommand command;
+        while (m_device_command_queue.pop(command))
+        {
+            if (command.command_type == NetworkToDeviceCommand::_ConnectionStopped)
+            {
+                m_request_handler_ref.handle_client_connection_stopped(command.connection_id);
+            }
+        }
+    }
+
+    // Runs on the device thread
+    void process_device_command(const NetworkToDeviceCommand &command)
+    {
+        switch (command.command_type)
+        {
+        case NetworkToDeviceCommand::_Request:
+            {
+                ResponsePtr response= m_request_handler_ref.handle_request(command.connection_id, command.request);
+
+                if (ServerRequestHandler::is_read_only_request(command.request))
+                {
+                    if (response)
+                    {
+                        cache_query_response(command.request, response);
+                    }
+                }
+                else
+                {
+                    // Any other request may have changed something a cached query reported
+                    invalidate_query_cache();
+                }
+
+                // Always hand back a result, even an empty one, so the connection can retire the request
+                m_io_service.post(
+                    boost::bind(&ServerNetworkManagerImpl::handle_device_response, this, command.connection_id, response));
+            } break;
+        case NetworkToDeviceCommand::_InputDataFrame:
+            {
+                m_request_handler_ref.handle_input_data_frame(command.input_data_frame);
+            } break;
+        case NetworkToDeviceCommand::_ConnectionStopped:
+            {
+                m_request_handler_ref.handle_client_connection_stopped(command.connection_id);
+            } break;
+        }
+    }
+
+    // Runs on the network thread
+    void handle_device_response(int connection_id, ResponsePtr response)
+    {
+        t_client_connection_map_iter entry = m_connections.find(connection_id);
+
+        if (entry != m_connections.end())
+        {
+            ClientConnectionPtr connection= entry->second;
+
+            connection->remove_pending_device_request();
+
+            if (response)
+            {
+                connection->add_tcp_response_to_write_queue(response);
+            }
+
+            connection->start_tcp_write_queued_response();
+        }
+        else
+        {
+            SERVER_LOG_DEBUG("ServerNetworkManager::handle_device_response") 
+                << "Dropping response for disconnected connection " << connection_id;
+        }
+    }
+
+    // Runs on the network thread
+    void flush_outbound_data_frames()
+    {
+        // Clear the flag before draining so that a frame pushed mid-drain posts another flush
+        m_has_pending_data_frame_flush= false;
+
+        OutboundDataFrame outbound;
+        while (m_outbound_data_frame_queue.pop(outbound))
+        {
+            t_client_connection_map_iter entry = m_connections.find(outbound.connection_id);
+
+            if (entry != m_connections.end())
+            {
+                SERVER_LOG_TRACE("ServerNetworkManager::flush_outbound_data_frames") 
+                    << "Sending data_frame to connection " << outbound.connection_id;
+
+                entry->second->add_device_data_frame_to_write_queue(outbound.data_frame);
+            }
+            else
+            {
+                SERVER_LOG_DEBUG("ServerNetworkManager::flush_outbound_data_frames") 
+                    << "Can't send data_frame to unknown connection " << outbound.connection_id;
+            }
+        }
+
+        start_udp_queued_data_frame_write();
+    }
+
+    static std::string make_query_cache_key(const RequestPtr &request)
+    {
+        // Identical queries only differ by request id
+        PSMoveProtocol::Request key_request(*request);
+        key_request.set_request_id(0);
+
+        return key_request.SerializeAsString();
+    }
+
+    // Runs on the device thread
+    void cache_query_response(const RequestPtr &request, const ResponsePtr &response)
+    {
+        CachedQueryResponse entry;
+        entry.device_state_generation= m_device_state_generation.load();
+        entry.timestamp= std::chrono::high_resolution_clock::now();
+        entry.response= ResponsePtr(new PSMoveProtocol::Response(*response));
+
+        const std::string key= make_query_cache_key(request);
+
+        std::lock_guard<std::mutex> lock(m_query_cache_mutex);
+        m_query_cache[key]= entry;
+    }
+
+    // Runs on the network thread
+    ResponsePtr find_cached_query_response(const RequestPtr &request)
+    {
+        ResponsePtr response;
+        const std::string key= make_query_cache_key(request);
+
+        std::lock_guard<std::mutex> lock(m_query_cache_mutex);
+        std::map<std::string, CachedQueryResponse>::const_iterator iter= m_query_cache.find(key);
+
+        if (iter != m_query_cache.end())
+        {
+            const CachedQueryResponse &entry= iter->second;
+            const std::chrono::duration<double, std::milli> age= std::chrono::high_resolution_clock::now() - entry.timestamp;
+
+            if (entry.device_state_generation == m_device_state_generation.load() && 
+                age.count() < k_max_query_cache_age_ms)
+            {
+                response= ResponsePtr(new PSMoveProtocol::Response(*entry.response));
+                response->set_request_id(request->request_id());
+            }
+        }
+
+        return response;
+    }
+
+    void invalidate_query_cache()
+    {
+        ++m_device_state_generation;
+    }
+
+    // Runs on the network thread
+    void handle_send_notification(int connection_id, ResponsePtr response)
+    {
+        t_client_connection_map_iter entry = m_connections.find(connection_id);
+        
+        if (entry != m_connections.end())
+        {
+            ClientConnectionPtr connection= entry->second;
+
+            SERVER_LOG_DEBUG("ServerNetworkManager::send_notification") 
+                << "Sending response_type " << response->type() 
+                << " to connection " << connection_id;
+
+            connection->add_tcp_response_to_write_queue(response);
+            connection->start_tcp_write_queued_response();
+        }
+        else
+        {
+            SERVER_LOG_DEBUG("ServerNetworkManager::send_notification") 
+                << "Can't send response_type " << response->type() 
+                << " to a disconnected connection " << connection_id;
+        }
+    }
+
+    // Runs on the trace dump thread, or the network thread when the dump couldn't start
+    void post_trace_dump_response(int connection_id, ResponsePtr response)
+    {
+        // Sent like a notification, but keeps the request id the client waits on
+        m_io_service.post(
+            boost::bind(&ServerNetworkManagerImpl::handle_send_notification, this, connection_id, response));
+    }
+
+    // Runs on the network thread
+    void handle_send_notification_to_all_clients(ResponsePtr response)
+    {
+        SERVER_LOG_DEBUG("ServerNetworkManager::send_notification") 
+            << "Sending response_type " << response->type() << "to all clients";
+
+        for (t_client_connection_map_iter iter= m_connections.begin(); iter != m_connections.end(); ++iter)
+        {
+            ClientConnectionPtr connection= iter->second;
+
+            if (connection->can_send_data_to_client())
+            {
+                connection->add_tcp_response_to_write_queue(response);
+                connection->start_tcp_write_queued_response();
+            }
+        }
+    }
+
+    void handle_tcp_accept(ClientConnectionPtr connection, const boost::system::error_code& error)
+    {        
+        // A new client has connected
+        //
+        if (!error)
+        {
+            SERVER_LOG_DEBUG("ServerNetworkManager::handle_tcp_accept") << "Accepting a new connection";
+            
+            // Start the connection
+            connection->start();
+        }
+        else
+        {
+            SERVER_LOG_DEBUG("ServerNetworkManager::handle_tcp_accept") << 
+                "Failed to accept new connection: " << error.message();
+
+            // Stop the failed connection
+            connection->stop();
+        }
+
+        // Accept another client
+        start_connection_accept();
+    }
+
+    void open_metrics_acceptor(const std::string &address, int port)
+    {
+        try
+        {
+            const tcp::endpoint endpoint(asio::ip::address::from_string(address), static_cast<unsigned short>(port));
+
+            m_metrics_acceptor.reset(new tcp::acceptor(m_io_service, endpoint));
+
+            SERVER_LOG_INFO("ServerNetworkManager::open_metrics_acceptor") 
+                << "Serving metrics on http://" << address << ":" << port << "/metrics";
+        }
+        catch (boost::system::system_error &e)
+        {
+            SERVER_LOG_WARNING("ServerNetworkManager::open_metrics_acceptor") 
+                << "Unable to open the metrics endpoint on " << address << ":" << port << " (" << e.what() << ")";
+
+            m_metrics_acceptor.reset();
+        }
+    }
+
+    void handle_metrics_accept(MetricsConnectionPtr connection, const boost::system::error_code& error)
+    {
+        if (error == asio::error::operation_aborted)
+        {
+            // The acceptor closed during shutdown
+            return;
+        }
+
+        if (error)
+        {
+            SERVER_LOG_DEBUG("ServerNetworkManager::handle_metrics_accept") << 
+                "Failed to accept a metrics connection: " << error.message();
+        }
+        else if (MetricsConnection::get_open_connection_count() > k_max_metrics_connection_count)
+        {
+            SERVER_LOG_DEBUG("ServerNetworkManager::handle_metrics_accept") << 
+                "Closing a metrics connection, " << k_max_metrics_connection_count << " scrapes are already open";
+            connection->close();
+        }
+        else
+        {
+            connection->start();
+        }
+
+        // Wait for the next scrape
+        start_metrics_accept();
+    }
+
+    void start_udp_read_input_data_frame()
     {
         if (!m_has_pending_udp_read)
         {
@@ -824,7 +1641,7 @@ protected:
         if (!error) 
         {
             // Parse the incoming data frame
-            handle_udp_data_frame_received();
+            handle_input_data_frame_received(m_input_dataframe_buffer, sizeof(m_input_dataframe_buffer), false);
         }
         else
         {
@@ -836,23 +1653,20 @@ protected:
         start_udp_read_input_data_frame();
     }
 
-    // Called when enough data was read into m_data_frame_read_buffer for a complete data frame message. 
+    // Called when a complete data frame message was received on the udp socket (or the local datagram socket). 
     // Parse the data_frame and forward it on to the response handler.
-    void handle_udp_data_frame_received()
+    void handle_input_data_frame_received(uint8_t *buffer, size_t buffer_size, bool is_local)
     {
-        // No longer is there a pending read
-        m_has_pending_udp_read = false;
-
         SERVER_LOG_DEBUG("ClientNetworkManager::handle_udp_data_frame_received") << "Parsing DataFrame";
 
         // TODO: Switch on data frame type to choose which m_packed_data_frame_X to use.
-        unsigned msg_len = m_packed_input_dataframe.decode_header(m_input_dataframe_buffer, sizeof(m_input_dataframe_buffer));
+        unsigned msg_len = m_packed_input_dataframe.decode_header(buffer, buffer_size);
         unsigned total_len = HEADER_SIZE + msg_len;
-        SERVER_LOG_DEBUG("    ") << show_hex(m_input_dataframe_buffer, total_len);
+        SERVER_LOG_DEBUG("    ") << show_hex(buffer, total_len);
         SERVER_LOG_DEBUG("    ") << msg_len << " bytes";
 
         // Parse the response buffer
-        if (m_packed_input_dataframe.unpack(m_input_dataframe_buffer, total_len))
+        if (m_packed_input_dataframe.unpack(buffer, total_len))
         {
             DeviceInputDataFramePtr data_frame = m_packed_input_dataframe.get_msg();
 
@@ -870,14 +1684,33 @@ protected:
                 if (!connection->is_udp_remote_endpoint_bound())
                 {
                     // Associate this udp remote endpoint with the given connection id
-                    connection->bind_udp_remote_endpoint(m_udp_connecting_remote_endpoint);
-
-                    // Tell the client that this was a valid connection id
-                    start_udp_send_connection_result(true);
+                    // and tell the client that this was a valid connection id
+                    if (is_local)
+                    {
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+                        connection->bind_local_remote_endpoint(m_local_connecting_remote_endpoint);
+                        start_local_send_connection_result(true);
+#endif
+                    }
+                    else
+                    {
+                        connection->bind_udp_remote_endpoint(m_udp_connecting_remote_endpoint);
+                        start_udp_send_connection_result(true);
+                    }
                 }
 
-                // Process the incoming data frame
-                m_request_handler_ref.handle_input_data_frame(data_frame);
+                // Hand a copy of the incoming data frame over to the device thread
+                // (the packed message gets reused by the next read)
+                NetworkToDeviceCommand command;
+                command.command_type= NetworkToDeviceCommand::_InputDataFrame;
+                command.connection_id= data_frame->connection_id();
+                command.input_data_frame= DeviceInputDataFramePtr(new PSMoveProtocol::DeviceInputDataFrame(*data_frame));
+
+                if (!m_device_command_queue.push(command))
+                {
+                    SERVER_LOG_WARNING("ServerNetworkManager::handle_udp_data_frame_received")
+                        << "Device command queue full. Dropping input data frame from connection " << data_frame->connection_id();
+                }
             }
             else 
             {
@@ -888,7 +1721,16 @@ protected:
                 {
                     // If the device category was invalid, then this must have been an initial dataframe sent at device connection
                     // Tell the client that this was an invalid connection id
-                    start_udp_send_connection_result(false);
+                    if (is_local)
+                    {
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+                        start_local_send_connection_result(false);
+#endif
+                    }
+                    else
+                    {
+                        start_udp_send_connection_result(false);
+                    }
                 }
             }
         }
@@ -918,47 +1760,221 @@ protected:
         start_udp_read_input_data_frame();
     }
 
-    void start_udp_queued_data_frame_write()
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    void open_local_sockets()
     {
-        for (t_client_connection_map_iter iter= m_connections.begin(); iter != m_connections.end(); ++iter)
+        try
         {
-            ClientConnectionPtr connection= iter->second;
-
-            if (connection->start_udp_write_queued_device_data_frame())
+            // Only remove socket files left behind by a previous run that didn't shut down cleanly,
+            // never the live endpoints of another running service
+            if (!remove_stale_local_socket<local_stream>(m_local_stream_socket_path) ||
+                !remove_stale_local_socket<local_datagram>(m_local_datagram_socket_path))
             {
-                SERVER_LOG_TRACE("ServerNetworkManager::start_udp_queued_data_frame_write") 
-                    << "Send queued UDP data on connection id: " << iter->first;
-
-                // Don't start a write on any other connection until this one is finished 
-                break;
+                SERVER_LOG_WARNING("ServerNetworkManager::open_local_sockets") 
+                    << "Another service is accepting local clients on " << m_local_stream_socket_path 
+                    << ". Only accepting clients over TCP/UDP.";
+                return;
             }
-        }        
+
+
+            m_local_stream_acceptor.reset(
+                new local_stream::acceptor(m_io_service, local_stream::endpoint(m_local_stream_socket_path)));
+            m_local_datagram_socket.reset(
+                new local_datagram::socket(m_io_service, local_datagram::endpoint(m_local_datagram_socket_path)));
+
+            SERVER_LOG_INFO("ServerNetworkManager::open_local_sockets") 
+                << "Accepting local clients on " << m_local_stream_socket_path;
+        }
+        catch (boost::system::system_error &e)
+        {
+            SERVER_LOG_WARNING("ServerNetworkManager::open_local_sockets") 
+                << "Unable to open local sockets (" << e.what() << "). Local clients will fall back to TCP/UDP.";
+
+            m_local_stream_acceptor.reset();
+            m_local_datagram_socket.reset();
+        }
     }
 
-    bool has_queued_controller_data_frames_ready_to_start()
+    static std::string make_local_socket_path(int server_port, const char *suffix)
     {
-        bool has_queued_write_ready_to_start= false;
-        bool udp_socket_available= true;
+        std::stringstream path;
+        path << PSMOVESERVICE_LOCAL_SOCKET_PATH_PREFIX << server_port << suffix;
 
-        for (t_client_connection_map_iter iter= m_connections.begin(); iter != m_connections.end(); ++iter)
+        return path.str();
+    }
+
+    /// Unlinks a socket file nobody is bound to anymore.
+    /// Returns false when something still accepts connections on it.
+    template <typename t_local_protocol>
+    bool remove_stale_local_socket(const std::string &path)
+    {
+        boost::system::error_code error;
+        typename t_local_protocol::socket probe_socket(m_io_service);
+
+        probe_socket.connect(typename t_local_protocol::endpoint(path), error);
+
+        if (!error)
         {
-            ClientConnectionPtr connection= iter->second;
+            return false;
+        }
+        
+        // A socket file without an owner refuses connections
+        if (error == asio::error::connection_refused)
+        {
+            ::unlink(path.c_str());
+        }
 
-            if (connection->has_pending_udp_write())
+        return true;
+    }
+
+    void close_local_sockets()
+    {
+        boost::system::error_code error;
+
+        if (m_local_stream_acceptor)
+        {
+            m_local_stream_acceptor->close(error);
+            m_local_stream_acceptor.reset();
+            ::unlink(m_local_stream_socket_path.c_str());
+        }
+
+        if (m_local_datagram_socket)
+        {
+            m_local_datagram_socket->close(error);
+            if (error)
             {
-                // Can't start any new udp write until any current udp write is done
-                udp_socket_available= false;
-                break;
+                SERVER_LOG_ERROR("ServerNetworkManager::close_local_sockets") << "Problem closing the local datagram socket: " << error.message();
             }
 
-            if (connection->has_queued_controller_data_frames())
+            m_local_datagram_socket.reset();
+            ::unlink(m_local_datagram_socket_path.c_str());
+        }
+    }
+
+    void start_local_connection_accept()
+    {
+        SERVER_LOG_DEBUG("ServerNetworkManager::start_local_connection_accept") << "Start waiting for a new local connection";
+
+        ClientConnectionPtr new_connection = 
+            ClientConnection::create_local(
+                this, 
+                m_io_service, 
+                m_udp_socket,
+                *m_local_datagram_socket);
+
+        // Add the connection to the list
+        t_id_client_connection_pair map_entry(new_connection->get_connection_id(), new_connection);
+        m_connections.insert(map_entry);
+
+        // Asynchronously wait to accept a new local client
+        m_local_stream_acceptor->async_accept(
+            new_connection->get_local_stream_socket(),
+            boost::bind(&ServerNetworkManagerImpl::handle_local_accept, this, new_connection, asio::placeholders::error));
+
+        // Local clients send their connection id over the local datagram socket
+        start_local_read_input_data_frame();
+    }
+
+    void handle_local_accept(ClientConnectionPtr connection, const boost::system::error_code& error)
+    {
+        if (!error)
+        {
+            SERVER_LOG_DEBUG("ServerNetworkManager::handle_local_accept") << "Accepting a new local connection";
+
+            connection->start();
+        }
+        else
+        {
+            SERVER_LOG_DEBUG("ServerNetworkManager::handle_local_accept") << 
+                "Failed to accept new local connection: " << error.message();
+
+            connection->stop();
+        }
+
+        // The acceptor is closed during shutdown
+        if (m_local_stream_acceptor && m_local_stream_acceptor->is_open())
+        {
+            start_local_connection_accept();
+        }
+    }
+
+    void start_local_read_input_data_frame()
+    {
+        if (!m_has_pending_local_read && m_local_datagram_socket)
+        {
+            m_has_pending_local_read = true;
+            m_local_datagram_socket->async_receive_from(
+                asio::buffer(m_local_input_dataframe_buffer, sizeof(m_local_input_dataframe_buffer)),
+                m_local_connecting_remote_endpoint,
+                boost::bind(
+                    &ServerNetworkManagerImpl::handle_local_read_data_frame,
+                    this,
+                    asio::placeholders::error));
+        }
+    }
+
+    void handle_local_read_data_frame(const boost::system::error_code& error)
+    {
+        m_has_pending_local_read= false;
+
+        if (!error) 
+        {
+            handle_input_data_frame_received(m_local_input_dataframe_buffer, sizeof(m_local_input_dataframe_buffer), true);
+        }
+        else
+        {
+            SERVER_LOG_ERROR("ServerNetworkManager::handle_local_read_data_frame") 
+                << "Failed to receive local data frame: "<< error.message();
+
+            if (error == asio::error::operation_aborted)
             {
-                // Found a connection with a pending udp write ready to go
-                has_queued_write_ready_to_start= true;
+                // Socket closed during shutdown
+                return;
             }
         }
 
-        return udp_socket_available && has_queued_write_ready_to_start;
+        start_local_read_input_data_frame();
+    }
+
+    void start_local_send_connection_result(bool success)
+    {
+        SERVER_LOG_DEBUG("ServerNetworkManager::start_local_send_connection_result") 
+            << "Send result: " << success;
+
+        m_local_connection_result_write_buffer= success;
+        m_local_datagram_socket->async_send_to(
+            boost::asio::buffer(&m_local_connection_result_write_buffer, sizeof(m_local_connection_result_write_buffer)), 
+            m_local_connecting_remote_endpoint,
+            boost::bind(&ServerNetworkManagerImpl::handle_local_write_connection_result, this, boost::asio::placeholders::error));
+    }
+
+    void handle_local_write_connection_result(const boost::system::error_code& error)
+    {
+        if (error) 
+        {
+            SERVER_LOG_ERROR("ServerNetworkManager::handle_local_write_connection_result") 
+                << "Failed to send local connection response: "<< error.message();
+        }
+
+        start_local_read_input_data_frame();
+    }
+#endif
+
+    void start_udp_queued_data_frame_write()
+    {
+        for (t_client_connection_map_iter iter= m_connections.begin(); iter != m_connections.end(); ++iter)
+        {
+            ClientConnectionPtr connection= iter->second;
+
+            if (connection->start_udp_write_queued_device_data_frame())
+            {
+                SERVER_LOG_TRACE("ServerNetworkManager::start_udp_queued_data_frame_write") 
+                    << "Send queued UDP data on connection id: " << iter->first;
+
+                // Don't start a write on any other connection until this one is finished 
+                break;
+            }
+        }        
     }
 };
 
@@ -997,6 +2013,8 @@ bool ServerNetworkManager::startup()
     m_instance= this;
     
     implementation_ptr->start_connection_accept();
+    implementation_ptr->start_metrics_accept();
+    implementation_ptr->start_network_thread();
 
     return true;
 }
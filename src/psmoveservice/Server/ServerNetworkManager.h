@@ -27,6 +27,14 @@ public:
 
     long version;
 	int server_port;
+
+	// Also accept local clients over unix domain sockets (on platforms that have them),
+	// their paths are derived from server_port (see PSMOVESERVICE_LOCAL_SOCKET_PATH_PREFIX)
+	bool local_sockets_enabled;
+
+	// Serves the ServerMetrics registry in the Prometheus text format, a port of 0 turns it off
+	int metrics_port;
+	std::string metrics_address;
 };
 
 // -Server Network Manager-
@@ -48,21 +56,26 @@ public:
     /// Called first by PSMoveService::startup()
     /**
      Calls ServerNetworkManagerImpl::start_connection_accept()
+     and starts the network thread that services all socket i/o
      */
     bool startup();
     
     /// Called last by PSMoveService::update()
     /**
      Calls ServerNetworkManagerImpl::poll()
+     which runs any requests queued up by the network thread on the calling (device) thread
      */
     void update();
     
     /// Called last by PSMoveService::shutdown()
     /**
      Calls ServerNetworkManagerImpl::close_all_connections()
+     after stopping the network thread
      */
     void shutdown();
 
+    /// The send functions must be called from the device thread.
+    /// The messages get handed over to the network thread to be written.
     void send_notification(int connection_id, ResponsePtr response);
     
     void send_notification_to_all_clients(ResponsePtr response);
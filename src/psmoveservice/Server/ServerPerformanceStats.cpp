@@ -0,0 +1,178 @@
+//-- includes -----
+#include "ServerPerformanceStats.h"
+#include "DeviceInterface.h"
+#include "PSMoveProtocol.pb.h"
+#include "SharedConstants.h"
+#include <algorithm>
+#include <string.h>
+
+//-- constants -----
+// Bucket i counts samples below (k_first_bucket_nsec << i), the last bucket counts everything else
+static const int k_bucket_count = 16;
+static const long long k_first_bucket_nsec = 1000;
+
+// Each histogram covers between one and two windows worth of the most recent samples
+static const unsigned long long k_window_sample_count = 1024;
+
+// Enough device slots for the largest of the device lists
+static const int k_max_stage_device_count =
+    (PSMOVESERVICE_MAX_CONTROLLER_COUNT > PSMOVESERVICE_MAX_TRACKER_COUNT)
+    ? ((PSMOVESERVICE_MAX_CONTROLLER_COUNT > PSMOVESERVICE_MAX_HMD_COUNT) ? PSMOVESERVICE_MAX_CONTROLLER_COUNT : PSMOVESERVICE_MAX_HMD_COUNT)
+    : ((PSMOVESERVICE_MAX_TRACKER_COUNT > PSMOVESERVICE_MAX_HMD_COUNT) ? PSMOVESERVICE_MAX_TRACKER_COUNT : PSMOVESERVICE_MAX_HMD_COUNT);
+
+//-- definitions -----
+struct StageWindow
+{
+    unsigned long long sample_count;
+    long long min_nsec;
+    long long max_nsec;
+    long long total_nsec;
+    unsigned long long bucket_counts[k_bucket_count];
+};
+
+// Recording goes into the current window.
+// Once it fills up it becomes the previous window and the old previous window gets recycled,
+// so the reported stats follow changes in the update loop without losing all history at once.
+struct StageHistogram
+{
+    StageWindow windows[2];
+    int current_window_index;
+
+    void record(long long duration_nsec)
+    {
+        StageWindow *window= &windows[current_window_index];
+
+        if (window->sample_count >= k_window_sample_count)
+        {
+            current_window_index= 1 - current_window_index;
+            window= &windows[current_window_index];
+            memset(window, 0, sizeof(StageWindow));
+        }
+
+        int bucket_index= 0;
+        while (bucket_index < k_bucket_count - 1 && duration_nsec >= (k_first_bucket_nsec << bucket_index))
+        {
+            ++bucket_index;
+        }
+
+        window->min_nsec= (window->sample_count == 0) ? duration_nsec : std::min(window->min_nsec, duration_nsec);
+        window->max_nsec= std::max(window->max_nsec, duration_nsec);
+        window->total_nsec+= duration_nsec;
+        window->bucket_counts[bucket_index]++;
+        window->sample_count++;
+    }
+};
+
+//-- globals -----
+static StageHistogram g_stage_histograms[ServerStageDevice_COUNT][k_max_stage_device_count][ServerStage_COUNT];
+
+//-- public interface -----
+namespace ServerPerformanceStats
+{
+    void record_stage_sample(
+        eServerStage stage,
+        eServerStageDeviceCategory device_category,
+        int device_id,
+        long long duration_nsec)
+    {
+        if (device_category == ServerStageDevice_System)
+        {
+            device_id= 0;
+        }
+
+        if (device_id >= 0 && device_id < k_max_stage_device_count)
+        {
+            g_stage_histograms[device_category][device_id][stage].record(std::max(duration_nsec, 0LL));
+        }
+    }
+
+    void fill_performance_stats(PSMoveProtocol::Response_ResultPerformanceStats *out_stats)
+    {
+        out_stats->set_window_sample_count(static_cast<unsigned int>(k_window_sample_count));
+
+        for (int category_index = 0; category_index < ServerStageDevice_COUNT; ++category_index)
+        {
+            const int device_count = (category_index == ServerStageDevice_System) ? 1 : k_max_stage_device_count;
+
+            for (int device_id = 0; device_id < device_count; ++device_id)
+            {
+                for (int stage_index = 0; stage_index < ServerStage_COUNT; ++stage_index)
+                {
+                    const StageHistogram &histogram = g_stage_histograms[category_index][device_id][stage_index];
+                    const StageWindow &current = histogram.windows[histogram.current_window_index];
+                    const StageWindow &previous = histogram.windows[1 - histogram.current_window_index];
+
+                    if (current.sample_count + previous.sample_count == 0)
+                    {
+                        continue;
+                    }
+
+                    PSMoveProtocol::Response_ResultPerformanceStats_StageStats *stage_stats = out_stats->add_stage_stats();
+
+                    stage_stats->set_stage(static_cast<PSMoveProtocol::Response_ResultPerformanceStats_Stage>(stage_index));
+                    if (category_index == ServerStageDevice_System)
+                    {
+                        stage_stats->set_device_id(-1);
+                    }
+                    else
+                    {
+                        stage_stats->set_device_category(
+                            static_cast<PSMoveProtocol::DeviceOutputDataFrame_DeviceCategory>(category_index));
+                        stage_stats->set_device_id(device_id);
+                    }
+
+                    stage_stats->set_sample_count(current.sample_count + previous.sample_count);
+                    if (previous.sample_count == 0)
+                    {
+                        stage_stats->set_min_nsec(current.min_nsec);
+                    }
+                    else if (current.sample_count == 0)
+                    {
+                        stage_stats->set_min_nsec(previous.min_nsec);
+                    }
+                    else
+                    {
+                        stage_stats->set_min_nsec(std::min(current.min_nsec, previous.min_nsec));
+                    }
+                    stage_stats->set_max_nsec(std::max(current.max_nsec, previous.max_nsec));
+                    stage_stats->set_total_nsec(current.total_nsec + previous.total_nsec);
+
+                    for (int bucket_index = 0; bucket_index < k_bucket_count; ++bucket_index)
+                    {
+                        stage_stats->add_bucket_counts(current.bucket_counts[bucket_index] + previous.bucket_counts[bucket_index]);
+                    }
+                }
+            }
+        }
+    }
+
+    void reset()
+    {
+        memset(g_stage_histograms, 0, sizeof(g_stage_histograms));
+    }
+
+    eServerStageDeviceCategory get_device_category(const IDeviceInterface *device)
+    {
+        eServerStageDeviceCategory device_category = ServerStageDevice_System;
+
+        if (device != nullptr)
+        {
+            const int device_class = static_cast<int>(device->getDeviceType()) & 0xf0;
+
+            switch (device_class)
+            {
+            case CommonDeviceState::Controller:
+                device_category = ServerStageDevice_Controller;
+                break;
+            case CommonDeviceState::TrackingCamera:
+                device_category = ServerStageDevice_Tracker;
+                break;
+            case CommonDeviceState::HeadMountedDisplay:
+                device_category = ServerStageDevice_HMD;
+                break;
+            }
+        }
+
+        return device_category;
+    }
+};
@@ -0,0 +1,61 @@
+#ifndef SERVER_PERFORMANCE_STATS_H
+#define SERVER_PERFORMANCE_STATS_H
+
+//-- constants -----
+/// Stages of the device update loop that get timed.
+/// Same values as PSMoveProtocol::Response::ResultPerformanceStats::Stage.
+enum eServerStage
+{
+    ServerStage_None= -1,                   // Scopes that aren't a timed stage
+
+    ServerStage_Tick= 0,                    // The whole DeviceManager::update()
+    ServerStage_DevicePoll= 1,              // Reading a device's sensor packet or video frame
+    ServerStage_OpticalPoseEstimation= 2,   // Projecting a device on every tracker and triangulating its position
+    ServerStage_FilterUpdate= 3,            // Pose filter update and prediction
+    ServerStage_Publish= 4,                 // Building the data frames of a device for its listening clients
+
+    ServerStage_COUNT
+};
+
+/// Which devices a stage sample belongs to.
+/// Same values as PSMoveProtocol::DeviceOutputDataFrame::DeviceCategory, plus one for the stages shared by all devices.
+enum eServerStageDeviceCategory
+{
+    ServerStageDevice_Controller= 0,
+    ServerStageDevice_Tracker= 1,
+    ServerStageDevice_HMD= 2,
+    ServerStageDevice_System= 3,
+
+    ServerStageDevice_COUNT
+};
+
+//-- declarations -----
+namespace PSMoveProtocol
+{
+    class Response_ResultPerformanceStats;
+};
+
+class IDeviceInterface;
+
+//-- interface -----
+/// Rolling per device, per stage duration histograms of the device update loop.
+/// Only the device thread (PSMoveService::update) records and reads them, so there is no locking.
+namespace ServerPerformanceStats
+{
+    /// Adds a stage duration to the histogram of the given device (device_id is ignored for ServerStageDevice_System)
+    void record_stage_sample(eServerStage stage, eServerStageDeviceCategory device_category, int device_id, long long duration_nsec);
+
+    /// Writes every histogram with samples in it to a GET_PERFORMANCE_STATS result
+    void fill_performance_stats(PSMoveProtocol::Response_ResultPerformanceStats *out_stats);
+
+    /// Empties all of the histograms
+    void reset();
+
+    /// Maps a device to the category its stage samples are filed under (ServerStageDevice_System for no device)
+    eServerStageDeviceCategory get_device_category(const IDeviceInterface *device);
+};
+
+//-- macros -----
+// Stages get timed with SERVER_STAGE_SCOPE (ServerScope.h), which also records them in the timeline trace.
+
+#endif // SERVER_PERFORMANCE_STATS_H
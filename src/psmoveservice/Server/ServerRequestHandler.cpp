@@ -21,18 +21,31 @@
 #include "ServerControllerView.h"
 #include "ServerDeviceView.h"
 #include "ServerNetworkManager.h"
+#include "ServerPerformanceStats.h"
+#include "ServerTrace.h"
 #include "ServerTrackerView.h"
 #include "ServerHMDView.h"
 #include "ServerLog.h"
+#include "ServerMessagePool.h"
+#include "ServerMetrics.h"
 #include "ServerUtility.h"
 #include "TrackerManager.h"
 #include "VirtualController.h"
 
 #include <cassert>
+#include <chrono>
 #include <bitset>
+#include <functional>
 #include <map>
 #include <boost/shared_ptr.hpp>
 
+//-- constants -----
+// Enough in-flight messages to cover every open stream with a few frames queued per connection
+static const size_t k_data_frame_pool_size= 256;
+static const size_t k_data_frame_arena_block_size= 2048;
+static const size_t k_response_pool_size= 32;
+static const size_t k_response_arena_block_size= 8192;
+
 //-- pre-declarations -----
 class ServerRequestHandlerImpl;
 typedef boost::shared_ptr<ServerRequestHandlerImpl> ServerRequestHandlerImplPtr;
@@ -91,6 +104,8 @@ public:
     ServerRequestHandlerImpl(DeviceManager &deviceManager)
         : m_device_manager(deviceManager)
         , m_connection_state_map()
+        , m_data_frame_pool(k_data_frame_pool_size, k_data_frame_arena_block_size)
+        , m_response_pool(k_response_pool_size, k_response_arena_block_size)
     {
     }
 
@@ -176,216 +191,226 @@ public:
         context.connection_state= FindOrCreateConnectionState(connection_id);
 
         // All responses track which request they came from
-        PSMoveProtocol::Response *response= nullptr;
+        ResponsePtr response;
 
         switch (request->type())
         {
             // Controller Requests
             case PSMoveProtocol::Request_RequestType_GET_CONTROLLER_LIST:
-                response = new PSMoveProtocol::Response;
-                handle_request__get_controller_list(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__get_controller_list(context, response.get());
                 break;
             case PSMoveProtocol::Request_RequestType_START_CONTROLLER_DATA_STREAM:
-                response = new PSMoveProtocol::Response;
-                handle_request__start_controller_data_stream(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__start_controller_data_stream(context, response.get());
                 break;
             case PSMoveProtocol::Request_RequestType_STOP_CONTROLLER_DATA_STREAM:
-                response = new PSMoveProtocol::Response;
-                handle_request__stop_controller_data_stream(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__stop_controller_data_stream(context, response.get());
                 break;
             case PSMoveProtocol::Request_RequestType_RESET_ORIENTATION:
-                response = new PSMoveProtocol::Response;
-                handle_request__reset_orientation(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__reset_orientation(context, response.get());
                 break;
             case PSMoveProtocol::Request_RequestType_UNPAIR_CONTROLLER:
-                response = new PSMoveProtocol::Response;
-                handle_request__unpair_controller(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__unpair_controller(context, response.get());
                 break;
             case PSMoveProtocol::Request_RequestType_PAIR_CONTROLLER:
-                response = new PSMoveProtocol::Response;
-                handle_request__pair_controller(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__pair_controller(context, response.get());
                 break;
             case PSMoveProtocol::Request_RequestType_CANCEL_BLUETOOTH_REQUEST:
-                response = new PSMoveProtocol::Response;
-                handle_request__cancel_bluetooth_request(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__cancel_bluetooth_request(context, response.get());
                 break;
             case PSMoveProtocol::Request_RequestType_SET_LED_TRACKING_COLOR:
-                response = new PSMoveProtocol::Response;
-                handle_request__set_led_tracking_color(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__set_led_tracking_color(context, response.get());
                 break;
             case PSMoveProtocol::Request_RequestType_SET_CONTROLLER_MAGNETOMETER_CALIBRATION:
-                response = new PSMoveProtocol::Response;
-                handle_request__set_controller_magnetometer_calibration(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__set_controller_magnetometer_calibration(context, response.get());
                 break;
             case PSMoveProtocol::Request_RequestType_SET_CONTROLLER_ACCELEROMETER_CALIBRATION:
-                response = new PSMoveProtocol::Response;
-                handle_request__set_controller_accelerometer_calibration(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__set_controller_accelerometer_calibration(context, response.get());
                 break;
             case PSMoveProtocol::Request_RequestType_SET_CONTROLLER_GYROSCOPE_CALIBRATION:
-                response = new PSMoveProtocol::Response;
-                handle_request__set_controller_gyroscope_calibration(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__set_controller_gyroscope_calibration(context, response.get());
                 break;
             case PSMoveProtocol::Request_RequestType_SET_OPTICAL_NOISE_CALIBRATION:
-                response = new PSMoveProtocol::Response;
-                handle_request__set_optical_noise_calibration(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__set_optical_noise_calibration(context, response.get());
                 break;
             case PSMoveProtocol::Request_RequestType_SET_ORIENTATION_FILTER:
-                response = new PSMoveProtocol::Response;
-                handle_request__set_orientation_filter(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__set_orientation_filter(context, response.get());
                 break;
             case PSMoveProtocol::Request_RequestType_SET_POSITION_FILTER:
-                response = new PSMoveProtocol::Response;
-                handle_request__set_position_filter(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__set_position_filter(context, response.get());
                 break;
             case PSMoveProtocol::Request_RequestType_SET_CONTROLLER_PREDICTION_TIME:
-                response = new PSMoveProtocol::Response;
-                handle_request__set_controller_prediction_time(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__set_controller_prediction_time(context, response.get());
                 break;
             case PSMoveProtocol::Request_RequestType_SET_ATTACHED_CONTROLLER:
-                response = new PSMoveProtocol::Response;
-                handle_request__set_attached_controller(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__set_attached_controller(context, response.get());
                 break;
             case PSMoveProtocol::Request_RequestType_SET_GAMEPAD_INDEX:
-                response = new PSMoveProtocol::Response;
-                handle_request__set_gamepad_index(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__set_gamepad_index(context, response.get());
                 break;
             case PSMoveProtocol::Request_RequestType_SET_CONTROLLER_DATA_STREAM_TRACKER_INDEX:
-                response = new PSMoveProtocol::Response;
-                handle_request__set_controller_data_stream_tracker_index(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__set_controller_data_stream_tracker_index(context, response.get());
                 break;
 
             // Tracker Requests
             case PSMoveProtocol::Request_RequestType_GET_TRACKER_LIST:
-                response = new PSMoveProtocol::Response;
-                handle_request__get_tracker_list(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__get_tracker_list(context, response.get());
                 break;
             case PSMoveProtocol::Request_RequestType_START_TRACKER_DATA_STREAM:
-                response = new PSMoveProtocol::Response;
-                handle_request__start_tracker_data_stream(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__start_tracker_data_stream(context, response.get());
                 break;
             case PSMoveProtocol::Request_RequestType_STOP_TRACKER_DATA_STREAM:
-                response = new PSMoveProtocol::Response;
-                handle_request__stop_tracker_data_stream(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__stop_tracker_data_stream(context, response.get());
                 break;
             case PSMoveProtocol::Request_RequestType_GET_TRACKER_SETTINGS:
-                response = new PSMoveProtocol::Response;
-                handle_request__get_tracker_settings(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__get_tracker_settings(context, response.get());
                 break;
             case PSMoveProtocol::Request_RequestType_SET_TRACKER_FRAME_WIDTH:
-                response = new PSMoveProtocol::Response;
-                handle_request__set_tracker_frame_width(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__set_tracker_frame_width(context, response.get());
                 break;
             case PSMoveProtocol::Request_RequestType_SET_TRACKER_FRAME_HEIGHT:
-                response = new PSMoveProtocol::Response;
-                handle_request__set_tracker_frame_height(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__set_tracker_frame_height(context, response.get());
                 break;
             case PSMoveProtocol::Request_RequestType_SET_TRACKER_FRAME_RATE:
-                response = new PSMoveProtocol::Response;
-                handle_request__set_tracker_frame_rate(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__set_tracker_frame_rate(context, response.get());
                 break;
             case PSMoveProtocol::Request_RequestType_SET_TRACKER_EXPOSURE:
-                response = new PSMoveProtocol::Response;
-                handle_request__set_tracker_exposure(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__set_tracker_exposure(context, response.get());
                 break;
             case PSMoveProtocol::Request_RequestType_SET_TRACKER_GAIN:
-                response = new PSMoveProtocol::Response;
-                handle_request__set_tracker_gain(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__set_tracker_gain(context, response.get());
                 break;
             case PSMoveProtocol::Request_RequestType_SET_TRACKER_OPTION:
-                response = new PSMoveProtocol::Response;
-                handle_request__set_tracker_option(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__set_tracker_option(context, response.get());
                 break;
             case PSMoveProtocol::Request_RequestType_SET_TRACKER_COLOR_PRESET:
-                response = new PSMoveProtocol::Response;
-                handle_request__set_tracker_color_preset(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__set_tracker_color_preset(context, response.get());
                 break;
             case PSMoveProtocol::Request_RequestType_SET_TRACKER_POSE:
-                response = new PSMoveProtocol::Response;
-                handle_request__set_tracker_pose(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__set_tracker_pose(context, response.get());
                 break;
             case PSMoveProtocol::Request_RequestType_SET_TRACKER_INTRINSICS:
-                response = new PSMoveProtocol::Response;
-                handle_request__set_tracker_intrinsics(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__set_tracker_intrinsics(context, response.get());
                 break;
             case PSMoveProtocol::Request_RequestType_SAVE_TRACKER_PROFILE:
-                response = new PSMoveProtocol::Response;
-                handle_request__save_tracker_profile(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__save_tracker_profile(context, response.get());
                 break;
             case PSMoveProtocol::Request_RequestType_RELOAD_TRACKER_SETTINGS:
-                response = new PSMoveProtocol::Response;
-                handle_request__reload_tracker_settings(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__reload_tracker_settings(context, response.get());
                 break;
             case PSMoveProtocol::Request_RequestType_APPLY_TRACKER_PROFILE:
-                response = new PSMoveProtocol::Response;
-                handle_request__apply_tracker_profile(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__apply_tracker_profile(context, response.get());
                 break;
             case PSMoveProtocol::Request_RequestType_SEARCH_FOR_NEW_TRACKERS:
-                response = new PSMoveProtocol::Response;
-                handle_request__search_for_new_trackers(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__search_for_new_trackers(context, response.get());
                 break;
             case PSMoveProtocol::Request_RequestType_GET_TRACKING_SPACE_SETTINGS:
-                response = new PSMoveProtocol::Response;
-                handle_request__get_tracking_space_settings(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__get_tracking_space_settings(context, response.get());
                 break;
 
             // HMD Requests
             case PSMoveProtocol::Request_RequestType_GET_HMD_LIST:
-                response = new PSMoveProtocol::Response;
-                handle_request__get_hmd_list(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__get_hmd_list(context, response.get());
                 break;
             case PSMoveProtocol::Request_RequestType_START_HMD_DATA_STREAM:
-                response = new PSMoveProtocol::Response;
-                handle_request__start_hmd_data_stream(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__start_hmd_data_stream(context, response.get());
                 break;
             case PSMoveProtocol::Request_RequestType_STOP_HMD_DATA_STREAM:
-                response = new PSMoveProtocol::Response;
-                handle_request__stop_hmd_data_stream(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__stop_hmd_data_stream(context, response.get());
                 break;
             case PSMoveProtocol::Request_RequestType_SET_HMD_LED_TRACKING_COLOR:
-                response = new PSMoveProtocol::Response;
-                handle_request__set_hmd_led_tracking_color(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__set_hmd_led_tracking_color(context, response.get());
                 break;
             case PSMoveProtocol::Request_RequestType_SET_HMD_ACCELEROMETER_CALIBRATION:
-                response = new PSMoveProtocol::Response;
-                handle_request__set_hmd_accelerometer_calibration(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__set_hmd_accelerometer_calibration(context, response.get());
                 break;
             case PSMoveProtocol::Request_RequestType_SET_HMD_GYROSCOPE_CALIBRATION:
-                response = new PSMoveProtocol::Response;
-                handle_request__set_hmd_gyroscope_calibration(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__set_hmd_gyroscope_calibration(context, response.get());
                 break;
             case PSMoveProtocol::Request_RequestType_SET_HMD_ORIENTATION_FILTER:
-                response = new PSMoveProtocol::Response;
-                handle_request__set_hmd_orientation_filter(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__set_hmd_orientation_filter(context, response.get());
                 break;
             case PSMoveProtocol::Request_RequestType_SET_HMD_POSITION_FILTER:
-                response = new PSMoveProtocol::Response;
-                handle_request__set_hmd_position_filter(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__set_hmd_position_filter(context, response.get());
                 break;
             case PSMoveProtocol::Request_RequestType_SET_HMD_PREDICTION_TIME:
-                response = new PSMoveProtocol::Response;
-                handle_request__set_hmd_prediction_time(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__set_hmd_prediction_time(context, response.get());
                 break;
             case PSMoveProtocol::Request_RequestType_SET_HMD_DATA_STREAM_TRACKER_INDEX:
-                response = new PSMoveProtocol::Response;
-                handle_request__set_hmd_data_stream_tracker_index(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__set_hmd_data_stream_tracker_index(context, response.get());
                 break;
 
             // General Service Requests
             case PSMoveProtocol::Request_RequestType_GET_SERVICE_VERSION:
-                response = new PSMoveProtocol::Response;
-                handle_request__get_service_version(context, response);
+                response = m_response_pool.acquireMessage();
+                handle_request__get_service_version(context, response.get());
+                break;
+            case PSMoveProtocol::Request_RequestType_GET_SERVICE_TIME:
+                response = ServerRequestHandler::handle_service_time_request(request);
+                break;
+            case PSMoveProtocol::Request_RequestType_GET_PERFORMANCE_STATS:
+                response = m_response_pool.acquireMessage();
+                handle_request__get_performance_stats(context, response.get());
+                break;
+            case PSMoveProtocol::Request_RequestType_SET_TRACING_ENABLED:
+                response = ServerRequestHandler::handle_trace_request(request);
                 break;
 
             default:
                 assert(0 && "Whoops, bad request!");
         }
 
-        if (response != nullptr)
+        if (response)
         {
             response->set_request_id(request->request_id());
         }
 
-        return ResponsePtr(response);
+        return response;
     }
 
     void handle_input_data_frame(DeviceInputDataFramePtr data_frame)
@@ -499,6 +524,7 @@ public:
          ServerRequestHandler::t_generate_controller_data_frame_for_stream callback)
     {
         int controller_id= controller_view->getDeviceID();
+        const StreamPublishScheduler::t_timestamp now= std::chrono::high_resolution_clock::now();
 
         // Notify any connections that care about the controller update
         for (t_connection_state_iter iter= m_connection_state_map.begin(); iter != m_connection_state_map.end(); ++iter)
@@ -508,11 +534,17 @@ public:
 
             if (connection_state->active_controller_streams.test(controller_id))
             {
-                const ControllerStreamInfo &streamInfo=
+                ControllerStreamInfo &streamInfo=
                     connection_state->active_controller_stream_info[controller_id];
 
+                // Skip this update if the connection asked for a lower publish rate
+                if (!streamInfo.publish_scheduler.shouldPublish(now))
+                {
+                    continue;
+                }
+
                 // Fill out a data frame specific to this stream using the given callback
-                DeviceOutputDataFramePtr data_frame(new PSMoveProtocol::DeviceOutputDataFrame);
+                DeviceOutputDataFramePtr data_frame= m_data_frame_pool.acquireMessage();
                 callback(controller_view, &streamInfo, data_frame.get());
 
                 // Send the controller data frame over the network
@@ -526,6 +558,7 @@ public:
             ServerRequestHandler::t_generate_tracker_data_frame_for_stream callback)
     {
         int tracker_id = tracker_view->getDeviceID();
+        const StreamPublishScheduler::t_timestamp now = std::chrono::high_resolution_clock::now();
 
         // Notify any connections that care about the tracker update
         for (t_connection_state_iter iter = m_connection_state_map.begin(); iter != m_connection_state_map.end(); ++iter)
@@ -535,11 +568,17 @@ public:
 
             if (connection_state->active_tracker_streams.test(tracker_id))
             {
-                const TrackerStreamInfo &streamInfo =
+                TrackerStreamInfo &streamInfo =
                     connection_state->active_tracker_stream_info[tracker_id];
 
+                // Skip this update if the connection asked for a lower publish rate
+                if (!streamInfo.publish_scheduler.shouldPublish(now))
+                {
+                    continue;
+                }
+
                 // Fill out a data frame specific to this stream using the given callback
-                DeviceOutputDataFramePtr data_frame(new PSMoveProtocol::DeviceOutputDataFrame);
+                DeviceOutputDataFramePtr data_frame= m_data_frame_pool.acquireMessage();
                 callback(tracker_view, &streamInfo, data_frame);
 
                 // Send the tracker data frame over the network
@@ -553,6 +592,7 @@ public:
         ServerRequestHandler::t_generate_hmd_data_frame_for_stream callback)
     {
         int hmd_id = hmd_view->getDeviceID();
+        const StreamPublishScheduler::t_timestamp now = std::chrono::high_resolution_clock::now();
 
         // Notify any connections that care about the tracker update
         for (t_connection_state_iter iter = m_connection_state_map.begin(); iter != m_connection_state_map.end(); ++iter)
@@ -562,11 +602,17 @@ public:
 
             if (connection_state->active_hmd_streams.test(hmd_id))
             {
-                const HMDStreamInfo &streamInfo =
+                HMDStreamInfo &streamInfo =
                     connection_state->active_hmd_stream_info[hmd_id];
 
+                // Skip this update if the connection asked for a lower publish rate
+                if (!streamInfo.publish_scheduler.shouldPublish(now))
+                {
+                    continue;
+                }
+
                 // Fill out a data frame specific to this stream using the given callback
-                DeviceOutputDataFramePtr data_frame(new PSMoveProtocol::DeviceOutputDataFrame);
+                DeviceOutputDataFramePtr data_frame= m_data_frame_pool.acquireMessage();
                 callback(hmd_view, &streamInfo, data_frame);
 
                 // Send the hmd data frame over the network
@@ -794,6 +840,7 @@ protected:
                 streamInfo.include_calibrated_sensor_data = request.include_calibrated_sensor_data();
                 streamInfo.include_raw_tracker_data = request.include_raw_tracker_data();
                 streamInfo.disable_roi = request.disable_roi();
+                streamInfo.publish_scheduler.setMaxPublishRate(request.max_publish_rate_hz());
 
                 SERVER_LOG_INFO("ServerRequestHandler") << "Start controller(" << controller_id << ") stream ("
                     << "pos=" << streamInfo.include_position_data
@@ -802,6 +849,7 @@ protected:
                     << ",cal_sens=" << streamInfo.include_calibrated_sensor_data
                     << ",trkr=" << streamInfo.include_raw_tracker_data
                     << ",roi=" << streamInfo.disable_roi
+                    << ",max_hz=" << streamInfo.publish_scheduler.max_publish_rate_hz
                     << ")";
 
                 if (streamInfo.include_position_data)
@@ -1719,6 +1767,9 @@ protected:
                 case CommonControllerState::PS3EYE:
                     tracker_info->set_tracker_type(PSMoveProtocol::PS3EYE);
                     break;
+                case CommonControllerState::VirtualTracker:
+                    tracker_info->set_tracker_type(PSMoveProtocol::VIRTUAL_TRACKER);
+                    break;
                 default:
                     assert(0 && "Unhandled tracker type");
                 }
@@ -1738,6 +1789,9 @@ protected:
                 case ITrackerInterface::Generic_Webcam:
                     tracker_info->set_tracker_driver(PSMoveProtocol::GENERIC_WEBCAM);
                     break;
+                case ITrackerInterface::Virtual:
+                    tracker_info->set_tracker_driver(PSMoveProtocol::VIRTUAL);
+                    break;
                 default:
                     assert(0 && "Unhandled tracker type");
                 }
@@ -1826,6 +1880,7 @@ protected:
 
                 // Set control flags for the stream
                 streamInfo.streaming_video_data = true;
+                streamInfo.publish_scheduler.setMaxPublishRate(request.max_publish_rate_hz());
 
                 // Increment the number of stream listeners
                 tracker_view->startSharedMemoryVideoStream();
@@ -2632,6 +2687,7 @@ protected:
                 streamInfo.include_calibrated_sensor_data = request.include_calibrated_sensor_data();
                 streamInfo.include_raw_tracker_data = request.include_raw_tracker_data();
                 streamInfo.disable_roi = request.disable_roi();
+                streamInfo.publish_scheduler.setMaxPublishRate(request.max_publish_rate_hz());
 
                 SERVER_LOG_INFO("ServerRequestHandler") << "Start hmd(" << hmd_id << ") stream ("
                     << "pos=" << streamInfo.include_position_data
@@ -2640,6 +2696,7 @@ protected:
                     << ",cal_sens=" << streamInfo.include_calibrated_sensor_data
                     << ",trkr=" << streamInfo.include_raw_tracker_data
                     << ",roi=" << streamInfo.disable_roi
+                    << ",max_hz=" << streamInfo.publish_scheduler.max_publish_rate_hz
                     << ")";
 
                 if (streamInfo.disable_roi)
@@ -2797,6 +2854,7 @@ protected:
 
             // Reset the orientation filter state the calibration changed
             poseFilter->resetState();
+            ServerMetrics::increment_counter(ServerMetric_HMDFilterResets, hmd_id);
 
             response->set_result_code(PSMoveProtocol::Response_ResultCode_RESULT_OK);
         }
@@ -2828,6 +2886,7 @@ protected:
 
             // Reset the orientation filter state the calibration changed
             HMDView->getPoseFilterMutable()->resetState();
+            ServerMetrics::increment_counter(ServerMetric_HMDFilterResets, hmd_id);
 
             response->set_result_code(PSMoveProtocol::Response_ResultCode_RESULT_OK);
         }
@@ -3016,6 +3075,23 @@ protected:
         response->set_result_code(PSMoveProtocol::Response_ResultCode_RESULT_OK);
     }
 
+    void handle_request__get_performance_stats(
+        const RequestContext &context,
+        PSMoveProtocol::Response *response)
+    {
+        response->set_type(PSMoveProtocol::Response_ResponseType_PERFORMANCE_STATS);
+
+        // The stage timers run on this (the device) thread, so the histograms can be read directly
+        ServerPerformanceStats::fill_performance_stats(response->mutable_result_performance_stats());
+
+        if (context.request->request_get_performance_stats().reset_stats())
+        {
+            ServerPerformanceStats::reset();
+        }
+
+        response->set_result_code(PSMoveProtocol::Response_ResultCode_RESULT_OK);
+    }
+
     // -- Data Frame Updates -----
     void handle_data_frame__controller_packet(
         RequestConnectionStatePtr connection_state,
@@ -3124,9 +3200,33 @@ protected:
         }
     }
 
+public:
+    void log_message_pool_stats() const
+    {
+        log_pool_stats("data frame", m_data_frame_pool);
+        log_pool_stats("response", m_response_pool);
+    }
+
+protected:
+    template <class t_message_type>
+    static void log_pool_stats(const char *pool_name, const ServerMessagePool<t_message_type> &pool)
+    {
+        const ServerMessagePoolStats &stats= pool.getStats();
+
+        SERVER_LOG_INFO("ServerRequestHandler") << "Message pool (" << pool_name << "): "
+            << stats.acquire_count << " acquired, "
+            << stats.getHeapAllocationCount() << " heap allocations ("
+            << stats.pool_alloc_count << " pool growth, "
+            << stats.overflow_count << " overflow, "
+            << stats.arena_spill_count << " arena spill), "
+            << pool.getPooledCount() << " pooled";
+    }
+
 private:
     DeviceManager &m_device_manager;
     t_connection_state_map m_connection_state_map;
+    ServerMessagePool<PSMoveProtocol::DeviceOutputDataFrame> m_data_frame_pool;
+    ServerMessagePool<PSMoveProtocol::Response> m_response_pool;
 };
 
 //-- public interface -----
@@ -3166,9 +3266,113 @@ void ServerRequestHandler::update()
 
 void ServerRequestHandler::shutdown()
 {
+    m_implementation_ptr->log_message_pool_stats();
     m_instance= NULL;
 }
 
+bool ServerRequestHandler::is_read_only_request(const RequestPtr &request)
+{
+    bool is_read_only= false;
+
+    switch (request->type())
+    {
+    case PSMoveProtocol::Request_RequestType_GET_CONTROLLER_LIST:
+    case PSMoveProtocol::Request_RequestType_GET_TRACKER_LIST:
+    case PSMoveProtocol::Request_RequestType_GET_TRACKER_SETTINGS:
+    case PSMoveProtocol::Request_RequestType_GET_TRACKING_SPACE_SETTINGS:
+    case PSMoveProtocol::Request_RequestType_GET_HMD_LIST:
+    case PSMoveProtocol::Request_RequestType_GET_SERVICE_VERSION:
+        is_read_only= true;
+        break;
+    default:
+        break;
+    }
+
+    return is_read_only;
+}
+
+ResponsePtr ServerRequestHandler::handle_service_time_request(const RequestPtr &request)
+{
+    ResponsePtr response(new PSMoveProtocol::Response);
+
+    response->set_type(PSMoveProtocol::Response_ResponseType_SERVICE_TIME);
+    response->set_request_id(request->request_id());
+    response->set_result_code(PSMoveProtocol::Response_ResultCode_RESULT_OK);
+
+    // Same clock as the data frame latency timestamps
+    response->mutable_result_service_time()->set_service_time_usec(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+
+    return response;
+}
+
+ResponsePtr ServerRequestHandler::handle_trace_request(const RequestPtr &request)
+{
+    ResponsePtr response(new PSMoveProtocol::Response);
+    const bool bEnabled= request->request_set_tracing_enabled().enabled();
+
+    response->set_request_id(request->request_id());
+
+    ServerTrace::set_enabled(bEnabled);
+    SERVER_LOG_INFO("ServerRequestHandler") << "Service timeline tracing " << (bEnabled ? "enabled" : "disabled");
+
+    response->set_type(PSMoveProtocol::Response_ResponseType_GENERAL_RESULT);
+    response->set_result_code(PSMoveProtocol::Response_ResultCode_RESULT_OK);
+
+    return response;
+}
+
+static void handle_trace_dump_finished(
+    int request_id,
+    ServerRequestHandler::t_trace_dump_response_callback callback,
+    bool bSuccess,
+    const std::string &filename,
+    int event_count)
+{
+    ResponsePtr response(new PSMoveProtocol::Response);
+
+    response->set_request_id(request_id);
+    response->set_type(PSMoveProtocol::Response_ResponseType_TRACE_DUMP);
+
+    if (bSuccess)
+    {
+        SERVER_LOG_INFO("ServerRequestHandler") << "Wrote " << event_count << " trace events to " << filename;
+
+        response->mutable_result_trace_dump()->set_filename(filename);
+        response->mutable_result_trace_dump()->set_event_count(event_count);
+        response->set_result_code(PSMoveProtocol::Response_ResultCode_RESULT_OK);
+    }
+    else
+    {
+        SERVER_LOG_ERROR("ServerRequestHandler") << "Failed to write the trace to " << filename;
+
+        response->set_result_code(PSMoveProtocol::Response_ResultCode_RESULT_ERROR);
+    }
+
+    callback(response);
+}
+
+void ServerRequestHandler::handle_trace_dump_request(const RequestPtr &request, const t_trace_dump_response_callback &callback)
+{
+    const bool bStarted= ServerTrace::start_dump(
+        std::bind(&handle_trace_dump_finished, request->request_id(), callback,
+            std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+
+    if (!bStarted)
+    {
+        ResponsePtr response(new PSMoveProtocol::Response);
+
+        SERVER_LOG_WARNING("ServerRequestHandler") << "Ignoring trace dump request, the previous dump is still being written";
+
+        response->set_request_id(request->request_id());
+        response->set_type(PSMoveProtocol::Response_ResponseType_TRACE_DUMP);
+        response->set_result_code(PSMoveProtocol::Response_ResultCode_RESULT_ERROR);
+
+        callback(response);
+    }
+}
+
 ResponsePtr ServerRequestHandler::handle_request(int connection_id, RequestPtr request)
 {
     return m_implementation_ptr->handle_request(connection_id, request);
@@ -3,6 +3,8 @@
 
 // -- includes -----
 #include "PSMoveProtocolInterface.h"
+#include <chrono>
+#include <functional>
 
 // -- pre-declarations -----
 class DeviceManager;
@@ -12,6 +14,73 @@ namespace boost {
 }};
 
 // -- definitions -----
+/// Decimates the data frames published on a single stream down to the stream's max publish rate.
+/// Sends are scheduled on a fixed cadence (next_publish_time advances by whole periods)
+/// rather than "one period since the last send", so the delivered rate doesn't drift low
+/// when device updates don't line up with the requested period.
+struct StreamPublishScheduler
+{
+    typedef std::chrono::time_point<std::chrono::high_resolution_clock> t_timestamp;
+
+    float max_publish_rate_hz;
+    std::chrono::duration<double> publish_period;
+    t_timestamp next_publish_time;
+    bool has_published;
+
+    inline void Clear()
+    {
+        max_publish_rate_hz = 0.f;
+        publish_period = std::chrono::duration<double>::zero();
+        next_publish_time = t_timestamp();
+        has_published = false;
+    }
+
+    inline void setMaxPublishRate(float rate_hz)
+    {
+        max_publish_rate_hz = (rate_hz > 0.f) ? rate_hz : 0.f;
+        publish_period = 
+            (max_publish_rate_hz > 0.f)
+            ? std::chrono::duration<double>(1.0 / static_cast<double>(max_publish_rate_hz))
+            : std::chrono::duration<double>::zero();
+        has_published = false;
+    }
+
+    /// Returns true if a data frame should be sent at the given time.
+    /// Advances the schedule when it does.
+    inline bool shouldPublish(const t_timestamp &now)
+    {
+        if (max_publish_rate_hz <= 0.f)
+        {
+            // Unthrottled stream
+            return true;
+        }
+
+        if (!has_published)
+        {
+            // First frame on the stream always goes out and starts the cadence
+            next_publish_time = now + std::chrono::duration_cast<t_timestamp::duration>(publish_period);
+            has_published = true;
+            return true;
+        }
+
+        if (now < next_publish_time)
+        {
+            return false;
+        }
+
+        // Stay aligned to the cadence ...
+        next_publish_time += std::chrono::duration_cast<t_timestamp::duration>(publish_period);
+
+        // ... unless we fell more than a whole period behind (device stalled), then re-anchor
+        if (next_publish_time <= now)
+        {
+            next_publish_time = now + std::chrono::duration_cast<t_timestamp::duration>(publish_period);
+        }
+
+        return true;
+    }
+};
+
 struct ControllerStreamInfo
 {
     bool include_position_data;
@@ -23,6 +92,7 @@ struct ControllerStreamInfo
 	bool disable_roi;
     int last_data_input_sequence_number;
     int selected_tracker_index;
+    StreamPublishScheduler publish_scheduler;
 
     inline void Clear()
     {
@@ -35,6 +105,7 @@ struct ControllerStreamInfo
 		disable_roi = false;
 		last_data_input_sequence_number = -1;
         selected_tracker_index = 0;
+        publish_scheduler.Clear();
     }
 };
 
@@ -42,11 +113,13 @@ struct TrackerStreamInfo
 {
     bool streaming_video_data;
 	bool has_temp_settings_override;
+    StreamPublishScheduler publish_scheduler;
 
     inline void Clear()
     {
         streaming_video_data = false;
 		has_temp_settings_override = false;
+        publish_scheduler.Clear();
     }
 };
 
@@ -59,6 +132,7 @@ struct HMDStreamInfo
 	bool include_raw_tracker_data;
 	bool disable_roi;
     int selected_tracker_index;
+    StreamPublishScheduler publish_scheduler;
 
     inline void Clear()
     {
@@ -69,6 +143,7 @@ struct HMDStreamInfo
 		include_raw_tracker_data = false;
 		disable_roi = false;
         selected_tracker_index = 0;
+        publish_scheduler.Clear();
     }
 };
 
@@ -86,6 +161,25 @@ public:
     void update();
     void shutdown();
 
+    /// True for queries that don't change any service state and don't depend on the connection.
+    /// Their responses may be answered from a snapshot by the network manager.
+    static bool is_read_only_request(const RequestPtr &request);
+
+    /// Answers a GET_SERVICE_TIME clock sync request.
+    /// The network manager calls this straight from the network thread so the answer isn't delayed by the device thread.
+    static ResponsePtr handle_service_time_request(const RequestPtr &request);
+
+    /// Answers a SET_TRACING_ENABLED request.
+    /// It doesn't touch device state, so the network manager answers it from the network thread.
+    static ResponsePtr handle_trace_request(const RequestPtr &request);
+
+    typedef std::function<void(ResponsePtr response)> t_trace_dump_response_callback;
+
+    /// Starts writing the trace out for a DUMP_TRACE request on the trace dump thread, so neither the
+    /// network thread nor the device thread waits on it. The callback gets the response on the dump thread,
+    /// or right away when an earlier dump is still being written.
+    static void handle_trace_dump_request(const RequestPtr &request, const t_trace_dump_response_callback &callback);
+
     ResponsePtr handle_request(int connection_id, RequestPtr request);
     void handle_input_data_frame(DeviceInputDataFramePtr data_frame);
     void handle_client_connection_stopped(int connection_id);
@@ -0,0 +1,157 @@
+#ifndef SERVER_SCOPE_H
+#define SERVER_SCOPE_H
+
+//-- includes -----
+#include "ServerAllocationTracker.h"
+#include "ServerPerformanceStats.h"
+#include "ServerTrace.h"
+
+#include <chrono>
+
+//-- macros -----
+// Instrumented scopes of the service update loop.
+// One RAII scope reads one clock (steady_clock) and feeds every sink it was given:
+//   SERVER_TRACE_SCOPE(name) records the rest of the enclosing scope as one timeline event (\ref ServerTrace).
+//   SERVER_TRACE_SCOPE_ID(name, device_id) also tags the event with a device id.
+//   SERVER_STAGE_SCOPE(name, stage, device_category, device_id) records the timeline event
+//   and adds its duration to the stage histogram of the device (\ref ServerPerformanceStats).
+//   SERVER_PHASE_SCOPE(name, allocation_phase) records the timeline event
+//   and counts the heap allocations made on the calling thread under the phase (\ref ServerAllocationTracker).
+// Building with PSM_ENABLE_TRACING undefined compiles the timeline events out,
+// building with PSM_ENABLE_STAGE_TIMERS undefined compiles the stage histograms out,
+// building with PSM_ENABLE_ALLOCATION_TRACKING undefined compiles the allocation phases out.
+// A scope left with no sink compiles out entirely (arguments included).
+#if defined(PSM_ENABLE_TRACING) || defined(PSM_ENABLE_STAGE_TIMERS) || defined(PSM_ENABLE_ALLOCATION_TRACKING)
+
+class ServerScope
+{
+public:
+    typedef std::chrono::steady_clock t_clock;
+
+    ServerScope(
+        const char *trace_name, int device_id, 
+        eServerStage stage, eServerStageDeviceCategory device_category,
+        eServerAllocationPhase allocation_phase)
+        : m_trace_name(trace_name)
+        , m_device_id(device_id)
+        , m_stage(stage)
+        , m_device_category(device_category)
+        , m_previous_allocation_phase(enter_allocation_phase(allocation_phase))
+        , m_bIsAllocationPhase(allocation_phase != ServerAllocationPhase_None)
+        , m_bIsTracing(get_is_tracing(trace_name))
+        , m_bIsTiming(get_is_timing(stage))
+        , m_start_time((m_bIsTracing || m_bIsTiming) ? t_clock::now() : t_clock::time_point())
+    {
+    }
+
+    ~ServerScope()
+    {
+        if (m_bIsTracing || m_bIsTiming)
+        {
+            const t_clock::time_point end_time= t_clock::now();
+
+#if defined(PSM_ENABLE_TRACING)
+            if (m_bIsTracing)
+            {
+                ServerTrace::record_scope(m_trace_name, m_device_id, to_usec(m_start_time), to_usec(end_time));
+            }
+#endif // PSM_ENABLE_TRACING
+
+#if defined(PSM_ENABLE_STAGE_TIMERS)
+            if (m_bIsTiming)
+            {
+                ServerPerformanceStats::record_stage_sample(
+                    m_stage, m_device_category, m_device_id,
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - m_start_time).count());
+            }
+#endif // PSM_ENABLE_STAGE_TIMERS
+        }
+
+#if defined(PSM_ENABLE_ALLOCATION_TRACKING)
+        if (m_bIsAllocationPhase)
+        {
+            ServerAllocationTracker::set_current_phase(m_previous_allocation_phase);
+        }
+#endif // PSM_ENABLE_ALLOCATION_TRACKING
+    }
+
+private:
+    // Returns the phase the scope has to restore (ServerAllocationPhase_None when it didn't change it)
+    static eServerAllocationPhase enter_allocation_phase(eServerAllocationPhase allocation_phase)
+    {
+#if defined(PSM_ENABLE_ALLOCATION_TRACKING)
+        if (allocation_phase != ServerAllocationPhase_None)
+        {
+            return ServerAllocationTracker::set_current_phase(allocation_phase);
+        }
+#endif // PSM_ENABLE_ALLOCATION_TRACKING
+
+        return ServerAllocationPhase_None;
+    }
+
+    static bool get_is_tracing(const char *trace_name)
+    {
+#if defined(PSM_ENABLE_TRACING)
+        return trace_name != nullptr && ServerTrace::get_enabled();
+#else
+        return false;
+#endif // PSM_ENABLE_TRACING
+    }
+
+    static bool get_is_timing(eServerStage stage)
+    {
+#if defined(PSM_ENABLE_STAGE_TIMERS)
+        return stage != ServerStage_None;
+#else
+        return false;
+#endif // PSM_ENABLE_STAGE_TIMERS
+    }
+
+    // Same time base as ServerTrace::get_time_usec()
+    static long long to_usec(const t_clock::time_point &time)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count();
+    }
+
+    const char *m_trace_name;
+    int m_device_id;
+    eServerStage m_stage;
+    eServerStageDeviceCategory m_device_category;
+    eServerAllocationPhase m_previous_allocation_phase;
+    bool m_bIsAllocationPhase;
+    bool m_bIsTracing;
+    bool m_bIsTiming;
+    t_clock::time_point m_start_time;
+};
+
+#define SERVER_SCOPE_CONCAT_INNER(a, b) a ## b
+#define SERVER_SCOPE_CONCAT(a, b) SERVER_SCOPE_CONCAT_INNER(a, b)
+#define SERVER_SCOPE(name, device_id, stage, device_category, allocation_phase) \
+    ServerScope SERVER_SCOPE_CONCAT(server_scope_, __LINE__)(name, device_id, stage, device_category, allocation_phase)
+
+#define SERVER_STAGE_SCOPE(name, stage, device_category, device_id) \
+    SERVER_SCOPE(name, device_id, stage, device_category, ServerAllocationPhase_None)
+#define SERVER_PHASE_SCOPE(name, allocation_phase) \
+    SERVER_SCOPE(name, -1, ServerStage_None, ServerStageDevice_System, allocation_phase)
+
+#else
+
+#define SERVER_STAGE_SCOPE(name, stage, device_category, device_id)
+#define SERVER_PHASE_SCOPE(name, allocation_phase)
+
+#endif // PSM_ENABLE_TRACING || PSM_ENABLE_STAGE_TIMERS || PSM_ENABLE_ALLOCATION_TRACKING
+
+#if defined(PSM_ENABLE_TRACING)
+
+#define SERVER_TRACE_SCOPE_ID(name, device_id) \
+    SERVER_SCOPE(name, device_id, ServerStage_None, ServerStageDevice_System, ServerAllocationPhase_None)
+#define SERVER_TRACE_SCOPE(name) SERVER_TRACE_SCOPE_ID(name, -1)
+
+#else
+
+#define SERVER_TRACE_SCOPE_ID(name, device_id)
+#define SERVER_TRACE_SCOPE(name)
+
+#endif // PSM_ENABLE_TRACING
+
+#endif // SERVER_SCOPE_H
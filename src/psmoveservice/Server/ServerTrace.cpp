@@ -0,0 +1,258 @@
+//-- includes -----
+#include "ServerTrace.h"
+#include "PSMoveConfig.h"
+#include "ServerLog.h"
+#include "ServerUtility.h"
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+#ifdef _MSC_VER
+#define TRACE_THREAD_LOCAL __declspec(thread)
+#else
+#define TRACE_THREAD_LOCAL __thread
+#endif
+
+//-- constants -----
+// Must be a power of two.
+// A tick records a few dozen scopes, so this covers several seconds of a 1kHz update loop.
+static const unsigned long long k_trace_event_capacity = 1 << 18;
+
+static const int k_max_trace_thread_count = 32;
+
+//-- definitions -----
+struct TraceEvent
+{
+    // Index of the event plus one once the event is fully written, zero while it is being written
+    std::atomic<unsigned long long> sequence;
+
+    const char *name;
+    int device_id;
+    int thread_id;
+    long long start_usec;
+    long long end_usec;
+};
+
+//-- globals -----
+static TraceEvent g_trace_events[k_trace_event_capacity];
+static std::atomic<unsigned long long> g_next_trace_event_index(0);
+static std::atomic_bool g_trace_enabled(false);
+
+static std::atomic<int> g_next_trace_thread_id(0);
+static std::atomic<const char *> g_trace_thread_names[k_max_trace_thread_count];
+
+// One past the calling thread's id, zero until the thread records its first event
+static TRACE_THREAD_LOCAL int t_trace_thread_id_plus_one = 0;
+
+// Only one dump is written at a time, a finished dump thread is joined by the next start_dump() or wait_for_dump()
+static std::mutex g_dump_thread_mutex;
+static std::thread g_dump_thread;
+static std::atomic_bool g_dump_in_progress(false);
+static std::atomic<int> g_dump_count(0);
+
+//-- private functions -----
+static int get_current_trace_thread_id()
+{
+    if (t_trace_thread_id_plus_one == 0)
+    {
+        t_trace_thread_id_plus_one = ++g_next_trace_thread_id;
+    }
+
+    return t_trace_thread_id_plus_one - 1;
+}
+
+// Never reuses a name while the service runs, so an earlier dump can't be overwritten
+static std::string make_dump_filename()
+{
+    const std::time_t now = std::time(nullptr);
+    std::tm local_time;
+    char timestamp[32];
+
+    // Runs on the dump thread, so stay off std::localtime()'s buffer shared with the logger
+#ifdef _MSC_VER
+    localtime_s(&local_time, &now);
+#else
+    localtime_r(&now, &local_time);
+#endif
+    std::strftime(timestamp, sizeof(timestamp), "%Y%m%d_%H%M%S", &local_time);
+
+    boost::filesystem::path filename(PSMoveConfig::getConfigDirectory());
+    filename /= SERVER_TRACE_DIRECTORY_NAME;
+    boost::filesystem::create_directories(filename);
+    filename /= std::string(SERVER_TRACE_FILENAME_PREFIX) + timestamp + "_" + std::to_string(++g_dump_count) + ".json";
+
+    return filename.string();
+}
+
+static void dump_thread_func(ServerTrace::t_dump_callback callback)
+{
+    ServerUtility::set_current_thread_name("Trace Dump Thread");
+
+    std::string filename;
+    int event_count = 0;
+    bool bSuccess = false;
+
+    try
+    {
+        filename = make_dump_filename();
+
+        std::ofstream file(filename, std::ofstream::out | std::ofstream::trunc);
+        if (file.is_open())
+        {
+            event_count = ServerTrace::write_chrome_trace(file);
+            bSuccess = file.good();
+        }
+    }
+    catch (const boost::filesystem::filesystem_error &e)
+    {
+        SERVER_LOG_ERROR("ServerTrace") << "Failed to create the trace directory: " << e.what();
+    }
+
+    callback(bSuccess, filename, event_count);
+
+    g_dump_in_progress = false;
+}
+
+//-- public interface -----
+namespace ServerTrace
+{
+    void set_enabled(bool bEnabled)
+    {
+        g_trace_enabled = bEnabled;
+    }
+
+    bool get_enabled()
+    {
+        return g_trace_enabled.load(std::memory_order_relaxed);
+    }
+
+    void set_current_thread_name(const char *thread_name)
+    {
+        const int thread_id = get_current_trace_thread_id();
+
+        if (thread_id < k_max_trace_thread_count)
+        {
+            g_trace_thread_names[thread_id] = thread_name;
+        }
+    }
+
+    long long get_time_usec()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void record_scope(const char *name, int device_id, long long start_usec, long long end_usec)
+    {
+        const unsigned long long event_index = g_next_trace_event_index.fetch_add(1, std::memory_order_relaxed);
+        TraceEvent &event = g_trace_events[event_index & (k_trace_event_capacity - 1)];
+
+        event.sequence.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        event.name = name;
+        event.device_id = device_id;
+        event.thread_id = get_current_trace_thread_id();
+        event.start_usec = start_usec;
+        event.end_usec = end_usec;
+
+        event.sequence.store(event_index + 1, std::memory_order_release);
+    }
+
+    int write_chrome_trace(std::ostream &out)
+    {
+        int event_count = 0;
+
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+        // Thread names
+        const int thread_count = std::min(g_next_trace_thread_id.load(), k_max_trace_thread_count);
+        for (int thread_id = 0; thread_id < thread_count; ++thread_id)
+        {
+            const char *thread_name = g_trace_thread_names[thread_id].load();
+
+            out << (thread_id > 0 ? ",\n" : "\n");
+            out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread_id
+                << ",\"args\":{\"name\":\"" << (thread_name != nullptr ? thread_name : "Thread") << "\"}}";
+        }
+
+        // Scopes, oldest first.
+        // The ring keeps getting written while this runs, so skip any event that changed under us.
+        const unsigned long long end_index = g_next_trace_event_index.load();
+        const unsigned long long start_index = (end_index > k_trace_event_capacity) ? end_index - k_trace_event_capacity : 0;
+
+        for (unsigned long long event_index = start_index; event_index < end_index; ++event_index)
+        {
+            const TraceEvent &event = g_trace_events[event_index & (k_trace_event_capacity - 1)];
+
+            if (event.sequence.load(std::memory_order_acquire) != event_index + 1)
+            {
+                continue;
+            }
+
+            const char *name = event.name;
+            const int device_id = event.device_id;
+            const int thread_id = event.thread_id;
+            const long long start_usec = event.start_usec;
+            const long long end_usec = event.end_usec;
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (event.sequence.load(std::memory_order_relaxed) != event_index + 1)
+            {
+                continue;
+            }
+
+            out << ((thread_count + event_count) > 0 ? ",\n" : "\n");
+            out << "{\"name\":\"" << name << "\",\"cat\":\"psmoveservice\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread_id
+                << ",\"ts\":" << start_usec << ",\"dur\":" << (end_usec - start_usec);
+            if (device_id >= 0)
+            {
+                out << ",\"args\":{\"device_id\":" << device_id << "}";
+            }
+            out << "}";
+
+            ++event_count;
+        }
+
+        out << "\n]}\n";
+
+        return event_count;
+    }
+
+    bool start_dump(const t_dump_callback &callback)
+    {
+        std::lock_guard<std::mutex> lock(g_dump_thread_mutex);
+
+        if (g_dump_in_progress)
+        {
+            return false;
+        }
+
+        if (g_dump_thread.joinable())
+        {
+            g_dump_thread.join();
+        }
+
+        g_dump_in_progress = true;
+        g_dump_thread = std::thread(dump_thread_func, callback);
+
+        return true;
+    }
+
+    void wait_for_dump()
+    {
+        std::lock_guard<std::mutex> lock(g_dump_thread_mutex);
+
+        if (g_dump_thread.joinable())
+        {
+            g_dump_thread.join();
+        }
+    }
+};
@@ -0,0 +1,57 @@
+#ifndef SERVER_TRACE_H
+#define SERVER_TRACE_H
+
+//-- includes -----
+#include <functional>
+#include <ostream>
+#include <string>
+
+//-- constants -----
+// Trace dumps go in this sub directory of the config directory, each under a new name
+#define SERVER_TRACE_DIRECTORY_NAME "traces"
+#define SERVER_TRACE_FILENAME_PREFIX "psmoveservice_trace_"
+
+//-- interface -----
+/// Timeline of the update loop and the worker threads, dumped as Chrome trace JSON
+/// (load it in chrome://tracing or ui.perfetto.dev).
+/// Finished scopes go into a fixed size ring that any thread writes to without locking,
+/// so a dump holds the last few seconds of activity before it.
+namespace ServerTrace
+{
+    /// Turns recording on or off. Off by default, a trace scope then only costs a flag check.
+    void set_enabled(bool bEnabled);
+    bool get_enabled();
+
+    /// Names the calling thread in the timeline (thread_name must outlive the service, e.g. a string literal)
+    void set_current_thread_name(const char *thread_name);
+
+    /// Microseconds on the clock the scopes are recorded with
+    long long get_time_usec();
+
+    /// Adds a finished scope to the ring (name must be a string literal, only the pointer is kept)
+    void record_scope(const char *name, int device_id, long long start_usec, long long end_usec);
+
+    /// Writes the events in the ring as Chrome trace JSON, returns how many were written
+    int write_chrome_trace(std::ostream &out);
+
+    /// Called on the dump thread once a dump finishes, with the file it went to
+    typedef std::function<void(bool bSuccess, const std::string &filename, int event_count)> t_dump_callback;
+
+    /// Writes the events in the ring to a new file in the trace directory on a worker thread.
+    /// Returns false (and never calls back) when an earlier dump is still being written.
+    bool start_dump(const t_dump_callback &callback);
+
+    /// Blocks until the dump in progress, if any, has called back
+    void wait_for_dump();
+};
+
+//-- macros -----
+// The timeline scopes themselves are SERVER_TRACE_SCOPE / SERVER_TRACE_SCOPE_ID in ServerScope.h.
+// Building with PSM_ENABLE_TRACING undefined compiles the thread names out as well.
+#if defined(PSM_ENABLE_TRACING)
+#define SERVER_TRACE_THREAD_NAME(thread_name) ServerTrace::set_current_thread_name(thread_name)
+#else
+#define SERVER_TRACE_THREAD_NAME(thread_name)
+#endif // PSM_ENABLE_TRACING
+
+#endif // SERVER_TRACE_H
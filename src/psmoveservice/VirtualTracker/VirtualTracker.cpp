@@ -0,0 +1,1317 @@
+// -- includes -----
+#include "VirtualTracker.h"
+#include "MathGLM.h"
+#include "ServerLog.h"
+#include "ServerUtility.h"
+#include "PSMoveProtocol.pb.h"
+#include "TrackerDeviceEnumerator.h"
+#include "opencv2/opencv.hpp"
+#include <glm/gtc/quaternion.hpp>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+
+// -- constants -----
+#define VIRTUAL_TRACKER_STATE_BUFFER_MAX 16
+
+// Points used for the outline of a projected sphere
+#define VIRTUAL_TRACKER_SPHERE_OUTLINE_POINTS 24
+
+// Sub-pixel precision used when filling the projected outlines
+#define VIRTUAL_TRACKER_FILL_SHIFT_BITS 4
+
+// The light sizes match the tracking shapes the PSMove, DS4 and Morpheus report
+#define VIRTUAL_TRACKER_BULB_RADIUS 2.25f // cm
+#define VIRTUAL_TRACKER_LIGHTBAR_WIDTH 5.2f // cm
+#define VIRTUAL_TRACKER_LIGHTBAR_HEIGHT 1.1f // cm
+#define VIRTUAL_TRACKER_LED_RADIUS 0.5f // cm
+#define VIRTUAL_TRACKER_LED_COUNT 9
+
+static const float k_morpheus_led_positions[VIRTUAL_TRACKER_LED_COUNT][3] = {
+    { 0.f, 0.f, 0.f },
+    { 8.f, 4.5f, -2.5f },
+    { 9.f, 0.f, -10.f },
+    { 8.f, -4.5f, -2.5f },
+    { -8.f, 4.5f, -2.5f },
+    { -9.f, 0.f, -10.f },
+    { -8.f, -4.5f, -2.5f },
+    { 6.f, -1.f, -24.f },
+    { -6.f, -1.f, -24.f },
+};
+
+static const char *k_shape_names[VirtualTrackerSceneObject::MAX_SHAPES] = {
+    "sphere",
+    "lightbar",
+    "led_cluster"
+};
+
+static const char *k_motion_names[VirtualTrackerSceneObject::MAX_MOTIONS] = {
+    "static",
+    "orbit",
+    "trajectory"
+};
+
+// -- private definitions -----
+struct VirtualTrackerKeyframe
+{
+    double time;
+    glm::vec3 position;
+    glm::quat orientation;
+};
+
+class VirtualTrackerScene
+{
+public:
+    VirtualTrackerScene()
+        : frame()
+        , lights()
+        , exposure()
+        , glow()
+        , noise()
+        , trajectories()
+        , next_frame_time()
+        , ground_truth_stream()
+        , rng(0x5053)
+    {
+    }
+
+    cv::Mat frame; // CV_8UC3, what the tracker hands out
+    cv::Mat lights; // CV_8UC3, lights rendered at one instant
+    cv::Mat exposure; // CV_32FC3, lights accumulated while the shutter is open
+    cv::Mat glow;
+    cv::Mat noise;
+    std::vector< std::vector<VirtualTrackerKeyframe> > trajectories; // One per scene object
+    std::chrono::time_point<std::chrono::steady_clock> next_frame_time;
+    std::ofstream ground_truth_stream;
+    cv::RNG rng;
+};
+
+// -- private methods -----
+static VirtualTrackerSceneObject::eShape parse_shape(const std::string &name);
+static VirtualTrackerSceneObject::eMotion parse_motion(const std::string &name);
+static bool load_trajectory(const std::string &filename, std::vector<VirtualTrackerKeyframe> &out_keyframes);
+static void compute_object_pose(
+    const VirtualTrackerSceneObject &object, const std::vector<VirtualTrackerKeyframe> &trajectory, double time,
+    glm::vec3 &out_position, glm::quat &out_orientation);
+static cv::Scalar compute_light_color(const CommonHSVColorRange &preset);
+static void compute_intrinsic_matrix(const VirtualTrackerConfig &cfg, cv::Matx33f &out_intrinsics, cv::Matx<float, 5, 1> &out_distortion);
+static bool project_outline(const VirtualTrackerConfig &cfg, const std::vector<cv::Point3f> &tracker_points, std::vector<cv::Point> &out_outline);
+static void render_sphere(const VirtualTrackerConfig &cfg, const glm::vec3 &tracker_center, float radius, const cv::Scalar &color, cv::Mat &target);
+static void render_lightbar(const VirtualTrackerConfig &cfg, const glm::mat4 &tracker_xform, const cv::Scalar &color, cv::Mat &target);
+static void render_led_cluster(const VirtualTrackerConfig &cfg, const glm::mat4 &tracker_xform, const cv::Scalar &color, cv::Mat &target);
+
+// -- public methods
+// -- Virtual Tracker Scene Object
+void VirtualTrackerSceneObject::clear()
+{
+    shape = VirtualTrackerSceneObject::Sphere;
+    tracking_color_id = eCommonTrackingColorID::Magenta;
+    motion = VirtualTrackerSceneObject::Orbit;
+    center.set(0.f, 0.f, 100.f);
+    orbit_radius = 20.f;
+    orbit_period = 4.f;
+    swing_degrees = 0.f;
+    trajectory_filename.clear();
+}
+
+// -- Virtual Tracker Config
+const int VirtualTrackerConfig::CONFIG_VERSION = 1;
+
+VirtualTrackerConfig::VirtualTrackerConfig(const std::string &fnamebase)
+    : PSMoveConfig(fnamebase)
+    , is_valid(false)
+    , max_poll_failure_count(100)
+	, frame_width(640)
+	, frame_height(480)
+	, frame_rate(40)
+    , exposure(32)
+    , gain(32)
+    , focalLengthX(554.2563) // pixels
+    , focalLengthY(554.2563) // pixels
+    , principalX(320.0) // pixels
+    , principalY(240.0) // pixels
+    , hfov(60.0) // degrees
+    , vfov(45.0) // degrees
+    , zNear(10.0) // cm
+    , zFar(200.0) // cm
+    , distortionK1(0.0)
+    , distortionK2(0.0)
+    , distortionK3(0.0)
+    , distortionP1(0.0)
+    , distortionP2(0.0)
+    , real_time_frames(true)
+    , noise_stddev(2.0)
+    , background_level(16.0)
+    , motion_blur_samples(4)
+    , glow_radius(3.0)
+    , glow_strength(0.5)
+    , ground_truth_filename()
+{
+    pose.clear();
+
+	SharedColorPresets.table_name.clear();
+    for (int preset_index = 0; preset_index < eCommonTrackingColorID::MAX_TRACKING_COLOR_TYPES; ++preset_index)
+    {
+        SharedColorPresets.color_presets[preset_index] = k_default_color_presets[preset_index];
+    }
+
+    // A single PSMove bulb circling in front of the tracker
+    VirtualTrackerSceneObject object;
+    object.clear();
+    scene_objects.push_back(object);
+};
+
+const boost::property_tree::ptree
+VirtualTrackerConfig::config2ptree()
+{
+    boost::property_tree::ptree pt;
+
+    pt.put("is_valid", is_valid);
+    pt.put("version", VirtualTrackerConfig::CONFIG_VERSION);
+    pt.put("max_poll_failure_count", max_poll_failure_count);
+	pt.put("frame_width", frame_width);
+	pt.put("frame_height", frame_height);
+	pt.put("frame_rate", frame_rate);
+    pt.put("exposure", exposure);
+	pt.put("gain", gain);
+    pt.put("focalLengthX", focalLengthX);
+    pt.put("focalLengthY", focalLengthY);
+    pt.put("principalX", principalX);
+    pt.put("principalY", principalY);
+    pt.put("hfov", hfov);
+    pt.put("vfov", vfov);
+    pt.put("zNear", zNear);
+    pt.put("zFar", zFar);
+    pt.put("distortionK1", distortionK1);
+    pt.put("distortionK2", distortionK2);
+    pt.put("distortionK3", distortionK3);
+    pt.put("distortionP1", distortionP1);
+    pt.put("distortionP2", distortionP2);
+
+    pt.put("pose.orientation.w", pose.Orientation.w);
+    pt.put("pose.orientation.x", pose.Orientation.x);
+    pt.put("pose.orientation.y", pose.Orientation.y);
+    pt.put("pose.orientation.z", pose.Orientation.z);
+    pt.put("pose.position.x", pose.PositionCm.x);
+    pt.put("pose.position.y", pose.PositionCm.y);
+    pt.put("pose.position.z", pose.PositionCm.z);
+
+    pt.put("render.real_time_frames", real_time_frames);
+    pt.put("render.noise_stddev", noise_stddev);
+    pt.put("render.background_level", background_level);
+    pt.put("render.motion_blur_samples", motion_blur_samples);
+    pt.put("render.glow_radius", glow_radius);
+    pt.put("render.glow_strength", glow_strength);
+    pt.put("render.ground_truth_filename", ground_truth_filename);
+
+    pt.put("scene.object_count", scene_objects.size());
+    for (size_t object_index = 0; object_index < scene_objects.size(); ++object_index)
+    {
+        const VirtualTrackerSceneObject &object = scene_objects[object_index];
+        boost::property_tree::ptree object_pt;
+
+        object_pt.put("shape", k_shape_names[object.shape]);
+        writeTrackingColor(object_pt, object.tracking_color_id);
+        object_pt.put("motion", k_motion_names[object.motion]);
+        object_pt.put("center.x", object.center.x);
+        object_pt.put("center.y", object.center.y);
+        object_pt.put("center.z", object.center.z);
+        object_pt.put("orbit_radius", object.orbit_radius);
+        object_pt.put("orbit_period", object.orbit_period);
+        object_pt.put("swing_degrees", object.swing_degrees);
+        object_pt.put("trajectory_filename", object.trajectory_filename);
+
+        pt.add_child("scene.object_" + std::to_string(object_index), object_pt);
+    }
+
+	writeColorPropertyPresetTable(&SharedColorPresets, pt);
+
+	for (auto &controller_preset_table : DeviceColorPresets)
+	{
+		writeColorPropertyPresetTable(&controller_preset_table, pt);
+	}
+
+    return pt;
+}
+
+void
+VirtualTrackerConfig::ptree2config(const boost::property_tree::ptree &pt)
+{
+    int config_version = pt.get<int>("version", 0);
+    if (config_version == VirtualTrackerConfig::CONFIG_VERSION)
+    {
+        is_valid = pt.get<bool>("is_valid", false);
+        max_poll_failure_count = pt.get<long>("max_poll_failure_count", 100);
+		frame_width = pt.get<double>("frame_width", 640);
+		frame_height = pt.get<double>("frame_height", 480);
+		frame_rate = pt.get<double>("frame_rate", 40);
+        exposure = pt.get<double>("exposure", 32);
+		gain = pt.get<double>("gain", 32);
+        focalLengthX = pt.get<double>("focalLengthX", focalLengthX);
+        focalLengthY = pt.get<double>("focalLengthY", focalLengthY);
+        principalX = pt.get<double>("principalX", principalX);
+        principalY = pt.get<double>("principalY", principalY);
+        hfov = pt.get<double>("hfov", 60.0);
+        vfov = pt.get<double>("vfov", 45.0);
+        zNear = pt.get<double>("zNear", 10.0);
+        zFar = pt.get<double>("zFar", 200.0);
+        distortionK1 = pt.get<double>("distortionK1", distortionK1);
+        distortionK2 = pt.get<double>("distortionK2", distortionK2);
+        distortionK3 = pt.get<double>("distortionK3", distortionK3);
+        distortionP1 = pt.get<double>("distortionP1", distortionP1);
+        distortionP2 = pt.get<double>("distortionP2", distortionP2);
+
+        pose.Orientation.w = pt.get<float>("pose.orientation.w", 1.0);
+        pose.Orientation.x = pt.get<float>("pose.orientation.x", 0.0);
+        pose.Orientation.y = pt.get<float>("pose.orientation.y", 0.0);
+        pose.Orientation.z = pt.get<float>("pose.orientation.z", 0.0);
+        pose.PositionCm.x = pt.get<float>("pose.position.x", 0.0);
+        pose.PositionCm.y = pt.get<float>("pose.position.y", 0.0);
+        pose.PositionCm.z = pt.get<float>("pose.position.z", 0.0);
+
+        real_time_frames = pt.get<bool>("render.real_time_frames", real_time_frames);
+        noise_stddev = pt.get<double>("render.noise_stddev", noise_stddev);
+        background_level = pt.get<double>("render.background_level", background_level);
+        motion_blur_samples = pt.get<int>("render.motion_blur_samples", motion_blur_samples);
+        glow_radius = pt.get<double>("render.glow_radius", glow_radius);
+        glow_strength = pt.get<double>("render.glow_strength", glow_strength);
+        ground_truth_filename = pt.get<std::string>("render.ground_truth_filename", ground_truth_filename);
+
+        const int object_count = pt.get<int>("scene.object_count", 0);
+        scene_objects.clear();
+        for (int object_index = 0; object_index < object_count; ++object_index)
+        {
+            const std::string object_path = "scene.object_" + std::to_string(object_index);
+            VirtualTrackerSceneObject object;
+            object.clear();
+
+            if (pt.get_child_optional(object_path))
+            {
+                const boost::property_tree::ptree &object_pt = pt.get_child(object_path);
+                const int tracking_color_id = readTrackingColor(object_pt);
+
+                object.shape = parse_shape(object_pt.get<std::string>("shape", k_shape_names[object.shape]));
+                object.tracking_color_id =
+                    (tracking_color_id != eCommonTrackingColorID::INVALID_COLOR)
+                    ? static_cast<eCommonTrackingColorID>(tracking_color_id)
+                    : object.tracking_color_id;
+                object.motion = parse_motion(object_pt.get<std::string>("motion", k_motion_names[object.motion]));
+                object.center.x = object_pt.get<float>("center.x", object.center.x);
+                object.center.y = object_pt.get<float>("center.y", object.center.y);
+                object.center.z = object_pt.get<float>("center.z", object.center.z);
+                object.orbit_radius = object_pt.get<float>("orbit_radius", object.orbit_radius);
+                object.orbit_period = object_pt.get<float>("orbit_period", object.orbit_period);
+                object.swing_degrees = object_pt.get<float>("swing_degrees", object.swing_degrees);
+                object.trajectory_filename = object_pt.get<std::string>("trajectory_filename", "");
+            }
+
+            scene_objects.push_back(object);
+        }
+
+		// Read the default preset table
+		readColorPropertyPresetTable(pt, &SharedColorPresets);
+
+		// Read all of the controller preset tables
+		const std::string controller_prefix("controller_");
+		const std::string hmd_prefix("hmd_");
+		for(auto iter = pt.begin(); iter != pt.end(); iter++)
+		{
+			const std::string &entry_name= iter->first;
+
+			if (entry_name.compare(0, controller_prefix.length(), controller_prefix) == 0 ||
+				entry_name.compare(0, hmd_prefix.length(), hmd_prefix) == 0)
+			{
+				CommonHSVColorRangeTable table;
+
+				table.table_name= entry_name;
+				for (int preset_index = 0; preset_index < eCommonTrackingColorID::MAX_TRACKING_COLOR_TYPES; ++preset_index)
+				{
+					table.color_presets[preset_index] = k_default_color_presets[preset_index];
+				}
+
+				readColorPropertyPresetTable(pt, &table);
+
+				DeviceColorPresets.push_back(table);
+			}
+		}
+    }
+    else
+    {
+        SERVER_LOG_WARNING("VirtualTrackerConfig") <<
+            "Config version " << config_version << " does not match expected version " <<
+            VirtualTrackerConfig::CONFIG_VERSION << ", Using defaults.";
+    }
+}
+
+const CommonHSVColorRangeTable *
+VirtualTrackerConfig::getColorRangeTable(const std::string &table_name) const
+{
+	const CommonHSVColorRangeTable *table= &SharedColorPresets;
+
+	if (table_name.length() > 0)
+	{
+		for (auto &entry : DeviceColorPresets)
+		{
+			if (entry.table_name == table_name)
+			{
+				table= &entry;
+			}
+		}
+	}
+
+	return table;
+}
+
+inline CommonHSVColorRangeTable *
+VirtualTrackerConfig::getOrAddColorRangeTable(const std::string &table_name)
+{
+	CommonHSVColorRangeTable *table= nullptr;
+
+	if (table_name.length() > 0)
+	{
+		for (auto &entry : DeviceColorPresets)
+		{
+			if (entry.table_name == table_name)
+			{
+				table= &entry;
+			}
+		}
+
+		if (table == nullptr)
+		{
+			CommonHSVColorRangeTable Table;
+
+			Table.table_name= table_name;
+			for (int preset_index = 0; preset_index < eCommonTrackingColorID::MAX_TRACKING_COLOR_TYPES; ++preset_index)
+			{
+				Table.color_presets[preset_index] = k_default_color_presets[preset_index];
+			}
+
+			DeviceColorPresets.push_back(Table);
+			table= &DeviceColorPresets[DeviceColorPresets.size() - 1];
+		}
+	}
+	else
+	{
+		table= &SharedColorPresets;
+	}
+
+	return table;
+}
+
+// -- Virtual Tracker
+VirtualTracker::VirtualTracker()
+    : cfg()
+    , DevicePath()
+    , Scene(nullptr)
+    , FrameIndex(0)
+    , GroundTruth()
+    , NextPollSequenceNumber(0)
+    , TrackerStates()
+{
+}
+
+VirtualTracker::~VirtualTracker()
+{
+    if (getIsOpen())
+    {
+        SERVER_LOG_ERROR("~VirtualTracker") << "Tracker deleted without calling close() first!";
+    }
+}
+
+bool VirtualTracker::open() // Opens the first virtual tracker
+{
+    TrackerDeviceEnumerator enumerator;
+    bool success = false;
+
+    // Skip over everything that isn't a virtual tracker
+    while (enumerator.is_valid() && enumerator.get_device_type() != CommonDeviceState::VirtualTracker)
+    {
+        enumerator.next();
+    }
+
+    if (enumerator.is_valid())
+    {
+        success = open(&enumerator);
+    }
+
+    return success;
+}
+
+bool VirtualTracker::matchesDeviceEnumerator(const DeviceEnumerator *enumerator) const
+{
+    bool matches = false;
+
+    if (enumerator->get_device_type() == CommonDeviceState::VirtualTracker)
+    {
+        std::string enumerator_path = enumerator->get_path();
+
+        matches = (enumerator_path == DevicePath);
+    }
+
+    return matches;
+}
+
+bool VirtualTracker::open(const DeviceEnumerator *enumerator)
+{
+    const char *cur_dev_path = enumerator->get_path();
+    bool bSuccess = false;
+
+    if (getIsOpen())
+    {
+        SERVER_LOG_WARNING("VirtualTracker::open") << "VirtualTracker(" << cur_dev_path << ") already open. Ignoring request.";
+        bSuccess = true;
+    }
+    else
+    {
+        SERVER_LOG_INFO("VirtualTracker::open") << "Opening VirtualTracker(" << cur_dev_path << ")";
+
+        DevicePath = cur_dev_path;
+
+        std::string config_name = "VirtualTrackerConfig_";
+        config_name.append(DevicePath);
+
+        cfg = VirtualTrackerConfig(config_name);
+
+		// Load the virtual tracker config
+        cfg.load();
+		// Save the config back out again in case defaults changed
+		cfg.save();
+
+        Scene = new VirtualTrackerScene;
+        FrameIndex = 0;
+        NextPollSequenceNumber = 0;
+        rebuildScene();
+
+        bSuccess = true;
+    }
+
+    return bSuccess;
+}
+
+bool VirtualTracker::getIsOpen() const
+{
+    return Scene != nullptr;
+}
+
+bool VirtualTracker::getIsReadyToPoll() const
+{
+    return getIsOpen();
+}
+
+IDeviceInterface::ePollResult VirtualTracker::poll()
+{
+    IDeviceInterface::ePollResult result = IDeviceInterface::_PollResultFailure;
+
+    if (getIsOpen())
+    {
+        const std::chrono::time_point<std::chrono::steady_clock> now = std::chrono::steady_clock::now();
+
+        if (cfg.real_time_frames && now < Scene->next_frame_time)
+        {
+            // The next frame isn't due yet
+            return IDeviceInterface::_PollResultSuccessNoData;
+        }
+
+        const double frame_rate = std::max(cfg.frame_rate, 1.0);
+        const double frame_time = static_cast<double>(FrameIndex) / frame_rate;
+        const double shutter_time = (std::min(std::max(cfg.exposure, 0.0), 255.0) / 255.0) / frame_rate;
+        const int blur_samples = std::max(cfg.motion_blur_samples, 1);
+
+        // Longer exposures and higher gains make the lights brighter, the defaults (32, 32) are unscaled
+        const double brightness = (cfg.exposure / 32.0) * ((cfg.gain + 32.0) / 64.0);
+
+        const int width = static_cast<int>(cfg.frame_width);
+        const int height = static_cast<int>(cfg.frame_height);
+        Scene->frame.create(height, width, CV_8UC3);
+        Scene->lights.create(height, width, CV_8UC3);
+        Scene->exposure.create(height, width, CV_32FC3);
+        Scene->exposure.setTo(cv::Scalar::all(0));
+
+        // World space to tracker space
+        const CommonDeviceQuaternion &tracker_quat = cfg.pose.Orientation;
+        const CommonDevicePosition &tracker_pos = cfg.pose.PositionCm;
+        const glm::mat4 world_to_tracker =
+            glm::inverse(
+                glm_mat4_from_pose(
+                    glm::quat(tracker_quat.w, tracker_quat.x, tracker_quat.y, tracker_quat.z),
+                    glm::vec3(tracker_pos.x, tracker_pos.y, tracker_pos.z)));
+
+        // Average renders spread across the time the shutter was open
+        for (int sample_index = 0; sample_index < blur_samples; ++sample_index)
+        {
+            const double sample_time =
+                (blur_samples > 1)
+                ? frame_time - shutter_time + shutter_time * static_cast<double>(sample_index) / static_cast<double>(blur_samples - 1)
+                : frame_time;
+
+            Scene->lights.setTo(cv::Scalar::all(0));
+
+            for (size_t object_index = 0; object_index < cfg.scene_objects.size(); ++object_index)
+            {
+                const VirtualTrackerSceneObject &object = cfg.scene_objects[object_index];
+                const cv::Scalar color = compute_light_color(cfg.SharedColorPresets.color_presets[object.tracking_color_id]);
+
+                glm::vec3 position;
+                glm::quat orientation;
+                compute_object_pose(object, Scene->trajectories[object_index], sample_time, position, orientation);
+
+                const glm::mat4 tracker_xform = world_to_tracker * glm_mat4_from_pose(orientation, position);
+
+                switch (object.shape)
+                {
+                case VirtualTrackerSceneObject::Sphere:
+                    render_sphere(cfg, glm::vec3(tracker_xform[3]), VIRTUAL_TRACKER_BULB_RADIUS, color, Scene->lights);
+                    break;
+                case VirtualTrackerSceneObject::LightBar:
+                    render_lightbar(cfg, tracker_xform, color, Scene->lights);
+                    break;
+                case VirtualTrackerSceneObject::LEDCluster:
+                    render_led_cluster(cfg, tracker_xform, color, Scene->lights);
+                    break;
+                default:
+                    break;
+                }
+            }
+
+            cv::accumulate(Scene->lights, Scene->exposure);
+        }
+
+        Scene->exposure *= brightness / static_cast<double>(blur_samples);
+
+        if (cfg.glow_radius > 0.0 && cfg.glow_strength > 0.0)
+        {
+            cv::GaussianBlur(Scene->exposure, Scene->glow, cv::Size(0, 0), cfg.glow_radius);
+            cv::scaleAdd(Scene->glow, cfg.glow_strength, Scene->exposure, Scene->exposure);
+        }
+
+        Scene->exposure += cv::Scalar::all(cfg.background_level);
+
+        if (cfg.noise_stddev > 0.0)
+        {
+            Scene->noise.create(height, width, CV_32FC3);
+            Scene->rng.fill(Scene->noise, cv::RNG::NORMAL, cv::Scalar::all(0.0), cv::Scalar::all(cfg.noise_stddev));
+            Scene->exposure += Scene->noise;
+        }
+
+        // Saturates at 0 and 255 like the sensor would
+        Scene->exposure.convertTo(Scene->frame, CV_8UC3);
+
+        // Record where everything was at the end of the exposure
+        cv::Matx33f camera_matrix;
+        cv::Matx<float, 5, 1> distortions;
+        compute_intrinsic_matrix(cfg, camera_matrix, distortions);
+
+        GroundTruth.resize(cfg.scene_objects.size());
+        for (size_t object_index = 0; object_index < cfg.scene_objects.size(); ++object_index)
+        {
+            VirtualTrackerGroundTruth &truth = GroundTruth[object_index];
+
+            glm::vec3 position;
+            glm::quat orientation;
+            compute_object_pose(cfg.scene_objects[object_index], Scene->trajectories[object_index], frame_time, position, orientation);
+
+            const glm::vec4 tracker_position = world_to_tracker * glm::vec4(position, 1.f);
+
+            truth.object_index = static_cast<int>(object_index);
+            truth.world_pose.PositionCm.set(position.x, position.y, position.z);
+            truth.world_pose.Orientation.w = orientation.w;
+            truth.world_pose.Orientation.x = orientation.x;
+            truth.world_pose.Orientation.y = orientation.y;
+            truth.world_pose.Orientation.z = orientation.z;
+            truth.tracker_position.set(tracker_position.x, tracker_position.y, tracker_position.z);
+            truth.screen_location.clear();
+            truth.bIsVisible = false;
+
+            if (tracker_position.z > cfg.zNear && tracker_position.z < cfg.zFar)
+            {
+                const std::vector<cv::Point3f> object_points(1, cv::Point3f(tracker_position.x, tracker_position.y, tracker_position.z));
+                std::vector<cv::Point2f> image_points;
+
+                cv::projectPoints(object_points, cv::Vec3d(0, 0, 0), cv::Vec3d(0, 0, 0), camera_matrix, distortions, image_points);
+
+                truth.screen_location.set(image_points[0].x, image_points[0].y);
+                truth.bIsVisible =
+                    image_points[0].x >= 0.f && image_points[0].x < static_cast<float>(width) &&
+                    image_points[0].y >= 0.f && image_points[0].y < static_cast<float>(height);
+            }
+
+            if (Scene->ground_truth_stream.is_open())
+            {
+                Scene->ground_truth_stream
+                    << FrameIndex << "," << frame_time << "," << object_index << ","
+                    << position.x << "," << position.y << "," << position.z << ","
+                    << orientation.w << "," << orientation.x << "," << orientation.y << "," << orientation.z << ","
+                    << tracker_position.x << "," << tracker_position.y << "," << tracker_position.z << ","
+                    << truth.screen_location.x << "," << truth.screen_location.y << ","
+                    << (truth.bIsVisible ? 1 : 0) << "\n";
+            }
+        }
+
+        ++FrameIndex;
+
+        // Schedule the next frame, catching up rather than bursting if we fell behind
+        const std::chrono::microseconds frame_period(static_cast<long long>(1000000.0 / frame_rate));
+        Scene->next_frame_time = std::max(Scene->next_frame_time + frame_period, now);
+
+        {
+            VirtualTrackerState newState;
+
+            // Increment the sequence for every new polling packet
+            newState.PollSequenceNumber = NextPollSequenceNumber;
+            ++NextPollSequenceNumber;
+
+            // Make room for new entry if at the max queue size
+            if (TrackerStates.size() >= VIRTUAL_TRACKER_STATE_BUFFER_MAX)
+            {
+                TrackerStates.erase(TrackerStates.begin(), TrackerStates.begin() + TrackerStates.size() - VIRTUAL_TRACKER_STATE_BUFFER_MAX);
+            }
+
+            TrackerStates.push_back(newState);
+        }
+
+        result = IDeviceInterface::_PollResultSuccessNewData;
+    }
+
+    return result;
+}
+
+void VirtualTracker::close()
+{
+    if (Scene != nullptr)
+    {
+        delete Scene;
+        Scene = nullptr;
+    }
+
+    GroundTruth.clear();
+}
+
+long VirtualTracker::getMaxPollFailureCount() const
+{
+    return cfg.max_poll_failure_count;
+}
+
+CommonDeviceState::eDeviceType VirtualTracker::getDeviceType() const
+{
+    return CommonDeviceState::VirtualTracker;
+}
+
+const CommonDeviceState *VirtualTracker::getState(int lookBack) const
+{
+    const int queueSize = static_cast<int>(TrackerStates.size());
+    const CommonDeviceState * result =
+        (lookBack < queueSize) ? &TrackerStates.at(queueSize - lookBack - 1) : nullptr;
+
+    return result;
+}
+
+ITrackerInterface::eDriverType VirtualTracker::getDriverType() const
+{
+    return ITrackerInterface::Virtual;
+}
+
+std::string VirtualTracker::getUSBDevicePath() const
+{
+    return DevicePath;
+}
+
+bool VirtualTracker::getVideoFrameDimensions(
+    int *out_width,
+    int *out_height,
+    int *out_stride) const
+{
+    const int width = static_cast<int>(cfg.frame_width);
+
+    if (out_width != nullptr)
+    {
+        *out_width = width;
+    }
+
+    if (out_height != nullptr)
+    {
+        *out_height = static_cast<int>(cfg.frame_height);
+    }
+
+    if (out_stride != nullptr)
+    {
+        // Rendered as tightly packed BGR
+        *out_stride = 3 * width;
+    }
+
+    return true;
+}
+
+const unsigned char *VirtualTracker::getVideoFrameBuffer() const
+{
+    const unsigned char *result = nullptr;
+
+    if (Scene != nullptr && !Scene->frame.empty())
+    {
+        result = static_cast<const unsigned char *>(Scene->frame.data);
+    }
+
+    return result;
+}
+
+void VirtualTracker::loadSettings()
+{
+    cfg.load();
+
+    if (getIsOpen())
+    {
+        rebuildScene();
+    }
+}
+
+void VirtualTracker::saveSettings()
+{
+    cfg.save();
+}
+
+void VirtualTracker::setFrameWidth(double value, bool bUpdateConfig)
+{
+    // Keep the 4:3 aspect ratio of the PS3Eye modes
+    cfg.frame_width = value;
+    cfg.frame_height = value * 3.0 / 4.0;
+
+	if (bUpdateConfig)
+	{
+		cfg.save();
+	}
+}
+
+double VirtualTracker::getFrameWidth() const
+{
+	return cfg.frame_width;
+}
+
+void VirtualTracker::setFrameHeight(double value, bool bUpdateConfig)
+{
+    cfg.frame_height = value;
+
+	if (bUpdateConfig)
+	{
+		cfg.save();
+	}
+}
+
+double VirtualTracker::getFrameHeight() const
+{
+	return cfg.frame_height;
+}
+
+void VirtualTracker::setFrameRate(double value, bool bUpdateConfig)
+{
+    cfg.frame_rate = value;
+
+	if (bUpdateConfig)
+	{
+		cfg.save();
+	}
+}
+
+double VirtualTracker::getFrameRate() const
+{
+	return cfg.frame_rate;
+}
+
+void VirtualTracker::setExposure(double value, bool bUpdateConfig)
+{
+    cfg.exposure = value;
+
+	if (bUpdateConfig)
+	{
+		cfg.save();
+	}
+}
+
+double VirtualTracker::getExposure() const
+{
+    return cfg.exposure;
+}
+
+void VirtualTracker::setGain(double value, bool bUpdateConfig)
+{
+    cfg.gain = value;
+
+	if (bUpdateConfig)
+	{
+		cfg.save();
+	}
+}
+
+double VirtualTracker::getGain() const
+{
+	return cfg.gain;
+}
+
+void VirtualTracker::getCameraIntrinsics(
+    float &outFocalLengthX, float &outFocalLengthY,
+    float &outPrincipalX, float &outPrincipalY,
+    float &outDistortionK1, float &outDistortionK2, float &outDistortionK3,
+    float &outDistortionP1, float &outDistortionP2) const
+{
+    outFocalLengthX = static_cast<float>(cfg.focalLengthX);
+    outFocalLengthY = static_cast<float>(cfg.focalLengthY);
+    outPrincipalX = static_cast<float>(cfg.principalX);
+    outPrincipalY = static_cast<float>(cfg.principalY);
+    outDistortionK1 = static_cast<float>(cfg.distortionK1);
+    outDistortionK2 = static_cast<float>(cfg.distortionK2);
+    outDistortionK3 = static_cast<float>(cfg.distortionK3);
+    outDistortionP1 = static_cast<float>(cfg.distortionP1);
+    outDistortionP2 = static_cast<float>(cfg.distortionP2);
+}
+
+void VirtualTracker::setCameraIntrinsics(
+    float focalLengthX, float focalLengthY,
+    float principalX, float principalY,
+    float distortionK1, float distortionK2, float distortionK3,
+    float distortionP1, float distortionP2)
+{
+    cfg.focalLengthX = focalLengthX;
+    cfg.focalLengthY = focalLengthY;
+    cfg.principalX = principalX;
+    cfg.principalY = principalY;
+    cfg.distortionK1 = distortionK1;
+    cfg.distortionK2 = distortionK2;
+    cfg.distortionK3 = distortionK3;
+    cfg.distortionP1 = distortionP1;
+    cfg.distortionP2 = distortionP2;
+}
+
+CommonDevicePose VirtualTracker::getTrackerPose() const
+{
+    return cfg.pose;
+}
+
+void VirtualTracker::setTrackerPose(
+    const struct CommonDevicePose *pose)
+{
+    cfg.pose = *pose;
+    cfg.save();
+}
+
+void VirtualTracker::getFOV(float &outHFOV, float &outVFOV) const
+{
+    outHFOV = static_cast<float>(cfg.hfov);
+    outVFOV = static_cast<float>(cfg.vfov);
+}
+
+void VirtualTracker::getZRange(float &outZNear, float &outZFar) const
+{
+    outZNear = static_cast<float>(cfg.zNear);
+    outZFar = static_cast<float>(cfg.zFar);
+}
+
+void VirtualTracker::gatherTrackerOptions(
+    PSMoveProtocol::Response_ResultTrackerSettings* settings) const
+{
+    // No driver specific options
+}
+
+bool VirtualTracker::setOptionIndex(
+    const std::string &option_name,
+    int option_index)
+{
+    return false;
+}
+
+bool VirtualTracker::getOptionIndex(
+    const std::string &option_name,
+    int &out_option_index) const
+{
+    return false;
+}
+
+void VirtualTracker::gatherTrackingColorPresets(
+	const std::string &controller_serial,
+    PSMoveProtocol::Response_ResultTrackerSettings* settings) const
+{
+	const CommonHSVColorRangeTable *table= cfg.getColorRangeTable(controller_serial);
+
+    for (int list_index = 0; list_index < MAX_TRACKING_COLOR_TYPES; ++list_index)
+    {
+        const CommonHSVColorRange &hsvRange = table->color_presets[list_index];
+        const eCommonTrackingColorID colorType = static_cast<eCommonTrackingColorID>(list_index);
+
+        PSMoveProtocol::TrackingColorPreset *colorPreset= settings->add_color_presets();
+        colorPreset->set_color_type(static_cast<PSMoveProtocol::TrackingColorType>(colorType));
+        colorPreset->set_hue_center(hsvRange.hue_range.center);
+        colorPreset->set_hue_range(hsvRange.hue_range.range);
+        colorPreset->set_saturation_center(hsvRange.saturation_range.center);
+        colorPreset->set_saturation_range(hsvRange.saturation_range.range);
+        colorPreset->set_value_center(hsvRange.value_range.center);
+        colorPreset->set_value_range(hsvRange.value_range.range);
+    }
+}
+
+void VirtualTracker::setTrackingColorPreset(
+	const std::string &controller_serial,
+    eCommonTrackingColorID color,
+    const CommonHSVColorRange *preset)
+{
+	CommonHSVColorRangeTable *table= cfg.getOrAddColorRangeTable(controller_serial);
+
+    table->color_presets[color] = *preset;
+    cfg.save();
+}
+
+void VirtualTracker::getTrackingColorPreset(
+	const std::string &controller_serial,
+    eCommonTrackingColorID color,
+    CommonHSVColorRange *out_preset) const
+{
+	const CommonHSVColorRangeTable *table= cfg.getColorRangeTable(controller_serial);
+
+    *out_preset = table->color_presets[color];
+}
+
+void VirtualTracker::rebuildScene()
+{
+    Scene->trajectories.clear();
+    Scene->trajectories.resize(cfg.scene_objects.size());
+
+    for (size_t object_index = 0; object_index < cfg.scene_objects.size(); ++object_index)
+    {
+        VirtualTrackerSceneObject &object = cfg.scene_objects[object_index];
+
+        if (object.motion == VirtualTrackerSceneObject::Trajectory &&
+            !load_trajectory(object.trajectory_filename, Scene->trajectories[object_index]))
+        {
+            SERVER_LOG_WARNING("VirtualTracker::rebuildScene") <<
+                "Scene object " << object_index << " of " << DevicePath << " has no usable trajectory, holding it at its center";
+            object.motion = VirtualTrackerSceneObject::Static;
+        }
+    }
+
+    if (Scene->ground_truth_stream.is_open())
+    {
+        Scene->ground_truth_stream.close();
+    }
+
+    if (!cfg.ground_truth_filename.empty())
+    {
+        Scene->ground_truth_stream.open(cfg.ground_truth_filename.c_str(), std::ios::out | std::ios::trunc);
+
+        if (Scene->ground_truth_stream.is_open())
+        {
+            Scene->ground_truth_stream <<
+                "frame,time,object,world_x,world_y,world_z,world_qw,world_qx,world_qy,world_qz,"
+                "tracker_x,tracker_y,tracker_z,screen_x,screen_y,visible\n";
+        }
+        else
+        {
+            SERVER_LOG_ERROR("VirtualTracker::rebuildScene") << "Failed to open ground truth file " << cfg.ground_truth_filename;
+        }
+    }
+}
+
+// -- private methods -----
+static VirtualTrackerSceneObject::eShape parse_shape(const std::string &name)
+{
+    for (int shape_index = 0; shape_index < VirtualTrackerSceneObject::MAX_SHAPES; ++shape_index)
+    {
+        if (name == k_shape_names[shape_index])
+        {
+            return static_cast<VirtualTrackerSceneObject::eShape>(shape_index);
+        }
+    }
+
+    SERVER_LOG_WARNING("VirtualTrackerConfig") << "Unknown scene object shape '" << name << "', using a sphere";
+    return VirtualTrackerSceneObject::Sphere;
+}
+
+static VirtualTrackerSceneObject::eMotion parse_motion(const std::string &name)
+{
+    for (int motion_index = 0; motion_index < VirtualTrackerSceneObject::MAX_MOTIONS; ++motion_index)
+    {
+        if (name == k_motion_names[motion_index])
+        {
+            return static_cast<VirtualTrackerSceneObject::eMotion>(motion_index);
+        }
+    }
+
+    SERVER_LOG_WARNING("VirtualTrackerConfig") << "Unknown scene object motion '" << name << "', holding it still";
+    return VirtualTrackerSceneObject::Static;
+}
+
+// Reads "time_seconds, x, y, z, qw, qx, qy, qz" keyframes, one per line, in increasing time.
+// Positions are in cm, blank lines and lines starting with '#' are skipped.
+static bool load_trajectory(const std::string &filename, std::vector<VirtualTrackerKeyframe> &out_keyframes)
+{
+    std::ifstream file(filename.c_str());
+
+    out_keyframes.clear();
+
+    if (!file.is_open())
+    {
+        SERVER_LOG_ERROR("VirtualTracker") << "Failed to open trajectory file '" << filename << "'";
+        return false;
+    }
+
+    std::string line;
+    int line_number = 0;
+    while (std::getline(file, line))
+    {
+        ++line_number;
+
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+
+        std::replace(line.begin(), line.end(), ',', ' ');
+
+        std::istringstream line_stream(line);
+        VirtualTrackerKeyframe keyframe;
+        if (!(line_stream >> keyframe.time
+                >> keyframe.position.x >> keyframe.position.y >> keyframe.position.z
+                >> keyframe.orientation.w >> keyframe.orientation.x >> keyframe.orientation.y >> keyframe.orientation.z))
+        {
+            SERVER_LOG_WARNING("VirtualTracker") << filename << "(" << line_number << "): Skipping malformed keyframe";
+            continue;
+        }
+
+        if (!out_keyframes.empty() && keyframe.time <= out_keyframes.back().time)
+        {
+            SERVER_LOG_WARNING("VirtualTracker") << filename << "(" << line_number << "): Skipping keyframe that goes back in time";
+            continue;
+        }
+
+        keyframe.orientation = glm::normalize(keyframe.orientation);
+        out_keyframes.push_back(keyframe);
+    }
+
+    return !out_keyframes.empty();
+}
+
+static void compute_object_pose(
+    const VirtualTrackerSceneObject &object,
+    const std::vector<VirtualTrackerKeyframe> &trajectory,
+    double time,
+    glm::vec3 &out_position,
+    glm::quat &out_orientation)
+{
+    const glm::vec3 center(object.center.x, object.center.y, object.center.z);
+
+    switch (object.motion)
+    {
+    case VirtualTrackerSceneObject::Orbit:
+        {
+            const double period = std::max(static_cast<double>(object.orbit_period), 0.001);
+            const float angle = static_cast<float>(k_real_two_pi * std::fmod(time, period) / period);
+            const float swing_radians = object.swing_degrees * k_degrees_to_radians * sinf(angle);
+
+            out_position = center + glm::vec3(cosf(angle), sinf(angle), 0.f) * object.orbit_radius;
+            out_orientation = glm::quat(cosf(swing_radians / 2.f), 0.f, sinf(swing_radians / 2.f), 0.f); // Yaw about +Y
+        } break;
+    case VirtualTrackerSceneObject::Trajectory:
+        if (trajectory.size() > 1)
+        {
+            // Loop the recording
+            const double start_time = trajectory.front().time;
+            const double duration = trajectory.back().time - start_time;
+            const double sample_time = start_time + std::fmod(std::max(time, 0.0), duration);
+
+            auto next_iter =
+                std::upper_bound(
+                    trajectory.begin(), trajectory.end(), sample_time,
+                    [](double t, const VirtualTrackerKeyframe &keyframe) { return t < keyframe.time; });
+
+            if (next_iter == trajectory.end())
+            {
+                out_position = trajectory.back().position;
+                out_orientation = trajectory.back().orientation;
+            }
+            else if (next_iter == trajectory.begin())
+            {
+                out_position = trajectory.front().position;
+                out_orientation = trajectory.front().orientation;
+            }
+            else
+            {
+                const VirtualTrackerKeyframe &prev = *(next_iter - 1);
+                const VirtualTrackerKeyframe &next = *next_iter;
+                const float u = static_cast<float>((sample_time - prev.time) / (next.time - prev.time));
+
+                out_position = glm_vec3_lerp(prev.position, next.position, u);
+                out_orientation = glm::mix(prev.orientation, next.orientation, u);
+            }
+        }
+        else if (trajectory.size() == 1)
+        {
+            out_position = trajectory.front().position;
+            out_orientation = trajectory.front().orientation;
+        }
+        else
+        {
+            out_position = center;
+            out_orientation = glm::quat();
+        }
+        break;
+    case VirtualTrackerSceneObject::Static:
+    default:
+        out_position = center;
+        out_orientation = glm::quat();
+        break;
+    }
+}
+
+// The center of the tracking color preset, so the default presets pick the lights up
+static cv::Scalar compute_light_color(const CommonHSVColorRange &preset)
+{
+    const cv::Mat hsv(1, 1, CV_8UC3,
+        cv::Scalar(
+            preset.hue_range.center,
+            std::min(preset.saturation_range.center, 255.f),
+            std::min(preset.value_range.center, 255.f)));
+    cv::Mat bgr;
+
+    cv::cvtColor(hsv, bgr, cv::COLOR_HSV2BGR);
+
+    const cv::Vec3b pixel = bgr.at<cv::Vec3b>(0, 0);
+    return cv::Scalar(pixel[0], pixel[1], pixel[2]);
+}
+
+// Same lens model ServerTrackerView uses to undo the projection
+static void compute_intrinsic_matrix(
+    const VirtualTrackerConfig &cfg,
+    cv::Matx33f &out_intrinsics,
+    cv::Matx<float, 5, 1> &out_distortion)
+{
+    out_intrinsics = cv::Matx33f(
+        static_cast<float>(cfg.focalLengthX), 0.f, static_cast<float>(cfg.principalX),
+        0.f, -static_cast<float>(cfg.focalLengthY), static_cast<float>(cfg.principalY), //Negate F_PY because the screen coordinate system has +Y down.
+        0.f, 0.f, 1.f);
+
+    out_distortion(0, 0) = static_cast<float>(cfg.distortionK1);
+    out_distortion(1, 0) = static_cast<float>(cfg.distortionK2);
+    out_distortion(2, 0) = static_cast<float>(cfg.distortionP1);
+    out_distortion(3, 0) = static_cast<float>(cfg.distortionP2);
+    out_distortion(4, 0) = static_cast<float>(cfg.distortionK3);
+}
+
+static bool project_outline(
+    const VirtualTrackerConfig &cfg,
+    const std::vector<cv::Point3f> &tracker_points,
+    std::vector<cv::Point> &out_outline)
+{
+    const float fill_scale = static_cast<float>(1 << VIRTUAL_TRACKER_FILL_SHIFT_BITS);
+    const float max_extent = static_cast<float>(4.0 * std::max(cfg.frame_width, cfg.frame_height));
+
+    for (const cv::Point3f &point : tracker_points)
+    {
+        // Behind the near plane the lens model falls apart
+        if (point.z <= cfg.zNear || point.z >= cfg.zFar)
+        {
+            return false;
+        }
+    }
+
+    cv::Matx33f camera_matrix;
+    cv::Matx<float, 5, 1> distortions;
+    compute_intrinsic_matrix(cfg, camera_matrix, distortions);
+
+    std::vector<cv::Point2f> image_points;
+    cv::projectPoints(tracker_points, cv::Vec3d(0, 0, 0), cv::Vec3d(0, 0, 0), camera_matrix, distortions, image_points);
+
+    out_outline.clear();
+    for (const cv::Point2f &point : image_points)
+    {
+        // The distortion polynomial blows up well outside of the field of view
+        if (!(std::fabs(point.x) < max_extent && std::fabs(point.y) < max_extent))
+        {
+            return false;
+        }
+
+        out_outline.push_back(cv::Point(cvRound(point.x * fill_scale), cvRound(point.y * fill_scale)));
+    }
+
+    return true;
+}
+
+static void render_sphere(
+    const VirtualTrackerConfig &cfg,
+    const glm::vec3 &tracker_center,
+    float radius,
+    const cv::Scalar &color,
+    cv::Mat &target)
+{
+    const float distance = glm::length(tracker_center);
+
+    if (distance <= radius)
+    {
+        return;
+    }
+
+    // The visible outline of a sphere is the circle where the view rays graze it
+    const glm::vec3 view_dir = tracker_center / distance;
+    const glm::vec3 up = (fabsf(view_dir.y) < 0.9f) ? glm::vec3(0.f, 1.f, 0.f) : glm::vec3(1.f, 0.f, 0.f);
+    const glm::vec3 u = glm::normalize(glm::cross(view_dir, up));
+    const glm::vec3 v = glm::cross(view_dir, u);
+    const glm::vec3 outline_center = tracker_center - view_dir * (radius * radius / distance);
+    const float outline_radius = radius * sqrtf(1.f - (radius * radius) / (distance * distance));
+
+    std::vector<cv::Point3f> outline_points;
+    for (int point_index = 0; point_index < VIRTUAL_TRACKER_SPHERE_OUTLINE_POINTS; ++point_index)
+    {
+        const float angle = k_real_two_pi * static_cast<float>(point_index) / static_cast<float>(VIRTUAL_TRACKER_SPHERE_OUTLINE_POINTS);
+        const glm::vec3 point = outline_center + (u * cosf(angle) + v * sinf(angle)) * outline_radius;
+
+        outline_points.push_back(cv::Point3f(point.x, point.y, point.z));
+    }
+
+    std::vector<cv::Point> outline;
+    if (project_outline(cfg, outline_points, outline))
+    {
+        cv::fillConvexPoly(target, outline.data(), static_cast<int>(outline.size()), color, cv::LINE_AA, VIRTUAL_TRACKER_FILL_SHIFT_BITS);
+    }
+}
+
+static void render_lightbar(
+    const VirtualTrackerConfig &cfg,
+    const glm::mat4 &tracker_xform,
+    const cv::Scalar &color,
+    cv::Mat &target)
+{
+    const float half_x = VIRTUAL_TRACKER_LIGHTBAR_WIDTH / 2.f;
+    const float half_y = VIRTUAL_TRACKER_LIGHTBAR_HEIGHT / 2.f;
+    const glm::vec4 corners[4] = {
+        glm::vec4(half_x, half_y, 0.f, 1.f),
+        glm::vec4(-half_x, half_y, 0.f, 1.f),
+        glm::vec4(-half_x, -half_y, 0.f, 1.f),
+        glm::vec4(half_x, -half_y, 0.f, 1.f),
+    };
+
+    std::vector<cv::Point3f> corner_points;
+    for (const glm::vec4 &corner : corners)
+    {
+        const glm::vec4 point = tracker_xform * corner;
+
+        corner_points.push_back(cv::Point3f(point.x, point.y, point.z));
+    }
+
+    std::vector<cv::Point> outline;
+    if (project_outline(cfg, corner_points, outline))
+    {
+        cv::fillConvexPoly(target, outline.data(), static_cast<int>(outline.size()), color, cv::LINE_AA, VIRTUAL_TRACKER_FILL_SHIFT_BITS);
+    }
+}
+
+static void render_led_cluster(
+    const VirtualTrackerConfig &cfg,
+    const glm::mat4 &tracker_xform,
+    const cv::Scalar &color,
+    cv::Mat &target)
+{
+    // No occlusion by the headset body, every LED in front of the tracker gets drawn
+    for (int led_index = 0; led_index < VIRTUAL_TRACKER_LED_COUNT; ++led_index)
+    {
+        const float *led = k_morpheus_led_positions[led_index];
+        const glm::vec4 point = tracker_xform * glm::vec4(led[0], led[1], led[2], 1.f);
+
+        render_sphere(cfg, glm::vec3(point), VIRTUAL_TRACKER_LED_RADIUS, color, target);
+    }
+}
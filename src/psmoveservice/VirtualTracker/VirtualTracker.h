@@ -0,0 +1,218 @@
+#ifndef VIRTUAL_TRACKER_H
+#define VIRTUAL_TRACKER_H
+
+// -- includes -----
+#include "PSMoveConfig.h"
+#include "DeviceEnumerator.h"
+#include "DeviceInterface.h"
+#include <string>
+#include <vector>
+#include <deque>
+
+// -- pre-declarations -----
+namespace PSMoveProtocol
+{
+    class Response_ResultTrackerSettings;
+};
+
+// -- definitions -----
+/// A tracked object the virtual tracker renders into its frames
+struct VirtualTrackerSceneObject
+{
+    enum eShape
+    {
+        Sphere,         // PSMove tracking bulb
+        LightBar,       // DS4 light bar
+        LEDCluster,     // Morpheus tracking LEDs
+
+        MAX_SHAPES
+    };
+
+    enum eMotion
+    {
+        Static,         // Sits at the center
+        Orbit,          // Circles the center in the tracker's XY plane, swinging its yaw back and forth
+        Trajectory,     // Follows the keyframes in the trajectory file, looping at the end
+
+        MAX_MOTIONS
+    };
+
+    eShape shape;
+    eCommonTrackingColorID tracking_color_id;
+    eMotion motion;
+    CommonDevicePosition center; // cm, world space
+    float orbit_radius; // cm
+    float orbit_period; // seconds
+    float swing_degrees;
+    std::string trajectory_filename;
+
+    void clear();
+};
+
+class VirtualTrackerConfig : public PSMoveConfig
+{
+public:
+    VirtualTrackerConfig(const std::string &fnamebase = "VirtualTrackerConfig");
+
+    virtual const boost::property_tree::ptree config2ptree();
+    virtual void ptree2config(const boost::property_tree::ptree &pt);
+
+	const CommonHSVColorRangeTable *getColorRangeTable(const std::string &table_name) const;
+	inline CommonHSVColorRangeTable *getOrAddColorRangeTable(const std::string &table_name);
+
+    bool is_valid;
+    long max_poll_failure_count;
+	double frame_width;
+	double frame_height;
+	double frame_rate;
+    double exposure;
+	double gain;
+    double focalLengthX;
+    double focalLengthY;
+    double principalX;
+    double principalY;
+    double hfov;
+    double vfov;
+    double zNear;
+    double zFar;
+    double distortionK1;
+    double distortionK2;
+    double distortionK3;
+    double distortionP1;
+    double distortionP2;
+
+    CommonDevicePose pose;
+	CommonHSVColorRangeTable SharedColorPresets;
+	std::vector<CommonHSVColorRangeTable> DeviceColorPresets;
+
+    // Render frames at frame_rate in wall clock time, otherwise render a new frame on every poll
+    bool real_time_frames;
+    // Sensor noise standard deviation, in 0-255 pixel levels
+    double noise_stddev;
+    // Brightness of the empty background, in 0-255 pixel levels
+    double background_level;
+    // Number of renders averaged across the time the shutter is open
+    int motion_blur_samples;
+    // Gaussian halo around the lights, in pixels (0 disables it)
+    double glow_radius;
+    double glow_strength;
+    // CSV file that gets the pose of every scene object for every frame (empty disables it)
+    std::string ground_truth_filename;
+
+    std::vector<VirtualTrackerSceneObject> scene_objects;
+
+    static const int CONFIG_VERSION;
+};
+
+struct VirtualTrackerState : public CommonDeviceState
+{
+    VirtualTrackerState()
+    {
+        clear();
+    }
+
+    void clear()
+    {
+        CommonDeviceState::clear();
+        DeviceType = CommonDeviceState::VirtualTracker;
+    }
+};
+
+/// Where a scene object was when a frame was rendered
+struct VirtualTrackerGroundTruth
+{
+    int object_index;
+    CommonDevicePose world_pose;
+    CommonDevicePosition tracker_position; // cm, relative to the tracker
+    CommonDeviceScreenLocation screen_location; // Projected center, in pixels
+    bool bIsVisible;
+};
+
+/// Tracker that renders tracking lights from scripted or recorded trajectories instead of reading a camera.
+/// The frames go through the same lens model (intrinsics and distortion) the optical tracking inverts,
+/// so they can stand in for real cameras in multi-camera and accuracy benchmarks on headless machines.
+class VirtualTracker : public ITrackerInterface {
+public:
+    VirtualTracker();
+    virtual ~VirtualTracker();
+
+    // VirtualTracker
+    bool open(); // Opens the first virtual tracker
+
+    // -- IDeviceInterface
+    bool matchesDeviceEnumerator(const DeviceEnumerator *enumerator) const override;
+    bool open(const DeviceEnumerator *enumerator) override;
+    bool getIsOpen() const override;
+    bool getIsReadyToPoll() const override;
+    IDeviceInterface::ePollResult poll() override;
+    void close() override;
+    long getMaxPollFailureCount() const override;
+    static CommonDeviceState::eDeviceType getDeviceTypeStatic()
+    { return CommonDeviceState::VirtualTracker; }
+    CommonDeviceState::eDeviceType getDeviceType() const override;
+    const CommonDeviceState *getState(int lookBack = 0) const override;
+
+    // -- ITrackerInterface
+    ITrackerInterface::eDriverType getDriverType() const override;
+    std::string getUSBDevicePath() const override;
+    bool getVideoFrameDimensions(int *out_width, int *out_height, int *out_stride) const override;
+    const unsigned char *getVideoFrameBuffer() const override;
+    void loadSettings() override;
+    void saveSettings() override;
+	void setFrameWidth(double value, bool bUpdateConfig) override;
+	double getFrameWidth() const override;
+	void setFrameHeight(double value, bool bUpdateConfig) override;
+	double getFrameHeight() const override;
+	void setFrameRate(double value, bool bUpdateConfig) override;
+	double getFrameRate() const override;
+    void setExposure(double value, bool bUpdateConfig) override;
+    double getExposure() const override;
+	void setGain(double value, bool bUpdateConfig) override;
+	double getGain() const override;
+    void getCameraIntrinsics(
+        float &outFocalLengthX, float &outFocalLengthY,
+        float &outPrincipalX, float &outPrincipalY,
+        float &outDistortionK1, float &outDistortionK2, float &outDistortionK3,
+        float &outDistortionP1, float &outDistortionP2) const override;
+    void setCameraIntrinsics(
+        float focalLengthX, float focalLengthY,
+        float principalX, float principalY,
+        float distortionK1, float distortionK2, float distortionK3,
+        float distortionP1, float distortionP2) override;
+    CommonDevicePose getTrackerPose() const override;
+    void setTrackerPose(const struct CommonDevicePose *pose) override;
+    void getFOV(float &outHFOV, float &outVFOV) const override;
+    void getZRange(float &outZNear, float &outZFar) const override;
+    void gatherTrackerOptions(PSMoveProtocol::Response_ResultTrackerSettings* settings) const override;
+    bool setOptionIndex(const std::string &option_name, int option_index) override;
+    bool getOptionIndex(const std::string &option_name, int &out_option_index) const override;
+    void gatherTrackingColorPresets(const std::string &controller_serial, PSMoveProtocol::Response_ResultTrackerSettings* settings) const override;
+    void setTrackingColorPreset(const std::string &controller_serial, eCommonTrackingColorID color, const CommonHSVColorRange *preset) override;
+    void getTrackingColorPreset(const std::string &controller_serial, eCommonTrackingColorID color, CommonHSVColorRange *out_preset) const override;
+
+    // -- Getters
+    inline const VirtualTrackerConfig &getConfig() const
+    { return cfg; }
+
+    /// Number of frames rendered since the tracker was opened
+    inline int getFrameIndex() const
+    { return FrameIndex; }
+
+    /// Where every scene object was in the last rendered frame
+    inline const std::vector<VirtualTrackerGroundTruth> &getGroundTruth() const
+    { return GroundTruth; }
+
+private:
+    void rebuildScene();
+
+    VirtualTrackerConfig cfg;
+    std::string DevicePath;
+    class VirtualTrackerScene *Scene;
+    int FrameIndex;
+    std::vector<VirtualTrackerGroundTruth> GroundTruth;
+
+    // Read Tracker State
+    int NextPollSequenceNumber;
+    std::deque<VirtualTrackerState> TrackerStates;
+};
+#endif // VIRTUAL_TRACKER_H
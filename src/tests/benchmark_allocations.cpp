@@ -0,0 +1,46 @@
+//-- includes -----
+#include "benchmark_allocations.h"
+
+#include <atomic>
+#include <new>
+#include <stdlib.h>
+
+//-- globals -----
+static std::atomic<long long> g_allocation_count(0);
+static std::atomic<long long> g_allocated_bytes(0);
+
+//-- allocator hooks -----
+void *operator new(size_t size)
+{
+    benchmark_record_allocation(size);
+
+    void *memory = malloc(size > 0 ? size : 1);
+    if (memory == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+
+    return memory;
+}
+
+void operator delete(void *memory) noexcept
+{
+    free(memory);
+}
+
+//-- public interface -----
+long long benchmark_get_allocation_count()
+{
+    return g_allocation_count;
+}
+
+long long benchmark_get_allocated_bytes()
+{
+    return g_allocated_bytes;
+}
+
+void benchmark_record_allocation(size_t size)
+{
+    ++g_allocation_count;
+    g_allocated_bytes += static_cast<long long>(size);
+}
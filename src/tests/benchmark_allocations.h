@@ -0,0 +1,16 @@
+#ifndef BENCHMARK_ALLOCATIONS_H
+#define BENCHMARK_ALLOCATIONS_H
+
+//-- includes -----
+#include <stddef.h>
+
+//-- interface -----
+/// Linking benchmark_allocations.cpp replaces the global operator new/delete with ones that count every allocation.
+/// The counts are atomic, so allocations made on any thread are included.
+long long benchmark_get_allocation_count();
+long long benchmark_get_allocated_bytes();
+
+/// Counts an allocation that doesn't go through operator new, e.g. a cv::Mat buffer
+void benchmark_record_allocation(size_t size);
+
+#endif // BENCHMARK_ALLOCATIONS_H
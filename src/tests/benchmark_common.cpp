@@ -0,0 +1,63 @@
+//-- includes -----
+#include "benchmark_common.h"
+
+#include <algorithm>
+#include <math.h>
+
+//-- public interface -----
+double benchmark_compute_percentile(const std::vector<double> &sorted_samples, const double fraction)
+{
+    if (sorted_samples.empty())
+    {
+        return 0.0;
+    }
+
+    const size_t rank = static_cast<size_t>(ceil(fraction * static_cast<double>(sorted_samples.size())));
+    const size_t index = std::min(std::max(rank, static_cast<size_t>(1)), sorted_samples.size()) - 1;
+
+    return sorted_samples[index];
+}
+
+BenchmarkSummary benchmark_summarize(std::vector<double> &samples)
+{
+    BenchmarkSummary summary;
+    double total = 0.0;
+
+    std::sort(samples.begin(), samples.end());
+    for (const double sample : samples)
+    {
+        total += sample;
+    }
+
+    summary.count = samples.size();
+    summary.mean = (summary.count > 0) ? total / static_cast<double>(summary.count) : 0.0;
+    summary.min = samples.empty() ? 0.0 : samples.front();
+    summary.p50 = benchmark_compute_percentile(samples, 0.50);
+    summary.p90 = benchmark_compute_percentile(samples, 0.90);
+    summary.p99 = benchmark_compute_percentile(samples, 0.99);
+    summary.max = samples.empty() ? 0.0 : samples.back();
+
+    return summary;
+}
+
+void benchmark_write_json_string(FILE *fp, const std::string &value)
+{
+    fputc('"', fp);
+    for (const char ch : value)
+    {
+        if (ch == '"' || ch == '\\')
+        {
+            fputc('\\', fp);
+            fputc(ch, fp);
+        }
+        else if (static_cast<unsigned char>(ch) < 0x20)
+        {
+            fprintf(fp, "\\u%04x", static_cast<unsigned char>(ch));
+        }
+        else
+        {
+            fputc(ch, fp);
+        }
+    }
+    fputc('"', fp);
+}
@@ -0,0 +1,33 @@
+#ifndef BENCHMARK_COMMON_H
+#define BENCHMARK_COMMON_H
+
+//-- includes -----
+#include <stddef.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+//-- definitions -----
+/// Distribution of a set of measured samples, in the unit of the samples
+struct BenchmarkSummary
+{
+    size_t count;
+    double mean;
+    double min;
+    double p50;
+    double p90;
+    double p99;
+    double max;
+};
+
+//-- interface -----
+/// Nearest-rank percentile (fraction in [0, 1]) of samples sorted in ascending order, 0 when there are none
+double benchmark_compute_percentile(const std::vector<double> &sorted_samples, const double fraction);
+
+/// Sorts the samples and summarizes them, every field is 0 when there are none
+BenchmarkSummary benchmark_summarize(std::vector<double> &samples);
+
+/// Writes the value as a quoted and escaped JSON string
+void benchmark_write_json_string(FILE *fp, const std::string &value);
+
+#endif // BENCHMARK_COMMON_H
@@ -0,0 +1,1175 @@
+// Replays recorded controller sensor streams through every pose filter the service can be configured with.
+//
+// usage: benchmark_filters [--recording <samples.csv>] [--truth <ground_truth.csv>] [--truth_object <n>]
+//                          [--device psmove|dualshock4] [--filter <position type>/<orientation type>]
+//                          [--iterations <n>] [--label <build name>] [--output <results.json>]
+//
+// Recordings use the test_kalman_filter format: the device name on the first line, then the
+// TIME,POS_X,...,GYRO_Z column header and one row per IMU sample (seconds, cm, px^2, g-units, rad/s).
+// Rows with an AREA of zero have no optical measurement. The recording has to start with the
+// controller at rest in its identity pose, the identity gravity and magnetometer directions are
+// taken from the first half second.
+//
+// Ground truth comes from seven optional TRUTH_POS_X,...,TRUTH_ORI_Z columns after GYRO_Z, or from
+// the ground truth file a virtual tracker writes (render.ground_truth_filename), resampled at the
+// recording's sample times. Without a recording a synthetic controller is generated with exact
+// ground truth and a couple of optical dropouts.
+//
+// Every filter combination gets the cost of an update (the filter packet plus the filter update),
+// the heap allocations per update, the RMS position and orientation error against ground truth, and
+// the time it takes the filter to converge again after each optical dropout.
+// --filter can be repeated to pick combinations, by default all the compound filters are run.
+// Results are written as JSON so runs from different builds can be diffed.
+#include "DeviceInterface.h"
+#include "MathEigen.h"
+#include "MathUtility.h"
+#include "PoseFilterFactory.h"
+#include "PoseFilterInterface.h"
+#include "benchmark_allocations.h"
+#include "benchmark_common.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#if _MSC_VER
+#define strcasecmp(a, b) _stricmp(a, b)
+#endif
+
+//-- constants -----
+static const int k_default_iterations = 10;
+
+// The identity pose is measured over the start of a recording
+static const float k_identity_pose_duration = 0.5f; // seconds
+
+// A filter has converged again after a dropout once its error is under these
+static const float k_converged_position_error_cm = 1.f;
+static const float k_converged_orientation_error_degrees = 5.f;
+
+// Synthetic controller: waving in front of the tracker at the PSMove IMU rate
+static const float k_synthetic_duration = 20.f; // seconds
+static const float k_synthetic_sample_rate = 120.f; // Hz
+static const float k_synthetic_projection_area = 600.f; // px^2
+static const float k_synthetic_optical_position_noise_cm = 0.2f;
+static const float k_synthetic_optical_orientation_noise_radians = 0.02f;
+static const float k_synthetic_dropouts[][2] = { { 6.f, 1.f }, { 13.f, 2.5f } }; // start, duration in seconds
+static const int k_synthetic_dropout_count = static_cast<int>(sizeof(k_synthetic_dropouts) / sizeof(k_synthetic_dropouts[0]));
+static const unsigned int k_synthetic_random_seed = 1234;
+
+enum eSampleFields
+{
+    FIELD_TIME,
+    FIELD_POSITION_X,
+    FIELD_POSITION_Y,
+    FIELD_POSITION_Z,
+    FIELD_AREA,
+    FIELD_ORIENTATION_W,
+    FIELD_ORIENTATION_X,
+    FIELD_ORIENTATION_Y,
+    FIELD_ORIENTATION_Z,
+    FIELD_ACCELEROMETER_X,
+    FIELD_ACCELEROMETER_Y,
+    FIELD_ACCELEROMETER_Z,
+    FIELD_MAGNETOMETER_X,
+    FIELD_MAGNETOMETER_Y,
+    FIELD_MAGNETOMETER_Z,
+    FIELD_GYROSCOPE_X,
+    FIELD_GYROSCOPE_Y,
+    FIELD_GYROSCOPE_Z,
+
+    FIELD_SENSOR_COUNT,
+
+    FIELD_TRUTH_POSITION_X = FIELD_SENSOR_COUNT,
+    FIELD_TRUTH_POSITION_Y,
+    FIELD_TRUTH_POSITION_Z,
+    FIELD_TRUTH_ORIENTATION_W,
+    FIELD_TRUTH_ORIENTATION_X,
+    FIELD_TRUTH_ORIENTATION_Y,
+    FIELD_TRUTH_ORIENTATION_Z,
+
+    FIELD_COUNT
+};
+
+static const char *k_column_names[FIELD_COUNT] = {
+    "TIME",
+    "POS_X", "POS_Y", "POS_Z",
+    "AREA",
+    "ORI_W", "ORI_X", "ORI_Y", "ORI_Z",
+    "ACC_X", "ACC_Y", "ACC_Z",
+    "MAG_X", "MAG_Y", "MAG_Z",
+    "GYRO_X", "GYRO_Y", "GYRO_Z",
+    "TRUTH_POS_X", "TRUTH_POS_Y", "TRUTH_POS_Z",
+    "TRUTH_ORI_W", "TRUTH_ORI_X", "TRUTH_ORI_Y", "TRUTH_ORI_Z"
+};
+
+// Columns of the virtual tracker ground truth file
+enum eGroundTruthFields
+{
+    TRUTH_FIELD_FRAME,
+    TRUTH_FIELD_TIME,
+    TRUTH_FIELD_OBJECT,
+    TRUTH_FIELD_POSITION_X,
+    TRUTH_FIELD_POSITION_Y,
+    TRUTH_FIELD_POSITION_Z,
+    TRUTH_FIELD_ORIENTATION_W,
+    TRUTH_FIELD_ORIENTATION_X,
+    TRUTH_FIELD_ORIENTATION_Y,
+    TRUTH_FIELD_ORIENTATION_Z,
+
+    TRUTH_FIELD_COUNT
+};
+
+//-- definitions -----
+// Kept as plain floats so the recording can live in a std::vector without an aligned allocator
+struct FilterSample
+{
+    float time; // seconds
+    float delta_time; // seconds since the previous sample
+
+    // Optical readings in the world reference frame
+    float optical_position_cm[3];
+    float projection_area_px_sqr; // zero when the controller isn't tracked
+    float optical_orientation[4]; // w, x, y, z
+
+    // Sensor readings in the controller's reference frame
+    float accelerometer_g_units[3];
+    float magnetometer_unit[3];
+    float gyroscope_rad_per_sec[3];
+
+    bool bHasTruth;
+    float truth_position_cm[3];
+    float truth_orientation[4]; // w, x, y, z
+};
+
+struct FilterRecording
+{
+    std::string source;
+    CommonDeviceState::eDeviceType device_type;
+    std::vector<FilterSample> samples;
+    Eigen::Vector3f identity_gravity;
+    Eigen::Vector3f identity_magnetometer;
+    float mean_delta_time;
+    int dropout_count;
+    int truth_sample_count;
+};
+
+struct FilterCombination
+{
+    std::string position_filter_type;
+    std::string orientation_filter_type;
+};
+
+struct FilterResult
+{
+    std::string position_filter_type;
+    std::string orientation_filter_type;
+    size_t updates;
+    double mean_ns, p50_ns, p90_ns, p99_ns, max_ns;
+    double allocations_per_update;
+    double allocated_bytes_per_update;
+    long long setup_allocations;
+
+    bool bHasPositionError;
+    double position_rms_cm;
+    double position_rms_during_dropout_cm; // negative when the filter had no position during any dropout
+    double position_max_cm;
+    bool bHasOrientationError;
+    double orientation_rms_degrees;
+    double orientation_max_degrees;
+
+    // Convergence after each optical dropout, unconverged dropouts aren't part of the mean and max
+    int converged_count;
+    int unconverged_count;
+    double convergence_mean_seconds;
+    double convergence_max_seconds;
+
+    bool bStateValid; // The filter never produced a NaN
+};
+
+struct BenchmarkOptions
+{
+    std::string recording_filename;
+    std::string truth_filename;
+    std::string device_name;
+    std::string label;
+    std::string output_filename;
+    std::vector<FilterCombination> combinations;
+    int truth_object;
+    int iterations;
+};
+
+//-- prototypes -----
+static bool parse_arguments(int argc, char *argv[], BenchmarkOptions &out_options);
+static bool parse_device_type(const std::string &device_name, CommonDeviceState::eDeviceType &out_device_type);
+static bool load_recording(const std::string &filename, FilterRecording &out_recording);
+static bool load_ground_truth(const std::string &filename, const int object_index, FilterRecording &recording);
+static void generate_synthetic_recording(const CommonDeviceState::eDeviceType device_type, FilterRecording &out_recording);
+static void finalize_recording(FilterRecording &recording);
+static void get_all_filter_combinations(std::vector<FilterCombination> &out_combinations);
+static void init_filter_space(const FilterRecording &recording, PoseFilterSpace &out_filter_space, PoseFilterConstants &out_constants);
+static FilterResult run_filter(const FilterCombination &combination, const BenchmarkOptions &options, const FilterRecording &recording);
+static void write_results(FILE *fp, const BenchmarkOptions &options, const FilterRecording &recording, const std::vector<FilterResult> &results);
+
+//-- entry point -----
+int main(int argc, char *argv[])
+{
+    BenchmarkOptions options;
+    if (!parse_arguments(argc, argv, options))
+    {
+        printf("usage: benchmark_filters [--recording <samples.csv>] [--truth <ground_truth.csv>] [--truth_object <n>]\n");
+        printf("                         [--device psmove|dualshock4] [--filter <position type>/<orientation type>]\n");
+        printf("                         [--iterations <n>] [--label <build name>] [--output <results.json>]\n");
+        return -1;
+    }
+
+    FilterRecording recording;
+    if (options.recording_filename.length() > 0)
+    {
+        if (!load_recording(options.recording_filename, recording))
+        {
+            fprintf(stderr, "No samples could be loaded from: %s\n", options.recording_filename.c_str());
+            return -1;
+        }
+    }
+    else
+    {
+        CommonDeviceState::eDeviceType device_type;
+        if (!parse_device_type(options.device_name, device_type))
+        {
+            fprintf(stderr, "Unknown device: %s\n", options.device_name.c_str());
+            return -1;
+        }
+
+        generate_synthetic_recording(device_type, recording);
+    }
+
+    if (options.truth_filename.length() > 0 &&
+        !load_ground_truth(options.truth_filename, options.truth_object, recording))
+    {
+        fprintf(stderr, "No ground truth for object %d could be loaded from: %s\n", options.truth_object, options.truth_filename.c_str());
+        return -1;
+    }
+
+    finalize_recording(recording);
+
+    if (recording.truth_sample_count == 0)
+    {
+        fprintf(stderr, "The recording has no ground truth, only timings will be reported\n");
+    }
+
+    if (options.combinations.empty())
+    {
+        get_all_filter_combinations(options.combinations);
+    }
+
+    std::vector<FilterResult> results;
+    for (const FilterCombination &combination : options.combinations)
+    {
+        fprintf(stderr, "Running %s/%s...\n", combination.position_filter_type.c_str(), combination.orientation_filter_type.c_str());
+        results.push_back(run_filter(combination, options, recording));
+    }
+
+    FILE *fp = stdout;
+    if (options.output_filename.length() > 0)
+    {
+        fp = fopen(options.output_filename.c_str(), "wt");
+        if (fp == nullptr)
+        {
+            fprintf(stderr, "Failed to open %s for writing\n", options.output_filename.c_str());
+            return -1;
+        }
+    }
+
+    write_results(fp, options, recording, results);
+
+    if (fp != stdout)
+    {
+        fclose(fp);
+    }
+
+    return 0;
+}
+
+//-- setup -----
+static bool parse_arguments(int argc, char *argv[], BenchmarkOptions &out_options)
+{
+    out_options.device_name = "psmove";
+    out_options.label = "unlabeled";
+    out_options.truth_object = 0;
+    out_options.iterations = k_default_iterations;
+
+    for (int arg_index = 1; arg_index < argc; ++arg_index)
+    {
+        const char *arg = argv[arg_index];
+        const char *value = (arg_index + 1 < argc) ? argv[arg_index + 1] : nullptr;
+
+        if (value == nullptr)
+        {
+            return false;
+        }
+
+        if (strcmp(arg, "--recording") == 0)
+        {
+            out_options.recording_filename = value;
+        }
+        else if (strcmp(arg, "--truth") == 0)
+        {
+            out_options.truth_filename = value;
+        }
+        else if (strcmp(arg, "--truth_object") == 0)
+        {
+            out_options.truth_object = std::max(atoi(value), 0);
+        }
+        else if (strcmp(arg, "--device") == 0)
+        {
+            out_options.device_name = value;
+        }
+        else if (strcmp(arg, "--filter") == 0)
+        {
+            // "<position>/<orientation>", either side may be empty
+            const char *separator = strchr(value, '/');
+            if (separator == nullptr)
+            {
+                return false;
+            }
+
+            FilterCombination combination;
+            combination.position_filter_type = std::string(value, separator);
+            combination.orientation_filter_type = std::string(separator + 1);
+            out_options.combinations.push_back(combination);
+        }
+        else if (strcmp(arg, "--iterations") == 0)
+        {
+            out_options.iterations = std::max(atoi(value), 1);
+        }
+        else if (strcmp(arg, "--label") == 0)
+        {
+            out_options.label = value;
+        }
+        else if (strcmp(arg, "--output") == 0)
+        {
+            out_options.output_filename = value;
+        }
+        else
+        {
+            return false;
+        }
+
+        ++arg_index;
+    }
+
+    return true;
+}
+
+static bool parse_device_type(const std::string &device_name, CommonDeviceState::eDeviceType &out_device_type)
+{
+    if (strcasecmp(device_name.c_str(), "psmove") == 0)
+    {
+        out_device_type = CommonDeviceState::PSMove;
+        return true;
+    }
+    else if (strcasecmp(device_name.c_str(), "dualshock4") == 0)
+    {
+        out_device_type = CommonDeviceState::PSDualShock4;
+        return true;
+    }
+
+    return false;
+}
+
+static void trim_line_ending(char *line)
+{
+    size_t len = strlen(line);
+
+    while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r' || line[len - 1] == ' '))
+    {
+        line[--len] = '\0';
+    }
+}
+
+static int parse_csv_floats(char *line, float *out_columns, const int max_columns)
+{
+    int column_count = 0;
+    char *cursor = line;
+
+    while (column_count < max_columns && *cursor != '\0')
+    {
+        char *end = nullptr;
+        const float value = strtof(cursor, &end);
+
+        if (end == cursor)
+        {
+            break;
+        }
+
+        out_columns[column_count++] = value;
+
+        cursor = end;
+        while (*cursor == ' ')
+        {
+            ++cursor;
+        }
+        if (*cursor == ',')
+        {
+            ++cursor;
+        }
+    }
+
+    return column_count;
+}
+
+static int parse_csv_header(char *line, const char **column_names, const int max_columns)
+{
+    int matching_columns = 0;
+    char *token = strtok(line, ",");
+
+    while (token != nullptr && matching_columns < max_columns)
+    {
+        while (*token == ' ')
+        {
+            ++token;
+        }
+
+        if (strcasecmp(token, column_names[matching_columns]) != 0)
+        {
+            break;
+        }
+
+        ++matching_columns;
+        token = strtok(nullptr, ",");
+    }
+
+    return matching_columns;
+}
+
+static bool load_recording(const std::string &filename, FilterRecording &out_recording)
+{
+    char line[1024];
+    bool bSuccess = false;
+
+    FILE *fp = fopen(filename.c_str(), "rt");
+    if (fp == nullptr)
+    {
+        return false;
+    }
+
+    out_recording.source = filename;
+    out_recording.samples.clear();
+
+    int column_count = 0;
+    if (fgets(line, sizeof(line), fp) != nullptr)
+    {
+        trim_line_ending(line);
+
+        if (parse_device_type(line, out_recording.device_type) &&
+            fgets(line, sizeof(line), fp) != nullptr)
+        {
+            trim_line_ending(line);
+            column_count = parse_csv_header(line, k_column_names, FIELD_COUNT);
+
+            // The truth columns are all or nothing
+            bSuccess = column_count == FIELD_SENSOR_COUNT || column_count == FIELD_COUNT;
+        }
+    }
+
+    while (bSuccess && fgets(line, sizeof(line), fp) != nullptr)
+    {
+        float columns[FIELD_COUNT];
+
+        trim_line_ending(line);
+        if (parse_csv_floats(line, columns, column_count) != column_count)
+        {
+            continue;
+        }
+
+        FilterSample sample;
+        memset(&sample, 0, sizeof(sample));
+
+        sample.time = columns[FIELD_TIME];
+        sample.projection_area_px_sqr = columns[FIELD_AREA];
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            sample.optical_position_cm[axis] = columns[FIELD_POSITION_X + axis];
+            sample.accelerometer_g_units[axis] = columns[FIELD_ACCELEROMETER_X + axis];
+            sample.magnetometer_unit[axis] = columns[FIELD_MAGNETOMETER_X + axis];
+            sample.gyroscope_rad_per_sec[axis] = columns[FIELD_GYROSCOPE_X + axis];
+        }
+        for (int component = 0; component < 4; ++component)
+        {
+            sample.optical_orientation[component] = columns[FIELD_ORIENTATION_W + component];
+        }
+
+        // Normalize the magnetometer readings
+        Eigen::Vector3f mag(sample.magnetometer_unit[0], sample.magnetometer_unit[1], sample.magnetometer_unit[2]);
+        eigen_vector3f_normalize_with_default(mag, Eigen::Vector3f::Zero());
+        sample.magnetometer_unit[0] = mag.x();
+        sample.magnetometer_unit[1] = mag.y();
+        sample.magnetometer_unit[2] = mag.z();
+
+        if (column_count == FIELD_COUNT)
+        {
+            sample.bHasTruth = true;
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                sample.truth_position_cm[axis] = columns[FIELD_TRUTH_POSITION_X + axis];
+            }
+            for (int component = 0; component < 4; ++component)
+            {
+                sample.truth_orientation[component] = columns[FIELD_TRUTH_ORIENTATION_W + component];
+            }
+        }
+
+        out_recording.samples.push_back(sample);
+    }
+
+    fclose(fp);
+
+    if (out_recording.samples.size() <= 1)
+    {
+        return false;
+    }
+
+    // Measure the identity pose the controller rests in at the start of the recording
+    Eigen::Vector3f gravity_sum = Eigen::Vector3f::Zero();
+    Eigen::Vector3f magnetometer_sum = Eigen::Vector3f::Zero();
+    const float identity_pose_end_time = out_recording.samples[0].time + k_identity_pose_duration;
+
+    for (const FilterSample &sample : out_recording.samples)
+    {
+        if (sample.time > identity_pose_end_time)
+        {
+            break;
+        }
+
+        gravity_sum += Eigen::Vector3f(sample.accelerometer_g_units[0], sample.accelerometer_g_units[1], sample.accelerometer_g_units[2]);
+        magnetometer_sum += Eigen::Vector3f(sample.magnetometer_unit[0], sample.magnetometer_unit[1], sample.magnetometer_unit[2]);
+    }
+
+    out_recording.identity_gravity = gravity_sum;
+    eigen_vector3f_normalize_with_default(out_recording.identity_gravity, Eigen::Vector3f(0.f, 1.f, 0.f));
+    out_recording.identity_magnetometer = magnetometer_sum;
+    eigen_vector3f_normalize_with_default(out_recording.identity_magnetometer, Eigen::Vector3f::Zero());
+
+    return true;
+}
+
+static bool load_ground_truth(const std::string &filename, const int object_index, FilterRecording &recording)
+{
+    struct TruthPose
+    {
+        float time;
+        float position_cm[3];
+        float orientation[4];
+    };
+    std::vector<TruthPose> truth_poses;
+    char line[1024];
+
+    FILE *fp = fopen(filename.c_str(), "rt");
+    if (fp == nullptr)
+    {
+        return false;
+    }
+
+    // Skip the column header
+    if (fgets(line, sizeof(line), fp) != nullptr)
+    {
+        while (fgets(line, sizeof(line), fp) != nullptr)
+        {
+            float columns[TRUTH_FIELD_COUNT];
+
+            if (parse_csv_floats(line, columns, TRUTH_FIELD_COUNT) == TRUTH_FIELD_COUNT &&
+                static_cast<int>(columns[TRUTH_FIELD_OBJECT]) == object_index)
+            {
+                TruthPose pose;
+
+                pose.time = columns[TRUTH_FIELD_TIME];
+                for (int axis = 0; axis < 3; ++axis)
+                {
+                    pose.position_cm[axis] = columns[TRUTH_FIELD_POSITION_X + axis];
+                }
+                for (int component = 0; component < 4; ++component)
+                {
+                    pose.orientation[component] = columns[TRUTH_FIELD_ORIENTATION_W + component];
+                }
+
+                truth_poses.push_back(pose);
+            }
+        }
+    }
+
+    fclose(fp);
+
+    if (truth_poses.empty())
+    {
+        return false;
+    }
+
+    std::sort(truth_poses.begin(), truth_poses.end(),
+        [](const TruthPose &a, const TruthPose &b) { return a.time < b.time; });
+
+    // Resample the truth at every sample time inside the truth's time span
+    size_t truth_index = 0;
+    for (FilterSample &sample : recording.samples)
+    {
+        while (truth_index + 1 < truth_poses.size() && truth_poses[truth_index + 1].time <= sample.time)
+        {
+            ++truth_index;
+        }
+
+        sample.bHasTruth = false;
+        if (truth_index + 1 < truth_poses.size() && truth_poses[truth_index].time <= sample.time)
+        {
+            const TruthPose &before = truth_poses[truth_index];
+            const TruthPose &after = truth_poses[truth_index + 1];
+            const float span = after.time - before.time;
+            const float u = (span > k_real_epsilon) ? (sample.time - before.time) / span : 0.f;
+
+            const Eigen::Quaternionf q_before(before.orientation[0], before.orientation[1], before.orientation[2], before.orientation[3]);
+            const Eigen::Quaternionf q_after(after.orientation[0], after.orientation[1], after.orientation[2], after.orientation[3]);
+            const Eigen::Quaternionf q = q_before.slerp(u, q_after).normalized();
+
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                sample.truth_position_cm[axis] = lerpf(before.position_cm[axis], after.position_cm[axis], u);
+            }
+            sample.truth_orientation[0] = q.w();
+            sample.truth_orientation[1] = q.x();
+            sample.truth_orientation[2] = q.y();
+            sample.truth_orientation[3] = q.z();
+            sample.bHasTruth = true;
+        }
+    }
+
+    return true;
+}
+
+static void compute_synthetic_pose(const float time, Eigen::Vector3f &out_position_cm, Eigen::Quaternionf &out_orientation)
+{
+    // A lazy figure eight in front of the tracker while the controller twists and nods.
+    // The controller starts out in its identity pose.
+    out_position_cm = Eigen::Vector3f(
+        25.f * sinf(0.9f * time),
+        12.f * sinf(1.8f * time),
+        -150.f + 10.f * sinf(0.5f * time));
+    out_orientation =
+        Eigen::Quaternionf(Eigen::AngleAxisf(0.8f * sinf(0.7f * time), Eigen::Vector3f::UnitY())) *
+        Eigen::Quaternionf(Eigen::AngleAxisf(0.5f * sinf(1.3f * time), Eigen::Vector3f::UnitX())) *
+        Eigen::Quaternionf(Eigen::AngleAxisf(0.3f * sinf(0.4f * time), Eigen::Vector3f::UnitZ()));
+}
+
+static void generate_synthetic_recording(const CommonDeviceState::eDeviceType device_type, FilterRecording &out_recording)
+{
+    // The noise levels are those of the default device configs
+    const bool bHasMagnetometer = device_type == CommonDeviceState::PSMove;
+    const bool bHasOpticalOrientation = device_type == CommonDeviceState::PSDualShock4;
+    const float accelerometer_variance = (device_type == CommonDeviceState::PSMove) ? 7.2e-06f : 1.45e-05f;
+    const float gyro_variance = (device_type == CommonDeviceState::PSMove) ? 0.00035f : 4.75e-06f;
+    const float magnetometer_variance = 0.00059f;
+    const float delta_time = 1.f / k_synthetic_sample_rate;
+    const float derivative_step = 0.001f;
+    const Eigen::Vector3f world_gravity(0.f, 1.f, 0.f);
+    const Eigen::Vector3f world_magnetometer = Eigen::Vector3f(0.f, -0.6f, 0.8f).normalized();
+
+    std::mt19937 random_engine(k_synthetic_random_seed);
+    std::normal_distribution<float> accelerometer_noise(0.f, sqrtf(accelerometer_variance));
+    std::normal_distribution<float> gyro_noise(0.f, sqrtf(gyro_variance));
+    std::normal_distribution<float> magnetometer_noise(0.f, sqrtf(magnetometer_variance));
+    std::normal_distribution<float> optical_position_noise(0.f, k_synthetic_optical_position_noise_cm);
+    std::normal_distribution<float> optical_orientation_noise(0.f, k_synthetic_optical_orientation_noise_radians);
+
+    out_recording.source = "synthetic";
+    out_recording.device_type = device_type;
+    out_recording.identity_gravity = world_gravity;
+    out_recording.identity_magnetometer = bHasMagnetometer ? world_magnetometer : Eigen::Vector3f::Zero();
+    out_recording.samples.clear();
+
+    const int sample_count = static_cast<int>(k_synthetic_duration * k_synthetic_sample_rate);
+    for (int sample_index = 0; sample_index < sample_count; ++sample_index)
+    {
+        const float time = static_cast<float>(sample_index) * delta_time;
+        Eigen::Vector3f position, position_before, position_after;
+        Eigen::Quaternionf orientation, orientation_before, orientation_after;
+
+        compute_synthetic_pose(time, position, orientation);
+        compute_synthetic_pose(time - derivative_step, position_before, orientation_before);
+        compute_synthetic_pose(time + derivative_step, position_after, orientation_after);
+
+        // The sensors measure in the controller's frame: sensor = q^-1 * world * q
+        const Eigen::Vector3f acceleration_cm_s2 =
+            (position_after - 2.f * position + position_before) / (derivative_step * derivative_step);
+        const Eigen::Vector3f accelerometer =
+            eigen_vector3f_clockwise_rotate(orientation, world_gravity + acceleration_cm_s2 / k_g_units_to_gal);
+        const Eigen::Vector3f magnetometer =
+            bHasMagnetometer ? eigen_vector3f_clockwise_rotate(orientation, world_magnetometer) : Eigen::Vector3f::Zero();
+
+        // Body frame angular velocity from q_dot = 0.5*q*omega
+        const Eigen::AngleAxisf rotation_step(orientation_before.conjugate() * orientation_after);
+        const Eigen::Vector3f gyroscope = rotation_step.axis() * (rotation_step.angle() / (2.f * derivative_step));
+
+        bool bIsDropout = false;
+        for (int dropout_index = 0; dropout_index < k_synthetic_dropout_count; ++dropout_index)
+        {
+            const float dropout_start = k_synthetic_dropouts[dropout_index][0];
+            const float dropout_end = dropout_start + k_synthetic_dropouts[dropout_index][1];
+
+            bIsDropout |= time >= dropout_start && time < dropout_end;
+        }
+
+        FilterSample sample;
+        memset(&sample, 0, sizeof(sample));
+
+        sample.time = time;
+        sample.optical_orientation[0] = 1.f;
+        if (!bIsDropout)
+        {
+            sample.projection_area_px_sqr = k_synthetic_projection_area;
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                sample.optical_position_cm[axis] = position[axis] + optical_position_noise(random_engine);
+            }
+
+            if (bHasOpticalOrientation)
+            {
+                const Eigen::Vector3f noise_axis(
+                    optical_orientation_noise(random_engine),
+                    optical_orientation_noise(random_engine),
+                    optical_orientation_noise(random_engine));
+                const float noise_angle = noise_axis.norm();
+                const Eigen::Quaternionf noisy_orientation =
+                    (noise_angle > k_real_epsilon)
+                    ? (orientation * Eigen::Quaternionf(Eigen::AngleAxisf(noise_angle, noise_axis / noise_angle))).normalized()
+                    : orientation;
+
+                sample.optical_orientation[0] = noisy_orientation.w();
+                sample.optical_orientation[1] = noisy_orientation.x();
+                sample.optical_orientation[2] = noisy_orientation.y();
+                sample.optical_orientation[3] = noisy_orientation.z();
+            }
+        }
+
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            sample.accelerometer_g_units[axis] = accelerometer[axis] + accelerometer_noise(random_engine);
+            sample.gyroscope_rad_per_sec[axis] = gyroscope[axis] + gyro_noise(random_engine);
+            sample.magnetometer_unit[axis] = bHasMagnetometer ? magnetometer[axis] + magnetometer_noise(random_engine) : 0.f;
+            sample.truth_position_cm[axis] = position[axis];
+        }
+
+        sample.bHasTruth = true;
+        sample.truth_orientation[0] = orientation.w();
+        sample.truth_orientation[1] = orientation.x();
+        sample.truth_orientation[2] = orientation.y();
+        sample.truth_orientation[3] = orientation.z();
+
+        out_recording.samples.push_back(sample);
+    }
+}
+
+static void finalize_recording(FilterRecording &recording)
+{
+    const size_t sample_count = recording.samples.size();
+
+    recording.mean_delta_time =
+        (recording.samples.back().time - recording.samples.front().time) / static_cast<float>(sample_count - 1);
+    recording.dropout_count = 0;
+    recording.truth_sample_count = 0;
+
+    for (size_t sample_index = 0; sample_index < sample_count; ++sample_index)
+    {
+        FilterSample &sample = recording.samples[sample_index];
+
+        // Out of order or duplicate timestamps get the typical time step
+        sample.delta_time =
+            (sample_index > 0 && sample.time > recording.samples[sample_index - 1].time)
+            ? sample.time - recording.samples[sample_index - 1].time
+            : recording.mean_delta_time;
+
+        if (sample_index > 0 &&
+            sample.projection_area_px_sqr <= 0.f &&
+            recording.samples[sample_index - 1].projection_area_px_sqr > 0.f)
+        {
+            ++recording.dropout_count;
+        }
+
+        if (sample.bHasTruth)
+        {
+            ++recording.truth_sample_count;
+        }
+    }
+}
+
+static void get_all_filter_combinations(std::vector<FilterCombination> &out_combinations)
+{
+    for (int position_index = 0; position_index < k_position_filter_type_count; ++position_index)
+    {
+        for (int orientation_index = 0; orientation_index < k_orientation_filter_type_count; ++orientation_index)
+        {
+            FilterCombination combination;
+            combination.position_filter_type = k_position_filter_type_names[position_index];
+            combination.orientation_filter_type = k_orientation_filter_type_names[orientation_index];
+
+            // Nothing to filter
+            if (combination.position_filter_type.empty() && combination.orientation_filter_type.empty())
+            {
+                continue;
+            }
+
+            out_combinations.push_back(combination);
+        }
+    }
+
+    // The full pose kalman filter doesn't work yet (see test_kalman_filter),
+    // it only runs when asked for with --filter PoseKalman/PoseKalman
+}
+
+static void init_filter_space(const FilterRecording &recording, PoseFilterSpace &out_filter_space, PoseFilterConstants &out_constants)
+{
+    // Recordings are measured in the filter space directly
+    out_filter_space.setIdentityGravity(recording.identity_gravity);
+    out_filter_space.setIdentityMagnetometer(recording.identity_magnetometer);
+    out_filter_space.setCalibrationTransform(*k_eigen_identity_pose_upright);
+    out_filter_space.setSensorTransform(*k_eigen_sensor_transform_identity);
+
+    // The constants are those of the default device configs (see init_filters_for_psmove and
+    // init_filters_for_psdualshock4 in ServerControllerView) with the recording's update rate
+    out_constants.clear();
+    out_constants.orientation_constants.gravity_calibration_direction = out_filter_space.getGravityCalibrationDirection();
+    out_constants.orientation_constants.magnetometer_calibration_direction = out_filter_space.getMagnetometerCalibrationDirection();
+    out_constants.orientation_constants.mean_update_time_delta = recording.mean_delta_time;
+    out_constants.position_constants.gravity_calibration_direction = out_filter_space.getGravityCalibrationDirection();
+    out_constants.position_constants.mean_update_time_delta = recording.mean_delta_time;
+    out_constants.position_constants.max_velocity = 1.f;
+    out_constants.position_constants.position_variance_curve.MaxValue = 1.f;
+
+    if (recording.device_type == CommonDeviceState::PSMove)
+    {
+        out_constants.orientation_constants.accelerometer_variance = Eigen::Vector3f::Constant(7.2e-06f);
+        out_constants.orientation_constants.gyro_drift = Eigen::Vector3f::Constant(0.027f);
+        out_constants.orientation_constants.gyro_variance = Eigen::Vector3f::Constant(0.00035f);
+        out_constants.orientation_constants.magnetometer_variance = Eigen::Vector3f::Constant(0.00059f);
+        out_constants.orientation_constants.orientation_variance_curve.A = 18.75f;
+        out_constants.orientation_constants.orientation_variance_curve.B = 0.f;
+        out_constants.orientation_constants.orientation_variance_curve.MaxValue = 18.75f;
+
+        out_constants.position_constants.accelerometer_variance = Eigen::Vector3f::Constant(7.2e-06f);
+        out_constants.position_constants.accelerometer_noise_radius = 0.014f;
+        out_constants.position_constants.position_variance_curve.A = 0.0994158462f;
+        out_constants.position_constants.position_variance_curve.B = -0.000567041978f;
+    }
+    else
+    {
+        out_constants.orientation_constants.accelerometer_variance = Eigen::Vector3f::Constant(1.45e-05f);
+        out_constants.orientation_constants.gyro_drift = Eigen::Vector3f::Constant(0.00071f);
+        out_constants.orientation_constants.gyro_variance = Eigen::Vector3f::Constant(4.75e-06f);
+        out_constants.orientation_constants.orientation_variance_curve.A = 0.119878575f;
+        out_constants.orientation_constants.orientation_variance_curve.B = -0.00267515215f;
+        out_constants.orientation_constants.orientation_variance_curve.MaxValue = 1.f;
+
+        out_constants.position_constants.accelerometer_variance = Eigen::Vector3f::Constant(1.45e-05f);
+        out_constants.position_constants.accelerometer_noise_radius = 0.015f;
+        out_constants.position_constants.position_variance_curve.A = 0.0219580978f;
+        out_constants.position_constants.position_variance_curve.B = -0.00079152541f;
+    }
+}
+
+//-- measurement -----
+static void make_sensor_packet(const FilterSample &sample, PoseSensorPacket &out_packet)
+{
+    out_packet.optical_position_cm =
+        Eigen::Vector3f(sample.optical_position_cm[0], sample.optical_position_cm[1], sample.optical_position_cm[2]);
+    out_packet.optical_orientation =
+        Eigen::Quaternionf(sample.optical_orientation[0], sample.optical_orientation[1], sample.optical_orientation[2], sample.optical_orientation[3]);
+    out_packet.tracking_projection_area_px_sqr = sample.projection_area_px_sqr;
+    out_packet.imu_accelerometer_g_units =
+        Eigen::Vector3f(sample.accelerometer_g_units[0], sample.accelerometer_g_units[1], sample.accelerometer_g_units[2]);
+    out_packet.imu_magnetometer_unit =
+        Eigen::Vector3f(sample.magnetometer_unit[0], sample.magnetometer_unit[1], sample.magnetometer_unit[2]);
+    out_packet.imu_gyroscope_rad_per_sec =
+        Eigen::Vector3f(sample.gyroscope_rad_per_sec[0], sample.gyroscope_rad_per_sec[1], sample.gyroscope_rad_per_sec[2]);
+}
+
+static FilterResult run_filter(
+    const FilterCombination &combination,
+    const BenchmarkOptions &options,
+    const FilterRecording &recording)
+{
+    FilterResult result;
+    std::vector<double> samples_ns;
+    samples_ns.reserve(recording.samples.size() * options.iterations);
+
+    PoseFilterSpace filter_space;
+    PoseFilterConstants constants;
+    init_filter_space(recording, filter_space, constants);
+
+    // Prepared up front so the packet conversion isn't part of the timings
+    std::vector<PoseSensorPacket, Eigen::aligned_allocator<PoseSensorPacket>> sensor_packets(recording.samples.size());
+    for (size_t sample_index = 0; sample_index < recording.samples.size(); ++sample_index)
+    {
+        make_sensor_packet(recording.samples[sample_index], sensor_packets[sample_index]);
+    }
+
+    const bool bFullPoseFilter = combination.position_filter_type == k_pose_kalman_filter_type_name;
+    const bool bHasPositionFilter = bFullPoseFilter || !combination.position_filter_type.empty();
+    const bool bHasOrientationFilter = bFullPoseFilter || !combination.orientation_filter_type.empty();
+
+    long long allocation_count = 0;
+    long long allocated_bytes = 0;
+
+    // Accuracy of the last iteration, every iteration starts over from a new filter
+    double position_squared_error_sum = 0.0, dropout_position_squared_error_sum = 0.0, orientation_squared_error_sum = 0.0;
+    int position_error_count = 0, dropout_position_error_count = 0, orientation_error_count = 0;
+    double convergence_sum = 0.0;
+
+    result.position_max_cm = 0.0;
+    result.orientation_max_degrees = 0.0;
+    result.converged_count = 0;
+    result.unconverged_count = 0;
+    result.convergence_max_seconds = 0.0;
+    result.bStateValid = true;
+    result.setup_allocations = 0;
+
+    for (int iteration = 0; iteration < options.iterations; ++iteration)
+    {
+        const bool bMeasureAccuracy = iteration + 1 == options.iterations;
+
+        const long long setup_start_allocation_count = benchmark_get_allocation_count();
+        IPoseFilter *filter = pose_filter_factory(
+            recording.device_type,
+            combination.position_filter_type,
+            combination.orientation_filter_type,
+            constants);
+        result.setup_allocations = benchmark_get_allocation_count() - setup_start_allocation_count;
+
+        bool bWaitingForConvergence = false;
+        float reacquire_time = 0.f;
+
+        for (size_t sample_index = 0; sample_index < recording.samples.size(); ++sample_index)
+        {
+            const FilterSample &sample = recording.samples[sample_index];
+            PoseFilterPacket filter_packet;
+
+            const long long start_allocation_count = benchmark_get_allocation_count();
+            const long long start_allocated_bytes = benchmark_get_allocated_bytes();
+            const std::chrono::high_resolution_clock::time_point start_time = std::chrono::high_resolution_clock::now();
+
+            filter_space.createFilterPacket(sensor_packets[sample_index], filter, filter_packet);
+            filter->update(sample.delta_time, filter_packet);
+
+            const std::chrono::high_resolution_clock::time_point end_time = std::chrono::high_resolution_clock::now();
+            const double elapsed_ns = std::chrono::duration<double, std::nano>(end_time - start_time).count();
+
+            allocation_count += benchmark_get_allocation_count() - start_allocation_count;
+            allocated_bytes += benchmark_get_allocated_bytes() - start_allocated_bytes;
+            samples_ns.push_back(elapsed_ns);
+
+            if (!bMeasureAccuracy)
+            {
+                continue;
+            }
+
+            const bool bIsTracked = sample.projection_area_px_sqr > 0.f;
+            if (bIsTracked && sample_index > 0 && recording.samples[sample_index - 1].projection_area_px_sqr <= 0.f)
+            {
+                // A dropout that never converged before the next one started
+                if (bWaitingForConvergence)
+                {
+                    ++result.unconverged_count;
+                }
+
+                bWaitingForConvergence = true;
+                reacquire_time = sample.time;
+            }
+
+            if (!sample.bHasTruth)
+            {
+                continue;
+            }
+
+            bool bPositionConverged = true;
+            bool bOrientationConverged = true;
+
+            if (bHasPositionFilter && filter->getIsPositionStateValid())
+            {
+                const Eigen::Vector3f position = filter->getPositionCm();
+                const Eigen::Vector3f truth_position(sample.truth_position_cm[0], sample.truth_position_cm[1], sample.truth_position_cm[2]);
+                const double error_cm = static_cast<double>((position - truth_position).norm());
+
+                if (std::isfinite(error_cm))
+                {
+                    position_squared_error_sum += error_cm * error_cm;
+                    ++position_error_count;
+                    result.position_max_cm = std::max(result.position_max_cm, error_cm);
+
+                    if (!bIsTracked)
+                    {
+                        dropout_position_squared_error_sum += error_cm * error_cm;
+                        ++dropout_position_error_count;
+                    }
+                }
+                else
+                {
+                    result.bStateValid = false;
+                }
+
+                bPositionConverged = error_cm < k_converged_position_error_cm;
+            }
+
+            if (bHasOrientationFilter && filter->getIsOrientationStateValid())
+            {
+                const Eigen::Quaternionf orientation = filter->getOrientation();
+                const Eigen::Quaternionf truth_orientation(
+                    sample.truth_orientation[0], sample.truth_orientation[1], sample.truth_orientation[2], sample.truth_orientation[3]);
+                const double dot = std::min(static_cast<double>(fabsf(orientation.normalized().dot(truth_orientation))), 1.0);
+                const double error_degrees = 2.0 * acos(dot) * k_real64_radians_to_degreees;
+
+                if (std::isfinite(error_degrees))
+                {
+                    orientation_squared_error_sum += error_degrees * error_degrees;
+                    ++orientation_error_count;
+                    result.orientation_max_degrees = std::max(result.orientation_max_degrees, error_degrees);
+                }
+                else
+                {
+                    result.bStateValid = false;
+                }
+
+                bOrientationConverged = error_degrees < k_converged_orientation_error_degrees;
+            }
+
+            if (bWaitingForConvergence && bIsTracked && bPositionConverged && bOrientationConverged)
+            {
+                const double convergence_seconds = static_cast<double>(sample.time - reacquire_time);
+
+                convergence_sum += convergence_seconds;
+                result.convergence_max_seconds = std::max(result.convergence_max_seconds, convergence_seconds);
+                ++result.converged_count;
+                bWaitingForConvergence = false;
+            }
+        }
+
+        if (bMeasureAccuracy && bWaitingForConvergence)
+        {
+            ++result.unconverged_count;
+        }
+
+        delete filter;
+    }
+
+    const BenchmarkSummary summary_ns = benchmark_summarize(samples_ns);
+
+    result.position_filter_type = combination.position_filter_type;
+    result.orientation_filter_type = combination.orientation_filter_type;
+    result.updates = summary_ns.count;
+    result.mean_ns = summary_ns.mean;
+    result.p50_ns = summary_ns.p50;
+    result.p90_ns = summary_ns.p90;
+    result.p99_ns = summary_ns.p99;
+    result.max_ns = summary_ns.max;
+    result.allocations_per_update = (result.updates > 0) ? static_cast<double>(allocation_count) / static_cast<double>(result.updates) : 0.0;
+    result.allocated_bytes_per_update = (result.updates > 0) ? static_cast<double>(allocated_bytes) / static_cast<double>(result.updates) : 0.0;
+
+    result.bHasPositionError = position_error_count > 0;
+    result.position_rms_cm = result.bHasPositionError ? sqrt(position_squared_error_sum / position_error_count) : 0.0;
+    result.position_rms_during_dropout_cm =
+        (dropout_position_error_count > 0) ? sqrt(dropout_position_squared_error_sum / dropout_position_error_count) : -1.0;
+    result.bHasOrientationError = orientation_error_count > 0;
+    result.orientation_rms_degrees = result.bHasOrientationError ? sqrt(orientation_squared_error_sum / orientation_error_count) : 0.0;
+    result.convergence_mean_seconds = (result.converged_count > 0) ? convergence_sum / result.converged_count : 0.0;
+
+    return result;
+}
+
+static const char *get_device_name(const CommonDeviceState::eDeviceType device_type)
+{
+    return (device_type == CommonDeviceState::PSMove) ? "psmove" : "dualshock4";
+}
+
+static void write_results(
+    FILE *fp,
+    const BenchmarkOptions &options,
+    const FilterRecording &recording,
+    const std::vector<FilterResult> &results)
+{
+    fprintf(fp, "{\n");
+    fprintf(fp, "  \"label\": ");
+    benchmark_write_json_string(fp, options.label);
+    fprintf(fp, ",\n");
+    fprintf(fp, "  \"recording\": {\n");
+    fprintf(fp, "    \"source\": ");
+    benchmark_write_json_string(fp, recording.source);
+    fprintf(fp, ",\n");
+    fprintf(fp, "    \"truth\": ");
+    benchmark_write_json_string(fp, options.truth_filename.length() > 0 ? options.truth_filename : recording.source);
+    fprintf(fp, ",\n");
+    fprintf(fp, "    \"device\": \"%s\",\n", get_device_name(recording.device_type));
+    fprintf(fp, "    \"sample_count\": %d,\n", static_cast<int>(recording.samples.size()));
+    fprintf(fp, "    \"truth_sample_count\": %d,\n", recording.truth_sample_count);
+    fprintf(fp, "    \"mean_delta_time\": %.6f,\n", recording.mean_delta_time);
+    fprintf(fp, "    \"dropout_count\": %d\n", recording.dropout_count);
+    fprintf(fp, "  },\n");
+    fprintf(fp, "  \"iterations\": %d,\n", options.iterations);
+    fprintf(fp, "  \"converged_position_error_cm\": %.2f,\n", k_converged_position_error_cm);
+    fprintf(fp, "  \"converged_orientation_error_degrees\": %.2f,\n", k_converged_orientation_error_degrees);
+    fprintf(fp, "  \"filters\": [\n");
+
+    for (size_t result_index = 0; result_index < results.size(); ++result_index)
+    {
+        const FilterResult &result = results[result_index];
+
+        fprintf(fp, "    {\n");
+        fprintf(fp, "      \"position_filter\": ");
+        benchmark_write_json_string(fp, result.position_filter_type);
+        fprintf(fp, ",\n");
+        fprintf(fp, "      \"orientation_filter\": ");
+        benchmark_write_json_string(fp, result.orientation_filter_type);
+        fprintf(fp, ",\n");
+        fprintf(fp, "      \"updates\": %d,\n", static_cast<int>(result.updates));
+        fprintf(fp, "      \"update_ns\": { \"mean\": %.1f, \"p50\": %.1f, \"p90\": %.1f, \"p99\": %.1f, \"max\": %.1f },\n",
+            result.mean_ns, result.p50_ns, result.p90_ns, result.p99_ns, result.max_ns);
+        fprintf(fp, "      \"allocations_per_update\": %.2f,\n", result.allocations_per_update);
+        fprintf(fp, "      \"allocated_bytes_per_update\": %.1f,\n", result.allocated_bytes_per_update);
+        fprintf(fp, "      \"setup_allocations\": %lld,\n", result.setup_allocations);
+        fprintf(fp, "      \"state_valid\": %s,\n", result.bStateValid ? "true" : "false");
+
+        if (result.bHasPositionError)
+        {
+            fprintf(fp, "      \"position_error_cm\": { \"rms\": %.3f, \"rms_during_dropout\": ", result.position_rms_cm);
+            if (result.position_rms_during_dropout_cm >= 0.0)
+            {
+                fprintf(fp, "%.3f", result.position_rms_during_dropout_cm);
+            }
+            else
+            {
+                fprintf(fp, "null");
+            }
+            fprintf(fp, ", \"max\": %.3f },\n", result.position_max_cm);
+        }
+        else
+        {
+            fprintf(fp, "      \"position_error_cm\": null,\n");
+        }
+
+        if (result.bHasOrientationError)
+        {
+            fprintf(fp, "      \"orientation_error_degrees\": { \"rms\": %.3f, \"max\": %.3f },\n",
+                result.orientation_rms_degrees, result.orientation_max_degrees);
+        }
+        else
+        {
+            fprintf(fp, "      \"orientation_error_degrees\": null,\n");
+        }
+
+        fprintf(fp, "      \"convergence_after_dropout\": { \"converged\": %d, \"unconverged\": %d, \"mean_seconds\": %.3f, \"max_seconds\": %.3f }\n",
+            result.converged_count, result.unconverged_count, result.convergence_mean_seconds, result.convergence_max_seconds);
+        fprintf(fp, "    }%s\n", (result_index + 1 < results.size()) ? "," : "");
+    }
+
+    fprintf(fp, "  ]\n");
+    fprintf(fp, "}\n");
+}
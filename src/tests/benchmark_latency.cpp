@@ -0,0 +1,514 @@
+// Measures the latency from device input reaching the service to a client reading the pose, end to end.
+//
+// usage: benchmark_latency [--service <PSMoveService executable>] [--capture <device capture file>]
+//                          [--controllers <n>] [--trackers <n>] [--transport local|network|both]
+//                          [--duration <seconds>] [--warmup <seconds>] [--label <build name>] [--output <results.json>]
+//
+// A fresh service is started for every transport, with its config files in a scratch directory so it runs
+// headless and never touches the user's settings. Without a capture the service gets virtual trackers that
+// render synthetic frames of orbiting bulbs, and virtual controllers tracked in those frames. With a capture
+// (recorded with --record_capture) the service replays the recorded IMU reports and camera frames instead.
+//
+// For every new data frame the client reads the pose with PSM_GetControllerPose() and takes the time since
+// the frame's input reached the service (the earliest of its sensor arrival and optical capture timestamps).
+// That covers the device polling and tracker image processing, filtering, serialization, the socket hop and
+// the client's decode. Results are written as JSON so runs from different builds can be diffed.
+#include "PSMoveClient_CAPI.h"
+#include "benchmark_common.h"
+#include "benchmark_service.h"
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+//-- constants -----
+static const double k_default_duration_seconds = 10.0;
+static const double k_default_warmup_seconds = 3.0;
+static const int k_default_controller_count = 1;
+static const int k_default_tracker_count = 1;
+
+static const int k_connect_timeout_ms = 10000;
+static const int k_request_timeout_ms = 2000;
+
+//-- definitions -----
+enum eBenchmarkTransport
+{
+    _BenchmarkTransport_Local,      // Local stream/datagram sockets
+    _BenchmarkTransport_Network,    // TCP/UDP over loopback
+};
+
+struct BenchmarkOptions
+{
+    std::string service_path;
+    std::string capture_filename;
+    std::string label;
+    std::string output_filename;
+    std::vector<eBenchmarkTransport> transports;
+    int controller_count;
+    int tracker_count;
+    double duration_seconds;
+    double warmup_seconds;
+};
+
+struct TransportResult
+{
+    std::string name;
+    bool bSucceeded;
+    int controller_count;
+    double measured_seconds;
+    unsigned long long clock_sync_round_trip_us;
+    BenchmarkSummary input_to_pose;     // Input reached the service -> pose read by the client
+    BenchmarkSummary service;           // Input reached the service -> data frame sent
+    BenchmarkSummary transport;         // Data frame sent -> data frame received by the client
+    BenchmarkSummary client;            // Data frame received -> pose read by the client
+};
+
+//-- prototypes -----
+static bool parse_arguments(int argc, char *argv[], BenchmarkOptions &out_options);
+static TransportResult run_transport(const BenchmarkOptions &options, eBenchmarkTransport transport, const boost::filesystem::path &scratch_directory);
+static bool connect_to_service(eBenchmarkTransport transport, BenchmarkServiceProcess &process);
+static void write_results(FILE *fp, const BenchmarkOptions &options, const std::vector<TransportResult> &results);
+
+static const char *get_transport_name(eBenchmarkTransport transport)
+{
+    return (transport == _BenchmarkTransport_Local) ? "local" : "network";
+}
+
+//-- entry point -----
+int main(int argc, char *argv[])
+{
+    BenchmarkOptions options;
+    if (!parse_arguments(argc, argv, options))
+    {
+        printf("usage: benchmark_latency [--service <PSMoveService executable>] [--capture <device capture file>]\n");
+        printf("                         [--controllers <n>] [--trackers <n>] [--transport local|network|both]\n");
+        printf("                         [--duration <seconds>] [--warmup <seconds>] [--label <build name>] [--output <results.json>]\n");
+        return -1;
+    }
+
+    // The service is assumed to be installed next to the benchmark unless told otherwise
+    if (options.service_path.empty())
+    {
+        options.service_path = benchmark_get_default_service_path(argv[0]);
+    }
+
+    if (!boost::filesystem::exists(options.service_path))
+    {
+        fprintf(stderr, "Can't find the service executable: %s\n", options.service_path.c_str());
+        return -1;
+    }
+
+    // The service runs in its own working directory, so the capture path has to be absolute
+    if (!options.capture_filename.empty())
+    {
+        if (!boost::filesystem::exists(options.capture_filename))
+        {
+            fprintf(stderr, "Can't find the device capture: %s\n", options.capture_filename.c_str());
+            return -1;
+        }
+
+        options.capture_filename = boost::filesystem::system_complete(options.capture_filename).string();
+    }
+
+    const boost::filesystem::path scratch_directory =
+        boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("psmove-latency-%%%%-%%%%-%%%%");
+
+    // A replayed capture brings its own devices
+    BenchmarkDeviceSetup device_setup;
+    device_setup.virtual_controller_count = options.capture_filename.empty() ? options.controller_count : 0;
+    device_setup.virtual_tracker_count = options.capture_filename.empty() ? options.tracker_count : 0;
+    device_setup.virtual_hmd_count = 0;
+
+    boost::system::error_code ec;
+    boost::filesystem::create_directories(scratch_directory / "config", ec);
+    if (ec || !benchmark_write_service_config(scratch_directory / "config", device_setup))
+    {
+        fprintf(stderr, "Failed to write the service config to %s\n", scratch_directory.string().c_str());
+        return -1;
+    }
+
+    std::vector<TransportResult> results;
+    bool bAllSucceeded = true;
+
+    for (eBenchmarkTransport transport : options.transports)
+    {
+        fprintf(stderr, "Measuring the %s transport...\n", get_transport_name(transport));
+
+        TransportResult result = run_transport(options, transport, scratch_directory);
+        bAllSucceeded &= result.bSucceeded;
+
+        if (result.bSucceeded)
+        {
+            fprintf(stderr, "  %d frames, input to pose p50 %.0fus, p99 %.0fus\n",
+                static_cast<int>(result.input_to_pose.count), result.input_to_pose.p50, result.input_to_pose.p99);
+        }
+
+        results.push_back(result);
+    }
+
+    boost::filesystem::remove_all(scratch_directory, ec);
+
+    FILE *fp = stdout;
+    if (options.output_filename.length() > 0)
+    {
+        fp = fopen(options.output_filename.c_str(), "wt");
+        if (fp == nullptr)
+        {
+            fprintf(stderr, "Failed to open %s for writing\n", options.output_filename.c_str());
+            return -1;
+        }
+    }
+
+    write_results(fp, options, results);
+
+    if (fp != stdout)
+    {
+        fclose(fp);
+    }
+
+    return bAllSucceeded ? 0 : -1;
+}
+
+//-- setup -----
+static bool parse_arguments(int argc, char *argv[], BenchmarkOptions &out_options)
+{
+    std::string transport_name = "both";
+
+    out_options.label = "unlabeled";
+    out_options.controller_count = k_default_controller_count;
+    out_options.tracker_count = k_default_tracker_count;
+    out_options.duration_seconds = k_default_duration_seconds;
+    out_options.warmup_seconds = k_default_warmup_seconds;
+
+    for (int arg_index = 1; arg_index < argc; ++arg_index)
+    {
+        const char *arg = argv[arg_index];
+        const char *value = (arg_index + 1 < argc) ? argv[arg_index + 1] : nullptr;
+
+        if (value == nullptr)
+        {
+            return false;
+        }
+
+        if (strcmp(arg, "--service") == 0)
+        {
+            out_options.service_path = value;
+        }
+        else if (strcmp(arg, "--capture") == 0)
+        {
+            out_options.capture_filename = value;
+        }
+        else if (strcmp(arg, "--controllers") == 0)
+        {
+            out_options.controller_count = std::min(std::max(atoi(value), 1), PSMOVESERVICE_MAX_CONTROLLER_COUNT);
+        }
+        else if (strcmp(arg, "--trackers") == 0)
+        {
+            out_options.tracker_count = std::min(std::max(atoi(value), 1), PSMOVESERVICE_MAX_TRACKER_COUNT);
+        }
+        else if (strcmp(arg, "--transport") == 0)
+        {
+            transport_name = value;
+        }
+        else if (strcmp(arg, "--duration") == 0)
+        {
+            out_options.duration_seconds = std::max(atof(value), 1.0);
+        }
+        else if (strcmp(arg, "--warmup") == 0)
+        {
+            out_options.warmup_seconds = std::max(atof(value), 0.0);
+        }
+        else if (strcmp(arg, "--label") == 0)
+        {
+            out_options.label = value;
+        }
+        else if (strcmp(arg, "--output") == 0)
+        {
+            out_options.output_filename = value;
+        }
+        else
+        {
+            return false;
+        }
+
+        ++arg_index;
+    }
+
+    if (transport_name == "local" || transport_name == "both")
+    {
+#ifdef _WIN32
+        // The service only listens on local sockets where asio has them
+        fprintf(stderr, "Local sockets aren't available on Windows, only measuring the network transport\n");
+#else
+        out_options.transports.push_back(_BenchmarkTransport_Local);
+#endif
+    }
+    if (transport_name == "network" || transport_name == "both")
+    {
+        out_options.transports.push_back(_BenchmarkTransport_Network);
+    }
+
+    return !out_options.transports.empty();
+}
+
+//-- measurement -----
+static bool connect_to_service(eBenchmarkTransport transport, BenchmarkServiceProcess &process)
+{
+    const unsigned int initialize_flags =
+        (transport == _BenchmarkTransport_Network)
+        ? PSMInitializeFlags_disableLocalSockets
+        : PSMInitializeFlags_defaultOptions;
+    const std::chrono::steady_clock::time_point give_up_time =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(k_connect_timeout_ms);
+
+    // The service takes a moment to open its sockets, so keep trying until it answers
+    while (std::chrono::steady_clock::now() < give_up_time && benchmark_get_is_service_running(process))
+    {
+        if (PSM_InitializeAsyncWithFlags(PSMOVESERVICE_DEFAULT_ADDRESS, PSMOVESERVICE_DEFAULT_PORT, initialize_flags) == PSMResult_Error)
+        {
+            return false;
+        }
+
+        const std::chrono::steady_clock::time_point attempt_end_time =
+            std::chrono::steady_clock::now() + std::chrono::milliseconds(k_request_timeout_ms);
+
+        while (std::chrono::steady_clock::now() < attempt_end_time)
+        {
+            PSM_Update();
+
+            if (PSM_HasConnectionStatusChanged())
+            {
+                break;
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        if (PSM_GetIsConnected())
+        {
+            return true;
+        }
+
+        PSM_Shutdown();
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    }
+
+    return false;
+}
+
+static void add_sample(std::vector<double> &samples_us, unsigned long long start_usec, unsigned long long end_usec)
+{
+    if (start_usec != 0 && end_usec != 0)
+    {
+        samples_us.push_back(static_cast<double>(static_cast<long long>(end_usec - start_usec)));
+    }
+}
+
+static TransportResult run_transport(const BenchmarkOptions &options, eBenchmarkTransport transport, const boost::filesystem::path &scratch_directory)
+{
+    TransportResult result;
+    memset(&result.input_to_pose, 0, sizeof(BenchmarkSummary));
+    memset(&result.service, 0, sizeof(BenchmarkSummary));
+    memset(&result.transport, 0, sizeof(BenchmarkSummary));
+    memset(&result.client, 0, sizeof(BenchmarkSummary));
+    result.name = get_transport_name(transport);
+    result.bSucceeded = false;
+    result.controller_count = 0;
+    result.measured_seconds = 0.0;
+    result.clock_sync_round_trip_us = 0;
+
+    std::vector<std::string> service_args;
+    if (!options.capture_filename.empty())
+    {
+        service_args.push_back("--replay_capture");
+        service_args.push_back(options.capture_filename);
+    }
+
+    BenchmarkServiceProcess service;
+    if (!benchmark_start_service(options.service_path, scratch_directory, service_args, service))
+    {
+        fprintf(stderr, "Failed to start %s\n", options.service_path.c_str());
+        return result;
+    }
+
+    if (!connect_to_service(transport, service))
+    {
+        fprintf(stderr, "Failed to connect to the service%s\n",
+            benchmark_get_is_service_running(service) ? "" : " (it exited, is another PSMoveService already running?)");
+        benchmark_stop_service(service);
+        return result;
+    }
+
+    PSMControllerList controller_list;
+    memset(&controller_list, 0, sizeof(controller_list));
+    PSM_GetControllerList(&controller_list, k_request_timeout_ms);
+
+    for (int list_index = 0; list_index < controller_list.count; ++list_index)
+    {
+        const PSMControllerID controller_id = controller_list.controller_id[list_index];
+
+        PSM_AllocateControllerListener(controller_id);
+        PSM_StartControllerDataStream(controller_id, PSMStreamFlags_includePositionData, k_request_timeout_ms);
+    }
+    result.controller_count = controller_list.count;
+
+    if (controller_list.count == 0)
+    {
+        fprintf(stderr, "The service has no controllers\n");
+    }
+    else
+    {
+        // Let the filters settle and the clock offset get measured before any samples are taken
+        const std::chrono::steady_clock::time_point warmup_end_time =
+            std::chrono::steady_clock::now() + std::chrono::microseconds(static_cast<long long>(options.warmup_seconds * 1000000.0));
+        bool bIsClockSynced = false;
+
+        while (PSM_GetIsConnected() && (!bIsClockSynced || std::chrono::steady_clock::now() < warmup_end_time))
+        {
+            PSM_Update();
+
+            PSMLatencyTimestamps timestamps;
+            bIsClockSynced =
+                PSM_GetLatencyTimestamps(PSMDeviceCategory_Controller, controller_list.controller_id[0], &timestamps) == PSMResult_Success &&
+                timestamps.bIsClockSynced;
+
+            std::this_thread::yield();
+        }
+
+        std::vector<double> input_to_pose_us;
+        std::vector<double> service_us;
+        std::vector<double> transport_us;
+        std::vector<double> client_us;
+        unsigned long long last_consumed_usec[PSMOVESERVICE_MAX_CONTROLLER_COUNT];
+        memset(last_consumed_usec, 0, sizeof(last_consumed_usec));
+
+        const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+        const std::chrono::steady_clock::time_point end_time =
+            start_time + std::chrono::microseconds(static_cast<long long>(options.duration_seconds * 1000000.0));
+
+        // Spin rather than sleep so the client's own polling interval doesn't show up in the numbers
+        while (PSM_GetIsConnected() && std::chrono::steady_clock::now() < end_time)
+        {
+            PSM_Update();
+
+            for (int list_index = 0; list_index < controller_list.count; ++list_index)
+            {
+                const PSMControllerID controller_id = controller_list.controller_id[list_index];
+                PSMLatencyTimestamps timestamps;
+
+                if (PSM_GetLatencyTimestamps(PSMDeviceCategory_Controller, controller_id, &timestamps) != PSMResult_Success ||
+                    !timestamps.bIsClockSynced ||
+                    timestamps.ConsumedUsec == last_consumed_usec[controller_id])
+                {
+                    continue;
+                }
+                last_consumed_usec[controller_id] = timestamps.ConsumedUsec;
+
+                PSMPosef pose;
+                PSM_GetControllerPose(controller_id, &pose);
+                const unsigned long long pose_read_usec = PSM_GetClientTimeUsec();
+
+                unsigned long long input_usec = timestamps.SensorArrivalUsec;
+                if (timestamps.OpticalCaptureUsec != 0 && (input_usec == 0 || timestamps.OpticalCaptureUsec < input_usec))
+                {
+                    input_usec = timestamps.OpticalCaptureUsec;
+                }
+
+                add_sample(input_to_pose_us, input_usec, pose_read_usec);
+                add_sample(service_us, input_usec, timestamps.NetworkSendUsec);
+                add_sample(transport_us, timestamps.NetworkSendUsec, timestamps.ReceivedUsec);
+                add_sample(client_us, timestamps.ReceivedUsec, pose_read_usec);
+            }
+
+            std::this_thread::yield();
+        }
+
+        result.measured_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+        result.input_to_pose = benchmark_summarize(input_to_pose_us);
+        result.service = benchmark_summarize(service_us);
+        result.transport = benchmark_summarize(transport_us);
+        result.client = benchmark_summarize(client_us);
+
+        PSMLatencyStats latency_stats;
+        if (PSM_GetLatencyStats(PSMDeviceCategory_Controller, controller_list.controller_id[0], &latency_stats) == PSMResult_Success)
+        {
+            result.clock_sync_round_trip_us = latency_stats.ClockSyncRoundTripUsec;
+        }
+
+        result.bSucceeded = PSM_GetIsConnected() && result.input_to_pose.count > 0;
+        if (!result.bSucceeded)
+        {
+            fprintf(stderr, "No pose updates were measured (is a controller being tracked?)\n");
+        }
+    }
+
+    for (int list_index = 0; list_index < controller_list.count; ++list_index)
+    {
+        const PSMControllerID controller_id = controller_list.controller_id[list_index];
+
+        PSM_StopControllerDataStream(controller_id, k_request_timeout_ms);
+        PSM_FreeControllerListener(controller_id);
+    }
+
+    PSM_Shutdown();
+    benchmark_stop_service(service);
+
+    return result;
+}
+
+static void write_summary(FILE *fp, const char *name, const BenchmarkSummary &summary, const bool bIsLast)
+{
+    fprintf(fp, "      \"%s\": { \"mean\": %.1f, \"p50\": %.1f, \"p90\": %.1f, \"p99\": %.1f, \"max\": %.1f }%s\n",
+        name, summary.mean, summary.p50, summary.p90, summary.p99, summary.max, bIsLast ? "" : ",");
+}
+
+static void write_results(FILE *fp, const BenchmarkOptions &options, const std::vector<TransportResult> &results)
+{
+    fprintf(fp, "{\n");
+    fprintf(fp, "  \"label\": ");
+    benchmark_write_json_string(fp, options.label);
+    fprintf(fp, ",\n");
+    fprintf(fp, "  \"source\": ");
+    benchmark_write_json_string(fp, options.capture_filename.empty() ? std::string("synthetic") : options.capture_filename);
+    fprintf(fp, ",\n");
+    if (options.capture_filename.empty())
+    {
+        fprintf(fp, "  \"virtual_controllers\": %d,\n", options.controller_count);
+        fprintf(fp, "  \"virtual_trackers\": %d,\n", options.tracker_count);
+    }
+    fprintf(fp, "  \"duration_seconds\": %.1f,\n", options.duration_seconds);
+    fprintf(fp, "  \"transports\": [\n");
+
+    for (size_t result_index = 0; result_index < results.size(); ++result_index)
+    {
+        const TransportResult &result = results[result_index];
+        const double frames_per_second =
+            (result.measured_seconds > 0.0) ? static_cast<double>(result.input_to_pose.count) / result.measured_seconds : 0.0;
+
+        fprintf(fp, "    {\n");
+        fprintf(fp, "      \"name\": ");
+        benchmark_write_json_string(fp, result.name);
+        fprintf(fp, ",\n");
+        fprintf(fp, "      \"succeeded\": %s,\n", result.bSucceeded ? "true" : "false");
+        fprintf(fp, "      \"controllers\": %d,\n", result.controller_count);
+        fprintf(fp, "      \"frames\": %d,\n", static_cast<int>(result.input_to_pose.count));
+        fprintf(fp, "      \"frames_per_second\": %.1f,\n", frames_per_second);
+        fprintf(fp, "      \"clock_sync_round_trip_us\": %llu,\n", result.clock_sync_round_trip_us);
+        write_summary(fp, "input_to_pose_us", result.input_to_pose, false);
+        write_summary(fp, "service_us", result.service, false);
+        write_summary(fp, "transport_us", result.transport, false);
+        write_summary(fp, "client_us", result.client, true);
+        fprintf(fp, "    }%s\n", (result_index + 1 < results.size()) ? "," : "");
+    }
+
+    fprintf(fp, "  ]\n");
+    fprintf(fp, "}\n");
+}
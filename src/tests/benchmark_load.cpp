@@ -0,0 +1,1008 @@
+// Puts the service's network layer under load from many clients at once.
+//
+// usage: benchmark_load [--service <PSMoveService executable>] [--clients <n>] [--controllers <n>] [--hmds <n>]
+//                       [--trackers <n>] [--streams controllers,hmds,trackers] [--stream_flags position,physics,...]
+//                       [--requests controller_list,tracker_list,...] [--request_rate <requests per second per client>]
+//                       [--transport local|network] [--poll_interval_ms <ms>] [--duration <seconds>]
+//                       [--warmup <seconds>] [--label <build name>] [--output <results.json>]
+//
+// A service is started in a scratch config directory with virtual controllers, HMDs and trackers so it runs
+// headless. Every client is its own connection (a PSMoveClient with its own sockets) driven from its own thread,
+// the way separate applications would be. Each one subscribes to the data streams of every device in the chosen
+// categories and cycles through the chosen requests at a steady rate while the service is measured.
+//
+// Per client it reports the delivered frame rate, the drop rate (gaps in the data frames' sequence numbers,
+// which the service increments on every publish), the arrival jitter (standard deviation of the time between
+// two frames of a stream) and the round trip of the requests. The service's CPU use over the measurement
+// is read from the OS. Results are written as JSON so runs from different builds can be diffed.
+//
+// Frames are timestamped when the client thread's update() reads them, so the poll interval is part of
+// the jitter. Use --poll_interval_ms 0 to spin instead of sleeping between updates.
+#include "PSMoveClient.h"
+#include "PSMoveProtocol.pb.h"
+#include "benchmark_common.h"
+#include "benchmark_service.h"
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+//-- constants -----
+static const double k_default_duration_seconds = 10.0;
+static const double k_default_warmup_seconds = 2.0;
+static const double k_default_request_rate = 5.0;
+static const int k_default_client_count = 8;
+static const int k_default_controller_count = 4;
+static const int k_default_hmd_count = 1;
+static const int k_default_tracker_count = 1;
+static const int k_default_poll_interval_ms = 1;
+
+static const int k_connect_timeout_ms = 10000;
+static const int k_request_timeout_ms = 2000;
+
+//-- definitions -----
+enum eLoadRequestType
+{
+    _LoadRequest_ControllerList,
+    _LoadRequest_TrackerList,
+    _LoadRequest_HmdList,
+    _LoadRequest_TrackingSpace,
+    _LoadRequest_TrackerSettings,
+    _LoadRequest_ServiceVersion,
+
+    _LoadRequest_Count
+};
+static const char *k_load_request_names[_LoadRequest_Count] = {
+    "controller_list", "tracker_list", "hmd_list", "tracking_space", "tracker_settings", "service_version"
+};
+
+enum eLoadPhase
+{
+    _LoadPhase_Connecting,
+    _LoadPhase_Warmup,
+    _LoadPhase_Measuring,
+    _LoadPhase_Stopping,
+};
+
+struct LoadOptions
+{
+    std::string service_path;
+    std::string label;
+    std::string output_filename;
+    int client_count;
+    BenchmarkDeviceSetup device_setup;
+    bool bStreamControllers;
+    bool bStreamHmds;
+    bool bStreamTrackers;
+    unsigned int stream_flags;
+    std::vector<eLoadRequestType> request_mix;
+    double request_rate;
+    bool bUseLocalSockets;
+    int poll_interval_ms;
+    double duration_seconds;
+    double warmup_seconds;
+};
+
+/// Delivery of one device's data stream to one client
+struct LoadStreamStats
+{
+    bool bIsSubscribed;
+    bool bHasFrame;
+    int last_sequence_num;
+    unsigned long long last_received_usec;
+    unsigned long long frame_count;
+    unsigned long long dropped_count;
+    unsigned long long out_of_order_count;
+    // Running mean and variance of the time between frames (Welford)
+    unsigned long long interval_count;
+    double interval_mean_us;
+    double interval_m2;
+    double interval_max_us;
+
+    void clear_measurements();
+    void add_frame(int sequence_num, unsigned long long received_usec);
+    inline double get_jitter_us() const
+    { return (interval_count > 1) ? sqrt(interval_m2 / static_cast<double>(interval_count - 1)) : 0.0; }
+};
+
+/// One connection to the service, counting every data frame it receives
+class LoadClient : public PSMoveClient
+{
+public:
+    LoadClient(const std::string &host, const std::string &port);
+
+    void set_is_measuring(bool bIsMeasuring);
+    LoadStreamStats *get_stream_stats(PSMDeviceCategory device_category, int device_id);
+
+protected:
+    // IDataFrameListener
+    virtual void handle_data_frame(const PSMoveProtocol::DeviceOutputDataFrame *data_frame) override;
+
+private:
+    LoadStreamStats m_controller_streams[PSMOVESERVICE_MAX_CONTROLLER_COUNT];
+    LoadStreamStats m_tracker_streams[PSMOVESERVICE_MAX_TRACKER_COUNT];
+    LoadStreamStats m_hmd_streams[PSMOVESERVICE_MAX_HMD_COUNT];
+    bool m_bIsMeasuring;
+};
+
+struct LoadClientResult
+{
+    bool bConnected;
+    bool bSubscribed;
+    int stream_count;
+    unsigned long long frame_count;
+    unsigned long long dropped_count;
+    unsigned long long out_of_order_count;
+    double frames_per_second;
+    double drop_rate;
+    double jitter_us;           // Mean over the client's streams
+    double max_interval_us;
+    unsigned long long requests_sent;
+    unsigned long long responses_received;
+    unsigned long long request_errors;
+    std::vector<double> request_round_trips_us;
+};
+
+/// State shared between a client's thread and the main thread
+struct LoadClientContext
+{
+    const LoadOptions *options;
+    LoadClient *client;
+    std::thread thread;
+    LoadClientResult result;
+
+    // Send times of the requests still waiting for a response
+    std::map<PSMRequestID, unsigned long long> pending_request_send_usec;
+};
+
+//-- globals -----
+static std::atomic<int> g_load_phase(_LoadPhase_Connecting);
+static std::atomic<int> g_ready_client_count(0);
+static std::atomic<int> g_failed_client_count(0);
+
+//-- prototypes -----
+static bool parse_arguments(int argc, char *argv[], LoadOptions &out_options);
+static LoadClient *connect_client(const LoadOptions &options, const std::chrono::steady_clock::time_point &give_up_time);
+static void run_client(LoadClientContext *context);
+static void write_results(
+    FILE *fp, const LoadOptions &options, const std::vector<LoadClientContext *> &contexts,
+    double measured_seconds, bool bHasServiceCpu, double service_cpu_seconds);
+
+//-- entry point -----
+int main(int argc, char *argv[])
+{
+    LoadOptions options;
+    if (!parse_arguments(argc, argv, options))
+    {
+        printf("usage: benchmark_load [--service <PSMoveService executable>] [--clients <n>] [--controllers <n>] [--hmds <n>]\n");
+        printf("                      [--trackers <n>] [--streams controllers,hmds,trackers] [--stream_flags position,physics,...]\n");
+        printf("                      [--requests controller_list,tracker_list,...] [--request_rate <requests per second per client>]\n");
+        printf("                      [--transport local|network] [--poll_interval_ms <ms>] [--duration <seconds>]\n");
+        printf("                      [--warmup <seconds>] [--label <build name>] [--output <results.json>]\n");
+        return -1;
+    }
+
+    if (options.service_path.empty())
+    {
+        options.service_path = benchmark_get_default_service_path(argv[0]);
+    }
+
+    if (!boost::filesystem::exists(options.service_path))
+    {
+        fprintf(stderr, "Can't find the service executable: %s\n", options.service_path.c_str());
+        return -1;
+    }
+
+    const boost::filesystem::path scratch_directory =
+        boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("psmove-load-%%%%-%%%%-%%%%");
+
+    boost::system::error_code ec;
+    boost::filesystem::create_directories(scratch_directory / "config", ec);
+    if (ec || !benchmark_write_service_config(scratch_directory / "config", options.device_setup))
+    {
+        fprintf(stderr, "Failed to write the service config to %s\n", scratch_directory.string().c_str());
+        return -1;
+    }
+
+    BenchmarkServiceProcess service;
+    if (!benchmark_start_service(options.service_path, scratch_directory, std::vector<std::string>(), service))
+    {
+        fprintf(stderr, "Failed to start %s\n", options.service_path.c_str());
+        boost::filesystem::remove_all(scratch_directory, ec);
+        return -1;
+    }
+
+    // The service takes a moment to open its sockets, so wait until a first client gets in
+    const std::chrono::steady_clock::time_point connect_give_up_time =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(k_connect_timeout_ms);
+    std::vector<LoadClientContext *> contexts;
+    bool bSuccess = true;
+
+    while (static_cast<int>(contexts.size()) < options.client_count)
+    {
+        LoadClient *client = connect_client(options, connect_give_up_time);
+
+        if (client == nullptr || !benchmark_get_is_service_running(service))
+        {
+            fprintf(stderr, "Client %d failed to connect to the service%s\n", static_cast<int>(contexts.size()),
+                benchmark_get_is_service_running(service) ? "" : " (it exited, is another PSMoveService already running?)");
+            delete client;
+            bSuccess = false;
+            break;
+        }
+
+        // Value initialized, so the counters start at zero
+        LoadClientContext *context = new LoadClientContext();
+        context->options = &options;
+        context->client = client;
+        context->result.bConnected = true;
+        contexts.push_back(context);
+    }
+
+    double measured_seconds = 0.0;
+    double service_cpu_seconds = 0.0;
+    bool bHasServiceCpu = false;
+
+    if (bSuccess)
+    {
+        fprintf(stderr, "%d clients connected, subscribing...\n", options.client_count);
+
+        for (LoadClientContext *context : contexts)
+        {
+            context->thread = std::thread(run_client, context);
+        }
+
+        // Wait for every client to get its device lists and start its streams
+        const std::chrono::steady_clock::time_point ready_give_up_time =
+            std::chrono::steady_clock::now() + std::chrono::milliseconds(k_connect_timeout_ms);
+
+        while (g_ready_client_count + g_failed_client_count < options.client_count &&
+               std::chrono::steady_clock::now() < ready_give_up_time)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        g_load_phase = _LoadPhase_Warmup;
+        std::this_thread::sleep_for(std::chrono::microseconds(static_cast<long long>(options.warmup_seconds * 1000000.0)));
+
+        fprintf(stderr, "Measuring for %.1f seconds...\n", options.duration_seconds);
+
+        double start_cpu_seconds = 0.0, end_cpu_seconds = 0.0;
+        bHasServiceCpu = benchmark_get_service_cpu_seconds(service, start_cpu_seconds);
+
+        const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+        g_load_phase = _LoadPhase_Measuring;
+        std::this_thread::sleep_for(std::chrono::microseconds(static_cast<long long>(options.duration_seconds * 1000000.0)));
+        g_load_phase = _LoadPhase_Stopping;
+        measured_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+        bHasServiceCpu &= benchmark_get_service_cpu_seconds(service, end_cpu_seconds);
+        service_cpu_seconds = end_cpu_seconds - start_cpu_seconds;
+    }
+
+    g_load_phase = _LoadPhase_Stopping;
+    for (LoadClientContext *context : contexts)
+    {
+        if (context->thread.joinable())
+        {
+            context->thread.join();
+        }
+
+        context->client->shutdown();
+        delete context->client;
+        context->client = nullptr;
+    }
+
+    benchmark_stop_service(service);
+    boost::filesystem::remove_all(scratch_directory, ec);
+
+    if (bSuccess)
+    {
+        FILE *fp = stdout;
+        if (options.output_filename.length() > 0)
+        {
+            fp = fopen(options.output_filename.c_str(), "wt");
+            if (fp == nullptr)
+            {
+                fprintf(stderr, "Failed to open %s for writing\n", options.output_filename.c_str());
+                bSuccess = false;
+            }
+        }
+
+        if (fp != nullptr)
+        {
+            write_results(fp, options, contexts, measured_seconds, bHasServiceCpu, service_cpu_seconds);
+
+            if (fp != stdout)
+            {
+                fclose(fp);
+            }
+        }
+    }
+
+    for (LoadClientContext *context : contexts)
+    {
+        bSuccess &= context->result.bSubscribed;
+        delete context;
+    }
+
+    return bSuccess ? 0 : -1;
+}
+
+//-- setup -----
+static bool parse_name_list(const char *value, const char **names, const int name_count, std::vector<int> &out_indices)
+{
+    std::string list = value;
+    size_t start = 0;
+
+    while (start <= list.length())
+    {
+        size_t end = list.find(',', start);
+        if (end == std::string::npos)
+        {
+            end = list.length();
+        }
+
+        const std::string name = list.substr(start, end - start);
+        const char **found = std::find_if(names, names + name_count, [&name](const char *candidate) { return name == candidate; });
+
+        if (found == names + name_count)
+        {
+            fprintf(stderr, "Unknown name: %s\n", name.c_str());
+            return false;
+        }
+
+        out_indices.push_back(static_cast<int>(found - names));
+        start = end + 1;
+    }
+
+    return true;
+}
+
+static bool parse_arguments(int argc, char *argv[], LoadOptions &out_options)
+{
+    static const char *k_stream_names[] = { "controllers", "hmds", "trackers" };
+    static const char *k_stream_flag_names[] = { "position", "physics", "raw_sensor", "calibrated_sensor", "raw_tracker" };
+    static const unsigned int k_stream_flags[] = {
+        PSMStreamFlags_includePositionData, PSMStreamFlags_includePhysicsData, PSMStreamFlags_includeRawSensorData,
+        PSMStreamFlags_includeCalibratedSensorData, PSMStreamFlags_includeRawTrackerData
+    };
+
+    out_options.label = "unlabeled";
+    out_options.client_count = k_default_client_count;
+    out_options.device_setup.virtual_controller_count = k_default_controller_count;
+    out_options.device_setup.virtual_hmd_count = k_default_hmd_count;
+    out_options.device_setup.virtual_tracker_count = k_default_tracker_count;
+    out_options.bStreamControllers = true;
+    out_options.bStreamHmds = true;
+    out_options.bStreamTrackers = false;
+    out_options.stream_flags = PSMStreamFlags_includePositionData | PSMStreamFlags_includePhysicsData;
+    out_options.request_rate = k_default_request_rate;
+    out_options.bUseLocalSockets = true;
+    out_options.poll_interval_ms = k_default_poll_interval_ms;
+    out_options.duration_seconds = k_default_duration_seconds;
+    out_options.warmup_seconds = k_default_warmup_seconds;
+    for (int request_index = 0; request_index < _LoadRequest_Count; ++request_index)
+    {
+        out_options.request_mix.push_back(static_cast<eLoadRequestType>(request_index));
+    }
+
+    for (int arg_index = 1; arg_index < argc; ++arg_index)
+    {
+        const char *arg = argv[arg_index];
+        const char *value = (arg_index + 1 < argc) ? argv[arg_index + 1] : nullptr;
+
+        if (value == nullptr)
+        {
+            return false;
+        }
+
+        if (strcmp(arg, "--service") == 0)
+        {
+            out_options.service_path = value;
+        }
+        else if (strcmp(arg, "--clients") == 0)
+        {
+            out_options.client_count = std::max(atoi(value), 1);
+        }
+        else if (strcmp(arg, "--controllers") == 0)
+        {
+            out_options.device_setup.virtual_controller_count = std::min(std::max(atoi(value), 0), PSMOVESERVICE_MAX_CONTROLLER_COUNT);
+        }
+        else if (strcmp(arg, "--hmds") == 0)
+        {
+            out_options.device_setup.virtual_hmd_count = std::min(std::max(atoi(value), 0), PSMOVESERVICE_MAX_HMD_COUNT);
+        }
+        else if (strcmp(arg, "--trackers") == 0)
+        {
+            out_options.device_setup.virtual_tracker_count = std::min(std::max(atoi(value), 0), PSMOVESERVICE_MAX_TRACKER_COUNT);
+        }
+        else if (strcmp(arg, "--streams") == 0)
+        {
+            std::vector<int> streams;
+            if (!parse_name_list(value, k_stream_names, 3, streams))
+            {
+                return false;
+            }
+
+            out_options.bStreamControllers = std::find(streams.begin(), streams.end(), 0) != streams.end();
+            out_options.bStreamHmds = std::find(streams.begin(), streams.end(), 1) != streams.end();
+            out_options.bStreamTrackers = std::find(streams.begin(), streams.end(), 2) != streams.end();
+        }
+        else if (strcmp(arg, "--stream_flags") == 0)
+        {
+            std::vector<int> flags;
+            if (!parse_name_list(value, k_stream_flag_names, 5, flags))
+            {
+                return false;
+            }
+
+            out_options.stream_flags = 0;
+            for (int flag_index : flags)
+            {
+                out_options.stream_flags |= k_stream_flags[flag_index];
+            }
+        }
+        else if (strcmp(arg, "--requests") == 0)
+        {
+            std::vector<int> requests;
+            if (!parse_name_list(value, k_load_request_names, _LoadRequest_Count, requests))
+            {
+                return false;
+            }
+
+            out_options.request_mix.clear();
+            for (int request_index : requests)
+            {
+                out_options.request_mix.push_back(static_cast<eLoadRequestType>(request_index));
+            }
+        }
+        else if (strcmp(arg, "--request_rate") == 0)
+        {
+            out_options.request_rate = std::max(atof(value), 0.0);
+        }
+        else if (strcmp(arg, "--transport") == 0)
+        {
+            if (strcmp(value, "local") == 0)
+            {
+                out_options.bUseLocalSockets = true;
+            }
+            else if (strcmp(value, "network") == 0)
+            {
+                out_options.bUseLocalSockets = false;
+            }
+            else
+            {
+                return false;
+            }
+        }
+        else if (strcmp(arg, "--poll_interval_ms") == 0)
+        {
+            out_options.poll_interval_ms = std::max(atoi(value), 0);
+        }
+        else if (strcmp(arg, "--duration") == 0)
+        {
+            out_options.duration_seconds = std::max(atof(value), 1.0);
+        }
+        else if (strcmp(arg, "--warmup") == 0)
+        {
+            out_options.warmup_seconds = std::max(atof(value), 0.0);
+        }
+        else if (strcmp(arg, "--label") == 0)
+        {
+            out_options.label = value;
+        }
+        else if (strcmp(arg, "--output") == 0)
+        {
+            out_options.output_filename = value;
+        }
+        else
+        {
+            return false;
+        }
+
+        ++arg_index;
+    }
+
+    return true;
+}
+
+//-- load client -----
+void LoadStreamStats::clear_measurements()
+{
+    bHasFrame = false;
+    last_sequence_num = 0;
+    last_received_usec = 0;
+    frame_count = 0;
+    dropped_count = 0;
+    out_of_order_count = 0;
+    interval_count = 0;
+    interval_mean_us = 0.0;
+    interval_m2 = 0.0;
+    interval_max_us = 0.0;
+}
+
+void LoadStreamStats::add_frame(int sequence_num, unsigned long long received_usec)
+{
+    if (bHasFrame)
+    {
+        if (sequence_num <= last_sequence_num)
+        {
+            // Stale frame, the client drops these too
+            ++out_of_order_count;
+            return;
+        }
+
+        dropped_count += static_cast<unsigned long long>(sequence_num - last_sequence_num - 1);
+
+        const double interval_us = static_cast<double>(received_usec - last_received_usec);
+        const double delta_us = interval_us - interval_mean_us;
+
+        ++interval_count;
+        interval_mean_us += delta_us / static_cast<double>(interval_count);
+        interval_m2 += delta_us * (interval_us - interval_mean_us);
+        interval_max_us = std::max(interval_max_us, interval_us);
+    }
+
+    bHasFrame = true;
+    last_sequence_num = sequence_num;
+    last_received_usec = received_usec;
+    ++frame_count;
+}
+
+LoadClient::LoadClient(const std::string &host, const std::string &port)
+    : PSMoveClient(host, port)
+    , m_bIsMeasuring(false)
+{
+    memset(m_controller_streams, 0, sizeof(m_controller_streams));
+    memset(m_tracker_streams, 0, sizeof(m_tracker_streams));
+    memset(m_hmd_streams, 0, sizeof(m_hmd_streams));
+}
+
+void LoadClient::set_is_measuring(bool bIsMeasuring)
+{
+    if (bIsMeasuring && !m_bIsMeasuring)
+    {
+        for (LoadStreamStats &stream : m_controller_streams) stream.clear_measurements();
+        for (LoadStreamStats &stream : m_tracker_streams) stream.clear_measurements();
+        for (LoadStreamStats &stream : m_hmd_streams) stream.clear_measurements();
+    }
+
+    m_bIsMeasuring = bIsMeasuring;
+}
+
+LoadStreamStats *LoadClient::get_stream_stats(PSMDeviceCategory device_category, int device_id)
+{
+    switch (device_category)
+    {
+    case PSMDeviceCategory_Controller:
+        return (device_id >= 0 && device_id < PSMOVESERVICE_MAX_CONTROLLER_COUNT) ? &m_controller_streams[device_id] : nullptr;
+    case PSMDeviceCategory_Tracker:
+        return (device_id >= 0 && device_id < PSMOVESERVICE_MAX_TRACKER_COUNT) ? &m_tracker_streams[device_id] : nullptr;
+    case PSMDeviceCategory_Hmd:
+        return (device_id >= 0 && device_id < PSMOVESERVICE_MAX_HMD_COUNT) ? &m_hmd_streams[device_id] : nullptr;
+    default:
+        return nullptr;
+    }
+}
+
+void LoadClient::handle_data_frame(const PSMoveProtocol::DeviceOutputDataFrame *data_frame)
+{
+    if (m_bIsMeasuring)
+    {
+        const unsigned long long received_usec = get_client_time_usec();
+        LoadStreamStats *stream = nullptr;
+        int sequence_num = 0;
+
+        switch (data_frame->device_category())
+        {
+        case PSMoveProtocol::DeviceOutputDataFrame::CONTROLLER:
+            stream = get_stream_stats(PSMDeviceCategory_Controller, data_frame->controller_data_packet().controller_id());
+            sequence_num = data_frame->controller_data_packet().sequence_num();
+            break;
+        case PSMoveProtocol::DeviceOutputDataFrame::TRACKER:
+            stream = get_stream_stats(PSMDeviceCategory_Tracker, data_frame->tracker_data_packet().tracker_id());
+            sequence_num = data_frame->tracker_data_packet().sequence_num();
+            break;
+        case PSMoveProtocol::DeviceOutputDataFrame::HMD:
+            stream = get_stream_stats(PSMDeviceCategory_Hmd, data_frame->hmd_data_packet().hmd_id());
+            sequence_num = data_frame->hmd_data_packet().sequence_num();
+            break;
+        default:
+            break;
+        }
+
+        if (stream != nullptr && stream->bIsSubscribed)
+        {
+            stream->add_frame(sequence_num, received_usec);
+        }
+    }
+
+    PSMoveClient::handle_data_frame(data_frame);
+}
+
+//-- client threads -----
+struct BlockingResponse
+{
+    bool bReceived;
+    PSMResponseMessage response;
+};
+
+static void PSM_CALL handle_blocking_response(const PSMResponseMessage *response, void *userdata)
+{
+    BlockingResponse *blocking_response = reinterpret_cast<BlockingResponse *>(userdata);
+
+    blocking_response->response = *response;
+    blocking_response->bReceived = true;
+}
+
+static bool wait_for_response(LoadClient *client, PSMRequestID request_id, PSMResponseMessage *out_response)
+{
+    BlockingResponse blocking_response;
+    blocking_response.bReceived = false;
+
+    if (request_id == PSM_INVALID_REQUEST_ID)
+    {
+        return false;
+    }
+
+    client->register_callback(request_id, handle_blocking_response, &blocking_response);
+
+    const std::chrono::steady_clock::time_point give_up_time =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(k_request_timeout_ms);
+
+    while (!blocking_response.bReceived && client->getIsConnected() && std::chrono::steady_clock::now() < give_up_time)
+    {
+        client->update();
+        client->process_messages();
+
+        if (!blocking_response.bReceived)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    if (!blocking_response.bReceived)
+    {
+        client->cancel_callback(request_id);
+        return false;
+    }
+
+    if (out_response != nullptr)
+    {
+        *out_response = blocking_response.response;
+    }
+
+    return blocking_response.response.result_code == PSMResult_Success;
+}
+
+static LoadClient *connect_client(const LoadOptions &options, const std::chrono::steady_clock::time_point &give_up_time)
+{
+    while (std::chrono::steady_clock::now() < give_up_time)
+    {
+        LoadClient *client = new LoadClient(PSMOVESERVICE_DEFAULT_ADDRESS, PSMOVESERVICE_DEFAULT_PORT);
+
+        if (client->startup(_log_severity_level_warning, false, options.bUseLocalSockets))
+        {
+            const std::chrono::steady_clock::time_point attempt_end_time =
+                std::chrono::steady_clock::now() + std::chrono::milliseconds(k_request_timeout_ms);
+
+            while (!client->pollHasConnectionStatusChanged() && std::chrono::steady_clock::now() < attempt_end_time)
+            {
+                client->update();
+                client->process_messages();
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+
+            if (client->getIsConnected())
+            {
+                return client;
+            }
+        }
+
+        client->shutdown();
+        delete client;
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    }
+
+    return nullptr;
+}
+
+static bool subscribe_client(LoadClientContext *context)
+{
+    const LoadOptions &options = *context->options;
+    LoadClient *client = context->client;
+    PSMResponseMessage response;
+    bool bSuccess = true;
+
+    if (options.bStreamControllers && wait_for_response(client, client->get_controller_list(), &response))
+    {
+        for (int list_index = 0; list_index < response.payload.controller_list.count; ++list_index)
+        {
+            const PSMControllerID controller_id = response.payload.controller_list.controller_id[list_index];
+
+            client->allocate_controller_listener(controller_id);
+            client->get_stream_stats(PSMDeviceCategory_Controller, controller_id)->bIsSubscribed =
+                wait_for_response(client, client->start_controller_data_stream(controller_id, options.stream_flags), nullptr);
+            bSuccess &= client->get_stream_stats(PSMDeviceCategory_Controller, controller_id)->bIsSubscribed;
+            ++context->result.stream_count;
+        }
+    }
+
+    if (options.bStreamHmds && wait_for_response(client, client->get_hmd_list(), &response))
+    {
+        for (int list_index = 0; list_index < response.payload.hmd_list.count; ++list_index)
+        {
+            const PSMHmdID hmd_id = response.payload.hmd_list.hmd_id[list_index];
+
+            client->allocate_hmd_listener(hmd_id);
+            client->get_stream_stats(PSMDeviceCategory_Hmd, hmd_id)->bIsSubscribed =
+                wait_for_response(client, client->start_hmd_data_stream(hmd_id, options.stream_flags), nullptr);
+            bSuccess &= client->get_stream_stats(PSMDeviceCategory_Hmd, hmd_id)->bIsSubscribed;
+            ++context->result.stream_count;
+        }
+    }
+
+    if (options.bStreamTrackers && wait_for_response(client, client->get_tracker_list(), &response))
+    {
+        for (int list_index = 0; list_index < response.payload.tracker_list.count; ++list_index)
+        {
+            const PSMClientTrackerInfo &tracker_info = response.payload.tracker_list.trackers[list_index];
+
+            client->allocate_tracker_listener(tracker_info);
+            client->get_stream_stats(PSMDeviceCategory_Tracker, tracker_info.tracker_id)->bIsSubscribed =
+                wait_for_response(client, client->start_tracker_data_stream(tracker_info.tracker_id), nullptr);
+            bSuccess &= client->get_stream_stats(PSMDeviceCategory_Tracker, tracker_info.tracker_id)->bIsSubscribed;
+            ++context->result.stream_count;
+        }
+    }
+
+    return bSuccess && context->result.stream_count > 0;
+}
+
+static void PSM_CALL handle_load_response(const PSMResponseMessage *response, void *userdata)
+{
+    LoadClientContext *context = reinterpret_cast<LoadClientContext *>(userdata);
+    auto pending_request = context->pending_request_send_usec.find(response->request_id);
+
+    if (pending_request != context->pending_request_send_usec.end())
+    {
+        const unsigned long long round_trip_usec = PSMoveClient::get_client_time_usec() - pending_request->second;
+
+        context->pending_request_send_usec.erase(pending_request);
+        context->result.request_round_trips_us.push_back(static_cast<double>(round_trip_usec));
+        ++context->result.responses_received;
+
+        if (response->result_code != PSMResult_Success)
+        {
+            ++context->result.request_errors;
+        }
+    }
+}
+
+static PSMRequestID send_load_request(LoadClient *client, eLoadRequestType request_type)
+{
+    switch (request_type)
+    {
+    case _LoadRequest_ControllerList:
+        return client->get_controller_list();
+    case _LoadRequest_TrackerList:
+        return client->get_tracker_list();
+    case _LoadRequest_HmdList:
+        return client->get_hmd_list();
+    case _LoadRequest_TrackingSpace:
+        return client->get_tracking_space_settings();
+    case _LoadRequest_TrackerSettings:
+        {
+            // Settings of the first tracker as seen by the first controller, like the config tool asks for them
+            RequestPtr request(new PSMoveProtocol::Request());
+            request->set_type(PSMoveProtocol::Request_RequestType_GET_TRACKER_SETTINGS);
+            request->mutable_request_get_tracker_settings()->set_tracker_id(0);
+            request->mutable_request_get_tracker_settings()->set_device_id(0);
+            request->mutable_request_get_tracker_settings()->set_device_category(
+                PSMoveProtocol::Request_RequestGetTrackerSettings_DeviceCategory_CONTROLLER);
+
+            return client->send_opaque_request(&request);
+        }
+    case _LoadRequest_ServiceVersion:
+        return client->get_service_version();
+    default:
+        return PSM_INVALID_REQUEST_ID;
+    }
+}
+
+static void run_client(LoadClientContext *context)
+{
+    const LoadOptions &options = *context->options;
+    LoadClient *client = context->client;
+
+    context->result.bSubscribed = subscribe_client(context);
+    if (context->result.bSubscribed)
+    {
+        ++g_ready_client_count;
+    }
+    else
+    {
+        ++g_failed_client_count;
+    }
+
+    const long long request_interval_usec =
+        (options.request_rate > 0.0 && !options.request_mix.empty())
+        ? static_cast<long long>(1000000.0 / options.request_rate)
+        : 0;
+    unsigned long long next_request_usec = 0;
+    size_t next_request_index = 0;
+    bool bWasMeasuring = false;
+
+    while (g_load_phase != _LoadPhase_Stopping && client->getIsConnected())
+    {
+        const bool bIsMeasuring = g_load_phase == _LoadPhase_Measuring;
+        const unsigned long long now_usec = PSMoveClient::get_client_time_usec();
+
+        if (bIsMeasuring != bWasMeasuring)
+        {
+            client->set_is_measuring(bIsMeasuring);
+            bWasMeasuring = bIsMeasuring;
+            next_request_usec = now_usec;
+        }
+
+        // Requests go out at a steady rate, cycling through the mix
+        if (bIsMeasuring && request_interval_usec > 0 && now_usec >= next_request_usec)
+        {
+            const eLoadRequestType request_type = options.request_mix[next_request_index];
+            const PSMRequestID request_id = send_load_request(client, request_type);
+
+            if (request_id != PSM_INVALID_REQUEST_ID)
+            {
+                context->pending_request_send_usec[request_id] = now_usec;
+                client->register_callback(request_id, handle_load_response, context);
+                ++context->result.requests_sent;
+            }
+
+            next_request_index = (next_request_index + 1) % options.request_mix.size();
+            next_request_usec += request_interval_usec;
+        }
+
+        client->update();
+        client->process_messages();
+
+        if (options.poll_interval_ms > 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(options.poll_interval_ms));
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    client->set_is_measuring(false);
+    context->result.bConnected = client->getIsConnected();
+
+    // Gather the stream totals before the callbacks go away with the client
+    double jitter_total_us = 0.0;
+    int jitter_stream_count = 0;
+
+    for (int category = PSMDeviceCategory_Controller; category <= PSMDeviceCategory_Hmd; ++category)
+    {
+        const int device_count =
+            (category == PSMDeviceCategory_Controller) ? PSMOVESERVICE_MAX_CONTROLLER_COUNT :
+            (category == PSMDeviceCategory_Tracker) ? PSMOVESERVICE_MAX_TRACKER_COUNT :
+            PSMOVESERVICE_MAX_HMD_COUNT;
+
+        for (int device_id = 0; device_id < device_count; ++device_id)
+        {
+            const LoadStreamStats *stream = client->get_stream_stats(static_cast<PSMDeviceCategory>(category), device_id);
+
+            if (stream != nullptr && stream->bIsSubscribed)
+            {
+                context->result.frame_count += stream->frame_count;
+                context->result.dropped_count += stream->dropped_count;
+                context->result.out_of_order_count += stream->out_of_order_count;
+                context->result.max_interval_us = std::max(context->result.max_interval_us, stream->interval_max_us);
+                jitter_total_us += stream->get_jitter_us();
+                ++jitter_stream_count;
+            }
+        }
+    }
+
+    if (jitter_stream_count > 0)
+    {
+        context->result.jitter_us = jitter_total_us / static_cast<double>(jitter_stream_count);
+    }
+
+    for (auto &pending_request : context->pending_request_send_usec)
+    {
+        client->cancel_callback(pending_request.first);
+    }
+}
+
+//-- results -----
+static void write_results(
+    FILE *fp, const LoadOptions &options, const std::vector<LoadClientContext *> &contexts,
+    double measured_seconds, bool bHasServiceCpu, double service_cpu_seconds)
+{
+    std::vector<double> frame_rates;
+    std::vector<double> jitters_us;
+    std::vector<double> round_trips_us;
+    unsigned long long total_frames = 0;
+    unsigned long long total_dropped = 0;
+
+    // Per client rates first, they're also summarized across clients
+    for (LoadClientContext *context : contexts)
+    {
+        LoadClientResult &result = context->result;
+        const unsigned long long expected_frames = result.frame_count + result.dropped_count;
+
+        result.frames_per_second = (measured_seconds > 0.0) ? static_cast<double>(result.frame_count) / measured_seconds : 0.0;
+        result.drop_rate = (expected_frames > 0) ? static_cast<double>(result.dropped_count) / static_cast<double>(expected_frames) : 0.0;
+
+        frame_rates.push_back(result.frames_per_second);
+        jitters_us.push_back(result.jitter_us);
+        round_trips_us.insert(round_trips_us.end(), result.request_round_trips_us.begin(), result.request_round_trips_us.end());
+        total_frames += result.frame_count;
+        total_dropped += result.dropped_count;
+    }
+
+    const BenchmarkSummary frame_rate_summary = benchmark_summarize(frame_rates);
+    const BenchmarkSummary jitter_summary = benchmark_summarize(jitters_us);
+    const BenchmarkSummary round_trip_summary = benchmark_summarize(round_trips_us);
+
+    fprintf(fp, "{\n");
+    fprintf(fp, "  \"label\": ");
+    benchmark_write_json_string(fp, options.label);
+    fprintf(fp, ",\n");
+    fprintf(fp, "  \"transport\": \"%s\",\n", options.bUseLocalSockets ? "local" : "network");
+    fprintf(fp, "  \"clients\": %d,\n", options.client_count);
+    fprintf(fp, "  \"virtual_controllers\": %d,\n", options.device_setup.virtual_controller_count);
+    fprintf(fp, "  \"virtual_hmds\": %d,\n", options.device_setup.virtual_hmd_count);
+    fprintf(fp, "  \"virtual_trackers\": %d,\n", options.device_setup.virtual_tracker_count);
+    fprintf(fp, "  \"request_rate\": %.1f,\n", options.request_rate);
+    fprintf(fp, "  \"poll_interval_ms\": %d,\n", options.poll_interval_ms);
+    fprintf(fp, "  \"measured_seconds\": %.2f,\n", measured_seconds);
+    if (bHasServiceCpu && measured_seconds > 0.0)
+    {
+        fprintf(fp, "  \"service_cpu_percent\": %.1f,\n", 100.0 * service_cpu_seconds / measured_seconds);
+    }
+    else
+    {
+        fprintf(fp, "  \"service_cpu_percent\": null,\n");
+    }
+    fprintf(fp, "  \"frames_per_second\": { \"min\": %.1f, \"mean\": %.1f, \"max\": %.1f },\n",
+        frame_rate_summary.min, frame_rate_summary.mean, frame_rate_summary.max);
+    fprintf(fp, "  \"drop_rate\": %.6f,\n",
+        (total_frames + total_dropped > 0) ? static_cast<double>(total_dropped) / static_cast<double>(total_frames + total_dropped) : 0.0);
+    fprintf(fp, "  \"jitter_us\": { \"mean\": %.1f, \"max\": %.1f },\n", jitter_summary.mean, jitter_summary.max);
+    fprintf(fp, "  \"request_round_trip_us\": { \"count\": %d, \"mean\": %.1f, \"p50\": %.1f, \"p99\": %.1f, \"max\": %.1f },\n",
+        static_cast<int>(round_trip_summary.count), round_trip_summary.mean, round_trip_summary.p50, round_trip_summary.p99, round_trip_summary.max);
+    fprintf(fp, "  \"per_client\": [\n");
+
+    for (size_t client_index = 0; client_index < contexts.size(); ++client_index)
+    {
+        const LoadClientResult &result = contexts[client_index]->result;
+        std::vector<double> client_round_trips_us = result.request_round_trips_us;
+        const BenchmarkSummary client_round_trip_summary = benchmark_summarize(client_round_trips_us);
+
+        fprintf(fp, "    { \"client\": %d, \"connected\": %s, \"subscribed\": %s, \"streams\": %d, ",
+            static_cast<int>(client_index), result.bConnected ? "true" : "false", result.bSubscribed ? "true" : "false", result.stream_count);
+        fprintf(fp, "\"frames\": %llu, \"frames_per_second\": %.1f, \"dropped\": %llu, \"drop_rate\": %.6f, \"out_of_order\": %llu, ",
+            result.frame_count, result.frames_per_second, result.dropped_count, result.drop_rate, result.out_of_order_count);
+        fprintf(fp, "\"jitter_us\": %.1f, \"max_interval_us\": %.1f, ", result.jitter_us, result.max_interval_us);
+        fprintf(fp, "\"requests\": %llu, \"responses\": %llu, \"request_errors\": %llu, \"request_round_trip_p99_us\": %.1f }%s\n",
+            result.requests_sent, result.responses_received, result.request_errors, client_round_trip_summary.p99,
+            (client_index + 1 < contexts.size()) ? "," : "");
+    }
+
+    fprintf(fp, "  ]\n");
+    fprintf(fp, "}\n");
+}
@@ -0,0 +1,325 @@
+//-- includes -----
+#include "benchmark_service.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+//-- constants -----
+static const int k_service_stop_timeout_ms = 5000;
+
+// Config versions of the files written into the scratch config directory.
+// Keep these in sync with the CONFIG_VERSION of the matching config classes in PSMoveService.
+static const int k_controller_manager_config_version = 1;
+static const int k_tracker_manager_config_version = 2;
+static const int k_hmd_manager_config_version = 1;
+static const int k_virtual_controller_config_version = 1;
+static const int k_virtual_tracker_config_version = 1;
+static const int k_virtual_hmd_config_version = 1;
+
+// Layout of the synthetic scene: one orbiting bulb per tracked device, side by side in front of the trackers.
+// Every bulb needs its own tracking color, so only the first few devices get one.
+static const char *k_tracking_color_names[] = { "magenta", "cyan", "yellow", "red", "green", "blue" };
+static const int k_tracking_color_count = static_cast<int>(sizeof(k_tracking_color_names) / sizeof(k_tracking_color_names[0]));
+static const float k_scene_depth_cm = 150.f;
+static const float k_scene_bulb_spacing_cm = 30.f;
+static const float k_scene_orbit_radius_cm = 8.f;
+static const float k_tracker_spacing_cm = 30.f;
+
+//-- private methods -----
+static bool write_config_file(const boost::filesystem::path &config_directory, const std::string &name, const boost::property_tree::ptree &pt)
+{
+    try
+    {
+        boost::property_tree::write_json((config_directory / (name + ".json")).string(), pt);
+    }
+    catch (boost::property_tree::json_parser_error &error)
+    {
+        fprintf(stderr, "%s\n", error.what());
+        return false;
+    }
+
+    return true;
+}
+
+static float get_centered_offset(const int index, const int count)
+{
+    return static_cast<float>(index) - static_cast<float>(count - 1) / 2.f;
+}
+
+//-- public interface -----
+std::string benchmark_get_default_service_path(const char *argv0)
+{
+    boost::filesystem::path service_path = boost::filesystem::system_complete(argv0).parent_path();
+#ifdef _WIN32
+    service_path /= "PSMoveService.exe";
+#else
+    service_path /= "PSMoveService";
+#endif
+
+    return service_path.string();
+}
+
+bool benchmark_write_service_config(const boost::filesystem::path &config_directory, const BenchmarkDeviceSetup &setup)
+{
+    const int tracked_device_count = std::min(setup.virtual_controller_count + setup.virtual_hmd_count, k_tracking_color_count);
+    bool bSuccess = true;
+
+    {
+        boost::property_tree::ptree pt;
+        pt.put("version", k_controller_manager_config_version);
+        pt.put("virtual_controller_count", setup.virtual_controller_count);
+        bSuccess &= write_config_file(config_directory, "ControllerManagerConfig", pt);
+    }
+
+    {
+        boost::property_tree::ptree pt;
+        pt.put("version", k_tracker_manager_config_version);
+        pt.put("virtual_tracker_count", setup.virtual_tracker_count);
+        bSuccess &= write_config_file(config_directory, "TrackerManagerConfig", pt);
+    }
+
+    {
+        boost::property_tree::ptree pt;
+        pt.put("version", k_hmd_manager_config_version);
+        pt.put("virtual_hmd_count", setup.virtual_hmd_count);
+        bSuccess &= write_config_file(config_directory, "HMDManagerConfig", pt);
+    }
+
+    // Each virtual device is tracked by the color of its own bulb, controllers first
+    for (int controller_index = 0; controller_index < setup.virtual_controller_count; ++controller_index)
+    {
+        const int color_index = controller_index;
+        boost::property_tree::ptree pt;
+
+        pt.put("is_valid", true);
+        pt.put("version", k_virtual_controller_config_version);
+        if (color_index < tracked_device_count)
+        {
+            pt.put("tracking_color", k_tracking_color_names[color_index]);
+        }
+        bSuccess &= write_config_file(config_directory, "VirtualController_" + std::to_string(controller_index), pt);
+    }
+
+    for (int hmd_index = 0; hmd_index < setup.virtual_hmd_count; ++hmd_index)
+    {
+        const int color_index = setup.virtual_controller_count + hmd_index;
+        boost::property_tree::ptree pt;
+
+        pt.put("is_valid", true);
+        pt.put("version", k_virtual_hmd_config_version);
+        if (color_index < tracked_device_count)
+        {
+            pt.put("tracking_color", k_tracking_color_names[color_index]);
+        }
+        bSuccess &= write_config_file(config_directory, "VirtualHMD__" + std::to_string(hmd_index), pt);
+    }
+
+    // The trackers stand side by side and all look down +Z at the bulbs
+    for (int tracker_index = 0; tracker_index < setup.virtual_tracker_count; ++tracker_index)
+    {
+        boost::property_tree::ptree pt;
+
+        pt.put("is_valid", true);
+        pt.put("version", k_virtual_tracker_config_version);
+        pt.put("pose.position.x", get_centered_offset(tracker_index, setup.virtual_tracker_count) * k_tracker_spacing_cm);
+        pt.put("scene.object_count", tracked_device_count);
+
+        for (int object_index = 0; object_index < tracked_device_count; ++object_index)
+        {
+            boost::property_tree::ptree object_pt;
+
+            object_pt.put("shape", "sphere");
+            object_pt.put("tracking_color", k_tracking_color_names[object_index]);
+            object_pt.put("motion", "orbit");
+            object_pt.put("center.x", get_centered_offset(object_index, tracked_device_count) * k_scene_bulb_spacing_cm);
+            object_pt.put("center.y", 0.f);
+            object_pt.put("center.z", k_scene_depth_cm);
+            object_pt.put("orbit_radius", k_scene_orbit_radius_cm);
+
+            pt.add_child("scene.object_" + std::to_string(object_index), object_pt);
+        }
+
+        bSuccess &= write_config_file(config_directory, "VirtualTrackerConfig_VirtualTracker_" + std::to_string(tracker_index), pt);
+    }
+
+    return bSuccess;
+}
+
+bool benchmark_start_service(
+    const std::string &service_path,
+    const boost::filesystem::path &scratch_directory,
+    const std::vector<std::string> &extra_args,
+    BenchmarkServiceProcess &out_process)
+{
+    std::vector<std::string> args;
+    args.push_back(service_path);
+    args.push_back("--log_level");
+    args.push_back("warning");
+    args.push_back("--working_directory");
+    args.push_back(scratch_directory.string());
+    args.push_back("--config_directory");
+    args.push_back((scratch_directory / "config").string());
+    args.insert(args.end(), extra_args.begin(), extra_args.end());
+
+    out_process.bIsRunning = false;
+
+#ifdef _WIN32
+    std::string command_line;
+    for (const std::string &arg : args)
+    {
+        command_line += "\"" + arg + "\" ";
+    }
+
+    STARTUPINFOA startup_info;
+    PROCESS_INFORMATION process_info;
+    memset(&startup_info, 0, sizeof(startup_info));
+    startup_info.cb = sizeof(startup_info);
+
+    if (CreateProcessA(
+            service_path.c_str(), &command_line[0], nullptr, nullptr, FALSE, 0, nullptr, nullptr,
+            &startup_info, &process_info))
+    {
+        CloseHandle(process_info.hThread);
+        out_process.process_handle = process_info.hProcess;
+        out_process.bIsRunning = true;
+    }
+#else
+    std::vector<char *> argv;
+    for (const std::string &arg : args)
+    {
+        argv.push_back(const_cast<char *>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    out_process.pid = fork();
+    if (out_process.pid == 0)
+    {
+        execv(service_path.c_str(), argv.data());
+        _exit(127);
+    }
+
+    out_process.bIsRunning = out_process.pid > 0;
+#endif
+
+    return out_process.bIsRunning;
+}
+
+bool benchmark_get_is_service_running(BenchmarkServiceProcess &process)
+{
+    if (process.bIsRunning)
+    {
+#ifdef _WIN32
+        process.bIsRunning = WaitForSingleObject(process.process_handle, 0) == WAIT_TIMEOUT;
+#else
+        int status = 0;
+        process.bIsRunning = waitpid(process.pid, &status, WNOHANG) == 0;
+#endif
+    }
+
+    return process.bIsRunning;
+}
+
+bool benchmark_get_service_cpu_seconds(const BenchmarkServiceProcess &process, double &out_cpu_seconds)
+{
+    bool bSuccess = false;
+
+    if (process.bIsRunning)
+    {
+#if defined(_WIN32)
+        FILETIME creation_time, exit_time, kernel_time, user_time;
+
+        if (GetProcessTimes(process.process_handle, &creation_time, &exit_time, &kernel_time, &user_time))
+        {
+            // FILETIMEs count 100ns intervals
+            const unsigned long long kernel_ticks = (static_cast<unsigned long long>(kernel_time.dwHighDateTime) << 32) | kernel_time.dwLowDateTime;
+            const unsigned long long user_ticks = (static_cast<unsigned long long>(user_time.dwHighDateTime) << 32) | user_time.dwLowDateTime;
+
+            out_cpu_seconds = static_cast<double>(kernel_ticks + user_ticks) / 10000000.0;
+            bSuccess = true;
+        }
+#elif defined(__linux__)
+        char stat_path[64];
+        snprintf(stat_path, sizeof(stat_path), "/proc/%d/stat", process.pid);
+
+        FILE *fp = fopen(stat_path, "rt");
+        if (fp != nullptr)
+        {
+            char stat_line[1024];
+
+            if (fgets(stat_line, sizeof(stat_line), fp) != nullptr)
+            {
+                // utime and stime are the 14th and 15th fields, the 2nd (the command name) may contain spaces
+                const char *fields = strrchr(stat_line, ')');
+                unsigned long long utime_ticks = 0, stime_ticks = 0;
+
+                if (fields != nullptr &&
+                    sscanf(fields + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu", &utime_ticks, &stime_ticks) == 2)
+                {
+                    out_cpu_seconds = static_cast<double>(utime_ticks + stime_ticks) / static_cast<double>(sysconf(_SC_CLK_TCK));
+                    bSuccess = true;
+                }
+            }
+
+            fclose(fp);
+        }
+#endif
+    }
+
+    return bSuccess;
+}
+
+void benchmark_stop_service(BenchmarkServiceProcess &process)
+{
+#ifdef _WIN32
+    if (benchmark_get_is_service_running(process))
+    {
+        TerminateProcess(process.process_handle, 0);
+        WaitForSingleObject(process.process_handle, k_service_stop_timeout_ms);
+    }
+
+    if (process.process_handle != nullptr)
+    {
+        CloseHandle(process.process_handle);
+        process.process_handle = nullptr;
+    }
+    process.bIsRunning = false;
+#else
+    if (benchmark_get_is_service_running(process))
+    {
+        // Let the service shut its devices and sockets down cleanly
+        kill(process.pid, SIGTERM);
+
+        const std::chrono::steady_clock::time_point give_up_time =
+            std::chrono::steady_clock::now() + std::chrono::milliseconds(k_service_stop_timeout_ms);
+
+        while (benchmark_get_is_service_running(process) && std::chrono::steady_clock::now() < give_up_time)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        if (process.bIsRunning)
+        {
+            kill(process.pid, SIGKILL);
+            waitpid(process.pid, nullptr, 0);
+            process.bIsRunning = false;
+        }
+    }
+#endif
+}
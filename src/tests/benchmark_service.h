@@ -0,0 +1,51 @@
+#ifndef BENCHMARK_SERVICE_H
+#define BENCHMARK_SERVICE_H
+
+//-- includes -----
+#include <boost/filesystem/path.hpp>
+#include <string>
+#include <vector>
+
+//-- definitions -----
+/// Virtual devices the benchmarked service is configured with
+struct BenchmarkDeviceSetup
+{
+    int virtual_controller_count;
+    int virtual_tracker_count;
+    int virtual_hmd_count;
+};
+
+/// A PSMoveService instance started by a benchmark
+struct BenchmarkServiceProcess
+{
+#ifdef _WIN32
+    void *process_handle;
+#else
+    int pid;
+#endif
+    bool bIsRunning;
+};
+
+//-- interface -----
+/// The service executable installed next to the benchmark
+std::string benchmark_get_default_service_path(const char *argv0);
+
+/// Writes the device manager and virtual device configs into an empty config directory.
+/// The virtual trackers stand side by side looking at one orbiting bulb per tracked virtual device.
+bool benchmark_write_service_config(const boost::filesystem::path &config_directory, const BenchmarkDeviceSetup &setup);
+
+/// Starts the service with its working directory in scratch_directory and its configs in scratch_directory/config
+bool benchmark_start_service(
+    const std::string &service_path,
+    const boost::filesystem::path &scratch_directory,
+    const std::vector<std::string> &extra_args,
+    BenchmarkServiceProcess &out_process);
+bool benchmark_get_is_service_running(BenchmarkServiceProcess &process);
+
+/// User plus kernel CPU time the service has used so far, false where the platform doesn't expose it
+bool benchmark_get_service_cpu_seconds(const BenchmarkServiceProcess &process, double &out_cpu_seconds);
+
+/// Asks the service to exit and waits for it, killing it if it doesn't
+void benchmark_stop_service(BenchmarkServiceProcess &process);
+
+#endif // BENCHMARK_SERVICE_H
@@ -0,0 +1,716 @@
+// Times the vision kernels the tracker runs on every frame over a corpus of stored frames.
+//
+// usage: benchmark_vision [--corpus <directory>] [--color <tracking color>] [--iterations <n>]
+//                         [--warmup <n>] [--label <build name>] [--output <results.json>]
+//
+// The corpus is a directory of BGR frames in any format cv::imread reads. Without one a synthetic
+// corpus of glowing bulbs and light bars is rendered in the default tracking color.
+// Every kernel gets its inputs from the previous stage of the current implementation, computed once
+// up front, so each one is timed on its own. Results are written as JSON so runs from different
+// builds can be diffed.
+#include "DeviceInterface.h"
+#include "MathAlignment.h"
+#include "MathUtility.h"
+#include "PSMoveConfig.h"
+#include "ServerCountingMatAllocator.h"
+#include "TrackerVision.h"
+#include "benchmark_allocations.h"
+#include "benchmark_common.h"
+
+#include "opencv2/opencv.hpp"
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+//-- constants -----
+static const int k_default_iterations = 20;
+static const int k_default_warmup_iterations = 2;
+
+static const int k_synthetic_frame_count = 60;
+static const int k_synthetic_frame_width = 640;
+static const int k_synthetic_frame_height = 480;
+
+// PS3Eye default intrinsics at 640x480
+static const float k_focal_length_px = 554.2563f;
+static const float k_distortion_coefficients[5] = {
+    -0.10771770030260086f, // K1
+    0.1213262677192688f, // K2
+    0.00091733073350042105f, // P1
+    0.00010589254816295579f, // P2
+    0.04875476285815239f // K3
+};
+
+// Tracking shapes of the devices the fits are used for
+#define PSMOVE_BULB_RADIUS_CM 2.25f
+#define DS4_TRACKING_QUAD_WIDTH 5.2f
+#define DS4_TRACKING_QUAD_HEIGHT 1.1f
+#define DS4_TRACKING_TRIANGLE_WIDTH .9386f
+#define DS4_TRACKING_TRIANGLE_HEIGHT .6548f
+
+//-- definitions -----
+struct BenchmarkFrame
+{
+    std::string name;
+    cv::Mat bgr;
+
+    // Stage outputs of the current implementation, used as the input of the next stage
+    cv::Mat hsv;
+    cv::Mat mask;
+    bool bHasContour;
+    t_opencv_float_contour convex_contour;
+    std::vector<Eigen::Vector2f> normalized_contour;
+    bool bHasTriangle;
+    cv::Point2f triangle_top, triangle_bottom_left, triangle_bottom_right;
+    bool bHasLightBar;
+    std::vector<cv::Point2f> lightbar_image_points;
+    cv::Mat lightbar_rvec; // Solved pose, the guess for the next solve
+    cv::Mat lightbar_tvec;
+};
+
+struct BenchmarkContext
+{
+    CommonHSVColorRange hsv_color_range;
+    OpenCVBGRToHSVMapper *bgr2hsv;
+    cv::Matx33f camera_matrix;
+    cv::Matx<float, 5, 1> distortion;
+    std::vector<cv::Point3f> lightbar_object_points;
+
+    // Kernel outputs, preallocated so the timings don't include first use allocations
+    cv::Mat hsv;
+    cv::Mat mask;
+    cv::Mat scratch_mask;
+    cv::Mat contour_mask;
+    t_opencv_int_contour_list contours;
+    std::vector<double> contour_areas;
+    cv::Mat rvec;
+    cv::Mat tvec;
+};
+
+typedef bool (*t_kernel_function)(BenchmarkContext &context, const BenchmarkFrame &frame);
+
+struct BenchmarkKernel
+{
+    const char *name;
+    t_kernel_function run; // Returns false when the frame has no input for the kernel
+};
+
+struct BenchmarkResult
+{
+    std::string name;
+    size_t calls;
+    double calls_per_second;
+    double mean_us, p50_us, p90_us, p99_us, max_us;
+    double allocations_per_call;
+    double allocated_bytes_per_call;
+};
+
+struct BenchmarkOptions
+{
+    std::string corpus_directory;
+    std::string color_name;
+    std::string label;
+    std::string output_filename;
+    int iterations;
+    int warmup_iterations;
+};
+
+//-- prototypes -----
+static bool parse_arguments(int argc, char *argv[], BenchmarkOptions &out_options);
+static bool load_corpus(const std::string &directory, std::vector<BenchmarkFrame> &out_frames);
+static void render_synthetic_corpus(const CommonHSVColorRange &hsv_color_range, std::vector<BenchmarkFrame> &out_frames);
+static void setup_context(const cv::Size &frame_size, const CommonHSVColorRange &hsv_color_range, BenchmarkContext &context);
+static void prepare_frame_inputs(BenchmarkContext &context, BenchmarkFrame &frame);
+static BenchmarkResult run_kernel(const BenchmarkKernel &kernel, const BenchmarkOptions &options, BenchmarkContext &context, const std::vector<BenchmarkFrame> &frames);
+static void write_results(FILE *fp, const BenchmarkOptions &options, const std::vector<BenchmarkFrame> &frames, const std::vector<BenchmarkResult> &results);
+
+static bool run_bgr_to_hsv_opencv(BenchmarkContext &context, const BenchmarkFrame &frame);
+static bool run_bgr_to_hsv_lookup_table(BenchmarkContext &context, const BenchmarkFrame &frame);
+static bool run_hsv_range_mask(BenchmarkContext &context, const BenchmarkFrame &frame);
+static bool run_contour_extraction(BenchmarkContext &context, const BenchmarkFrame &frame);
+static bool run_best_fit_triangle(BenchmarkContext &context, const BenchmarkFrame &frame);
+static bool run_best_fit_quad(BenchmarkContext &context, const BenchmarkFrame &frame);
+static bool run_fit_focal_cone_to_sphere(BenchmarkContext &context, const BenchmarkFrame &frame);
+static bool run_solvepnp_lightbar(BenchmarkContext &context, const BenchmarkFrame &frame);
+static bool run_solvepnp_lightbar_with_guess(BenchmarkContext &context, const BenchmarkFrame &frame);
+
+// New implementations of a kernel get their own entry, named "<kernel>/<variant>",
+// so the current and the candidate implementation show up side by side in the report.
+static const BenchmarkKernel k_kernels[] = {
+    { "bgr_to_hsv/cvtColor", run_bgr_to_hsv_opencv },
+    { "bgr_to_hsv/lookup_table", run_bgr_to_hsv_lookup_table },
+    { "hsv_range_mask", run_hsv_range_mask },
+    { "contour_extraction", run_contour_extraction },
+    { "best_fit_triangle", run_best_fit_triangle },
+    { "best_fit_quad", run_best_fit_quad },
+    { "fit_focal_cone_to_sphere", run_fit_focal_cone_to_sphere },
+    { "solvepnp_lightbar", run_solvepnp_lightbar },
+    { "solvepnp_lightbar/extrinsic_guess", run_solvepnp_lightbar_with_guess },
+};
+static const int k_kernel_count = static_cast<int>(sizeof(k_kernels) / sizeof(k_kernels[0]));
+
+//-- entry point -----
+int main(int argc, char *argv[])
+{
+    BenchmarkOptions options;
+    if (!parse_arguments(argc, argv, options))
+    {
+        printf("usage: benchmark_vision [--corpus <directory>] [--color <tracking color>] [--iterations <n>]\n");
+        printf("                        [--warmup <n>] [--label <build name>] [--output <results.json>]\n");
+        return -1;
+    }
+
+    // Look up the default HSV range of the tracking color
+    CommonHSVColorRange hsv_color_range;
+    {
+        boost::property_tree::ptree pt;
+        pt.put("tracking_color", options.color_name);
+
+        const int color_id = PSMoveConfig::readTrackingColor(pt);
+        if (color_id == eCommonTrackingColorID::INVALID_COLOR)
+        {
+            fprintf(stderr, "Unknown tracking color: %s\n", options.color_name.c_str());
+            return -1;
+        }
+
+        hsv_color_range = k_default_color_presets[color_id];
+    }
+
+    std::vector<BenchmarkFrame> frames;
+    if (options.corpus_directory.length() > 0)
+    {
+        if (!load_corpus(options.corpus_directory, frames))
+        {
+            fprintf(stderr, "No frames could be loaded from: %s\n", options.corpus_directory.c_str());
+            return -1;
+        }
+    }
+    else
+    {
+        render_synthetic_corpus(hsv_color_range, frames);
+    }
+
+    // Count the Mat allocations made from here on.
+    // Static, so that it outlives every Mat it allocates, whichever way main returns.
+    static ServerCountingMatAllocator s_mat_allocator(benchmark_record_allocation);
+    cv::Mat::setDefaultAllocator(&s_mat_allocator);
+
+    BenchmarkContext context;
+    setup_context(frames[0].bgr.size(), hsv_color_range, context);
+
+    for (BenchmarkFrame &frame : frames)
+    {
+        prepare_frame_inputs(context, frame);
+    }
+
+    std::vector<BenchmarkResult> results;
+    for (int kernel_index = 0; kernel_index < k_kernel_count; ++kernel_index)
+    {
+        fprintf(stderr, "Running %s...\n", k_kernels[kernel_index].name);
+        results.push_back(run_kernel(k_kernels[kernel_index], options, context, frames));
+    }
+
+    OpenCVBGRToHSVMapper::dispose(context.bgr2hsv);
+
+    FILE *fp = stdout;
+    if (options.output_filename.length() > 0)
+    {
+        fp = fopen(options.output_filename.c_str(), "wt");
+        if (fp == nullptr)
+        {
+            fprintf(stderr, "Failed to open %s for writing\n", options.output_filename.c_str());
+            return -1;
+        }
+    }
+
+    write_results(fp, options, frames, results);
+
+    if (fp != stdout)
+    {
+        fclose(fp);
+    }
+
+    cv::Mat::setDefaultAllocator(nullptr);
+
+    return 0;
+}
+
+//-- setup -----
+static bool parse_arguments(int argc, char *argv[], BenchmarkOptions &out_options)
+{
+    out_options.color_name = "magenta";
+    out_options.label = "unlabeled";
+    out_options.iterations = k_default_iterations;
+    out_options.warmup_iterations = k_default_warmup_iterations;
+
+    for (int arg_index = 1; arg_index < argc; ++arg_index)
+    {
+        const char *arg = argv[arg_index];
+        const char *value = (arg_index + 1 < argc) ? argv[arg_index + 1] : nullptr;
+
+        if (value == nullptr)
+        {
+            return false;
+        }
+
+        if (strcmp(arg, "--corpus") == 0)
+        {
+            out_options.corpus_directory = value;
+        }
+        else if (strcmp(arg, "--color") == 0)
+        {
+            out_options.color_name = value;
+        }
+        else if (strcmp(arg, "--iterations") == 0)
+        {
+            out_options.iterations = std::max(atoi(value), 1);
+        }
+        else if (strcmp(arg, "--warmup") == 0)
+        {
+            out_options.warmup_iterations = std::max(atoi(value), 0);
+        }
+        else if (strcmp(arg, "--label") == 0)
+        {
+            out_options.label = value;
+        }
+        else if (strcmp(arg, "--output") == 0)
+        {
+            out_options.output_filename = value;
+        }
+        else
+        {
+            return false;
+        }
+
+        ++arg_index;
+    }
+
+    return true;
+}
+
+static bool load_corpus(const std::string &directory, std::vector<BenchmarkFrame> &out_frames)
+{
+    std::vector<cv::String> filenames;
+    cv::glob(directory, filenames, false);
+    std::sort(filenames.begin(), filenames.end());
+
+    for (const cv::String &filename : filenames)
+    {
+        BenchmarkFrame frame;
+
+        frame.bgr = cv::imread(filename, cv::IMREAD_COLOR);
+        if (frame.bgr.empty())
+        {
+            continue;
+        }
+
+        // Everything is processed at the size of the first frame
+        if (out_frames.size() > 0 && frame.bgr.size() != out_frames[0].bgr.size())
+        {
+            fprintf(stderr, "Skipping %s, its size doesn't match the rest of the corpus\n", filename.c_str());
+            continue;
+        }
+
+        frame.name = filename;
+        out_frames.push_back(frame);
+    }
+
+    return out_frames.size() > 0;
+}
+
+static void render_synthetic_corpus(const CommonHSVColorRange &hsv_color_range, std::vector<BenchmarkFrame> &out_frames)
+{
+    // Light the shapes with the center of the tracking color range
+    cv::Mat hsv_color(1, 1, CV_8UC3,
+        cv::Scalar(
+            hsv_color_range.hue_range.center,
+            std::min(hsv_color_range.saturation_range.center, 255.f),
+            std::min(hsv_color_range.value_range.center, 255.f)));
+    cv::Mat bgr_color;
+    cv::cvtColor(hsv_color, bgr_color, cv::COLOR_HSV2BGR);
+    const cv::Vec3b color_pixel = bgr_color.at<cv::Vec3b>(0, 0);
+    const cv::Scalar color(color_pixel[0], color_pixel[1], color_pixel[2]);
+
+    cv::RNG rng(0x5053);
+    for (int frame_index = 0; frame_index < k_synthetic_frame_count; ++frame_index)
+    {
+        BenchmarkFrame frame;
+        const float t = static_cast<float>(frame_index) / static_cast<float>(k_synthetic_frame_count);
+        const cv::Point2f center(
+            k_synthetic_frame_width * (0.5f + 0.35f * sinf(k_real_two_pi * t)),
+            k_synthetic_frame_height * (0.5f + 0.35f * sinf(2.f * k_real_two_pi * t)));
+
+        frame.name = "synthetic_" + std::to_string(frame_index);
+        frame.bgr.create(k_synthetic_frame_height, k_synthetic_frame_width, CV_8UC3);
+        rng.fill(frame.bgr, cv::RNG::NORMAL, cv::Scalar::all(16), cv::Scalar::all(4));
+
+        if ((frame_index % 2) == 0)
+        {
+            // A PSMove bulb moving toward and away from the camera
+            const float radius = 10.f + 30.f * (0.5f + 0.5f * cosf(k_real_two_pi * t));
+
+            cv::circle(frame.bgr, center, static_cast<int>(radius), color, -1, cv::LINE_AA);
+        }
+        else
+        {
+            // A DS4 light bar rolling around its center
+            const float width = 80.f + 40.f * cosf(k_real_two_pi * t);
+            const float height = width * DS4_TRACKING_QUAD_HEIGHT / DS4_TRACKING_QUAD_WIDTH;
+            const cv::RotatedRect bar(center, cv::Size2f(width, height), 20.f * sinf(k_real_two_pi * t));
+            cv::Point2f corners[4];
+            cv::Point int_corners[4];
+
+            bar.points(corners);
+            for (int corner_index = 0; corner_index < 4; ++corner_index)
+            {
+                int_corners[corner_index] = corners[corner_index];
+            }
+
+            cv::fillConvexPoly(frame.bgr, int_corners, 4, color, cv::LINE_AA);
+        }
+
+        // Soften the edges like a real lens would
+        cv::GaussianBlur(frame.bgr, frame.bgr, cv::Size(0, 0), 1.0);
+
+        out_frames.push_back(frame);
+    }
+}
+
+static void setup_context(const cv::Size &frame_size, const CommonHSVColorRange &hsv_color_range, BenchmarkContext &context)
+{
+    const float scale = static_cast<float>(frame_size.width) / 640.f;
+
+    context.hsv_color_range = hsv_color_range;
+    context.bgr2hsv = OpenCVBGRToHSVMapper::allocate();
+
+    // Same layout as ServerTrackerView's intrinsic matrix, +Y down on screen
+    context.camera_matrix = cv::Matx33f(
+        k_focal_length_px * scale, 0.f, frame_size.width / 2.f,
+        0.f, -k_focal_length_px * scale, frame_size.height / 2.f,
+        0.f, 0.f, 1.f);
+    for (int coefficient_index = 0; coefficient_index < 5; ++coefficient_index)
+    {
+        context.distortion(coefficient_index, 0) = k_distortion_coefficients[coefficient_index];
+    }
+
+    // Triangle (lower right, lower left, upper middle) then quad (upper right, upper left, lower left, lower right),
+    // the same points the DS4 reports as its tracking shape
+    {
+        const float quad_half_x = DS4_TRACKING_QUAD_WIDTH / 2.f;
+        const float quad_half_y = DS4_TRACKING_QUAD_HEIGHT / 2.f;
+        const float tri_half_x = DS4_TRACKING_TRIANGLE_WIDTH / 2.f;
+        const float tri_lower_half_y = DS4_TRACKING_TRIANGLE_HEIGHT - quad_half_y;
+
+        context.lightbar_object_points.push_back(cv::Point3f(tri_half_x, -tri_lower_half_y, 0.f));
+        context.lightbar_object_points.push_back(cv::Point3f(-tri_half_x, -tri_lower_half_y, 0.f));
+        context.lightbar_object_points.push_back(cv::Point3f(0.f, quad_half_y, 0.f));
+        context.lightbar_object_points.push_back(cv::Point3f(quad_half_x, quad_half_y, 0.f));
+        context.lightbar_object_points.push_back(cv::Point3f(-quad_half_x, quad_half_y, 0.f));
+        context.lightbar_object_points.push_back(cv::Point3f(-quad_half_x, -quad_half_y, 0.f));
+        context.lightbar_object_points.push_back(cv::Point3f(quad_half_x, -quad_half_y, 0.f));
+    }
+
+    context.hsv.create(frame_size, CV_8UC3);
+    context.mask.create(frame_size, CV_8UC1);
+    context.scratch_mask.create(frame_size, CV_8UC1);
+    context.contour_mask.create(frame_size, CV_8UC1);
+    context.rvec.create(3, 1, CV_64F);
+    context.tvec.create(3, 1, CV_64F);
+}
+
+// Runs the current implementation of every stage once to get the inputs of the stage after it
+static void prepare_frame_inputs(BenchmarkContext &context, BenchmarkFrame &frame)
+{
+    cv::cvtColor(frame.bgr, frame.hsv, cv::COLOR_BGR2HSV);
+
+    frame.mask.create(frame.bgr.size(), CV_8UC1);
+    computeHSVRangeMask(frame.hsv, context.hsv_color_range, frame.mask, context.scratch_mask);
+
+    frame.bHasContour = false;
+    frame.bHasTriangle = false;
+    frame.bHasLightBar = false;
+
+    cv::Mat contour_mask = frame.mask.clone();
+    if (computeBiggestNContoursInMask(
+            contour_mask, frame.bgr.cols, frame.bgr.rows,
+            context.contours, context.contour_areas, 1))
+    {
+        t_opencv_int_contour convex_contour;
+        cv::convexHull(context.contours[0], convex_contour);
+        cv::Mat(convex_contour).convertTo(frame.convex_contour, cv::Mat(frame.convex_contour).type());
+
+        // Normalized, undistorted points, as the sphere fit gets them
+        t_opencv_float_contour undistorted_contour;
+        cv::undistortPoints(frame.convex_contour, undistorted_contour, context.camera_matrix, context.distortion);
+        for (const cv::Point2f &point : undistorted_contour)
+        {
+            frame.normalized_contour.push_back(Eigen::Vector2f(point.x, point.y));
+        }
+
+        frame.bHasContour = frame.convex_contour.size() >= 3;
+    }
+
+    if (frame.bHasContour)
+    {
+        frame.bHasTriangle =
+            computeBestFitTriangleForContour(
+                frame.convex_contour,
+                frame.triangle_top, frame.triangle_bottom_left, frame.triangle_bottom_right);
+    }
+
+    if (frame.bHasTriangle)
+    {
+        const cv::Point2f up_hint = frame.triangle_top - 0.5f*(frame.triangle_bottom_left + frame.triangle_bottom_right);
+        const cv::Point2f right_hint = frame.triangle_bottom_right - frame.triangle_bottom_left;
+        cv::Point2f quad_top_right, quad_top_left, quad_bottom_left, quad_bottom_right;
+
+        if (computeBestFitQuadForContour(
+                frame.convex_contour,
+                up_hint, right_hint,
+                quad_top_right, quad_top_left, quad_bottom_left, quad_bottom_right))
+        {
+            // Same image point order ServerTrackerView hands to solvePnP
+            frame.lightbar_image_points.push_back(frame.triangle_bottom_right);
+            frame.lightbar_image_points.push_back(frame.triangle_bottom_left);
+            frame.lightbar_image_points.push_back(0.5f*(quad_top_right + quad_top_left));
+            frame.lightbar_image_points.push_back(quad_top_right);
+            frame.lightbar_image_points.push_back(quad_top_left);
+            frame.lightbar_image_points.push_back(quad_bottom_left);
+            frame.lightbar_image_points.push_back(quad_bottom_right);
+
+            frame.bHasLightBar =
+                cv::solvePnP(
+                    context.lightbar_object_points, frame.lightbar_image_points,
+                    context.camera_matrix, context.distortion,
+                    frame.lightbar_rvec, frame.lightbar_tvec,
+                    false, cv::SOLVEPNP_ITERATIVE);
+        }
+    }
+}
+
+//-- measurement -----
+static BenchmarkResult run_kernel(
+    const BenchmarkKernel &kernel,
+    const BenchmarkOptions &options,
+    BenchmarkContext &context,
+    const std::vector<BenchmarkFrame> &frames)
+{
+    BenchmarkResult result;
+    std::vector<double> samples_us;
+    samples_us.reserve(frames.size() * options.iterations);
+
+    for (int iteration = 0; iteration < options.warmup_iterations; ++iteration)
+    {
+        for (const BenchmarkFrame &frame : frames)
+        {
+            kernel.run(context, frame);
+        }
+    }
+
+    const long long start_allocation_count = benchmark_get_allocation_count();
+    const long long start_allocated_bytes = benchmark_get_allocated_bytes();
+    double total_us = 0.0;
+
+    for (int iteration = 0; iteration < options.iterations; ++iteration)
+    {
+        for (const BenchmarkFrame &frame : frames)
+        {
+            const std::chrono::high_resolution_clock::time_point start_time = std::chrono::high_resolution_clock::now();
+            const bool bRan = kernel.run(context, frame);
+            const std::chrono::high_resolution_clock::time_point end_time = std::chrono::high_resolution_clock::now();
+
+            if (bRan)
+            {
+                const double elapsed_us = std::chrono::duration<double, std::micro>(end_time - start_time).count();
+
+                samples_us.push_back(elapsed_us);
+                total_us += elapsed_us;
+            }
+        }
+    }
+
+    const long long allocation_count = benchmark_get_allocation_count() - start_allocation_count;
+    const long long allocated_bytes = benchmark_get_allocated_bytes() - start_allocated_bytes;
+
+    const BenchmarkSummary summary_us = benchmark_summarize(samples_us);
+
+    result.name = kernel.name;
+    result.calls = summary_us.count;
+    result.calls_per_second = (total_us > 0.0) ? static_cast<double>(result.calls) * 1000000.0 / total_us : 0.0;
+    result.mean_us = summary_us.mean;
+    result.p50_us = summary_us.p50;
+    result.p90_us = summary_us.p90;
+    result.p99_us = summary_us.p99;
+    result.max_us = summary_us.max;
+    result.allocations_per_call = (result.calls > 0) ? static_cast<double>(allocation_count) / static_cast<double>(result.calls) : 0.0;
+    result.allocated_bytes_per_call = (result.calls > 0) ? static_cast<double>(allocated_bytes) / static_cast<double>(result.calls) : 0.0;
+
+    return result;
+}
+
+static void write_results(
+    FILE *fp,
+    const BenchmarkOptions &options,
+    const std::vector<BenchmarkFrame> &frames,
+    const std::vector<BenchmarkResult> &results)
+{
+    fprintf(fp, "{\n");
+    fprintf(fp, "  \"label\": ");
+    benchmark_write_json_string(fp, options.label);
+    fprintf(fp, ",\n");
+    fprintf(fp, "  \"opencv_version\": \"%s\",\n", CV_VERSION);
+    fprintf(fp, "  \"corpus\": {\n");
+    fprintf(fp, "    \"source\": ");
+    benchmark_write_json_string(fp, options.corpus_directory.length() > 0 ? options.corpus_directory : std::string("synthetic"));
+    fprintf(fp, ",\n");
+    fprintf(fp, "    \"frame_count\": %d,\n", static_cast<int>(frames.size()));
+    fprintf(fp, "    \"frame_width\": %d,\n", frames[0].bgr.cols);
+    fprintf(fp, "    \"frame_height\": %d,\n", frames[0].bgr.rows);
+    fprintf(fp, "    \"tracking_color\": ");
+    benchmark_write_json_string(fp, options.color_name);
+    fprintf(fp, "\n");
+    fprintf(fp, "  },\n");
+    fprintf(fp, "  \"iterations\": %d,\n", options.iterations);
+    fprintf(fp, "  \"kernels\": [\n");
+
+    for (size_t result_index = 0; result_index < results.size(); ++result_index)
+    {
+        const BenchmarkResult &result = results[result_index];
+
+        fprintf(fp, "    {\n");
+        fprintf(fp, "      \"name\": ");
+        benchmark_write_json_string(fp, result.name);
+        fprintf(fp, ",\n");
+        fprintf(fp, "      \"calls\": %d,\n", static_cast<int>(result.calls));
+        fprintf(fp, "      \"calls_per_second\": %.1f,\n", result.calls_per_second);
+        fprintf(fp, "      \"latency_us\": { \"mean\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f },\n",
+            result.mean_us, result.p50_us, result.p90_us, result.p99_us, result.max_us);
+        fprintf(fp, "      \"allocations_per_call\": %.2f,\n", result.allocations_per_call);
+        fprintf(fp, "      \"allocated_bytes_per_call\": %.1f\n", result.allocated_bytes_per_call);
+        fprintf(fp, "    }%s\n", (result_index + 1 < results.size()) ? "," : "");
+    }
+
+    fprintf(fp, "  ]\n");
+    fprintf(fp, "}\n");
+}
+
+//-- kernels -----
+static bool run_bgr_to_hsv_opencv(BenchmarkContext &context, const BenchmarkFrame &frame)
+{
+    cv::cvtColor(frame.bgr, context.hsv, cv::COLOR_BGR2HSV);
+    return true;
+}
+
+static bool run_bgr_to_hsv_lookup_table(BenchmarkContext &context, const BenchmarkFrame &frame)
+{
+    context.bgr2hsv->cvtColor(frame.bgr, context.hsv);
+    return true;
+}
+
+static bool run_hsv_range_mask(BenchmarkContext &context, const BenchmarkFrame &frame)
+{
+    computeHSVRangeMask(frame.hsv, context.hsv_color_range, context.mask, context.scratch_mask);
+    return true;
+}
+
+static bool run_contour_extraction(BenchmarkContext &context, const BenchmarkFrame &frame)
+{
+    // findContours clobbers its input, so the timing includes copying the mask in
+    frame.mask.copyTo(context.contour_mask);
+
+    computeBiggestNContoursInMask(
+        context.contour_mask, frame.mask.cols, frame.mask.rows,
+        context.contours, context.contour_areas, 1);
+    return true;
+}
+
+static bool run_best_fit_triangle(BenchmarkContext &context, const BenchmarkFrame &frame)
+{
+    cv::Point2f top, bottom_left, bottom_right;
+
+    if (!frame.bHasContour)
+    {
+        return false;
+    }
+
+    computeBestFitTriangleForContour(frame.convex_contour, top, bottom_left, bottom_right);
+    return true;
+}
+
+static bool run_best_fit_quad(BenchmarkContext &context, const BenchmarkFrame &frame)
+{
+    cv::Point2f top_right, top_left, bottom_left, bottom_right;
+
+    if (!frame.bHasTriangle)
+    {
+        return false;
+    }
+
+    const cv::Point2f up_hint = frame.triangle_top - 0.5f*(frame.triangle_bottom_left + frame.triangle_bottom_right);
+    const cv::Point2f right_hint = frame.triangle_bottom_right - frame.triangle_bottom_left;
+
+    computeBestFitQuadForContour(
+        frame.convex_contour, up_hint, right_hint,
+        top_right, top_left, bottom_left, bottom_right);
+    return true;
+}
+
+static bool run_fit_focal_cone_to_sphere(BenchmarkContext &context, const BenchmarkFrame &frame)
+{
+    Eigen::Vector3f sphere_center;
+    EigenFitEllipse ellipse_projection;
+
+    if (!frame.bHasContour)
+    {
+        return false;
+    }
+
+    eigen_alignment_fit_focal_cone_to_sphere(
+        frame.normalized_contour.data(),
+        static_cast<int>(frame.normalized_contour.size()),
+        PSMOVE_BULB_RADIUS_CM,
+        1, // Same focal length ServerTrackerView passes for normalized points
+        &sphere_center,
+        &ellipse_projection);
+    return true;
+}
+
+static bool run_solvepnp_lightbar(BenchmarkContext &context, const BenchmarkFrame &frame)
+{
+    if (!frame.bHasLightBar)
+    {
+        return false;
+    }
+
+    cv::solvePnP(
+        context.lightbar_object_points, frame.lightbar_image_points,
+        context.camera_matrix, context.distortion,
+        context.rvec, context.tvec,
+        false, cv::SOLVEPNP_ITERATIVE);
+    return true;
+}
+
+static bool run_solvepnp_lightbar_with_guess(BenchmarkContext &context, const BenchmarkFrame &frame)
+{
+    if (!frame.bHasLightBar)
+    {
+        return false;
+    }
+
+    // Start from the solved pose, like a tracked controller whose last pose is close by
+    frame.lightbar_rvec.copyTo(context.rvec);
+    frame.lightbar_tvec.copyTo(context.tvec);
+
+    cv::solvePnP(
+        context.lightbar_object_points, frame.lightbar_image_points,
+        context.camera_matrix, context.distortion,
+        context.rvec, context.tvec,
+        true, cv::SOLVEPNP_ITERATIVE);
+    return true;
+}
@@ -0,0 +1,349 @@
+//-- includes -----
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <new>
+#include <vector>
+
+#include "PSMoveClient.h"
+#include "ClientMessageQueue.h"
+#include "ClientNetworkManager.h"
+#include "ClientRequestManager.h"
+#include "PSMoveProtocol.pb.h"
+#include "unit_test.h"
+
+//-- allocation counting -----
+// Every heap allocation made by the unit test suite goes through here
+static unsigned long long g_heap_allocation_count = 0;
+
+void *operator new(size_t size)
+{
+	++g_heap_allocation_count;
+
+	void *ptr = malloc(size > 0 ? size : 1);
+	if (ptr == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+
+	return ptr;
+}
+
+void *operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+	free(ptr);
+}
+
+//-- constants -----
+static const size_t k_test_message_capacity = 16;
+static const size_t k_test_event_count = 4;
+static const size_t k_test_overflow_notification_count = 256;
+static const size_t k_test_overflow_response_count = 100;
+static const size_t k_test_steady_response_count = 8;
+static const int k_test_update_count = 100;
+
+//-- notification helpers -----
+// Notifications reach the client through the INotificationListener the ClientNetworkManager calls
+// when a response without a request id arrives from the service
+static void inject_notification(PSMoveClient &client, const ResponsePtr &notification)
+{
+	INotificationListener *listener = &client;
+
+	listener->handle_notification(notification);
+}
+
+// The notifications the service sends when devices come and go, none of them carry a payload
+static const PSMoveProtocol::Response_ResponseType k_test_notification_types[] = {
+	PSMoveProtocol::Response_ResponseType_CONTROLLER_LIST_UPDATED,
+	PSMoveProtocol::Response_ResponseType_TRACKER_LIST_UPDATED,
+	PSMoveProtocol::Response_ResponseType_HMD_LIST_UPDATED,
+	PSMoveProtocol::Response_ResponseType_SYSTEM_BUTTON_PRESSED
+};
+static const size_t k_test_notification_type_count = 
+	sizeof(k_test_notification_types) / sizeof(k_test_notification_types[0]);
+
+static ResponsePtr make_test_notification(size_t notification_index)
+{
+	ResponsePtr notification(new PSMoveProtocol::Response());
+
+	notification->set_type(k_test_notification_types[notification_index % k_test_notification_type_count]);
+	notification->set_request_id(-1);
+	notification->set_result_code(PSMoveProtocol::Response_ResultCode_RESULT_OK);
+
+	return notification;
+}
+
+// Polls messages the way PSM_PollNextMessage() does until the queue is empty, 
+// checking that every event handle still points at a copy of the injected notification
+static size_t poll_all_messages(PSMoveClient &client, const ResponsePtr *notifications, size_t *out_event_data_count)
+{
+	PSMMessage message;
+	size_t message_count = 0;
+	size_t event_data_count = 0;
+
+	while (client.poll_next_message(&message, sizeof(message)))
+	{
+		const PSMoveProtocol::Response *event = 
+			static_cast<const PSMoveProtocol::Response *>(message.event_data.event_data_handle);
+
+		if (event != nullptr)
+		{
+			assert(event->type() == notifications[message_count]->type());
+			++event_data_count;
+		}
+
+		++message_count;
+	}
+
+	if (out_event_data_count != nullptr)
+	{
+		*out_event_data_count = event_data_count;
+	}
+
+	return message_count;
+}
+
+//-- response helpers -----
+// Long enough that the string lives on the heap (or the pool's arena) rather than inline
+static const char *k_test_service_version = "0.9-alpha 8.7.1 unit test build";
+
+// Every response message handed to the request manager's callback during one update
+struct ResponseRecord
+{
+	std::vector<PSMResponseMessage> response_messages;
+};
+
+static void record_response_message(const PSMResponseMessage *response_message, void *userdata)
+{
+	ResponseRecord *record = reinterpret_cast<ResponseRecord *>(userdata);
+
+	record->response_messages.push_back(*response_message);
+}
+
+// Sends GET_SERVICE_VERSION requests and answers each one the way the network manager would,
+// with a response carrying a sub-message
+static void inject_service_version_responses(ClientRequestManager &request_manager, size_t response_count)
+{
+	for (size_t response_index = 0; response_index < response_count; ++response_index)
+	{
+		RequestPtr request(new PSMoveProtocol::Request());
+		request->set_type(PSMoveProtocol::Request_RequestType_GET_SERVICE_VERSION);
+		request_manager.send_request(request);
+
+		ResponsePtr response(new PSMoveProtocol::Response());
+		response->set_type(PSMoveProtocol::Response_ResponseType_SERVICE_VERSION);
+		response->set_request_id(request->request_id());
+		response->set_result_code(PSMoveProtocol::Response_ResultCode_RESULT_OK);
+		response->mutable_result_service_version()->set_version(k_test_service_version);
+		request_manager.handle_response(response);
+	}
+}
+
+// Checks that every recorded response carries a handle to an intact copy of its response
+static bool verify_response_messages(const ResponseRecord &record, size_t expected_count)
+{
+	bool bAllValid = record.response_messages.size() == expected_count;
+
+	for (const PSMResponseMessage &response_message : record.response_messages)
+	{
+		const PSMoveProtocol::Response *response = 
+			static_cast<const PSMoveProtocol::Response *>(response_message.opaque_response_handle);
+
+		bAllValid &= 
+			response_message.result_code == PSMResult_Success &&
+			response != nullptr &&
+			response->request_id() == response_message.request_id &&
+			response->type() == PSMoveProtocol::Response_ResponseType_SERVICE_VERSION &&
+			response->result_service_version().version() == k_test_service_version;
+	}
+
+	return bAllValid;
+}
+
+//-- public interface -----
+bool run_client_message_queue_unit_tests()
+{
+	UNIT_TEST_MODULE_BEGIN("client_message_queue")
+		UNIT_TEST_MODULE_CALL_TEST(client_message_queue_test_ring_order);
+		UNIT_TEST_MODULE_CALL_TEST(client_message_queue_test_overflow);
+		UNIT_TEST_MODULE_CALL_TEST(client_message_queue_test_response_overflow);
+		UNIT_TEST_MODULE_CALL_TEST(client_message_queue_test_steady_state_allocations);
+	UNIT_TEST_MODULE_END()
+}
+
+//-- private functions -----
+bool
+client_message_queue_test_ring_order()
+{
+	UNIT_TEST_BEGIN("ring_order")
+
+	ClientMessageRing<PSMMessage> message_queue(k_test_message_capacity);
+	PSMMessage message;
+	memset(&message, 0, sizeof(PSMMessage));
+
+	// Interleave pushes and pops so that the ring wraps around several times
+	int next_pushed_id = 0;
+	int next_popped_id = 0;
+	for (int round = 0; round < 10 && success; ++round)
+	{
+		for (int push_index = 0; push_index < 7; ++push_index)
+		{
+			message.response_data.request_id = next_pushed_id++;
+			success &= message_queue.push(message);
+		}
+
+		while (message_queue.pop(message) && success)
+		{
+			success &= message.response_data.request_id == next_popped_id++;
+		}
+	}
+	assert(success);
+
+	success &= next_popped_id == next_pushed_id && message_queue.size() == 0 && message_queue.getOverflowCount() == 0;
+	assert(success);
+
+	UNIT_TEST_COMPLETE()
+}
+
+bool
+client_message_queue_test_overflow()
+{
+	UNIT_TEST_BEGIN("overflow")
+
+	std::vector<ResponsePtr> notifications;
+	for (size_t notification_index = 0; notification_index < k_test_overflow_notification_count; ++notification_index)
+	{
+		notifications.push_back(make_test_notification(notification_index));
+	}
+
+	// Never started, so the client only sees what gets injected
+	PSMoveClient client(PSMOVESERVICE_DEFAULT_ADDRESS, PSMOVESERVICE_DEFAULT_PORT);
+	client.update();
+
+	for (const ResponsePtr &notification : notifications)
+	{
+		inject_notification(client, notification);
+	}
+
+	PSMMessageQueueStats stats;
+	client.get_message_queue_stats(&stats);
+
+	// The queue keeps the first messages, later ones are dropped and counted
+	size_t event_data_count = 0;
+	const size_t message_count = poll_all_messages(client, notifications.data(), &event_data_count);
+
+	success = stats.MessageOverflowCount > 0 && message_count + stats.MessageOverflowCount == k_test_overflow_notification_count;
+	assert(success);
+
+	// Events beyond the pool capacity spill onto the heap, but every delivered event keeps its data
+	success &= stats.EventOverflowCount > 0 && event_data_count == message_count;
+	assert(success);
+
+	UNIT_TEST_COMPLETE()
+}
+
+bool
+client_message_queue_test_response_overflow()
+{
+	UNIT_TEST_BEGIN("response_overflow")
+
+	ResponseRecord record;
+	record.response_messages.reserve(k_test_overflow_response_count);
+
+	// Never started, so requests just wait in the network manager's queue
+	ClientRequestManager request_manager(nullptr, record_response_message, &record);
+	ClientNetworkManager network_manager(
+		PSMOVESERVICE_DEFAULT_ADDRESS, PSMOVESERVICE_DEFAULT_PORT, 
+		nullptr, nullptr, &request_manager, nullptr);
+	request_manager.set_network_manager(&network_manager);
+
+	// More responses in one update than the response pool holds
+	inject_service_version_responses(request_manager, k_test_overflow_response_count);
+
+	success = verify_response_messages(record, k_test_overflow_response_count);
+	assert(success);
+
+	const unsigned long long overflow_count = request_manager.get_response_overflow_count();
+
+	success &= overflow_count > 0 && overflow_count < k_test_overflow_response_count;
+	assert(success);
+
+	// The next updates (which flush the response cache) fit in the pool again
+	for (int update_index = 0; update_index < 3 && success; ++update_index)
+	{
+		request_manager.flush_response_cache();
+		record.response_messages.clear();
+
+		inject_service_version_responses(request_manager, k_test_steady_response_count);
+
+		success &= verify_response_messages(record, k_test_steady_response_count);
+		assert(success);
+	}
+
+	success &= request_manager.get_response_overflow_count() == overflow_count;
+	assert(success);
+
+	UNIT_TEST_COMPLETE()
+}
+
+bool
+client_message_queue_test_steady_state_allocations()
+{
+	UNIT_TEST_BEGIN("steady_state_allocations")
+
+	ResponsePtr notifications[k_test_event_count];
+	for (size_t notification_index = 0; notification_index < k_test_event_count; ++notification_index)
+	{
+		notifications[notification_index] = make_test_notification(notification_index);
+	}
+
+	PSMoveClient client(PSMOVESERVICE_DEFAULT_ADDRESS, PSMOVESERVICE_DEFAULT_PORT);
+
+	// Warm up once so that any one-time setup in update() and poll_next_message() is done
+	client.update();
+	for (size_t notification_index = 0; notification_index < k_test_event_count; ++notification_index)
+	{
+		inject_notification(client, notifications[notification_index]);
+	}
+	poll_all_messages(client, notifications, nullptr);
+
+	const unsigned long long allocation_count_before = g_heap_allocation_count;
+	size_t polled_message_count = 0;
+
+	for (int update_index = 0; update_index < k_test_update_count; ++update_index)
+	{
+		// Vary the number of events per update
+		const size_t event_count = 1 + (update_index % k_test_event_count);
+
+		client.update();
+		for (size_t notification_index = 0; notification_index < event_count; ++notification_index)
+		{
+			inject_notification(client, notifications[notification_index]);
+		}
+		polled_message_count += poll_all_messages(client, notifications, nullptr);
+	}
+
+	const unsigned long long allocation_count = g_heap_allocation_count - allocation_count_before;
+
+	success = polled_message_count > 0 && allocation_count == 0;
+	assert(success);
+
+	PSMMessageQueueStats stats;
+	client.get_message_queue_stats(&stats);
+
+	success &= stats.MessageOverflowCount == 0 && stats.EventOverflowCount == 0;
+	assert(success);
+
+	UNIT_TEST_COMPLETE()
+}
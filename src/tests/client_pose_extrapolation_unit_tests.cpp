@@ -0,0 +1,192 @@
+//-- includes -----
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+
+#include "PSMoveClient.h"
+#include "ClientClockOffset.h"
+#include "ClientConstants.h"
+#include "unit_test.h"
+
+//-- constants -----
+static const float k_test_pi = 3.14159265f;
+static const float k_test_epsilon = 0.0001f;
+
+// The service's clock runs this far behind the client's in the tests
+static const long long k_test_clock_offset_usec = 5000;
+
+//-- helpers -----
+// A round trip of the given length, with the service reading its clock halfway through
+static bool add_test_round_trip(
+	ClientClockOffsetEstimator &estimator,
+	unsigned long long sent_usec,
+	unsigned long long round_trip_usec,
+	long long service_read_delay_usec = 0)
+{
+	const unsigned long long service_usec =
+		sent_usec + round_trip_usec / 2 + service_read_delay_usec - k_test_clock_offset_usec;
+
+	return estimator.add_round_trip_sample(sent_usec, service_usec, sent_usec + round_trip_usec);
+}
+
+static PSMPoseSnapshot make_test_snapshot(unsigned long long server_timestamp_usec)
+{
+	PSMPoseSnapshot snapshot;
+
+	memset(&snapshot, 0, sizeof(PSMPoseSnapshot));
+	snapshot.Pose.Orientation.w = 1.f;
+	snapshot.bIsOrientationValid = true;
+	snapshot.bIsPositionValid = true;
+	snapshot.ServerTimestampUsec = server_timestamp_usec;
+
+	return snapshot;
+}
+
+static bool is_pose_rotated_about_z(const PSMPosef &pose, float expected_angle)
+{
+	return
+		fabsf(pose.Orientation.w - cosf(0.5f*expected_angle)) < k_test_epsilon &&
+		fabsf(pose.Orientation.x) < k_test_epsilon &&
+		fabsf(pose.Orientation.y) < k_test_epsilon &&
+		fabsf(pose.Orientation.z - sinf(0.5f*expected_angle)) < k_test_epsilon;
+}
+
+//-- public interface -----
+bool run_client_pose_extrapolation_unit_tests()
+{
+	UNIT_TEST_MODULE_BEGIN("client_pose_extrapolation")
+		UNIT_TEST_MODULE_CALL_TEST(client_pose_extrapolation_test_clock_offset_minimum_filter);
+		UNIT_TEST_MODULE_CALL_TEST(client_pose_extrapolation_test_clock_offset_creep);
+		UNIT_TEST_MODULE_CALL_TEST(client_pose_extrapolation_test_angular_velocity);
+		UNIT_TEST_MODULE_CALL_TEST(client_pose_extrapolation_test_time_limits);
+	UNIT_TEST_MODULE_END()
+}
+
+//-- private functions -----
+bool
+client_pose_extrapolation_test_clock_offset_minimum_filter()
+{
+	UNIT_TEST_BEGIN("clock_offset_minimum_filter")
+
+	ClientClockOffsetEstimator estimator;
+
+	success = !estimator.get_has_offset() && estimator.get_round_trip_usec() == 0;
+	assert(success);
+
+	// The service answered 400us late on a 1ms round trip, the offset is off by that much
+	success &= add_test_round_trip(estimator, 1000000, 1000, 400);
+	success &= estimator.get_has_offset() && estimator.get_offset_usec() == k_test_clock_offset_usec - 400;
+	assert(success);
+
+	// A shorter round trip bounds the offset better and replaces it
+	success &= add_test_round_trip(estimator, 1010000, 200, 50);
+	success &= estimator.get_offset_usec() == k_test_clock_offset_usec - 50 && estimator.get_round_trip_usec() == 200;
+	assert(success);
+
+	// Longer round trips shortly after don't
+	success &= !add_test_round_trip(estimator, 1020000, 800, 0);
+	success &= !add_test_round_trip(estimator, 1030000, 5000, 0);
+	success &= estimator.get_offset_usec() == k_test_clock_offset_usec - 50 && estimator.get_round_trip_usec() == 200;
+	assert(success);
+
+	// Starting over forgets the kept sample
+	estimator.reset();
+	success &= !estimator.get_has_offset();
+	success &= add_test_round_trip(estimator, 2000000, 5000, 0);
+	success &= estimator.get_offset_usec() == k_test_clock_offset_usec && estimator.get_round_trip_usec() == 5000;
+	assert(success);
+
+	UNIT_TEST_COMPLETE()
+}
+
+bool
+client_pose_extrapolation_test_clock_offset_creep()
+{
+	UNIT_TEST_BEGIN("clock_offset_creep")
+
+	const unsigned long long k_creep = ClientClockOffsetEstimator::k_round_trip_creep_usec_per_sec;
+	ClientClockOffsetEstimator estimator;
+
+	success = add_test_round_trip(estimator, 1000000, 100);
+	assert(success);
+
+	// After 10 seconds the kept 100us round trip counts as 100us + 10 * creep
+	const unsigned long long sent_usec = 1000000 + 10000000;
+	const unsigned long long aged_round_trip_usec = 100 + 10 * k_creep;
+
+	success &= !add_test_round_trip(estimator, sent_usec, aged_round_trip_usec + 50, 0);
+	success &= estimator.get_round_trip_usec() == 100;
+	assert(success);
+
+	// A round trip within the aged bound follows the drifted clock
+	success &= add_test_round_trip(estimator, sent_usec, aged_round_trip_usec - 50, 30);
+	success &= estimator.get_round_trip_usec() == aged_round_trip_usec - 50 && estimator.get_offset_usec() == k_test_clock_offset_usec - 30;
+	assert(success);
+
+	UNIT_TEST_COMPLETE()
+}
+
+bool
+client_pose_extrapolation_test_angular_velocity()
+{
+	UNIT_TEST_BEGIN("angular_velocity")
+
+	PSMPoseSnapshot snapshot = make_test_snapshot(1000000);
+	snapshot.PhysicsData.AngularVelocityRadPerSec.z = k_test_pi; // half a turn per second about z
+	snapshot.PhysicsData.LinearVelocityCmPerSec.x = 10.f;
+
+	// 50ms after the pose was taken on the client's clock
+	const unsigned long long pose_client_time_usec = snapshot.ServerTimestampUsec + k_test_clock_offset_usec;
+	PSMPosef pose;
+	PSMoveClient::extrapolate_pose(snapshot, k_test_clock_offset_usec, pose_client_time_usec + 50000, &pose);
+
+	success = is_pose_rotated_about_z(pose, k_test_pi * 0.05f);
+	assert(success);
+
+	success &= fabsf(pose.Position.x - 0.5f) < k_test_epsilon && fabsf(pose.Position.y) < k_test_epsilon && fabsf(pose.Position.z) < k_test_epsilon;
+	assert(success);
+
+	// Constant angular acceleration adds half of it times dt^2 to the angle
+	snapshot.PhysicsData.AngularAccelerationRadPerSecSqr.z = 2.f * k_test_pi;
+	PSMoveClient::extrapolate_pose(snapshot, k_test_clock_offset_usec, pose_client_time_usec + 50000, &pose);
+
+	success &= is_pose_rotated_about_z(pose, k_test_pi * 0.05f + 0.5f * 2.f * k_test_pi * 0.05f * 0.05f);
+	assert(success);
+
+	UNIT_TEST_COMPLETE()
+}
+
+bool
+client_pose_extrapolation_test_time_limits()
+{
+	UNIT_TEST_BEGIN("time_limits")
+
+	PSMPoseSnapshot snapshot = make_test_snapshot(1000000);
+	snapshot.PhysicsData.AngularVelocityRadPerSec.z = k_test_pi;
+	snapshot.PhysicsData.LinearVelocityCmPerSec.x = 10.f;
+
+	const unsigned long long pose_client_time_usec = snapshot.ServerTimestampUsec + k_test_clock_offset_usec;
+	PSMPosef pose;
+
+	// Targets further out than PSM_MAX_POSE_EXTRAPOLATION_USEC are clamped to it
+	PSMoveClient::extrapolate_pose(snapshot, k_test_clock_offset_usec, pose_client_time_usec + 10 * PSM_MAX_POSE_EXTRAPOLATION_USEC, &pose);
+
+	const float max_dt = static_cast<float>(PSM_MAX_POSE_EXTRAPOLATION_USEC) / 1000000.f;
+	success = is_pose_rotated_about_z(pose, k_test_pi * max_dt) && fabsf(pose.Position.x - 10.f * max_dt) < k_test_epsilon;
+	assert(success);
+
+	// Targets before the pose was taken never extrapolate backwards
+	PSMoveClient::extrapolate_pose(snapshot, k_test_clock_offset_usec, pose_client_time_usec - 20000, &pose);
+	success &= is_pose_rotated_about_z(pose, 0.f) && fabsf(pose.Position.x) < k_test_epsilon;
+	assert(success);
+
+	// Neither do poses without a service timestamp
+	snapshot.ServerTimestampUsec = 0;
+	PSMoveClient::extrapolate_pose(snapshot, k_test_clock_offset_usec, pose_client_time_usec + 50000, &pose);
+	success &= is_pose_rotated_about_z(pose, 0.f) && fabsf(pose.Position.x) < k_test_epsilon;
+	assert(success);
+
+	UNIT_TEST_COMPLETE()
+}
@@ -0,0 +1,287 @@
+//-- includes -----
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "PSMoveClient.h"
+#include "ClientConstants.h"
+#include "PSMoveProtocol.pb.h"
+#include "unit_test.h"
+
+//-- globals -----
+// The client the C API calls forward to
+extern PSMoveClient *g_psm_client;
+
+//-- constants -----
+// Never connected to, the tests only feed data frames to the client directly
+static const char *k_test_host = "localhost";
+static const char *k_test_port = "9512";
+
+// Devices that have received a data frame, every other view stays invalid
+static const PSMControllerID k_test_controller_ids[] = { 0, 2, 4 };
+static const int k_test_controller_count = sizeof(k_test_controller_ids) / sizeof(k_test_controller_ids[0]);
+static const PSMHmdID k_test_hmd_ids[] = { 1, 3 };
+static const int k_test_hmd_count = sizeof(k_test_hmd_ids) / sizeof(k_test_hmd_ids[0]);
+
+// Written to every entry beforehand to spot the ones the getters touched
+static const int k_test_untouched_id = -7;
+
+//-- data frame helpers -----
+// Data frames reach the client through the IDataFrameListener the ClientNetworkManager calls
+// when a frame arrives from the service
+static void inject_data_frame(const PSMoveProtocol::DeviceOutputDataFrame &data_frame)
+{
+	IDataFrameListener *listener = g_psm_client;
+
+	listener->handle_data_frame(&data_frame);
+}
+
+static void inject_test_devices()
+{
+	for (int index = 0; index < k_test_controller_count; ++index)
+	{
+		PSMoveProtocol::DeviceOutputDataFrame data_frame;
+		PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket *controller_packet = data_frame.mutable_controller_data_packet();
+
+		data_frame.set_device_category(PSMoveProtocol::DeviceOutputDataFrame::CONTROLLER);
+		controller_packet->set_controller_id(k_test_controller_ids[index]);
+		controller_packet->set_controller_type(PSMoveProtocol::PSMOVE);
+		controller_packet->set_sequence_num(index + 1);
+		controller_packet->set_isconnected(true);
+		inject_data_frame(data_frame);
+	}
+
+	for (int index = 0; index < k_test_hmd_count; ++index)
+	{
+		PSMoveProtocol::DeviceOutputDataFrame data_frame;
+		PSMoveProtocol::DeviceOutputDataFrame_HMDDataPacket *hmd_packet = data_frame.mutable_hmd_data_packet();
+
+		data_frame.set_device_category(PSMoveProtocol::DeviceOutputDataFrame::HMD);
+		hmd_packet->set_hmd_id(k_test_hmd_ids[index]);
+		hmd_packet->set_hmd_type(PSMoveProtocol::Morpheus);
+		hmd_packet->set_sequence_num(index + 1);
+		hmd_packet->set_isconnected(true);
+		inject_data_frame(data_frame);
+	}
+}
+
+static void reset_controller_state_block(PSMControllerStateBlock *state_block, int version)
+{
+	memset(state_block, 0, sizeof(PSMControllerStateBlock));
+	state_block->Version = version;
+	state_block->Count = -1;
+
+	for (int index = 0; index < PSMOVESERVICE_MAX_CONTROLLER_COUNT; ++index)
+	{
+		state_block->ControllerID[index] = k_test_untouched_id;
+	}
+}
+
+static void reset_hmd_state_block(PSMHmdStateBlock *state_block, int version)
+{
+	memset(state_block, 0, sizeof(PSMHmdStateBlock));
+	state_block->Version = version;
+	state_block->Count = -1;
+
+	for (int index = 0; index < PSMOVESERVICE_MAX_HMD_COUNT; ++index)
+	{
+		state_block->HmdID[index] = k_test_untouched_id;
+	}
+}
+
+// The first count entries are the test devices in id order, the rest weren't written
+static bool is_controller_state_block_filled(const PSMControllerStateBlock &state_block, int count)
+{
+	bool bIsFilled = state_block.Count == count;
+
+	for (int index = 0; bIsFilled && index < PSMOVESERVICE_MAX_CONTROLLER_COUNT; ++index)
+	{
+		if (index < count)
+		{
+			bIsFilled &= state_block.ControllerID[index] == k_test_controller_ids[index];
+			bIsFilled &= state_block.ControllerType[index] == PSMController_Move;
+			bIsFilled &= state_block.OutputSequenceNum[index] == index + 1;
+			bIsFilled &= (state_block.StateFlags[index] & PSMDeviceStateFlags_isConnected) != 0;
+		}
+		else
+		{
+			bIsFilled &= state_block.ControllerID[index] == k_test_untouched_id;
+		}
+	}
+
+	return bIsFilled;
+}
+
+static bool is_hmd_state_block_filled(const PSMHmdStateBlock &state_block, int count)
+{
+	bool bIsFilled = state_block.Count == count;
+
+	for (int index = 0; bIsFilled && index < PSMOVESERVICE_MAX_HMD_COUNT; ++index)
+	{
+		if (index < count)
+		{
+			bIsFilled &= state_block.HmdID[index] == k_test_hmd_ids[index];
+			bIsFilled &= state_block.HmdType[index] == PSMHmd_Morpheus;
+			bIsFilled &= state_block.OutputSequenceNum[index] == index + 1;
+			bIsFilled &= (state_block.StateFlags[index] & PSMDeviceStateFlags_isConnected) != 0;
+		}
+		else
+		{
+			bIsFilled &= state_block.HmdID[index] == k_test_untouched_id;
+		}
+	}
+
+	return bIsFilled;
+}
+
+//-- public interface -----
+bool run_client_state_block_unit_tests()
+{
+	UNIT_TEST_MODULE_BEGIN("client_state_block")
+		UNIT_TEST_MODULE_CALL_TEST(client_state_block_test_version);
+		UNIT_TEST_MODULE_CALL_TEST(client_state_block_test_null_block);
+		UNIT_TEST_MODULE_CALL_TEST(client_state_block_test_short_block);
+	UNIT_TEST_MODULE_END()
+}
+
+//-- private functions -----
+bool
+client_state_block_test_version()
+{
+	UNIT_TEST_BEGIN("version")
+
+	PSMControllerStateBlock controller_block;
+	PSMHmdStateBlock hmd_block;
+
+	// No client to read from yet
+	reset_controller_state_block(&controller_block, PSM_CONTROLLER_STATE_BLOCK_VERSION);
+	reset_hmd_state_block(&hmd_block, PSM_HMD_STATE_BLOCK_VERSION);
+	success = PSM_GetAllControllerStates(&controller_block, PSMOVESERVICE_MAX_CONTROLLER_COUNT) == PSMResult_Error;
+	success &= PSM_GetAllHmdStates(&hmd_block, PSMOVESERVICE_MAX_HMD_COUNT) == PSMResult_Error;
+	success &= controller_block.Count == -1 && hmd_block.Count == -1;
+	assert(success);
+
+	success &= PSM_InitializeAsync(k_test_host, k_test_port) == PSMResult_RequestSent;
+	assert(success);
+
+	// Blocks laid out by an older or newer client are left alone
+	const int mismatched_versions[] = { 0, PSM_CONTROLLER_STATE_BLOCK_VERSION + 1 };
+	for (int version_index = 0; version_index < 2; ++version_index)
+	{
+		reset_controller_state_block(&controller_block, mismatched_versions[version_index]);
+		success &= PSM_GetAllControllerStates(&controller_block, PSMOVESERVICE_MAX_CONTROLLER_COUNT) == PSMResult_Error;
+		success &= is_controller_state_block_filled(controller_block, -1);
+	}
+	assert(success);
+
+	const int mismatched_hmd_versions[] = { 0, PSM_HMD_STATE_BLOCK_VERSION + 1 };
+	for (int version_index = 0; version_index < 2; ++version_index)
+	{
+		reset_hmd_state_block(&hmd_block, mismatched_hmd_versions[version_index]);
+		success &= PSM_GetAllHmdStates(&hmd_block, PSMOVESERVICE_MAX_HMD_COUNT) == PSMResult_Error;
+		success &= is_hmd_state_block_filled(hmd_block, -1);
+	}
+	assert(success);
+
+	// No device has received data yet
+	reset_controller_state_block(&controller_block, PSM_CONTROLLER_STATE_BLOCK_VERSION);
+	reset_hmd_state_block(&hmd_block, PSM_HMD_STATE_BLOCK_VERSION);
+	success &= PSM_GetAllControllerStates(&controller_block, PSMOVESERVICE_MAX_CONTROLLER_COUNT) == PSMResult_Success;
+	success &= PSM_GetAllHmdStates(&hmd_block, PSMOVESERVICE_MAX_HMD_COUNT) == PSMResult_Success;
+	success &= is_controller_state_block_filled(controller_block, 0) && is_hmd_state_block_filled(hmd_block, 0);
+	assert(success);
+
+	// The current version reads every device with data
+	inject_test_devices();
+
+	reset_controller_state_block(&controller_block, PSM_CONTROLLER_STATE_BLOCK_VERSION);
+	reset_hmd_state_block(&hmd_block, PSM_HMD_STATE_BLOCK_VERSION);
+	success &= PSM_GetAllControllerStates(&controller_block, PSMOVESERVICE_MAX_CONTROLLER_COUNT) == PSMResult_Success;
+	success &= PSM_GetAllHmdStates(&hmd_block, PSMOVESERVICE_MAX_HMD_COUNT) == PSMResult_Success;
+	success &= is_controller_state_block_filled(controller_block, k_test_controller_count);
+	success &= is_hmd_state_block_filled(hmd_block, k_test_hmd_count);
+	assert(success);
+
+	success &= PSM_Shutdown() == PSMResult_Success;
+	assert(success);
+
+	UNIT_TEST_COMPLETE()
+}
+
+bool
+client_state_block_test_null_block()
+{
+	UNIT_TEST_BEGIN("null block")
+
+	success = PSM_GetAllControllerStates(nullptr, PSMOVESERVICE_MAX_CONTROLLER_COUNT) == PSMResult_Error;
+	success &= PSM_GetAllHmdStates(nullptr, PSMOVESERVICE_MAX_HMD_COUNT) == PSMResult_Error;
+	assert(success);
+
+	success &= PSM_InitializeAsync(k_test_host, k_test_port) == PSMResult_RequestSent;
+	assert(success);
+
+	inject_test_devices();
+
+	success &= PSM_GetAllControllerStates(nullptr, PSMOVESERVICE_MAX_CONTROLLER_COUNT) == PSMResult_Error;
+	success &= PSM_GetAllHmdStates(nullptr, PSMOVESERVICE_MAX_HMD_COUNT) == PSMResult_Error;
+	assert(success);
+
+	success &= PSM_Shutdown() == PSMResult_Success;
+	assert(success);
+
+	UNIT_TEST_COMPLETE()
+}
+
+bool
+client_state_block_test_short_block()
+{
+	UNIT_TEST_BEGIN("short block")
+
+	PSMControllerStateBlock controller_block;
+	PSMHmdStateBlock hmd_block;
+
+	success = PSM_InitializeAsync(k_test_host, k_test_port) == PSMResult_RequestSent;
+	assert(success);
+
+	inject_test_devices();
+
+	// Fewer entries than devices with data, only the first ones in id order get written
+	for (int max_count = 0; max_count < k_test_controller_count; ++max_count)
+	{
+		reset_controller_state_block(&controller_block, PSM_CONTROLLER_STATE_BLOCK_VERSION);
+		success &= PSM_GetAllControllerStates(&controller_block, max_count) == PSMResult_Success;
+		success &= is_controller_state_block_filled(controller_block, max_count);
+	}
+	assert(success);
+
+	for (int max_count = 0; max_count < k_test_hmd_count; ++max_count)
+	{
+		reset_hmd_state_block(&hmd_block, PSM_HMD_STATE_BLOCK_VERSION);
+		success &= PSM_GetAllHmdStates(&hmd_block, max_count) == PSMResult_Success;
+		success &= is_hmd_state_block_filled(hmd_block, max_count);
+	}
+	assert(success);
+
+	// A negative count writes nothing
+	reset_controller_state_block(&controller_block, PSM_CONTROLLER_STATE_BLOCK_VERSION);
+	reset_hmd_state_block(&hmd_block, PSM_HMD_STATE_BLOCK_VERSION);
+	success &= PSM_GetAllControllerStates(&controller_block, -1) == PSMResult_Success;
+	success &= PSM_GetAllHmdStates(&hmd_block, -1) == PSMResult_Success;
+	success &= is_controller_state_block_filled(controller_block, 0) && is_hmd_state_block_filled(hmd_block, 0);
+	assert(success);
+
+	// Counts past the size of the arrays stop at the arrays
+	reset_controller_state_block(&controller_block, PSM_CONTROLLER_STATE_BLOCK_VERSION);
+	reset_hmd_state_block(&hmd_block, PSM_HMD_STATE_BLOCK_VERSION);
+	success &= PSM_GetAllControllerStates(&controller_block, 10 * PSMOVESERVICE_MAX_CONTROLLER_COUNT) == PSMResult_Success;
+	success &= PSM_GetAllHmdStates(&hmd_block, 10 * PSMOVESERVICE_MAX_HMD_COUNT) == PSMResult_Success;
+	success &= is_controller_state_block_filled(controller_block, k_test_controller_count);
+	success &= is_hmd_state_block_filled(hmd_block, k_test_hmd_count);
+	assert(success);
+
+	success &= PSM_Shutdown() == PSMResult_Success;
+	assert(success);
+
+	UNIT_TEST_COMPLETE()
+}
@@ -0,0 +1,236 @@
+//-- includes -----
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "DeviceCaptureFile.h"
+#include "unit_test.h"
+
+//-- constants -----
+// Smallest chunk the writer maps, so a few hundred records span several chunks
+static const size_t k_test_chunk_size = 64*1024;
+static const int k_test_report_count = 2000;
+static const size_t k_test_report_size = 49;
+static const int k_test_hid_stream_id = 3;
+static const char *k_test_device_path = "/dev/hidraw0";
+
+// Offsets of the fields of the file header
+static const std::streamoff k_test_header_version_offset = 8;
+static const std::streamoff k_test_header_area_size_offset = 16;
+static const std::streamoff k_test_header_chunk_size_offset = 24;
+static const size_t k_test_header_size = 40;
+static const unsigned long long k_test_header_area_size = 64*1024;
+
+//-- helpers -----
+static std::string make_test_filename()
+{
+	return (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("psmove_capture_%%%%-%%%%.psmcap")).string();
+}
+
+static void make_test_report(int report_index, unsigned char *out_report)
+{
+	for (size_t byte_index = 0; byte_index < k_test_report_size; ++byte_index)
+	{
+		out_report[byte_index] = static_cast<unsigned char>(report_index + byte_index);
+	}
+}
+
+// A stream info record followed by k_test_report_count input reports
+static bool write_test_capture(const std::string &filename)
+{
+	DeviceCaptureWriter writer;
+	bool bSuccess = writer.open(filename, k_test_chunk_size);
+
+	if (bSuccess)
+	{
+		DeviceCaptureStreamInfo stream_info;
+
+		memset(&stream_info, 0, sizeof(stream_info));
+		stream_info.stream_type = _DeviceCaptureStream_HID;
+		stream_info.device_type = -1;
+		stream_info.vendor_id = 0x054c;
+		stream_info.product_id = 0x03d5;
+
+		bSuccess = writer.append(
+			_DeviceCaptureRecord_StreamInfo, k_test_hid_stream_id, 0,
+			&stream_info, sizeof(stream_info),
+			k_test_device_path, strlen(k_test_device_path) + 1);
+	}
+
+	for (int report_index = 0; bSuccess && report_index < k_test_report_count; ++report_index)
+	{
+		unsigned char report[k_test_report_size];
+
+		make_test_report(report_index, report);
+		bSuccess = writer.append(
+			_DeviceCaptureRecord_InputReport, k_test_hid_stream_id, 1000 + report_index*4000,
+			nullptr, 0,
+			report, sizeof(report));
+	}
+
+	writer.close();
+
+	return bSuccess;
+}
+
+template <typename t_value>
+static bool patch_test_capture(const std::string &filename, std::streamoff offset, t_value value)
+{
+	std::fstream file(filename, std::fstream::in | std::fstream::out | std::fstream::binary);
+
+	file.seekp(offset);
+	file.write(reinterpret_cast<const char *>(&value), sizeof(value));
+
+	return file.good();
+}
+
+//-- public interface -----
+bool run_device_capture_file_unit_tests()
+{
+	UNIT_TEST_MODULE_BEGIN("device_capture_file")
+		UNIT_TEST_MODULE_CALL_TEST(device_capture_file_test_round_trip);
+		UNIT_TEST_MODULE_CALL_TEST(device_capture_file_test_truncated_header);
+		UNIT_TEST_MODULE_CALL_TEST(device_capture_file_test_corrupt_header);
+	UNIT_TEST_MODULE_END()
+}
+
+//-- private functions -----
+bool
+device_capture_file_test_round_trip()
+{
+	UNIT_TEST_BEGIN("round trip")
+
+	const std::string filename = make_test_filename();
+
+	success = write_test_capture(filename);
+	assert(success);
+
+	// The reports don't fit in a single chunk
+	success &= boost::filesystem::file_size(filename) > k_test_header_area_size + k_test_chunk_size;
+	assert(success);
+
+	DeviceCaptureReader reader;
+	success &= reader.open(filename) && reader.getIsOpen();
+	assert(success);
+
+	const std::vector<DeviceCaptureRecord> &records = reader.getRecords();
+	success &= records.size() == k_test_report_count + 1;
+	assert(success);
+
+	if (success)
+	{
+		const DeviceCaptureRecord &stream_record = records[0];
+		const DeviceCaptureStreamInfo *stream_info = reinterpret_cast<const DeviceCaptureStreamInfo *>(stream_record.payload);
+
+		success &= stream_record.record_type == _DeviceCaptureRecord_StreamInfo;
+		success &= stream_record.stream_id == k_test_hid_stream_id;
+		success &= stream_record.payload_size == sizeof(DeviceCaptureStreamInfo) + strlen(k_test_device_path) + 1;
+		success &= stream_info->stream_type == _DeviceCaptureStream_HID && stream_info->product_id == 0x03d5;
+		success &= strcmp(reinterpret_cast<const char *>(stream_record.payload + sizeof(DeviceCaptureStreamInfo)), k_test_device_path) == 0;
+		assert(success);
+
+		for (int report_index = 0; success && report_index < k_test_report_count; ++report_index)
+		{
+			const DeviceCaptureRecord &report_record = records[report_index + 1];
+			unsigned char report[k_test_report_size];
+
+			make_test_report(report_index, report);
+			success &= report_record.record_type == _DeviceCaptureRecord_InputReport;
+			success &= report_record.stream_id == k_test_hid_stream_id;
+			success &= report_record.arrival_usec == 1000 + report_index*4000;
+			success &= report_record.payload_size == k_test_report_size;
+			success &= memcmp(report_record.payload, report, k_test_report_size) == 0;
+		}
+		assert(success);
+	}
+
+	reader.close();
+	success &= !reader.getIsOpen() && reader.getRecords().empty();
+	assert(success);
+
+	boost::filesystem::remove(filename);
+
+	UNIT_TEST_COMPLETE()
+}
+
+bool
+device_capture_file_test_truncated_header()
+{
+	UNIT_TEST_BEGIN("truncated header")
+
+	const std::string filename = make_test_filename();
+
+	success = write_test_capture(filename);
+	assert(success);
+
+	// Cut inside of the file header
+	boost::filesystem::resize_file(filename, k_test_header_size - 8);
+
+	DeviceCaptureReader reader;
+	success &= !reader.open(filename) && !reader.getIsOpen() && reader.getRecords().empty();
+	assert(success);
+
+	// Cut inside of the header area, before the first chunk
+	success &= write_test_capture(filename);
+	boost::filesystem::resize_file(filename, 1024);
+
+	success &= !reader.open(filename) && !reader.getIsOpen();
+	assert(success);
+
+	boost::filesystem::remove(filename);
+
+	UNIT_TEST_COMPLETE()
+}
+
+bool
+device_capture_file_test_corrupt_header()
+{
+	UNIT_TEST_BEGIN("corrupt header")
+
+	const std::string filename = make_test_filename();
+	DeviceCaptureReader reader;
+
+	// Not a capture file
+	success = write_test_capture(filename);
+	success &= patch_test_capture(filename, 0, 'X');
+	success &= !reader.open(filename);
+	assert(success);
+
+	// Written by another version
+	success &= write_test_capture(filename);
+	success &= patch_test_capture(filename, k_test_header_version_offset, static_cast<uint32_t>(DEVICE_CAPTURE_FILE_VERSION + 1));
+	success &= !reader.open(filename);
+	assert(success);
+
+	// A chunk size that would never advance past the first chunk
+	success &= write_test_capture(filename);
+	success &= patch_test_capture(filename, k_test_header_chunk_size_offset, static_cast<uint64_t>(0));
+	success &= !reader.open(filename);
+	assert(success);
+
+	// Header areas smaller than the header or past the end of the file
+	success &= write_test_capture(filename);
+	success &= patch_test_capture(filename, k_test_header_area_size_offset, static_cast<uint64_t>(8));
+	success &= !reader.open(filename);
+	assert(success);
+
+	success &= patch_test_capture(filename, k_test_header_area_size_offset, static_cast<uint64_t>(1) << 40);
+	success &= !reader.open(filename) && !reader.getIsOpen() && reader.getRecords().empty();
+	assert(success);
+
+	// The untouched capture still opens
+	success &= write_test_capture(filename);
+	success &= reader.open(filename) && reader.getRecords().size() == k_test_report_count + 1;
+	assert(success);
+
+	reader.close();
+	boost::filesystem::remove(filename);
+
+	UNIT_TEST_COMPLETE()
+}
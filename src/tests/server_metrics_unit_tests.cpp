@@ -0,0 +1,202 @@
+//-- includes -----
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <sstream>
+#include <string>
+
+#include "ServerMetrics.h"
+#include "SharedConstants.h"
+#include "unit_test.h"
+
+//-- constants -----
+static const char *k_test_frames_sent_metric = "psmoveservice_connection_data_frames_sent_total";
+static const char *k_test_frames_dropped_metric = "psmoveservice_connection_data_frames_dropped_total";
+static const char *k_test_queue_depth_metric = "psmoveservice_connection_data_frame_queue_depth";
+static const char *k_test_frames_grabbed_metric = "psmoveservice_tracker_frames_grabbed_total";
+static const char *k_test_hid_read_errors_metric = "psmoveservice_hid_read_errors_total";
+
+// More connections than the registry keeps series for
+static const int k_test_connection_count = 64;
+
+//-- helpers -----
+static std::string get_prometheus_text()
+{
+	std::ostringstream out;
+
+	ServerMetrics::write_prometheus_text(out);
+
+	return out.str();
+}
+
+static std::string make_series_name(const char *metric_name, const char *label_name, int label_id)
+{
+	std::ostringstream series_name;
+
+	series_name << metric_name << "{" << label_name << "=\"" << label_id << "\"}";
+
+	return series_name.str();
+}
+
+// Every series line follows a HELP or TYPE comment, so a series is always at the start of a line
+static bool get_series_value(const std::string &text, const std::string &series_name, long long *out_value)
+{
+	const std::string series_prefix = "\n" + series_name + " ";
+	const size_t series_offset = text.find(series_prefix);
+
+	if (series_offset == std::string::npos)
+	{
+		return false;
+	}
+
+	*out_value = atoll(text.c_str() + series_offset + series_prefix.length());
+
+	return true;
+}
+
+static int count_series(const std::string &text, const char *metric_name)
+{
+	const std::string series_prefix = std::string("\n") + metric_name + "{";
+	int series_count = 0;
+
+	for (size_t offset = text.find(series_prefix); offset != std::string::npos; offset = text.find(series_prefix, offset + 1))
+	{
+		++series_count;
+	}
+
+	return series_count;
+}
+
+//-- public interface -----
+bool run_server_metrics_unit_tests()
+{
+	UNIT_TEST_MODULE_BEGIN("server_metrics")
+		UNIT_TEST_MODULE_CALL_TEST(server_metrics_test_device_series);
+		UNIT_TEST_MODULE_CALL_TEST(server_metrics_test_connection_series);
+		UNIT_TEST_MODULE_CALL_TEST(server_metrics_test_connection_slot_reuse);
+	UNIT_TEST_MODULE_END()
+}
+
+//-- private functions -----
+bool
+server_metrics_test_device_series()
+{
+	UNIT_TEST_BEGIN("device series")
+
+	long long value = 0;
+
+	// Unlabeled metrics are always exported
+	std::string text = get_prometheus_text();
+	success = get_series_value(text, k_test_hid_read_errors_metric, &value) && value == 0;
+	assert(success);
+
+	success &= text.find(std::string("# TYPE ") + k_test_hid_read_errors_metric + " counter\n") != std::string::npos;
+	success &= text.find(std::string("# TYPE ") + k_test_queue_depth_metric + " gauge\n") != std::string::npos;
+	assert(success);
+
+	// Device series only show up once recorded to
+	success &= count_series(text, k_test_frames_grabbed_metric) == 0;
+	assert(success);
+
+	ServerMetrics::increment_counter(ServerMetric_HidReadErrors, -1, 3);
+	ServerMetrics::increment_counter(ServerMetric_TrackerFramesGrabbed, 1);
+	ServerMetrics::increment_counter(ServerMetric_TrackerFramesGrabbed, 1, 9);
+	ServerMetrics::increment_counter(ServerMetric_TrackerFramesGrabbed, PSMOVESERVICE_MAX_TRACKER_COUNT);
+	ServerMetrics::increment_counter(ServerMetric_TrackerFramesGrabbed, -1);
+
+	text = get_prometheus_text();
+	success &= get_series_value(text, k_test_hid_read_errors_metric, &value) && value == 3;
+	success &= get_series_value(text, make_series_name(k_test_frames_grabbed_metric, "tracker", 1), &value) && value == 10;
+	assert(success);
+
+	// Ids outside of the tracker list are skipped
+	success &= count_series(text, k_test_frames_grabbed_metric) == 1;
+	assert(success);
+
+	UNIT_TEST_COMPLETE()
+}
+
+bool
+server_metrics_test_connection_series()
+{
+	UNIT_TEST_BEGIN("connection series")
+
+	long long value = 0;
+
+	// A new connection's series are exported right away, starting at zero
+	ServerMetrics::add_connection(7);
+
+	std::string text = get_prometheus_text();
+	success = get_series_value(text, make_series_name(k_test_frames_sent_metric, "connection", 7), &value) && value == 0;
+	success &= get_series_value(text, make_series_name(k_test_frames_dropped_metric, "connection", 7), &value) && value == 0;
+	success &= get_series_value(text, make_series_name(k_test_queue_depth_metric, "connection", 7), &value) && value == 0;
+	assert(success);
+
+	ServerMetrics::increment_counter(ServerMetric_ConnectionDataFramesSent, 7, 5);
+	ServerMetrics::set_gauge(ServerMetric_ConnectionDataFrameQueueDepth, 7, 4);
+	ServerMetrics::set_gauge(ServerMetric_ConnectionDataFrameQueueDepth, 7, 2);
+
+	// Connections that were never added have no series to record to
+	ServerMetrics::increment_counter(ServerMetric_ConnectionDataFramesSent, 8, 5);
+
+	text = get_prometheus_text();
+	success &= get_series_value(text, make_series_name(k_test_frames_sent_metric, "connection", 7), &value) && value == 5;
+	success &= get_series_value(text, make_series_name(k_test_queue_depth_metric, "connection", 7), &value) && value == 2;
+	success &= count_series(text, k_test_frames_sent_metric) == 1;
+	assert(success);
+
+	// A removed connection's series disappear
+	ServerMetrics::remove_connection(7);
+
+	text = get_prometheus_text();
+	success &= count_series(text, k_test_frames_sent_metric) == 0;
+	success &= count_series(text, k_test_queue_depth_metric) == 0;
+	assert(success);
+
+	UNIT_TEST_COMPLETE()
+}
+
+bool
+server_metrics_test_connection_slot_reuse()
+{
+	UNIT_TEST_BEGIN("connection slot reuse")
+
+	long long value = 0;
+
+	for (int connection_id = 0; connection_id < k_test_connection_count; ++connection_id)
+	{
+		ServerMetrics::add_connection(connection_id);
+		ServerMetrics::increment_counter(ServerMetric_ConnectionDataFramesSent, connection_id, connection_id + 1);
+	}
+
+	// Connections beyond the registry's slots don't get a series, the ones that did keep their own counts
+	std::string text = get_prometheus_text();
+	const int series_count = count_series(text, k_test_frames_sent_metric);
+	success = series_count > 0 && series_count < k_test_connection_count;
+	success &= get_series_value(text, make_series_name(k_test_frames_sent_metric, "connection", 0), &value) && value == 1;
+	success &= !get_series_value(text, make_series_name(k_test_frames_sent_metric, "connection", k_test_connection_count - 1), &value);
+	assert(success);
+
+	// Freeing a slot lets the next connection have it, starting from zero
+	// (even though the removed connection's count was never cleared)
+	ServerMetrics::remove_connection(0);
+	ServerMetrics::increment_counter(ServerMetric_ConnectionDataFramesSent, 0, 1);
+	ServerMetrics::add_connection(k_test_connection_count);
+
+	text = get_prometheus_text();
+	success &= !get_series_value(text, make_series_name(k_test_frames_sent_metric, "connection", 0), &value);
+	success &= get_series_value(text, make_series_name(k_test_frames_sent_metric, "connection", k_test_connection_count), &value) && value == 0;
+	success &= count_series(text, k_test_frames_sent_metric) == series_count;
+	assert(success);
+
+	for (int connection_id = 0; connection_id <= k_test_connection_count; ++connection_id)
+	{
+		ServerMetrics::remove_connection(connection_id);
+	}
+
+	text = get_prometheus_text();
+	success &= count_series(text, k_test_frames_sent_metric) == 0;
+	assert(success);
+
+	UNIT_TEST_COMPLETE()
+}
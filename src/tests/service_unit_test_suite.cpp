@@ -0,0 +1,19 @@
+//-- includes -----
+#include <stdio.h>
+#include <stdlib.h>
+#include "unit_test.h"
+
+//-- prototypes -----
+
+//-- entry point -----
+// Unit tests of service code that logs through ServerLog,
+// which can't be linked next to the client library's ClientLog in unit_test_suite
+int
+main(int argc, char* argv[])
+{
+	UNIT_TEST_SUITE_BEGIN()
+		UNIT_TEST_SUITE_CALL_CPP_MODULE(run_device_capture_file_unit_tests);
+	UNIT_TEST_SUITE_END()
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <iomanip>
 #include <chrono>
 #include <cstring>
+#include <string>
 
 #if defined(__linux) || defined (__APPLE__)
 #include <unistd.h>
@@ -195,6 +196,11 @@ private:
         
 			std::cout << std::endl;
         
+			if (controller0->ControllerState.PSMoveState.TriangleButton == PSMButtonState_PRESSED)
+			{
+				dumpServicePerformanceStats();
+			}
+
 			if (controller0->ControllerState.PSMoveState.CrossButton != PSMButtonState_UP)
 			{
 				m_keepRunning = false;
@@ -212,9 +218,52 @@ private:
 		// No tracker data streams started
 		// No HMD data streams started
 
+        dumpServicePerformanceStats();
+
         PSM_Shutdown();
     }
 
+	void dumpServicePerformanceStats()
+	{
+		static const char *k_stage_names[PSMServiceStage_count]= {
+			"Tick", "DevicePoll", "OpticalPoseEstimation", "FilterUpdate", "Publish"
+		};
+		static const char *k_category_names[]= {"Controller", "Tracker", "HMD"};
+
+		PSMServicePerformanceStats stats;
+		if (PSM_GetServicePerformanceStats(&stats, false, PSM_DEFAULT_TIMEOUT) != PSMResult_Success)
+		{
+			std::cout << "Failed to get the service performance stats" << std::endl;
+			return;
+		}
+
+		std::cout << "Service stage timings (us, last " << stats.WindowSampleCount << "-" << 2*stats.WindowSampleCount << " samples):" << std::endl;
+		std::cout << std::setw(24) << std::left << "Stage" << std::setw(16) << "Device";
+		std::cout << std::setw(10) << std::right << "Samples" << std::setw(12) << "Min" << std::setw(12) << "Mean" << std::setw(12) << "Max" << std::endl;
+
+		for (int stats_index= 0; stats_index < stats.StageStatsCount; ++stats_index)
+		{
+			const PSMServiceStageStats &stage_stats= stats.StageStats[stats_index];
+			std::string device_name= "All";
+
+			if (stage_stats.DeviceID != -1)
+			{
+				device_name= std::string(k_category_names[stage_stats.DeviceCategory]) + " " + std::to_string(stage_stats.DeviceID);
+			}
+
+			const double mean_nsec= 
+				(stage_stats.SampleCount > 0) ? static_cast<double>(stage_stats.TotalNsec) / static_cast<double>(stage_stats.SampleCount) : 0.0;
+
+			std::cout << std::setw(24) << std::left << k_stage_names[stage_stats.Stage] << std::setw(16) << device_name;
+			std::cout << std::setw(10) << std::right << stage_stats.SampleCount;
+			std::cout << std::fixed << std::setprecision(1);
+			std::cout << std::setw(12) << stage_stats.MinNsec / 1000.0;
+			std::cout << std::setw(12) << mean_nsec / 1000.0;
+			std::cout << std::setw(12) << stage_stats.MaxNsec / 1000.0;
+			std::cout << std::defaultfloat << std::endl;
+		}
+	}
+
 	void rebuildControllerList()
 	{
 		memset(&controllerList, 0, sizeof(PSMControllerList));
@@ -262,6 +311,9 @@ private:
             case PSMTracker_PS3Eye:
                 tracker_type= "PS3Eye";
                 break;
+            case PSMTracker_Virtual:
+                tracker_type= "Virtual";
+                break;
             }
 
             std::cout << "  Tracker ID: " << trackerList.trackers[tracker_ix].tracker_id << " is a " << tracker_type << std::endl;
@@ -13,6 +13,10 @@ main(int argc, char* argv[])
 		UNIT_TEST_SUITE_CALL_CPP_MODULE(run_math_alignment_unit_tests);
 		UNIT_TEST_SUITE_CALL_CPP_MODULE(run_math_eigen_unit_tests);
 		UNIT_TEST_SUITE_CALL_CPP_MODULE(run_math_utility_unit_tests);
+		UNIT_TEST_SUITE_CALL_CPP_MODULE(run_client_message_queue_unit_tests);
+		UNIT_TEST_SUITE_CALL_CPP_MODULE(run_client_pose_extrapolation_unit_tests);
+		UNIT_TEST_SUITE_CALL_CPP_MODULE(run_client_state_block_unit_tests);
+		UNIT_TEST_SUITE_CALL_CPP_MODULE(run_server_metrics_unit_tests);
 	UNIT_TEST_SUITE_END()
 
 	return success ? EXIT_SUCCESS : EXIT_FAILURE;